@@ -36,6 +36,7 @@
 
 #include "execute_task_solution_capability.h"
 
+#include <moveit/task_constructor/merge.h>
 #include <moveit/plan_execution/plan_execution.h>
 #include <moveit/trajectory_processing/trajectory_tools.h>
 #include <moveit/kinematic_constraints/utils.h>
@@ -45,8 +46,15 @@
 #include <moveit/utils/moveit_error_code.h>
 #include <fmt/format.h>
 
+#include <cmath>
+#include <future>
+#include <thread>
+
 namespace {
 
+// period of progress feedback while executing a sub trajectory
+constexpr double FEEDBACK_PERIOD = 0.1;
+
 // TODO: move to moveit::core::RobotModel
 const moveit::core::JointModelGroup* findJointModelGroup(const moveit::core::RobotModel& model,
                                                          const std::vector<std::string>& joints) {
@@ -76,12 +84,154 @@ const moveit::core::JointModelGroup* findJointModelGroup(const moveit::core::Rob
 
 	return nullptr;
 }
+
+// names of all joints actuated by a sub trajectory
+std::vector<std::string> jointNames(const moveit_task_constructor_msgs::SubTrajectory& sub_traj) {
+	std::vector<std::string> joint_names(sub_traj.trajectory.joint_trajectory.joint_names);
+	joint_names.insert(joint_names.end(), sub_traj.trajectory.multi_dof_joint_trajectory.joint_names.begin(),
+	                   sub_traj.trajectory.multi_dof_joint_trajectory.joint_names.end());
+	return joint_names;
+}
+
+// whether applying the scene diff of a sub trajectory changes anything beyond the robot's joint state
+bool hasSceneEffect(moveit_msgs::PlanningScene scene_diff) {
+	scene_diff.robot_state.joint_state = sensor_msgs::JointState();
+	scene_diff.robot_state.multi_dof_joint_state = sensor_msgs::MultiDOFJointState();
+	return !moveit::core::isEmpty(scene_diff);
+}
+
+// whether a sub trajectory moves the robot, i.e. its execution is validated against the current scene
+bool hasMotion(const moveit_task_constructor_msgs::SubTrajectory& sub_traj) {
+	return !sub_traj.trajectory.joint_trajectory.points.empty() ||
+	       !sub_traj.trajectory.multi_dof_joint_trajectory.points.empty();
+}
+
+// whether next can be executed continuously after prev: by the same controllers, without a scene change in between
+bool canBlend(const moveit_task_constructor_msgs::SubTrajectory& prev,
+              const robot_trajectory::RobotTrajectory& prev_traj,
+              const moveit_task_constructor_msgs::SubTrajectory& next,
+              const robot_trajectory::RobotTrajectory& next_traj) {
+	return !prev_traj.empty() && !next_traj.empty() && prev_traj.getGroup() == next_traj.getGroup() &&
+	       prev.execution_info.controller_names == next.execution_info.controller_names &&
+	       !hasSceneEffect(prev.scene_diff);
+}
+
+// velocity and acceleration scaling a trajectory was timed with
+struct Scaling
+{
+	double velocity = 1.0;
+	double acceleration = 1.0;
+};
+
+/* estimate the scaling of a timed trajectory from its peak velocities and accelerations w.r.t. the joint limits
+ *
+ * Sub trajectories don't carry the scaling their planner used. However, time-optimal parameterization
+ * saturates (scaled) limits, such that the largest ratio of a limit used by any waypoint is a good estimate. */
+Scaling estimateScaling(const robot_trajectory::RobotTrajectory& trajectory) {
+	constexpr double MIN_SCALING = 0.01;
+	double velocity = 0.0, acceleration = 0.0;
+	const moveit::core::RobotModel& model = *trajectory.getRobotModel();
+	const std::vector<int>& indices = trajectory.getGroup() ? trajectory.getGroup()->getVariableIndexList() :
+	                                                          std::vector<int>();
+	for (size_t k = 0; k < trajectory.getWayPointCount(); ++k) {
+		const moveit::core::RobotState& waypoint = trajectory.getWayPoint(k);
+		for (int index : indices) {
+			const moveit::core::VariableBounds& bounds = model.getVariableBounds(model.getVariableNames()[index]);
+			if (waypoint.hasVelocities() && bounds.velocity_bounded_ && bounds.max_velocity_ > 0.0)
+				velocity = std::max(velocity, std::abs(waypoint.getVariableVelocity(index)) / bounds.max_velocity_);
+			if (waypoint.hasAccelerations() && bounds.acceleration_bounded_ && bounds.max_acceleration_ > 0.0)
+				acceleration =
+				    std::max(acceleration, std::abs(waypoint.getVariableAcceleration(index)) / bounds.max_acceleration_);
+		}
+	}
+	// unknown (zero) or excessive ratios keep the full limits
+	Scaling result;
+	if (velocity > 0.0)
+		result.velocity = std::min(1.0, std::max(MIN_SCALING, velocity));
+	if (acceleration > 0.0)
+		result.acceleration = std::min(1.0, std::max(MIN_SCALING, acceleration));
+	return result;
+}
+
+// plan component executing several sub trajectories simultaneously
+struct ParallelComponent
+{
+	size_t component;
+	moveit::core::RobotState start;  // state before the component
+	std::vector<robot_trajectory::RobotTrajectoryConstPtr> trajectories;
+	// fallback if the merged trajectory is invalid: members as individual components, and their sub trajectories
+	std::vector<plan_execution::ExecutableTrajectory> sequential;
+	std::vector<size_t> subs;
+};
+
+// whether the groups share any active joints
+bool overlap(const moveit::core::JointModelGroup& a, const moveit::core::JointModelGroup& b) {
+	for (const moveit::core::JointModel* jm : a.getActiveJointModels())
+		if (b.hasJointModel(jm->getName()))
+			return true;
+	return false;
+}
+
+/* whether next can be executed simultaneously with the members of the current component:
+ * on disjoint joints, by other controllers, and not depending on a scene change by prev */
+bool canParallelize(const moveit_task_constructor_msgs::SubTrajectory& prev,
+                    const plan_execution::ExecutableTrajectory& current,
+                    const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& members,
+                    const moveit_task_constructor_msgs::SubTrajectory& next,
+                    const robot_trajectory::RobotTrajectory& next_traj) {
+	if (next_traj.empty() || !next_traj.getGroup() || hasSceneEffect(prev.scene_diff))
+		return false;
+	for (const std::string& controller : next.execution_info.controller_names)
+		if (std::find(current.controller_names_.begin(), current.controller_names_.end(), controller) !=
+		    current.controller_names_.end())
+			return false;
+	for (const auto& member : members)
+		if (member->empty() || !member->getGroup() || overlap(*member->getGroup(), *next_traj.getGroup()))
+			return false;
+	return true;
+}
+
+/* append the effect next to the coalesced effect into, returning false if this would change their meaning
+ *
+ * Diffs are applied in the order robot state, ACM, ..., world, while lists are processed sequentially.
+ * Thus, concatenating them is equivalent, unless attaching in next refers to world changes of into. */
+bool coalesce(moveit_msgs::PlanningScene& into, const moveit_msgs::PlanningScene& next) {
+	if (!into.world.collision_objects.empty() && !next.robot_state.attached_collision_objects.empty())
+		return false;
+
+	auto append = [](auto& list, const auto& more) { list.insert(list.end(), more.begin(), more.end()); };
+	append(into.robot_state.attached_collision_objects, next.robot_state.attached_collision_objects);
+	append(into.world.collision_objects, next.world.collision_objects);
+	append(into.object_colors, next.object_colors);
+	append(into.link_padding, next.link_padding);
+	append(into.link_scale, next.link_scale);
+	// these fields are replaced as a whole
+	if (!next.name.empty())
+		into.name = next.name;
+	if (!next.fixed_frame_transforms.empty())
+		into.fixed_frame_transforms = next.fixed_frame_transforms;
+	if (!next.allowed_collision_matrix.entry_names.empty())
+		into.allowed_collision_matrix = next.allowed_collision_matrix;
+	if (!next.world.octomap.octomap.data.empty())
+		into.world.octomap = next.world.octomap;
+	return true;
+}
 }  // namespace
 
 namespace move_group {
 
 ExecuteTaskSolutionCapability::ExecuteTaskSolutionCapability() : MoveGroupCapability("ExecuteTaskSolution") {}
 
+ExecuteTaskSolutionCapability::~ExecuteTaskSolutionCapability() {
+	{
+		std::lock_guard<std::mutex> lock(effects_mutex_);
+		stop_effects_ = true;
+	}
+	effects_cv_.notify_all();
+	if (effects_thread_.joinable())
+		effects_thread_.join();
+}
+
 void ExecuteTaskSolutionCapability::initialize() {
 	// configure the action server
 	as_.reset(new actionlib::SimpleActionServer<moveit_task_constructor_msgs::ExecuteTaskSolutionAction>(
@@ -89,6 +239,12 @@ void ExecuteTaskSolutionCapability::initialize() {
 	    std::bind(&ExecuteTaskSolutionCapability::execCallback, this, std::placeholders::_1), false));
 	as_->registerPreemptCallback(std::bind(&ExecuteTaskSolutionCapability::preemptCallback, this));
 	as_->start();
+
+	node_handle_.param("execute_task_solution/blend_sub_trajectories", blend_sub_trajectories_, false);
+	node_handle_.param("execute_task_solution/parallel_sub_trajectories", parallel_sub_trajectories_, false);
+	node_handle_.param("execute_task_solution/async_scene_effects", async_scene_effects_, false);
+	if (async_scene_effects_)
+		effects_thread_ = std::thread(&ExecuteTaskSolutionCapability::applySceneEffects, this);
 }
 
 void ExecuteTaskSolutionCapability::execCallback(
@@ -102,12 +258,66 @@ void ExecuteTaskSolutionCapability::execCallback(
 		return;
 	}
 
+	const moveit_task_constructor_msgs::Solution& solution = goal->solution;
+	moveit::core::RobotState state(context_->planning_scene_monitor_->getRobotModel());
+	{
+		planning_scene_monitor::LockedPlanningSceneRO scene(context_->planning_scene_monitor_);
+		state = scene->getCurrentState();
+	}
+	{
+		std::lock_guard<std::mutex> lock(progress_mutex_);
+		durations_.clear();
+	}
+
+	// convert the first component only, such that motion starts regardless of the solution's length,
+	// but validate all sub trajectories before, such that an invalid one doesn't abort the execution midway.
+	// Merging and retiming can only be validated by a full conversion.
 	plan_execution::ExecutableMotionPlan plan;
-	if (!constructMotionPlan(goal->solution, plan))
+	size_t next = 0;
+	const size_t max_components = blend_sub_trajectories_ || parallel_sub_trajectories_ ? 0 : 1;
+	if (!validateSolution(solution, state) || !constructMotionPlan(solution, state, next, max_components, plan))
 		result.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
 	else {
+		// convert the remaining sub trajectories while the first component is executed
+		plan_execution::ExecutableMotionPlan remainder;
+		std::future<bool> constructed;
+		if (next < solution.sub_trajectory.size())
+			constructed = std::async(std::launch::async, [this, &solution, &state, &next, &remainder] {
+				return constructMotionPlan(solution, state, next, 0, remainder);
+			});
+
 		ROS_INFO_NAMED("ExecuteTaskSolution", "Executing TaskSolution");
+		{
+			std::lock_guard<std::mutex> lock(progress_mutex_);
+			executing_ = true;
+			finished_ = 0;
+			segment_start_ = ros::WallTime::now();
+		}
+		std::thread progress(&ExecuteTaskSolutionCapability::publishProgress, this, solution.sub_trajectory.size());
 		result.error_code = context_->plan_execution_->executeAndMonitor(plan);
+		// the remainder is validated against the scene, and clients expect it to be updated after execution
+		if (!flushSceneEffects() && result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
+			result.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+		if (constructed.valid()) {
+			const bool valid = constructed.get();  // always wait: the construction references the goal
+			if (result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS) {
+				if (!valid)
+					result.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_MOTION_PLAN;
+				else if (as_->isPreemptRequested())
+					result.error_code.val = moveit_msgs::MoveItErrorCodes::PREEMPTED;
+				else {
+					result.error_code = context_->plan_execution_->executeAndMonitor(remainder);
+					if (!flushSceneEffects() && result.error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS)
+						result.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+				}
+			}
+		}
+		{
+			std::lock_guard<std::mutex> lock(progress_mutex_);
+			executing_ = false;
+		}
+		progress_cv_.notify_one();
+		progress.join();
 	}
 
 	const std::string response = moveit::core::MoveItErrorCode::toString(result.error_code);
@@ -124,34 +334,133 @@ void ExecuteTaskSolutionCapability::preemptCallback() {
 		context_->plan_execution_->stop();
 }
 
-bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constructor_msgs::Solution& solution,
-                                                        plan_execution::ExecutableMotionPlan& plan) {
-	moveit::core::RobotModelConstPtr model = context_->planning_scene_monitor_->getRobotModel();
+void ExecuteTaskSolutionCapability::publishProgress(size_t num_sub_trajectories) {
+	moveit_task_constructor_msgs::ExecuteTaskSolutionFeedback feedback;
+	feedback.sub_no = num_sub_trajectories;
 
-	moveit::core::RobotState state(model);
+	std::unique_lock<std::mutex> lock(progress_mutex_);
+	while (executing_) {
+		feedback.sub_id = finished_;
+		feedback.progress = 1.0;
+		auto it = durations_.find(finished_);  // the component starting after the finished sub trajectories
+		if (it != durations_.end() && it->second > 0.0) {
+			const double elapsed = (ros::WallTime::now() - segment_start_).toSec();
+			feedback.progress = std::min(1.0, elapsed / it->second);
+		}
+		as_->publishFeedback(feedback);
+		progress_cv_.wait_for(lock, std::chrono::duration<double>(FEEDBACK_PERIOD));
+	}
+}
+
+void ExecuteTaskSolutionCapability::finished(size_t index) {
 	{
-		planning_scene_monitor::LockedPlanningSceneRO scene(context_->planning_scene_monitor_);
-		state = scene->getCurrentState();
+		std::lock_guard<std::mutex> lock(progress_mutex_);
+		finished_ = index + 1;
+		segment_start_ = ros::WallTime::now();
+	}
+	progress_cv_.notify_one();
+}
+
+bool ExecuteTaskSolutionCapability::applySceneEffect(const moveit_msgs::PlanningScene& scene_diff) {
+	if (!async_scene_effects_)
+		return context_->planning_scene_monitor_->newPlanningSceneMessage(scene_diff);
+
+	{
+		std::lock_guard<std::mutex> lock(effects_mutex_);
+		pending_effects_.push_back(&scene_diff);
+	}
+	effects_cv_.notify_all();
+	return true;  // failures are reported by flushSceneEffects()
+}
+
+void ExecuteTaskSolutionCapability::applySceneEffects() {
+	std::unique_lock<std::mutex> lock(effects_mutex_);
+	while (true) {
+		effects_cv_.wait(lock, [this] { return stop_effects_ || !pending_effects_.empty(); });
+		if (pending_effects_.empty())
+			return;  // stopped
+
+		std::vector<const moveit_msgs::PlanningScene*> diffs;
+		diffs.swap(pending_effects_);
+		applying_effects_ = true;
+		lock.unlock();
+
+		// apply as few messages as possible, each one locking the scene and notifying its listeners
+		std::vector<moveit_msgs::PlanningScene> coalesced;
+		for (const moveit_msgs::PlanningScene* diff : diffs)
+			if (coalesced.empty() || !coalesce(coalesced.back(), *diff))
+				coalesced.push_back(*diff);
+		bool success = true;
+		for (const moveit_msgs::PlanningScene& diff : coalesced)
+			success &= context_->planning_scene_monitor_->newPlanningSceneMessage(diff);
+		if (!success)
+			ROS_ERROR_NAMED("ExecuteTaskSolution", "failed to apply scene effects");
+		else
+			ROS_DEBUG_NAMED("ExecuteTaskSolution", "applied %zu scene effects as %zu diffs", diffs.size(),
+			                coalesced.size());
+
+		lock.lock();
+		applying_effects_ = false;
+		effects_failed_ |= !success;
+		effects_cv_.notify_all();
 	}
+}
+
+bool ExecuteTaskSolutionCapability::flushSceneEffects() {
+	std::unique_lock<std::mutex> lock(effects_mutex_);
+	effects_cv_.wait(lock, [this] { return pending_effects_.empty() && !applying_effects_; });
+	const bool success = !effects_failed_;
+	effects_failed_ = false;
+	return success;
+}
 
-	plan.plan_components_.reserve(solution.sub_trajectory.size());
+bool ExecuteTaskSolutionCapability::validateSolution(const moveit_task_constructor_msgs::Solution& solution,
+                                                     moveit::core::RobotState state) {
+	const moveit::core::RobotModelConstPtr& model = state.getRobotModel();
 	for (size_t i = 0; i < solution.sub_trajectory.size(); ++i) {
 		const moveit_task_constructor_msgs::SubTrajectory& sub_traj = solution.sub_trajectory[i];
+		const std::vector<std::string> joint_names = jointNames(sub_traj);
+		if (!joint_names.empty() && !findJointModelGroup(model, joint_names)) {
+			ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution", fmt::format("Could not find JointModelGroup that actuates "
+			                                                          "{{{}}} in SubTrajectory {}/{}",
+			                                                          fmt::join(joint_names, ", "), i + 1,
+			                                                          solution.sub_trajectory.size()));
+			return false;
+		}
+		if (!moveit::core::isEmpty(sub_traj.scene_diff.robot_state) &&
+		    !moveit::core::robotStateMsgToRobotState(sub_traj.scene_diff.robot_state, state, true)) {
+			ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution",
+			                       "invalid intermediate robot state in scene diff of SubTrajectory "
+			                           << i + 1 << "/" << solution.sub_trajectory.size());
+			return false;
+		}
+	}
+	return true;
+}
 
-		plan.plan_components_.emplace_back();
-		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_.back();
+bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constructor_msgs::Solution& solution,
+                                                        moveit::core::RobotState& state, size_t& next,
+                                                        size_t max_components,
+                                                        plan_execution::ExecutableMotionPlan& plan) {
+	moveit::core::RobotModelConstPtr model = state.getRobotModel();
 
-		// define individual variable for use in closure below
-		const std::string description = std::to_string(i + 1) + "/" + std::to_string(solution.sub_trajectory.size());
-		exec_traj.description_ = description;
+	const size_t num_sub_trajectories = solution.sub_trajectory.size();
+	const size_t begin = next;
+	plan.plan_components_.reserve(num_sub_trajectories - begin);
+	std::vector<size_t> firsts;  // first sub trajectory of each component
+	std::vector<size_t> blended;  // components comprising several sub trajectories, to be retimed
+	std::vector<Scaling> blended_scaling;  // lowest scaling of the sub trajectories of each blended component
+	std::vector<ParallelComponent> parallel;  // components comprising several sub trajectories, to be merged
+	moveit::core::RobotState component_start(state);
+	size_t first = begin;  // first sub trajectory of the current component
+	for (size_t i = begin; i < num_sub_trajectories; next = ++i) {
+		const moveit_task_constructor_msgs::SubTrajectory& sub_traj = solution.sub_trajectory[i];
 
 		const moveit::core::JointModelGroup* group = nullptr;
 		{
-			std::vector<std::string> joint_names(sub_traj.trajectory.joint_trajectory.joint_names);
-			joint_names.insert(joint_names.end(), sub_traj.trajectory.multi_dof_joint_trajectory.joint_names.begin(),
-			                   sub_traj.trajectory.multi_dof_joint_trajectory.joint_names.end());
+			const std::vector<std::string> joint_names = jointNames(sub_traj);
 			if (!joint_names.empty()) {
-				group = findJointModelGroup(*model, joint_names);
+				group = findJointModelGroup(model, joint_names);
 				if (!group) {
 					ROS_ERROR_STREAM_NAMED(
 					    "ExecuteTaskSolution",
@@ -162,23 +471,96 @@ bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constr
 				                group->getName().c_str());
 			}
 		}
-		exec_traj.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(model, group);
-		exec_traj.trajectory_->setRobotTrajectoryMsg(state, sub_traj.trajectory);
-		exec_traj.controller_names_ = sub_traj.execution_info.controller_names;
+		auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(model, group);
+		trajectory->setRobotTrajectoryMsg(state, sub_traj.trajectory);
+
+		plan_execution::ExecutableTrajectory* current = i > begin ? &plan.plan_components_.back() : nullptr;
+		const size_t current_index = plan.plan_components_.size() - 1;
+		const bool current_blended = !blended.empty() && blended.back() == current_index;
+		const bool current_parallel = !parallel.empty() && parallel.back().component == current_index;
+		std::vector<robot_trajectory::RobotTrajectoryConstPtr> members;  // trajectories of the current component
+		bool parallelized = false;  // sub trajectory i joined the current (parallel) component
+		if (current_parallel)
+			members = parallel.back().trajectories;
+		else if (current)
+			members.push_back(current->trajectory_);
 
-		/* TODO add action feedback and markers */
+		if (blend_sub_trajectories_ && current && !current_parallel &&
+		    canBlend(solution.sub_trajectory[i - 1], *current->trajectory_, sub_traj, *trajectory)) {
+			// retiming keeps the slowest scaling of all blended sub trajectories
+			if (!current_blended) {
+				blended.push_back(current_index);
+				blended_scaling.push_back(estimateScaling(*current->trajectory_));
+			}
+			const Scaling scaling = estimateScaling(*trajectory);
+			blended_scaling.back().velocity = std::min(blended_scaling.back().velocity, scaling.velocity);
+			blended_scaling.back().acceleration = std::min(blended_scaling.back().acceleration, scaling.acceleration);
+
+			// continue the current component, skipping the first waypoint, which duplicates the previous end
+			for (size_t k = 1; k < trajectory->getWayPointCount(); ++k)
+				current->trajectory_->addSuffixWayPoint(trajectory->getWayPoint(k),
+				                                        trajectory->getWayPointDurationFromPrevious(k));
+		} else if (parallel_sub_trajectories_ && current && !current_blended &&
+		           canParallelize(solution.sub_trajectory[i - 1], *current, members, sub_traj, *trajectory)) {
+			// execute along with the current component, dispatching to all controllers at once
+			if (!current_parallel) {
+				parallel.push_back(ParallelComponent{ current_index, component_start, members });
+				parallel.back().sequential.push_back(*current);
+				parallel.back().subs.push_back(i - 1);
+			}
+			parallel.back().trajectories.push_back(trajectory);
+			parallel.back().sequential.emplace_back();
+			parallel.back().sequential.back().trajectory_ = trajectory;
+			parallel.back().sequential.back().controller_names_ = sub_traj.execution_info.controller_names;
+			parallel.back().subs.push_back(i);
+			parallelized = true;
+			current->controller_names_.insert(current->controller_names_.end(),
+			                                  sub_traj.execution_info.controller_names.begin(),
+			                                  sub_traj.execution_info.controller_names.end());
+		} else {
+			if (max_components && plan.plan_components_.size() == max_components)
+				break;  // leave sub trajectory i to the next call
+			first = i;
+			firsts.push_back(i);
+			if (parallel_sub_trajectories_)
+				component_start = state;
+			plan.plan_components_.emplace_back();
+			plan.plan_components_.back().trajectory_ = trajectory;
+			plan.plan_components_.back().controller_names_ = sub_traj.execution_info.controller_names;
+		}
+		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_.back();
+
+		// define individual variable for use in closure below
+		const std::string description =
+		    (first == i ? std::to_string(i + 1) : fmt::format("{}-{}", first + 1, i + 1)) + "/" +
+		    std::to_string(num_sub_trajectories);
+		exec_traj.description_ = description;
+
+		/* TODO add markers */
+		// a following motion might depend on queued effects, e.g. an attached object: apply them before it starts
+		const bool next_moves = i + 1 < num_sub_trajectories && hasMotion(solution.sub_trajectory[i + 1]);
 		exec_traj.effect_on_success_ = [this,
 		                                &scene_diff = const_cast<::moveit_msgs::PlanningScene&>(sub_traj.scene_diff),
-		                                description](const plan_execution::ExecutableMotionPlan* /*plan*/) {
+		                                description, i,
+		                                next_moves](const plan_execution::ExecutableMotionPlan* /*plan*/) {
+			finished(i);
 			scene_diff.robot_state.joint_state = sensor_msgs::JointState();
 			scene_diff.robot_state.multi_dof_joint_state = sensor_msgs::MultiDOFJointState();
 
+			bool success = true;
 			if (!moveit::core::isEmpty(scene_diff)) {
 				ROS_DEBUG_STREAM_NAMED("ExecuteTaskSolution", "apply effect of " << description);
-				return context_->planning_scene_monitor_->newPlanningSceneMessage(scene_diff);
+				success = applySceneEffect(scene_diff);
 			}
-			return true;
+			if (success && next_moves && async_scene_effects_)
+				success = flushSceneEffects();
+			return success;
 		};
+		if (parallelized) {
+			plan_execution::ExecutableTrajectory& member = parallel.back().sequential.back();
+			member.description_ = std::to_string(i + 1) + "/" + std::to_string(num_sub_trajectories);
+			member.effect_on_success_ = exec_traj.effect_on_success_;
+		}
 
 		if (!moveit::core::isEmpty(sub_traj.scene_diff.robot_state) &&
 		    !moveit::core::robotStateMsgToRobotState(sub_traj.scene_diff.robot_state, state, true)) {
@@ -188,9 +570,97 @@ bool ExecuteTaskSolutionCapability::constructMotionPlan(const moveit_task_constr
 		}
 	}
 
+	// parallel components execute a single trajectory, merged from the trajectories of their members
+	// (in reverse order, such that splitting a component doesn't shift the remaining parallel ones)
+	for (auto p = parallel.rbegin(); p != parallel.rend(); ++p) {
+		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_[p->component];
+		robot_trajectory::RobotTrajectoryPtr merged;
+		try {
+			moveit::core::JointModelGroup* group = mergedJointModelGroup(p->trajectories);
+			merged = moveit::task_constructor::merge(p->trajectories, p->start, group, time_parameterization_);
+		} catch (const std::runtime_error& e) {
+			ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution",
+			                       "failed to merge sub trajectories " << exec_traj.description_ << ": " << e.what());
+			return false;
+		}
+
+		// members were validated individually, but their groups might collide when moving simultaneously
+		bool valid;
+		{
+			planning_scene_monitor::LockedPlanningSceneRO scene(context_->planning_scene_monitor_);
+			valid = scene->isPathValid(*merged);
+		}
+		if (valid) {
+			exec_traj.trajectory_ = merged;
+			continue;
+		}
+		ROS_WARN_STREAM_NAMED("ExecuteTaskSolution", "simultaneous sub trajectories "
+		                                                 << exec_traj.description_
+		                                                 << " are in collision: executing them sequentially");
+		const size_t component = p->component;
+		const size_t added = p->sequential.size() - 1;
+		plan.plan_components_.erase(plan.plan_components_.begin() + component);
+		plan.plan_components_.insert(plan.plan_components_.begin() + component, p->sequential.begin(),
+		                             p->sequential.end());
+		firsts.insert(firsts.begin() + component + 1, p->subs.begin() + 1, p->subs.end());
+		for (size_t& b : blended)
+			if (b > component)
+				b += added;
+	}
+
+	// blended components are executed continuously: retime them as a whole, without stops at the junctions
+	for (size_t b = 0; b < blended.size(); ++b) {
+		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_[blended[b]];
+		const Scaling& scaling = blended_scaling[b];
+		if (!time_parameterization_.computeTimeStamps(*exec_traj.trajectory_, scaling.velocity, scaling.acceleration)) {
+			ROS_ERROR_STREAM_NAMED("ExecuteTaskSolution", "failed to retime blended sub trajectories "
+			                                                  << exec_traj.description_);
+			return false;
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(progress_mutex_);
+	for (size_t component = 0; component < firsts.size(); ++component) {
+		const auto& trajectory = plan.plan_components_[component].trajectory_;
+		durations_[firsts[component]] = trajectory ? trajectory->getDuration() : 0.0;
+	}
 	return true;
 }
 
+const moveit::core::JointModelGroup*
+ExecuteTaskSolutionCapability::findJointModelGroup(const moveit::core::RobotModelConstPtr& model,
+                                                   const std::vector<std::string>& joints) {
+	if (model != jmg_cache_model_) {
+		jmg_cache_.clear();
+		merged_jmg_cache_.clear();
+		jmg_cache_model_ = model;
+	}
+
+	std::vector<std::string> key(joints);
+	std::sort(key.begin(), key.end());
+	key.erase(std::unique(key.begin(), key.end()), key.end());
+	auto it = jmg_cache_.find(key);
+	if (it == jmg_cache_.end()) {
+		const moveit::core::JointModelGroup* jmg = ::findJointModelGroup(*model, key);
+		it = jmg_cache_.emplace(std::move(key), jmg).first;
+	}
+	return it->second;
+}
+
+moveit::core::JointModelGroup* ExecuteTaskSolutionCapability::mergedJointModelGroup(
+    const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& trajectories) {
+	std::vector<const moveit::core::JointModelGroup*> groups;
+	std::vector<std::string> key;
+	for (const auto& trajectory : trajectories) {
+		groups.push_back(trajectory->getGroup());
+		key.push_back(trajectory->getGroup()->getName());
+	}
+	std::unique_ptr<moveit::core::JointModelGroup>& jmg = merged_jmg_cache_[key];
+	if (!jmg)
+		jmg.reset(moveit::task_constructor::merge(groups));
+	return jmg.get();
+}
+
 }  // namespace move_group
 
 #include <pluginlib/class_list_macros.hpp>
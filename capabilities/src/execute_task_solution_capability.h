@@ -43,10 +43,17 @@
 
 #include <moveit/move_group/move_group_capability.h>
 #include <actionlib/server/simple_action_server.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 
 #include <moveit_task_constructor_msgs/ExecuteTaskSolutionAction.h>
 
+#include <condition_variable>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace move_group {
 
@@ -54,17 +61,83 @@ class ExecuteTaskSolutionCapability : public MoveGroupCapability
 {
 public:
 	ExecuteTaskSolutionCapability();
+	~ExecuteTaskSolutionCapability() override;
 
 	void initialize() override;
 
 private:
-	bool constructMotionPlan(const moveit_task_constructor_msgs::Solution& solution,
-	                         plan_execution::ExecutableMotionPlan& plan);
+	/** check that all sub trajectories of solution can be converted, starting from the robot state state
+	 *
+	 * This only comprises the cheap conversions, i.e. the groups of the trajectories and the intermediate robot
+	 * states, such that the trajectories themselves can be converted while the solution is already executed.
+	 * Merging or retiming sub trajectories (if enabled) requires a full conversion before execution. */
+	bool validateSolution(const moveit_task_constructor_msgs::Solution& solution, moveit::core::RobotState state);
+	/** convert sub trajectories of solution, starting from next, into (at most max_components) plan components
+	 *
+	 * state is the robot state before sub trajectory next. On return, next refers to the first unconverted
+	 * sub trajectory, always beginning a new component, and state is advanced accordingly. */
+	bool constructMotionPlan(const moveit_task_constructor_msgs::Solution& solution, moveit::core::RobotState& state,
+	                         size_t& next, size_t max_components, plan_execution::ExecutableMotionPlan& plan);
+
+	/// memoized lookup of the JointModelGroup actuating the given joints
+	const moveit::core::JointModelGroup* findJointModelGroup(const moveit::core::RobotModelConstPtr& model,
+	                                                         const std::vector<std::string>& joints);
+	/// memoized group comprising the groups of all trajectories, valid for jmg_cache_model_
+	moveit::core::JointModelGroup*
+	mergedJointModelGroup(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& trajectories);
 
 	void execCallback(const moveit_task_constructor_msgs::ExecuteTaskSolutionGoalConstPtr& goal);
 	void preemptCallback();
 
+	/// periodically publish the progress of the execution as action feedback, until executing_ is reset
+	void publishProgress(size_t num_sub_trajectories);
+	/// mark sub trajectories up to index as finished, publishing feedback immediately
+	void finished(size_t index);
+
+	/// apply the scene effect of a sub trajectory, only queueing it for the effects thread if async_scene_effects_
+	bool applySceneEffect(const moveit_msgs::PlanningScene& scene_diff);
+	/// effects thread: apply queued scene effects, coalescing all diffs queued in the meantime
+	void applySceneEffects();
+	/// wait until all queued scene effects were applied, returns false if any of them failed
+	bool flushSceneEffects();
+
 	std::unique_ptr<actionlib::SimpleActionServer<moveit_task_constructor_msgs::ExecuteTaskSolutionAction>> as_;
+
+	/* execute consecutive sub trajectories of the same group and controllers, which don't change the scene,
+	 * as a single, retimed trajectory, such that the robot doesn't stop at their junctions
+	 * (parameter ~execute_task_solution/blend_sub_trajectories) */
+	bool blend_sub_trajectories_ = false;
+	/* execute consecutive sub trajectories, which actuate disjoint joints via distinct controllers and don't
+	 * depend on a scene change of their predecessor, simultaneously as a single, merged trajectory
+	 * (parameter ~execute_task_solution/parallel_sub_trajectories) */
+	bool parallel_sub_trajectories_ = false;
+	trajectory_processing::TimeOptimalTrajectoryGeneration time_parameterization_;
+
+	// groups found for sorted joint names, valid for jmg_cache_model_ (only accessed by one constructMotionPlan())
+	moveit::core::RobotModelConstPtr jmg_cache_model_;
+	std::map<std::vector<std::string>, const moveit::core::JointModelGroup*> jmg_cache_;
+	// merged groups for group names, referenced by the trajectories of the current plan
+	std::map<std::vector<std::string>, std::unique_ptr<moveit::core::JointModelGroup>> merged_jmg_cache_;
+
+	// progress of the current execution, updated by the effects of its sub trajectories
+	std::mutex progress_mutex_;
+	std::condition_variable progress_cv_;
+	bool executing_ = false;
+	uint32_t finished_ = 0;
+	std::map<size_t, double> durations_;  // duration of components, indexed by their first sub trajectory
+	ros::WallTime segment_start_;  // (estimated) start time of the current sub trajectory
+
+	/* apply scene effects of sub trajectories in a background thread, such that consecutive sub trajectories
+	 * without motion don't wait for the planning scene monitor (parameter ~execute_task_solution/async_scene_effects).
+	 * Queued effects are applied before the next motion starts, as it is validated against the scene. */
+	bool async_scene_effects_ = false;
+	std::thread effects_thread_;
+	std::mutex effects_mutex_;
+	std::condition_variable effects_cv_;
+	std::vector<const moveit_msgs::PlanningScene*> pending_effects_;  // referencing the goal of the execution
+	bool applying_effects_ = false;
+	bool effects_failed_ = false;
+	bool stop_effects_ = false;
 };
 
 }  // namespace move_group
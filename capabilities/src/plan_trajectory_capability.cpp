@@ -0,0 +1,73 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "plan_trajectory_capability.h"
+
+#include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
+
+namespace move_group {
+
+PlanTrajectoryCapability::PlanTrajectoryCapability() : MoveGroupCapability("PlanTrajectory") {}
+
+void PlanTrajectoryCapability::initialize() {
+	service_ = root_node_handle_.advertiseService("plan_trajectory", &PlanTrajectoryCapability::planCallback, this);
+}
+
+bool PlanTrajectoryCapability::planCallback(moveit_task_constructor_msgs::PlanTrajectory::Request& req,
+                                            moveit_task_constructor_msgs::PlanTrajectory::Response& res) {
+	const planning_pipeline::PlanningPipelinePtr pipeline = resolvePlanningPipeline(req.request.pipeline_id);
+	if (!pipeline) {
+		res.response.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+		return true;
+	}
+
+	// plan in the requested scene instead of the monitored one
+	auto scene = std::make_shared<planning_scene::PlanningScene>(context_->planning_scene_monitor_->getRobotModel());
+	if (!scene->setPlanningSceneMsg(req.scene)) {
+		res.response.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_ROBOT_STATE;
+		return true;
+	}
+
+	planning_interface::MotionPlanResponse mp_res;
+	pipeline->generatePlan(scene, req.request, mp_res);
+	mp_res.getMessage(res.response);
+	return true;
+}
+
+}  // namespace move_group
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS(move_group::PlanTrajectoryCapability, move_group::MoveGroupCapability)
@@ -0,0 +1,142 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Memory arena for objects sharing the lifetime of a planning run
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Memory pool for many small objects sharing the lifetime of a planning run.
+ *
+ * Memory is taken from large blocks and recycled via free lists per allocation size.
+ * Blocks are only released when the arena is destroyed. As ArenaAllocators share ownership of their arena,
+ * this happens when the last object allocated from the arena was released.
+ * Allocation and deallocation are thread-safe.
+ */
+class Arena
+{
+public:
+	static constexpr size_t ALIGNMENT = alignof(std::max_align_t);
+
+	explicit Arena(size_t block_size = 64 * 1024);
+	~Arena();
+
+	Arena(const Arena&) = delete;
+	Arena& operator=(const Arena&) = delete;
+
+	void* allocate(size_t bytes);
+	void deallocate(void* p, size_t bytes) noexcept;
+
+	/// total size of all blocks reserved so far
+	size_t capacity() const;
+
+private:
+	struct FreeNode
+	{
+		FreeNode* next;
+	};
+	static size_t roundUp(size_t bytes) { return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+	const size_t block_size_;
+	mutable std::mutex mutex_;
+	std::vector<char*> blocks_;
+	char* current_ = nullptr;  // free space in last block
+	size_t remaining_ = 0;
+	std::unordered_map<size_t, FreeNode*> free_lists_;  // recycled memory, indexed by (rounded) size
+};
+using ArenaPtr = std::shared_ptr<Arena>;
+
+/** STL-compatible allocator drawing memory from an Arena.
+ *
+ * A default-constructed allocator (without arena) falls back to the global operator new.
+ */
+template <typename T>
+class ArenaAllocator
+{
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	ArenaAllocator() noexcept = default;
+	explicit ArenaAllocator(ArenaPtr arena) noexcept : arena_(std::move(arena)) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena()) {}
+
+	T* allocate(size_t n) {
+		if (!usesArena())
+			return static_cast<T*>(::operator new(n * sizeof(T)));
+		return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+	}
+	void deallocate(T* p, size_t n) noexcept {
+		if (!usesArena())
+			::operator delete(p);
+		else
+			arena_->deallocate(p, n * sizeof(T));
+	}
+
+	const ArenaPtr& arena() const noexcept { return arena_; }
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& other) const noexcept {
+		return arena_ == other.arena();
+	}
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+		return arena_ != other.arena();
+	}
+
+private:
+	// over-aligned types cannot be served by the arena
+	bool usesArena() const noexcept { return arena_ && alignof(T) <= Arena::ALIGNMENT; }
+
+	ArenaPtr arena_;
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
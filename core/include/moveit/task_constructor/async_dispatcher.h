@@ -0,0 +1,190 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Asynchronous delivery of items to a consumer thread via a bounded queue
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Delivers items pushed by a producer in batches to a callback, running on a dedicated thread
+ *
+ * This decouples slow consumers, e.g. logging solutions to a database, from the producer.
+ * The queue is bounded: If it is full, push() either blocks until the consumer caught up (BLOCK)
+ * or drops the new item (DROP). Items are delivered in order, in batches of up to max_batch items.
+ * An exception thrown by the callback stops delivery and is rethrown by the next flush().
+ *
+ * Thread safety: push(), flush(), and dropped() are synchronized and may be called from any thread.
+ * The callback runs on the consumer thread only, one batch at a time, and thus concurrently to the producers.
+ * It must not call push() or flush() itself, which might wait for the callback to return.
+ * The destructor must not be called concurrently to other methods or from within the callback.
+ */
+template <typename T>
+class AsyncDispatcher
+{
+public:
+	enum Backpressure
+	{
+		BLOCK,  // wait for free space in the queue
+		DROP,  // discard items not fitting into the queue
+	};
+	using BatchCallback = std::function<void(const std::vector<T>& batch)>;
+
+	AsyncDispatcher(BatchCallback callback, size_t capacity = 1024, size_t max_batch = 64,
+	                Backpressure policy = BLOCK)
+	  : callback_(std::move(callback))
+	  , capacity_(std::max<size_t>(capacity, 1))
+	  , max_batch_(std::max<size_t>(max_batch, 1))
+	  , policy_(policy)
+	  , consumer_([this] { consume(); }) {}
+
+	/// deliver all pending items before stopping the consumer thread
+	~AsyncDispatcher() {
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			stop_ = true;
+		}
+		pushed_.notify_all();
+		consumer_.join();
+	}
+
+	AsyncDispatcher(const AsyncDispatcher&) = delete;
+	AsyncDispatcher& operator=(const AsyncDispatcher&) = delete;
+
+	/// enqueue an item for delivery, returns false if it was dropped
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (error_)
+			return false;  // delivery stopped
+		if (queue_.size() >= capacity_) {
+			if (policy_ == DROP) {
+				++dropped_;
+				return false;
+			}
+			popped_.wait(lock, [this] { return queue_.size() < capacity_ || error_; });
+			if (error_)
+				return false;
+		}
+		queue_.push_back(std::move(item));
+		lock.unlock();
+		pushed_.notify_one();
+		return true;
+	}
+
+	/// wait until all queued items are delivered, rethrowing an exception thrown by the callback
+	void flush() {
+		std::unique_lock<std::mutex> lock(mutex_);
+		popped_.wait(lock, [this] { return (queue_.empty() && !delivering_) || error_; });
+		if (error_) {
+			std::exception_ptr error;
+			std::swap(error, error_);
+			queue_.clear();
+			std::rethrow_exception(error);
+		}
+	}
+
+	/// number of items dropped due to a full queue so far
+	size_t dropped() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return dropped_;
+	}
+
+private:
+	void consume() {
+		std::vector<T> batch;
+		std::unique_lock<std::mutex> lock(mutex_);
+		while (true) {
+			pushed_.wait(lock, [this] { return !queue_.empty() || stop_; });
+			if (queue_.empty())
+				return;  // stopped and nothing left to deliver
+			const size_t n = std::min(queue_.size(), max_batch_);
+			batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + n));
+			queue_.erase(queue_.begin(), queue_.begin() + n);
+			delivering_ = true;
+			lock.unlock();
+			popped_.notify_all();  // producers may continue while we deliver
+
+			std::exception_ptr error;
+			try {
+				callback_(batch);
+			} catch (...) {
+				error = std::current_exception();
+			}
+			batch.clear();
+
+			lock.lock();
+			delivering_ = false;
+			if (error && !error_)
+				error_ = error;
+			if (error_)
+				queue_.clear();
+			popped_.notify_all();
+		}
+	}
+
+	BatchCallback callback_;
+	const size_t capacity_;
+	const size_t max_batch_;
+	const Backpressure policy_;
+
+	mutable std::mutex mutex_;
+	std::condition_variable pushed_;  // signals new items (or stop_) to the consumer
+	std::condition_variable popped_;  // signals free space or finished delivery to producers
+	std::deque<T> queue_;
+	bool delivering_ = false;
+	bool stop_ = false;
+	size_t dropped_ = 0;
+	std::exception_ptr error_;
+
+	std::thread consumer_;  // started last, after all other members are initialized
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
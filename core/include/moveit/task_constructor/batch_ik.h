@@ -0,0 +1,104 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Pluggable backend solving the IK of many targets at once
+ */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Geometry>
+
+#include <functional>
+#include <vector>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotState);
+MOVEIT_CLASS_FORWARD(JointModelGroup);
+MOVEIT_CLASS_FORWARD(LinkModel);
+}  // namespace core
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+MOVEIT_CLASS_FORWARD(BatchIKSolver);
+
+/** Backend solving inverse kinematics for a batch of targets in a single call
+ *
+ * ComputeIK submits the targets of all upstream solutions processed in one compute() at once (see batch_size).
+ * This allows for vectorized or GPU-based solvers, amortizing their setup and transfer costs over many targets.
+ * The solver only provides candidate joint positions: ComputeIK validates them (bounds, constraints, collisions)
+ * and spawns solutions and failures per target, like for any other IK solver. Solvers should prefer candidates
+ * accepted by the validity callback of their query. Unless the solver provides allBranches(), ComputeIK continues
+ * with its regular seeded search for targets lacking enough valid candidates.
+ * The default implementation solves the queries one by one with RobotState::setFromIK().
+ * Implementations need to be thread-safe, as they may be shared by several stages.
+ */
+class BatchIKSolver
+{
+public:
+	/// signature of moveit::core::GroupStateValidityCallbackFn
+	using Validity = std::function<bool(moveit::core::RobotState* state, const moveit::core::JointModelGroup* jmg,
+	                                    const double* joint_positions)>;
+	struct Query
+	{
+		const moveit::core::JointModelGroup* jmg;
+		const moveit::core::LinkModel* link;  // link to be placed at target_pose
+		Eigen::Isometry3d target_pose;  // w.r.t. the model frame
+		const moveit::core::RobotState* seed;  // seed state, also defining the positions of all other joints
+		size_t max_solutions;  // number of distinct solutions requested
+		Validity is_valid;  // whether a candidate is valid (not thread-safe: call sequentially for all queries)
+	};
+	/// joint group positions of candidate solutions per query, may be empty if no solution was found
+	using Solutions = std::vector<std::vector<std::vector<double>>>;
+
+	virtual ~BatchIKSolver() = default;
+
+	/** solve all queries, spending at most timeout seconds per query
+	 *
+	 * solutions is resized to the number of queries, solutions[i] holding the candidates of queries[i].
+	 */
+	virtual void solve(const std::vector<Query>& queries, double timeout, Solutions& solutions) const;
+
+	/// whether the candidates comprise all solution branches (e.g. of analytic solvers), rendering seeding pointless
+	virtual bool allBranches() const { return false; }
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,174 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Cooperative cancellation of long-running computations
+ */
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Shared flag to request cancellation of running computations
+ *
+ * Copies of a token share their state: cancelling one of them cancels all.
+ * Long-running computations poll cancelled() or register a callback to interrupt blocking calls.
+ * Task::plan() activates its token for the planning thread, cancels it on preempt() or timeout,
+ * and containers propagate it to their worker threads. Solvers and stages access it via current().
+ */
+class CancellationToken
+{
+	struct State;
+
+public:
+	using Callback = std::function<void()>;
+
+	/** RAII registration of a callback, called once when the token (or one of its parents) is cancelled
+	 *
+	 * If the token is already cancelled, the callback is called immediately.
+	 * The destructor waits for a running callback to finish. Thus, callbacks must not destroy their registration.
+	 */
+	class Registration
+	{
+	public:
+		Registration(const CancellationToken& token, Callback&& callback);
+		~Registration();
+		Registration(const Registration&) = delete;
+		Registration& operator=(const Registration&) = delete;
+
+	private:
+		std::vector<std::pair<std::shared_ptr<State>, std::list<Callback>::iterator>> entries_;
+	};
+
+	/// RAII helper to activate a token in the current thread
+	class Activation
+	{
+	public:
+		explicit Activation(CancellationToken token);
+		~Activation();
+
+	private:
+		std::shared_ptr<State> previous_;
+	};
+
+	/// create a new token, which is not cancelled
+	CancellationToken();
+
+	/// token active in the calling thread, never cancelled if none was activated
+	static CancellationToken& current();
+
+	/// a new token, which is cancelled together with this one, but can also be cancelled individually
+	CancellationToken child() const;
+
+	/// request cancellation and call all registered callbacks
+	void cancel();
+	/// clear the cancellation request of this token (but not of its parents)
+	void reset();
+	bool cancelled() const;
+
+private:
+	explicit CancellationToken(std::shared_ptr<State> state) : state_(std::move(state)) {}
+
+	std::shared_ptr<State> state_;
+};
+
+/// Cancel a token after a timeout, unless the timer is destroyed before
+class CancellationTimer
+{
+public:
+	/// timer with a non-finite or excessive timeout (more than a year) don't do anything
+	CancellationTimer(const CancellationToken& token, double timeout);
+	~CancellationTimer();
+	CancellationTimer(const CancellationTimer&) = delete;
+	CancellationTimer& operator=(const CancellationTimer&) = delete;
+
+private:
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool stop_ = false;
+	std::thread thread_;
+};
+
+/** Deadline for the compute() call running in the current thread
+ *
+ * Task::plan() limits each compute() to the task's time slice (see Task::setTimeSlice()) and to its timeout.
+ * Long-running stages poll expired() to suspend their work, keeping a continuation to resume it in the next
+ * compute() call, which gives the scheduler the chance to interleave other stages in between.
+ * Containers propagate the deadline to their worker threads.
+ */
+class TimeSlice
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	/// RAII helper to limit the deadline of the current thread, which never extends an already active one
+	class Activation
+	{
+	public:
+		explicit Activation(Clock::time_point deadline);
+		/// limit the deadline to duration seconds from now, a non-finite duration doesn't limit it
+		explicit Activation(double duration);
+		~Activation();
+		Activation(const Activation&) = delete;
+		Activation& operator=(const Activation&) = delete;
+
+	private:
+		Clock::time_point previous_;
+	};
+
+	/// deadline of the current thread, Clock::time_point::max() if unlimited
+	static Clock::time_point deadline();
+	/// whether the deadline of the current thread has passed
+	static bool expired();
+	/// seconds until the deadline of the current thread (not below zero), infinity if unlimited
+	static double remaining();
+
+private:
+	static Clock::time_point& current();
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Process-wide registry of persistent ROS clients
+ */
+
+#pragma once
+
+#include <actionlib/client/simple_action_client.h>
+#include <ros/node_handle.h>
+#include <ros/service_client.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Clients shared by all tasks of the process
+ *
+ * Creating a client, waiting for its server, and connecting to it take considerable time.
+ * Instead of paying this for each call, clients are created once per name and type and kept connected.
+ * Service clients are persistent and are reconnected if their connection broke, e.g. after a server restart.
+ */
+class ClientRegistry
+{
+public:
+	/// the registry lives until the process exits, outliving ros::shutdown()
+	static ClientRegistry& instance();
+
+	/// shared action client for the given action name
+	template <typename Action>
+	std::shared_ptr<actionlib::SimpleActionClient<Action>> actionClient(const std::string& name) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		std::shared_ptr<void>& client = action_clients_[{ typeid(Action), name }];
+		if (!client)
+			client = std::make_shared<actionlib::SimpleActionClient<Action>>(name);
+		return std::static_pointer_cast<actionlib::SimpleActionClient<Action>>(client);
+	}
+
+	/// persistent service client for the given service name
+	template <typename Service>
+	ros::ServiceClient serviceClient(const std::string& name) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		ros::ServiceClient& client = service_clients_[{ typeid(Service), name }];
+		if (!client.isValid())  // not yet created or connection broken
+			client = ros::NodeHandle().serviceClient<Service>(name, true);
+		return client;
+	}
+
+	/// drop all clients, e.g. before shutting down ROS
+	void clear();
+
+private:
+	ClientRegistry() = default;
+
+	using Key = std::pair<std::type_index, std::string>;
+	std::mutex mutex_;
+	std::map<Key, std::shared_ptr<void>> action_clients_;
+	std::map<Key, ros::ServiceClient> service_clients_;
+};
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Pluggable backend for batched collision queries
+ */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace planning_scene {
+MOVEIT_CLASS_FORWARD(PlanningScene);
+}
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotState);
+}
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+MOVEIT_CLASS_FORWARD(CollisionChecker);
+
+/** Backend answering many collision queries against the same planning scene at once
+ *
+ * Stages and solvers validating many states, e.g. the waypoints of a trajectory, submit them in a single call.
+ * This allows for implementations that process the states in parallel, e.g. on a GPU or using SIMD
+ * sphere approximations of the robot. The default implementation checks the states one by one with
+ * PlanningScene::isStateColliding(). A custom backend is installed globally with setCollisionChecker().
+ *
+ * All states must belong to the robot model of the scene and have up-to-date link transforms.
+ * Implementations need to be thread-safe, as stages may query them concurrently.
+ */
+class CollisionChecker
+{
+public:
+	virtual ~CollisionChecker() = default;
+
+	/** check states for collisions within scene, considering the links of group only (all links if empty)
+	 *
+	 * colliding is resized to the number of states, colliding[i] indicating the result for states[i].
+	 */
+	virtual void checkStates(const planning_scene::PlanningScene& scene, const std::string& group,
+	                         const std::vector<const moveit::core::RobotState*>& states,
+	                         std::vector<bool>& colliding) const;
+
+	/** index of the first colliding state, states.size() if all states are collision-free
+	 *
+	 * Implementations may stop processing once a collision is found. The default one checks in order.
+	 */
+	virtual size_t firstCollision(const planning_scene::PlanningScene& scene, const std::string& group,
+	                              const std::vector<const moveit::core::RobotState*>& states) const;
+};
+
+/// collision checker used by all stages and solvers
+CollisionCheckerPtr collisionChecker();
+/// install a custom collision checker backend, nullptr restores the default one
+void setCollisionChecker(CollisionCheckerPtr checker);
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
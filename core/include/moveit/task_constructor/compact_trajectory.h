@@ -0,0 +1,107 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Memory-efficient storage of robot trajectories
+ */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+
+#include <memory>
+#include <vector>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotState);
+MOVEIT_CLASS_FORWARD(JointModelGroup);
+}  // namespace core
+}  // namespace moveit
+namespace robot_trajectory {
+MOVEIT_CLASS_FORWARD(RobotTrajectory);
+}
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+MOVEIT_CLASS_FORWARD(CompactTrajectory);
+
+/** Compact copy of a RobotTrajectory, storing only the variables of its group
+ *
+ * Per waypoint, only the positions of the group's variables (and their velocities, accelerations, and efforts,
+ * if defined by any waypoint) are stored as rows of contiguous matrices, together with the waypoint durations.
+ * All other variables and the attached bodies are taken from a single reference state, the first waypoint.
+ * In contrast to full RobotStates, link transforms are not stored, but recomputed by expand().
+ */
+class CompactTrajectory
+{
+public:
+	/// compact the trajectory, nullptr if it's empty or variables outside its group change along the trajectory
+	static CompactTrajectoryConstPtr create(const robot_trajectory::RobotTrajectory& trajectory);
+
+	/// rebuild the full trajectory, including the link transforms of all waypoints
+	robot_trajectory::RobotTrajectoryPtr expand() const;
+
+	size_t waypointCount() const { return durations_.size(); }
+	const moveit::core::JointModelGroup* group() const { return group_; }
+	/// first waypoint, providing the values of all variables not stored per waypoint
+	const moveit::core::RobotState& reference() const { return *reference_; }
+	/// indices of the stored variables in the robot model
+	const std::vector<int>& variables() const { return variables_; }
+	/// durations of the waypoints from their predecessors
+	const std::vector<double>& durations() const { return durations_; }
+	/// positions of the stored variables, waypoints x variables, row-major
+	const std::vector<double>& positions() const { return positions_; }
+	/// velocities of the stored variables, empty if not defined by any waypoint
+	const std::vector<double>& velocities() const { return velocities_; }
+	/// approximate memory used by the waypoint data (bytes)
+	size_t memoryUsage() const;
+
+private:
+	CompactTrajectory() = default;
+
+	const moveit::core::JointModelGroup* group_ = nullptr;
+	moveit::core::RobotStateConstPtr reference_;
+	std::vector<int> variables_;
+	std::vector<double> durations_;
+	// waypoints x variables, row-major, empty if not defined by any waypoint
+	std::vector<double> positions_;
+	std::vector<double> velocities_;
+	std::vector<double> accelerations_;
+	std::vector<double> efforts_;
+};
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
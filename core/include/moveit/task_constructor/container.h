@@ -94,6 +94,7 @@ public:
 	PRIVATE_CLASS(SerialContainer)
 	SerialContainer(const std::string& name = "serial container");
 
+	void reset() override;
 	bool canCompute() const override;
 	void compute() override;
 
@@ -103,6 +104,26 @@ protected:
 	SerialContainer(SerialContainerPrivate* impl);
 };
 
+class ConcurrentSerialContainerPrivate;
+/** SerialContainer computing all of its ready children concurrently, also if the Task plans sequentially
+ *
+ * Children are computed on the Task's thread pool or, if the Task plans sequentially, on a thread pool
+ * of the container (with the given number of threads, 0: number of CPU cores).
+ * Idle threads steal work: while slow children (e.g. a Connect stage) are still computing, children that
+ * can compute again (e.g. generators or propagators on either side) are computed once more.
+ * As with parallel planning, new solutions and states are processed sequentially once all children finished.
+ */
+class ConcurrentSerialContainer : public SerialContainer
+{
+public:
+	PRIVATE_CLASS(ConcurrentSerialContainer)
+	ConcurrentSerialContainer(const std::string& name = "concurrent serial container");
+
+	void setThreads(size_t threads) { setProperty("threads", threads); }
+
+	void compute() override;
+};
+
 class ParallelContainerBasePrivate;
 class ParallelContainerBase;
 /** Parallel containers allow for alternative planning stages
@@ -140,12 +161,22 @@ protected:
 /** Plan for different alternatives in parallel.
  *
  * Solution of all children are reported - sorted by cost.
+ * With a parallel execution policy, the children are computed concurrently.
  */
 class Alternatives : public ParallelContainerBase
 {
 public:
 	Alternatives(const std::string& name = "alternatives") : ParallelContainerBase(name) {}
 
+	/// decide whether a state received by the container (in the given direction) is passed to a child
+	using AdmissionPredicate = std::function<bool(const InterfaceState&, Interface::Direction)>;
+	/** only pass received states satisfying predicate to child (nullptr: pass all states)
+	 *
+	 * Rejected states aren't copied into the child's interface at all, such that specialized children
+	 * (e.g. for another group) don't multiply the number of states to schedule.
+	 */
+	void setAdmission(const Stage* child, AdmissionPredicate predicate);
+
 	bool canCompute() const override;
 	void compute() override;
 
@@ -158,6 +189,10 @@ class FallbacksPrivate;
  * Try to find feasible solutions using first child. Only if this fails,
  * proceed to the next child trying an alternative planning strategy.
  * All solutions of the last active child are reported.
+ *
+ * With a parallel execution policy, Connect-like children work on their pending pairs concurrently.
+ * If the property "speculative" is set, later Generator or Propagator children are computed concurrently too.
+ * Their solutions are only reported if all previous children failed (on the current job).
  */
 class Fallbacks : public ParallelContainerBase
 {
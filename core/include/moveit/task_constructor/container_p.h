@@ -41,14 +41,17 @@
 #include <moveit/task_constructor/container.h>
 #include <moveit/macros/class_forward.h>
 #include "stage_p.h"
-
-#include <boost/bimap.hpp>
-#include <boost/bimap/unordered_set_of.hpp>
-#include <boost/bimap/unordered_multiset_of.hpp>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/task_constructor/flat_map.h>
 
 #include <map>
+#include <unordered_map>
 #include <climits>
 
+namespace trajectory_processing {
+class TimeParameterization;
+}
+
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(JointModelGroup);
@@ -116,22 +119,42 @@ public:
 	// forward these methods to the public interface for containers
 	bool canCompute() const override;
 	void compute() override;
+	// forget the link of a released internal copy
+	void onReleaseState(const InterfaceState& state) override;
 
 	// internal interface for first/last child to push to if required
 	InterfacePtr pendingBackward() const { return pending_backward_; }
 	InterfacePtr pendingForward() const { return pending_forward_; }
 
-	// tags for internal_external_ bimap
-	struct INTERNAL
-	{};
-	struct EXTERNAL
-	{};
+	using InternalToExternalMap = utils::FlatPointerMap<const InterfaceState*, const InterfaceState*>;
+	using InternalStates = utils::SmallVector<const InterfaceState*>;
 	// map InterfaceStates from children to external InterfaceStates of the container
-	inline const auto& internalToExternalMap() const { return internal_external_.by<INTERNAL>(); }
-	inline const auto& externalToInternalMap() const { return internal_external_.by<EXTERNAL>(); }
+	inline const InternalToExternalMap& internalToExternalMap() const { return internal_external_; }
+	/// all internal states linked to the given external state
+	inline const InternalStates& internalStates(const InterfaceState* external) const {
+		static const InternalStates NONE;
+		auto it = external_internal_.find(external);
+		return it == external_internal_.end() ? NONE : it->second;
+	}
 
 	/// called by a (direct) child when a solution failed
 	virtual void onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to);
+	/// called by a (direct) child when it evicted a state from its pull interface, before it is removed
+	virtual void onEvictChildState(const Stage& /* child */, const InterfaceState& /* state */) {}
+	/// called by a (direct) child before it discards solutions, which might still be pending for delivery
+	virtual void flushPendingSolutions() {}
+
+	/** runCompute() all given children, concurrently if a thread pool is available
+	 *
+	 * Side effects of the children's computations (new solutions and states) are deferred
+	 * and applied in order of the children list in the calling thread afterwards. */
+	void computeConcurrently(const std::vector<StagePrivate*>& children);
+
+	/** Should computation of the child be withheld as it exceeded its compute budget?
+	 *
+	 * An over-budget child is only computed if no sibling within its budget can compute,
+	 * such that slow stages don't starve the others, but remaining work is still done. */
+	bool withheldByBudget(const StagePrivate* child) const;
 
 protected:
 	ContainerBasePrivate(ContainerBase* me, const std::string& name);
@@ -165,20 +188,60 @@ protected:
 	void liftSolution(const SolutionBasePtr& solution, const InterfaceState* internal_from,
 	                  const InterfaceState* internal_to);
 
-	/// protected writable overloads
-	inline auto& internalToExternalMap() { return internal_external_.by<INTERNAL>(); }
-	inline auto& externalToInternalMap() { return internal_external_.by<EXTERNAL>(); }
+	/// Cost a new solution needs to undercut to enter the top max_retained_solutions (infinity if not limited)
+	double retentionThreshold() const;
+	/// Does lifting preserve the cost of a solution, allowing to discard it before lifting?
+	bool liftingPreservesCost() const;
+
+	/** Accumulated cost above which a pending child state cannot lead to a competitive solution anymore
+	 *
+	 * This is the cost of the best solution plus the slack configured via property cost_pruning_slack.
+	 * Infinity if pruning is disabled, there is no solution yet, or lifting doesn't preserve costs. */
+	double costPruningBound() const;
+	/// Mark the pending state as PRUNED if its accumulated cost exceeds bound
+	void pruneByCost(const InterfaceState& state, double bound);
+	/// Mark all pending states in children's interfaces exceeding bound as PRUNED
+	void pruneByCost(double bound);
+
+	/// combined coarse hash of the sub trajectories of solution, memoizing the hash of each one
+	size_t solutionHash(const SolutionBase& solution);
+	/// whether the sub trajectories of both solutions are equal up to solution_dedup_resolution_
+	bool solutionsEqual(const SolutionBase& a, const SolutionBase& b) const;
+	/// forget the hashes of the task's solution, which is about to be released
+	void forgetSolutionHash(const SolutionBase& solution);
+
+	/// remember the link between a child's (internal) state and the corresponding external state
+	inline void linkStates(const InterfaceState* internal, const InterfaceState* external) {
+		if (internal_external_.insert(std::make_pair(internal, external)).second)
+			external_internal_[external].push_back(internal);
+	}
+	inline void clearStateLinks() {
+		internal_external_.clear();
+		external_internal_.clear();
+	}
 
 	// set in resolveInterface()
 	InterfaceFlags required_interface_;
 
+	// set in init() from property max_retained_solutions (0: unlimited), the task's root also evicts worse solutions
+	uint32_t max_retained_solutions_;
+	// set in init() from property cost_pruning_slack (infinity: disabled)
+	double cost_pruning_slack_;
+	// set in init() from property solution_dedup_resolution (0: disabled), only used by the task's root
+	double solution_dedup_resolution_ = 0.0;
+	// root only: the retained solutions by hash, and memoized hashes of solutions
+	std::unordered_multimap<size_t, const SolutionBase*> solution_by_hash_;
+	std::unordered_map<const SolutionBase*, size_t> solution_hashes_;
+	// root only: memoized hashes of sub trajectories, valid for the given SubTrajectory::trajectoryRevision()
+	std::unordered_map<const SubTrajectory*, std::pair<uint64_t, size_t>> trajectory_hashes_;
+
 private:
 	container_type children_;
 
 	// map start/end states of children (internal) to corresponding states in our external interfaces
-	boost::bimap<boost::bimaps::unordered_set_of<boost::bimaps::tagged<const InterfaceState*, INTERNAL>>,
-	             boost::bimaps::unordered_multiset_of<boost::bimaps::tagged<const InterfaceState*, EXTERNAL>>>
-	    internal_external_;
+	InternalToExternalMap internal_external_;
+	// reverse mapping: an external state can be linked to several internal ones
+	utils::FlatPointerMap<const InterfaceState*, InternalStates> external_internal_;
 
 	/* TODO: these interfaces don't need to be priority-sorted.
 	 * Introduce base class UnsortedInterface (which is a plain list) for this use case. */
@@ -207,6 +270,35 @@ public:
 	void validateConnectivity() const override;
 
 	void reset();
+	// forget the cached partial paths of a released internal copy
+	void onReleaseState(const InterfaceState& state) override;
+
+	/* A partial solution path, linking a child solution to the container's start (BACKWARD) or end (FORWARD).
+	 * Paths are stored as singly-linked lists, starting at the solution closest to the origin state.
+	 * Linking all paths through the same interface state to a common tail avoids copying. */
+	struct PartialPath;
+	using PartialPathPtr = std::shared_ptr<const PartialPath>;
+	struct PartialPath
+	{
+		const SolutionBase* solution;
+		PartialPathPtr next;  // nullptr for the last solution of the path
+	};
+	/// All partial paths originating from an internal interface state into a given direction
+	struct PartialPaths
+	{
+		/// paths reaching the container's boundary, in depth-first traversal order
+		std::vector<PartialPathPtr> complete;
+		/// last path in depth-first traversal order (complete or not), if any
+		PartialPathPtr last;
+		bool has_last = false;
+	};
+
+	/// retrieve (cached) partial paths originating from state s, which is separated by depth stages from the boundary
+	template <Interface::Direction dir>
+	const PartialPaths& partialPaths(const InterfaceState& s, size_t depth);
+	/// drop cached paths of s (and all states depending on them) as new solutions were attached to s
+	template <Interface::Direction dir>
+	void invalidatePartialPaths(const InterfaceState& s);
 
 protected:
 	// connect two neighbors
@@ -215,9 +307,30 @@ protected:
 	// validate that child's interface matches mine (considering start or end only as determined by mask)
 	template <unsigned int mask>
 	void validateInterface(const StagePrivate& child, InterfaceFlags required) const;
+
+	// partial paths cached per internal interface state, indexed by Interface::Direction
+	std::unordered_map<const InterfaceState*, PartialPaths> partial_paths_[2];
+
+	// index of the child to start searching from with anytime scheduling
+	size_t anytime_next_ = 0;
 };
 PIMPL_FUNCTIONS(SerialContainer)
 
+class ConcurrentSerialContainerPrivate : public SerialContainerPrivate
+{
+	friend class ConcurrentSerialContainer;
+
+public:
+	ConcurrentSerialContainerPrivate(ConcurrentSerialContainer* me, const std::string& name);
+
+	/// the Task's thread pool, or the container's own one if the Task plans sequentially
+	utils::ThreadPool& pool();
+
+private:
+	std::unique_ptr<utils::ThreadPool> own_pool_;
+};
+PIMPL_FUNCTIONS(ConcurrentSerialContainer)
+
 class ParallelContainerBasePrivate : public ContainerBasePrivate
 {
 	friend class ParallelContainerBase;
@@ -230,6 +343,11 @@ public:
 
 	void validateConnectivity() const override;
 
+	/// see Alternatives::setAdmission()
+	void setAdmission(const Stage* child, Alternatives::AdmissionPredicate predicate);
+	/// whether state is passed to child by propagateStateToAllChildren()
+	bool admits(const Stage& child, const InterfaceState& state, Interface::Direction dir) const;
+
 protected:
 	void validateInterfaces(const StagePrivate& child, InterfaceFlags& external, bool first = false) const;
 
@@ -238,6 +356,8 @@ private:
 	template <typename Interface::Direction>
 	void propagateStateToAllChildren(Interface::iterator external, Interface::UpdateFlags updated);
 
+	std::map<const Stage*, Alternatives::AdmissionPredicate> admissions_;
+
 	// override to customize behavior on received interface states (default: propagateStateToAllChildren())
 	virtual void initializeExternalInterfaces();
 };
@@ -280,8 +400,17 @@ public:
 	void reset() override;
 	bool canCompute() const override;
 	void compute() override;
+	void onNewSolution(const SolutionBase& s) override;
+
+	/// Does a speculatively computed solution of a later child belong to the current job?
+	virtual bool matchesJob(const SolutionBase& /*s*/) const { return true; }
+	/// Lift solutions the current child computed speculatively before it became active, false if there were none
+	bool liftSpeculativeSolutions();
 
 	container_type::const_iterator current_;  // currently active child
+	bool speculative_;  // compute later children concurrently to current_?
+	// solutions of later children computed speculatively, lifted only when their creator becomes current_
+	std::map<const Stage*, std::vector<const SolutionBase*>> speculative_solutions_;
 };
 
 /// Fallbacks implementation for GENERATOR interface
@@ -297,7 +426,10 @@ struct FallbacksPrivatePropagator : FallbacksPrivateCommon
 	FallbacksPrivatePropagator(FallbacksPrivate&& old);
 	void reset() override;
 	void onNewSolution(const SolutionBase& s) override;
+	bool matchesJob(const SolutionBase& s) const override;
 	bool nextJob() override;
+	/// remove pending copies of job_ from all children
+	void withdrawJob();
 
 	Interface::Direction dir_;  // propagation direction
 	Interface::iterator job_;  // pointer to currently processed external state
@@ -308,15 +440,14 @@ struct FallbacksPrivatePropagator : FallbacksPrivateCommon
 struct FallbacksPrivateConnect : FallbacksPrivate
 {
 	FallbacksPrivateConnect(FallbacksPrivate&& old);
-	void reset() override;
 	bool canCompute() const override;
 	void compute() override;
 	void onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to) override;
+	// later children hold pairs of the evicted state as explicit pairs
+	void onEvictChildState(const Stage& child, const InterfaceState& state) override;
 
 	template <Interface::Direction dir>
 	void propagateStateUpdate(Interface::iterator external, Interface::UpdateFlags updated);
-
-	mutable container_type::const_iterator active_;  // child picked for compute()
 };
 
 class WrapperBasePrivate : public ParallelContainerBasePrivate
@@ -337,6 +468,9 @@ class MergerPrivate : public ParallelContainerBasePrivate
 	using ChildSolutionMap = std::map<const Stage*, ChildSolutionList>;
 	// map from external source state (iterator) to all corresponding children's solutions
 	std::map<const InterfaceState*, ChildSolutionMap> source_state_to_solutions_;
+	// budget for merging a new child solution, set in init() from properties max_merges and merge_timeout
+	uint32_t max_merges_;
+	double merge_timeout_;
 
 public:
 	using Spawner = std::function<void(SubTrajectory&&)>;
@@ -346,10 +480,15 @@ public:
 
 	void onNewPropagateSolution(const SolutionBase& s);
 	void onNewGeneratorSolution(const SolutionBase& s);
+	/** merge the current solution with combinations of other children's solutions (concurrently if possible)
+	 *
+	 * Combinations are merged in order of increasing cost, until max_merges_ were successful or merge_timeout_
+	 * has passed. */
 	void mergeAnyCombination(const ChildSolutionMap& all_solutions, const SolutionBase& current,
 	                         const planning_scene::PlanningSceneConstPtr& start_scene, const Spawner& spawner);
-	void merge(const ChildSolutionList& sub_solutions, const planning_scene::PlanningSceneConstPtr& start_scene,
-	           const Spawner& spawner);
+	/// merge and validate a single combination of sub solutions (thread-safe, requires jmg_merged_)
+	SubTrajectory merge(const ChildSolutionList& sub_solutions, const planning_scene::PlanningSceneConstPtr& start_scene,
+	                    const trajectory_processing::TimeParameterization& timing) const;
 
 	void sendForward(SubTrajectory&& t, const InterfaceState* from);
 	void sendBackward(SubTrajectory&& t, const InterfaceState* to);
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <cassert>
 #include <queue>
 #include <list>
 #include <deque>
+#include <set>
+#include <unordered_map>
 #include <iostream>
 #include <algorithm>
 
@@ -23,7 +26,8 @@ struct ValueOrPointeeLess<T, decltype(*std::declval<T>() < *std::declval<T>())>
  *
  *  In contrast to std::priority_queue, we use a std::list as the underlying container.
  *  This ensures, that existing iterators remain valid upon insertion and deletion.
- *  Sorted insertion has logarithmic complexity.
+ *  Sorted insertion has linear complexity (w.r.t. list traversal), but requires only logarithmic comparisons.
+ *  For large containers, consider indexed_ordered<ValueType>.
  */
 template <typename T, typename Compare = ValueOrPointeeLess<T>>
 class ordered
@@ -128,6 +132,194 @@ public:
 	}
 };
 
+/**
+ *  @brief indexed_ordered<ValueType> provides the API of ordered<ValueType> with logarithmic insertion and update.
+ *
+ *  Like ordered<ValueType>, items are stored in a std::list, keeping existing iterators valid.
+ *  Additionally, a balanced tree indexes the list positions, such that insertion and update have
+ *  logarithmic complexity. A hash map allows constant-time lookup of an item's position via find().
+ *  Hence, items need to be unique (w.r.t. Hash). As the index relies on the sort order of all items,
+ *  any change of an item's sort value needs to be announced immediately via update() - or sort() if many changed.
+ */
+template <typename T, typename Compare = ValueOrPointeeLess<T>, typename Hash = std::hash<T>>
+class indexed_ordered
+{
+public:
+	using container_type = std::list<T>;
+	using value_type = typename container_type::value_type;
+	using size_type = typename container_type::size_type;
+	using difference_type = typename container_type::difference_type;
+
+	using reference = typename container_type::reference;
+	using const_reference = typename container_type::const_reference;
+
+	using pointer = typename container_type::pointer;
+	using const_pointer = typename container_type::const_pointer;
+
+	using iterator = typename container_type::iterator;
+	using const_iterator = typename container_type::const_iterator;
+
+	using reverse_iterator = typename container_type::reverse_iterator;
+	using const_reverse_iterator = typename container_type::const_reverse_iterator;
+
+protected:
+	/// compare list positions by their referenced items (also supporting heterogeneous lookup by value)
+	struct PositionLess
+	{
+		using is_transparent = void;
+		Compare comp;
+
+		bool operator()(const iterator& x, const iterator& y) const { return comp(*x, *y); }
+		bool operator()(const value_type& x, const iterator& y) const { return comp(x, *y); }
+		bool operator()(const iterator& x, const value_type& y) const { return comp(*x, y); }
+	};
+	using index_type = std::multiset<iterator, PositionLess>;
+
+	container_type c;
+	Compare comp;
+	index_type index_;  // list positions sorted by their items
+	std::unordered_map<value_type, typename index_type::iterator, Hash> nodes_;  // item -> index node
+
+public:
+	/// initialize empty container
+	explicit indexed_ordered() {}
+	indexed_ordered(const indexed_ordered& other) : c(other.c), comp(other.comp) { reindex(); }
+	indexed_ordered(indexed_ordered&& other) = default;  // list nodes (and thus iterators) are moved along
+	indexed_ordered& operator=(const indexed_ordered& other) {
+		c = other.c;
+		comp = other.comp;
+		reindex();
+		return *this;
+	}
+	indexed_ordered& operator=(indexed_ordered&& other) = default;
+
+	bool empty() const { return c.empty(); }
+	size_type size() const { return c.size(); }
+
+	void clear() {
+		nodes_.clear();
+		index_.clear();
+		c.clear();
+	}
+
+	reference top() { return c.front(); }
+	const_reference top() const { return c.front(); }
+	value_type pop() {
+		value_type result(top());
+		unregister(c.begin());
+		c.pop_front();
+		return result;
+	}
+
+	reference front() { return c.front(); }
+	const_reference front() const { return c.front(); }
+	reference back() { return c.back(); }
+	const_reference back() const { return c.back(); }
+
+	iterator begin() { return c.begin(); }
+	iterator end() { return c.end(); }
+
+	const_iterator begin() const { return c.begin(); }
+	const_iterator end() const { return c.end(); }
+	const_iterator cbegin() const { return c.begin(); }
+	const_iterator cend() const { return c.end(); }
+
+	const_reverse_iterator rbegin() const { return c.rbegin(); }
+	const_reverse_iterator rend() const { return c.rend(); }
+	const_reverse_iterator crbegin() const { return c.rbegin(); }
+	const_reverse_iterator crend() const { return c.rend(); }
+
+	/// find position of given item in constant time, end() if not found
+	iterator find(const value_type& item) {
+		auto node = nodes_.find(item);
+		return node == nodes_.end() ? c.end() : *node->second;
+	}
+	const_iterator find(const value_type& item) const { return const_cast<indexed_ordered*>(this)->find(item); }
+
+	/// explicitly sort container, useful if many items have changed their value
+	void sort() {
+		c.sort(comp);
+		reindex();
+	}
+
+	iterator insert(const value_type& item) {
+		auto hint = index_.upper_bound(item);
+		return index(c.insert(position(hint), item), hint);
+	}
+	iterator insert(value_type&& item) {
+		auto hint = index_.upper_bound(item);
+		return index(c.insert(position(hint), std::move(item)), hint);
+	}
+	inline void push(const value_type& item) { insert(item); }
+	inline void push(value_type&& item) { insert(std::move(item)); }
+
+	iterator erase(const_iterator pos) {
+		unregister(pos);
+		return c.erase(pos);
+	}
+
+	/// update sort position of a single item after changes
+	iterator update(iterator& it) {
+		unregister(it);  // erasing an index node doesn't require (now invalid) comparisons
+		auto hint = index_.upper_bound(*it);
+		c.splice(position(hint), c, it);
+		return index(it, hint);
+	}
+
+	/// move element pos from this to other container, inserting before other_pos
+	iterator moveTo(iterator pos, container_type& other, iterator other_pos) {
+		unregister(pos);
+		other.splice(other_pos, c, pos);
+		return pos;
+	}
+	/// move element pos from other container into this one (sorted)
+	iterator moveFrom(iterator pos, container_type& other) {
+		auto hint = index_.upper_bound(*pos);
+		c.splice(position(hint), other, pos);
+		return index(pos, hint);
+	}
+	/// move all elements of other into this container, sorting them only once (stable w.r.t. existing elements)
+	void merge(container_type& other) {
+		other.sort(comp);
+		c.merge(other, comp);
+		reindex();
+	}
+
+	template <typename Predicate>
+	void remove_if(Predicate p) {
+		for (auto it = c.begin(), end = c.end(); it != end;) {
+			if (p(*it))
+				it = erase(it);
+			else
+				++it;
+		}
+	}
+
+private:
+	// list position corresponding to index node
+	iterator position(typename index_type::iterator node) { return node == index_.end() ? c.end() : *node; }
+
+	// add list position of an item to the index, inserting before hint
+	iterator index(iterator it, typename index_type::iterator hint) {
+		nodes_[*it] = index_.insert(hint, it);
+		return it;
+	}
+
+	void unregister(const_iterator it) {
+		auto node = nodes_.find(*it);
+		assert(node != nodes_.end());
+		index_.erase(node->second);
+		nodes_.erase(node);
+	}
+
+	void reindex() {
+		nodes_.clear();
+		index_.clear();
+		for (auto it = c.begin(), end = c.end(); it != end; ++it)
+			index(it, index_.end());  // list is sorted, thus append
+	}
+};
+
 namespace detail {
 
 template <typename ValueType, typename CostType>
@@ -42,6 +42,12 @@
 #include <moveit/task_constructor/utils.h>
 #include <moveit_msgs/RobotState.h>
 
+#include <limits>
+
+namespace distance_field {
+class DistanceField;
+}
+
 namespace moveit {
 namespace task_constructor {
 
@@ -62,6 +68,45 @@ public:
 	virtual double operator()(const SubTrajectory& s, std::string& comment) const;
 	virtual double operator()(const SolutionSequence& s, std::string& comment) const;
 	virtual double operator()(const WrappedSolution& s, std::string& comment) const;
+
+	/** cost above which the solution currently evaluated (in this thread) is discarded anyway
+	 *
+	 * Expensive cost terms may stop their evaluation as soon as their cost is known to reach this bound,
+	 * returning any finite cost not below it. The bound is infinite if solutions are not limited.
+	 */
+	static double bound();
+
+	/// RAII helper setting bound() for the current thread
+	class ScopedBound
+	{
+	public:
+		explicit ScopedBound(double bound);
+		~ScopedBound();
+		ScopedBound(const ScopedBound&) = delete;
+		ScopedBound& operator=(const ScopedBound&) = delete;
+
+	private:
+		double previous_;
+	};
+
+	/** whether the comment of an infinite (i.e. failing) cost is used (in this thread)
+	 *
+	 * False if the evaluating stage drops failures anyway, such that cost terms can skip formatting it.
+	 */
+	static bool explainFailures();
+
+	/// RAII helper setting explainFailures() for the current thread
+	class ScopedExplainFailures
+	{
+	public:
+		explicit ScopedExplainFailures(bool explain);
+		~ScopedExplainFailures();
+		ScopedExplainFailures(const ScopedExplainFailures&) = delete;
+		ScopedExplainFailures& operator=(const ScopedExplainFailures&) = delete;
+
+	private:
+		bool previous_;
+	};
 };
 
 /** base class for cost terms that only work on SubTrajectory solutions
@@ -122,6 +167,10 @@ public:
 	double cost;
 };
 
+/// (weighted) joint-space distance between robot states, precompiled for a robot model
+class JointDistanceKernel;
+using JointDistanceKernelConstPtr = std::shared_ptr<const JointDistanceKernel>;
+
 /// trajectory length with optional weighting for different joints
 class PathLength : public TrajectoryCostTerm
 {
@@ -135,6 +184,9 @@ public:
 	double operator()(const SubTrajectory& s, std::string& comment) const override;
 
 	std::map<std::string, double> joints;  //< joint weights
+
+private:
+	mutable JointDistanceKernelConstPtr kernel_;  //< compiled for last used robot model and joints
 };
 
 /// (weighted) joint-space distance to reference pose
@@ -150,6 +202,9 @@ public:
 	moveit_msgs::RobotState reference;
 	std::map<std::string, double> weights;
 	Mode mode;
+
+private:
+	mutable JointDistanceKernelConstPtr kernel_;  //< compiled for last used robot model and weights
 };
 
 /// execution duration of the whole trajectory
@@ -189,11 +244,74 @@ public:
 
 	Mode mode;
 
+	/// how waypoint distances of a trajectory are combined
+	enum class Aggregation
+	{
+		AVERAGE,
+		MINIMUM /* allows to stop early once the cost reaches CostTerm::bound() */
+	};
+	Aggregation aggregation{ Aggregation::AVERAGE };
+
+	/** only evaluate every stride-th waypoint of a trajectory (and the last one)
+	 *
+	 * Distances of skipped waypoints are interpolated linearly. Intervals whose boundary distances differ by more
+	 * than refinement_threshold are bisected until all waypoints are evaluated or the distances are close enough.
+	 */
+	std::size_t stride{ 1 };
+	double refinement_threshold{ std::numeric_limits<double>::infinity() };
+
+	/** precomputed distance field of the static world, queried instead of FCL for world distances
+	 *
+	 * Collision bodies of the robot are approximated by their bounding spheres. The resulting distances are
+	 * a cheap, conservative estimate, but don't indicate collisions. Attached objects are not considered.
+	 */
+	std::shared_ptr<const distance_field::DistanceField> world_distance_field;
+
+	/// mapping from (aggregated) distance to cost, assumed to be monotonically decreasing
 	std::function<double(double)> distance_to_cost;
 
 	double operator()(const SubTrajectory& s, std::string& comment) const override;
 };
 
+/** weighted sum of cost terms, evaluating expensive ones only for the best complete solutions
+ *
+ * IMMEDIATE terms are evaluated when a solution is created, like any other cost term, and thus decide about
+ * the ordering during planning. DEFERRED terms, e.g. Clearance, are only evaluated by Task::plan() for solutions
+ * that end up in one of the best complete solutions (see Task::setDeferredCostsTopK()). Their costs are then added
+ * to the solution and all its parents, and the task's solutions are ranked again.
+ */
+class Tiered : public CostTerm
+{
+public:
+	enum class Tier
+	{
+		IMMEDIATE,
+		DEFERRED
+	};
+
+	/// add a term, weighting its cost
+	void add(CostTermConstPtr term, Tier tier = Tier::IMMEDIATE, double weight = 1.0);
+	bool hasDeferred() const;
+
+	double operator()(const SubTrajectory& s, std::string& comment) const override;
+	double operator()(const SolutionSequence& s, std::string& comment) const override;
+	double operator()(const WrappedSolution& s, std::string& comment) const override;
+
+	/// weighted sum of the DEFERRED terms for s
+	double deferredCost(const SolutionBase& s, std::string& comment) const;
+
+private:
+	struct Term
+	{
+		CostTermConstPtr term;
+		Tier tier;
+		double weight;
+	};
+	std::vector<Term> terms_;
+
+	double evaluate(const SolutionBase& s, Tier tier, std::string& comment) const;
+};
+
 }  // namespace cost
 }  // namespace task_constructor
 }  // namespace moveit
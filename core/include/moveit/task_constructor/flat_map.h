@@ -0,0 +1,213 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Flat open-addressing hash maps for pointer keys
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/small_vector.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Hash map from pointers to values, using open addressing with linear probing
+ *
+ * Entries are kept in a single contiguous array of power-of-two size, such that lookups mostly touch
+ * a single cache line. nullptr is reserved to mark empty slots and cannot be used as a key.
+ * Erasing an entry shifts the following entries of its probe sequence back, such that no tombstones are needed.
+ * Iteration order is unspecified and iterators are invalidated by insertion and erasure.
+ */
+template <typename K, typename V>
+class FlatPointerMap
+{
+	static_assert(std::is_pointer<K>::value, "FlatPointerMap requires pointer keys");
+
+public:
+	using key_type = K;
+	using mapped_type = V;
+	using value_type = std::pair<K, V>;
+
+	template <typename Value, typename Slot>
+	class Iterator
+	{
+		friend class FlatPointerMap;
+		Slot* slot_;
+		Slot* end_;
+		Iterator(Slot* slot, Slot* end) : slot_(slot), end_(end) { skip(); }
+		void skip() {
+			while (slot_ != end_ && slot_->first == nullptr)
+				++slot_;
+		}
+
+	public:
+		Iterator() : slot_(nullptr), end_(nullptr) {}
+		// allow conversion from iterator to const_iterator
+		template <typename OtherValue, typename OtherSlot>
+		Iterator(const Iterator<OtherValue, OtherSlot>& other) : slot_(other.slot_), end_(other.end_) {}
+
+		Value& operator*() const { return *slot_; }
+		Value* operator->() const { return slot_; }
+		Iterator& operator++() {
+			++slot_;
+			skip();
+			return *this;
+		}
+		bool operator==(const Iterator& other) const { return slot_ == other.slot_; }
+		bool operator!=(const Iterator& other) const { return slot_ != other.slot_; }
+
+		template <typename, typename>
+		friend class Iterator;
+	};
+	using iterator = Iterator<value_type, value_type>;
+	using const_iterator = Iterator<const value_type, const value_type>;
+
+	bool empty() const { return size_ == 0; }
+	size_t size() const { return size_; }
+
+	iterator begin() { return iterator(slots_.data(), slots_.data() + slots_.size()); }
+	iterator end() { return iterator(slots_.data() + slots_.size(), slots_.data() + slots_.size()); }
+	const_iterator begin() const { return const_iterator(slots_.data(), slots_.data() + slots_.size()); }
+	const_iterator end() const {
+		return const_iterator(slots_.data() + slots_.size(), slots_.data() + slots_.size());
+	}
+
+	iterator find(K key) {
+		if (slots_.empty())
+			return end();
+		value_type& slot = slots_[probe(key)];
+		return slot.first == key ? iterator(&slot, slots_.data() + slots_.size()) : end();
+	}
+	const_iterator find(K key) const { return const_cast<FlatPointerMap*>(this)->find(key); }
+	size_t count(K key) const { return find(key) != end(); }
+
+	const V& at(K key) const {
+		auto it = find(key);
+		if (it == end())
+			throw std::out_of_range("FlatPointerMap::at");
+		return it->second;
+	}
+
+	/// insert value for key, if not yet present; returns the position of key and whether insertion took place
+	std::pair<iterator, bool> insert(const value_type& value) {
+		assert(value.first != nullptr);
+		if ((size_ + 1) * 4 > slots_.size() * 3)  // keep load factor below 3/4
+			rehash(std::max<size_t>(16, slots_.size() * 2));
+		value_type& slot = slots_[probe(value.first)];
+		const bool inserted = slot.first == nullptr;
+		if (inserted) {
+			slot = value;
+			++size_;
+		}
+		return std::make_pair(iterator(&slot, slots_.data() + slots_.size()), inserted);
+	}
+	/// access value of key, default-constructing it if not yet present
+	V& operator[](K key) { return insert(value_type(key, V())).first->second; }
+
+	/// erase the entry of key, if present; returns the number of erased entries
+	size_t erase(K key) {
+		if (slots_.empty())
+			return 0;
+		const size_t mask = slots_.size() - 1;
+		size_t gap = probe(key);
+		if (slots_[gap].first != key)
+			return 0;
+		for (size_t i = (gap + 1) & mask; slots_[i].first != nullptr; i = (i + 1) & mask) {
+			// move the entry into the gap, unless its home slot lies cyclically within (gap, i]
+			if (((i - home(slots_[i].first)) & mask) >= ((i - gap) & mask)) {
+				slots_[gap] = std::move(slots_[i]);
+				gap = i;
+			}
+		}
+		slots_[gap] = value_type(nullptr, V());
+		--size_;
+		return 1;
+	}
+
+	void clear() {
+		slots_.clear();
+		size_ = 0;
+	}
+	void reserve(size_t n) {
+		size_t capacity = 16;
+		while (capacity * 3 < n * 4)
+			capacity *= 2;
+		if (capacity > slots_.size())
+			rehash(capacity);
+	}
+
+private:
+	std::vector<value_type> slots_;  // power-of-two size, nullptr keys mark empty slots
+	size_t size_ = 0;
+
+	// first slot of the probe sequence of key
+	size_t home(K key) const {
+		// mix the bits of the pointer: its lower bits are mostly zero due to alignment
+		size_t h = std::hash<K>()(key);
+		h ^= h >> 17;
+		h *= 0xed5ad4bbu;
+		h ^= h >> 11;
+		return h & (slots_.size() - 1);
+	}
+
+	// slot holding key or the empty slot where it should be inserted
+	size_t probe(K key) const {
+		const size_t mask = slots_.size() - 1;
+		size_t i = home(key);
+		while (slots_[i].first != nullptr && slots_[i].first != key)
+			i = (i + 1) & mask;
+		return i;
+	}
+
+	void rehash(size_t capacity) {
+		std::vector<value_type> old(capacity, value_type(nullptr, V()));
+		old.swap(slots_);
+		for (value_type& entry : old)
+			if (entry.first != nullptr)
+				slots_[probe(entry.first)] = std::move(entry);
+	}
+};
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
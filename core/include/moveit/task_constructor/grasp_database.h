@@ -0,0 +1,103 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Memory-mapped database of precomputed grasps, sorted by quality
+ */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Geometry>
+#include <Eigen/StdVector>
+
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+MOVEIT_CLASS_FORWARD(GraspDatabase);
+
+/** Grasp poses of an object, sorted by decreasing quality and memory-mapped from a file
+ *
+ * Grasps are decoded on access only, such that databases of millions of grasps can be streamed
+ * without ever being loaded into memory. The mapped pages are shared between processes.
+ * Grasp poses denote the target pose of the ik frame w.r.t. the object frame.
+ * A database is written once with save() and is immutable afterwards. Queries are thread-safe.
+ */
+class GraspDatabase
+{
+public:
+	struct Grasp
+	{
+		Eigen::Isometry3d pose;  // w.r.t. the object frame
+		double quality;  // higher is better
+	};
+	using Grasps = std::vector<Grasp, Eigen::aligned_allocator<Grasp>>;
+
+	/// write grasps, sorting them by decreasing quality
+	static void save(const std::string& filename, Grasps grasps, const std::string& object = "");
+	/// memory-map a database written with save(), throws std::runtime_error on failure
+	static GraspDatabaseConstPtr load(const std::string& filename);
+
+	~GraspDatabase();
+	GraspDatabase(const GraspDatabase&) = delete;
+	GraspDatabase& operator=(const GraspDatabase&) = delete;
+
+	/// name of the object, the grasps were computed for (may be empty)
+	const std::string& object() const { return object_; }
+	size_t size() const { return size_; }
+
+	/// decode the i-th best grasp
+	Grasp grasp(size_t i) const;
+	double quality(size_t i) const;
+	/// number of grasps with a quality of at least min_quality (binary search)
+	size_t countAbove(double min_quality) const;
+
+private:
+	GraspDatabase() = default;
+	struct Record;
+	const Record& record(size_t i) const;
+
+	std::string object_;
+	size_t size_ = 0;
+	const Record* records_ = nullptr;
+	void* mapping_ = nullptr;
+	size_t mapping_size_ = 0;
+};
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,115 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+
+/* Desc: canonical hashes of joint states, world objects, and interface states */
+
+#pragma once
+
+#include <moveit/collision_detection/world.h>
+#include <moveit/macros/class_forward.h>
+
+#include <Eigen/Geometry>
+#include <cstddef>
+#include <memory>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(JointModelGroup);
+MOVEIT_CLASS_FORWARD(RobotModel);
+MOVEIT_CLASS_FORWARD(RobotState);
+}  // namespace core
+
+namespace task_constructor {
+class InterfaceState;
+class SubTrajectory;
+
+namespace utils {
+
+/// combine the entries of pose, quantized to resolution, into seed
+void hashPose(size_t& seed, const Eigen::Isometry3d& pose, double resolution);
+
+/** hash of the active joints' positions of group (or of the whole robot if group is nullptr)
+ *
+ * Positions are quantized to resolution. Continuous joints are normalized to [-pi, pi] first,
+ * such that equivalent configurations yield the same hash. Mimic joints are ignored.
+ * positions need to provide values for all variables of model.
+ */
+size_t jointStateHash(const moveit::core::RobotModel& model, const double* positions,
+                      const moveit::core::JointModelGroup* group, double resolution);
+size_t jointStateHash(const moveit::core::RobotState& state, const moveit::core::JointModelGroup* group,
+                      double resolution);
+
+/** hash of a world object's name, shapes, and poses, quantized to resolution
+ *
+ * Hashes are cached per object instance. Diff scenes share unmodified objects with their parent, as World
+ * copies them on write. Hence, worldHash() of a scene only computes the hashes of objects added or modified
+ * since the scene it was derived from. The cache only keeps weak references to hashed objects. Objects owned by a
+ * single world are modified in place: a cached hash is only reused if the object's poses and shapes are unchanged.
+ * Entries of released objects are pruned as the cache grows.
+ */
+size_t objectHash(const collision_detection::World::ObjectConstPtr& object, double resolution);
+/// number of object hashes currently cached
+size_t objectHashCacheSize();
+/// release all cached object hashes
+void clearObjectHashCache();
+
+/** hash of an interface state: its world, attached bodies, allowed collisions, and (group's) joint positions
+ *
+ * This doesn't create the scene of a lightweight state. To key caches on the identity of a state's scene
+ * instead of its content, use InterfaceState::sceneRevision().
+ */
+size_t stateHash(const InterfaceState& state, const moveit::core::JointModelGroup* group, double resolution);
+
+/** hash of a sub trajectory: the joint positions of all its waypoints, and the world and joints of its end state
+ *
+ * Compact and full representations of the same trajectory yield the same hash. Timing is ignored.
+ */
+size_t trajectoryHash(const SubTrajectory& trajectory, double resolution);
+
+/** coarse hash of a sub trajectory: its number of waypoints and the world of its end state
+ *
+ * Unlike trajectoryHash(), it doesn't bin joint positions: trajectories equal by trajectoriesEqual() always share it.
+ * Thus, it indexes candidates to compare exactly.
+ */
+size_t coarseTrajectoryHash(const SubTrajectory& trajectory, double resolution);
+/** whether both sub trajectories have the same number of waypoints, all within resolution (per joint, see
+ * JointModel::distance()), and end states with the same joint positions (within resolution) and world (by hash)
+ */
+bool trajectoriesEqual(const SubTrajectory& a, const SubTrajectory& b, double resolution);
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
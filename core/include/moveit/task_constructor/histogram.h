@@ -0,0 +1,96 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Fixed-bucket histogram of durations, e.g. of Stage::compute() calls
+ */
+
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Histogram of durations in exponentially growing buckets, recording in constant time without allocation
+ *
+ * Bucket i counts durations in (bound(i-1), bound(i)], with bounds doubling from 100us to ~1.6s.
+ * The last bucket counts everything beyond.
+ */
+class LatencyHistogram
+{
+public:
+	static constexpr size_t BUCKETS = 16;
+	static constexpr double FIRST_BOUND = 1e-4;
+
+	/// upper bound (seconds) of the given bucket, infinity for the last one
+	static double bound(size_t bucket) {
+		return bucket + 1 < BUCKETS ? std::ldexp(FIRST_BOUND, static_cast<int>(bucket)) :
+		                              std::numeric_limits<double>::infinity();
+	}
+
+	void record(double seconds) {
+		size_t bucket = 0;
+		while (bucket + 1 < BUCKETS && seconds > bound(bucket))
+			++bucket;
+		++counts_[bucket];
+		++count_;
+		sum_ += seconds;
+	}
+	void clear() {
+		counts_.fill(0);
+		count_ = 0;
+		sum_ = 0.0;
+	}
+
+	/// number of durations recorded in the given bucket
+	uint64_t count(size_t bucket) const { return counts_[bucket]; }
+	/// total number of recorded durations
+	uint64_t count() const { return count_; }
+	/// sum of all recorded durations (seconds)
+	double sum() const { return sum_; }
+
+private:
+	std::array<uint64_t, BUCKETS> counts_{};
+	uint64_t count_ = 0;
+	double sum_ = 0.0;
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
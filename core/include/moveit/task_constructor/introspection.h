@@ -43,10 +43,14 @@
 #include <moveit_task_constructor_msgs/TaskStatistics.h>
 #include <moveit_task_constructor_msgs/Solution.h>
 #include <moveit_task_constructor_msgs/GetSolution.h>
+#include <moveit/task_constructor/solution_compression.h>
+
+#include <memory>
 
 #define DESCRIPTION_TOPIC "description"
 #define STATISTICS_TOPIC "statistics"
 #define SOLUTION_TOPIC "solution"
+#define COMPRESSED_SOLUTION_TOPIC "solution_compressed"
 #define GET_SOLUTION_SERVICE "get_solution"
 
 namespace moveit {
@@ -61,6 +65,8 @@ class IntrospectionPrivate;
 /** The Introspection class provides publishing of task state and solutions.
  *
  *  It is interlinked to its task.
+ *  Task statistics are published from a background thread: only the snapshot of the statistics
+ *  is taken in the planning thread, and snapshots taken faster than they are published are coalesced.
  */
 class Introspection
 {
@@ -79,18 +85,50 @@ public:
 
 	/// fill task state message for publishing the current task state
 	moveit_task_constructor_msgs::TaskStatistics& fillTaskStatistics(moveit_task_constructor_msgs::TaskStatistics& msg);
-	/// publish the current state of task
+	/// publish the current state of task (asynchronously)
 	void publishTaskState();
+	/// publish the current state of task, if the last publish is older than the publish period
+	void updateTaskState();
+
+	/// maximum rate (Hz) of updateTaskState() publishing statistics during planning (0: on every update)
+	void setPublishRate(double rate);
+	double publishRate() const;
+
+	/** Publish every n-th statistics message as a full keyframe (0: keyframes only)
+	 *
+	 * Other messages are incremental, only listing solution IDs added since the previously published message.
+	 * After solutions were unregistered, the next message is a keyframe, such that subscribers drop their IDs.
+	 */
+	void setKeyframeInterval(size_t interval);
+	size_t keyframeInterval() const;
 
 	/// indicate that this task was reset
 	void reset();
 
 	/// register the given solution, assigning a unique ID
 	void registerSolution(const SolutionBase& s);
+	/// forget a discarded solution, its ID is not reused and the next statistics message is a keyframe
+	void unregisterSolution(const SolutionBase& s);
 
 	/// publish the given solution
 	void publishSolution(const SolutionBase& s);
 
+	/** Publish solutions compressed on COMPRESSED_SOLUTION_TOPIC instead of SOLUTION_TOPIC, e.g. for remote rviz
+	 *
+	 * Trajectories are quantized as specified by options. The get_solution service is not affected.
+	 * Compressed messages are cached along with the solution messages (see setSolutionCacheSize()).
+	 */
+	void enableCompression(bool enable = true, const utils::SolutionCompression& options = {});
+
+	/** Number of solution messages cached for publishSolution() and the get_solution service (0: no caching)
+	 *
+	 * Least recently used messages are evicted first. The cache is cleared on reset().
+	 */
+	void setSolutionCacheSize(size_t size);
+	size_t solutionCacheSize() const;
+	/// drop all cached solution messages, required after modifying (the costs or trajectories of) stored solutions
+	void invalidateSolutions();
+
 	/// publish all top-level solutions of task
 	void publishAllSolutions(bool wait = true);
 
@@ -105,8 +143,13 @@ public:
 	uint32_t solutionId(const moveit::task_constructor::SolutionBase& s);
 
 private:
-	void fillStageStatistics(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& s);
+	/// fill statistics with all solutions, or only those with an ID larger than since (if non-zero)
+	moveit_task_constructor_msgs::TaskStatistics& fillTaskStatistics(moveit_task_constructor_msgs::TaskStatistics& msg,
+	                                                                 uint32_t since);
+	void fillStageStatistics(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& s, uint32_t since);
 	void fillSolution(moveit_task_constructor_msgs::Solution& msg, const SolutionBase& s);
+	/// cached message of the given solution, created on demand and shared by all publishers and services
+	moveit_task_constructor_msgs::SolutionConstPtr solutionMsg(const SolutionBase& s);
 	/// retrieve or set id of given stage
 	uint32_t stageId(const moveit::task_constructor::Stage* const s);
 	/// retrieve solution with given id
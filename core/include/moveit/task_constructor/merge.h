@@ -55,10 +55,28 @@ moveit::core::JointModelGroup* merge(const std::vector<const moveit::core::Joint
  * (to know about the involved joint names), a merged JointModelGroup needs to be passed
  * or created on the fly. This JMG needs to stay alive during the lifetime of the trajectory.
  * For now, only the trajectory path is considered. Timings, velocities, etc. are ignored.
+ * Forward kinematics of the waypoints is not computed: call updateKinematics() before accessing link transforms.
+ * Different combinations of sub trajectories can be merged concurrently, if merged_group is already created.
  */
 robot_trajectory::RobotTrajectoryPtr
 merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
       const moveit::core::RobotState& base_state, moveit::core::JointModelGroup*& merged_group,
       const trajectory_processing::TimeParameterization& time_parameterization);
+/// merge sub trajectories without time parameterization, e.g. to defer it via SubTrajectory::deferTiming()
+robot_trajectory::RobotTrajectoryPtr
+merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
+      const moveit::core::RobotState& base_state, moveit::core::JointModelGroup*& merged_group);
+
+/// compute forward kinematics of all waypoints of the trajectory
+void updateKinematics(robot_trajectory::RobotTrajectory& trajectory);
+/** compute forward kinematics of all waypoints of a merged trajectory, group by group
+ *
+ * Waypoints need to differ only in the joints of groups (and share attached bodies), as created by merge().
+ * Each waypoint starts from the transforms of its predecessor, only updating the subtrees of moved groups.
+ * In contrast, updating a waypoint as a whole recomputes everything below the common root of all moved groups,
+ * e.g. the whole upper body for two arms.
+ */
+void updateKinematics(robot_trajectory::RobotTrajectory& trajectory,
+                      const std::vector<const moveit::core::JointModelGroup*>& groups);
 }  // namespace task_constructor
 }  // namespace moveit
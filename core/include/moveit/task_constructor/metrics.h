@@ -0,0 +1,113 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Lightweight runtime metrics of a task, independent of introspection
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/solvers/instrumented_planner.h>
+#include <moveit_task_constructor_msgs/TaskMetrics.h>
+#include <ros/node_handle.h>
+#include <ros/publisher.h>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Sample per-stage counters of a task while it is planning and publish them at a fixed rate
+ *
+ * Metrics comprise number and latency histogram of compute() calls, the number of queued and pruned states
+ * in the stages' pull interfaces, as well as the number and rate of solutions and failures.
+ * Statistics of planners added via addPlanner() are reported alongside.
+ * They are published as TaskMetrics on topic "metrics" in the task's private namespace.
+ * Optionally, they are also written to a file in Prometheus' text exposition format,
+ * e.g. to be scraped via node_exporter's textfile collector.
+ *
+ * Sampling happens in the planning thread between top-level iterations of Task::plan(), at most with the
+ * configured rate, and is skipped as long as there are neither subscribers nor a file to write.
+ * The task needs to outlive the publisher.
+ */
+class MetricsPublisher
+{
+public:
+	MetricsPublisher(Task& task, double rate = 1.0);
+	~MetricsPublisher();
+	MetricsPublisher(const MetricsPublisher&) = delete;
+	MetricsPublisher& operator=(const MetricsPublisher&) = delete;
+
+	/// maximum rate (Hz) of published metrics, 0 to publish after each iteration
+	void setPublishRate(double rate);
+	double publishRate() const;
+
+	/// additionally write metrics in Prometheus' text format to path (replaced atomically), empty to disable
+	void setTextfile(const std::string& path) { textfile_ = path; }
+	const std::string& textfile() const { return textfile_; }
+
+	/// report the statistics of planner, too
+	void addPlanner(const solvers::InstrumentedPlannerConstPtr& planner) { planners_.push_back(planner); }
+
+	/// sample and publish the current metrics immediately
+	void publish();
+	/// sample the current metrics of the task
+	void fill(moveit_task_constructor_msgs::TaskMetrics& msg);
+
+	/// write metrics in Prometheus' text exposition format
+	static void writePrometheus(const moveit_task_constructor_msgs::TaskMetrics& msg, std::ostream& os);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	Task& task_;
+	Task::TaskCallbackList::const_iterator callback_;
+	ros::NodeHandle nh_;
+	ros::Publisher publisher_;
+	std::string textfile_;
+	std::vector<solvers::InstrumentedPlannerConstPtr> planners_;
+
+	std::chrono::duration<double> period_;
+	Clock::time_point last_publish_;
+	// number of solutions per stage at the previous sample, to compute solution rates
+	Clock::time_point last_sample_;
+	std::unordered_map<const Stage*, size_t> last_solutions_;
+};
+
+}  // namespace task_constructor
+}  // namespace moveit
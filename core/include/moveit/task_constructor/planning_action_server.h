@@ -0,0 +1,82 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Action server planning requests and streaming solutions while planning continues
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/planning_server.h>
+#include <moveit_task_constructor_msgs/PlanTaskAction.h>
+#include <actionlib/server/simple_action_server.h>
+#include <ros/node_handle.h>
+
+#include <atomic>
+#include <string>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Serve PlanTask action goals, streaming each new solution to the client as feedback
+ *
+ * Goals are planned by a PlanningServer with a single worker, i.e. one at a time, by a fresh task stamped out
+ * from the template. Each new top-level solution is sent as feedback as soon as it is found, such that clients
+ * can start executing a good-enough solution while planning continues for better ones.
+ * Planning is stopped when max_solutions are found, on timeout, or when the goal is preempted.
+ * The result holds the successful solutions, sorted by cost.
+ * Properties of the goal are deserialized via Property::deserialize() and thus need a registered serializer.
+ */
+class PlanningActionServer
+{
+public:
+	using Action = moveit_task_constructor_msgs::PlanTaskAction;
+
+	PlanningActionServer(const TaskTemplate& task_template, const std::string& action_name = "plan_task",
+	                     const ros::NodeHandle& nh = ros::NodeHandle());
+	/// preempt a running goal and shut down the action server
+	~PlanningActionServer();
+
+	PlanningActionServer(const PlanningActionServer&) = delete;
+	PlanningActionServer& operator=(const PlanningActionServer&) = delete;
+
+private:
+	void execute(const moveit_task_constructor_msgs::PlanTaskGoalConstPtr& goal);
+
+	PlanningServer server_;
+	std::atomic<bool> shutdown_{ false };
+	actionlib::SimpleActionServer<Action> action_server_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
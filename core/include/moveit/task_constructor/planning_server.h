@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Plan many requests concurrently on a pool of tasks
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/task.h>
+
+#include <boost/any.hpp>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Serves planning requests concurrently, each one planned by its own Task stamped out from a TaskTemplate
+ *
+ * Tasks are instantiated ahead of time, such that a request only needs to configure the task's properties before
+ * planning. All tasks share the robot model and the pipeline caches of the template. Each request is planned
+ * sequentially by one of the server's worker threads, independently of all other requests.
+ * Build functions of the template are never called concurrently.
+ */
+class PlanningServer
+{
+public:
+	struct Request
+	{
+		std::string name;
+		/// task-level properties configuring the request (e.g. target poses)
+		std::map<std::string, boost::any> properties;
+		size_t max_solutions = 1;
+		/// planning timeout (s) overriding the task's one, if positive
+		double timeout = 0.0;
+		ExecutionPolicy policy = ExecutionPolicy::sequential();
+		/// called from the worker thread for each new solution of the task, while it is still planning
+		Task::SolutionCallback on_solution;
+		/// preempts planning when cancelled, a request cancelled while queued is not planned at all
+		utils::CancellationToken cancellation;
+	};
+
+	struct Result
+	{
+		Task task;  // the planned task, providing access to its solutions
+		moveit::core::MoveItErrorCode error_code;
+		double queue_time = 0.0;  // time (s) waiting for a worker
+		double planning_time = 0.0;  // time (s) spent in Task::plan()
+		double latency = 0.0;  // total time (s) from submission to result
+	};
+
+	/// create num_threads workers (0: number of CPU cores), each one keeping a pre-instantiated task at hand
+	explicit PlanningServer(const TaskTemplate& task_template, size_t num_threads = 0);
+	/// finish running requests, abandoning queued ones (their futures throw std::future_error)
+	~PlanningServer();
+
+	PlanningServer(const PlanningServer&) = delete;
+	PlanningServer& operator=(const PlanningServer&) = delete;
+
+	/// queue a request for planning, its future throws exceptions of instantiating or planning the task
+	std::future<Result> submit(Request request);
+
+	/// number of requests waiting for a worker
+	size_t pending() const;
+	size_t numThreads() const { return workers_.size(); }
+
+private:
+	struct Job
+	{
+		Request request;
+		std::promise<Result> promise;
+		std::chrono::steady_clock::time_point submitted;
+	};
+
+	void work();
+	Task instantiate(const std::string& name);
+
+	const TaskTemplate& template_;
+	std::mutex build_mutex_;  // serializes calls of the template's build function
+
+	std::vector<std::thread> workers_;
+	std::deque<Job> queue_;
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	bool stop_ = false;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,142 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Scoped timers recording the computation time of stages, solvers, and cost terms
+ */
+
+#pragma once
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Collector of timing events recorded by ScopedTimer instances
+ *
+ * Timers are only recorded in threads that have an active Profiler::Context.
+ * Task::plan() activates the task's profiler (if enabled) and containers propagate it to worker threads.
+ * Recorded events can be exported in Chrome's trace event format (chrome://tracing, perfetto)
+ * or as folded stacks for flamegraph.pl.
+ */
+class Profiler
+{
+public:
+	using Clock = std::chrono::steady_clock;
+
+	struct Event
+	{
+		std::string category;
+		std::string name;
+		/// ';'-separated names of all enclosing timers, including this one
+		std::string stack;
+		Clock::time_point start;
+		Clock::duration duration;
+		/// index of the recording thread, in order of appearance
+		size_t thread;
+	};
+
+	/// profiling context of a thread: active profiler and names of currently running timers
+	struct Context
+	{
+		Profiler* profiler = nullptr;
+		std::string stack;
+	};
+
+	/// RAII helper to activate a profiling context in the current thread
+	class Activation
+	{
+	public:
+		explicit Activation(Context context);
+		Activation(Profiler* profiler) : Activation(Context{ profiler, std::string() }) {}
+		~Activation();
+
+	private:
+		Context previous_;
+	};
+
+	/// profiling context of the calling thread
+	static Context& context();
+
+	Profiler() : origin_(Clock::now()) {}
+
+	void record(Event&& event);
+	void clear();
+
+	/// copy of all events recorded so far
+	std::vector<Event> events() const;
+
+	/// write events as JSON in Chrome's trace event format
+	void writeChromeTrace(std::ostream& os) const;
+	/// write folded stacks with self time in microseconds, as consumed by flamegraph.pl
+	void writeFlameGraph(std::ostream& os) const;
+
+private:
+	Clock::time_point origin_;
+	mutable std::mutex mutex_;
+	std::vector<Event> events_;
+	std::unordered_map<std::thread::id, size_t> threads_;
+};
+using ProfilerPtr = std::shared_ptr<Profiler>;
+
+/** Measure the lifetime of this object and record it with the thread's active profiler
+ *
+ * Without an active profiler, the timer doesn't do anything.
+ */
+class ScopedTimer
+{
+public:
+	ScopedTimer(const char* category, const std::string& name);
+	~ScopedTimer();
+
+	ScopedTimer(const ScopedTimer&) = delete;
+	ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+	Profiler* profiler_;
+	const char* category_;
+	size_t stack_size_;
+	Profiler::Clock::time_point start_;
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
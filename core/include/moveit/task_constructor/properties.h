@@ -39,12 +39,16 @@
 #pragma once
 
 #include <boost/any.hpp>
+#include <cstdint>
 #include <typeindex>
+#include <iterator>
 #include <map>
+#include <memory>
 #include <set>
 #include <vector>
 #include <functional>
 #include <sstream>
+#include <type_traits>
 #include <ros/serialization.h>
 
 namespace moveit {
@@ -52,6 +56,8 @@ namespace task_constructor {
 
 class Property;
 class PropertyMap;
+template <typename T>
+class PropertyHandle;
 
 /// initializer function, using given name from the passed property map
 boost::any fromName(const PropertyMap& other, const std::string& other_name);
@@ -69,6 +75,8 @@ boost::any fromName(const PropertyMap& other, const std::string& other_name);
 class Property
 {
 	friend class PropertyMap;
+	template <typename T>
+	friend class PropertyHandle;
 
 	/// typed constructor is only accessible via PropertyMap
 	Property(const boost::typeindex::type_info& type_info, const std::string& description,
@@ -106,14 +114,19 @@ public:
 
 	/// get current value (or default if not defined)
 	inline const boost::any& value() const { return value_.empty() ? default_ : value_; }
-	inline boost::any& value() { return value_.empty() ? default_ : value_; }
+	inline boost::any& value() {
+		serialized_valid_ = false;  // the value might get modified via the returned reference
+		return value_.empty() ? default_ : value_;
+	}
 	/// get default value
 	const boost::any& defaultValue() const { return default_; }
 
 	/// serialize value using registered functions
 	static std::string serialize(const boost::any& value);
 	static boost::any deserialize(const std::string& type_name, const std::string& wire);
-	std::string serialize() const { return serialize(value()); }
+	std::string serialize() const { return serialized(); }
+	/// serialized value(), cached until the value changes (e.g. for repeated task descriptions)
+	const std::string& serialized() const;
 
 	/// get description text
 	const std::string& description() const { return description_; }
@@ -136,10 +149,15 @@ private:
 	boost::any default_;
 	boost::any value_;
 
+	/// cached serialization of value(), invalidated by all modifications
+	mutable std::string serialized_;
+	mutable bool serialized_valid_ = false;
+
 	/// used for external initialization
 	SourceFlags source_flags_ = 0;
 	SourceFlags initialized_from_;
 	InitializerFunction initializer_;
+	std::string source_name_;  // name of the source property, if initialized by name
 };
 
 class Property::error : public std::runtime_error
@@ -252,26 +270,78 @@ private:
  *
  * Conveniency methods are provided to setup property initialization for several
  * properties at once - always inheriting from the identically named external property.
+ *
+ * Copies of a PropertyMap share their properties until they get modified (copy-on-write).
+ * Thus, copying (e.g. along with InterfaceStates) is cheap. Properties are shared individually:
+ * modifying one property doesn't move the others. References to a property remain valid until the property
+ * is modified via this map, or the map is destroyed, reassigned, or moved from (like for a std::map).
+ * Once non-const references were handed out (via declare(), property(), or non-const iteration),
+ * copies of the map don't share its properties anymore, as they could be modified via these references.
  */
 class PropertyMap
 {
-	std::map<std::string, Property> props_;
+	template <typename T>
+	friend class PropertyHandle;
+
+public:
+	using value_type = std::pair<const std::string, Property>;
+
+private:
+	using container_type = std::map<std::string, std::shared_ptr<value_type>>;
+	// properties, shared between copies as a whole and individually, nullptr if empty
+	std::shared_ptr<container_type> props_;
+	// globally unique values, renewed when the addresses of properties change (generation_),
+	// or when properties are added or reconfigured, or the container is replaced (layout_)
+	uint64_t generation_;
+	uint64_t layout_;
+	// whether non-const references to properties were handed out: copies cannot share them
+	bool leaked_ = false;
+	// tracks the lifetime of this map for handles, created on demand
+	struct Anchor
+	{
+		const PropertyMap* map;
+	};
+	mutable std::shared_ptr<Anchor> anchor_;
+
+	static uint64_t nextGeneration();
+	void touch() { generation_ = layout_ = nextGeneration(); }
+
+	/// read-only access to (possibly shared) properties
+	const container_type& props() const;
+	/// write access to the container (not its properties), unsharing it first if needed
+	container_type& mutableProps();
+	/// write access to a property of mutableProps(), unsharing it first if needed
+	Property& mutableProperty(container_type::iterator it);
+	/// unshare all properties, e.g. before handing out references to all of them
+	container_type& unshareAll();
 
 	/// implementation of declare methods
 	Property& declare(const std::string& name, const Property::type_info& type_info, const std::string& description,
 	                  const boost::any& default_value);
+	/// initialize a single property from other, if not yet defined by a higher-priority source
+	static void performInitFrom(const std::string& name, Property& p, Property::SourceFlags source,
+	                            const PropertyMap& other);
 
 public:
+	PropertyMap() { touch(); }
+	PropertyMap(const PropertyMap& other);
+	PropertyMap(PropertyMap&& other) noexcept;
+	PropertyMap& operator=(const PropertyMap& other);
+	PropertyMap& operator=(PropertyMap&& other) noexcept;
+	~PropertyMap();
+
 	/// declare a property for future use
 	template <typename T>
 	Property& declare(const std::string& name, const std::string& description = "") {
 		PropertySerializer<T>();  // register serializer/deserializer
+		leaked_ = true;
 		return declare(name, typeid(T), description, boost::any());
 	}
 	/// declare a property with default value
 	template <typename T>
 	Property& declare(const std::string& name, const T& default_value, const std::string& description = "") {
 		PropertySerializer<T>();  // register serializer/deserializer
+		leaked_ = true;
 		return declare(name, typeid(T), description, default_value);
 	}
 
@@ -286,15 +356,52 @@ public:
 
 	/// get the property with given name, throws Property::undeclared for unknown name
 	Property& property(const std::string& name);
-	const Property& property(const std::string& name) const { return const_cast<PropertyMap*>(this)->property(name); }
-
-	using iterator = std::map<std::string, Property>::iterator;
-	using const_iterator = std::map<std::string, Property>::const_iterator;
+	const Property& property(const std::string& name) const;
 
-	iterator begin() { return props_.begin(); }
-	iterator end() { return props_.end(); }
-	const_iterator begin() const { return props_.begin(); }
-	const_iterator end() const { return props_.end(); }
+	/// resolve a typed handle to the property with given name, throws Property::undeclared or Property::type_error
+	template <typename T>
+	PropertyHandle<T> handle(const std::string& name) const;
+
+	/// iterator over the (name, Property) pairs of the map
+	template <typename Value, typename Base>
+	class Iterator
+	{
+		friend class PropertyMap;
+		Base it_;
+
+		explicit Iterator(Base it) : it_(it) {}
+
+	public:
+		using iterator_category = std::bidirectional_iterator_tag;
+		using value_type = std::remove_const_t<Value>;
+		using difference_type = std::ptrdiff_t;
+		using pointer = Value*;
+		using reference = Value&;
+
+		Iterator() = default;
+
+		reference operator*() const { return *it_->second; }
+		pointer operator->() const { return it_->second.get(); }
+		Iterator& operator++() {
+			++it_;
+			return *this;
+		}
+		Iterator operator++(int) { return Iterator(it_++); }
+		Iterator& operator--() {
+			--it_;
+			return *this;
+		}
+		Iterator operator--(int) { return Iterator(it_--); }
+		bool operator==(const Iterator& other) const { return it_ == other.it_; }
+		bool operator!=(const Iterator& other) const { return it_ != other.it_; }
+	};
+	using iterator = Iterator<value_type, container_type::iterator>;
+	using const_iterator = Iterator<const value_type, container_type::const_iterator>;
+
+	iterator begin();
+	iterator end();
+	const_iterator begin() const { return const_iterator(props().begin()); }
+	const_iterator end() const { return const_iterator(props().end()); }
 
 	/// allow initialization from given source for listed properties - always using the same name
 	void configureInitFrom(Property::SourceFlags source, const std::set<std::string>& properties = {});
@@ -302,11 +409,13 @@ public:
 	/// set (and, if neccessary, declare) the value of a property
 	template <typename T>
 	void set(const std::string& name, const T& value) {
-		auto it = props_.find(name);
-		if (it == props_.end())  // name is not yet declared
-			declare<T>(name, value, "");
-		else
-			it->second.setValue(value);
+		auto& props = mutableProps();
+		auto it = props.find(name);
+		if (it == props.end()) {  // name is not yet declared
+			PropertySerializer<T>();  // register serializer/deserializer
+			declare(name, typeid(T), "", value);
+		} else
+			mutableProperty(it).setValue(value);
 	}
 
 	/// overloading: const char* is stored as std::string
@@ -341,11 +450,139 @@ public:
 
 	/// perform initialization of still undefined properties using configured initializers
 	void performInitFrom(Property::SourceFlags source, const PropertyMap& other);
+
+	/** Properties configured for initialization from a given source, precomputed for repeated initialization
+	 *
+	 * A plan refers to the properties of its map. It becomes outdated (and performInitFrom() falls back to
+	 * a full initialization) if the map gets copied or properties are declared or (re)configured afterwards.
+	 */
+	class InitPlan
+	{
+		friend class PropertyMap;
+		Property::SourceFlags source_ = 0;
+		uint64_t layout_ = 0;  // layout of the map the plan was computed for
+		std::vector<container_type::iterator> entries_;
+
+	public:
+		size_t size() const { return entries_.size(); }
+	};
+	/// precompute the properties to initialize from source
+	InitPlan initPlan(Property::SourceFlags source);
+	/// perform initialization as planned, only visiting the planned properties
+	void performInitFrom(const InitPlan& plan, const PropertyMap& other);
 };
 
+/** Typed handle to a Property, providing fast access to its value without looking up its name
+ *
+ * Resolve handles once, e.g. in Stage::init(), via PropertyMap::handle<T>(name), and use them in hot code,
+ * e.g. in compute(). A handle follows its PropertyMap: if properties were copied into the map or
+ * (re)declared since the last access, the property is looked up again. Accessing a handle whose map was
+ * destroyed throws Property::undeclared. Like the map itself, handles are not thread-safe.
+ */
+template <typename T>
+class PropertyHandle
+{
+	friend class PropertyMap;
+
+	std::string name_;
+	std::shared_ptr<const PropertyMap::Anchor> anchor_;
+	// property resolved for the given generation of the map
+	mutable const Property* property_ = nullptr;
+	mutable uint64_t generation_ = 0;
+	mutable bool exact_type_ = false;  // declared type is T, not boost::any: values were type-checked when set
+
+	PropertyHandle(const std::string& name, std::shared_ptr<const PropertyMap::Anchor> anchor)
+	  : name_(name), anchor_(std::move(anchor)) {
+		resolve();
+	}
+
+	const Property& resolve() const {
+		const PropertyMap* map = anchor_->map;
+		if (!map)
+			throw Property::undeclared(name_, "property map was destroyed");
+		if (map->generation_ != generation_) {
+			const Property& p = map->property(name_);
+			if (p.type_info_ != typeid(T) && p.type_info_ != typeid(boost::any))
+				throw Property::type_error(typeid(T).name(), p.type_info_.name());
+			property_ = &p;
+			exact_type_ = p.type_info_ == typeid(T);
+			generation_ = map->generation_;
+		}
+		return *property_;
+	}
+
+public:
+	PropertyHandle() = default;
+
+	/// was the handle resolved?
+	explicit operator bool() const { return anchor_ != nullptr; }
+
+	const std::string& name() const { return name_; }
+	const Property& property() const { return resolve(); }
+
+	/// Get typed value of property. Throws undefined.
+	const T& get() const {
+		const boost::any& value = resolve().value();
+		if (value.empty())
+			throw Property::undefined(name_);
+		return exact_type_ ? *boost::unsafe_any_cast<T>(&value) : boost::any_cast<const T&>(value);
+	}
+	/// get typed value of property, using fallback if undefined
+	const T& get(const T& fallback) const {
+		const boost::any& value = resolve().value();
+		if (value.empty())
+			return fallback;
+		return exact_type_ ? *boost::unsafe_any_cast<T>(&value) : boost::any_cast<const T&>(value);
+	}
+};
+
+template <typename T>
+PropertyHandle<T> PropertyMap::handle(const std::string& name) const {
+	if (!anchor_)
+		anchor_ = std::make_shared<Anchor>(Anchor{ this });
+	return PropertyHandle<T>(name, anchor_);
+}
+
 // boost::any needs a specialization to avoid infinite recursion
 template <>
 void PropertyMap::set<boost::any>(const std::string& name, const boost::any& value);
 
+/** Property declared as a typed member of a stage class
+ *
+ * The property is declared in the given PropertyMap (usually the stage's properties()) on construction.
+ * Reading its value is direct typed access, without name lookup or RTTI check. The string-keyed PropertyMap
+ * remains the facade for introspection, Python, and property initialization from parent or interface.
+ */
+template <typename T>
+class TypedProperty
+{
+	PropertyMap& map_;
+	PropertyHandle<T> handle_;
+
+public:
+	TypedProperty(PropertyMap& map, const std::string& name, const std::string& description = "") : map_(map) {
+		map_.declare<T>(name, description);
+		handle_ = map_.handle<T>(name);
+	}
+	TypedProperty(PropertyMap& map, const std::string& name, const T& default_value,
+	              const std::string& description = "")
+	  : map_(map) {
+		map_.declare<T>(name, default_value, description);
+		handle_ = map_.handle<T>(name);
+	}
+	TypedProperty(const TypedProperty&) = delete;
+	TypedProperty& operator=(const TypedProperty&) = delete;
+
+	const std::string& name() const { return handle_.name(); }
+	const Property& property() const { return handle_.property(); }
+
+	/// Get typed value of property. Throws undefined.
+	const T& get() const { return handle_.get(); }
+	/// get typed value of property, using fallback if undefined
+	const T& get(const T& fallback) const { return handle_.get(fallback); }
+	/// set value of property
+	void set(const T& value) { map_.set(handle_.name(), value); }
+};
+
 }  // namespace task_constructor
 }  // namespace moveit
@@ -0,0 +1,122 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Precomputed reachability map of an ik frame for fast pre-screening of IK targets
+ */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <Eigen/Geometry>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotModel);
+}
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+MOVEIT_CLASS_FORWARD(ReachabilityMap);
+
+/** Voxel grid scoring the reachability of positions and approach directions of an ik frame
+ *
+ * The map is generated offline by forward kinematics of randomly sampled joint configurations of a group.
+ * Each voxel stores how often it was reached (normalized to the most frequently reached voxel)
+ * and the set of reached directions of the frame's z-axis (±x, ±y, ±z).
+ * Poses are expressed w.r.t. the robot's root link. The map is only valid for the frame it was generated for,
+ * i.e. for the given link and offset.
+ *
+ * A saved map is memory-mapped when loaded, such that loading is instantaneous and the data is
+ * shared between processes. Queries are lock-free and thread-safe.
+ * As the map is sampled, a zero score doesn't guarantee unreachability: choose resolution and samples accordingly.
+ */
+class ReachabilityMap
+{
+public:
+	/// generate a map for the given frame, which is rigidly attached to link, by sampling random configurations
+	static ReachabilityMapPtr generate(const moveit::core::RobotModelConstPtr& robot_model, const std::string& group,
+	                                   const std::string& link,
+	                                   const Eigen::Isometry3d& offset = Eigen::Isometry3d::Identity(),
+	                                   double resolution = 0.05, size_t samples = 1000000, uint32_t seed = 0);
+	/// memory-map a map previously saved with save(), throws std::runtime_error on failure
+	static ReachabilityMapConstPtr load(const std::string& filename);
+	/// write the map to a file
+	void save(const std::string& filename) const;
+
+	~ReachabilityMap();
+	ReachabilityMap(const ReachabilityMap&) = delete;
+	ReachabilityMap& operator=(const ReachabilityMap&) = delete;
+
+	/// reachability score of pose (w.r.t. the root link) in [0, 1], 0: not reached during sampling
+	double score(const Eigen::Isometry3d& pose) const;
+
+	const std::string& robotName() const { return robot_name_; }
+	const std::string& group() const { return group_; }
+	const std::string& link() const { return link_; }
+	/// pose of the frame w.r.t. link
+	const Eigen::Isometry3d& offset() const { return offset_; }
+	double resolution() const { return resolution_; }
+
+	/// map generated for the given robot, group, and frame (offset w.r.t. link, compared with 1e-6 tolerance)?
+	bool matches(const std::string& robot_name, const std::string& group, const std::string& link,
+	             const Eigen::Isometry3d& offset) const;
+
+private:
+	ReachabilityMap() = default;
+
+	std::string robot_name_;
+	std::string group_;
+	std::string link_;
+	Eigen::Isometry3d offset_ = Eigen::Isometry3d::Identity();
+	double resolution_ = 0.0;
+	Eigen::Vector3d origin_ = Eigen::Vector3d::Zero();  // lower corner of the grid
+	uint32_t size_[3] = { 0, 0, 0 };
+
+	// per voxel: score (0..255) followed by the direction mask, either in storage_ or memory-mapped
+	std::vector<uint8_t> storage_;
+	const uint8_t* data_ = nullptr;
+	void* mapping_ = nullptr;
+	size_t mapping_size_ = 0;
+};
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
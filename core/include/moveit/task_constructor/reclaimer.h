@@ -0,0 +1,111 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+/* Desc:    Background thread destroying retired objects off the critical path
+ */
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Destroys retired objects in a background thread.
+ *
+ * Tearing down large planning graphs (states, scenes, trajectories) can take considerable time.
+ * Handing them to retire() instead returns immediately. Objects are destroyed in the order of retirement.
+ * The thread is only started with the first retired object. The destructor waits for all objects to be destroyed.
+ */
+class Reclaimer
+{
+public:
+	Reclaimer() = default;
+	~Reclaimer();
+
+	Reclaimer(const Reclaimer&) = delete;
+	Reclaimer& operator=(const Reclaimer&) = delete;
+
+	/** process-wide instance, used by Task::setBackgroundTeardown()
+	 *
+	 * It is never destroyed, such that it remains usable during static destruction. Thus, objects still pending
+	 * at exit are not destroyed: call wait() before, if their destructors need to run.
+	 */
+	static Reclaimer& global();
+
+	/// take ownership of (moved) garbage and destroy it in the background
+	template <typename T>
+	void retire(T&& garbage) {
+		push(std::make_unique<Holder<std::decay_t<T>>>(std::forward<T>(garbage)));
+	}
+
+	/// block until all objects retired so far were destroyed
+	void wait();
+	/// number of retired objects not yet destroyed
+	size_t pending() const;
+
+private:
+	struct Garbage
+	{
+		virtual ~Garbage() = default;
+	};
+	template <typename T>
+	struct Holder : Garbage
+	{
+		explicit Holder(T&& value) : value(std::move(value)) {}
+		T value;
+	};
+
+	void push(std::unique_ptr<Garbage> garbage);
+	void work();
+
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;  // signals new garbage (or stop_) to the worker
+	std::condition_variable done_cv_;  // signals progress to wait()
+	std::deque<std::unique_ptr<Garbage>> queue_;
+	size_t pending_ = 0;  // queued plus currently destroyed objects
+	bool stop_ = false;
+	std::thread worker_;
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,117 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Recycling of RobotState instances for trajectory waypoints
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/arena.h>
+#include <moveit/macros/class_forward.h>
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace moveit {
+namespace core {
+MOVEIT_CLASS_FORWARD(RobotModel);
+MOVEIT_CLASS_FORWARD(RobotState);
+}  // namespace core
+}  // namespace moveit
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+class RobotStatePool;
+using RobotStatePoolPtr = std::shared_ptr<RobotStatePool>;
+
+/** Pool of RobotState instances of a single robot model, to be used as trajectory waypoints
+ *
+ * Each RobotState allocates its own buffer for positions, velocities, accelerations, and transforms.
+ * Trajectories of thousands of waypoints thus cause thousands of allocations, which are avoided by recycling
+ * released states: copy() assigns to a previously released state instead of constructing a new one.
+ * The control blocks of the returned shared pointers are taken from an Arena, too.
+ *
+ * Returned states keep their pool alive. Released states are kept up to capacity() for reuse.
+ * To not hold on to the states of a long-gone burst, e.g. a single huge trajectory, the pool calls shrink()
+ * about once per second while it is used.
+ * All methods are thread-safe.
+ */
+class RobotStatePool : public std::enable_shared_from_this<RobotStatePool>
+{
+public:
+	/// pool of the given model, shared by all callers while any of them (or any of its states) is alive
+	static RobotStatePoolPtr get(const moveit::core::RobotModelConstPtr& robot_model);
+
+	~RobotStatePool();
+	RobotStatePool(const RobotStatePool&) = delete;
+	RobotStatePool& operator=(const RobotStatePool&) = delete;
+
+	/// copy of state (which needs to belong to the pool's model), recycling a released state if possible
+	moveit::core::RobotStatePtr copy(const moveit::core::RobotState& state);
+
+	/// maximum number of released states kept for reuse
+	void setCapacity(size_t capacity);
+	size_t capacity() const;
+	/// number of released states available for reuse
+	size_t available() const;
+	/// delete all released states
+	void clear();
+	/// delete released states that were not reused since the previous shrink()
+	void shrink();
+
+private:
+	struct Recycler;
+	RobotStatePool(const moveit::core::RobotModel* robot_model);
+	void release(moveit::core::RobotState* state) noexcept;
+	/// move released states not reused since the last shrink into excess, requires mutex_ to be locked
+	void shrink(std::vector<moveit::core::RobotState*>& excess);
+	/// shrink() if the last time was long enough ago, requires mutex_ to be locked
+	void shrinkPeriodically(std::vector<moveit::core::RobotState*>& excess);
+
+	const moveit::core::RobotModel* robot_model_;  // identity of the model only: states keep the model alive
+	ArenaPtr arena_;  // for control blocks
+	mutable std::mutex mutex_;
+	std::vector<moveit::core::RobotState*> free_;  // recently released states at the back
+	size_t capacity_ = 1000;
+	size_t unused_ = 0;  // number of states at the front of free_ that weren't reused since the last shrink
+	std::chrono::steady_clock::time_point last_shrink_ = std::chrono::steady_clock::now();
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
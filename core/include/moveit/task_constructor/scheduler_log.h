@@ -0,0 +1,215 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Binary ring-buffer log of scheduling decisions during Task::plan()
+ */
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+class Stage;
+class InterfaceState;
+
+namespace utils {
+
+/** Log of scheduling decisions for offline tuning of scheduling policies
+ *
+ * For each compute() of a stage, a fixed-size record stores the Task::plan() iteration, the job taken (generation,
+ * the top start or end state of a propagating stage, or a pending pair of a connecting stage), its duration and the
+ * number of new solutions and failures. Additionally, status changes of all states that were taken as jobs are
+ * recorded, such that computations of branches pruned later on can be identified.
+ *
+ * Records are stored in a ring buffer of fixed capacity, overwriting the oldest ones once it is full.
+ * Only threads with an active log record (via Activation), which Task::plan() does for its planning thread.
+ * Stages computed in worker threads of parallel containers are not recorded.
+ */
+class SchedulerLog
+{
+public:
+	using Clock = std::chrono::steady_clock;
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 16;
+
+	enum Kind : uint8_t
+	{
+		GENERATE,  // compute() of a generator
+		FORWARD,  // propagation of the top start state
+		BACKWARD,  // propagation of the top end state
+		CONNECT,  // connection of the top pending pair
+		CONTAINER,  // compute() of a container, enclosing the records of its children
+		STATUS  // status change of a state taken as job before
+	};
+
+	/// fixed-size record, written to file as is
+	struct Record
+	{
+		uint64_t iteration;  // Task::plan() iteration
+		uint64_t time;  // start of compute or time of status change, in ns since creation of the log
+		uint64_t duration;  // of compute, in ns
+		uint32_t stage;  // index into stageNames()
+		uint32_t states[2];  // ids of the job's start and end state, 0 if none
+		uint16_t solutions;  // number of new solutions, saturated
+		uint16_t failures;  // number of new failures, saturated
+		uint8_t kind;
+		uint8_t status;  // STATUS: new InterfaceState::Status
+		uint8_t depth;  // nesting depth of compute() calls
+		uint8_t padding[5];
+	};
+	static_assert(sizeof(Record) == 48, "Record layout is part of the file format");
+
+	/// accumulated records of a stage, see summarize()
+	struct StageSummary
+	{
+		std::string stage;
+		bool container = false;
+		size_t computes = 0;
+		double time = 0.0;  // seconds
+		size_t solutions = 0;
+		size_t failures = 0;
+		/// computes whose job states were pruned (or not re-enabled) at the end of the log
+		size_t wasted_computes = 0;
+		double wasted_time = 0.0;
+	};
+
+	/// RAII helper to activate a log in the current thread
+	class Activation
+	{
+	public:
+		explicit Activation(SchedulerLog* log);
+		~Activation();
+		Activation(const Activation&) = delete;
+		Activation& operator=(const Activation&) = delete;
+
+	private:
+		SchedulerLog* previous_;
+	};
+
+	/** RAII helper recording a compute() of stage with the log of the current thread, if any
+	 *
+	 * The job is GENERATE (or CONTAINER for containers) unless specified via job().
+	 */
+	class Compute
+	{
+	public:
+		explicit Compute(const Stage& stage);
+		~Compute();
+		Compute(const Compute&) = delete;
+		Compute& operator=(const Compute&) = delete;
+
+		/// number of solutions and failures created
+		void finish(size_t solutions, size_t failures);
+
+	private:
+		friend class SchedulerLog;
+		SchedulerLog* log_;
+		Compute* parent_;
+		Record record_;
+		Clock::time_point start_;
+	};
+
+	explicit SchedulerLog(size_t capacity = DEFAULT_CAPACITY);
+	~SchedulerLog();
+
+	/// log of the calling thread
+	static SchedulerLog* current();
+
+	/// specify the job taken by the innermost Compute of the current thread
+	static void job(Kind kind, const InterfaceState* start, const InterfaceState* end = nullptr);
+	/// record the status change of state, if it was taken as job before
+	static void status(const InterfaceState* state, unsigned int status);
+	/// forget a destroyed state in all logs (from any thread), such that a new state at its address gets a new id
+	static void released(const InterfaceState* state);
+
+	/// start a new Task::plan() iteration
+	void nextIteration();
+	/// forget the identity of all states, e.g. when they are released: new states always get new ids
+	void forgetStates();
+
+	size_t capacity() const { return capacity_; }
+	/// number of records stored
+	size_t size() const;
+	/// number of records overwritten since the last clear()
+	size_t dropped() const;
+	void clear();
+
+	/// copy of all stored records, oldest first
+	std::vector<Record> records() const;
+	/// names of stages referenced by records
+	std::vector<std::string> stageNames() const;
+
+	/// write the log to a binary file
+	void save(const std::string& path) const;
+	/// replace the log by the records of a binary file, throws std::runtime_error on failure
+	void load(const std::string& path);
+
+	/// accumulate records per stage, in order of first appearance
+	std::vector<StageSummary> summarize() const;
+	/// write summarize() as a table, highlighting compute time spent on pruned branches
+	void writeSummary(std::ostream& os) const;
+
+private:
+	void append(const Record& record);
+	uint32_t stageIndex(const Stage& stage);
+	uint32_t stateId(const InterfaceState* state);
+
+	const Clock::time_point origin_;
+	mutable std::mutex mutex_;
+	size_t capacity_;
+	std::vector<Record> records_;
+	size_t head_ = 0;  // position of the oldest record, once the buffer is full
+	size_t dropped_ = 0;
+	uint64_t iteration_ = 0;
+
+	std::vector<std::string> stage_names_;
+	std::unordered_map<const Stage*, uint32_t> stages_;
+	std::unordered_map<const InterfaceState*, uint32_t> states_;
+	uint32_t next_state_id_ = 1;
+};
+using SchedulerLogPtr = std::shared_ptr<SchedulerLog>;
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
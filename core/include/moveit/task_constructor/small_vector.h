@@ -0,0 +1,132 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Vector with inline storage for a few trivially copyable elements
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Vector storing up to N elements inline, only allocating heap memory if it grows beyond
+ *
+ * Restricted to trivially copyable elements, e.g. pointers.
+ * Iterators are invalidated by any modification.
+ */
+template <typename T, size_t N = 2>
+class SmallVector
+{
+	static_assert(std::is_trivially_copyable<T>::value, "SmallVector only supports trivially copyable types");
+
+public:
+	using value_type = T;
+	using iterator = T*;
+	using const_iterator = const T*;
+
+	SmallVector() = default;
+	SmallVector(const SmallVector& other) { *this = other; }
+	SmallVector& operator=(const SmallVector& other) {
+		size_ = other.size_;
+		heap_ = other.heap_;
+		std::copy(other.inline_, other.inline_ + std::min(size_, N), inline_);
+		return *this;
+	}
+
+	bool empty() const { return size_ == 0; }
+	size_t size() const { return size_; }
+
+	T* begin() { return size_ <= N ? inline_ : heap_.data(); }
+	T* end() { return begin() + size_; }
+	const T* begin() const { return size_ <= N ? inline_ : heap_.data(); }
+	const T* end() const { return begin() + size_; }
+
+	T& operator[](size_t i) { return begin()[i]; }
+	const T& operator[](size_t i) const { return begin()[i]; }
+	T& front() { return *begin(); }
+	const T& front() const { return *begin(); }
+	T& back() { return end()[-1]; }
+	const T& back() const { return end()[-1]; }
+
+	void push_back(const T& value) {
+		if (size_ < N)
+			inline_[size_] = value;
+		else {
+			if (size_ == N)  // spill inline elements to the heap
+				heap_.assign(inline_, inline_ + N);
+			heap_.push_back(value);
+		}
+		++size_;
+	}
+	void pop_back() { erase(end() - 1, end()); }
+
+	/// erase range [first, last), returning an iterator to the element following the erased ones
+	T* erase(const T* first, const T* last) {
+		const size_t pos = first - begin();
+		const size_t count = last - first;
+		assert(pos + count <= size_);
+		if (size_ <= N)
+			std::copy(inline_ + pos + count, inline_ + size_, inline_ + pos);
+		else {
+			heap_.erase(heap_.begin() + pos, heap_.begin() + pos + count);
+			if (heap_.size() <= N) {  // move back to inline storage
+				std::copy(heap_.begin(), heap_.end(), inline_);
+				heap_.clear();
+			}
+		}
+		size_ -= count;
+		return begin() + pos;
+	}
+	T* erase(const T* pos) { return erase(pos, pos + 1); }
+
+	void clear() {
+		size_ = 0;
+		heap_.clear();
+	}
+
+private:
+	T inline_[N];
+	size_t size_ = 0;
+	std::vector<T> heap_;  // holds all elements once size_ > N
+};
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
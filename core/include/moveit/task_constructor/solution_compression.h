@@ -0,0 +1,77 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Compact encoding of Solution messages for remote introspection
+ */
+
+#pragma once
+
+#include <moveit_task_constructor_msgs/Solution.h>
+#include <moveit_task_constructor_msgs/CompressedSolution.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Options for compressing Solution messages
+ *
+ * Trajectory values are quantized to multiples of resolution and stored as (small) differences between
+ * consecutive waypoints. Markers occurring multiple times within a solution are stored once. Joint values
+ * of scene diffs that didn't change w.r.t. the previous scene are dropped. The result is zlib-compressed.
+ */
+struct SolutionCompression
+{
+	/// quantization step of positions, velocities, accelerations, and efforts (0: store trajectories exactly)
+	double resolution = 1e-5;
+	/// quantization step of waypoint times in seconds (0: store trajectories exactly)
+	double time_resolution = 1e-4;
+	/// zlib compression level: 1 (fast) .. 9 (best), -1: zlib's default
+	int level = -1;
+};
+
+/// encode msg into compressed
+void compress(const moveit_task_constructor_msgs::Solution& msg,
+              moveit_task_constructor_msgs::CompressedSolution& compressed, const SolutionCompression& options = {});
+
+/** decode compressed into msg
+ *
+ * Scene diffs are only complete when applied in sequence, starting from the start scene.
+ * Throws std::runtime_error if compressed is malformed.
+ */
+void decompress(const moveit_task_constructor_msgs::CompressedSolution& compressed,
+                moveit_task_constructor_msgs::Solution& msg);
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,109 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Reuse solutions of repetitive tasks
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/task.h>
+#include <moveit_task_constructor_msgs/Solution.h>
+
+#include <mutex>
+#include <unordered_map>
+
+namespace moveit {
+namespace task_constructor {
+
+/** Library of solutions of a repetitive task, keyed on the task's inputs
+ *
+ * The key comprises the task's name, the names and configured properties (e.g. goals) of the task and all of
+ * its stages, as well as the start scene: its world objects and robot state, quantized to the library's resolution.
+ * Property values, which are neither serializable nor joint maps, only contribute their type.
+ * plan() re-validates a stored solution
+ * in the current scene before returning it, such that changes not covered by the key are caught.
+ * Only if there is no valid solution, the task is planned and its best solution stored.
+ */
+class SolutionLibrary
+{
+public:
+	/// joint values (rad, m) and object poses are distinguished with the given resolution
+	SolutionLibrary(double resolution = 1e-3);
+
+	/// key of the task's inputs, when planning from scene
+	size_t key(const Task& task, const planning_scene::PlanningScene& scene) const;
+
+	/** provide a solution of task, valid in scene
+	 *
+	 * scene needs to be the scene the task starts from, e.g. the one monitored by move_group.
+	 * Returns the error code of Task::plan() if no stored solution is valid and planning fails.
+	 */
+	moveit::core::MoveItErrorCode plan(Task& task, const planning_scene::PlanningScene& scene,
+	                                   moveit_task_constructor_msgs::Solution& solution);
+
+	/** check whether solution is executable in scene
+	 *
+	 * The solution needs to start from the scene's robot state and all of its trajectories need to be collision-free
+	 * when applying the solution's scene diffs in sequence.
+	 */
+	bool validate(const moveit_task_constructor_msgs::Solution& solution,
+	              const planning_scene::PlanningScene& scene) const;
+
+	/// store solution for key, replacing a previous one
+	void insert(size_t key, const moveit_task_constructor_msgs::Solution& solution);
+	/// retrieve solution stored for key, returns false if there is none
+	bool find(size_t key, moveit_task_constructor_msgs::Solution& solution) const;
+	size_t size() const;
+	void clear();
+
+	/// write all solutions to a utils::SolutionStore file
+	void save(const std::string& path) const;
+	/// add all solutions of a file written by save()
+	void load(const std::string& path);
+
+	/// number of lookups answered by a valid stored solution
+	size_t hits() const;
+	/// number of lookups requiring to plan
+	size_t misses() const;
+
+private:
+	const double resolution_;
+
+	mutable std::mutex mutex_;
+	std::unordered_map<size_t, moveit_task_constructor_msgs::Solution> solutions_;
+	size_t hits_ = 0;
+	size_t misses_ = 0;
+};
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,140 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Binary file format to archive and replay solutions
+ */
+
+#pragma once
+
+#include <moveit_task_constructor_msgs/Solution.h>
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Binary file of serialized Solution messages
+ *
+ * Layout (native byte order):
+ * - header: magic "MTCSOLS" (8 bytes incl. terminating zero), uint32 version, uint32 reserved
+ * - records: serialized Solution messages, each starting at an 8-byte aligned offset
+ * - index: one Entry per record, 8-byte aligned
+ * - footer: uint64 offset of the index, uint64 number of entries
+ *
+ * Hence, the index is located from the end of the file and any record can be read directly from a memory map.
+ */
+namespace solution_store {
+constexpr char MAGIC[8] = "MTCSOLS";
+constexpr uint32_t VERSION = 1;
+
+struct Header
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t reserved;
+};
+
+struct Entry
+{
+	uint64_t offset;  ///< file offset of the record
+	uint64_t id;  ///< user-defined id, e.g. the introspection id or a SolutionLibrary key
+	uint32_t size;  ///< size of the record
+	uint32_t reserved;
+	double cost;
+};
+
+struct Footer
+{
+	uint64_t index_offset;
+	uint64_t count;
+};
+}  // namespace solution_store
+
+/// Sequentially write solutions to a solution store file, finalized by close() or destruction
+class SolutionStoreWriter
+{
+public:
+	/// create (or overwrite) file at path, throws std::runtime_error on failure
+	SolutionStoreWriter(const std::string& path);
+	SolutionStoreWriter(const SolutionStoreWriter&) = delete;
+	~SolutionStoreWriter();
+
+	/// append a solution
+	void add(const moveit_task_constructor_msgs::Solution& msg, double cost, uint64_t id = 0);
+	size_t size() const { return index_.size(); }
+
+	/// write the index, making the file readable
+	void close();
+
+private:
+	void pad();
+	/// current write position, throws std::runtime_error if writing failed
+	uint64_t offset();
+
+	std::ofstream file_;
+	std::vector<solution_store::Entry> index_;
+	std::vector<uint8_t> buffer_;
+};
+
+/// Read-only access to a solution store file via a memory map
+class SolutionStore
+{
+public:
+	/// map file at path, throws std::runtime_error if it cannot be read or is not a valid solution store
+	SolutionStore(const std::string& path);
+	SolutionStore(const SolutionStore&) = delete;
+	~SolutionStore();
+
+	size_t size() const { return count_; }
+	double cost(size_t i) const { return entry(i).cost; }
+	uint64_t id(size_t i) const { return entry(i).id; }
+
+	/// deserialize i-th solution
+	void load(size_t i, moveit_task_constructor_msgs::Solution& msg) const;
+
+private:
+	const solution_store::Entry& entry(size_t i) const;
+
+	uint8_t* data_ = nullptr;
+	size_t length_ = 0;
+	const solution_store::Entry* index_ = nullptr;
+	size_t count_ = 0;
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
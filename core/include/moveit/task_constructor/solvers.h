@@ -41,3 +41,4 @@
 #include "solvers/cartesian_path.h"
 #include "solvers/joint_interpolation.h"
 #include "solvers/pipeline_planner.h"
+#include "solvers/roadmap_planner.h"
@@ -0,0 +1,131 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    meta planner, caching trajectories of a wrapped planner
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(CachingPlanner);
+
+/** A meta planner caching joint-space trajectories found by a wrapped planner
+ *
+ * Trajectories are cached by the quantized joint positions of the planned group at start and goal,
+ * and by a hash of the collision world. Before a cached trajectory is returned, it's validated in the current scene:
+ * all joints outside the planned group are taken from the actual start state, the end points are snapped to
+ * the exact start and goal positions, and the path is checked for collisions and path constraints.
+ * Invalid hits fall back to the wrapped planner. Cartesian planning requests are not cached.
+ *
+ * In warm-start mode, the cache survives init() (and thus replanning a reset Task) and ignores the collision world
+ * in its keys. After small scene changes, e.g. a moved object, all cached trajectories that are still collision-free
+ * are reused and only the ones affected by the change are planned again.
+ */
+class CachingPlanner : public PlannerInterface
+{
+public:
+	CachingPlanner(const PlannerInterfacePtr& planner);
+
+	const PlannerInterfacePtr& planner() const { return planner_; }
+
+	void setResolution(double resolution) { setProperty("resolution", resolution); }
+	void setMaxEntries(uint32_t max_entries) { setProperty("max_entries", max_entries); }
+	void setWarmStart(bool warm_start) { setProperty("warm_start", warm_start); }
+
+	/// init wrapped planner and clear cache (unless warm-starting with the same robot model)
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	/// cached trajectories are stored as returned by the wrapped planner
+	Timing deferredTiming() const override { return planner_->deferredTiming(); }
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	void clear();
+	size_t size() const;
+	/// number of planning requests served from the cache
+	size_t hits() const;
+	/// number of planning requests passed to the wrapped planner
+	size_t misses() const;
+
+private:
+	struct Key
+	{
+		const moveit::core::JointModelGroup* jmg;
+		std::vector<long> from;  // quantized joint positions
+		std::vector<long> to;
+		size_t world_hash;
+
+		bool operator==(const Key& other) const {
+			return jmg == other.jmg && world_hash == other.world_hash && from == other.from && to == other.to;
+		}
+	};
+	struct KeyHash
+	{
+		size_t operator()(const Key& key) const;
+	};
+	using Entry = std::pair<Key, robot_trajectory::RobotTrajectoryConstPtr>;
+
+	Key makeKey(const planning_scene::PlanningScene& from, const planning_scene::PlanningScene& to,
+	            const moveit::core::JointModelGroup* jmg) const;
+	robot_trajectory::RobotTrajectoryConstPtr lookup(const Key& key);
+	void store(Key&& key, const robot_trajectory::RobotTrajectory& trajectory);
+
+	PlannerInterfacePtr planner_;
+	moveit::core::RobotModelConstPtr robot_model_;  // model of cached trajectories
+
+	mutable std::mutex mutex_;
+	std::list<Entry> entries_;  // most recently used first
+	std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> index_;
+	size_t hits_ = 0;
+	size_t misses_ = 0;
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
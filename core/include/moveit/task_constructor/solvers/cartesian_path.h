@@ -40,14 +40,19 @@
 
 #include <moveit/task_constructor/solvers/planner_interface.h>
 
+#include <mutex>
+
 namespace moveit {
 namespace task_constructor {
+namespace utils {
+class ThreadPool;
+}
 namespace solvers {
 
 MOVEIT_CLASS_FORWARD(CartesianPath);
 
 /** Use MoveIt's computeCartesianPath() to generate a straigh-line path between to scenes */
-class CartesianPath : public PlannerInterface
+class CartesianPath : public WaypointPlanner
 {
 public:
 	CartesianPath();
@@ -56,13 +61,25 @@ public:
 	void setJumpThreshold(double jump_threshold) { setProperty("jump_threshold", jump_threshold); }
 	void setMinFraction(double min_fraction) { setProperty("min_fraction", min_fraction); }
 
+	/** Split the path into the given number of segments, whose waypoints are solved concurrently
+	 *
+	 * Each segment is solved sequentially, seeded from the start state. Segments are stitched in order:
+	 * if the first waypoint of a segment jumps w.r.t. the preceding one, the segment is solved again,
+	 * seeded from the end of the preceding segment. Requires a thread-safe kinematics solver.
+	 */
+	void setSegments(size_t segments) { setProperty("segments", segments); }
+	/** Adaptively refine the step size down to min_step_size where the joint-space motion jumps
+	 *
+	 * Waypoints are inserted by bisection only where the jump_threshold is exceeded.
+	 * Thus, a coarse step_size can be used for smooth parts of the path.
+	 */
+	void setMinStepSize(double min_step_size) { setProperty("min_step_size", min_step_size); }
+
 	[[deprecated("Replace with setMaxVelocityScalingFactor")]]  // clang-format off
 	void setMaxVelocityScaling(double factor) { setMaxVelocityScalingFactor(factor); }
 	[[deprecated("Replace with setMaxAccelerationScalingFactor")]]  // clang-format off
 	void setMaxAccelerationScaling(double factor) { setMaxAccelerationScalingFactor(factor); }
 
-	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
-
 	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
 	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
 	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
@@ -71,6 +88,12 @@ public:
 	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
 	            double timeout, robot_trajectory::RobotTrajectoryPtr& result,
 	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+private:
+	std::shared_ptr<utils::ThreadPool> threadPool(size_t num_threads);
+
+	std::shared_ptr<utils::ThreadPool> thread_pool_;
+	std::mutex thread_pool_mutex_;
 };
 }  // namespace solvers
 }  // namespace task_constructor
@@ -0,0 +1,140 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    meta planner, recording statistics of a wrapped planner's calls
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+#include <moveit/task_constructor/histogram.h>
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(InstrumentedPlanner);
+
+/** A meta planner recording latency, outcome, and trajectory size of each call to a wrapped planner
+ *
+ * Each call is traced with a utils::ScopedTimer (category "planning", named after this planner),
+ * such that profiles distinguish the time spent in the wrapped planner from the remaining compute() time
+ * of the calling stage. Accumulated statistics are reported by MetricsPublisher::addPlanner(),
+ * individual calls can be observed via a callback.
+ */
+class InstrumentedPlanner : public PlannerInterface
+{
+public:
+	/// outcome of a single planning call
+	struct Call
+	{
+		bool cartesian;
+		bool success;
+		std::string message;
+		/// wall time (s) spent in the wrapped planner
+		double latency;
+		size_t waypoints;
+		/// joint-space length of the trajectory in the planned group
+		double path_length;
+		/// duration (s) of the trajectory, 0 if untimed
+		double duration;
+	};
+	/// statistics accumulated since the last clear()
+	struct Statistics
+	{
+		size_t calls = 0;
+		size_t successes = 0;
+		utils::LatencyHistogram latency;
+		/// number of failures per failure message
+		std::map<std::string, size_t> failures;
+		size_t waypoints = 0;
+		double path_length = 0.0;
+	};
+	using CallCallback = std::function<void(const Call& call)>;
+
+	/// name defaults to the wrapped planner's class name
+	InstrumentedPlanner(const PlannerInterfacePtr& planner, const std::string& name = "");
+
+	const PlannerInterfacePtr& planner() const { return planner_; }
+	const std::string& name() const { return name_; }
+
+	/// called after each planning call, from the planning thread
+	void setCallCallback(const CallCallback& cb) { call_cb_ = cb; }
+
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	Timing deferredTiming() const override { return planner_->deferredTiming(); }
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	/// forwarded to the wrapped planner, attributing an equal share of the batch's latency to each request
+	std::vector<Result> planBatch(const std::vector<Request>& requests,
+	                              std::vector<robot_trajectory::RobotTrajectoryPtr>& results) override;
+
+	Result planGoalSet(const planning_scene::PlanningSceneConstPtr& from,
+	                   const std::vector<planning_scene::PlanningSceneConstPtr>& goals,
+	                   const moveit::core::JointModelGroup* jmg, double timeout,
+	                   robot_trajectory::RobotTrajectoryPtr& result, size_t& reached,
+	                   const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	/// copy of the statistics accumulated so far
+	Statistics statistics() const;
+	void clear();
+
+private:
+	void record(bool cartesian, const Result& r, double latency, const robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit::core::JointModelGroup* jmg);
+
+	PlannerInterfacePtr planner_;
+	std::string name_;
+	CallCallback call_cb_;
+
+	mutable std::mutex mutex_;  // stages might plan concurrently
+	Statistics statistics_;
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
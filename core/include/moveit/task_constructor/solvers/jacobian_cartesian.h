@@ -0,0 +1,85 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    straight-line Cartesian path by integration of the Jacobian's damped pseudo-inverse
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+#include <moveit/macros/class_forward.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(JacobianCartesian);
+
+/** Follow a straight-line Cartesian path by differential inverse kinematics, seeded from the start state
+ *
+ * Instead of solving the full IK for every waypoint like CartesianPath, each waypoint is reached by a few
+ * damped least-squares steps dq = J^T (J J^T + damping^2 I)^-1 dx from the previous one.
+ * Joints reaching their limits are locked for the remainder of the step, such that the others compensate.
+ * Thus, the joint-space path is continuous by construction and there are no IK solver calls at all,
+ * which makes this a fast alternative for short approach / retreat motions.
+ * As the solver is local, it fails (returning the partial path) if a waypoint cannot be reached within
+ * max_iterations, e.g. close to singularities or joint limits, or if a joint would move more than
+ * max_joint_step.
+ * All waypoints are collision-checked at once afterwards, path constraints are checked per waypoint.
+ */
+class JacobianCartesian : public WaypointPlanner
+{
+public:
+	JacobianCartesian();
+
+	void setStepSize(double step_size) { setProperty("step_size", step_size); }
+	void setRotationStepSize(double step_size) { setProperty("rotation_step_size", step_size); }
+	void setDamping(double damping) { setProperty("damping", damping); }
+	void setMaxIterations(uint32_t iterations) { setProperty("max_iterations", iterations); }
+	void setMaxJointStep(double max_step) { setProperty("max_joint_step", max_step); }
+	void setMinFraction(double min_fraction) { setProperty("min_fraction", min_fraction); }
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
+	            double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
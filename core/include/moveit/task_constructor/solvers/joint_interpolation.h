@@ -51,13 +51,11 @@ MOVEIT_CLASS_FORWARD(JointInterpolationPlanner);
  *
  * Fails if direct joint space interpolation fails.
  */
-class JointInterpolationPlanner : public PlannerInterface
+class JointInterpolationPlanner : public WaypointPlanner
 {
 public:
 	JointInterpolationPlanner();
 
-	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
-
 	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
 	            const core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
 	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
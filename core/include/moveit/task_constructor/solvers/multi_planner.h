@@ -39,6 +39,12 @@
 #pragma once
 
 #include <moveit/task_constructor/solvers/planner_interface.h>
+#include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <tuple>
 #include <vector>
 
 namespace moveit {
@@ -54,12 +60,41 @@ MOVEIT_CLASS_FORWARD(MultiPlanner);
  * This is (slightly) different from the Fallbacks container, as the MultiPlanner directly applies its planners to each
  * individual planning job. In contrast, the Fallbacks container first runs the active child to exhaustion before
  * switching to the next child, which possibly applies a different planning strategy.
+ *
+ * In race mode, all planners are started concurrently instead. The first found solution is returned,
+ * or - if a grace period is configured - the shortest trajectory found within this period after the first success.
+ * Planners still running are cancelled (see utils::CancellationToken) and their results are discarded.
+ * A later plan() request waits for them to finish before using the same planner again.
+ *
+ * In adaptive (sequential) mode, the success rate and planning time of each planner is recorded per planning group
+ * and kind of goal (joint-space or Cartesian). Planners are then tried in order of their expected time to success,
+ * such that the planner most likely to succeed quickly runs first. Untried planners keep their configured order.
  */
 class MultiPlanner : public PlannerInterface, public std::vector<solvers::PlannerInterfacePtr>
 {
 public:
 	using PlannerList = std::vector<solvers::PlannerInterfacePtr>;
-	using PlannerList::PlannerList;  // inherit all std::vector constructors
+
+	MultiPlanner();
+	MultiPlanner(std::initializer_list<PlannerInterfacePtr> planners);
+	MultiPlanner(const MultiPlanner&) = delete;
+	~MultiPlanner() override;
+
+	void setRace(bool race) { setProperty("race", race); }
+	void setGracePeriod(double grace_period) { setProperty("grace_period", grace_period); }
+	void setAdaptive(bool adaptive) { setProperty("adaptive", adaptive); }
+
+	/// runtime statistics of a planner, recorded in adaptive mode
+	struct Statistics
+	{
+		size_t attempts = 0;
+		size_t successes = 0;
+		double time = 0.0;  // accumulated planning time (s)
+	};
+	/// statistics of planner for requests of given group and kind of goal
+	Statistics statistics(const PlannerInterface* planner, const std::string& group, bool cartesian) const;
+	/// forget all recorded statistics
+	void resetStatistics();
 
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 
@@ -71,6 +106,30 @@ public:
 	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target,
 	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
 	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+private:
+	using PlanFunction =
+	    std::function<Result(PlannerInterface& planner, double timeout, robot_trajectory::RobotTrajectoryPtr& result)>;
+	/// run planners in sequence, returning the first success
+	Result planSequentially(const PlanFunction& plan, const moveit::core::JointModelGroup* jmg, bool cartesian,
+	                        double timeout, robot_trajectory::RobotTrajectoryPtr& result);
+	/// planners in order of execution: configured order or, in adaptive mode, expected time to success
+	PlannerList schedule(const std::string& group, bool cartesian) const;
+	/// run all planners concurrently, plan needs to capture its arguments by value as it might outlive the call
+	Result race(const PlanFunction& plan, double timeout, robot_trajectory::RobotTrajectoryPtr& result);
+	/// remove and return the abandoned run of planner (if any), which needs to finish before reusing the planner
+	std::shared_future<void> takeBusy(const PlannerInterface* planner);
+	/// wait for all abandoned planner runs to finish
+	void waitForPlanners();
+
+	std::mutex busy_mutex_;
+	// planner runs abandoned by a race, which need to finish before the planner can be used again
+	std::map<const PlannerInterface*, std::shared_future<void>> busy_;
+
+	// statistics per (planner, group, cartesian goal)
+	using StatisticsKey = std::tuple<const PlannerInterface*, std::string, bool>;
+	mutable std::mutex statistics_mutex_;
+	std::map<StatisticsKey, Statistics> statistics_;
 };
 }  // namespace solvers
 }  // namespace task_constructor
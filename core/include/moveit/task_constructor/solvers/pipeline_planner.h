@@ -42,6 +42,10 @@
 #include <moveit_msgs/MotionPlanRequest.h>
 #include <moveit/macros/class_forward.h>
 
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
 namespace planning_pipeline {
 MOVEIT_CLASS_FORWARD(PlanningPipeline);
 }
@@ -51,8 +55,51 @@ namespace task_constructor {
 namespace solvers {
 
 MOVEIT_CLASS_FORWARD(PipelinePlanner);
+MOVEIT_CLASS_FORWARD(PipelinePool);
+
+/// Pool of identically configured planning pipelines, which can be used concurrently (each by a single thread)
+class PipelinePool
+{
+public:
+	/// Exclusive access to an idle pipeline of the pool for the lifetime of the lease
+	class Lease
+	{
+	public:
+		/// blocks until an idle pipeline is available
+		explicit Lease(PipelinePool& pool);
+		~Lease();
+		Lease(const Lease&) = delete;
+		Lease& operator=(const Lease&) = delete;
+
+		planning_pipeline::PlanningPipeline& operator*() const { return *pipeline_; }
+		planning_pipeline::PlanningPipeline* operator->() const { return pipeline_; }
+
+	private:
+		PipelinePool& pool_;
+		planning_pipeline::PlanningPipeline* pipeline_;
+	};
+
+	/// add a (new) pipeline to the pool
+	void add(const planning_pipeline::PlanningPipelinePtr& pipeline);
+	/// number of pipelines in the pool
+	size_t size() const;
+	/// all pipelines of the pool, regardless whether they are in use
+	std::vector<planning_pipeline::PlanningPipelinePtr> pipelines() const;
+
+private:
+	mutable std::mutex mutex_;
+	std::condition_variable idle_cv_;
+	std::vector<planning_pipeline::PlanningPipelinePtr> pipelines_;
+	std::vector<planning_pipeline::PlanningPipeline*> idle_;
+};
 
-/** Use MoveIt's PlanningPipeline to plan a trajectory between to scenes */
+/** Use MoveIt's PlanningPipeline to plan a trajectory between to scenes
+ *
+ * A PlanningPipeline doesn't support concurrent planning requests. Hence, pipelines are organized in pools of
+ * identically configured instances, shared by all PipelinePlanners with the same specification.
+ * Each plan() request checks out an idle instance, waiting for one to become available if necessary.
+ * Set the property "pool_size" (before init) to the number of concurrent requests to support.
+ */
 class PipelinePlanner : public PlannerInterface
 {
 public:
@@ -71,12 +118,15 @@ public:
 	}
 
 	static planning_pipeline::PlanningPipelinePtr create(const Specification& spec);
+	/// retrieve the (shared) pool of pipelines for spec, growing it to at least size instances
+	static PipelinePoolPtr createPool(const Specification& spec, size_t size);
 
 	PipelinePlanner(const std::string& pipeline = "ompl");
 
 	PipelinePlanner(const planning_pipeline::PlanningPipelinePtr& planning_pipeline);
 
 	void setPlannerId(const std::string& planner) { setProperty("planner", planner); }
+	void setPoolSize(uint size) { setProperty("pool_size", size); }
 
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 
@@ -89,12 +139,21 @@ public:
 	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
 	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
 
+	/// plan towards all goals at once, passing them as alternative goal constraints to the pipeline
+	Result planGoalSet(const planning_scene::PlanningSceneConstPtr& from,
+	                   const std::vector<planning_scene::PlanningSceneConstPtr>& goals,
+	                   const moveit::core::JointModelGroup* jmg, double timeout,
+	                   robot_trajectory::RobotTrajectoryPtr& result, size_t& reached,
+	                   const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
 protected:
-	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit_msgs::MotionPlanRequest& req,
-	            robot_trajectory::RobotTrajectoryPtr& result);
+	/// plan the assembled request
+	virtual Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit_msgs::MotionPlanRequest& req,
+	                    robot_trajectory::RobotTrajectoryPtr& result);
 
 	std::string pipeline_name_;
-	planning_pipeline::PlanningPipelinePtr planner_;
+	planning_pipeline::PlanningPipelinePtr planner_;  // first instance of pool_
+	PipelinePoolPtr pool_;
 };
 }  // namespace solvers
 }  // namespace task_constructor
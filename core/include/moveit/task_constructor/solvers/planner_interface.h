@@ -42,6 +42,8 @@
 #include <moveit_msgs/Constraints.h>
 #include <moveit/task_constructor/properties.h>
 #include <Eigen/Geometry>
+#include <functional>
+#include <mutex>
 
 namespace planning_scene {
 MOVEIT_CLASS_FORWARD(PlanningScene);
@@ -62,13 +64,22 @@ MOVEIT_CLASS_FORWARD(JointModelGroup);
 
 namespace moveit {
 namespace task_constructor {
+namespace utils {
+class RobotStatePool;
+}
 namespace solvers {
 
 MOVEIT_CLASS_FORWARD(PlannerInterface);
+/** Base class of all planning algorithms
+ *
+ * Long-running implementations of plan() should regularly poll utils::CancellationToken::current()
+ * (or register a callback with it) and return early with a failure when planning was cancelled.
+ */
 class PlannerInterface
 {
 	// these properties take precedence over stage properties
 	PropertyMap properties_;
+	std::mutex init_mutex_;  // serializing initShared()
 
 public:
 	struct Result
@@ -79,6 +90,16 @@ public:
 		operator bool() const { return success; }
 	};
 
+	/// joint-space planning request, as processed by planBatch()
+	struct Request
+	{
+		planning_scene::PlanningSceneConstPtr from;
+		planning_scene::PlanningSceneConstPtr to;
+		const moveit::core::JointModelGroup* jmg;
+		double timeout;
+		moveit_msgs::Constraints path_constraints;
+	};
+
 	PlannerInterface();
 	virtual ~PlannerInterface() {}
 
@@ -92,8 +113,23 @@ public:
 	void setTimeParameterization(const trajectory_processing::TimeParameterizationPtr& tp) {
 		properties_.set("time_parameterization", tp);
 	}
+	/** skip time parameterization in plan(), returning it via deferredTiming() instead
+	 *
+	 * Stages attach the deferred timing to their solutions, which are only timed when published or executed
+	 * (see SubTrajectory::deferTiming()). Supported by WaypointPlanner subclasses and RoadmapPlanner.
+	 */
+	void setDeferTiming(bool defer) { properties_.set("defer_timing", defer); }
+
+	using Timing = std::function<void(robot_trajectory::RobotTrajectory& trajectory)>;
+	/// time parameterization still to be applied to trajectories of plan(), empty if plan() timed them already
+	virtual Timing deferredTiming() const { return Timing(); }
 
 	virtual void init(const moveit::core::RobotModelConstPtr& robot_model) = 0;
+	/// call init(), serialized per planner instance: stages sharing a planner might be initialized concurrently
+	void initShared(const moveit::core::RobotModelConstPtr& robot_model) {
+		std::lock_guard<std::mutex> lock(init_mutex_);
+		init(robot_model);
+	}
 
 	/// plan trajectory between to robot states
 	virtual Result plan(const planning_scene::PlanningSceneConstPtr& from,
@@ -107,6 +143,48 @@ public:
 	                    const moveit::core::JointModelGroup* jmg, double timeout,
 	                    robot_trajectory::RobotTrajectoryPtr& result,
 	                    const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) = 0;
+
+	/** plan trajectories for several independent requests at once, resizing results to the number of requests
+	 *
+	 * Planners that can amortize their setup across requests should override this.
+	 * The default implementation calls plan() for each request in sequence.
+	 */
+	virtual std::vector<Result> planBatch(const std::vector<Request>& requests,
+	                                      std::vector<robot_trajectory::RobotTrajectoryPtr>& results);
+
+	/** plan trajectory from a start scene to any of several goal scenes, setting reached to the index of the goal
+	 *
+	 * Planners supporting goal sets should override this to plan towards all goals in a single request.
+	 * The default implementation plans towards the goals in order, until one of them is reached.
+	 */
+	virtual Result planGoalSet(const planning_scene::PlanningSceneConstPtr& from,
+	                           const std::vector<planning_scene::PlanningSceneConstPtr>& goals,
+	                           const moveit::core::JointModelGroup* jmg, double timeout,
+	                           robot_trajectory::RobotTrajectoryPtr& result, size_t& reached,
+	                           const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints());
+
+protected:
+	/// time parameterization as configured by time_parameterization and the scaling factors
+	Timing timing() const;
+};
+
+/** Base class of planners computing their waypoints themselves, like JointInterpolationPlanner
+ *
+ * Waypoints are allocated from the RobotStatePool of the robot model, kept alive by init() across plan() calls,
+ * such that waypoints of released trajectories get reused. Timing is deferred if defer_timing is set.
+ */
+class WaypointPlanner : public PlannerInterface
+{
+public:
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	Timing deferredTiming() const override;
+
+protected:
+	/// pool to allocate waypoints for robot_model from, also if init() wasn't called
+	std::shared_ptr<utils::RobotStatePool> statePool(const moveit::core::RobotModelConstPtr& robot_model) const;
+
+private:
+	std::shared_ptr<utils::RobotStatePool> state_pool_;
 };
 }  // namespace solvers
 }  // namespace task_constructor
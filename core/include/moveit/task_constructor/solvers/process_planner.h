@@ -0,0 +1,162 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    meta planner, isolating a wrapped planner in a pool of worker processes
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+
+#include <sys/types.h>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <typeinfo>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(ProcessPlanner);
+
+/** A meta planner running a wrapped planner in a pool of worker processes
+ *
+ * Each worker owns a copy of the wrapped planner, such that planners (or plugins) that are not thread-safe
+ * can still serve concurrent requests. Requests and trajectories are exchanged via a shared-memory buffer
+ * per worker, serialized as ROS messages. A worker plans in a copy of the start scene.
+ *
+ * fork() is only safe in a single-threaded process. Thus, workers are forked from a zygote process,
+ * which is forked itself before any threads are started, by startZygote(). A worker creates its copy of the
+ * wrapped planner with the factory registered for the planner's type, copies the planner's (serializable)
+ * properties at the time of init(), and initializes it with a copy of the robot model.
+ * Workers must not rely on ROS communication, as they don't run roscpp.
+ * A worker that died, was cancelled, or exceeded the planning timeout is killed and restarted on the next request.
+ * init() and the destructor must not be called concurrently with plan().
+ */
+class ProcessPlanner : public PlannerInterface
+{
+public:
+	ProcessPlanner(const PlannerInterfacePtr& planner);
+	ProcessPlanner(const ProcessPlanner&) = delete;
+	/// stop all worker processes
+	~ProcessPlanner() override;
+
+	using Factory = std::function<PlannerInterfacePtr()>;
+	/** register the factory creating planners of the given type in worker processes
+	 *
+	 * MTC's JointInterpolationPlanner, CartesianPath, and JacobianCartesian are registered by default.
+	 * Factories need to be registered before startZygote(), returns false otherwise.
+	 */
+	static bool registerFactory(const std::type_info& type, Factory factory);
+	template <typename T>
+	static bool registerFactory() {
+		return registerFactory(typeid(T), [] { return std::make_shared<T>(); });
+	}
+
+	/** fork the zygote process, from which all worker processes are forked later
+	 *
+	 * This must happen while the process is still single-threaded, e.g. first thing in main().
+	 * init() starts the zygote itself, if not yet done and the process is still single-threaded.
+	 * Returns true if the zygote is running.
+	 */
+	static bool startZygote();
+
+	const PlannerInterfacePtr& planner() const { return planner_; }
+
+	/// number of worker processes (0: number of CPU cores)
+	void setNumProcesses(uint num) { setProperty("num_processes", num); }
+	/// bytes available per worker for a serialized request or trajectory
+	void setBufferSize(uint32_t bytes) { setProperty("buffer_size", bytes); }
+
+	/// init wrapped planner and (re)start worker processes
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	Timing deferredTiming() const override { return planner_->deferredTiming(); }
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	/// number of running worker processes
+	size_t numProcesses() const;
+
+private:
+	struct Setup;
+	struct Job;
+	struct Response;
+	struct Slot;  // shared-memory channel to a worker
+	class Zygote;
+
+	Result run(const Job& job, const planning_scene::PlanningSceneConstPtr& from,
+	           robot_trajectory::RobotTrajectoryPtr& result);
+	Result exchange(size_t index, pid_t pid, const Job& job, Response& response);
+	Slot& slot(size_t index) const;
+
+	void start(size_t num);
+	void stop();
+	/// (re)initialize slot index and fork a worker process serving it (with mutex_ locked)
+	void spawn(size_t index);
+	/// kill the worker of slot index, if still running, and spawn a new one
+	void restart(size_t index, pid_t pid);
+
+	/// main function of a worker process
+	static void work(Slot& slot, uint32_t capacity);
+	static Response process(const PlannerInterfacePtr& planner, const moveit::core::RobotModelConstPtr& robot_model,
+	                        const Job& job);
+
+	PlannerInterfacePtr planner_;
+	moveit::core::RobotModelConstPtr robot_model_;
+	std::unique_ptr<Setup> setup_;  // workers' initialization, sent to each (re)started worker
+
+	int memory_fd_ = -1;  // shared memory of all slots, passed to the zygote
+	void* memory_ = nullptr;
+	size_t memory_size_ = 0;
+	size_t stride_ = 0;  // bytes per slot
+	uint32_t capacity_ = 0;  // buffer bytes per slot
+	std::vector<pid_t> pids_;
+
+	mutable std::mutex mutex_;  // protecting idle_ and pids_, locked before any slot
+	std::condition_variable idle_cv_;
+	std::vector<size_t> idle_;  // slots without a pending request
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,96 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    plan on remote worker nodes
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/pipeline_planner.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(RemotePlanner);
+
+/** Plan by sending requests to a pool of remote planning workers
+ *
+ * Each request, comprising the start scene and the motion plan request assembled like by PipelinePlanner,
+ * is sent via the moveit_task_constructor_msgs/PlanTrajectory service to the worker with the fewest pending requests.
+ * Workers are move_group nodes (e.g. on other machines) running the PlanTrajectoryCapability.
+ * If a worker isn't reachable, the request is passed to the next one.
+ *
+ * plan() blocks until the worker replied. Hence, to plan concurrently on several workers,
+ * use a parallel ExecutionPolicy or planBatch(), which dispatches several requests at once.
+ * plan() gives up if the reply doesn't arrive within the planning time plus reply_timeout,
+ * or if the active CancellationToken is cancelled. The worker still completes such an abandoned request
+ * (within its planning time) and counts as busy until then, but its reply is discarded.
+ */
+class RemotePlanner : public PipelinePlanner
+{
+public:
+	/// workers are given by the names of their PlanTrajectory services
+	RemotePlanner(const std::vector<std::string>& workers = { "plan_trajectory" });
+
+	void setWorkers(const std::vector<std::string>& workers) { setProperty("workers", workers); }
+	void setReplyTimeout(double timeout) { setProperty("reply_timeout", timeout); }
+
+	using PipelinePlanner::plan;
+
+	/// no local pipelines are needed
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+
+	/// dispatch requests to all workers concurrently
+	std::vector<Result> planBatch(const std::vector<Request>& requests,
+	                              std::vector<robot_trajectory::RobotTrajectoryPtr>& results) override;
+
+	/// number of requests currently pending at worker
+	size_t pending(const std::string& worker) const;
+
+protected:
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit_msgs::MotionPlanRequest& req,
+	            robot_trajectory::RobotTrajectoryPtr& result) override;
+
+private:
+	struct Workers;
+	std::shared_ptr<Workers> workers_;  // shared with pending service calls, which may outlive the planner
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,108 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    multi-query planner, reusing a lazily validated roadmap across requests
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/solvers/planner_interface.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+MOVEIT_CLASS_FORWARD(RoadmapPlanner);
+
+/** A multi-query joint-space planner, maintaining a persistent roadmap (lazy PRM) per planning group
+ *
+ * Roadmap nodes and edges are only validated when they become part of a candidate path.
+ * Validation results are remembered per validation context, i.e. the collision world, attached bodies,
+ * allowed collisions, positions of joints outside the group, and path constraints.
+ * In a static world, validated parts of the roadmap are thus reused by all subsequent requests.
+ * Each element keeps the results of its four most recently validated contexts, such that requests
+ * alternating between a few scenes (e.g. before and after grasping) don't invalidate each other.
+ * Results of older contexts are dropped and lazily revalidated once the element is used again.
+ *
+ * If no valid path is found, the roadmap is grown by random samples until the timeout is reached
+ * or the roadmap holds max_nodes nodes. Start and goal states of requests are added to the roadmap,
+ * such that repeated requests are cheap. Once the roadmap is full, they are removed after the request.
+ * Paths follow the roadmap's edges and are not smoothed. Cartesian planning requests are not supported.
+ *
+ * The roadmaps survive init() (and thus replanning a reset Task) unless the robot model changes.
+ * Requests for the same group are served one at a time.
+ */
+class RoadmapPlanner : public PlannerInterface
+{
+public:
+	RoadmapPlanner();
+	~RoadmapPlanner() override;
+
+	void setMaxNodes(uint32_t max_nodes) { setProperty("max_nodes", max_nodes); }
+	void setNeighbors(uint32_t neighbors) { setProperty("neighbors", neighbors); }
+	void setResolution(double resolution) { setProperty("resolution", resolution); }
+
+	/// keep roadmaps unless the robot model changes
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	Timing deferredTiming() const override;
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints = moveit_msgs::Constraints()) override;
+
+	/// discard all roadmaps
+	void clear();
+	/// number of nodes in the roadmap of the given group
+	size_t size(const moveit::core::JointModelGroup* jmg) const;
+
+private:
+	struct Roadmap;
+	std::shared_ptr<Roadmap> roadmap(const moveit::core::JointModelGroup* jmg);
+
+	moveit::core::RobotModelConstPtr robot_model_;  // model of the roadmaps
+	mutable std::mutex mutex_;  // protecting roadmaps_
+	std::map<const moveit::core::JointModelGroup*, std::shared_ptr<Roadmap>> roadmaps_;
+};
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -162,6 +162,36 @@ public:
 		PARENT = 2,
 		INTERFACE = 4,
 	};
+	/** Amount of visualization markers generated for solutions
+	 *
+	 * - MARKERS_NONE skips all marker generation, e.g. in headless production runs.
+	 * - MARKERS_BASIC generates lightweight markers only: frames and arrows.
+	 * - MARKERS_FULL additionally generates robot and object geometry, e.g. end-effector meshes.
+	 */
+	enum MarkerLevel
+	{
+		MARKERS_NONE = 0,
+		MARKERS_BASIC = 1,
+		MARKERS_FULL = 2,
+	};
+
+	/// approximate memory (bytes) held by a stage, see memoryUsage()
+	struct MemoryUsage
+	{
+		size_t states = 0;  // interface states created by the stage
+		size_t scenes = 0;  // planning scenes of these states, each counted once
+		size_t trajectories = 0;  // stored solutions and failures, including their trajectories
+		size_t markers = 0;  // markers of stored solutions and failures, shared markers counted once
+
+		size_t total() const { return states + scenes + trajectories + markers; }
+		MemoryUsage& operator+=(const MemoryUsage& other) {
+			states += other.states;
+			scenes += other.scenes;
+			trajectories += other.trajectories;
+			markers += other.markers;
+			return *this;
+		}
+	};
 
 	virtual ~Stage();
 
@@ -194,6 +224,23 @@ public:
 	void setTimeout(double timeout) { setProperty("timeout", timeout); }
 	/// timeout of stage per computation
 	double timeout() const { return properties().get<double>("timeout"); }
+	/** automatically tune the timeout to the given fraction in (0, 1] of successful compute durations (0: disabled)
+	 *
+	 * Durations of compute() calls yielding new solutions are collected across plan() runs.
+	 * Once enough of them are known, the timeout is lowered to the percentile of the recent ones,
+	 * cutting hopeless attempts short. The configured timeout remains an upper bound.
+	 * Values outside [0, 1] are rejected by init().
+	 */
+	void setTimeoutPercentile(double percentile) { setProperty("timeout_percentile", percentile); }
+
+	/** set the total computation time (in seconds) granted to the stage per plan() (0: unlimited)
+	 *
+	 * Once exhausted, the parent container only computes the stage if none of its siblings has pending work.
+	 */
+	void setComputeBudget(double budget) { setProperty("compute_budget", budget); }
+	double computeBudget() const { return properties().get<double>("compute_budget"); }
+	/// has the stage used up its compute budget?
+	bool budgetExhausted() const;
 
 	/** set marker namespace for solutions
 	 *
@@ -203,6 +250,22 @@ public:
 	/// marker namespace of solution markers
 	const std::string& markerNS() { return properties().get<std::string>("marker_ns"); }
 
+	/// set amount of generated markers, inherited from the parent (and thus the task) by default
+	void setMarkerLevel(MarkerLevel level) { setProperty("marker_level", level); }
+	MarkerLevel markerLevel() const { return properties().get<MarkerLevel>("marker_level"); }
+	/// should markers of the given level be generated? (valid after init())
+	bool generatesMarkers(MarkerLevel level = MARKERS_BASIC) const;
+
+	/// store solution trajectories compactly to reduce memory, inherited from the parent by default
+	void setCompactTrajectories(bool compact = true) { setProperty("compact_trajectories", compact); }
+	/** evaluate costs of new solutions in the background, overlapping expensive cost terms with further planning
+	 *
+	 * Solutions (and their states) are only stored and passed on once their cost is known. Inherited from the parent.
+	 * Cost terms see copies of the solutions' existing start and end states, lacking their incoming and outgoing
+	 * trajectories, as the planning thread keeps modifying the originals.
+	 */
+	void setAsyncCost(bool async = true) { setProperty("async_cost", async); }
+
 	/// Set and get info to use when executing the stage's trajectory
 	void setTrajectoryExecutionInfo(TrajectoryExecutionInfo trajectory_execution_info) {
 		setProperty("trajectory_execution_info", trajectory_execution_info);
@@ -234,11 +297,22 @@ public:
 		setCostTerm(std::make_shared<LambdaCostTerm>(term));
 	}
 
+	/** estimate the remaining cost of a complete solution through a state of this stage's interfaces
+	 *
+	 * The estimate is evaluated once, when a state enters the interface, and added to the state's
+	 * accumulated cost when ordering states of equal depth. Stages and schedulers thus expand states A*-like.
+	 * The estimate only guides the order of computation: it doesn't affect solution costs or cost-based pruning.
+	 */
+	using CostToGo = Interface::CostToGo;
+	void setCostToGo(const CostToGo& cost_to_go);
+
 	const ordered<SolutionBaseConstPtr>& solutions() const;
 	const std::list<SolutionBaseConstPtr>& failures() const;
 	size_t numFailures() const;
+	/// number of failures with the given reason, counted even if failures are not stored
+	size_t numFailures(FailureCode code) const;
 	/// Call to increase number of failures w/o storing a (failure) trajectory
-	void silentFailure();
+	void silentFailure(FailureCode code = FailureCode::UNSPECIFIED);
 	/// Should we generate failure solutions? Note: Always report a failure!
 	bool storeFailures() const;
 
@@ -257,6 +331,13 @@ public:
 
 	double getTotalComputeTime() const;
 
+	/** approximate memory held by this stage, excluding its children
+	 *
+	 * Scenes, trajectories, and markers shared by several stages are accounted by each of them.
+	 * The result is cached until the stage's states or stored solutions change.
+	 */
+	MemoryUsage memoryUsage() const;
+
 protected:
 	/// Stage can only be instantiated through derived classes
 	Stage(StagePrivate* impl);
@@ -372,6 +453,12 @@ public:
 		trajectory.setCost(cost);
 		spawn(std::move(state), std::move(trajectory));
 	}
+	/** spawn many states at once, like calling spawn(state, trajectory) for each of them
+	 *
+	 * All states are inserted into the next/previous interface at once, sorting them only once,
+	 * and the parent is notified about the new solutions only afterwards.
+	 */
+	void spawnBatch(std::vector<std::pair<InterfaceState, SubTrajectory>>&& batch);
 
 protected:
 	Generator(GeneratorPrivate* impl);
@@ -412,8 +499,41 @@ public:
 
 	virtual void compute(const InterfaceState& from, const InterfaceState& to) = 0;
 
+	using StatePairs = std::vector<std::pair<const InterfaceState*, const InterfaceState*>>;
+	/** Connect several state pairs at once, the number of which is limited by the property batch_size
+	 *
+	 * Override to plan all pairs together, e.g. via PlannerInterface::planBatch().
+	 * The default implementation calls compute() for each pair in sequence.
+	 */
+	virtual void computeBatch(const StatePairs& pairs);
+
+	/// number of pending state pairs passed to computeBatch() at once
+	void setBatchSize(size_t batch_size) { setProperty("batch_size", batch_size); }
+
+	/// estimate the cost-to-go of states as weighted joint-space distance to the closest opposite state
+	void setJointDistanceCostToGo(double weight = 1.0);
+
+	/// among pending pairs of equal priority, try the ones closest in joint space (see pairDistance()) first
+	void setPreferClosePairs(bool prefer = true) { setProperty("prefer_close_pairs", prefer); }
+	/// number of feasible pairs of equal priority compared by prefer_close_pairs per attempt (0: all of them)
+	void setClosePairCandidates(size_t candidates) { setProperty("close_pair_candidates", candidates); }
+	/// skip pending pairs farther apart than distance (0: no limit)
+	void setMaxPairDistance(double distance) { setProperty("max_pair_distance", distance); }
+	/** remember failed pairs to postpone pending pairs close to a failure (0: disabled)
+	 *
+	 * A pair is close to a failed one if both its start and end state are within tolerance (see pairDistance())
+	 * and their scenes have the same world and allowed collisions. Such pairs are only tried after all others.
+	 */
+	void setFailureTolerance(double tolerance) { setProperty("failure_tolerance", tolerance); }
+	/// never try pairs close to a failed one instead of postponing them
+	void setSkipNearFailures(bool skip = true) { setProperty("skip_near_failures", skip); }
+
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+
 protected:
 	virtual bool compatible(const InterfaceState& from_state, const InterfaceState& to_state) const;
+	/// distance between the states of a pending pair, by default the joint-space distance of all variables
+	virtual double pairDistance(const InterfaceState& from, const InterfaceState& to) const;
 
 	/// register solution as a solution connecting states from -> to
 	void connect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& solution);
@@ -42,12 +42,25 @@
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/cost_terms.h>
 #include <moveit/task_constructor/cost_queue.h>
+#include <moveit/task_constructor/arena.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/histogram.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/scheduler_log.h>
 
 #include <ros/console.h>
 #include <fmt/core.h>
 
+#include <array>
+#include <atomic>
 #include <ostream>
 #include <chrono>
+#include <deque>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
 
 // define pimpl() functions accessing correctly casted pimpl_ pointer
 #define PIMPL_FUNCTIONS(Class)                                                                       \
@@ -57,7 +70,46 @@
 namespace moveit {
 namespace task_constructor {
 
+namespace utils {
+class Reclaimer;
+class ThreadPool;
+}
+
+/** Buffer of postponed StagePrivate actions
+ *
+ * Stages computed concurrently in a worker thread must not modify interfaces shared with other stages.
+ * While a DeferredActions::Scope is active in the current thread, sendForward(), sendBackward(),
+ * spawn(), and connect() only record their action, which is performed later via apply()
+ * from the planning thread.
+ */
+class DeferredActions
+{
+public:
+	using Action = std::function<void()>;
+
+	/// record all actions of the current thread into the given buffer (for the lifetime of the scope)
+	class Scope
+	{
+		DeferredActions* previous_;
+
+	public:
+		explicit Scope(DeferredActions& actions);
+		~Scope();
+	};
+
+	/// record action if a Scope is active in the current thread, returns false otherwise
+	static bool defer(Action&& action);
+
+	/// perform (and clear) all recorded actions in order
+	void apply();
+	bool empty() const { return actions_.empty(); }
+
+private:
+	std::vector<Action> actions_;
+};
+
 class ContainerBase;
+class AsyncCosts;
 class StagePrivate
 {
 	friend class Stage;
@@ -67,7 +119,7 @@ public:
 	/// container type used to store children
 	using container_type = std::list<Stage::pointer>;
 	StagePrivate(Stage* me, const std::string& name);
-	virtual ~StagePrivate() = default;
+	virtual ~StagePrivate();
 
 	/// actually configured interface of this stage (only valid after init())
 	InterfaceFlags interfaceFlags() const;
@@ -83,6 +135,8 @@ public:
 
 	virtual bool canCompute() const = 0;
 	virtual void compute() = 0;
+	/// prepare work for the next canCompute() probes, called by the scheduler once per planning iteration
+	virtual void refill() {}
 
 	inline const Stage* me() const { return me_; }
 	inline Stage* me() { return me_; }
@@ -126,6 +180,27 @@ public:
 	/// to setup the connection structure of their children
 	inline void setParentPosition(container_type::iterator it) { it_ = it; }
 	inline void setIntrospection(Introspection* introspection) { introspection_ = introspection; }
+	inline void setThreadPool(utils::ThreadPool* pool) { thread_pool_ = pool; }
+	/// thread pool to use for concurrent computations (nullptr if planning sequentially)
+	inline utils::ThreadPool* threadPool() const { return thread_pool_; }
+	inline void setAnytimeFlag(const std::atomic<bool>* flag) { anytime_ = flag; }
+	/// destroy released solutions and states in the background (nullptr: synchronously)
+	inline void setReclaimer(utils::Reclaimer* reclaimer) { reclaimer_ = reclaimer; }
+	inline utils::Reclaimer* reclaimer() const { return reclaimer_; }
+	/// release all solutions, failures, and states (on reset)
+	void releaseSolutions();
+	/// prefer computing the most advanced partial solutions (ExecutionPolicy::ANYTIME, before the first solution)
+	inline bool anytime() const { return anytime_ && *anytime_; }
+	/// use task's arena for created states and solutions (switching arenas requires a reset stage)
+	void setArena(const utils::ArenaPtr& arena);
+	/// install cost-to-go estimator and beam width on the pull interfaces (possibly created late, in resolveInterface())
+	void configureInterfaces();
+
+	/// create a new solution object, allocated from the task's arena (if any)
+	template <typename T, typename... Args>
+	std::shared_ptr<T> makeSolution(Args&&... args) {
+		return std::allocate_shared<T>(utils::ArenaAllocator<T>(arena_), std::forward<Args>(args)...);
+	}
 
 	inline void setPrevEnds(const InterfacePtr& prev_ends) { prev_ends_ = prev_ends; }
 	inline void setNextStarts(const InterfacePtr& next_starts) { next_starts_ = next_starts; }
@@ -139,25 +214,101 @@ public:
 	inline void send(const InterfaceState& start, InterfaceState&& end, const SolutionBasePtr& solution);
 	void spawn(InterfaceState&& from, InterfaceState&& to, const SolutionBasePtr& solution);
 	void spawn(InterfaceState&& state, const SolutionBasePtr& solution);
+	void spawnBatch(std::vector<std::pair<InterfaceState, SolutionBasePtr>>&& batch);
 	void connect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& solution);
 
+	/** evaluate the cost of new solutions in the background (if the Stage property async_cost is enabled)
+	 *
+	 * Planning continues while evaluate runs. Once it finished, store is performed by the planning thread
+	 * via applyEvaluatedCosts(), in order of submission.
+	 */
+	void evaluateCostAsync(DeferredActions::Action&& evaluate, DeferredActions::Action&& store);
+	/// store solutions whose cost was evaluated in the background, waiting for all of them if wait is true
+	void applyEvaluatedCosts(bool wait = false);
+	bool hasPendingCosts() const;
+	/// wait for running background evaluations and drop all pending solutions (on reset)
+	void discardPendingCosts();
+
 	bool storeSolution(const SolutionBasePtr& solution, const InterfaceState* from, const InterfaceState* to);
+	/// compact the trajectory of a SubTrajectory before storing it, if compact_trajectories_ is enabled
+	void compactSolution(SolutionBase& solution) const;
+	/// release a stored solution, which was removed from solutions_ or failures_, and the states only it used
+	void discardSolution(const SolutionBaseConstPtr& solution);
+	/// add a newly created state to the given push interface, skipping duplicates if dedup_resolution_ > 0
+	void propagate(Interface& interface, InterfaceState& state);
+	void propagate(Interface& interface, const std::vector<InterfaceState*>& states);
 	void newSolution(const SolutionBasePtr& solution);
-	bool storeFailures() const { return introspection_ != nullptr; }
+	bool storeFailures() const { return introspection_ != nullptr && !drop_failures_; }
+
+	// degradation steps of Task::setMemoryBudget(), taken between iterations of plan()
+	/// discard all stored failures and don't store further ones until reset
+	void dropFailures();
+	/// remove the worst fraction of disabled (ARMED or PRUNED) states from the pull interfaces, returns their number
+	size_t evictDisabledStates(double fraction);
+	/// compact the trajectories of all stored solutions and failures, and of further ones until init()
+	void compactSolutions();
+	/// called for each state evicted from a pull interface, before it is removed
+	virtual void onEvictState(const InterfaceState& /* state */) {}
+	/// free created states that are neither in an interface nor used by a stored solution anymore, returns their number
+	size_t releaseOrphanedStates();
+	/// called for each state freed by releaseOrphanedStates(), before it is destroyed
+	virtual void onReleaseState(const InterfaceState& /* state */) {}
+	/// to be called when states_, solutions_, or failures_ change, such that memoryUsage() is recomputed
+	void invalidateMemoryUsage() { memory_usage_valid_ = false; }
+
 	void runCompute() {
+		if (utils::CancellationToken::current().cancelled())
+			return;  // planning was preempted or timed out
+		applyEvaluatedCosts();
 		ROS_DEBUG_STREAM_NAMED("Stage", fmt::format("Computing stage '{}'", name()));
 		auto compute_start_time = std::chrono::steady_clock::now();
+		const size_t num_solutions = solutions_.size();
+		const size_t num_failures = num_failures_;
+		utils::ScopedTimer timer("compute", name());
+		utils::SchedulerLog::Compute logged(*me());
 		try {
 			compute();
 		} catch (const Property::error& e) {
 			me()->reportPropertyError(e);
 		}
+		logged.finish(solutions_.size() - std::min(num_solutions, solutions_.size()), num_failures_ - num_failures);
 		auto compute_stop_time = std::chrono::steady_clock::now();
 		total_compute_time_ += compute_stop_time - compute_start_time;
+		++num_computes_;
+		compute_latency_.record(std::chrono::duration<double>(compute_stop_time - compute_start_time).count());
+		if (timeout_percentile_ > 0.0 && solutions_.size() > num_solutions)
+			recordSuccessfulCompute(std::chrono::duration<double>(compute_stop_time - compute_start_time).count());
+		// an idle stage isn't computed again: don't leave solutions behind
+		if (hasPendingCosts() && !canCompute())
+			applyEvaluatedCosts(true);
 	}
 
-	/** compute cost for solution through configured CostTerm */
-	void computeCost(const InterfaceState& from, const InterfaceState& to, SolutionBase& solution);
+	/// remember the duration of a compute() call that yielded new solutions, and tune the timeout accordingly
+	void recordSuccessfulCompute(double duration);
+	/** set the timeout property to the configured percentile of recent successful compute durations
+	 *
+	 * The tuned timeout never exceeds the configured one. It is only applied once enough samples were collected.
+	 */
+	void tuneTimeout();
+
+	/// durations of compute() calls since the last reset
+	const utils::LatencyHistogram& computeLatency() const { return compute_latency_; }
+	/// number of compute() calls since the last reset
+	size_t numComputes() const { return num_computes_; }
+	/// mean duration of compute() calls since the last reset (0 if not computed yet)
+	double meanComputeTime() const { return num_computes_ ? total_compute_time_.count() / num_computes_ : 0.0; }
+	/// has the stage used up its compute_budget since the last reset?
+	bool overBudget() const { return compute_budget_ > 0.0 && total_compute_time_.count() >= compute_budget_; }
+
+	/** compute cost for solution through configured CostTerm
+	 *
+	 * Solutions whose cost reaches bound are discarded by the caller, see CostTerm::bound().
+	 */
+	void computeCost(const InterfaceState& from, const InterfaceState& to, SolutionBase& solution,
+	                 double bound = std::numeric_limits<double>::infinity());
+	const CostTermConstPtr& costTerm() const { return cost_term_; }
+	/// restore the ordering of solutions_ after their costs were modified
+	void sortSolutions() { solutions_.sort(); }
 
 protected:
 	StagePrivate& operator=(StagePrivate&& other);
@@ -174,17 +325,38 @@ protected:
 
 	// user-configurable cost estimator
 	CostTermConstPtr cost_term_;
+	// optional estimator of the remaining cost of states in the pull interfaces
+	Stage::CostToGo cost_to_go_;
 
 	// The total compute time
 	std::chrono::duration<double> total_compute_time_;
+	size_t num_computes_ = 0;
+	utils::LatencyHistogram compute_latency_;
 
 	// functions called for each new solution
 	std::list<Stage::SolutionCallback> solution_cbs_;
 
-	std::list<InterfaceState> states_;  // storage for created states
+	using StateList = std::list<InterfaceState, utils::ArenaAllocator<InterfaceState>>;
+	StateList states_;  // storage for created states
 	ordered<SolutionBaseConstPtr> solutions_;
 	std::list<SolutionBaseConstPtr> failures_;
+	// Stage::memoryUsage(), cached until states_, solutions_, or failures_ change
+	mutable Stage::MemoryUsage memory_usage_;
+	mutable bool memory_usage_valid_ = false;
 	std::size_t num_failures_ = 0;  // num of failures if not stored
+	std::array<std::size_t, NUM_FAILURE_CODES> failure_counts_{};  // num of failures per FailureCode
+	uint32_t max_stored_failures_ = 0;  // number of most recent failures to store (0: all)
+	double compute_budget_ = 0.0;  // total compute time granted since the last reset (0: unlimited)
+	double dedup_resolution_ = 0.0;  // joint resolution to identify duplicate states (0: disabled)
+	double timeout_percentile_ = 0.0;  // percentile of successful compute durations used as timeout (0: disabled)
+	double configured_timeout_ = std::numeric_limits<double>::infinity();  // timeout before tuning
+	std::deque<double> successful_compute_times_;  // recent durations of computes yielding solutions, kept across runs
+	size_t max_interface_states_ = 0;  // beam width of pull interfaces (0: unlimited)
+	Stage::MarkerLevel marker_level_ = Stage::MARKERS_FULL;  // amount of markers to generate
+	bool compact_trajectories_ = false;  // compact trajectories of stored solutions
+	bool drop_failures_ = false;  // don't store failures, even if introspection is enabled
+	bool async_cost_ = false;  // evaluate costs of new solutions in the background
+	PropertyMap::InitPlan interface_init_plan_;  // properties initialized from INTERFACE, computed in init()
 
 private:
 	// !! items write-accessed only by ContainerBasePrivate to maintain hierarchy !!
@@ -197,6 +369,20 @@ private:
 	InterfaceWeakPtr next_starts_;  // interface to be used for sendForward()
 
 	Introspection* introspection_;  // task's introspection instance
+	utils::ThreadPool* thread_pool_;  // task's thread pool (if planning concurrently)
+	const std::atomic<bool>* anytime_ = nullptr;  // task's flag indicating anytime scheduling
+	utils::ArenaPtr arena_;  // task's memory arena for states and solutions
+	utils::Reclaimer* reclaimer_ = nullptr;  // task's reclaimer for background teardown
+
+	// second halves of sendForward() & co: store a new solution, whose cost is known, and propagate its states
+	void storeForward(const InterfaceState& from, InterfaceState&& to, const SolutionBasePtr& solution);
+	void storeBackward(InterfaceState&& from, const InterfaceState& to, const SolutionBasePtr& solution);
+	void storeSpawn(InterfaceState&& from, InterfaceState&& to, const SolutionBasePtr& solution);
+	void storeBatch(std::vector<std::pair<InterfaceState, SolutionBasePtr>>&& batch);
+	void storeConnect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& solution);
+
+	// background evaluation of costs, created on demand (declared last to stop it before anything else is destroyed)
+	std::unique_ptr<AsyncCosts> async_costs_;
 };
 PIMPL_FUNCTIONS(Stage)
 std::ostream& operator<<(std::ostream& os, const StagePrivate& stage);
@@ -339,17 +525,115 @@ public:
 		}
 	};
 
+	/** Pending state pairs of a Connecting stage, generated lazily from both interfaces
+	 *
+	 * Instead of materializing all N x M pairs of start and end states in a sorted list, only the registered states,
+	 * the incompatible pairs, and the already consumed pairs are remembered (in hash tables).
+	 * As both interfaces are sorted, the best pending pair is found by a best-first search through the grid of
+	 * enabled pairs, which only visits the consumed or incompatible pairs dominating it.
+	 * The search frontier is kept until states are added, forgotten, or change their priority,
+	 * such that popping pairs in sequence visits each consumed pair only once.
+	 * Pairs with equal priority are ordered by the arrival of their states.
+	 * Additionally, individual pairs can be inserted explicitly, as done by Fallbacks for its later children.
+	 */
+	class PendingPairs
+	{
+	public:
+		PendingPairs(const ConnectingPrivate* owner) : owner_(owner) {}
+
+		/// register a new interface state: it forms a pending pair with all compatible opposite states
+		void add(const InterfaceState* state);
+		/// mark the pair (from, to) as incompatible, i.e. not pending
+		void setIncompatible(const InterfaceState* from, const InterfaceState* to);
+		/// explicitly insert a single pair
+		void insert(const StatePair& pair);
+		/// notify about changed priorities of interface states
+		void invalidate() { top_valid_ = search_valid_ = false; }
+		/// forget a state evicted from its interface, including all pairs involving it
+		void forget(const InterfaceState* state);
+		void clear();
+
+		/// is (from, to) a pending pair, regardless of the states' status?
+		bool contains(const InterfaceState* from, const InterfaceState* to) const;
+		/// best feasible (i.e. both states enabled) pending pair, nullptr if there is none
+		const StatePair* top() const;
+		/// remove and return the best feasible pending pair
+		StatePair pop();
+
+		/// all pending pairs, sorted by priority
+		std::vector<StatePair> sorted() const;
+		bool empty() const;
+
+	private:
+		using Key = std::pair<const InterfaceState*, const InterfaceState*>;
+		struct KeyHash
+		{
+			size_t operator()(const Key& key) const {
+				size_t seed = std::hash<const InterfaceState*>()(key.first);
+				return seed ^ (std::hash<const InterfaceState*>()(key.second) + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+			}
+		};
+		// ordering of pairs: by priority, then by arrival of the (later, earlier) state
+		bool less(const StatePair& lhs, const StatePair& rhs) const;
+		// registered states of interface in order, only enabled ones if requested
+		std::vector<Interface::const_iterator> states(const Interface& interface, bool enabled_only) const;
+
+		const ConnectingPrivate* owner_;
+		std::unordered_map<const InterfaceState*, size_t> arrival_;  // registered states and their arrival index
+		std::unordered_set<Key, KeyHash> incompatible_;
+		// computed pairs, and pairs found by top() to exceed max_pair_distance, which are never tried
+		mutable std::unordered_set<Key, KeyHash> consumed_;
+		std::unordered_map<Key, std::pair<size_t, StatePair>, KeyHash> explicit_;  // insertion index and pair
+		size_t num_inserted_ = 0;
+		// distances of pending pairs evaluated so far, if needed by prefer_close_pairs or max_pair_distance
+		mutable std::unordered_map<Key, double, KeyHash> distances_;
+		double distance(const StatePair& pair) const;
+		bool tooFar(const StatePair& pair) const;
+		// whether pairs are close to a failure, valid for num_failures_seen_ failures of the owner
+		mutable std::unordered_map<Key, bool, KeyHash> near_failure_;
+		mutable size_t num_failures_seen_ = 0;
+		bool nearFailure(const StatePair& pair) const;
+
+		// frontier of the best-first search of top(), on the grid of enabled search_starts_ x search_ends_
+		struct Cell
+		{
+			size_t start;
+			size_t end;
+			bool expanded;  // successors were pushed already
+		};
+		mutable bool search_valid_ = false;
+		mutable std::vector<Interface::const_iterator> search_starts_;
+		mutable std::vector<Interface::const_iterator> search_ends_;
+		mutable std::vector<Cell> frontier_;  // heap, best cell first
+
+		// cached result of top()
+		mutable bool top_valid_ = false;
+		mutable bool has_top_ = false;
+		mutable StatePair top_;
+	};
+
 	inline ConnectingPrivate(Connecting* me, const std::string& name);
 
 	InterfaceFlags requiredInterface() const override;
 	bool canCompute() const override;
 	void compute() override;
+	/// revive deferred states (beyond the beam if needed) once no pair is pending anymore
+	void refill() override;
 
 	// Check whether there are pending feasible states that could connect to source
 	template <Interface::Direction dir>
 	bool hasPendingOpposites(const InterfaceState* source, const InterfaceState* target) const;
 
 	PendingPairsPrinter pendingPairsPrinter() const { return PendingPairsPrinter(this); }
+	/// distance between the states of a pair, see Connecting::pairDistance()
+	double pairDistance(const InterfaceState& from, const InterfaceState& to) const;
+
+	/// remember the failed pair (from, to), see Connecting::setFailureTolerance()
+	void addFailure(const InterfaceState& from, const InterfaceState& to);
+	/// whether (from, to) is within failure_tolerance_ of a failed pair
+	bool nearFailure(const InterfaceState& from, const InterfaceState& to) const;
+
+	void onEvictState(const InterfaceState& state) override;
 
 private:
 	// Create a pair of Interface states for pending list, such that the order (start, end) is maintained
@@ -360,8 +644,24 @@ private:
 	template <Interface::Direction other>
 	void newState(Interface::iterator it, Interface::UpdateFlags updated);
 
-	// ordered list of pending state pairs
-	ordered<StatePair> pending;
+	// pending state pairs
+	PendingPairs pending;
+	bool prefer_close_pairs_ = false;
+	size_t close_pair_candidates_ = 0;  // 0: unlimited
+	double max_pair_distance_ = 0.0;  // 0: unlimited
+	double failure_tolerance_ = 0.0;  // 0: failures are not remembered
+	bool skip_near_failures_ = false;
+
+	// failed pairs, grouped by a hash of the world and allowed collisions of both scenes
+	struct Failure
+	{
+		const InterfaceState* from;
+		const InterfaceState* to;
+	};
+	std::unordered_map<size_t, std::vector<Failure>> failures_;
+	size_t num_failures_ = 0;
+	mutable std::unordered_map<const InterfaceState*, size_t> scene_hashes_;
+	size_t sceneHash(const InterfaceState& state) const;
 };
 PIMPL_FUNCTIONS(Connecting)
 
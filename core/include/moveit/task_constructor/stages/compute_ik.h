@@ -36,20 +36,33 @@
 
 #pragma once
 
+#include <moveit/task_constructor/batch_ik.h>
 #include <moveit/task_constructor/container.h>
 #include <moveit/task_constructor/cost_queue.h>
+#include <moveit/task_constructor/reachability_map.h>
 #include <geometry_msgs/PoseStamped.h>
+#include <moveit_msgs/Constraints.h>
 #include <Eigen/Geometry>
+#include <atomic>
+#include <deque>
+#include <mutex>
 
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotState);
 MOVEIT_CLASS_FORWARD(JointModelGroup);
+MOVEIT_CLASS_FORWARD(LinkModel);
 }  // namespace core
 }  // namespace moveit
+namespace kinematic_constraints {
+MOVEIT_CLASS_FORWARD(KinematicConstraintSet);
+}
 
 namespace moveit {
 namespace task_constructor {
+namespace utils {
+class ThreadPool;
+}
 namespace stages {
 
 /** Wrapper for any pose generator stage to compute IK poses for a Cartesian pose.
@@ -69,6 +82,7 @@ class ComputeIK : public WrapperBase
 {
 public:
 	ComputeIK(const std::string& name = "IK", Stage::pointer&& child = Stage::pointer());
+	~ComputeIK() override;
 
 	void reset() override;
 	void init(const core::RobotModelConstPtr& robot_model) override;
@@ -109,9 +123,147 @@ public:
 	void setMaxIKSolutions(uint32_t n) { setProperty("max_ik_solutions", n); }
 	void setIgnoreCollisions(bool flag) { setProperty("ignore_collisions", flag); }
 	void setMinSolutionDistance(double distance) { setProperty("min_solution_distance", distance); }
+	/// process several IK seeds concurrently (requires a thread-safe kinematics solver), spawning in seed order
+	void setNumThreads(uint32_t n) { setProperty("num_threads", n); }
+	/** process up to n targets of the wrapped generator per compute()
+	 *
+	 * If num_threads > 1, targets of a batch are solved concurrently, using the task's thread pool or num_threads
+	 * threads, each with a single IK seed at a time. Like concurrent seeds, this requires a thread-safe kinematics
+	 * solver. This speeds up generators spawning many targets at once.
+	 */
+	void setBatchSize(uint32_t n) { setProperty("batch_size", n); }
+	/** solve the IK of all targets of a batch with a single call of solver (nullptr: per-target IK)
+	 *
+	 * The solver's candidates are validated and spawned per target, as usual. They replace the per-target
+	 * seeding, i.e. targets without candidates fail without trying other seeds.
+	 */
+	void setBatchIKSolver(const utils::BatchIKSolverPtr& solver) { setProperty("batch_ik_solver", solver); }
+
+	/** pre-screen targets with a reachability map of the ik frame, generated for the same robot, group, link, and offset
+	 *
+	 * Targets scoring below min_reachability (or never reached while generating the map) are rejected without IK.
+	 * With rank_by_reachability, pending targets are processed in order of decreasing score.
+	 */
+	void setReachabilityMap(const utils::ReachabilityMapConstPtr& map) { setProperty("reachability_map", map); }
+	void setMinReachability(double score) { setProperty("min_reachability", score); }
+	void setRankByReachability(bool flag) { setProperty("rank_by_reachability", flag); }
+
+	/** remember the last n IK solutions to seed IK of nearby targets (0: disabled)
+	 *
+	 * The solutions of the previous targets closest to a new target are tried as seeds first,
+	 * followed by the current state and random seeds.
+	 */
+	void setSeedCacheSize(uint32_t n) { setProperty("seed_cache_size", n); }
+	/** first query all IK solutions of a target in a single solver call (default: true)
+	 *
+	 * Analytic solvers like IKFast return all solution branches at once, such that no random seeds are needed.
+	 * Solvers not supporting this return a single solution from the current state as seed.
+	 */
+	void setMultiSolutionIK(bool flag) { setProperty("multi_solution_ik", flag); }
+
+	/// number of IK candidates rejected due to violated constraints (since last reset)
+	size_t numRejectedByConstraints() const { return num_rejected_by_constraints_; }
+	/// number of IK candidates rejected due to collisions (since last reset)
+	size_t numRejectedByCollision() const { return num_rejected_by_collision_; }
+	/// number of targets rejected by the reachability map (since last reset)
+	size_t numRejectedByReachability() const { return num_rejected_by_reachability_; }
 
 protected:
-	ordered<const SolutionBase*> upstream_solutions_;
+	struct IKTarget;
+	/// read properties from the target's interface state and validate the target pose, false if spawned or failed
+	bool prepareTarget(const SolutionBase& s, IKTarget& target);
+	/** solve IK for a prepared target and spawn its solutions (thread-safe for distinct targets)
+	 *
+	 * Returns false if the search was suspended at the end of the time slice (see utils::TimeSlice).
+	 * Calling it again with the same target resumes the search.
+	 */
+	bool solveTarget(IKTarget& target);
+	/// validity callback of the target's batch IK query, checking constraints and collisions
+	utils::BatchIKSolver::Validity batchValidity(const IKTarget& target) const;
+
+	/// bounded cache of IK solutions of previous targets, providing seeds for nearby targets (thread-safe)
+	class SeedCache
+	{
+	public:
+		/// change the number of retained solutions, dropping the oldest ones
+		void setCapacity(size_t capacity);
+		void clear();
+		void insert(const moveit::core::JointModelGroup* jmg, const Eigen::Isometry3d& target_pose,
+		            const std::vector<double>& solution);
+		/// joint values of up to k solutions whose target poses are closest to target_pose
+		std::vector<std::vector<double>> nearest(const moveit::core::JointModelGroup* jmg,
+		                                         const Eigen::Isometry3d& target_pose, size_t k) const;
+
+	private:
+		struct Entry
+		{
+			const moveit::core::JointModelGroup* jmg;
+			Eigen::Vector3d position;
+			Eigen::Matrix3d orientation;
+			std::vector<double> solution;
+		};
+		mutable std::mutex mutex_;
+		std::deque<Entry> entries_;  // oldest first
+		size_t capacity_ = 0;
+	};
+
+	/// reachability score of the solution's target pose, 0 if unknown
+	double reachabilityScore(const SolutionBase& s) const;
+
+	// upstream solution, ranked by reachability score (if enabled) and cost
+	struct RankedSolution
+	{
+		double score;
+		const SolutionBase* solution;
+		bool operator<(const RankedSolution& other) const {
+			if (score != other.score)
+				return score > other.score;
+			return *solution < *other.solution;
+		}
+	};
+	ordered<RankedSolution> upstream_solutions_;
+	// targets whose search was suspended at the end of a time slice, resumed before starting new ones
+	std::deque<std::unique_ptr<IKTarget>> suspended_targets_;
+	// pool for concurrent IK seeds, if the task doesn't provide one
+	std::shared_ptr<utils::ThreadPool> ik_thread_pool_;
+	std::atomic<size_t> num_rejected_by_constraints_{ 0 };
+	std::atomic<size_t> num_rejected_by_collision_{ 0 };
+	size_t num_rejected_by_reachability_ = 0;  // only modified in prepareTarget()
+	SeedCache seed_cache_;
+
+	// property-derived data cached across compute() calls, updated when the properties change
+	kinematic_constraints::KinematicConstraintSetPtr constraint_set_;
+	moveit_msgs::Constraints constraint_set_msg_;  // constraints used to build constraint_set_
+	bool constraint_set_scene_independent_ = false;
+	std::vector<double> compare_pose_;  // joint values of default_pose
+	std::string compare_pose_name_;
+	const moveit::core::JointModelGroup* compare_pose_jmg_ = nullptr;
+	// names of links with collision geometry of the subtree placed at the ik target and of the remaining robot
+	struct EEFLinks
+	{
+		const moveit::core::LinkModel* parent = nullptr;  // rigidly connected parent link of the subtree
+		std::vector<std::string> subtree;
+		std::vector<std::string> others;
+	};
+	EEFLinks eef_links_;  // cached for the most recent subtree
+	const EEFLinks& eefLinks(const moveit::core::RobotModel& robot_model, const moveit::core::LinkModel* parent);
+
+	// handles to properties read in compute(), resolved in init()
+	PropertyHandle<bool> ignore_collisions_;
+	PropertyHandle<geometry_msgs::PoseStamped> target_pose_;
+	PropertyHandle<geometry_msgs::PoseStamped> ik_frame_;
+	PropertyHandle<std::string> default_pose_;
+	PropertyHandle<double> min_solution_distance_;
+	PropertyHandle<moveit_msgs::Constraints> constraints_;
+	PropertyHandle<uint32_t> max_ik_solutions_;
+	PropertyHandle<uint32_t> num_threads_;
+	PropertyHandle<uint32_t> batch_size_;
+	PropertyHandle<utils::BatchIKSolverPtr> batch_ik_solver_;
+	PropertyHandle<utils::ReachabilityMapConstPtr> reachability_map_;
+	PropertyHandle<double> min_reachability_;
+	PropertyHandle<bool> rank_by_reachability_;
+	PropertyHandle<uint32_t> seed_cache_size_;
+	PropertyHandle<bool> multi_solution_ik_;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -51,6 +51,9 @@ MOVEIT_CLASS_FORWARD(RobotState);
 
 namespace moveit {
 namespace task_constructor {
+namespace utils {
+class ThreadPool;
+}
 namespace stages {
 
 /** Connect arbitrary InterfaceStates by motion planning
@@ -60,6 +63,16 @@ namespace stages {
  * specified order. Each planner only plan for joints within the corresponding planning group.
  * Finally, an attempt is made to merge the sub trajectories of individual planning results.
  * If this fails, the sequential planning result is returned.
+ *
+ * In CONCURRENT merge mode, all groups are planned at the same time, starting from the initial state.
+ * This is meant for disjoint groups that don't interact, e.g. two arms with independent goals.
+ * The merged trajectory is validated as a whole. If any group fails or merging fails,
+ * the pair is planned again sequentially.
+ *
+ * With goal_set enabled, pairs of a batch sharing their start state are planned in a single request towards
+ * all their goal states (see PlannerInterface::planGoalSet()). Each reached goal yields its own solution and
+ * is removed from the set for the next request, until planning fails for all remaining goals.
+ * This requires a single planning group and a batch_size > 1.
  */
 class Connect : public Connecting
 {
@@ -70,7 +83,8 @@ public:
 	enum MergeMode
 	{
 		SEQUENTIAL = 0,
-		WAYPOINTS = 1
+		WAYPOINTS = 1,
+		CONCURRENT = 2,  // plan all groups concurrently from the start state, then merge by waypoints
 	};
 
 	using GroupPlannerVector = std::vector<std::pair<std::string, solvers::PlannerInterfacePtr> >;
@@ -80,10 +94,13 @@ public:
 	void setPathConstraints(moveit_msgs::Constraints path_constraints) {
 		setProperty("path_constraints", std::move(path_constraints));
 	}
+	void setGoalSet(bool goal_set) { setProperty("goal_set", goal_set); }
 
 	void reset() override;
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 	void compute(const InterfaceState& from, const InterfaceState& to) override;
+	/// plan all pairs in lockstep, passing the requests of each group to planBatch() of its planner
+	void computeBatch(const StatePairs& pairs) override;
 
 protected:
 	SolutionSequencePtr makeSequential(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
@@ -98,6 +115,16 @@ protected:
 	moveit::core::JointModelGroupPtr merged_jmg_;
 	std::list<SubTrajectory> subsolutions_;
 	std::list<InterfaceState> states_;
+	// variable indices of joints not planned for by any group, computed in init()
+	std::vector<int> unplanned_variables_;
+	// threads for CONCURRENT planning if the task doesn't provide a thread pool
+	std::shared_ptr<utils::ThreadPool> group_thread_pool_;
+
+	// properties read in compute()
+	TypedProperty<MergeMode> merge_mode_;
+	TypedProperty<double> max_distance_;
+	TypedProperty<moveit_msgs::Constraints> path_constraints_;
+	TypedProperty<bool> goal_set_;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -40,17 +40,34 @@
 #pragma once
 
 #include <moveit/task_constructor/stage.h>
+#include <moveit/macros/class_forward.h>
+
+namespace planning_scene_monitor {
+MOVEIT_CLASS_FORWARD(PlanningSceneMonitor);
+}
 
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
-/** Fetch the current PlanningScene state via get_planning_scene service */
+/** Fetch the current PlanningScene state via get_planning_scene service
+ *
+ * If a PlanningSceneMonitor is provided, the scene is copied from the monitored scene instead,
+ * avoiding the service round-trip and the (de)serialization of the whole scene.
+ */
 class CurrentState : public Generator
 {
 public:
 	CurrentState(const std::string& name = "current state");
 
+	/** use given (already running) monitor instead of the get_planning_scene service
+	 *
+	 * The monitor needs to share the task's robot model, e.g. via Task::setRobotModel(monitor->getRobotModel()).
+	 */
+	void setPlanningSceneMonitor(const planning_scene_monitor::PlanningSceneMonitorPtr& monitor) { monitor_ = monitor; }
+	/// PlanningSceneComponents to request from the get_planning_scene service
+	void setComponents(uint32_t components) { setProperty("components", components); }
+
 	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
 	bool canCompute() const override;
 	void compute() override;
@@ -58,6 +75,7 @@ public:
 protected:
 	moveit::core::RobotModelConstPtr robot_model_;
 	planning_scene::PlanningScenePtr scene_;
+	planning_scene_monitor::PlanningSceneMonitorPtr monitor_;
 };
 }  // namespace stages
 }  // namespace task_constructor
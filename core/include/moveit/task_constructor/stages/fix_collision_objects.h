@@ -57,6 +57,11 @@ public:
 
 	void setDirection(const geometry_msgs::Vector3& dir) { setProperty("direction", dir); }
 	void setMaxPenetration(double penetration) { setProperty("max_penetration", penetration); }
+	/** resolve all penetrations of an object by a single least-squares translation per collision pass
+	 *
+	 * By default, objects are moved once per contacting body, requiring a collision pass per move.
+	 */
+	void setJointCorrection(bool joint) { setProperty("joint_correction", joint); }
 
 private:
 	SubTrajectory fixCollisions(planning_scene::PlanningScene& scene) const;
@@ -64,6 +64,23 @@ public:
 
 protected:
 	void onNewSolution(const SolutionBase& s) override;
+	/// scene of upstream solution s with the eef in pregrasp posture, nullptr (spawning a failure) if invalid
+	planning_scene::PlanningScenePtr pregraspScene(const SolutionBase& s);
+
+	// grasp pose candidates w.r.t. the object frame
+	struct Candidate
+	{
+		Eigen::Isometry3d pose;
+		std::string comment;
+	};
+	using Candidates = std::vector<Candidate, Eigen::aligned_allocator<Candidate>>;
+	/// candidates for given configuration, computed once and cached until the configuration changes
+	const Candidates& candidates(double angle_delta, const Eigen::Vector3d& rotation_axis);
+
+private:
+	Candidates candidates_;
+	double candidates_angle_delta_ = 0.0;
+	Eigen::Vector3d candidates_rotation_axis_ = Eigen::Vector3d::Zero();
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -40,6 +40,8 @@
 
 #include <moveit/task_constructor/stages/generate_pose.h>
 
+#include <map>
+
 namespace moveit {
 namespace task_constructor {
 namespace stages {
@@ -59,6 +61,18 @@ public:
 
 protected:
 	void onNewSolution(const SolutionBase& s) override;
+
+	// object pose candidates, relative to the nominal target pose
+	struct Candidate
+	{
+		Eigen::Matrix3d flip;  // flip about the object's x-axis, applied first
+		Eigen::Matrix3d rotation;  // rotation about world's z-axis (at the object's position)
+	};
+	/// candidates for given number of flips and rotations, computed once and cached
+	const std::vector<Candidate>& candidates(unsigned int z_flips, unsigned int z_rotations);
+
+private:
+	std::map<std::pair<unsigned int, unsigned int>, std::vector<Candidate>> candidates_;
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -41,6 +41,8 @@
 #include <moveit/task_constructor/stage.h>
 #include <moveit/task_constructor/cost_queue.h>
 #include <geometry_msgs/PoseStamped.h>
+#include <Eigen/Geometry>
+#include <functional>
 
 namespace moveit {
 namespace task_constructor {
@@ -57,9 +59,20 @@ public:
 
 	void setPose(const geometry_msgs::PoseStamped& pose) { setProperty("pose", pose); }
 
+	/** Predicate accepting target poses of the ik frame (w.r.t. the planning frame), which are possibly reachable
+	 *
+	 * This allows for rejecting candidates before IK is attempted, e.g. by lookup in a precomputed reachability map.
+	 */
+	using ReachabilityFilter = std::function<bool(const Eigen::Isometry3d& target_pose)>;
+	void setReachabilityFilter(ReachabilityFilter filter) { reachability_filter_ = std::move(filter); }
+
 protected:
 	void onNewSolution(const SolutionBase& s) override;
+	/// check target pose against the reachability filter, spawning a failure for rejected poses if requested
+	bool reachable(const planning_scene::PlanningSceneConstPtr& scene, const Eigen::Isometry3d& target_pose);
+
 	ordered<const SolutionBase*> upstream_solutions_;
+	ReachabilityFilter reachability_filter_;
 };
 }  // namespace stages
 }  // namespace task_constructor
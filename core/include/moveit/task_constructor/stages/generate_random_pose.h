@@ -51,6 +51,7 @@ class GenerateRandomPose : public GeneratePose
 public:
 	GenerateRandomPose(const std::string& name = "generate random pose");
 
+	void reset() override;
 	bool canCompute() const override;
 	void compute() override;
 
@@ -77,6 +78,9 @@ public:
 	 * The order in which the PoseDimension samplers are specified matters as the samplers are applied in sequence.
 	 * That way it's possible to implement different Euler angles (i.e. XYZ, ZXZ, YXY) or even construct more complex
 	 * sampling regions by applying translations after rotations.
+	 *
+	 * The samplers draw from a random number engine owned by the stage. Thus, distinct stages can safely
+	 * compute in parallel threads.
 	 */
 	template <template <class Realtype = double> class RandomNumberDistribution>
 	void sampleDimension(const PoseDimension pose_dimension, double width) {
@@ -91,6 +95,19 @@ public:
 	/** Limit the number of generated solutions */
 	void setMaxSolutions(size_t max_solutions) { setProperty("max_solutions", max_solutions); }
 
+	/** Seed the stage's random number engine to generate reproducible samples (0: seed from std::random_device)
+	 *
+	 * The engine is reseeded on reset(), i.e. each plan() of the task yields the same sequence of samples.
+	 */
+	void setSeed(uint32_t seed) { setProperty("seed", seed); }
+
+	/** Draw uniform distributions from a Halton sequence instead of the random number engine
+	 *
+	 * The low-discrepancy sequence covers the sampling region more evenly than random samples,
+	 * thus requiring fewer samples to find a feasible pose. Normal distributions remain randomized.
+	 */
+	void setLowDiscrepancy(bool enable) { setProperty("low_discrepancy", enable); }
+
 private:
 	/** Allocate the sampler function for the specified random distribution */
 	template <template <class Realtype = double> class RandomNumberDistribution>
@@ -99,7 +116,25 @@ private:
 		throw 0;  // suppress -Wreturn-type
 	}
 
+	/** Sample from [0, 1) for the given sampler index, either randomly or from the Halton sequence */
+	double uniformSample(size_t sampler_index);
+	void spawnTargetPose(const geometry_msgs::PoseStamped& target_pose);
+
+	// sampling around the seed pose of an upstream solution, possibly suspended at the end of a time slice
+	struct Sampling
+	{
+		const SolutionBase* solution = nullptr;  // nullptr if no sampling is pending
+		planning_scene::PlanningScenePtr scene;  // shared by all spawned states
+		geometry_msgs::PoseStamped seed_pose;
+		double elapsed_time = 0.0;  // sampling time spent so far, limited by the timeout
+		size_t spawned_solutions = 0;
+	};
+	Sampling sampling_;
+
 	std::vector<std::pair<PoseDimension, PoseDimensionSampler>> pose_dimension_samplers_;
+	std::mt19937 engine_;
+	bool low_discrepancy_ = false;
+	size_t sample_index_ = 0;  // index of the current pose sample in the Halton sequence
 };
 template <>
 GenerateRandomPose::PoseDimensionSampler
@@ -0,0 +1,103 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Wrapper caching the solutions of its child for identical inputs
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/container.h>
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+class MemoizePrivate;
+/** Wrapper caching the solutions of a propagating child, keyed on a hash of the received state
+ *
+ * States with a known key are not passed to the child anymore. Instead, all solutions (or the failure)
+ * the child reported for this key before are replayed. The cache survives reset() and re-planning,
+ * such that expensive propagators (e.g. MoveTo, MoveRelative) are computed only once for recurring inputs.
+ *
+ * By default, the key comprises the world objects, attached bodies, and allowed collisions of the scene,
+ * the robot state, all quantized to resolution, the (serializable) properties of the wrapped stage at init(),
+ * as well as the properties named in key_properties, looked up in the received state, or else in the wrapped stage.
+ * Anything else affecting the child's result needs to be covered by a custom key (or clearCache()).
+ * Only SubTrajectory solutions are cached, i.e. the child cannot be a container.
+ *
+ * States received while the child is still computing the same key are not passed to the child again,
+ * but receive the child's outcomes as they arrive. At most max_cache_size keys are kept,
+ * dropping the least recently used ones first.
+ */
+class Memoize : public WrapperBase
+{
+public:
+	PRIVATE_CLASS(Memoize)
+	using KeyFunction = std::function<size_t(const InterfaceState&)>;
+
+	Memoize(const std::string& name = "memoize", Stage::pointer&& child = Stage::pointer());
+
+	void reset() override;
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+
+	void onNewSolution(const SolutionBase& s) override;
+
+	/// custom key of a received state, replacing defaultKey()
+	void setKey(const KeyFunction& key) { setProperty("key", key); }
+	/// names of properties contributing to the default key
+	void setKeyProperties(const std::vector<std::string>& names) { setProperty("key_properties", names); }
+	/// joint values (rad, m) and object poses are distinguished with the given resolution
+	void setResolution(double resolution) { setProperty("resolution", resolution); }
+	/// maximum number of cached keys (0: unlimited)
+	void setMaxCacheSize(size_t size) { setProperty("max_cache_size", size); }
+
+	/// default key of a received state
+	size_t defaultKey(const InterfaceState& state) const;
+
+	/// drop all cached solutions
+	void clearCache();
+	/// number of cached keys
+	size_t cacheSize() const;
+	/// number of received states answered from the cache
+	size_t hits() const;
+	/// number of received states passed to the child
+	size_t misses() const;
+};
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -42,7 +42,9 @@
 #include <moveit/task_constructor/properties.h>
 #include <moveit/task_constructor/type_traits.h>
 #include <moveit_msgs/CollisionObject.h>
+#include <moveit/collision_detection/collision_common.h>
 #include <map>
+#include <set>
 
 namespace moveit {
 namespace core {
@@ -75,6 +77,14 @@ public:
 	/// call an arbitrary function
 	void setCallback(const ApplyCallback& cb) { callback_ = cb; }
 
+	/** only validate collisions involving objects affected by the modifications
+	 *
+	 * Collisions present in the incoming scene are not detected anymore. If the modifications can only remove
+	 * collisions (removing objects, allowing collisions), the collision check is skipped entirely.
+	 * A callback always triggers a full check.
+	 */
+	void setIncrementalCollisionCheck(bool incremental) { setProperty("incremental_collision_check", incremental); }
+
 	/// attach or detach a list of objects to the given link
 	void attachObjects(const Names& objects, const std::string& attach_link, bool attach);
 	/// Add an object to the planning scene
@@ -148,15 +158,23 @@ protected:
 	};
 	std::list<CollisionMatrixPairs> collision_matrix_edits_;
 	ApplyCallback callback_;
+	// collision request shared by all apply() calls
+	collision_detection::CollisionRequest collision_request_;
 
 protected:
 	// apply stored modifications to scene
 	std::pair<InterfaceState, SubTrajectory> apply(const InterfaceState& from, bool invert);
 	void processCollisionObject(planning_scene::PlanningScene& scene, const moveit_msgs::CollisionObject& object,
 	                            bool invert);
+	/// process all collision_objects_, failing before any modification if one of them cannot be applied
+	void processCollisionObjects(planning_scene::PlanningScene& scene, bool invert);
 	void attachObjects(planning_scene::PlanningScene& scene, const std::pair<std::string, std::pair<Names, bool>>& pair,
 	                   bool invert);
 	void allowCollisions(planning_scene::PlanningScene& scene, const CollisionMatrixPairs& pairs, bool invert);
+	/** names of objects whose collisions might be affected by the modifications, false if all need to be checked
+	 *
+	 * An empty set indicates that the modifications can only remove collisions. */
+	bool affectedNames(std::set<std::string>& names, bool invert) const;
 };
 
 inline void ModifyPlanningScene::attachObject(const std::string& object, const std::string& link) {
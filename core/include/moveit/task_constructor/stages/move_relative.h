@@ -44,6 +44,11 @@
 #include <geometry_msgs/TwistStamped.h>
 #include <geometry_msgs/Vector3Stamped.h>
 
+#include <string>
+#include <vector>
+#include <mutex>
+#include <unordered_map>
+
 namespace moveit {
 namespace core {
 class RobotState;
@@ -53,7 +58,17 @@ namespace moveit {
 namespace task_constructor {
 namespace stages {
 
-/** Perform a Cartesian motion relative to some link */
+/** Perform a Cartesian motion relative to some link
+ *
+ * With precheck enabled, a few poses along the required distance (min_distance, or the full one if negative) are
+ * probed for collision-free IK solutions before planning a Cartesian motion. If one of them fails, the stage fails
+ * without planning. As IK might not find a solution that Cartesian planning would reach, this is disabled by default.
+ *
+ * With a positive cache_resolution, results are cached by the start state (quantized to this resolution),
+ * its collision environment (compared by hash), the propagation direction, and the motion specification.
+ * Start states matching a cached entry reuse its trajectory instead of planning again,
+ * which pays off if many states share their start configuration, e.g. grasp candidates in Pick/Place.
+ */
 class MoveRelative : public PropagatingEitherWay
 {
 public:
@@ -93,6 +108,12 @@ public:
 	/// move specified joint variables by given amount
 	void setDirection(const std::map<std::string, double>& joint_deltas) { setProperty("direction", joint_deltas); }
 
+	/// probe IK along the required distance before Cartesian planning (default: false)
+	void setPrecheck(bool precheck) { setProperty("precheck", precheck); }
+
+	/// reuse results for start states matching within resolution (0: disable caching)
+	void setCacheResolution(double resolution) { setProperty("cache_resolution", resolution); }
+
 protected:
 	// return false if trajectory shouldn't be stored
 	bool compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& trajectory,
@@ -100,6 +121,41 @@ protected:
 
 protected:
 	solvers::PlannerInterfacePtr planner_;
+
+private:
+	bool plan(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& trajectory,
+	          Interface::Direction dir);
+
+	/// full cache key, compared on hash hits to reject hash collisions
+	struct CacheKey
+	{
+		Interface::Direction dir;
+		size_t scene_hash;  // collision environment and allowed collisions
+		std::string specification;  // serialized motion specification
+		std::vector<long> positions;  // quantized start state
+		size_t hash;
+
+		bool operator==(const CacheKey& other) const {
+			return hash == other.hash && dir == other.dir && scene_hash == other.scene_hash &&
+			       positions == other.positions && specification == other.specification;
+		}
+	};
+	struct CacheKeyHash
+	{
+		size_t operator()(const CacheKey& key) const { return key.hash; }
+	};
+	CacheKey cacheKey(const InterfaceState& state, Interface::Direction dir, double resolution) const;
+
+	struct CacheEntry
+	{
+		bool stored;  // return value of compute()
+		robot_trajectory::RobotTrajectoryPtr trajectory;  // never modified after caching
+		bool failure;
+		std::string comment;
+		std::vector<visualization_msgs::Marker> markers;
+	};
+	std::mutex cache_mutex_;  // stages might be computed concurrently
+	std::unordered_map<CacheKey, CacheEntry, CacheKeyHash> cache_;  // cleared by init()
 };
 }  // namespace stages
 }  // namespace task_constructor
@@ -43,6 +43,8 @@
 #include <moveit_msgs/Constraints.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/PointStamped.h>
+#include <boost/any.hpp>
+#include <vector>
 
 namespace moveit {
 namespace core {
@@ -51,6 +53,9 @@ class RobotState;
 }  // namespace moveit
 namespace moveit {
 namespace task_constructor {
+namespace solvers {
+MOVEIT_CLASS_FORWARD(CachingPlanner);
+}
 namespace stages {
 
 class MoveTo : public PropagatingEitherWay
@@ -90,11 +95,16 @@ public:
 		setProperty("path_constraints", std::move(path_constraints));
 	}
 
+	/// reuse trajectories to joint-space goals planned from identical start states (see solvers::CachingPlanner)
+	void setCachePlans(bool flag) { setProperty("cache_plans", flag); }
+
 protected:
 	// return false if trajectory shouldn't be stored
 	bool compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& trajectory,
 	             Interface::Direction dir) override;
 	bool getJointStateGoal(const boost::any& goal, const core::JointModelGroup* jmg, moveit::core::RobotState& state);
+	/// apply a joint-space goal to state, resolving it via getJointStateGoal() only if goal or group changed
+	bool applyJointStateGoal(const boost::any& goal, const core::JointModelGroup* jmg, moveit::core::RobotState& state);
 	bool getPoseGoal(const boost::any& goal, const planning_scene::PlanningScenePtr& scene,
 	                 Eigen::Isometry3d& target_eigen);
 	bool getPointGoal(const boost::any& goal, const Eigen::Isometry3d& ik_pose,
@@ -102,6 +112,18 @@ protected:
 
 protected:
 	solvers::PlannerInterfacePtr planner_;
+	solvers::CachingPlannerPtr caching_planner_;  // planner_ wrapped into a CachingPlanner, if cache_plans is set
+
+	// goal resolved by the last call of applyJointStateGoal()
+	struct ResolvedGoal
+	{
+		boost::any goal;
+		const core::JointModelGroup* jmg = nullptr;
+		bool is_joint_goal = false;
+		std::vector<int> variables;  // variables defined by a joint goal
+		std::vector<double> positions;
+	};
+	ResolvedGoal resolved_goal_;
 };
 }  // namespace stages
 }  // namespace task_constructor
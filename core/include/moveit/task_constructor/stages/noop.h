@@ -55,7 +55,7 @@ public:
 private:
 	bool compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& /*trajectory*/,
 	             Interface::Direction /*dir*/) override {
-		scene = state.scene()->diff();
+		scene = utils::diffScene(state.scene());
 		return true;
 	};
 };
@@ -52,11 +52,16 @@ namespace stages {
  * All solutions of the wrapped class are passed to predicate.
  * Solutions are accepted if predicate(s) == true.
  * Rejected solutions are forwarded as failures with an optional comment
+ *
+ * Additionally (or alternatively), a state_predicate filters the interface states received by the wrapper
+ * before they are passed to the wrapped child, avoiding to compute solutions that would be rejected anyway.
+ * For a propagating child, rejected states are reported as failures with an optional comment.
  */
 class PredicateFilter : public WrapperBase
 {
 public:
 	using Predicate = std::function<bool(const SolutionBase&, std::string&)>;
+	using StatePredicate = std::function<bool(const InterfaceState&, std::string&)>;
 
 	PredicateFilter(const std::string& name, Stage::pointer&& child = Stage::pointer());
 
@@ -65,6 +70,7 @@ public:
 	void onNewSolution(const SolutionBase& s) override;
 
 	void setPredicate(const Predicate& p) { setProperty("predicate", p); }
+	void setStatePredicate(const StatePredicate& p) { setProperty("state_predicate", p); }
 	void setIgnoreFilter(bool ignore) { setProperty("ignore_filter", ignore); }
 };
 }  // namespace stages
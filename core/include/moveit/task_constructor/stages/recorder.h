@@ -0,0 +1,90 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Wrapper recording the inputs of its child, to replay them in isolation
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/container.h>
+#include <moveit_task_constructor_msgs/RecordedProperty.h>
+#include <moveit_task_constructor_msgs/StageTrace.h>
+
+#include <string>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+class RecorderPrivate;
+/** Wrapper recording all states passed to its child, including their scenes and properties
+ *
+ * Together with the child's properties after initialization, the recorded trace allows for replaying
+ * the inputs of a production task into a freshly created stage of the same type, e.g. to profile it in isolation.
+ * The trace accumulates over several planning runs until clear() is called.
+ *
+ * Property values are recorded via Property::serialize(), apart from the common geometry_msgs types,
+ * which are stored as ROS-serialized messages. Values of other types cannot be restored on replay.
+ */
+class Recorder : public WrapperBase
+{
+public:
+	PRIVATE_CLASS(Recorder)
+
+	Recorder(const std::string& name = "recorder", Stage::pointer&& child = Stage::pointer());
+
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	void onNewSolution(const SolutionBase& s) override;
+
+	/// copy of the inputs recorded so far
+	moveit_task_constructor_msgs::StageTrace trace() const;
+	/// number of recorded inputs
+	size_t size() const;
+	/// drop all recorded inputs
+	void clear();
+
+	/// write trace() to file, throws std::runtime_error on failure
+	void save(const std::string& filename) const;
+	/// read a trace written by save(), throws std::runtime_error on failure
+	static moveit_task_constructor_msgs::StageTrace load(const std::string& filename);
+
+	/// record a property value, returns false if its type cannot be restored
+	static bool encode(const std::string& name, const boost::any& value,
+	                   moveit_task_constructor_msgs::RecordedProperty& msg);
+	/// restore a recorded property value, empty if its type is unknown
+	static boost::any decode(const moveit_task_constructor_msgs::RecordedProperty& msg);
+};
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
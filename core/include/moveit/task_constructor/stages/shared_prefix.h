@@ -0,0 +1,107 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Generator spawning the end states of a prefix Task shared by several Tasks
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/stage.h>
+#include <moveit/task_constructor/task.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+/** Spawn the end states of a prefix Task, which is planned only once for all Tasks sharing it
+ *
+ * Tasks often start with the same sub-pipeline, e.g. CurrentState, an IK fan-out, and a common approach motion.
+ * Instead of replicating (and recomputing) these stages in each Task, put them into a single prefix Task and
+ * start all consuming Tasks with a SharedPrefix stage referring to it. The first SharedPrefix to compute
+ * plans the prefix, all others (also concurrently planned Tasks) wait for and reuse its solutions.
+ * Each prefix solution spawns a solution of this stage, which reports the prefix trajectories in toMsg(),
+ * such that the consuming Task's solutions can be executed from the very start of the prefix.
+ *
+ * The prefix needs to outlive all solutions of the consuming Tasks. Its solutions persist across reset()
+ * of the consuming Tasks. To plan the prefix again, reset all consuming Tasks first, then call Source::reset().
+ */
+class SharedPrefix : public Generator
+{
+public:
+	/// prefix Task shared by several SharedPrefix stages
+	class Source
+	{
+	public:
+		Source(Task&& task, size_t max_solutions = 0) : task_(std::move(task)), max_solutions_(max_solutions) {}
+
+		Task& task() { return task_; }
+		/// plan the prefix Task, unless it was planned before (blocking concurrent callers until done)
+		moveit::core::MoveItErrorCode plan();
+		/// plan the prefix Task again on next plan(), invalidating solutions of consuming Tasks
+		void reset();
+		/// number of times the prefix Task was planned
+		size_t runs() const { return runs_; }
+
+	private:
+		std::mutex mutex_;
+		Task task_;
+		size_t max_solutions_;
+		bool planned_ = false;
+		size_t runs_ = 0;
+		moveit::core::MoveItErrorCode result_;
+	};
+	using SourcePtr = std::shared_ptr<Source>;
+
+	SharedPrefix(const std::string& name = "shared prefix", SourcePtr source = SourcePtr());
+	void setSource(SourcePtr source) { source_ = std::move(source); }
+	const SourcePtr& source() const { return source_; }
+
+	void reset() override;
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override;
+	bool canCompute() const override;
+	void compute() override;
+
+protected:
+	SourcePtr source_;
+	/// prefix solutions referenced by our solutions
+	std::vector<SolutionBaseConstPtr> prefixes_;
+	bool ran_ = false;
+};
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,95 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Stream grasp poses from a memory-mapped grasp database
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/stages/generate_grasp_pose.h>
+#include <moveit/task_constructor/grasp_database.h>
+
+#include <deque>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+/** Generate grasp poses for an object from a precomputed grasp database, best ones first
+ *
+ * Like GenerateGraspPose, the stage monitors the stage providing the eef in pregrasp posture.
+ * For each of its solutions, the database's grasps are streamed lazily: each compute() spawns the next
+ * chunk_size grasps only, decoded from the memory-mapped file on demand. Thus, the full set of grasps never
+ * resides in memory or in the downstream interface. With max_pending, streaming pauses until the stage's
+ * downstream interface has processed its states, such that grasps are only generated as the consumer drains them.
+ * Streaming stops at the first grasp below min_quality. Costs are the quality difference w.r.t. the best grasp.
+ */
+class StreamGraspPoses : public GenerateGraspPose
+{
+public:
+	StreamGraspPoses(const std::string& name = "stream grasp poses");
+
+	void reset() override;
+	void init(const core::RobotModelConstPtr& robot_model) override;
+	bool canCompute() const override;
+	void compute() override;
+
+	void setDatabase(const utils::GraspDatabaseConstPtr& db) { setProperty("database", db); }
+	/// number of grasps spawned per compute()
+	void setChunkSize(uint32_t n) { setProperty("chunk_size", n); }
+	/// pause while the downstream interface holds at least n unprocessed states (0: never pause)
+	void setMaxPending(uint32_t n) { setProperty("max_pending", n); }
+	void setMinQuality(double quality) { setProperty("min_quality", quality); }
+
+	/// number of grasps spawned so far (since last reset)
+	size_t numStreamed() const { return num_streamed_; }
+
+protected:
+	void onNewSolution(const SolutionBase& s) override;
+
+private:
+	// read position in the database for an upstream solution
+	struct Stream
+	{
+		const SolutionBase* solution;
+		planning_scene::PlanningSceneConstPtr scene;  // with pregrasp posture, created on first use
+		size_t next;
+	};
+	std::deque<Stream> streams_;
+	size_t num_streamed_ = 0;
+};
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
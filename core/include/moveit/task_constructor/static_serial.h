@@ -0,0 +1,154 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Serial container of a fixed sequence of stage types, validated at compile time
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/container.h>
+
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace detail {
+/// how a stage type interfaces with a neighbor: pulling states from it, pushing states to it, or resolved at runtime
+enum class Side
+{
+	PULL,
+	PUSH,
+	ANY
+};
+
+/// interface sides of a stage type, known by its base class
+template <typename S>
+struct StageSides
+{
+	static constexpr Side start() {
+		return std::is_base_of<Generator, S>::value           ? Side::PUSH :
+		       std::is_base_of<Connecting, S>::value          ? Side::PULL :
+		       std::is_base_of<PropagatingForward, S>::value  ? Side::PULL :
+		       std::is_base_of<PropagatingBackward, S>::value ? Side::PUSH :
+		                                                        Side::ANY;
+	}
+	static constexpr Side end() {
+		return std::is_base_of<Generator, S>::value           ? Side::PUSH :
+		       std::is_base_of<Connecting, S>::value          ? Side::PULL :
+		       std::is_base_of<PropagatingForward, S>::value  ? Side::PUSH :
+		       std::is_base_of<PropagatingBackward, S>::value ? Side::PULL :
+		                                                        Side::ANY;
+	}
+};
+
+/// neighbors need to complement each other: one pushes what the other pulls
+constexpr bool compatible(Side end, Side start) {
+	return end == Side::ANY || start == Side::ANY || end != start;
+}
+
+/// are all adjacent stages of a serial sequence compatible?
+template <typename... Stages>
+struct ValidSerial : std::true_type
+{};
+template <typename First, typename Second, typename... Rest>
+struct ValidSerial<First, Second, Rest...>
+  : std::integral_constant<bool, compatible(StageSides<First>::end(), StageSides<Second>::start()) &&
+                                     ValidSerial<Second, Rest...>::value>
+{};
+
+template <typename... Ts>
+struct AllStages : std::true_type
+{};
+template <typename T, typename... Rest>
+struct AllStages<T, Rest...>
+  : std::integral_constant<bool, std::is_base_of<Stage, T>::value && AllStages<Rest...>::value>
+{};
+}  // namespace detail
+
+/** SerialContainer of a fixed sequence of stage types
+ *
+ * The interfaces of adjacent stages are validated at compile time, as far as they are known from the stages'
+ * base classes (Generator, PropagatingForward/Backward, Connecting). E.g. two adjacent generators or a
+ * Connecting stage following a PropagatingBackward stage are rejected by the compiler.
+ * Stages deriving from PropagatingEitherWay or ContainerBase are resolved at runtime as usual.
+ *
+ * Children are accessible with their type via get<I>(), without lookup or dynamic_cast.
+ * The sequence is fixed: inserting or removing children throws.
+ */
+template <typename... Stages>
+class StaticSerial : public SerialContainer
+{
+	static_assert(sizeof...(Stages) > 0, "StaticSerial requires at least one stage");
+	static_assert(detail::AllStages<Stages...>::value, "StaticSerial requires Stage types");
+	static_assert(detail::ValidSerial<Stages...>::value, "adjacent stages of StaticSerial have incompatible interfaces");
+
+public:
+	StaticSerial(const std::string& name, std::unique_ptr<Stages>... stages)
+	  : SerialContainer(name), stages_(stages.get()...) {
+		using expand = int[];
+		(void)expand{ 0, (SerialContainer::insert(std::move(stages)), 0)... };
+	}
+	/// default-construct all stages
+	StaticSerial(const std::string& name = "static serial") : StaticSerial(name, std::make_unique<Stages>()...) {}
+
+	template <size_t I>
+	using StageType = typename std::tuple_element<I, std::tuple<Stages...>>::type;
+
+	template <size_t I>
+	StageType<I>& get() {
+		return *std::get<I>(stages_);
+	}
+	template <size_t I>
+	const StageType<I>& get() const {
+		return *std::get<I>(stages_);
+	}
+
+	void insert(Stage::pointer&& /*stage*/, int /*before*/ = -1) override {
+		throw std::runtime_error("StaticSerial: cannot insert into a fixed sequence");
+	}
+	Stage::pointer remove(int /*pos*/) override { throw std::runtime_error("StaticSerial: cannot remove children"); }
+	Stage::pointer remove(Stage* /*child*/) override {
+		throw std::runtime_error("StaticSerial: cannot remove children");
+	}
+	void clear() override { throw std::runtime_error("StaticSerial: cannot remove children"); }
+
+private:
+	std::tuple<Stages*...> stages_;
+};
+}  // namespace task_constructor
+}  // namespace moveit
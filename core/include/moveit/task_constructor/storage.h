@@ -41,16 +41,22 @@
 
 #include <moveit/macros/class_forward.h>
 #include <moveit/task_constructor/properties.h>
+#include <moveit/task_constructor/compact_trajectory.h>
 #include <moveit/task_constructor/cost_queue.h>
 #include <moveit/task_constructor/utils.h>
+#include <moveit/task_constructor/small_vector.h>
 #include <moveit_task_constructor_msgs/Solution.h>
 #include <visualization_msgs/MarkerArray.h>
 
+#include <cstdint>
+#include <atomic>
 #include <list>
+#include <memory>
 #include <vector>
-#include <deque>
+#include <unordered_set>
 #include <cassert>
 #include <functional>
+#include <mutex>
 
 namespace planning_scene {
 MOVEIT_CLASS_FORWARD(PlanningScene);
@@ -69,6 +75,26 @@ MOVEIT_CLASS_FORWARD(Interface);
 MOVEIT_CLASS_FORWARD(Stage);
 MOVEIT_CLASS_FORWARD(Introspection);
 
+/** Machine-readable reason of a failure
+ *
+ * Stages count their failures per code (Stage::numFailures(FailureCode)), which allows to
+ * query why planning failed even if no failure solutions (and their comments) are stored.
+ */
+enum class FailureCode : uint8_t
+{
+	NONE,  // no failure
+	UNSPECIFIED,  // failure without a specific reason
+	INVALID_INPUT,  // invalid configuration, e.g. unknown group, frame, or goal
+	COLLISION,  // state or motion in collision
+	NO_IK_SOLUTION,  // inverse kinematics failed
+	UNREACHABLE,  // target known to be unreachable, e.g. by a reachability map
+	CONSTRAINTS_VIOLATED,  // path or goal constraints not satisfied
+	PLANNING_FAILED,  // motion planner did not find a solution
+	COST,  // solution rejected by its cost term
+};
+constexpr size_t NUM_FAILURE_CODES = static_cast<size_t>(FailureCode::COST) + 1;
+const char* toString(FailureCode code);
+
 /** InterfaceState describes a potential start or goal state for a planning stage.
  *
  *  A start or goal state for planning is essentially defined by the state of a planning scene.
@@ -76,8 +102,7 @@ MOVEIT_CLASS_FORWARD(Introspection);
 class InterfaceState
 {
 	friend class SolutionBase;  // addIncoming() / addOutgoing() should be called only by SolutionBase
-	friend class Interface;  // allow Interface to set owner_ and priority_
-	friend class ContainerBasePrivate;  // allow setting priority_ for pruning
+	friend class Interface;  // allow Interface to set owner and priority
 
 public:
 	enum Status
@@ -91,24 +116,29 @@ public:
 	/** InterfaceStates are ordered according to two values:
 	 *  Depth of interlinked trajectory parts and accumulated trajectory costs along that path.
 	 *  Preference ordering considers high-depth first and within same depth, minimal cost paths.
+	 *  An optional estimate of the remaining cost (see Stage::setCostToGo()) is added to the cost for ordering.
 	 */
-	struct Priority : std::tuple<Status, unsigned int, double>
+	struct Priority : std::tuple<Status, unsigned int, double, double>
 	{
-		Priority(unsigned int depth, double cost, Status status)
-		  : std::tuple<Status, unsigned int, double>(status, depth, cost) {}
+		Priority(unsigned int depth, double cost, Status status, double estimate = 0.0)
+		  : std::tuple<Status, unsigned int, double, double>(status, depth, cost, estimate) {}
 		Priority(unsigned int depth, double cost) : Priority(depth, cost, std::isfinite(cost) ? ENABLED : PRUNED) {}
-		// Constructor copying depth and cost, but modifying its status
-		Priority(const Priority& other, Status status) : Priority(other.depth(), other.cost(), status) {}
+		// Constructor copying depth, cost, and estimate, but modifying its status
+		Priority(const Priority& other, Status status)
+		  : Priority(other.depth(), other.cost(), status, other.estimate()) {}
 
 		inline Status status() const { return std::get<0>(*this); }
 		inline bool enabled() const { return std::get<0>(*this) == ENABLED; }
 
 		inline unsigned int depth() const { return std::get<1>(*this); }
 		inline double cost() const { return std::get<2>(*this); }
+		/// estimated cost-to-go of the state
+		inline double estimate() const { return std::get<3>(*this); }
 
 		// add priorities
 		Priority operator+(const Priority& other) const {
-			return Priority(depth() + other.depth(), cost() + other.cost(), std::min(status(), other.status()));
+			return Priority(depth() + other.depth(), cost() + other.cost(), std::min(status(), other.status()),
+			                estimate() + other.estimate());
 		}
 		// comparison operators
 		bool operator<(const Priority& rhs) const;
@@ -116,7 +146,7 @@ public:
 		inline bool operator<=(const Priority& rhs) const { return !(rhs < *this); }
 		inline bool operator>=(const Priority& rhs) const { return !(*this < rhs); }
 	};
-	using Solutions = std::deque<SolutionBase*>;
+	using Solutions = utils::SmallVector<SolutionBase*, 2>;
 
 	/// create an InterfaceState from a planning scene
 	InterfaceState(const planning_scene::PlanningScenePtr& ps);
@@ -125,54 +155,121 @@ public:
 	/// provide an initial priority for the state (for internal use only)
 	InterfaceState(const planning_scene::PlanningSceneConstPtr& ps, const Priority& p);
 
+	/** create a lightweight InterfaceState, which differs from the base scene only in the robot's joint positions
+	 *
+	 * The actual planning scene (a diff of base) is created lazily on first access via scene().
+	 * This saves memory and time for states that are never expanded, e.g. failures or pruned branches.
+	 * positions need to provide values for all variables of the robot model.
+	 */
+	InterfaceState(const planning_scene::PlanningSceneConstPtr& base, std::vector<double> positions);
+
 	/// copy an existing InterfaceState, but not including incoming/outgoing trajectories
 	InterfaceState(const InterfaceState& other);
 	InterfaceState(InterfaceState&& other) = default;
 	InterfaceState& operator=(const InterfaceState& other) = default;
+	~InterfaceState();
 
-	inline const planning_scene::PlanningSceneConstPtr& scene() const { return scene_; }
-	inline const Solutions& incomingTrajectories() const { return incoming_trajectories_; }
-	inline const Solutions& outgoingTrajectories() const { return outgoing_trajectories_; }
+	inline const planning_scene::PlanningSceneConstPtr& scene() const {
+		return payload_->scene ? payload_->scene : payload_->lazy->scene();
+	}
+	/// scene() or, for a lightweight state, its base scene, whose world and attached bodies are shared
+	inline const planning_scene::PlanningSceneConstPtr& baseScene() const {
+		return payload_->scene ? payload_->scene : payload_->lazy->base;
+	}
+	/// joint positions of the robot state (not creating the scene of a lightweight state)
+	const double* variablePositions() const;
+	/** unique id of the state's scene, shared by all copies of the state
+	 *
+	 * Each state created from a scene (or base scene and positions) gets a new revision. As scenes of states
+	 * are immutable, caches keyed on the revision never need to be invalidated. See utils::stateHash()
+	 * for a key identifying equivalent scene content instead.
+	 */
+	inline uint64_t sceneRevision() const { return payload_->revision; }
+	inline const Solutions& incomingTrajectories() const { return schedule_.incoming_trajectories; }
+	inline const Solutions& outgoingTrajectories() const { return schedule_.outgoing_trajectories; }
 
+	/// properties of the state, which share their values with copies of the state (see PropertyMap)
 	PropertyMap& properties() { return properties_; }
 	const PropertyMap& properties() const { return properties_; }
 
 	/// states are ordered by priority
-	inline bool operator<(const InterfaceState& other) const { return this->priority_ < other.priority_; }
+	inline bool operator<(const InterfaceState& other) const {
+		return this->schedule_.priority < other.schedule_.priority;
+	}
 
-	inline const Priority& priority() const { return priority_; }
-	/// Update priority and call owner's notify() if possible
-	void updatePriority(const InterfaceState::Priority& priority);
+	inline const Priority& priority() const { return schedule_.priority; }
+	/** Update priority and call owner's notify() if possible
+	 *
+	 * Scheduling metadata is not part of the state's (immutable) payload. Hence, it can be updated on const states.
+	 */
+	void updatePriority(const InterfaceState::Priority& priority) const;
 	/// Update status, but keep current priority
-	void updateStatus(Status status);
+	void updateStatus(Status status) const;
 
-	Interface* owner() const { return owner_; }
+	Interface* owner() const { return schedule_.owner; }
 
 private:
 	// these methods should be only called by SolutionBase::set[Start|End]State()
-	inline void addIncoming(SolutionBase* t) { incoming_trajectories_.push_back(t); }
-	inline void addOutgoing(SolutionBase* t) { outgoing_trajectories_.push_back(t); }
+	inline void addIncoming(SolutionBase* t) const { schedule_.incoming_trajectories.push_back(t); }
+	inline void addOutgoing(SolutionBase* t) const { schedule_.outgoing_trajectories.push_back(t); }
+	void removeIncoming(const SolutionBase* t) const;
+	void removeOutgoing(const SolutionBase* t) const;
 	// Set new priority without updating the owning interface (USE WITH CARE)
-	inline void setPriority(const Priority& prio) { priority_ = prio; }
+	inline void setPriority(const Priority& prio) const { schedule_.priority = prio; }
 
 private:
+	// pending scene of a lightweight state, shared between copies
+	struct LazyScene
+	{
+		planning_scene::PlanningSceneConstPtr base;
+		std::vector<double> positions;
+		std::once_flag created;
+		planning_scene::PlanningSceneConstPtr result;
+
+		const planning_scene::PlanningSceneConstPtr& scene();
+	};
+
+	// immutable payload, shared between copies of the state
+	struct Payload
+	{
+		planning_scene::PlanningSceneConstPtr scene;  // nullptr for lightweight states
+		std::shared_ptr<LazyScene> lazy;
+		uint64_t revision = nextRevision();
+	};
+	// scheduling metadata, maintained by the owning Interface and the solutions linked to the state
+	struct Schedule
+	{
+		// members needed for priority scheduling in Interface list (first for cache locality of comparisons)
+		Priority priority;
+		Interface* owner = nullptr;  // allow update of priority
+		size_t slot = 0;  // handle into the owner's priority table
+		bool deferred = false;  // pushed out of the owner's beam (see Interface::setBeamWidth())
+		/// trajectories which are *timewise before* this state
+		Solutions incoming_trajectories;
+		/// trajectories which are *timewise after* this state
+		Solutions outgoing_trajectories;
+	};
+
+	static uint64_t nextRevision();
+
 	static const char* STATUS_COLOR_[];
-	planning_scene::PlanningSceneConstPtr scene_;
+	std::shared_ptr<const Payload> payload_;
+	// copy-on-write itself, and owned by the state, such that references remain valid when the state is copied
 	PropertyMap properties_;
-	/// trajectories which are *timewise before* this state
-	Solutions incoming_trajectories_;
-	/// trajectories which are *timewise after* this state
-	Solutions outgoing_trajectories_;
-
-	// members needed for priority scheduling in Interface list
-	Priority priority_;
-	Interface* owner_ = nullptr;  // allow update of priority
+	mutable Schedule schedule_;
 };
 
-/** Interface provides a cost-sorted list of InterfaceStates available as input for a stage. */
-class Interface : public ordered<InterfaceState*>
+/** Interface provides a cost-sorted list of InterfaceStates available as input for a stage.
+ *
+ * As a generator may fan out into thousands of states, insertion and priority updates use an indexed list.
+ *
+ * Interfaces are not thread-safe: they are only modified by the planning thread, which also runs their
+ * notify function. Stages computing concurrently in worker threads record their modifications
+ * as DeferredActions, which the planning thread applies afterwards (see ConcurrentSerialContainer).
+ */
+class Interface : public indexed_ordered<InterfaceState*>
 {
-	using base_type = ordered<InterfaceState*>;
+	using base_type = indexed_ordered<InterfaceState*>;
 
 public:
 	// iterators providing convinient access to stored InterfaceState
@@ -189,6 +286,7 @@ public:
 	class const_iterator : public base_type::const_iterator
 	{
 	public:
+		const_iterator() = default;
 		const_iterator(base_type::const_iterator other) : base_type::const_iterator(other) {}
 		const_iterator(base_type::iterator other) : base_type::const_iterator(other) {}
 
@@ -210,6 +308,7 @@ public:
 	};
 	using UpdateFlags = utils::Flags<Update>;
 	using NotifyFunction = std::function<void(iterator, UpdateFlags)>;
+	using CostToGo = std::function<double(const InterfaceState&)>;
 
 	class DisableNotify
 	{
@@ -222,25 +321,107 @@ public:
 	};
 	friend class DisableNotify;
 
+	/** Defer and coalesce the notifications of all interfaces (of the calling thread) while in scope
+	 *
+	 * Notifications of the same state are merged into one, accumulating their update flags,
+	 * where the notification of a new state subsumes any later update. They are delivered once the outermost
+	 * scope ends, in order of their first occurrence, skipping states removed from their interface meanwhile.
+	 * Notifications raised by the callbacks during delivery are batched too and delivered in further rounds,
+	 * such that cascades of priority updates are coalesced as well. States must stay alive while being batched.
+	 */
+	class BatchNotify
+	{
+	public:
+		BatchNotify();
+		~BatchNotify() noexcept(false);
+		BatchNotify(const BatchNotify&) = delete;
+		BatchNotify& operator=(const BatchNotify&) = delete;
+	};
+	friend class BatchNotify;
+
 	Interface(const NotifyFunction& notify = NotifyFunction());
+	Interface(const Interface&) = delete;
+	Interface& operator=(const Interface&) = delete;
 
 	/// add a new InterfaceState
 	void add(InterfaceState& state);
+	/// add several new InterfaceStates at once, sorting them only once, and notify them in given order
+	void add(const std::vector<InterfaceState*>& states);
+	/** add a new InterfaceState, unless an equivalent state was added with addUnique() before
+	 *
+	 * States are equivalent if their joint positions, quantized with given resolution, are equal
+	 * and their scenes comprise the same world objects and attached bodies (compared by name).
+	 * Returns false if the state was skipped as a duplicate.
+	 */
+	bool addUnique(InterfaceState& state, double resolution);
+	/// remove all states (and forget keys of unique states)
+	void clear();
 
 	/// remove a state from the interface and return it as a one-element list
 	container_type remove(iterator it);
 
-	/// update state's priority (and call notify_ if it really has changed)
+	/** limit the number of enabled states in the interface (0: unlimited)
+	 *
+	 * Enabled states beyond the beam width, i.e. those of lowest priority, are deferred: they are moved
+	 * out of the sorted list into a side list, which isn't sorted nor visible via iteration, priorities() or states().
+	 * Once no enabled state is left in the interface, the best deferred states are revived.
+	 * Connecting stages, whose states stay enabled, revive deferred states once all pairs of the beam were tried.
+	 * Deferral and revival are notified as PRIORITY updates, as the state's position has changed.
+	 */
+	void setBeamWidth(size_t width);
+	inline size_t beamWidth() const { return beam_width_; }
+	/// number of states currently deferred
+	inline size_t deferredSize() const { return deferred_.size(); }
+	/// states currently deferred, in no particular order
+	inline const container_type& deferred() const { return deferred_; }
+	/// move up to beamWidth() best deferred states back into the interface, returns number of revived states
+	size_t reviveDeferred();
+	/// move up to count best deferred states back into the interface, even exceeding the beam
+	size_t reviveDeferred(size_t count);
+
+	/// update state's priority (and call notify_ if it really has changed), keeping the state's estimate
 	void updatePriority(InterfaceState* state, const InterfaceState::Priority& priority);
 	inline bool notifyEnabled() const { return static_cast<bool>(notify_); }
 
+	/// estimate the cost-to-go of states when they are added
+	void setCostToGo(const CostToGo& cost_to_go) { cost_to_go_ = cost_to_go; }
+
+	/** Dense table of the priorities of all states (in no particular order), for sweeps over the whole interface
+	 *
+	 * Entries correspond to states(), i.e. priorities()[i] == states()[i]->priority().
+	 * In contrast to iterating the sorted list, scanning it doesn't need to chase pointers to the states.
+	 */
+	inline const std::vector<InterfaceState::Priority>& priorities() const { return priorities_; }
+	inline const std::vector<InterfaceState*>& states() const { return slots_; }
+
 private:
 	NotifyFunction notify_;
+	// call notify_ or defer the notification if a BatchNotify scope is active
+	void notify(iterator it, UpdateFlags updated);
+	CostToGo cost_to_go_;
+	size_t beam_width_ = 0;  // max number of enabled states (0: unlimited)
+	container_type deferred_;  // states pushed out of the beam, in no particular order
+	// defer enabled states beyond the beam width
+	void trimToBeam();
+	// revive deferred states if no enabled state is left
+	void reviveIfExhausted();
+	// keys of states added via addUnique()
+	std::unordered_set<std::string> unique_keys_;
+
+	// priority table and its states, indexed by InterfaceState's slot
+	std::vector<InterfaceState::Priority> priorities_;
+	std::vector<InterfaceState*> slots_;
+	void registerSlot(InterfaceState& state);
+	void releaseSlot(InterfaceState& state);
 
 	// restrict access to some functions to ensure consistency
-	// (we need to set/unset InterfaceState::owner_)
+	// (we need to set/unset InterfaceState's owner)
+	// prepare a new state for insertion, moving it into a list node of container
+	iterator prepare(InterfaceState& state, container_type& container);
+
 	using base_type::erase;
 	using base_type::insert;
+	using base_type::merge;
 	using base_type::moveFrom;
 	using base_type::moveTo;
 	using base_type::remove_if;
@@ -264,8 +445,11 @@ class CostTerm;
 class StagePrivate;
 class ContainerBasePrivate;
 struct TmpSolutionContext;
+namespace utils {
+class ThreadPool;
+}
 /// abstract base class for solutions (primitive and sequences)
-class SolutionBase
+class SolutionBase : public std::enable_shared_from_this<SolutionBase>
 {
 	friend ContainerBasePrivate;
 	friend TmpSolutionContext;
@@ -283,7 +467,7 @@ public:
 	inline void setStartState(const InterfaceState& state) {
 		assert(start_ == nullptr);
 		start_ = &state;
-		const_cast<InterfaceState&>(state).addOutgoing(this);
+		state.addOutgoing(this);
 	}
 
 	/** Set the solution's end_state_
@@ -293,24 +477,61 @@ public:
 	inline void setEndState(const InterfaceState& state) {
 		assert(end_ == nullptr);
 		end_ = &state;
-		const_cast<InterfaceState&>(state).addIncoming(this);
+		state.addIncoming(this);
 	}
 
+	/** Unregister the solution from its start and end states
+	 *
+	 * States keep raw pointers to their trajectories. Thus, this is required before discarding a stored solution.
+	 */
+	void detach();
+
 	inline const Stage* creator() const { return creator_; }
 	void setCreator(Stage* creator);
 
 	inline double cost() const { return cost_; }
 	void setCost(double cost);
-	void markAsFailure(const std::string& msg = std::string());
+	void markAsFailure(const std::string& msg = std::string()) { markAsFailure(FailureCode::UNSPECIFIED, msg); }
+	void markAsFailure(FailureCode code, const std::string& msg = std::string());
+	/** Mark as failure, rendering the message only if the comment is actually accessed
+	 *
+	 * Stages not storing failures (see Stage::storeFailures()) thus never pay for building the message.
+	 */
+	using LazyMessage = std::function<std::string()>;
+	void markAsFailure(FailureCode code, LazyMessage msg);
 	inline bool isFailure() const { return !std::isfinite(cost_); }
+	inline FailureCode failureCode() const {
+		if (!isFailure())
+			return FailureCode::NONE;
+		return failure_code_ == FailureCode::NONE ? FailureCode::UNSPECIFIED : failure_code_;
+	}
 
-	const std::string& comment() const { return comment_; }
-	void setComment(const std::string& comment) { comment_ = comment; }
+	/// comment, rendering a pending lazy failure message on first access
+	const std::string& comment() const {
+		if (lazy_comment_)
+			renderComment();
+		return comment_;
+	}
+	void setComment(const std::string& comment) {
+		lazy_comment_ = nullptr;
+		comment_ = comment;
+	}
+	/// check for a comment without rendering a pending lazy message
+	bool hasComment() const { return lazy_comment_ || !comment_.empty(); }
 
 	auto& markers() { return markers_; }
 	const auto& markers() const { return markers_; }
 
-	/// convert solution to message
+	/// markers referenced by many solutions, e.g. the target frame of all IK solutions of the same pose
+	using SharedMarkers = std::shared_ptr<const std::vector<visualization_msgs::Marker>>;
+	const std::vector<SharedMarkers>& sharedMarkers() const { return shared_markers_; }
+	/// reference markers instead of copying them into markers()
+	void addSharedMarkers(SharedMarkers markers) {
+		if (markers && !markers->empty())
+			shared_markers_.push_back(std::move(markers));
+	}
+
+	/// convert solution to message (messages of sub trajectories and the start scene are cached)
 	void toMsg(moveit_task_constructor_msgs::Solution& solution, Introspection* introspection = nullptr) const;
 	/// append this solution to Solution msg
 	virtual void appendTo(moveit_task_constructor_msgs::Solution& solution,
@@ -320,6 +541,17 @@ public:
 	/// required to dispatch to type-specific CostTerm methods via vtable
 	virtual double computeCost(const CostTerm& cost, std::string& comment) const = 0;
 
+	/** Check whether this (previously planned) solution is still valid in the given scene
+	 *
+	 * The solution needs to start from the scene's current state (within tolerance, per joint variable)
+	 * and its SubTrajectories need to connect seamlessly. All waypoints are checked for collisions
+	 * with the scene's world, considering the attached objects and allowed collisions of the solution
+	 * as well as the world objects it adds or removes. Trajectories are checked concurrently on pool
+	 * (on a temporary pool if nullptr), stopping at the first invalid waypoint.
+	 */
+	bool validate(const planning_scene::PlanningScene& scene, double tolerance = 1e-4,
+	              utils::ThreadPool* pool = nullptr) const;
+
 	/// order solutions by their cost
 	bool operator<(const SolutionBase& other) const { return this->cost_ < other.cost_; }
 
@@ -327,19 +559,45 @@ protected:
 	SolutionBase(Stage* creator = nullptr, double cost = 0.0, std::string comment = "")
 	  : creator_(creator), cost_(cost), comment_(std::move(comment)) {}
 
+	/** Evaluate cost term f on this solution, reusing the result of an earlier evaluation with the same term
+	 *
+	 * A sub solution can be part of many sequences, which would evaluate the cost term on it again and again.
+	 * Results bounded by CostTerm::bound() are not memoized, because they might not be exact.
+	 * Neither are failures evaluated without CostTerm::explainFailures(), because their comment might be missing.
+	 */
+	template <typename T>
+	double memoizedCost(const CostTerm& f, std::string& comment) const;
+	/// forget memoized costs, e.g. after the solution was modified
+	void resetMemoizedCosts() { std::atomic_store(&cost_memo_, std::shared_ptr<const CostMemo>()); }
+
 private:
+	struct CostMemo;
+
+	// not thread-safe: stages render pending messages before storing (and thus sharing) a failure
+	void renderComment() const;
+
 	// back-pointer to creating stage, allows to access sub-solutions
 	Stage* creator_;
 	// associated cost
 	double cost_;
 	// comment for this solution, e.g. explanation of failure
-	std::string comment_;
+	mutable std::string comment_;
+	// failure message to be prepended to comment_ when accessed
+	mutable LazyMessage lazy_comment_;
+	FailureCode failure_code_ = FailureCode::NONE;
 	// markers for this solution, e.g. target frame or collision indicators
-	std::deque<visualization_msgs::Marker> markers_;
+	std::vector<visualization_msgs::Marker> markers_;
+	// markers shared with other solutions
+	std::vector<SharedMarkers> shared_markers_;
 
 	// begin and end InterfaceState of this solution/trajectory
 	const InterfaceState* start_ = nullptr;
 	const InterfaceState* end_ = nullptr;
+
+	// cached message of start scene, created by toMsg()
+	mutable std::shared_ptr<const moveit_msgs::PlanningScene> start_scene_msg_;
+	// costs computed by memoizedCost() for individual cost terms
+	mutable std::shared_ptr<const CostMemo> cost_memo_;
 };
 MOVEIT_CLASS_FORWARD(SolutionBase);
 
@@ -352,10 +610,50 @@ public:
 	    double cost = 0.0, std::string comment = "")
 	  : SolutionBase(nullptr, cost, std::move(comment)), trajectory_(trajectory) {}
 
-	robot_trajectory::RobotTrajectoryConstPtr trajectory() const { return trajectory_; }
-	void setTrajectory(const robot_trajectory::RobotTrajectoryPtr& t) { trajectory_ = t; }
+	/// trajectory of this solution, rebuilt on demand if compacted
+	robot_trajectory::RobotTrajectoryConstPtr trajectory() const;
+	void setTrajectory(const robot_trajectory::RobotTrajectoryPtr& t) {
+		std::atomic_store(&trajectory_, robot_trajectory::RobotTrajectoryConstPtr(t));
+		compact_.reset();
+		pending_timing_.reset();
+		std::atomic_store(&msg_, std::shared_ptr<const moveit_task_constructor_msgs::SubTrajectory>());
+		resetMemoizedCosts();
+		revision_ = nextRevision();
+	}
+	/** revision of the trajectory, renewed by setTrajectory()
+	 *
+	 * Each sub trajectory gets a new revision, copies share it. Caches keyed on the trajectory's address need to
+	 * compare the revision to notice replaced trajectories (or a new sub trajectory at a reused address).
+	 */
+	uint64_t trajectoryRevision() const { return revision_; }
+
+	using Timing = std::function<void(robot_trajectory::RobotTrajectory& trajectory)>;
+	/** defer the time parameterization of the trajectory until it's needed
+	 *
+	 * Timing is applied when the solution is converted into a message or executed, or explicitly by computeTiming().
+	 * Until then, trajectory() provides the untimed waypoints (and duration-based cost terms are meaningless).
+	 */
+	void deferTiming(Timing timing);
+	bool timingPending() const;
+	/// apply a deferred time parameterization once (thread-safe)
+	void computeTiming() const;
+
+	/** replace the trajectory by a compact representation, only storing the joint values of its group
+	 *
+	 * The full trajectory is rebuilt by trajectory() when needed and kept as long as it is referenced elsewhere.
+	 * Trajectories with pending timing or varying joints outside their group are not compacted.
+	 * Not thread-safe w.r.t. concurrent calls of trajectory(): compact solutions before sharing them.
+	 */
+	void compact();
+	bool isCompact() const { return compact_ != nullptr; }
+	/// compact representation of the trajectory, nullptr if not compacted
+	utils::CompactTrajectoryConstPtr compactTrajectory() const { return compact_ ? compact_->trajectory : nullptr; }
+	/// approximate memory (bytes) held by the trajectory, without rebuilding a compact one
+	size_t memoryUsage() const;
 
 	void appendTo(moveit_task_constructor_msgs::Solution& msg, Introspection* introspection = nullptr) const override;
+	/// fill msg with the changes of the end scene w.r.t. the start scene
+	void getSceneDiffMsg(moveit_msgs::PlanningScene& msg) const;
 
 	double computeCost(const CostTerm& cost, std::string& comment) const override;
 
@@ -366,8 +664,26 @@ public:
 	}
 
 private:
-	// actual trajectory, might be empty
-	robot_trajectory::RobotTrajectoryConstPtr trajectory_;
+	// actual trajectory, might be empty, replaced atomically by computeTiming(), or released by compact()
+	mutable robot_trajectory::RobotTrajectoryConstPtr trajectory_;
+	struct PendingTiming
+	{
+		Timing timing;
+		std::once_flag once;
+		std::atomic<bool> done{ false };
+	};
+	std::shared_ptr<PendingTiming> pending_timing_;  // shared by copies of this solution
+	struct CompactStorage
+	{
+		utils::CompactTrajectoryConstPtr trajectory;
+		std::mutex mutex;  // protecting expanded
+		std::weak_ptr<const robot_trajectory::RobotTrajectory> expanded;
+	};
+	std::shared_ptr<CompactStorage> compact_;  // if set, trajectory_ is empty
+	// cached message (without info) created by appendTo()
+	mutable std::shared_ptr<const moveit_task_constructor_msgs::SubTrajectory> msg_;
+	static uint64_t nextRevision();
+	uint64_t revision_ = nextRevision();
 };
 MOVEIT_CLASS_FORWARD(SubTrajectory);
 
@@ -384,6 +700,11 @@ public:
 	explicit SolutionSequence() : SolutionBase() {}
 	SolutionSequence(container_type&& subsolutions, double cost = 0.0, Stage* creator = nullptr)
 	  : SolutionBase(creator, cost), subsolutions_(std::move(subsolutions)) {}
+	/// copy of other (sharing its start and end states), referring to the given subsolutions instead
+	SolutionSequence(const SolutionSequence& other, container_type&& subsolutions)
+	  : SolutionBase(other), subsolutions_(std::move(subsolutions)) {
+		resetMemoizedCosts();
+	}
 
 	void push_back(const SolutionBase& solution);
 
@@ -419,6 +740,10 @@ public:
 	  : SolutionBase(creator, cost), wrapped_(wrapped) {}
 	explicit WrappedSolution(Stage* creator, const SolutionBase* wrapped)
 	  : WrappedSolution(creator, wrapped, wrapped->cost()) {}
+	/// copy of other (sharing its start and end states), wrapping the given solution instead
+	WrappedSolution(const WrappedSolution& other, const SolutionBase* wrapped) : SolutionBase(other), wrapped_(wrapped) {
+		resetMemoizedCosts();
+	}
 	void appendTo(moveit_task_constructor_msgs::Solution& solution,
 	              Introspection* introspection = nullptr) const override;
 
@@ -430,6 +755,9 @@ private:
 	const SolutionBase* wrapped_;
 };
 
+/// collect all SubTrajectories of the given solution in execution order
+void flatten(const SolutionBase& solution, std::vector<const SubTrajectory*>& trajectories);
+
 /// Trait to retrieve the end (FORWARD) or start (BACKWARD) state of a given solution
 template <Interface::Direction dir>
 const InterfaceState* state(const SolutionBase& solution);
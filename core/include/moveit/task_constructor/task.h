@@ -42,6 +42,9 @@
 #include "container.h"
 
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/scheduler_log.h>
+#include <moveit/task_constructor/async_dispatcher.h>
 #include <moveit_task_constructor_msgs/Solution.h>
 
 #include <moveit/macros/class_forward.h>
@@ -49,6 +52,13 @@
 #include <moveit_msgs/MoveItErrorCodes.h>
 #include <moveit/utils/moveit_error_code.h>
 
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <limits>
+#include <mutex>
+
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotModel);
@@ -56,6 +66,10 @@ MOVEIT_CLASS_FORWARD(RobotState);
 }  // namespace core
 }  // namespace moveit
 
+namespace plan_execution {
+MOVEIT_CLASS_FORWARD(PlanExecution);
+}
+
 namespace moveit {
 namespace task_constructor {
 
@@ -63,6 +77,133 @@ MOVEIT_CLASS_FORWARD(Stage);
 MOVEIT_CLASS_FORWARD(ContainerBase);
 MOVEIT_CLASS_FORWARD(Task);
 
+/** Configuration of how Task::plan() schedules the computation of stages
+ *
+ * With a parallel policy, containers compute all of their ready children concurrently on a thread pool.
+ * New solutions and interface states are still processed sequentially by the planning thread.
+ * Stages and solvers shared between concurrently computed stages need to be thread-safe.
+ */
+struct ExecutionPolicy
+{
+	enum Scheduling
+	{
+		/// serial containers compute all ready children in order
+		ORDERED,
+		/** minimize the time to the first solution: until the task has found one, serial containers only compute
+		 * the ready child extending the deepest partial solution, i.e. the top interface state of highest depth.
+		 * Afterwards, scheduling falls back to ORDERED to improve on costs. Ignored with parallel threads. */
+		ANYTIME,
+		/** pick a single job per iteration from all ready stages of the task, preferring stages extending
+		 * the best partial solution (highest depth, lowest cost), then stages with a short mean compute time.
+		 * Only serial containers and Alternatives are descended into, other containers schedule their children
+		 * themselves. Ignored with parallel threads. */
+		GLOBAL
+	};
+
+	/** number of stages computed (and initialized) concurrently (1: sequential, 0: number of CPU cores)
+	 *
+	 * Stages are computed by the workers of utils::ThreadPool::shared(), which limits the concurrency of
+	 * all tasks of the process. Configure it via utils::ThreadPool::configureShared().
+	 */
+	size_t threads = 1;
+	Scheduling scheduling = ORDERED;
+
+	static ExecutionPolicy sequential() { return ExecutionPolicy(); }
+	static ExecutionPolicy parallel(size_t threads = 0) {
+		ExecutionPolicy policy;
+		policy.threads = threads;
+		return policy;
+	}
+	static ExecutionPolicy anytime() {
+		ExecutionPolicy policy;
+		policy.scheduling = ANYTIME;
+		return policy;
+	}
+	static ExecutionPolicy global() {
+		ExecutionPolicy policy;
+		policy.scheduling = GLOBAL;
+		return policy;
+	}
+};
+
+/** Hooks to monitor and adapt the execution of a solution by Task::execute()
+ *
+ * Both hooks are called from background threads.
+ */
+struct ExecutionMonitor
+{
+	/// execution feedback: number of finished sub trajectories, their total number, progress of the current one [0, 1]
+	std::function<void(size_t finished, size_t total, double progress)> feedback;
+
+	/** replan the sub trajectories following sub trajectory index, while the latter is executed
+	 *
+	 * remaining holds the sub trajectories planned after index. Return true to continue with the modified remaining
+	 * sub trajectories instead, e.g. because the scene changed, and false to continue as planned.
+	 * With a replan hook, sub trajectories are executed one by one, to splice in replanned ones in between.
+	 * If replanning takes longer than the execution of sub trajectory index, the robot waits for it.
+	 */
+	std::function<bool(size_t index, moveit_task_constructor_msgs::Solution& remaining)> replan;
+};
+
+/** Progress of an asynchronous Task::planAsync(), consumed by the caller
+ *
+ * The planning thread pushes an event for each new solution of the task and a statistics update after each
+ * planning iteration. Statistics updates not consumed yet are coalesced, such that only solutions accumulate
+ * if the consumer is slow.
+ */
+class PlanningProgress
+{
+public:
+	struct Event
+	{
+		/// new solution of the task, nullptr for a statistics update
+		SolutionBaseConstPtr solution;
+		/// statistics at the time of the event
+		size_t iterations = 0;
+		size_t solutions = 0;
+		double best_cost = std::numeric_limits<double>::infinity();
+		double elapsed = 0.0;  // seconds since planning started
+	};
+
+	/** wait up to timeout seconds for the next event
+	 *
+	 * Returns false on timeout, or if planning finished and all events were consumed.
+	 */
+	bool next(Event& event, double timeout = std::numeric_limits<double>::infinity());
+	/// whether planning finished, events might still be pending
+	bool finished() const;
+	/** call notify (on the planning thread) after each new event and when planning finished
+	 *
+	 * This allows event loops to wake up instead of blocking in next(). notify must be cheap and must not throw.
+	 */
+	void setNotify(std::function<void()> notify);
+
+	// producer API, used by the planning thread
+	void pushSolution(const SolutionBaseConstPtr& solution, const ordered<SolutionBaseConstPtr>& solutions);
+	void pushIteration(const ordered<SolutionBaseConstPtr>& solutions);
+	void finish();
+
+private:
+	void push(SolutionBaseConstPtr solution, const ordered<SolutionBaseConstPtr>& solutions);  // nullptr: iteration
+
+	mutable std::mutex mutex_;
+	std::condition_variable cv_;
+	std::deque<Event> events_;
+	const std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+	size_t iterations_ = 0;
+	bool finished_ = false;
+	std::shared_ptr<const std::function<void()>> notify_;  // shared, as copying might be costly (e.g. Python)
+};
+using PlanningProgressPtr = std::shared_ptr<PlanningProgress>;
+
+/// handles of a planning job started by Task::planAsync()
+struct AsyncPlanning
+{
+	/// result of plan(), or its exception
+	std::shared_future<moveit::core::MoveItErrorCode> result;
+	PlanningProgressPtr progress;
+};
+
 class TaskPrivate;
 /** A Task is the root of a tree of stages.
  *
@@ -91,8 +232,14 @@ public:
 	const moveit::core::RobotModelConstPtr& getRobotModel() const;
 	/// setting the robot model also resets the task
 	void setRobotModel(const moveit::core::RobotModelConstPtr& robot_model);
-	/// load robot model from given parameter
+	/** load robot model from given parameter
+	 *
+	 * Models are cached process-wide, keyed on the parameter and the URDF/SRDF content,
+	 * such that tasks loading the same description share a single model (and its planning pipelines).
+	 */
 	void loadRobotModel(const std::string& robot_description = "robot_description");
+	/// release cached robot models, models still used by a task stay alive until the task is destroyed
+	static void clearRobotModelCache();
 
 	void add(Stage::pointer&& stage);
 	void insert(Stage::pointer&& stage, int before = -1) override;
@@ -102,6 +249,16 @@ public:
 	void enableIntrospection(bool enable = true);
 	Introspection& introspection();
 
+	/// record computation times of stages, solvers, and cost terms during plan()
+	void enableProfiling(bool enable = true);
+	/// events recorded during all plan() calls since profiling was enabled, nullptr if disabled
+	const utils::ProfilerPtr& profiler() const;
+
+	/// record scheduling decisions of all plan() calls in a ring buffer of given capacity
+	void enableSchedulerLog(bool enable = true, size_t capacity = utils::SchedulerLog::DEFAULT_CAPACITY);
+	/// log of scheduling decisions, nullptr if disabled
+	const utils::SchedulerLogPtr& schedulerLog() const;
+
 	using TaskCallback = std::function<void(const Task& t)>;
 	using TaskCallbackList = std::list<TaskCallback>;
 	/// add function to be called after each top-level iteration
@@ -114,20 +271,133 @@ public:
 	using WrapperBase::removeSolutionCallback;
 	using WrapperBase::SolutionCallback;
 
+	using SolutionBatchCallback = std::function<void(const std::vector<SolutionBaseConstPtr>& solutions)>;
+	using SolutionBatchCallbackList = std::list<SolutionBatchCallback>;
+	/// add function to be called with new solutions, several at once if they are delivered asynchronously
+	SolutionBatchCallbackList::const_iterator addSolutionBatchCallback(SolutionBatchCallback&& cb);
+	void removeSolutionBatchCallback(SolutionBatchCallbackList::const_iterator which);
+
+	using SolutionDispatcher = utils::AsyncDispatcher<SolutionBaseConstPtr>;
+	/** call solution callbacks asynchronously during plan(), on a dedicated thread
+	 *
+	 * New solutions are queued (up to queue_size) and delivered in batches of up to max_batch solutions,
+	 * such that slow callbacks don't stall planning. If the queue is full, planning either waits (BLOCK)
+	 * or the solution is not delivered (DROP). plan() returns after all queued solutions were delivered.
+	 * Callbacks must not be added or removed during planning. queue_size = 0 restores synchronous calls.
+	 *
+	 * Callbacks run on the dispatcher thread while planning continues. They are called sequentially, but
+	 * data shared with the planning thread (or other code) requires synchronization. The passed solutions are
+	 * kept alive and their trajectories and states are not modified anymore, while deferred cost terms might
+	 * still update their cost. Callbacks must not access other parts of the task, e.g. solutions(), nor call
+	 * plan(), reset(), or other modifying methods. This method must not be called during planning.
+	 * Without async delivery, callbacks run synchronously on the planning thread.
+	 */
+	void setAsyncSolutionCallbacks(size_t queue_size = 1024, size_t max_batch = 64,
+	                               SolutionDispatcher::Backpressure policy = SolutionDispatcher::BLOCK);
+
+	/** destroy the planning graph released by reset() or ~Task in a background thread
+	 *
+	 * Tearing down many states, scenes, and trajectories can take considerable time. If enabled, reset() returns
+	 * immediately, such that the next plan() starts right away. Retired graphs are destroyed in order
+	 * by utils::Reclaimer::global(), whose wait() blocks until all of them are gone.
+	 */
+	void setBackgroundTeardown(bool enable = true);
+	bool backgroundTeardown() const;
+
+	/** evaluate DEFERRED terms of cost::Tiered only for the best k complete solutions (0: all)
+	 *
+	 * Deferred costs are evaluated at the end of plan(), after the solutions were passed to solution callbacks.
+	 * Afterwards, solutions() is ranked by the full costs.
+	 */
+	void setDeferredCostsTopK(size_t k);
+	size_t deferredCostsTopK() const;
+
+	/** limit each compute() call of plan() to the given duration (0: unlimited)
+	 *
+	 * Resumable stages, e.g. ComputeIK and GenerateRandomPose, suspend their work at the end of the slice
+	 * and continue it in a later compute() call, such that the scheduler can interleave other stages meanwhile.
+	 * Independently of the slice, they suspend their work at the task's timeout. See utils::TimeSlice.
+	 */
+	void setTimeSlice(double seconds);
+	double timeSlice() const;
+
+	/** limit the memory held by the stages during plan() to the given number of bytes (0: unlimited)
+	 *
+	 * The memoryUsage() is checked periodically between compute() calls. When it approaches the budget,
+	 * the task degrades gracefully, taking the following steps in this order until usage is below the budget again:
+	 * - drop all stored failures and don't store further ones (failures are still counted)
+	 * - evict the worst half of the disabled (ARMED or PRUNED) states from the stages' pull interfaces,
+	 *   such that they are not considered for further computations anymore
+	 * - compact the trajectories of all stored solutions and of further ones (see Stage property compact_trajectories)
+	 * States (and their scenes) only used by dropped failures are freed, while those of stored solutions are kept.
+	 * Solutions are never dropped. Degradation persists until reset().
+	 * If the usage still exceeds the budget after all steps, planning stops with a warning, returning FAILURE
+	 * if there are no solutions.
+	 */
+	void setMemoryBudget(size_t bytes);
+	size_t memoryBudget() const;
+
 	using WrapperBase::setTimeout;
 	using WrapperBase::timeout;
 
+	/// set amount of markers generated by all stages, e.g. MARKERS_NONE to skip visualization in headless runs
+	using WrapperBase::setMarkerLevel;
+	using WrapperBase::markerLevel;
+	/// evaluate costs of new solutions of all stages in the background, see Stage::setAsyncCost()
+	using WrapperBase::setAsyncCost;
+
 	/// reset all stages
 	void reset() final;
 	/// initialize all stages with given scene
 	void init();
+	/** initialize the task up front, such that the first plan() doesn't pay for lazy loading
+	 *
+	 * Loads the robot model (and thus its kinematics solvers) if needed and initializes all stages,
+	 * which loads their planning pipelines and planner plugins. With a parallel policy,
+	 * independent subtrees are initialized concurrently.
+	 */
+	void prewarm(const ExecutionPolicy& policy = ExecutionPolicy::parallel());
 
 	/// reset, init scene (if not yet done), and init all stages, then start planning
-	moveit::core::MoveItErrorCode plan(size_t max_solutions = 0);
+	moveit::core::MoveItErrorCode plan(size_t max_solutions = 0,
+	                                   const ExecutionPolicy& policy = ExecutionPolicy::sequential());
+	/** plan() on a worker of the process-wide utils::ThreadPool::shared(), returning immediately
+	 *
+	 * Tasks planned asynchronously share the pool's workers, with surplus tasks waiting for a free worker.
+	 * The task must not be modified or planned otherwise until the result is ready. Use preempt() to stop early,
+	 * also while still waiting for a worker. Destroying the task preempts and waits for its asynchronous planning,
+	 * moving it throws std::logic_error.
+	 */
+	AsyncPlanning planAsync(size_t max_solutions = 0, const ExecutionPolicy& policy = ExecutionPolicy::sequential());
 	/// interrupt current planning (or execution)
 	void preempt();
 	/// execute solution, return the result
 	moveit::core::MoveItErrorCode execute(const SolutionBase& s);
+	/** execute solution in-process, passing its trajectories directly to the given plan execution
+	 *
+	 * In contrast to execute(), this doesn't need the ExecuteTaskSolution capability of move_group
+	 * and avoids the conversion of the solution into a message and back.
+	 */
+	moveit::core::MoveItErrorCode execute(const SolutionBase& s, const plan_execution::PlanExecutionPtr& executor);
+	/// execute a solution message, e.g. loaded from a utils::SolutionStore, without planning
+	moveit::core::MoveItErrorCode execute(const moveit_task_constructor_msgs::Solution& msg);
+	/// execute solution, reporting progress to monitor and allowing it to replan the remainder during execution
+	moveit::core::MoveItErrorCode execute(const SolutionBase& s, const ExecutionMonitor& monitor);
+	moveit::core::MoveItErrorCode execute(moveit_task_constructor_msgs::Solution msg, const ExecutionMonitor& monitor);
+
+	/** Plan and execute in a pipelined fashion, overlapping execution of a finalized prefix with further planning
+	 *
+	 * Once the first prefix_stages top-level stages cannot compute anymore, the best chain of their solutions
+	 * is executed while planning continues. Planning stops at the first full solution continuing this prefix.
+	 * Its remainder is executed after the prefix. If no such solution is found, the robot stops after the prefix.
+	 * Pipelining requires a SerialContainer as top-level container and 0 < prefix_stages < number of stages.
+	 * Otherwise, the best solution is planned and executed sequentially.
+	 */
+	moveit::core::MoveItErrorCode planAndExecute(size_t prefix_stages,
+	                                             const ExecutionPolicy& policy = ExecutionPolicy::sequential());
+
+	/// approximate memory held by all stages of the task
+	Stage::MemoryUsage memoryUsage() const;
 
 	/// print current task state (number of found solutions and propagated states) to std::cout
 	void printState(std::ostream& os = std::cout) const;
@@ -142,6 +412,9 @@ public:
 	/// publish all top-level solutions
 	void publishAllSolutions(bool wait = true);
 
+	/// archive all top-level solutions (best first) into a file readable by utils::SolutionStore
+	void saveSolutions(const std::string& path) const;
+
 	// +1 TODO: convenient access to arbitrary stage by name. traverse hierarchy using / separator?
 	/// access stage tree
 	ContainerBase* stages();
@@ -167,5 +440,38 @@ inline std::ostream& operator<<(std::ostream& os, const Task& task) {
 	task.printState(os);
 	return os;
 }
+
+/** Blueprint to create new tasks of the same structure, sharing their expensive resources
+ *
+ * Stages cannot be copied generically. Thus, the template rebuilds the stage tree of each new task via the
+ * provided build function, and each new task runs a full init() on its first plan(). Only the resources that
+ * are expensive to create are shared: the robot model and the planning pipelines, which are cached by
+ * PipelinePlanner as long as the template's prototype task keeps them.
+ * The prototype is built and initialized once on construction, validating the build function.
+ */
+class TaskTemplate
+{
+public:
+	using BuildFunction = std::function<void(Task& task)>;
+
+	/// build and initialize the prototype task, loading the robot model from robot_description if not provided
+	TaskTemplate(BuildFunction build, const moveit::core::RobotModelConstPtr& robot_model = nullptr,
+	             const std::string& ns = "", bool introspection = false);
+
+	/** create a new task, configured by the build function and the given (task-level) properties
+	 *
+	 * The task is not initialized yet: plan() initializes it, loading neither the robot model nor the pipelines.
+	 */
+	Task instantiate(const std::string& name, const std::map<std::string, boost::any>& properties = {}) const;
+
+	const Task& prototype() const { return prototype_; }
+	const moveit::core::RobotModelConstPtr& getRobotModel() const { return prototype_.getRobotModel(); }
+
+private:
+	BuildFunction build_;
+	std::string ns_;
+	bool introspection_;
+	Task prototype_;
+};
 }  // namespace task_constructor
 }  // namespace moveit
@@ -41,12 +41,19 @@
 #include <moveit/task_constructor/container_p.h>
 #include <moveit/task_constructor/task.h>
 
+#include <atomic>
+#include <limits>
+#include <unordered_map>
+
 namespace robot_model_loader {
 MOVEIT_CLASS_FORWARD(RobotModelLoader);
 }
 
 namespace moveit {
 namespace task_constructor {
+namespace utils {
+class ThreadPool;
+}
 
 class TaskPrivate : public WrapperBasePrivate
 {
@@ -55,19 +62,109 @@ class TaskPrivate : public WrapperBasePrivate
 
 public:
 	TaskPrivate(Task* me, const std::string& ns);
+	~TaskPrivate() override;
 
 	const std::string& ns() const { return ns_; }
 	const ContainerBase* stages() const;
 
+	/// provide a thread pool matching the policy (or none for sequential planning) and its scheduling to all stages
+	void setupExecution(const ExecutionPolicy& policy);
+	/// pick the best ready stage of the whole task (ExecutionPolicy::GLOBAL), nullptr if there is none
+	StagePrivate* nextGlobalJob() const;
+	/// compute the next job: the best ready stage of the whole task or the root container, see Task::compute()
+	void computeNext();
+	/// let all stages prepare their work before they are probed via canCompute(), see StagePrivate::refill()
+	void refillStages();
+	/// clear a preempt() request of a previous planning, before starting a new one
+	void resetPreemption() {
+		preempt_requested_ = false;
+		cancellation_.reset();
+	}
+	/// Task::plan() without resetPreemption(), such that planAsync() can be preempted while queued
+	moveit::core::MoveItErrorCode plan(size_t max_solutions, const ExecutionPolicy& policy);
+	/// asynchronous planning still using this task?
+	bool planningAsync() const {
+		return async_planning_.valid() && async_planning_.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+	}
+
+	/// call solution callbacks for the given solutions
+	void deliverSolutions(const std::vector<SolutionBaseConstPtr>& solutions) const;
+	/// start asynchronous delivery of new solutions, if configured
+	void startSolutionDispatch();
+	/// deliver all pending solutions and stop asynchronous delivery, rethrowing an exception of a callback
+	void finishSolutionDispatch(bool rethrow = true);
+	/// wait until queued solutions were delivered, before the root container discards some
+	void flushPendingSolutions() override {
+		if (solution_dispatcher_)
+			solution_dispatcher_->flush();
+	}
+
+	/** evaluate deferred costs (see cost::Tiered) of the best count solutions (all if 0) and rank them again
+	 *
+	 * Evaluated solutions can drop out of the best ones, such that evaluation is repeated for their successors
+	 * until the best count solutions are all evaluated. Thus, they are ranked correctly if deferred costs are positive.
+	 */
+	void evaluateDeferredCosts(size_t count);
+
+	/** whether the solutions of the first num_stages children of the (serial) root container are final
+	 *
+	 * This requires that none of these stages can compute anymore and that no states are pushed into them anymore:
+	 * stages pulling from their end interface, e.g. Connect, are fed backwards by the following stages.
+	 */
+	bool prefixFinalized(size_t num_stages) const;
+
+	/// degradation steps of Task::setMemoryBudget(), in order
+	enum MemoryDegradation
+	{
+		NO_DEGRADATION,
+		DROP_FAILURES,
+		EVICT_STATES,
+		COMPACT_TRAJECTORIES,
+	};
+	/// take all degradation steps required to keep the memory usage below the budget, returns false if exceeded still
+	bool enforceMemoryBudget();
+	/// apply a degradation step to all stages
+	void degradeMemory(MemoryDegradation step);
+
 private:
+	// planning loop of Task::plan() and Task::planAndExecute()
+	class PlanningLoop;
+
 	std::string ns_;
 	robot_model_loader::RobotModelLoaderPtr robot_model_loader_;
 	moveit::core::RobotModelConstPtr robot_model_;
 	bool preempt_requested_;
+	utils::CancellationToken cancellation_;  // activated during planning, cancelled on preempt() or timeout
+	std::unique_ptr<utils::ThreadPool> thread_pool_;
+	std::atomic<bool> anytime_{ false };  // anytime scheduling active, i.e. still waiting for the first solution
+	bool global_scheduling_ = false;  // ExecutionPolicy::GLOBAL
+	utils::ArenaPtr arena_;  // memory for states and solutions, released on reset()
+	utils::ProfilerPtr profiler_;  // records computation times during plan(), if enabled
+	utils::SchedulerLogPtr scheduler_log_;  // records scheduling decisions during plan(), if enabled
+	size_t deferred_costs_top_k_ = 0;  // number of best solutions evaluating deferred costs (0: all)
+	double time_slice_ = 0.0;  // maximum duration of a compute() call of resumable stages (0: unlimited)
+	double timeSlice() const { return time_slice_ > 0.0 ? time_slice_ : std::numeric_limits<double>::infinity(); }
+	size_t memory_budget_ = 0;  // bytes held by all stages before degrading (0: unlimited)
+	MemoryDegradation memory_degradation_ = NO_DEGRADATION;  // last step taken since reset()
+	std::unordered_map<const SolutionBase*, double> deferred_costs_;  // cost added to evaluated solutions
 
 	// introspection and monitoring
 	std::unique_ptr<Introspection> introspection_;
 	std::list<Task::TaskCallback> task_cbs_;  // functions to monitor task's planning progress
+	Task::SolutionBatchCallbackList solution_batch_cbs_;
+
+	// asynchronous delivery of solutions to callbacks, configured by setAsyncSolutionCallbacks()
+	struct AsyncSolutions
+	{
+		size_t queue_size = 0;  // 0: synchronous delivery
+		size_t max_batch = 64;
+		Task::SolutionDispatcher::Backpressure policy = Task::SolutionDispatcher::BLOCK;
+	} async_solutions_;
+	std::unique_ptr<Task::SolutionDispatcher> solution_dispatcher_;  // only exists during plan()
+
+	// asynchronous planning started by planAsync()
+	std::shared_future<moveit::core::MoveItErrorCode> async_planning_;
+	PlanningProgressPtr progress_;  // only set during planAsync()
 };
 PIMPL_FUNCTIONS(Task)
 }  // namespace task_constructor
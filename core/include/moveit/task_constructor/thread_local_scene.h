@@ -0,0 +1,94 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: per-thread read-only clones of planning scenes for concurrent collision queries */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+
+#include <cstddef>
+#include <utility>
+
+namespace planning_scene {
+MOVEIT_CLASS_FORWARD(PlanningScene);
+}
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Read-only clones of a planning scene, one per thread, for concurrent collision queries
+ *
+ * The FCL broadphase managers of a scene's collision environment aren't safe for concurrent use, even for queries
+ * via the const interface. Instead, each thread calling local() gets a clone of the scene, which is a diff of it
+ * and thus has its own collision environment. Clones are cached per thread and shared by all views of the same scene,
+ * such that switching a view to a scene used by the thread before is cheap. A clone is released once it is the last
+ * owner of its scene, or if it is the least recently used one of more than CACHE_SIZE clones of the thread.
+ * As idle threads don't notice the former, releaseUnused() releases such clones of all threads, e.g. on Task::reset().
+ *
+ * Scenes must not be modified while they are viewed, which holds for the scenes of InterfaceStates.
+ */
+class ThreadLocalSceneView
+{
+public:
+	/// number of clones cached per thread
+	static constexpr size_t CACHE_SIZE = 8;
+
+	explicit ThreadLocalSceneView(planning_scene::PlanningSceneConstPtr scene = nullptr);
+
+	const planning_scene::PlanningSceneConstPtr& scene() const { return scene_; }
+	/// view another scene (not thread-safe w.r.t. concurrent local() calls)
+	void setScene(planning_scene::PlanningSceneConstPtr scene) { scene_ = std::move(scene); }
+
+	/// clone of the scene for the calling thread, created on first access
+	const planning_scene::PlanningScene& local() const;
+	const planning_scene::PlanningScene& operator*() const { return local(); }
+	const planning_scene::PlanningScene* operator->() const { return &local(); }
+
+	/// release all clones cached by the calling thread
+	static void clearThreadCache();
+	/// release the clones of all threads being the last owner of their scene (thread-safe)
+	static void releaseUnused();
+	/// number of clones cached by the calling thread
+	static size_t threadCacheSize();
+
+private:
+	planning_scene::PlanningSceneConstPtr scene_;
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,140 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Pool of worker threads to process batches of jobs concurrently
+ */
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+/** Pool of worker threads used to process batches of independent jobs concurrently.
+ *
+ * run() blocks until all jobs of the batch are finished. The calling thread takes part
+ * in processing the batch, such that run() can be safely called from within a job as well.
+ *
+ * A pool can also be a view onto the workers of another pool, limiting the number of jobs it processes
+ * concurrently: all (nested or concurrent) run() calls on a view share its size() - 1 helper threads.
+ * All parallel features of MTC use views onto the process-wide shared() pool, such that
+ * several tasks planning in the same process share its workers instead of oversubscribing the CPU cores.
+ */
+class ThreadPool
+{
+public:
+	using Job = std::function<void()>;
+
+	/// priority classes of queued jobs: idle workers start jobs of a higher class first
+	enum Priority
+	{
+		HIGH /* latency-critical jobs, e.g. planners racing in MultiPlanner */,
+		NORMAL /* batches of planning jobs */,
+		LOW /* background work, e.g. asynchronous cost evaluation and introspection publishing */
+	};
+
+	/** create a pool processing up to num_threads jobs concurrently (0: number of CPU cores)
+	 *
+	 * If cpus is not empty, workers are pinned to these CPUs (best effort, only supported on Linux).
+	 */
+	explicit ThreadPool(size_t num_threads = 0, const std::vector<unsigned int>& cpus = {});
+	/// create a view processing up to num_threads jobs concurrently on the workers of executor (0: its size)
+	ThreadPool(ThreadPool& executor, size_t num_threads);
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// number of jobs processed concurrently, including the calling thread
+	size_t size() const { return size_; }
+
+	/// process all jobs and wait for them to finish, rethrows the first exception thrown by a job
+	void run(const std::vector<Job>& jobs, Priority priority = NORMAL);
+
+	/** process job on a worker thread, returning immediately
+	 *
+	 * Without workers (size() == 1), the job is processed by the calling thread instead.
+	 * Exceptions thrown by the job are discarded: report them via the job itself, e.g. using a std::promise.
+	 * Posted jobs are not limited by the size of a view.
+	 */
+	void post(Job job, Priority priority = NORMAL);
+
+	/// post job only if an idle worker picks it up right away, returning false (without processing it) otherwise
+	bool tryPost(Job job, Priority priority = HIGH);
+
+	/** process-wide pool with a worker per CPU core for long-running jobs, e.g. Task::planAsync()
+	 *
+	 * Posting more jobs than there are workers queues them, instead of oversubscribing the CPU cores.
+	 */
+	static ThreadPool& shared();
+
+	/** configure the workers of shared(), which is only possible before its first use
+	 *
+	 * Returns false if shared() was created already. A planning process running several tasks,
+	 * or sharing the machine with other processes, can restrict MTC to some of the cores this way.
+	 */
+	static bool configureShared(size_t num_workers, const std::vector<unsigned int>& cpus = {});
+
+private:
+	static constexpr size_t NUM_PRIORITIES = LOW + 1;
+
+	void work();
+	ThreadPool& executor() { return executor_ ? *executor_ : *this; }
+	void enqueue(Job&& job, Priority priority);  // requires mutex_ to be locked
+
+	ThreadPool* executor_ = nullptr;  // pool providing the workers of a view
+	size_t size_;
+	// number of workers recruited by run() and not yet finished, shared with queued helpers outliving a view
+	std::shared_ptr<std::atomic<size_t>> helpers_ = std::make_shared<std::atomic<size_t>>(0);
+	std::vector<std::thread> workers_;
+	std::deque<Job> queues_[NUM_PRIORITIES];
+	size_t queued_ = 0;  // number of jobs in all queues
+	size_t idle_ = 0;  // number of workers waiting for jobs
+	std::mutex mutex_;
+	std::condition_variable cv_;
+	bool stop_ = false;
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
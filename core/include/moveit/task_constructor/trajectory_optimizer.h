@@ -0,0 +1,141 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Post-optimization of the free-space segments of planned solutions
+ */
+
+#pragma once
+
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/solvers/planner_interface.h>
+
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+class Task;
+namespace utils {
+
+/** Post-optimization of planned solutions, reducing the execution duration of their free-space segments
+ *
+ * Sampling-based planners often return detours, which survive in the final solutions. After planning, each
+ * selected SubTrajectory (by default those created by Connecting stages) is shortened by random shortcutting:
+ * a sub path between two waypoints is replaced by joint-space interpolation if the latter is collision-free
+ * w.r.t. the scene of the segment's start state. Optionally, the segment is also re-planned with a given planner.
+ * The result is densified and retimed. It is kept if it reduces the duration w.r.t. the original path retimed
+ * the same way, i.e. at the same velocity and acceleration scaling.
+ * The input solutions are not modified: Result::solutions provides copies referring to the optimized segments
+ * (sharing their unchanged parts with the originals). Costs of these copies are not updated.
+ *
+ * Segments are optimized concurrently. Shortcutting disregards path constraints: only select segments without.
+ */
+class TrajectoryOptimizer
+{
+public:
+	struct Options
+	{
+		/// random shortcut attempts per segment
+		size_t shortcut_iterations = 100;
+		/// max joint-space distance between checked (and returned) waypoints of shortcuts
+		double max_step = 0.05;
+		/// max timeout for re-planning a segment (s)
+		double replan_timeout = 1.0;
+		/// number of segments optimized concurrently (0: number of CPU cores, 1: sequentially)
+		size_t threads = 0;
+		/// seed of the random selection of shortcuts
+		unsigned int seed = 0;
+	};
+	struct Result
+	{
+		size_t segments = 0;  ///< number of optimized segments
+		size_t improved = 0;  ///< number of segments whose trajectory was replaced
+		double duration_before = 0.0;  ///< total duration of the original segments, retimed like the optimized ones (s)
+		double duration_after = 0.0;  ///< and after optimization (s)
+		/// optimized solutions, in order of the input (the original ones if none of their segments improved)
+		std::vector<SolutionBaseConstPtr> solutions;
+	};
+	/// select the sub trajectories to optimize
+	using Filter = std::function<bool(const SubTrajectory&)>;
+	using Timing = solvers::PlannerInterface::Timing;
+
+	TrajectoryOptimizer(const Options& options = Options());
+
+	const Options& options() const { return options_; }
+	/// replace the default selection of segments created by Connecting stages
+	void setFilter(Filter filter) { filter_ = std::move(filter); }
+	/** time parameterization of optimized trajectories
+	 *
+	 * Default: time-optimal, at the velocity and acceleration scaling estimated from the original trajectory
+	 */
+	void setTiming(Timing timing) { timing_ = std::move(timing); }
+	/// additionally re-plan segments with planner (which needs to be initialized), keeping the fastest result
+	void setPlanner(solvers::PlannerInterfacePtr planner) { planner_ = std::move(planner); }
+
+	/// optimize the segments of solution
+	Result optimize(const SolutionBase& solution) const;
+	/// optimize the segments of several solutions, segments shared between them only once
+	Result optimize(const std::vector<SolutionBaseConstPtr>& solutions) const;
+	/// optimize the best k solutions of task after planning (0: all), the task's solutions are kept as they are
+	Result optimize(const Task& task, size_t k = 1) const;
+
+	/// optimized version of trajectory within scene, nullptr if no faster one was found
+	robot_trajectory::RobotTrajectoryPtr optimize(const planning_scene::PlanningSceneConstPtr& scene,
+	                                              const planning_scene::PlanningSceneConstPtr& goal,
+	                                              const robot_trajectory::RobotTrajectory& trajectory,
+	                                              unsigned int seed) const;
+
+private:
+	/// as above, providing the duration of the retimed original trajectory as baseline
+	robot_trajectory::RobotTrajectoryPtr optimize(const planning_scene::PlanningSceneConstPtr& scene,
+	                                              const planning_scene::PlanningSceneConstPtr& goal,
+	                                              const robot_trajectory::RobotTrajectory& trajectory,
+	                                              unsigned int seed, double& baseline) const;
+	/// timing_, or the default for the given original trajectory
+	Timing timing(const robot_trajectory::RobotTrajectory& original) const;
+	robot_trajectory::RobotTrajectoryPtr shortcut(const planning_scene::PlanningScene& scene,
+	                                              const robot_trajectory::RobotTrajectory& trajectory,
+	                                              const Timing& timing, unsigned int seed) const;
+
+	Options options_;
+	Filter filter_;
+	Timing timing_;
+	solvers::PlannerInterfacePtr planner_;
+	mutable std::mutex planner_mutex_;  // planners are not necessarily thread-safe
+};
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -143,6 +143,42 @@ private:
 bool getRobotTipForFrame(const Property& property, const planning_scene::PlanningScene& scene,
                          const moveit::core::JointModelGroup* jmg, SolutionBase& solution,
                          const moveit::core::LinkModel*& robot_link, Eigen::Isometry3d& tip_in_global_frame);
+
+/// maximum depth of diff scenes created by diffScene() before flattening (0: never flatten, default: 8)
+unsigned int maxSceneDepth();
+void setMaxSceneDepth(unsigned int depth);
+
+/// number of parents of given scene
+unsigned int sceneDepth(const planning_scene::PlanningScene& scene);
+
+/** Return the given scene, or a flat copy of it without any parents if it reaches maxSceneDepth()
+ *
+ * Diff scenes resolve many lookups (e.g. of transforms, allowed collisions, or object colors) via their parents.
+ * Long chains of diffs, as created along a task, thus slow down all of them.
+ */
+planning_scene::PlanningSceneConstPtr flattenScene(const planning_scene::PlanningSceneConstPtr& scene);
+
+/// create a diff of the given scene (for a new InterfaceState), flattening the scene first if needed
+planning_scene::PlanningScenePtr diffScene(const planning_scene::PlanningSceneConstPtr& scene);
+
+/// approximate memory (bytes) of a robot state, including its transforms and attached bodies
+size_t memoryUsage(const moveit::core::RobotState& state);
+/** approximate memory (bytes) of a planning scene itself
+ *
+ * This accounts for the scene's robot state and, for scenes without a parent, its world objects.
+ * Diff scenes share everything else with their parent, which is not included.
+ */
+size_t memoryUsage(const planning_scene::PlanningScene& scene);
+
+/** hash of world objects and attached bodies of scene
+ *
+ * Object poses are quantized to resolution, such that small deviations don't alter the hash.
+ * If include_objects is false, only attached bodies are considered.
+ * Object hashes are cached, such that only objects modified in a diff scene are hashed again (see objectHash()).
+ */
+size_t worldHash(const planning_scene::PlanningScene& scene, double resolution, bool include_objects = true);
+/// hash of the allowed collision matrix of scene
+size_t acmHash(const planning_scene::PlanningScene& scene);
 }  // namespace utils
 }  // namespace task_constructor
 }  // namespace moveit
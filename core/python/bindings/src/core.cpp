@@ -36,14 +36,23 @@
 #include "utils.h"
 #include <pybind11/stl.h>
 #include <pybind11/functional.h>
+#include <pybind11/numpy.h>
 #include <moveit/python/task_constructor/properties.h>
 #include <moveit/task_constructor/container_p.h>
 #include <moveit/task_constructor/task.h>
 
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/planning_scene_interface/planning_scene_interface.h>
 #include <moveit/move_group_interface/move_group_interface.h>
 
+#include <chrono>
+#include <future>
+#include <limits>
+#include <memory>
+#include <numeric>
+#include <sstream>
+
 namespace py = pybind11;
 using namespace py::literals;
 using namespace moveit::task_constructor;
@@ -76,8 +85,142 @@ void setForwardedProperties(Stage& self, const py::object& names) {
 	self.setForwardedProperties(s);
 }
 
+/* Copy the waypoints of a trajectory into contiguous numpy arrays, restricted to the variables of its group.
+ * Waypoints are stored as individual RobotStates, so a zero-copy view isn't possible. However, a single
+ * copy in C++ avoids accessing each waypoint via its Python wrapper, enabling vectorized cost terms. */
+py::dict trajectoryArrays(const SubTrajectory& self) {
+	py::dict result;
+	const robot_trajectory::RobotTrajectoryConstPtr& t = self.trajectory();
+	if (!t)
+		return result;
+
+	const moveit::core::RobotModel& model = *t->getRobotModel();
+	const moveit::core::JointModelGroup* group = t->getGroup();
+	const std::vector<std::string>& names = group ? group->getVariableNames() : model.getVariableNames();
+	std::vector<int> indices;
+	indices.reserve(names.size());
+	for (const std::string& name : names)
+		indices.push_back(model.getVariableIndex(name));
+
+	const size_t n = t->getWayPointCount();
+	py::array_t<double> positions({ n, indices.size() });
+	py::array_t<double> velocities({ n, indices.size() });
+	py::array_t<double> times(n);
+	auto p = positions.mutable_unchecked<2>();
+	auto v = velocities.mutable_unchecked<2>();
+	auto time = times.mutable_unchecked<1>();
+	for (size_t i = 0; i < n; ++i) {
+		const moveit::core::RobotState& state = t->getWayPoint(i);
+		const double* velocity = state.hasVelocities() ? state.getVariableVelocities() : nullptr;
+		for (size_t j = 0; j < indices.size(); ++j) {
+			p(i, j) = state.getVariablePosition(indices[j]);
+			v(i, j) = velocity ? velocity[indices[j]] : 0.0;
+		}
+		time(i) = t->getWayPointDurationFromStart(i);
+	}
+	result["names"] = names;
+	result["positions"] = positions;
+	result["velocities"] = velocities;
+	result["times"] = times;
+	return result;
+}
+
+/* Read-only numpy view of the rows x cols matrix data, which is kept alive by owner */
+template <typename Owner>
+py::array_t<double> readOnlyView(const std::vector<double>& data, size_t rows, size_t cols, Owner owner) {
+	auto* held = new Owner(std::move(owner));
+	py::capsule base(held, [](void* p) { delete static_cast<Owner*>(p); });
+	py::array_t<double> result({ rows, cols }, data.data(), base);
+	result.attr("setflags")("write"_a = false);
+	return result;
+}
+
+/* Positions of the trajectory's waypoints (waypoints x variables of its group) as read-only numpy array.
+ * Compact trajectories store them contiguously, which is exposed without copying. Otherwise they are copied once,
+ * but never rebuilt from a compact trajectory or converted into a message. */
+py::array_t<double> trajectoryPositions(const SubTrajectory& self) {
+	if (utils::CompactTrajectoryConstPtr compact = self.compactTrajectory()) {
+		const size_t n = compact->variables().size();
+		return readOnlyView(compact->positions(), compact->waypointCount(), n, std::move(compact));
+	}
+	const robot_trajectory::RobotTrajectoryConstPtr& t = self.trajectory();
+	const size_t n = t ? t->getWayPointCount() : 0;
+	const moveit::core::JointModelGroup* group = t ? t->getGroup() : nullptr;
+	std::vector<int> indices;
+	if (group)
+		indices = group->getVariableIndexList();
+	else if (t) {
+		indices.resize(t->getRobotModel()->getVariableCount());
+		std::iota(indices.begin(), indices.end(), 0);
+	}
+
+	py::array_t<double> result({ n, indices.size() });
+	auto p = result.mutable_unchecked<2>();
+	for (size_t i = 0; i < n; ++i) {
+		const double* positions = t->getWayPoint(i).getVariablePositions();
+		for (size_t j = 0; j < indices.size(); ++j)
+			p(i, j) = positions[indices[j]];
+	}
+	result.attr("setflags")("write"_a = false);
+	return result;
+}
+
+/* Names of the variables in the columns of trajectoryPositions() */
+std::vector<std::string> trajectoryVariables(const SubTrajectory& self) {
+	const moveit::core::JointModelGroup* group;
+	const moveit::core::RobotModel* model;
+	if (utils::CompactTrajectoryConstPtr compact = self.compactTrajectory()) {  // don't expand the trajectory
+		group = compact->group();
+		model = compact->reference().getRobotModel().get();
+	} else if (const robot_trajectory::RobotTrajectoryConstPtr& t = self.trajectory()) {
+		group = t->getGroup();
+		model = t->getRobotModel().get();
+	} else
+		return {};
+	return group ? group->getVariableNames() : model->getVariableNames();
+}
+
+/* Share ownership of a solution, such that Python keeps it alive beyond a reset of the task */
+std::shared_ptr<const SolutionBase> share(const SolutionBase* solution) {
+	return solution ? solution->shared_from_this() : nullptr;
+}
+
+/* Destroying a task waits for its running planAsync() job, which needs the GIL to call Python stages, cost terms,
+ * and callbacks, and to release them. Thus, tasks created from Python release the GIL while being destroyed. */
+std::shared_ptr<Task> makeTask(std::unique_ptr<Task> task) {
+	return std::shared_ptr<Task>(task.release(), [](Task* task) {
+		if (PyGILState_Check()) {
+			py::gil_scoped_release release;
+			delete task;
+		} else
+			delete task;
+	});
+}
+
 }  // anonymous namespace
 
+}  // namespace python
+
+namespace task_constructor {
+std::vector<std::pair<InterfaceState, SubTrajectory>> toSpawnBatch(const pybind11::handle& batch) {
+	std::vector<std::pair<InterfaceState, SubTrajectory>> result;
+	for (const py::handle& item : batch) {
+		auto pair = item.cast<py::tuple>();
+		if (pair.size() != 2)
+			throw py::value_error("expected (state, cost) or (state, SubTrajectory) pairs");
+		SubTrajectory trajectory;
+		if (py::isinstance<SubTrajectory>(pair[1]))
+			trajectory = pair[1].cast<const SubTrajectory&>();
+		else
+			trajectory.setCost(pair[1].cast<double>());
+		result.emplace_back(InterfaceState(pair[0].cast<const InterfaceState&>()), std::move(trajectory));
+	}
+	return result;
+}
+}  // namespace task_constructor
+
+namespace python {
+
 void export_core(pybind11::module& m) {
 	/// translate InitStageException into InitStageError
 	PYBIND11_CONSTINIT static py::gil_safe_call_once_and_store<py::object> exc_storage;
@@ -99,14 +242,38 @@ void export_core(pybind11::module& m) {
 	    .def_property("cost", &SolutionBase::cost, &SolutionBase::setCost, "float: Cost associated with the solution")
 	    .def_property("comment", &SolutionBase::comment, &SolutionBase::setComment,
 	                  "str: Comment associated with the solution")
-	    .def("markAsFailure", &SolutionBase::markAsFailure, "Mark the SubTrajectory as a failure", "comment"_a)
+	    .def("markAsFailure", py::overload_cast<const std::string&>(&SolutionBase::markAsFailure),
+	         "Mark the SubTrajectory as a failure", "comment"_a)
 	    .def_property_readonly("isFailure", &SolutionBase::isFailure,
 	                           "bool: True if the trajectory is marked as a failure (read-only)")
 	    .def_property_readonly("start", &SolutionBase::start, "InterfaceState: Start of the trajectory (read-only)")
 	    .def_property_readonly("end", &SolutionBase::end, "InterfaceState: End of the trajectory (read-only)")
 	    .def_property_readonly(
-	        "markers", py::overload_cast<>(&SolutionBase::markers),
+	        "markers",
+	        [](const SolutionBase& self) {
+		        std::vector<visualization_msgs::Marker> markers = self.markers();
+		        for (const auto& shared : self.sharedMarkers())
+			        markers.insert(markers.end(), shared->begin(), shared->end());
+		        return markers;
+	        },
 	        ":visualization_msgs:`Marker`: Markers to visualize important aspects of the trajectory (read-only)")
+	    .def_property_readonly(
+	        "creator", [](const SolutionBase& self) { return self.creator() ? self.creator()->name() : std::string(); },
+	        "str: Name of the stage that created the solution (read-only)")
+	    .def(
+	        "subTrajectories",
+	        [](const SolutionBase& self) {
+		        std::vector<const SubTrajectory*> flat;
+		        flatten(self, flat);
+		        std::vector<std::shared_ptr<const SubTrajectory>> result;
+		        result.reserve(flat.size());
+		        for (const SubTrajectory* sub : flat)
+			        result.push_back(std::static_pointer_cast<const SubTrajectory>(share(sub)));
+		        return result;
+	        },
+	        R"(
+			All ``SubTrajectory`` solutions of this solution (tree) in execution order.
+			They share the solutions of the task without copying, keeping them alive when the task is reset.)")
 	    .def(
 	        "toMsg",
 	        [](const SolutionBase& self) {
@@ -120,7 +287,38 @@ void export_core(pybind11::module& m) {
 	                                        "Solution trajectory connecting two InterfaceStates of a stage")
 	    .def(py::init<>())
 	    .def_property("trajectory", &SubTrajectory::trajectory, &SubTrajectory::setTrajectory,
-	                  ":moveit_msgs:`RobotTrajectory`: Actual robot trajectory");
+	                  ":moveit_msgs:`RobotTrajectory`: Actual robot trajectory")
+	    .def("trajectoryArrays", &trajectoryArrays, R"(
+			Waypoints of the trajectory as numpy arrays, e.g. to compute costs in a vectorized fashion.
+			Returns a dict with the variable ``names`` of the trajectory's group, ``positions`` and ``velocities``
+			(waypoints x variables), and ``times`` from start (waypoints), or an empty dict without trajectory.)")
+	    .def_property_readonly("positions", &trajectoryPositions, R"(
+			numpy.ndarray: Read-only waypoint positions of the variables of the trajectory's group (waypoints x variables).
+			For compact trajectories, this is a view of the stored positions without copying.
+			In contrast to ``trajectory``, this neither converts the trajectory into a message nor expands it.)")
+	    .def_property_readonly("variableNames", &trajectoryVariables,
+	                           "list: Names of the variables in the columns of ``positions`` (read-only)")
+	    .def_property_readonly("isCompact", &SubTrajectory::isCompact,
+	                           "bool: True if the trajectory is stored in compact form (read-only)");
+
+	py::classh<SolutionSequence, SolutionBase>(m, "SolutionSequence",
+	                                           "Solution of a serial container, chaining the solutions of its children")
+	    .def_property_readonly(
+	        "solutions",
+	        [](const SolutionSequence& self) {
+		        std::vector<std::shared_ptr<const SolutionBase>> result;
+		        result.reserve(self.solutions().size());
+		        for (const SolutionBase* solution : self.solutions())
+			        result.push_back(share(solution));
+		        return result;
+	        },
+	        "list: Sub solutions in execution order (read-only)");
+
+	py::classh<WrappedSolution, SolutionBase>(m, "WrappedSolution",
+	                                          "Solution of a parallel container or wrapper, wrapping a child's solution")
+	    .def_property_readonly(
+	        "wrapped", [](const WrappedSolution& self) { return share(self.wrapped()); },
+	        "Solution: Wrapped solution of the child (read-only)");
 
 	using Solutions = ordered<SolutionBaseConstPtr>;
 	py::classh<Solutions>(m, "Solutions", "Cost-ordered list of solutions")
@@ -172,12 +370,37 @@ void export_core(pybind11::module& m) {
 
 	py::classh<cost::Clearance, TrajectoryCostTerm>(m, "Clearance", "Computes inverse distance to collision objects")
 	    .def(py::init<bool, bool, std::string, TrajectoryCostTerm::Mode>(), "with_world"_a = true,
-	         "cumulative"_a = false, "group_property"_a = "group", "mode"_a = TrajectoryCostTerm::Mode::AUTO);
+	         "cumulative"_a = false, "group_property"_a = "group", "mode"_a = TrajectoryCostTerm::Mode::AUTO)
+	    .def_readwrite("stride", &cost::Clearance::stride, "int: only evaluate every stride-th trajectory waypoint")
+	    .def_readwrite("refinement_threshold", &cost::Clearance::refinement_threshold,
+	                   "float: bisect skipped waypoints if distances differ by more than this");
+
+	auto tiered = py::classh<cost::Tiered, CostTerm>(
+	    m, "Tiered", "Weighted sum of cost terms, evaluating DEFERRED ones only for the best complete solutions");
+	py::enum_<cost::Tiered::Tier>(tiered, "Tier", "Define when a cost term is evaluated")
+	    .value("IMMEDIATE", cost::Tiered::Tier::IMMEDIATE, "When the solution is created")
+	    .value("DEFERRED", cost::Tiered::Tier::DEFERRED, "After planning, for the best complete solutions only");
+	tiered.def(py::init<>())
+	    .def("add", &cost::Tiered::add, "term"_a, "tier"_a = cost::Tiered::Tier::IMMEDIATE, "weight"_a = 1.0);
 
 	auto stage =
 	    properties::class_<Stage, PyStage<>>(m, "Stage", "Abstract base class of all stages.")
 	        .property<double>("timeout", "float: Maximally allowed time [s] per computation step")
+	        .property<double>("compute_budget",
+	                          "float: Total computation time [s] granted per plan(), 0: unlimited. "
+	                          "Once exhausted, the stage is only computed if no sibling has pending work.")
+	        .property<double>("timeout_percentile",
+	                          "float: Tune the timeout to this fraction in (0, 1] of successful compute durations "
+	                          "(0: disabled)")
+	        .property<uint32_t>("max_stored_failures",
+	                            "int: Number of most recent failures stored for introspection (0: all)")
+	        .property<size_t>("max_interface_states",
+	                          "int: Beam width, i.e. number of enabled input states considered at once (0: unlimited)")
 	        .property<std::string>("marker_ns", "str: Namespace for any markers that are associated to the stage")
+	        .property<Stage::MarkerLevel>("marker_level",
+	                                      "MarkerLevel: Amount of generated markers, inherited from the parent stage")
+	        .property<bool>("compact_trajectories",
+	                        "bool: Store solution trajectories compactly, inherited from the parent stage")
 	        .def_property("forwarded_properties", getForwardedProperties, setForwardedProperties,
 	                      "list: set of properties forwarded from input to output InterfaceState")
 	        .def_property("name", &Stage::name, &Stage::setName, "str: name of the stage displayed e.g. in rviz")
@@ -185,6 +408,7 @@ void export_core(pybind11::module& m) {
 	                               "PropertyMap: PropertyMap of the stage (read-only)")
 	        .def_property_readonly("solutions", &Stage::solutions, "Successful Solutions of the stage (read-only)")
 	        .def_property_readonly("failures", &Stage::failures, "Solutions: Failed Solutions of the stage (read-only)")
+	        .def("memoryUsage", &Stage::memoryUsage, "Approximate memory held by the stage, excluding its children")
 	        .def<void (Stage::*)(const CostTermConstPtr&)>("setCostTerm", &Stage::setCostTerm,
 	                                                       "Specify a CostTerm for calculation of stage costs")
 	        .def(
@@ -207,6 +431,19 @@ void export_core(pybind11::module& m) {
 	    .value("PARENT", Stage::PARENT, "Inherit properties from parent stage")
 	    .value("INTERFACE", Stage::INTERFACE, "Inherit properties from the input InterfaceState");
 
+	py::enum_<Stage::MarkerLevel>(stage, "MarkerLevel", "Amount of visualization markers generated for solutions")
+	    .value("NONE", Stage::MARKERS_NONE, "Don't generate any markers, e.g. in headless production runs")
+	    .value("BASIC", Stage::MARKERS_BASIC, "Generate lightweight markers only: frames and arrows")
+	    .value("FULL", Stage::MARKERS_FULL, "Additionally generate robot and object geometry");
+	PropertyConverter<Stage::MarkerLevel>();
+
+	py::class_<Stage::MemoryUsage>(stage, "MemoryUsage", "Approximate memory (bytes) held by a stage")
+	    .def_readonly("states", &Stage::MemoryUsage::states, "int: interface states created by the stage")
+	    .def_readonly("scenes", &Stage::MemoryUsage::scenes, "int: planning scenes of these states")
+	    .def_readonly("trajectories", &Stage::MemoryUsage::trajectories, "int: stored solutions and failures")
+	    .def_readonly("markers", &Stage::MemoryUsage::markers, "int: markers of stored solutions and failures")
+	    .def_property_readonly("total", &Stage::MemoryUsage::total, "int: sum of all categories");
+
 	auto either_way = py::classh<PropagatingEitherWay, Stage, PyPropagatingEitherWay<>>(
 	                      m, "PropagatingEitherWay", "Base class for propagator-like stages")
 	                      .def(py::init<const std::string&>(), "name"_a = std::string("PropagatingEitherWay"))
@@ -254,13 +491,20 @@ void export_core(pybind11::module& m) {
 
 					def compute(self):
 						self.spawn(core.InterfaceState(self.ps), cost=len(self.solutions))
+
+			Instead of calling ``spawn`` for each new state, ``compute()`` may also return a list of
+			``(state, cost)`` or ``(state, SubTrajectory)`` pairs, which are spawned at once.
+			This saves crossing into the interpreter for every single state.
 		)")
 	    .def(py::init<const std::string&>(), "name"_a = std::string("Generator"))
 	    .def("canCompute", &Generator::canCompute, "Return ``True`` if the stage can still produce solutions.")
 	    .def("compute", &Generator::compute, "Compute an actual solution and ``spawn`` an ``InterfaceState``")
 	    .def(
 	        "spawn", [](Generator& self, InterfaceState& state, double cost) { self.spawn(std::move(state), cost); },
-	        "Spawn an ``InterfaceState`` to both, start and end interface", "state"_a, "cost"_a);
+	        "Spawn an ``InterfaceState`` to both, start and end interface", "state"_a, "cost"_a)
+	    .def(
+	        "spawnBatch", [](Generator& self, const py::iterable& batch) { self.spawnBatch(toSpawnBatch(batch)); },
+	        "Spawn a list of ``(state, cost)`` or ``(state, SubTrajectory)`` pairs at once", "batch"_a);
 
 	properties::class_<MonitoringGenerator, Generator, PyMonitoringGenerator<>>(m, "MonitoringGenerator", R"(
 			Base class for monitoring generator stages
@@ -315,10 +559,14 @@ void export_core(pybind11::module& m) {
 	    .def("setMonitoredStage", &MonitoringGenerator::setMonitoredStage, "Set the monitored ``Stage``", "stage"_a)
 	    .def("_onNewSolution", &PubMonitoringGenerator::onNewSolution);
 
-	py::classh<ContainerBase, Stage>(m, "ContainerBase", R"(
+	properties::class_<Connecting, Stage>(m, "Connecting", "Abstract base class of stages connecting pairs of states")
+	    .property<size_t>("batch_size", "int: Number of pending state pairs planned at once");
+
+	properties::class_<ContainerBase, Stage>(m, "ContainerBase", R"(
 			Abstract base class for container stages
 			Containers allow encapsulation and reuse of planning functionality in a hierachical fashion.
 			You can iterate of the children of a container and access them by name.)")
+	    .property<uint32_t>("max_retained_solutions", "int: Number of best solutions to retain (0: all)")
 	    .def(
 	        "add",
 	        [](ContainerBase& c, const py::args& args) {
@@ -362,6 +610,11 @@ void export_core(pybind11::module& m) {
 	py::classh<SerialContainer, ContainerBase>(m, "SerialContainer", "Container implementing a linear planning sequence")
 	    .def(py::init<const std::string&>(), "name"_a = std::string("SerialContainer"));
 
+	properties::class_<ConcurrentSerialContainer, SerialContainer>(
+	    m, "ConcurrentSerialContainer", "SerialContainer computing its ready children concurrently")
+	    .property<size_t>("threads", "int: Number of threads if the Task plans sequentially (0: CPU cores)")
+	    .def(py::init<const std::string&>(), "name"_a = std::string("ConcurrentSerialContainer"));
+
 	py::classh<ParallelContainerBase, ContainerBase>(m, "ParallelContainerBase",
 	                                                 "Abstract base class for parallel containers");
 
@@ -399,12 +652,75 @@ void export_core(pybind11::module& m) {
 			the trajectory and output ``InterfaceStates``.
 			)");
 
+	auto policy = py::classh<ExecutionPolicy>(m, "ExecutionPolicy", R"(
+			Configuration of how ``Task.plan()`` schedules the computation of stages.
+			A parallel policy computes all ready children of a container concurrently.)");
+	py::enum_<ExecutionPolicy::Scheduling>(policy, "Scheduling", "Scheduling of children within serial containers")
+	    .value("ORDERED", ExecutionPolicy::ORDERED, "Compute all ready children in order")
+	    .value("ANYTIME", ExecutionPolicy::ANYTIME,
+	           "Until the first solution is found, only compute the child extending the deepest partial solution")
+	    .value("GLOBAL", ExecutionPolicy::GLOBAL,
+	           "Compute the stage extending the best partial solution of the whole task, then the fastest stage");
+	policy.def(py::init<>())
+	    .def_readwrite("threads", &ExecutionPolicy::threads,
+	                   "int: number of stages computed concurrently (1: sequential, 0: number of CPU cores)")
+	    .def_readwrite("scheduling", &ExecutionPolicy::scheduling, "Scheduling: scheduling of serial containers")
+	    .def_static("sequential", &ExecutionPolicy::sequential)
+	    .def_static("parallel", &ExecutionPolicy::parallel, "threads"_a = 0)
+	    .def_static("anytime", &ExecutionPolicy::anytime);
+
+	auto progress = py::classh<PlanningProgress>(m, "PlanningProgress", R"(
+			Progress of ``Task.planAsync()``: new solutions and statistics updates, consumed via ``next()``)");
+	py::classh<PlanningProgress::Event>(progress, "Event", "New solution or statistics update of asynchronous planning")
+	    .def_readonly("solution", &PlanningProgress::Event::solution,
+	                  "Solution: new solution of the task, None for a statistics update")
+	    .def_readonly("iterations", &PlanningProgress::Event::iterations, "int: planning iterations so far")
+	    .def_readonly("solutions", &PlanningProgress::Event::solutions, "int: number of solutions so far")
+	    .def_readonly("best_cost", &PlanningProgress::Event::best_cost, "float: cost of the best solution so far")
+	    .def_readonly("elapsed", &PlanningProgress::Event::elapsed, "float: seconds since planning started");
+	progress
+	    .def(
+	        "next",
+	        [](PlanningProgress& self, double timeout) -> py::object {
+		        PlanningProgress::Event event;
+		        bool valid;
+		        {
+			        py::gil_scoped_release release;
+			        valid = self.next(event, timeout);
+		        }
+		        return valid ? py::cast(std::move(event)) : py::none();
+	        },
+	        "timeout"_a = std::numeric_limits<double>::infinity(),
+	        "Wait up to timeout seconds for the next event, None on timeout or once planning finished")
+	    .def_property_readonly("finished", &PlanningProgress::finished,
+	                           "bool: planning finished (events might still be pending)")
+	    .def("setNotify", &PlanningProgress::setNotify, "notify"_a,
+	         "Call notify() from the planning thread after each new event and when finished. It must not raise.");
+
+	py::classh<AsyncPlanning>(m, "AsyncPlanning", "Handle of planning started by ``Task.planAsync()``")
+	    .def_readonly("progress", &AsyncPlanning::progress, "PlanningProgress: events of the planning job")
+	    .def(
+	        "done",
+	        [](const AsyncPlanning& self) {
+		        return self.result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+	        },
+	        "Whether planning finished")
+	    .def(
+	        "result", [](const AsyncPlanning& self) { return self.result.get(); },
+	        "Wait for planning to finish and return the result of ``plan()``, raising its exceptions",
+	        py::call_guard<py::gil_scoped_release>());
+
 	py::classh<Task>(m, "Task", R"(Root stage of a planning pipeline.
 			A task stage usually wraps a single container (by default ``SerialContainer``) stage.
 			The class provides methods to ``plan()`` for the configured pipeline and retrieve full solutions.)")
-	    .def(py::init<const std::string&, bool>(), "ns"_a = std::string(), "introspection"_a = true)
-	    .def(py::init<const std::string&, bool, ContainerBase::pointer&&>(), "ns"_a = std::string(),
-	         "introspection"_a = true, "container"_a)
+	    .def(py::init([](const std::string& ns, bool introspection) {
+		         return makeTask(std::make_unique<Task>(ns, introspection));
+	         }),
+	         "ns"_a = std::string(), "introspection"_a = true)
+	    .def(py::init([](const std::string& ns, bool introspection, ContainerBase::pointer&& container) {
+		         return makeTask(std::make_unique<Task>(ns, introspection, std::move(container)));
+	         }),
+	         "ns"_a = std::string(), "introspection"_a = true, "container"_a)
 
 	    .def_property_readonly("properties", py::overload_cast<>(&Task::properties),
 	                           "PropertyMap: PropertyMap of the stage (read-only)")
@@ -413,10 +729,44 @@ void export_core(pybind11::module& m) {
 	    .def_property("name", &Task::name, &Task::setName, "str: name of the task displayed e.g. in rviz")
 
 	    .def("loadRobotModel", &Task::loadRobotModel, "robot_description"_a = "robot_description",
-	         "Load robot model from given ROS parameter")
+	         "Load robot model from given ROS parameter", py::call_guard<py::gil_scoped_release>())
 	    .def("getRobotModel", &Task::getRobotModel)
 	    .def("enableIntrospection", &Task::enableIntrospection, "enabled"_a = true,
 	         "Enable publishing intermediate results for inspection in ``rviz``")
+	    .def("enableProfiling", &Task::enableProfiling, "enabled"_a = true,
+	         "Record computation times of stages, solvers, and cost terms during ``plan()``")
+	    .def("memoryUsage", &Task::memoryUsage, "Approximate memory held by all stages of the task")
+	    .def("saveSolutions", &Task::saveSolutions, "path"_a,
+	         "Archive all solutions (best first) into a file, which can be browsed offline in ``rviz``")
+	    .def(
+	        "chromeTrace",
+	        [](const Task& t) {
+		        std::ostringstream os;
+		        if (t.profiler())
+			        t.profiler()->writeChromeTrace(os);
+		        return os.str();
+	        },
+	        "Recorded profiling events as JSON in Chrome's trace event format")
+	    .def(
+	        "flameGraph",
+	        [](const Task& t) {
+		        std::ostringstream os;
+		        if (t.profiler())
+			        t.profiler()->writeFlameGraph(os);
+		        return os.str();
+	        },
+	        "Recorded profiling events as folded stacks (in microseconds) for ``flamegraph.pl``")
+	    .def("enableSchedulerLog", &Task::enableSchedulerLog, "enabled"_a = true,
+	         "capacity"_a = utils::SchedulerLog::DEFAULT_CAPACITY,
+	         "Record scheduling decisions of ``plan()`` in a ring buffer of given capacity")
+	    .def(
+	        "saveSchedulerLog",
+	        [](const Task& t, const std::string& path) {
+		        if (!t.schedulerLog())
+			        throw std::runtime_error("scheduler log is not enabled");
+		        t.schedulerLog()->save(path);
+	        },
+	        "path"_a, "Write the scheduling decisions to a binary file, to be analyzed by ``mtc_scheduler_log``")
 	    .def("clear", &Task::clear, "Reset the stage task (and all its stages)")
 	    .def(
 	        "add",
@@ -462,15 +812,33 @@ void export_core(pybind11::module& m) {
 	        "setCostTerm", [](Task& self, const LambdaCostTerm::SubTrajectoryShortSignature& f) { self.setCostTerm(f); },
 	        "Specify a function to calculate trajectory costs")
 	    .def("reset", &Task::reset, "Reset task (and all its stages)")
-	    .def("init", py::overload_cast<>(&Task::init), "Initialize the task (and all its stages)")
-	    .def("plan", &Task::plan, "max_solutions"_a = 0, R"(
+	    // long-running calls release the GIL, Python stages, cost terms, and callbacks reacquire it
+	    .def("init", py::overload_cast<>(&Task::init), "Initialize the task (and all its stages)",
+	         py::call_guard<py::gil_scoped_release>())
+	    .def("prewarm", &Task::prewarm, "policy"_a = ExecutionPolicy::parallel(),
+	         "Load the robot model and initialize all stages up front, concurrently as configured by the policy",
+	         py::call_guard<py::gil_scoped_release>())
+	    .def("plan", &Task::plan, "max_solutions"_a = 0, "policy"_a = ExecutionPolicy::sequential(), R"(
 			Reset, init, and plan. Planning is limited to ``max_allowed_solutions``.
-			Returns if planning was successful.)")
+			Stages are computed as configured by the ``ExecutionPolicy``.
+			Returns if planning was successful.)",
+	         py::call_guard<py::gil_scoped_release>())
+	    .def("planAndExecute", &Task::planAndExecute, "prefix_stages"_a, "policy"_a = ExecutionPolicy::sequential(),
+	         R"(
+			Plan and execute via the ``execute_task_solution`` action, starting execution of the first
+			``prefix_stages`` top-level stages as soon as their best solution is final, while planning continues.)",
+	         py::call_guard<py::gil_scoped_release>())
+	    .def("planAsync", &Task::planAsync, "max_solutions"_a = 0, "policy"_a = ExecutionPolicy::sequential(), R"(
+			Start ``plan()`` on a shared worker thread and return immediately.
+			The returned handle keeps the task alive. Destroying the task waits for planning to finish.
+			From ``asyncio``, use ``plan_async()`` instead.)",
+	         py::keep_alive<0, 1>())
 	    .def("preempt", &Task::preempt, "Interrupt current planning (or execution)")
 	    .def(
 	        "publish",
 	        [](Task& self, const SolutionBasePtr& solution) { self.introspection().publishSolution(*solution); },
-	        "solution"_a, "Publish the given solution to the ROS topic ``solution``")
+	        "solution"_a, "Publish the given solution to the ROS topic ``solution``",
+	        py::call_guard<py::gil_scoped_release>())
 	    .def_static(
 	        "execute",
 	        [](const SolutionBasePtr& solution) {
@@ -494,7 +862,8 @@ void export_core(pybind11::module& m) {
 		        }
 		        ROS_INFO("Executed successfully");
 	        },
-	        "solution"_a, "Send given solution to ``move_group`` node for execution");
+	        "solution"_a, "Send given solution to ``move_group`` node for execution",
+	        py::call_guard<py::gil_scoped_release>());
 }
 }  // namespace python
 }  // namespace moveit
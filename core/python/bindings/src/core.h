@@ -63,13 +63,25 @@ public:
 	void reset() override { PYBIND11_OVERRIDE(void, Stage, reset, ); }
 };
 
+/// convert a Python sequence of (InterfaceState, cost or SubTrajectory) pairs into a batch for Generator::spawnBatch()
+std::vector<std::pair<InterfaceState, SubTrajectory>> toSpawnBatch(const pybind11::handle& batch);
+
 template <class Generator = moveit::task_constructor::Generator>
 class PyGenerator : public PyStage<Generator>
 {
 public:
 	using PyStage<Generator>::PyStage;
 	bool canCompute() const override { PYBIND11_OVERRIDE_PURE(bool, Generator, canCompute, ); }
-	void compute() override { PYBIND11_OVERRIDE_PURE(void, Generator, compute, ); }
+	void compute() override {
+		pybind11::gil_scoped_acquire gil;
+		pybind11::function override = pybind11::get_override(static_cast<const Generator*>(this), "compute");
+		if (!override)
+			pybind11::pybind11_fail("Tried to call pure virtual function \"Generator::compute\"");
+		// compute() may return all its new states at once, which are spawned in a single batch
+		pybind11::object batch = override();
+		if (!batch.is_none())
+			this->spawnBatch(toSpawnBatch(batch));
+	}
 };
 
 template <class MonitoringGenerator = moveit::task_constructor::MonitoringGenerator>
@@ -131,6 +143,7 @@ PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::PropagatingForward)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::PropagatingBackward)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::Generator)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::MonitoringGenerator)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::Connecting)
 
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::ContainerBase)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::SerialContainer)
@@ -140,3 +153,6 @@ PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::Fallbacks)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::Merger)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::WrapperBase)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::Task)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::PlanningProgress)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::PlanningProgress::Event)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(moveit::task_constructor::AsyncPlanning)
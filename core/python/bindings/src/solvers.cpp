@@ -34,10 +34,16 @@
 
 #include <moveit/python/task_constructor/properties.h>
 #include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/solvers/jacobian_cartesian.h>
 #include <moveit/task_constructor/solvers/pipeline_planner.h>
 #include <moveit/task_constructor/solvers/joint_interpolation.h>
 #include <moveit/task_constructor/solvers/multi_planner.h>
+#include <moveit/task_constructor/solvers/caching_planner.h>
+#include <moveit/task_constructor/solvers/roadmap_planner.h>
+#include <moveit/task_constructor/solvers/remote_planner.h>
+#include <moveit/task_constructor/solvers/process_planner.h>
 #include <moveit_msgs/WorkspaceParameters.h>
+#include <pybind11/stl.h>
 #include "utils.h"
 
 namespace py = pybind11;
@@ -49,7 +55,12 @@ PYBIND11_SMART_HOLDER_TYPE_CASTERS(PlannerInterface)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(PipelinePlanner)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(JointInterpolationPlanner)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(CartesianPath)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(JacobianCartesian)
 PYBIND11_SMART_HOLDER_TYPE_CASTERS(MultiPlanner)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(CachingPlanner)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(RoadmapPlanner)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(RemotePlanner)
+PYBIND11_SMART_HOLDER_TYPE_CASTERS(ProcessPlanner)
 
 namespace moveit {
 namespace python {
@@ -59,6 +70,7 @@ void export_solvers(py::module& m) {
 	    .property<double>("max_velocity_scaling_factor", "float: Reduce the maximum velocity by scaling between (0,1]")
 	    .property<double>("max_acceleration_scaling_factor",
 	                      "float: Reduce the maximum acceleration by scaling between (0,1]")
+	    .property<bool>("defer_timing", "bool: Skip time parameterization until a trajectory is published or executed")
 	    .def_property_readonly("properties", py::overload_cast<>(&PlannerInterface::properties),
 	                           py::return_value_policy::reference_internal, "Properties of the planner");
 
@@ -75,6 +87,7 @@ void export_solvers(py::module& m) {
 			)")
 	    .property<std::string>("planner", "str: Planner ID")
 	    .property<uint>("num_planning_attempts", "int: Number of planning attempts")
+	    .property<uint>("pool_size", "int: Number of pipeline instances available for concurrent planning")
 	    .property<moveit_msgs::WorkspaceParameters>(
 	        "workspace_parameters",
 	        ":moveit_msgs:`WorkspaceParameters`: Specifies workspace box to be used for Cartesian sampling")
@@ -118,16 +131,44 @@ void export_solvers(py::module& m) {
 	        "float: Limit joint displacement between consecutive waypoints, thus preventing jumps in joint space. "
 	        "This values specifies the fraction of mean acceptable joint motion per step.")
 	    .property<double>("min_fraction", "float: Fraction of overall distance required to succeed.")
+	    .property<size_t>("segments", "int: Number of path segments, whose waypoints are solved concurrently.")
+	    .property<double>("min_step_size",
+	                      "float: Minimal step size when adaptively refining the path at joint-space jumps "
+	                      "(0: disabled).")
+	    .def(py::init<>());
+
+	properties::class_<JacobianCartesian, PlannerInterface>(m, "JacobianCartesian", R"(
+			Follow a straight Cartesian line by differential inverse kinematics, seeded from the start state.
+			Faster than CartesianPath for short approach and retreat motions, but fails close to singularities. ::
+
+				from moveit.task_constructor import core
+
+				# Instantiate Jacobian-based Cartesian planner
+				jacobianPlanner = core.JacobianCartesian()
+				jacobianPlanner.step_size = 0.005
+		)")
+	    .property<double>("step_size", "float: Limit the Cartesian translation between consecutive waypoints")
+	    .property<double>("rotation_step_size", "float: Limit the rotation between consecutive waypoints")
+	    .property<double>("damping", "float: Damping of the least-squares solution, trading accuracy for stability")
+	    .property<uint32_t>("max_iterations", "int: Maximum number of Jacobian steps to reach a waypoint")
+	    .property<double>("max_joint_step", "float: Limit any (single) joint change between two waypoints")
+	    .property<double>("min_fraction", "float: Fraction of overall distance required to succeed.")
 	    .def(py::init<>());
 
 	properties::class_<MultiPlanner, PlannerInterface>(m, "MultiPlanner", R"(
-			A meta planner that runs multiple alternative planners in sequence and returns the first found solution. ::
+			A meta planner that runs multiple alternative planners in sequence and returns the first found solution.
+			In race mode, all planners are run concurrently instead. ::
 
 				from moveit.task_constructor import core
 
 				# Instantiate MultiPlanner
 				multiPlanner = core.MultiPlanner()
+				multiPlanner.race = True
 		)")
+	    .property<bool>("race", "bool: Run all planners concurrently and return the first found solution")
+	    .property<double>("grace_period", "float: In race mode, time to wait for shorter solutions after the first one")
+	    .property<bool>("adaptive", "bool: In sequential mode, try planners in order of their expected time to success")
+	    .def("resetStatistics", &MultiPlanner::resetStatistics, "Forget the statistics recorded in adaptive mode")
 	    .def("__len__", &MultiPlanner::size)
 	    .def("__getitem__", &get_item<MultiPlanner>)
 	    .def(
@@ -140,6 +181,72 @@ void export_solvers(py::module& m) {
 	    .def(
 	        "clear", [](MultiPlanner& self) { self.clear(); }, "Remove all planners")
 	    .def(py::init<>());
+
+	properties::class_<CachingPlanner, PlannerInterface>(m, "CachingPlanner", R"(
+			A meta planner caching joint-space trajectories of a wrapped planner.
+			Cached trajectories are validated in the current scene before being reused. ::
+
+				from moveit.task_constructor import core
+
+				# Cache trajectories of an OMPL planner
+				cachingPlanner = core.CachingPlanner(core.PipelinePlanner())
+		)")
+	    .property<double>("resolution", "float: Quantization of joint values and object poses for cache lookup")
+	    .property<uint32_t>("max_entries", "int: Maximum number of cached trajectories")
+	    .property<bool>("warm_start", "bool: Keep the cache across replanning and ignore world changes in lookups")
+	    .def_property_readonly("planner", &CachingPlanner::planner, "PlannerInterface: wrapped planner")
+	    .def_property_readonly("hits", &CachingPlanner::hits, "int: Number of requests served from the cache")
+	    .def_property_readonly("misses", &CachingPlanner::misses, "int: Number of requests passed to the planner")
+	    .def("clear", &CachingPlanner::clear, "Clear the cache")
+	    .def(py::init<const PlannerInterfacePtr&>(), "planner"_a);
+
+	properties::class_<RoadmapPlanner, PlannerInterface>(m, "RoadmapPlanner", R"(
+			Multi-query joint-space planner, reusing a lazily validated roadmap per planning group
+			across requests. Validation results are revalidated when the scene changes. ::
+
+				from moveit.task_constructor import core
+
+				roadmapPlanner = core.RoadmapPlanner()
+				roadmapPlanner.max_nodes = 5000
+		)")
+	    .property<uint32_t>("max_nodes", "int: Maximum number of roadmap nodes per group")
+	    .property<uint32_t>("neighbors", "int: Number of nearest neighbors a new node is connected to")
+	    .property<uint32_t>("samples", "int: Number of random samples added when no path is found")
+	    .property<double>("resolution", "float: Joint-space distance between validated states along edges")
+	    .def("clear", &RoadmapPlanner::clear, "Discard all roadmaps")
+	    .def(py::init<>());
+
+	properties::class_<RemotePlanner, PipelinePlanner>(m, "RemotePlanner", R"(
+			Plan on remote move_group nodes running the PlanTrajectoryCapability,
+			sending each request to the least busy worker. ::
+
+				from moveit.task_constructor import core
+
+				remotePlanner = core.RemotePlanner(["/host1/plan_trajectory", "/host2/plan_trajectory"])
+		)")
+	    .property<double>("reply_timeout", "float: Time allowed for communication beyond the planning time")
+	    .def("pending", &RemotePlanner::pending, "worker"_a, "Number of requests currently pending at worker")
+	    .def(py::init<const std::vector<std::string>&>(),
+	         "workers"_a = std::vector<std::string>{ "plan_trajectory" });
+
+	properties::class_<ProcessPlanner, PlannerInterface>(m, "ProcessPlanner", R"(
+			Run a wrapped planner in a pool of worker processes, e.g. to plan concurrently with planners
+			that are not thread-safe. Requests and trajectories are exchanged via shared memory.
+			Workers are forked from a zygote process, which needs to be started before any threads,
+			and can create MTC's JointInterpolationPlanner, CartesianPath, and JacobianCartesian. ::
+
+				from moveit.task_constructor import core
+				core.ProcessPlanner.start_zygote()  # before importing rospy or starting threads
+
+				processPlanner = core.ProcessPlanner(core.CartesianPath())
+				processPlanner.num_processes = 4
+		)")
+	    .property<uint>("num_processes", "int: Number of worker processes (0: number of CPU cores)")
+	    .property<uint32_t>("buffer_size", "int: Bytes per worker for serialized requests and trajectories")
+	    .def_property_readonly("planner", &ProcessPlanner::planner, "PlannerInterface: wrapped planner")
+	    .def_static("start_zygote", &ProcessPlanner::startZygote,
+	                "Fork the process forking the workers, while the process is still single-threaded")
+	    .def(py::init<const PlannerInterfacePtr&>(), "planner"_a);
 }
 }  // namespace python
 }  // namespace moveit
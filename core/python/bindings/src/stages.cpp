@@ -94,6 +94,7 @@ void export_stages(pybind11::module& m) {
 
 		For an example, see :ref:`How-To-Guides <subsubsec-howto-modify-planning-scene>`.
 		)")
+		.property<bool>("incremental_collision_check", "bool: Only check collisions involving modified objects")
 		.def(py::init<const std::string&>(), "name"_a = std::string("modify planning scene"))
 		.def("attachObject", &ModifyPlanningScene::attachObject, "Attach an object to a robot link", "name"_a, "link"_a)
 		.def("detachObject", &ModifyPlanningScene::detachObject, "Detach an object from a robot link", "name"_a, "link"_a)
@@ -129,6 +130,7 @@ void export_stages(pybind11::module& m) {
 				:language: python
 
 		)")
+	    .property<uint32_t>("components", "int: Bitmask of moveit_msgs/PlanningSceneComponents requested from the service")
 	    .def(py::init<const std::string&>(), "name"_a = std::string("current state"));
 
 	properties::class_<FixedState, Stage>(m, "FixedState", R"(
@@ -198,6 +200,18 @@ void export_stages(pybind11::module& m) {
 		)")
 	    .property<double>("min_solution_distance", "reject solution that are closer than this to previously found solutions")
 	    .property<moveit_msgs::Constraints>("constraints", "additional constraints to obey")
+	    .property<uint32_t>("num_threads", R"(
+			int: Number of IK seeds processed concurrently.
+			Requires a thread-safe kinematics solver.
+		)")
+	    .property<uint32_t>("batch_size", R"(
+			int: Number of targets of the wrapped generator processed per compute().
+			If num_threads > 1, they are processed concurrently, requiring a thread-safe kinematics solver.
+		)")
+	    .property<double>("min_reachability", "float: Minimum score of targets in the reachability map")
+	    .property<bool>("rank_by_reachability", "bool: Process targets in order of decreasing reachability score")
+	    .property<uint32_t>("seed_cache_size", "int: Number of previous IK solutions kept to seed nearby targets")
+	    .property<bool>("multi_solution_ik", "bool: First query all IK solution branches at once (e.g. from IKFast)")
 	    .property<geometry_msgs::PoseStamped>("ik_frame", R"(
 			PoseStamped_: Specify the frame with respect
 			to which the inverse kinematics
@@ -241,6 +255,7 @@ void export_stages(pybind11::module& m) {
 
 			.. _Constraints: https://docs.ros.org/en/api/moveit_msgs/html/msg/Constraints.html
 		)")
+	    .property<bool>("cache_plans", "bool: Reuse trajectories to joint-space goals from identical start states")
 	    .def(py::init<const std::string&, const solvers::PlannerInterfacePtr&>(), "name"_a, "planner"_a)
 	    .def("setGoal", py::overload_cast<const geometry_msgs::PoseStamped&>(&MoveTo::setGoal), R"(
 			Move link to a given PoseStamped_
@@ -308,10 +323,12 @@ void export_stages(pybind11::module& m) {
 			with e.g. the connect stage.
 		)")
 	    .value("SEQUENTIAL", stages::Connect::MergeMode::SEQUENTIAL, "Store sequential trajectories")
-	    .value("WAYPOINTS", stages::Connect::MergeMode::WAYPOINTS, "Join trajectories by their waypoints");
+	    .value("WAYPOINTS", stages::Connect::MergeMode::WAYPOINTS, "Join trajectories by their waypoints")
+	    .value("CONCURRENT", stages::Connect::MergeMode::CONCURRENT,
+	           "Plan disjoint groups concurrently and join their trajectories by waypoints");
 	PropertyConverter<stages::Connect::MergeMode>();
 
-	properties::class_<Connect, Stage>(m, "Connect", R"(
+	properties::class_<Connect, Connecting>(m, "Connect", R"(
 			Connect arbitrary InterfaceStates by motion planning.
 			You can specify the planning groups and the planners you
 			want to utilize.
@@ -328,6 +345,7 @@ void export_stages(pybind11::module& m) {
 		)")
 	    .property<stages::Connect::MergeMode>("merge_mode", "Defines the merge strategy to use")
 	    .property<double>("max_distance", "maximally accepted distance between end and goal sate")
+	    .property<bool>("goal_set", "bool: Plan pairs sharing their start state towards all their goals at once")
 	    .def(py::init<const std::string&, const Connect::GroupPlannerVector&>(),
 	         "name"_a = std::string("connect"), "planners"_a);
 
@@ -342,6 +360,9 @@ void export_stages(pybind11::module& m) {
 	    .property<double>("max_penetration", R"(
 			float: Cutoff length up to which collision objects get fixed.
 		)")
+	    .property<bool>("joint_correction", R"(
+			bool: Correct all penetrations of an object at once per collision pass (least squares).
+		)")
 	    .def(py::init<const std::string&>(), "name"_a = std::string("fix collisions"));
 
 	properties::class_<GeneratePlacePose, MonitoringGenerator>(m, "GeneratePlacePose", R"(
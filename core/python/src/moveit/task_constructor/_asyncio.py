@@ -0,0 +1,75 @@
+"""asyncio integration of :class:`Task`, mixed into :mod:`moveit.task_constructor.core`"""
+
+import asyncio
+from pymoveit_mtc.core import Task
+
+
+class _PlanningStream(object):
+    """Runs Task.planAsync() and wakes the event loop whenever the planning thread reports progress"""
+
+    def __init__(self, task, max_solutions, policy):
+        self._loop = asyncio.get_running_loop()
+        self._wakeup = asyncio.Event()
+        if policy is None:
+            self._planning = task.planAsync(max_solutions)
+        else:
+            self._planning = task.planAsync(max_solutions, policy)
+        self._planning.progress.setNotify(self._notify)
+
+    def _notify(self):
+        # called from the planning thread: loop.call_soon_threadsafe is the only thread-safe entry point
+        try:
+            self._loop.call_soon_threadsafe(self._wakeup.set)
+        except RuntimeError:  # event loop already closed
+            pass
+
+    async def events(self):
+        progress = self._planning.progress
+        while True:
+            self._wakeup.clear()
+            finished = progress.finished  # read before polling: the final events precede finishing
+            event = progress.next(0.0)
+            if event is not None:
+                yield event
+            elif finished:
+                return
+            else:
+                await self._wakeup.wait()
+
+    async def result(self):
+        async for _ in self.events():
+            pass
+        return self._planning.result()  # ready by now, raises planning exceptions
+
+
+async def plan_async(self, max_solutions=0, policy=None):
+    """Coroutine planning the task without blocking the event loop, returning plan()'s result
+
+    Cancelling the coroutine preempts planning."""
+    stream = _PlanningStream(self, max_solutions, policy)
+    try:
+        return await stream.result()
+    except asyncio.CancelledError:
+        self.preempt()
+        raise
+
+
+async def solutions_async(self, max_solutions=0, policy=None):
+    """Asynchronous generator yielding the task's solutions as planning finds them
+
+    Planning errors are raised once all found solutions were yielded. Leaving the loop early preempts planning."""
+    stream = _PlanningStream(self, max_solutions, policy)
+    completed = False
+    try:
+        async for event in stream.events():
+            if event.solution is not None:
+                yield event.solution
+        stream._planning.result()
+        completed = True
+    finally:
+        if not completed:
+            self.preempt()
+
+
+Task.plan_async = plan_async
+Task.solutions_async = solutions_async
@@ -1,3 +1,7 @@
+import sys
 from pymoveit_mtc.core import *
 
+if sys.version_info >= (3, 7):
+    from . import _asyncio  # noqa: F401
+
 __doc__ = "Provides wrappers for :doc:`core C++ classes <pymoveit_mtc.core>`."
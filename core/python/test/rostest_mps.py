@@ -100,9 +100,10 @@ class TestModifyPlanningScene(unittest.TestCase):
         objects = [o.id for o in s.start_scene.world.collision_objects]
         self.assertTrue(objects == ["box"])
 
-        # only addObject(block) should add it
+        # only addObject(block) should add it, unchanged objects are omitted from the diff
         objects = [o.id for o in s.sub_trajectory[1].scene_diff.world.collision_objects]
-        self.assertTrue(objects == ["block", "box"])
+        self.assertTrue(objects == ["block"])
+        self.assertTrue(s.sub_trajectory[1].scene_diff.is_diff)
 
     def test_bw_remove_object(self):
         mps = stages.ModifyPlanningScene("removeObject(box) backwards")
@@ -1,6 +1,8 @@
 #! /usr/bin/env python
 
 from __future__ import print_function
+import sys
+import time
 import unittest
 import rostest
 from py_binding_tools import roscpp_init
@@ -10,6 +12,9 @@ from geometry_msgs.msg import Vector3Stamped, Vector3
 from std_msgs.msg import Header
 import rospy
 
+if sys.version_info >= (3, 7):
+    import asyncio
+
 
 class Test(unittest.TestCase):
     PLANNING_GROUP = "manipulator"
@@ -30,6 +35,49 @@ class Test(unittest.TestCase):
         self.assertEqual(len(task.solutions), 1)
         task.execute(task.solutions[0])
 
+    def test_TrajectoryArrays(self):
+        moveRel = stages.MoveRelative("moveRel", core.JointInterpolationPlanner())
+        moveRel.group = self.PLANNING_GROUP
+        moveRel.setDirection({"joint_1": 0.2})
+
+        def cost(trajectory):
+            arrays = trajectory.trajectoryArrays()
+            joint = arrays["names"].index("joint_1")
+            positions = arrays["positions"]
+            self.assertEqual(positions.shape, (len(arrays["times"]), len(arrays["names"])))
+            return float(abs(positions[-1, joint] - positions[0, joint]))
+
+        moveRel.setCostTerm(cost)
+        task = core.Task()
+        task.add(stages.CurrentState("current"), moveRel)
+
+        self.assertTrue(task.plan())
+        self.assertAlmostEqual(task.solutions[0].cost, 0.2)
+
+    def test_SolutionViews(self):
+        moveRel = stages.MoveRelative("moveRel", core.JointInterpolationPlanner())
+        moveRel.group = self.PLANNING_GROUP
+        moveRel.setDirection({"joint_1": 0.2})
+        moveRel.properties["compact_trajectories"] = True
+
+        task = core.Task()
+        task.add(stages.CurrentState("current"), moveRel)
+        self.assertTrue(task.plan())
+
+        solution = task.solutions[0]
+        self.assertIsInstance(solution, core.SolutionSequence)
+        self.assertEqual([s.creator for s in solution.solutions], ["current", "moveRel"])
+        trajectories = solution.subTrajectories()
+        self.assertEqual(len(trajectories), 2)
+
+        move = trajectories[1]
+        self.assertTrue(move.isCompact)
+        positions = move.positions
+        self.assertFalse(positions.flags.writeable)
+        self.assertEqual(positions.shape[1], len(move.variableNames))
+        joint = move.variableNames.index("joint_1")
+        self.assertAlmostEqual(positions[-1, joint] - positions[0, joint], 0.2)
+
     def test_Merger(self):
         cartesian = core.CartesianPath()
 
@@ -53,6 +101,43 @@ class Test(unittest.TestCase):
         task.init()
         self.assertFalse(task.plan())
 
+    @unittest.skipIf(sys.version_info < (3, 7), "requires asyncio.run")
+    def test_PlanAsync(self):
+        moveRel = stages.MoveRelative("moveRel", core.JointInterpolationPlanner())
+        moveRel.group = self.PLANNING_GROUP
+        moveRel.setDirection({"joint_1": 0.2})
+
+        task = core.Task()
+        task.add(stages.CurrentState("current"), moveRel)
+
+        async def plan():
+            solutions = [s async for s in task.solutions_async()]
+            self.assertEqual(len(solutions), 1)
+            self.assertTrue(await task.plan_async())
+
+        asyncio.run(plan())
+        self.assertEqual(len(task.solutions), 1)
+
+
+    def test_DestroyWhilePlanningAsync(self):
+        moveRel = stages.MoveRelative("moveRel", core.JointInterpolationPlanner())
+        moveRel.group = self.PLANNING_GROUP
+        moveRel.setDirection({"joint_1": 0.2})
+
+        def slowCost(trajectory):
+            time.sleep(0.1)  # keep planning running while the task is destroyed
+            return 0.0
+
+        task = core.Task()
+        task.add(stages.CurrentState("current"), moveRel)
+        task.setCostTerm(slowCost)
+        notified = []
+        planning = task.planAsync()
+        planning.progress.setNotify(lambda: notified.append(True))
+        # destroying the task waits for planning, which calls back into Python: this must not deadlock
+        del planning
+        del task
+        self.assertTrue(notified)
 
 if __name__ == "__main__":
     roscpp_init("test_mtc")
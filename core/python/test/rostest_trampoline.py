@@ -2,6 +2,7 @@
 # -*- coding: utf-8 -*-
 
 from __future__ import print_function
+import threading
 import unittest
 import rostest
 from py_binding_tools import roscpp_init
@@ -44,6 +45,18 @@ class PyGenerator(core.Generator):
         self.spawn(core.InterfaceState(self.ps), self.num)
 
 
+class PyBatchGenerator(PyGenerator):
+    """Returns all its states from a single compute() call."""
+
+    def canCompute(self):
+        return self.num > 0
+
+    def compute(self):
+        batch = [(core.InterfaceState(self.ps), i) for i in range(self.num)]
+        self.num = 0
+        return batch
+
+
 class PyMonitoringGenerator(core.MonitoringGenerator):
     """Implements a custom 'MonitoringGenerator' stage."""
 
@@ -111,6 +124,11 @@ class TestTrampolines(unittest.TestCase):
         task = self.create(PyGenerator())
         self.plan(task, expected_solutions=PyGenerator.max_calls)
 
+    @unittest.skipIf(len(pybind11_versions) > 1, incompatible_pybind11_msg)
+    def test_batch_generator(self):
+        task = self.create(PyBatchGenerator())
+        self.plan(task, expected_solutions=PyGenerator.max_calls)
+
     @unittest.skipIf(len(pybind11_versions) > 1, incompatible_pybind11_msg)
     def test_monitoring_generator(self):
         task = self.create(
@@ -121,6 +139,16 @@ class TestTrampolines(unittest.TestCase):
         task["generator"].setMonitoredStage(task["current"])
         self.plan(task, expected_solutions=PyMonitoringGenerator.solution_multiplier)
 
+    @unittest.skipIf(len(pybind11_versions) > 1, incompatible_pybind11_msg)
+    def test_plan_in_thread(self):
+        # plan() releases the GIL, Python stages reacquire it
+        task = self.create(PyGenerator())
+        thread = threading.Thread(target=task.plan)
+        thread.start()
+        thread.join(timeout=10)
+        self.assertFalse(thread.is_alive())
+        self.assertEqual(len(task.solutions), PyGenerator.max_calls)
+
     def test_propagator(self):
         task = self.create(
             PyMoveRelX(-0.2, self.cartesian),
@@ -166,6 +166,7 @@ class TestStages(unittest.TestCase):
         self._check(stage, "group", "group")
         self._check(stage, "default_pose", "default_pose")
         self._check(stage, "max_ik_solutions", 1)
+        self._check(stage, "batch_size", 4)
         self.assertRaises(TypeError, self._check_assign, stage, "max_ik_solutions", -1)
         self._check(stage, "ignore_collisions", False)
         self._check(stage, "ignore_collisions", True)
@@ -204,6 +205,9 @@ class TestStages(unittest.TestCase):
         planner = core.PipelinePlanner()
         stage = stages.Connect("connect", [("group1", planner), ("group2", planner)])
 
+        self.assertIsInstance(stage, core.Connecting)
+        self._check(stage, "batch_size", 4)
+
     def test_FixCollisionObjects(self):
         stage = stages.FixCollisionObjects("collision")
 
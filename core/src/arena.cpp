@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Memory arena for objects sharing the lifetime of a planning run
+ */
+
+#include <moveit/task_constructor/arena.h>
+
+#include <algorithm>
+#include <cassert>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+Arena::Arena(size_t block_size) : block_size_(roundUp(block_size)) {}
+
+Arena::~Arena() {
+	for (char* block : blocks_)
+		::operator delete(block);
+}
+
+void* Arena::allocate(size_t bytes) {
+	bytes = roundUp(std::max(bytes, sizeof(FreeNode)));
+	if (bytes > block_size_ / 4)  // large allocations are not worth pooling
+		return ::operator new(bytes);
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	// reuse previously released memory of same size
+	FreeNode*& head = free_lists_[bytes];
+	if (head) {
+		FreeNode* node = head;
+		head = node->next;
+		return node;
+	}
+	// otherwise take memory from current block
+	if (remaining_ < bytes) {
+		blocks_.push_back(static_cast<char*>(::operator new(block_size_)));
+		current_ = blocks_.back();
+		remaining_ = block_size_;
+	}
+	void* result = current_;
+	current_ += bytes;
+	remaining_ -= bytes;
+	return result;
+}
+
+void Arena::deallocate(void* p, size_t bytes) noexcept {
+	bytes = roundUp(std::max(bytes, sizeof(FreeNode)));
+	if (bytes > block_size_ / 4) {
+		::operator delete(p);
+		return;
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = free_lists_.find(bytes);  // created by allocate()
+	assert(it != free_lists_.end());
+	it->second = new (p) FreeNode{ it->second };
+}
+
+size_t Arena::capacity() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return blocks_.size() * block_size_;
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
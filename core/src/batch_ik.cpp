@@ -0,0 +1,62 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Pluggable backend solving the IK of many targets at once
+ */
+
+#include <moveit/task_constructor/batch_ik.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/robot_state/robot_state.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+void BatchIKSolver::solve(const std::vector<Query>& queries, double timeout, Solutions& solutions) const {
+	const auto& cancellation = CancellationToken::current();
+	solutions.assign(queries.size(), {});
+	for (size_t i = 0; i < queries.size() && !cancellation.cancelled(); ++i) {
+		const Query& query = queries[i];
+		moveit::core::RobotState state(*query.seed);
+		if (!state.setFromIK(query.jmg, query.target_pose, query.link->getName(), timeout, query.is_valid))
+			continue;
+		solutions[i].emplace_back();
+		state.copyJointGroupPositions(query.jmg, solutions[i].back());
+	}
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
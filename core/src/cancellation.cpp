@@ -0,0 +1,185 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Cooperative cancellation of long-running computations
+ */
+
+#include <moveit/task_constructor/cancellation.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+struct CancellationToken::State
+{
+	std::atomic<bool> cancelled{ false };
+	std::shared_ptr<State> parent;
+
+	std::mutex mutex;  // guards callbacks, locked while calling them
+	std::list<Callback> callbacks;
+};
+
+CancellationToken::Registration::Registration(const CancellationToken& token, Callback&& callback) {
+	// the callback is registered with the token and all its parents, but shall be called only once
+	Callback once = [called = std::make_shared<std::atomic<bool>>(false), callback = std::move(callback)] {
+		if (!called->exchange(true))
+			callback();
+	};
+	for (auto state = token.state_; state; state = state->parent) {
+		std::lock_guard<std::mutex> lock(state->mutex);
+		entries_.emplace_back(state, state->callbacks.insert(state->callbacks.end(), once));
+	}
+	// check after registration to not miss a concurrent cancellation
+	if (token.cancelled())
+		once();
+}
+
+CancellationToken::Registration::~Registration() {
+	for (auto& entry : entries_) {
+		std::lock_guard<std::mutex> lock(entry.first->mutex);
+		entry.first->callbacks.erase(entry.second);
+	}
+}
+
+CancellationToken::Activation::Activation(CancellationToken token) : previous_(std::move(current().state_)) {
+	current() = std::move(token);
+}
+
+CancellationToken::Activation::~Activation() {
+	current().state_ = std::move(previous_);
+}
+
+CancellationToken::CancellationToken() : state_(std::make_shared<State>()) {}
+
+CancellationToken& CancellationToken::current() {
+	static thread_local CancellationToken token(nullptr);
+	return token;
+}
+
+CancellationToken CancellationToken::child() const {
+	CancellationToken child;
+	child.state_->parent = state_;
+	return child;
+}
+
+void CancellationToken::cancel() {
+	if (!state_ || state_->cancelled.exchange(true))
+		return;
+	std::lock_guard<std::mutex> lock(state_->mutex);
+	for (const auto& callback : state_->callbacks)
+		callback();
+}
+
+void CancellationToken::reset() {
+	if (state_)
+		state_->cancelled = false;
+}
+
+bool CancellationToken::cancelled() const {
+	for (const State* state = state_.get(); state; state = state->parent.get())
+		if (state->cancelled)
+			return true;
+	return false;
+}
+
+CancellationTimer::CancellationTimer(const CancellationToken& token, double timeout) {
+	static constexpr double MAX_TIMEOUT = 365 * 24 * 3600.0;
+	if (!(timeout < MAX_TIMEOUT))  // also catches NaN
+		return;
+
+	const auto deadline = std::chrono::steady_clock::now() +
+	                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	                          std::chrono::duration<double>(std::max(timeout, 0.0)));
+	thread_ = std::thread([this, token = CancellationToken(token), deadline]() mutable {
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (!cv_.wait_until(lock, deadline, [this] { return stop_; }))
+			token.cancel();
+	});
+}
+
+CancellationTimer::~CancellationTimer() {
+	if (!thread_.joinable())
+		return;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_one();
+	thread_.join();
+}
+
+TimeSlice::Activation::Activation(Clock::time_point deadline) : previous_(current()) {
+	current() = std::min(previous_, deadline);
+}
+
+TimeSlice::Activation::Activation(double duration) : previous_(current()) {
+	static constexpr double MAX_DURATION = 365 * 24 * 3600.0;
+	if (duration < MAX_DURATION)  // also catches NaN
+		current() = std::min(previous_, Clock::now() + std::chrono::duration_cast<Clock::duration>(
+		                                                   std::chrono::duration<double>(std::max(duration, 0.0))));
+}
+
+TimeSlice::Activation::~Activation() {
+	current() = previous_;
+}
+
+TimeSlice::Clock::time_point& TimeSlice::current() {
+	static thread_local Clock::time_point deadline = Clock::time_point::max();
+	return deadline;
+}
+
+TimeSlice::Clock::time_point TimeSlice::deadline() {
+	return current();
+}
+
+bool TimeSlice::expired() {
+	const Clock::time_point deadline = current();
+	return deadline != Clock::time_point::max() && Clock::now() >= deadline;
+}
+
+double TimeSlice::remaining() {
+	const Clock::time_point deadline = current();
+	if (deadline == Clock::time_point::max())
+		return std::numeric_limits<double>::infinity();
+	return std::max(std::chrono::duration<double>(deadline - Clock::now()).count(), 0.0);
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
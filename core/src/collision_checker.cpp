@@ -0,0 +1,78 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Pluggable backend for batched collision queries
+ */
+
+#include <moveit/task_constructor/collision_checker.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <atomic>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+void CollisionChecker::checkStates(const planning_scene::PlanningScene& scene, const std::string& group,
+                                   const std::vector<const moveit::core::RobotState*>& states,
+                                   std::vector<bool>& colliding) const {
+	colliding.resize(states.size());
+	for (size_t i = 0; i < states.size(); ++i)
+		colliding[i] = scene.isStateColliding(*states[i], group);
+}
+
+size_t CollisionChecker::firstCollision(const planning_scene::PlanningScene& scene, const std::string& group,
+                                        const std::vector<const moveit::core::RobotState*>& states) const {
+	for (size_t i = 0; i < states.size(); ++i)
+		if (scene.isStateColliding(*states[i], group))
+			return i;
+	return states.size();
+}
+
+namespace {
+const CollisionCheckerPtr DEFAULT_CHECKER = std::make_shared<CollisionChecker>();
+CollisionCheckerPtr CHECKER = DEFAULT_CHECKER;  // only accessed via std::atomic_load/store
+}  // namespace
+
+CollisionCheckerPtr collisionChecker() {
+	return std::atomic_load(&CHECKER);
+}
+
+void setCollisionChecker(CollisionCheckerPtr checker) {
+	std::atomic_store(&CHECKER, checker ? std::move(checker) : DEFAULT_CHECKER);
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Memory-efficient storage of robot trajectories
+ */
+
+#include <moveit/task_constructor/compact_trajectory.h>
+#include <moveit/task_constructor/robot_state_pool.h>
+
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <numeric>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+CompactTrajectoryConstPtr CompactTrajectory::create(const robot_trajectory::RobotTrajectory& trajectory) {
+	if (trajectory.empty())
+		return CompactTrajectoryConstPtr();
+
+	const moveit::core::RobotState& reference = trajectory.getFirstWayPoint();
+	const size_t num_variables = reference.getVariableCount();
+	std::shared_ptr<CompactTrajectory> result(new CompactTrajectory());
+	result->group_ = trajectory.getGroup();
+	if (result->group_)
+		result->variables_ = result->group_->getVariableIndexList();
+	else {
+		result->variables_.resize(num_variables);
+		std::iota(result->variables_.begin(), result->variables_.end(), 0);
+	}
+
+	// all other variables need to be fixed
+	std::vector<bool> in_group(num_variables, false);
+	for (int variable : result->variables_)
+		in_group[variable] = true;
+	const size_t num_waypoints = trajectory.getWayPointCount();
+	bool velocities = false, accelerations = false, efforts = false;
+	for (size_t i = 0; i < num_waypoints; ++i) {
+		const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+		for (size_t v = 0; v < num_variables; ++v)
+			if (!in_group[v] && waypoint.getVariablePosition(v) != reference.getVariablePosition(v))
+				return CompactTrajectoryConstPtr();
+		velocities |= waypoint.hasVelocities();
+		accelerations |= waypoint.hasAccelerations();
+		efforts |= waypoint.hasEffort();
+	}
+
+	const size_t n = result->variables_.size();
+	result->durations_.reserve(num_waypoints);
+	result->positions_.reserve(num_waypoints * n);
+	auto append = [&result](std::vector<double>& matrix, const double* values) {
+		for (int variable : result->variables_)
+			matrix.push_back(values ? values[variable] : 0.0);
+	};
+	for (size_t i = 0; i < num_waypoints; ++i) {
+		const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+		result->durations_.push_back(trajectory.getWayPointDurationFromPrevious(i));
+		append(result->positions_, waypoint.getVariablePositions());
+		if (velocities)
+			append(result->velocities_, waypoint.hasVelocities() ? waypoint.getVariableVelocities() : nullptr);
+		if (accelerations)
+			append(result->accelerations_,
+			       waypoint.hasAccelerations() ? waypoint.getVariableAccelerations() : nullptr);
+		if (efforts)
+			append(result->efforts_, waypoint.hasEffort() ? waypoint.getVariableEffort() : nullptr);
+	}
+	result->reference_ = std::make_shared<moveit::core::RobotState>(reference);
+	return result;
+}
+
+robot_trajectory::RobotTrajectoryPtr CompactTrajectory::expand() const {
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(reference_->getRobotModel(), group_);
+	RobotStatePoolPtr pool = RobotStatePool::get(reference_->getRobotModel());
+	const size_t n = variables_.size();
+	for (size_t i = 0; i < durations_.size(); ++i) {
+		moveit::core::RobotStatePtr waypoint = pool->copy(*reference_);
+		for (size_t k = 0; k < n; ++k) {
+			const int variable = variables_[k];
+			waypoint->setVariablePosition(variable, positions_[i * n + k]);
+			if (!velocities_.empty())
+				waypoint->setVariableVelocity(variable, velocities_[i * n + k]);
+			if (!accelerations_.empty())
+				waypoint->setVariableAcceleration(variable, accelerations_[i * n + k]);
+			if (!efforts_.empty())
+				waypoint->setVariableEffort(variable, efforts_[i * n + k]);
+		}
+		waypoint->update();
+		trajectory->addSuffixWayPoint(waypoint, durations_[i]);
+	}
+	return trajectory;
+}
+
+size_t CompactTrajectory::memoryUsage() const {
+	return sizeof(double) * (durations_.size() + positions_.size() + velocities_.size() + accelerations_.size() +
+	                         efforts_.size()) +
+	       sizeof(int) * variables_.size();
+}
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -35,8 +35,10 @@
 /* Authors: Robert Haschke */
 
 #include <moveit/task_constructor/container_p.h>
+#include <moveit/task_constructor/hashing.h>
 #include <moveit/task_constructor/introspection.h>
 #include <moveit/task_constructor/merge.h>
+#include <moveit/task_constructor/thread_pool.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 
@@ -45,9 +47,17 @@
 #include <memory>
 #include <iostream>
 #include <algorithm>
+#include <boost/functional/hash.hpp>
 #include <boost/range/adaptor/reversed.hpp>
 #include <fmt/core.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
 #include <functional>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <typeinfo>
 
 using namespace std::placeholders;
 using namespace trajectory_processing;
@@ -86,11 +96,14 @@ printChildrenInterfaces(const ContainerBasePrivate& container, bool success, con
 ContainerBasePrivate::ContainerBasePrivate(ContainerBase* me, const std::string& name)
   : StagePrivate(me, name)
   , required_interface_(UNKNOWN)
+  , max_retained_solutions_(0)
+  , cost_pruning_slack_(std::numeric_limits<double>::infinity())
   , pending_backward_(new Interface)
   , pending_forward_(new Interface) {}
 
 ContainerBasePrivate& ContainerBasePrivate::operator=(ContainerBasePrivate&& other) {
 	assert(internal_external_.empty() && other.internal_external_.empty());
+	assert(external_internal_.empty() && other.external_internal_.empty());
 
 	// move StagePrivate members
 	this->StagePrivate::operator=(std::move(other));
@@ -166,69 +179,107 @@ void ContainerBasePrivate::compute() {
 template <Interface::Direction dir>
 void ContainerBasePrivate::setStatus(const Stage* creator, const InterfaceState* source, const InterfaceState* target,
                                      InterfaceState::Status status) {
-	if (status != InterfaceState::Status::ENABLED && creator) {
-		if (const auto* conn = dynamic_cast<const Connecting*>(creator)) {
-			auto cimpl = conn->pimpl();
-			// if creator is a Connecting stage and target has enabled opposite states (other than source)
-			if (cimpl->hasPendingOpposites<dir>(source, target))
-				return;  // don't prune
+	// Traverse the solution tree depth-first, using an explicit stack instead of recursion.
+	// Each state is updated at most once: revisiting an already updated state returns immediately.
+	struct Visit
+	{
+		const Stage* creator;
+		const InterfaceState* source;
+		const InterfaceState* target;
+		InterfaceState::Status status;
+	};
+	std::vector<Visit> stack{ { creator, source, target, status } };
+	while (!stack.empty()) {
+		const Visit v = stack.back();
+		stack.pop_back();
+		target = v.target;
+		status = v.status;
+
+		if (target->priority().status() == status)
+			continue;  // nothing changing, e.g. state was already reached via another path
+
+		if (status != InterfaceState::Status::ENABLED && v.creator) {
+			if (const auto* conn = dynamic_cast<const Connecting*>(v.creator)) {
+				auto cimpl = conn->pimpl();
+				// if creator is a Connecting stage and target has enabled opposite states (other than source)
+				if (cimpl->hasPendingOpposites<dir>(v.source, target))
+					continue;  // don't prune
+			}
 		}
-	}
-	if (target->priority().status() == status)
-		return;  // nothing changing
-
-	// Skip disabling the state, if there are alternative enabled solutions
-	if (status != InterfaceState::ENABLED) {
-		auto solution_is_enabled = [](auto&& solution) {
-			return state<opposite<dir>()>(*solution)->priority().enabled();
-		};
-		const auto& alternatives = trajectories<opposite<dir>()>(*target);
-		auto alternative_path = std::find_if(alternatives.cbegin(), alternatives.cend(), solution_is_enabled);
-		if (alternative_path != alternatives.cend())
-			return;
-	}
 
-	// actually enable/disable the state
-	const_cast<InterfaceState*>(target)->updateStatus(status);
-
-	// if possible (i.e. if target has an external counterpart), escalate setStatus to external interface
-	if (parent() && trajectories<dir>(*target).empty()) {
-		// TODO: This was coded with SerialContainer in mind. Not sure, it works for ParallelContainers
-		auto external{ internalToExternalMap().find(target) };
-		if (external != internalToExternalMap().end()) {  // do we have an external state?
-			// only escalate if there is no other *enabled* internal state connected to the same external one
-			// all internal states linked to external
-			auto internals{ externalToInternalMap().equal_range(external->get<EXTERNAL>()) };
-			auto is_enabled = [](const auto& ext_int_pair) { return ext_int_pair.second->priority().enabled(); };
-			auto other_path{ std::find_if(internals.first, internals.second, is_enabled) };
-			if (other_path == internals.second)
-				parent()->pimpl()->setStatus<dir>(nullptr, nullptr, external->get<EXTERNAL>(), status);
-			return;
+		// Skip disabling the state, if there are alternative enabled solutions
+		if (status != InterfaceState::ENABLED) {
+			auto solution_is_enabled = [](auto&& solution) {
+				return state<opposite<dir>()>(*solution)->priority().enabled();
+			};
+			const auto& alternatives = trajectories<opposite<dir>()>(*target);
+			auto alternative_path = std::find_if(alternatives.cbegin(), alternatives.cend(), solution_is_enabled);
+			if (alternative_path != alternatives.cend())
+				continue;
 		}
-	}
 
-	// To break symmetry between both ends of a partial solution sequence that gets disabled,
-	// we mark the first state with ARMED and all other states down the tree with PRUNED.
-	// This allows us to re-enable the ARMED state, but not the PRUNED states,
-	// when new states arrive in a Connecting stage.
-	// For details, https://github.com/moveit/moveit_task_constructor/pull/309#issuecomment-974636202
-	if (status == InterfaceState::Status::ARMED)
-		status = InterfaceState::Status::PRUNED;  // only the first state is marked as ARMED
+		// actually enable/disable the state
+		target->updateStatus(status);
+
+		// if possible (i.e. if target has an external counterpart), escalate setStatus to external interface
+		if (parent() && trajectories<dir>(*target).empty()) {
+			// TODO: This was coded with SerialContainer in mind. Not sure, it works for ParallelContainers
+			auto external{ internalToExternalMap().find(target) };
+			if (external != internalToExternalMap().end()) {  // do we have an external state?
+				// only escalate if there is no other *enabled* internal state connected to the same external one
+				// all internal states linked to external
+				const InternalStates& internals = internalStates(external->second);
+				auto is_enabled = [](const InterfaceState* internal) { return internal->priority().enabled(); };
+				auto other_path{ std::find_if(internals.begin(), internals.end(), is_enabled) };
+				if (other_path == internals.end())
+					parent()->pimpl()->setStatus<dir>(nullptr, nullptr, external->second, status);
+				continue;
+			}
+		}
 
-	// traverse solution tree
-	for (const SolutionBase* successor : trajectories<dir>(*target))
-		setStatus<dir>(successor->creator(), target, state<dir>(*successor), status);
+		// To break symmetry between both ends of a partial solution sequence that gets disabled,
+		// we mark the first state with ARMED and all other states down the tree with PRUNED.
+		// This allows us to re-enable the ARMED state, but not the PRUNED states,
+		// when new states arrive in a Connecting stage.
+		// For details, https://github.com/moveit/moveit_task_constructor/pull/309#issuecomment-974636202
+		if (status == InterfaceState::Status::ARMED)
+			status = InterfaceState::Status::PRUNED;  // only the first state is marked as ARMED
+
+		// traverse solution tree, pushing successors in reverse order to visit them in order
+		const auto& successors = trajectories<dir>(*target);
+		for (auto it = successors.rbegin(); it != successors.rend(); ++it)
+			stack.push_back({ (*it)->creator(), target, state<dir>(**it), status });
+	}
 }
 
-// recursively update state priorities along solution path
+// update state priorities along solution path, visiting each state at most once
 template <Interface::Direction dir>
 inline void updateStatePrios(const InterfaceState& s, const InterfaceState::Priority& prio) {
-	InterfaceState::Priority priority(prio, s.priority().status());
-	if (s.priority() == priority)
+	std::vector<const InterfaceState*> stack{ &s };
+	while (!stack.empty()) {
+		const InterfaceState* current = stack.back();
+		stack.pop_back();
+		InterfaceState::Priority priority(prio, current->priority().status());
+		if (current->priority() == priority)
+			continue;  // already up-to-date, e.g. reached via another path
+		current->updatePriority(priority);
+		for (const SolutionBase* successor : trajectories<dir>(*current))
+			stack.push_back(state<dir>(*successor));
+	}
+}
+
+void ContainerBasePrivate::onReleaseState(const InterfaceState& state) {
+	auto it = internal_external_.find(&state);
+	if (it == internal_external_.end())
 		return;
-	const_cast<InterfaceState&>(s).updatePriority(priority);
-	for (const SolutionBase* successor : trajectories<dir>(s))
-		updateStatePrios<dir>(*state<dir>(*successor), prio);
+	auto links = external_internal_.find(it->second);
+	if (links != external_internal_.end()) {
+		InternalStates& internals = links->second;
+		internals.erase(std::remove(internals.begin(), internals.end(), &state), internals.end());
+		if (internals.empty())
+			external_internal_.erase(links->first);
+	}
+	internal_external_.erase(&state);
 }
 
 void ContainerBasePrivate::onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to) {
@@ -254,28 +305,75 @@ void ContainerBasePrivate::onNewFailure(const Stage& child, const InterfaceState
 	// printChildrenInterfaces(*this, false, child);
 }
 
+void ContainerBasePrivate::computeConcurrently(const std::vector<StagePrivate*>& children) {
+	if (!threadPool() || children.size() < 2) {
+		for (StagePrivate* child : children)
+			child->runCompute();
+		return;
+	}
+
+	std::vector<DeferredActions> actions(children.size());
+	std::vector<utils::ThreadPool::Job> jobs;
+	jobs.reserve(children.size());
+	for (size_t i = 0; i < children.size(); ++i)
+		jobs.emplace_back([child = children[i], &actions = actions[i], profiling = utils::Profiler::context(),
+		                   cancellation = utils::CancellationToken::current(), deadline = utils::TimeSlice::deadline()] {
+			DeferredActions::Scope scope(actions);
+			utils::Profiler::Activation activation(profiling);
+			utils::CancellationToken::Activation cancellation_activation(cancellation);
+			utils::TimeSlice::Activation time_slice(deadline);
+			child->runCompute();
+		});
+
+	std::exception_ptr error;
+	try {
+		threadPool()->run(jobs);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	// apply results of all children in original order
+	for (auto& a : actions)
+		a.apply();
+	if (error)
+		std::rethrow_exception(error);
+}
+
+bool ContainerBasePrivate::withheldByBudget(const StagePrivate* child) const {
+	if (!child->overBudget())
+		return false;
+	for (const Stage::pointer& stage : children()) {
+		const StagePrivate* other = stage->pimpl();
+		if (other != child && !other->overBudget() && other->canCompute())
+			return true;
+	}
+	return false;
+}
+
 template <Interface::Direction dir>
 void ContainerBasePrivate::copyState(Interface::iterator external, const InterfacePtr& target,
                                      Interface::UpdateFlags updated) {
 	if (updated) {
 		auto prio = external->priority();
-		auto internals = externalToInternalMap().equal_range(&*external);
+		// copy the links, as setStatus() might add new ones
+		const InternalStates internals = internalStates(&*external);
 
 		if (updated.testFlag(Interface::Update::STATUS)) {  // propagate external status updates to internal copies
-			for (auto& i = internals.first; i != internals.second; ++i)
-				setStatus<dir>(nullptr, nullptr, i->second, prio.status());
+			for (const InterfaceState* internal : internals)
+				setStatus<dir>(nullptr, nullptr, internal, prio.status());
 		} else if (updated.testFlag(Interface::Update::PRIORITY)) {
-			for (auto& i = internals.first; i != internals.second; ++i)
-				updateStatePrios<opposite<dir>()>(*i->second, prio);
+			Interface::BatchNotify batch;
+			for (const InterfaceState* internal : internals)
+				updateStatePrios<opposite<dir>()>(*internal, prio);
 		} else
 			assert(false);  // Expecting either STATUS or PRIORITY updates, not both!
 		return;
 	}
 	// create a clone of external state within target interface (child's starts() or ends())
 	auto internal = states_.insert(states_.end(), InterfaceState(*external));
+	invalidateMemoryUsage();
 	target->add(*internal);
 	// and remember the mapping between them
-	internalToExternalMap().insert(std::make_pair(&*internal, &*external));
+	linkStates(&*internal, &*external);
 }
 
 void ContainerBasePrivate::copyState(Interface::Direction dir, Interface::iterator external, const InterfacePtr& target,
@@ -288,7 +386,31 @@ void ContainerBasePrivate::copyState(Interface::Direction dir, Interface::iterat
 
 void ContainerBasePrivate::liftSolution(const SolutionBasePtr& solution, const InterfaceState* internal_from,
                                         const InterfaceState* internal_to) {
-	computeCost(*internal_from, *internal_to, *solution);
+	utils::ScopedTimer timer("lift", name());
+	const double threshold = retentionThreshold();
+	computeCost(*internal_from, *internal_to, *solution, threshold);
+	if (!solution->isFailure() && solution->cost() >= threshold)
+		return;  // solution cannot enter the top max_retained_solutions: drop it
+
+	// The task's root keeps only the cheapest of solutions with the same sub trajectories
+	const bool root = parent() && !parent()->pimpl()->parent();
+	const bool dedup = root && solution_dedup_resolution_ > 0.0 && !solution->isFailure();
+	size_t hash = 0;
+	const SolutionBase* duplicate = nullptr;
+	if (dedup) {
+		hash = solutionHash(*solution);
+		auto range = solution_by_hash_.equal_range(hash);
+		for (auto it = range.first; it != range.second; ++it) {
+			if (!solutionsEqual(*it->second, *solution))
+				continue;  // hash collision
+			if (it->second->cost() <= solution->cost()) {
+				solution_hashes_.erase(solution.get());
+				return;  // a cheaper copy is retained already: drop solution
+			}
+			duplicate = it->second;
+			break;
+		}
+	}
 
 	// map internal to external states
 	auto find_or_create_external = [this](const InterfaceState* internal, bool& created) -> InterfaceState* {
@@ -297,7 +419,8 @@ void ContainerBasePrivate::liftSolution(const SolutionBasePtr& solution, const I
 			return const_cast<InterfaceState*>(it->second);
 
 		InterfaceState* external = &*states_.insert(states_.end(), InterfaceState(*internal));
-		internalToExternalMap().insert(std::make_pair(internal, external));
+		invalidateMemoryUsage();
+		linkStates(internal, external);
 		created = true;
 		return external;
 	};
@@ -320,9 +443,131 @@ void ContainerBasePrivate::liftSolution(const SolutionBasePtr& solution, const I
 		nextStarts()->add(*external_to);
 
 	newSolution(solution);
+
+	// Solutions of the task's root container are not referenced by any other solution.
+	// Thus, a more expensive duplicate and those dropping out of the top max_retained_solutions can be released.
+	if (dedup) {
+		if (duplicate) {
+			parent()->pimpl()->flushPendingSolutions();
+			auto it = std::find_if(solutions_.begin(), solutions_.end(),
+			                       [duplicate](const SolutionBaseConstPtr& s) { return s.get() == duplicate; });
+			assert(it != solutions_.end());
+			SolutionBaseConstPtr released = *it;
+			solutions_.erase(it);
+			forgetSolutionHash(*released);
+			discardSolution(released);
+		}
+		solution_by_hash_.emplace(hash, solution.get());
+	}
+	if (max_retained_solutions_ > 0 && root) {
+		if (solutions_.size() > max_retained_solutions_)
+			parent()->pimpl()->flushPendingSolutions();
+		while (solutions_.size() > max_retained_solutions_) {
+			SolutionBaseConstPtr worst = solutions_.back();
+			solutions_.erase(std::prev(solutions_.end()));
+			if (solution_dedup_resolution_ > 0.0)
+				forgetSolutionHash(*worst);
+			discardSolution(worst);
+		}
+	}
+}
+
+size_t ContainerBasePrivate::solutionHash(const SolutionBase& solution) {
+	std::vector<const SubTrajectory*> trajectories;
+	flatten(solution, trajectories);
+	size_t seed = 0;
+	for (const SubTrajectory* trajectory : trajectories) {
+		auto& memo = trajectory_hashes_[trajectory];
+		if (memo.first != trajectory->trajectoryRevision())  // unknown or replaced trajectory
+			memo = std::make_pair(trajectory->trajectoryRevision(),
+			                      utils::coarseTrajectoryHash(*trajectory, solution_dedup_resolution_));
+		boost::hash_combine(seed, memo.second);
+	}
+	solution_hashes_.emplace(&solution, seed);
+	return seed;
+}
+
+bool ContainerBasePrivate::solutionsEqual(const SolutionBase& a, const SolutionBase& b) const {
+	std::vector<const SubTrajectory*> a_trajectories, b_trajectories;
+	flatten(a, a_trajectories);
+	flatten(b, b_trajectories);
+	if (a_trajectories.size() != b_trajectories.size())
+		return false;
+	for (size_t i = 0; i < a_trajectories.size(); ++i)
+		if (!utils::trajectoriesEqual(*a_trajectories[i], *b_trajectories[i], solution_dedup_resolution_))
+			return false;
+	return true;
+}
+
+void ContainerBasePrivate::forgetSolutionHash(const SolutionBase& solution) {
+	auto it = solution_hashes_.find(&solution);
+	if (it == solution_hashes_.end())
+		return;
+	auto range = solution_by_hash_.equal_range(it->second);
+	for (auto retained = range.first; retained != range.second; ++retained)
+		if (retained->second == &solution) {
+			solution_by_hash_.erase(retained);
+			break;
+		}
+	solution_hashes_.erase(it);
+}
+
+double ContainerBasePrivate::retentionThreshold() const {
+	if (max_retained_solutions_ == 0 || solutions_.size() < max_retained_solutions_)
+		return std::numeric_limits<double>::infinity();
+	// solutions are sorted by cost: the k-th solution defines the threshold
+	return (*std::next(solutions_.begin(), max_retained_solutions_ - 1))->cost();
 }
 
-ContainerBase::ContainerBase(ContainerBasePrivate* impl) : Stage(impl) {}
+bool ContainerBasePrivate::liftingPreservesCost() const {
+	const CostTerm& term = *cost_term_;
+	return typeid(term) == typeid(CostTerm);
+}
+
+double ContainerBasePrivate::costPruningBound() const {
+	if (!std::isfinite(cost_pruning_slack_) || solutions_.empty() || !liftingPreservesCost())
+		return std::numeric_limits<double>::infinity();
+	// solutions are sorted by cost: the first one is the best
+	return (*solutions_.begin())->cost() + cost_pruning_slack_;
+}
+
+void ContainerBasePrivate::pruneByCost(const InterfaceState& state, double bound) {
+	// only consider enabled states, pending in a child's interface
+	if (!state.owner() || !state.priority().enabled() || state.priority().cost() <= bound)
+		return;
+	// states linking to our external interfaces are pruned by the parent (if at all)
+	if (internalToExternalMap().find(&state) != internalToExternalMap().end())
+		return;
+	ROS_DEBUG_STREAM_NAMED("Pruning", fmt::format("'{}' prunes state of cost {} exceeding bound {}", name(),
+	                                              state.priority().cost(), bound));
+	state.updateStatus(InterfaceState::Status::PRUNED);
+}
+
+void ContainerBasePrivate::pruneByCost(double bound) {
+	std::vector<const InterfaceState*> candidates;
+	for (const auto& child : children()) {
+		for (const InterfacePtr& interface : { child->pimpl()->starts(), child->pimpl()->ends() }) {
+			if (!interface)
+				continue;
+			const auto& priorities = interface->priorities();  // scan the dense table instead of the list
+			for (size_t i = 0; i < priorities.size(); ++i)
+				if (priorities[i].enabled() && priorities[i].cost() > bound)
+					candidates.push_back(interface->states()[i]);
+		}
+	}
+	// updating a state's status reorders its interface: don't do it while iterating
+	for (const InterfaceState* state : candidates)
+		pruneByCost(*state, bound);
+}
+
+ContainerBase::ContainerBase(ContainerBasePrivate* impl) : Stage(impl) {
+	properties().declare<uint32_t>("max_retained_solutions", 0u, "number of best solutions to retain (0: all)");
+	properties().declare<double>("cost_pruning_slack", std::numeric_limits<double>::infinity(),
+	                             "prune pending states exceeding the best solution's cost by this (inf: disabled)");
+	properties().declare<double>("solution_dedup_resolution", 0.0,
+	                             "task's root only: keep the cheapest of solutions with trajectories identical up to "
+	                             "this joint resolution (0: disabled)");
+}
 
 size_t ContainerBase::numChildren() const {
 	return pimpl()->children().size();
@@ -407,7 +652,11 @@ void ContainerBase::reset() {
 	impl->pending_backward_->clear();
 	impl->pending_forward_->clear();
 	// ... and state mapping
-	impl->internalToExternalMap().clear();
+	impl->clearStateLinks();
+	// ... and solution hashes
+	impl->solution_by_hash_.clear();
+	impl->solution_hashes_.clear();
+	impl->trajectory_hashes_.clear();
 
 	// interfaces depend on children which might change
 	impl->required_interface_ = UNKNOWN;
@@ -422,25 +671,45 @@ void ContainerBase::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	auto& children = impl->children();
 
 	Stage::init(robot_model);
+	impl->max_retained_solutions_ = properties().get<uint32_t>("max_retained_solutions");
+	impl->cost_pruning_slack_ = properties().get<double>("cost_pruning_slack");
+	impl->solution_dedup_resolution_ = properties().get<double>("solution_dedup_resolution");
 
 	// we need to have some children to do the actual work
 	if (children.empty())
 		throw InitStageException(*this, "no children");
 
 	// recursively init all children and accumulate errors
-	InitStageException errors;
-	for (auto& child : children) {
+	auto init_child = [impl, &robot_model](Stage& child, InitStageException& errors) {
 		try {
-			child->init(robot_model);
+			child.init(robot_model);
 		} catch (const Property::error& e) {
 			std::ostringstream oss;
 			oss << e.what();
-			pimpl()->composePropertyErrorMsg(e.name(), oss);
-			errors.push_back(*child, oss.str());
+			impl->composePropertyErrorMsg(e.name(), oss);
+			errors.push_back(child, oss.str());
 		} catch (InitStageException& e) {
 			errors.append(e);
 		}
-	}
+	};
+	InitStageException errors;
+	utils::ThreadPool* pool = impl->threadPool();
+	if (pool && children.size() > 1) {
+		// children only depend on their parent's (already initialized) properties: init subtrees concurrently
+		std::vector<InitStageException> child_errors(children.size());
+		std::vector<utils::ThreadPool::Job> jobs;
+		jobs.reserve(children.size());
+		size_t index = 0;
+		for (auto& child : children)
+			jobs.push_back([&init_child, stage = child.get(), child_error = &child_errors[index++]] {
+				init_child(*stage, *child_error);
+			});
+		pool->run(jobs);
+		for (auto& child_error : child_errors)  // report errors in order of children
+			errors.append(child_error);
+	} else
+		for (auto& child : children)
+			init_child(*child, errors);
 
 	if (errors)
 		throw errors;
@@ -469,38 +738,77 @@ std::ostream& operator<<(std::ostream& os, const ContainerBase& container) {
 	return os;
 }
 
-/** Collect all partial solution sequences originating from start into given direction */
 template <Interface::Direction dir>
-struct SolutionCollector
-{
-	SolutionCollector(size_t max_depth, const SolutionBase& start) : max_depth(max_depth) {
-		trace.reserve(max_depth);
-		traverse(start, InterfaceState::Priority(0, 0.0));
-		assert(trace.empty());
+const SerialContainerPrivate::PartialPaths& SerialContainerPrivate::partialPaths(const InterfaceState& s,
+                                                                                 size_t depth) {
+	auto& cache = partial_paths_[dir];
+	auto it = cache.find(&s);
+	if (it != cache.end())
+		return it->second;
+
+	PartialPaths paths;
+	const InterfaceState::Solutions& next = trajectories<dir>(s);
+	if (next.empty()) {  // reached the end of the chain: the empty path is complete if we reached the boundary
+		if (depth == 0)
+			paths.complete.emplace_back();
+		paths.has_last = true;
 	}
 
-	void traverse(const SolutionBase& start, const InterfaceState::Priority& prio) {
-		const InterfaceState::Solutions& next = trajectories<dir>(*state<dir>(start));
-		if (next.empty()) {  // when reaching the end, add the trace to solutions
-			assert(prio.depth() == trace.size());
-			assert(prio.depth() <= max_depth);
-			solutions.emplace_back(std::make_pair(trace, prio));
-		} else {
-			for (SolutionBase* successor : next) {
-				if (successor->isFailure())
-					continue;  // skip failures
-				trace.push_back(successor);
-				traverse(*successor, prio + InterfaceState::Priority(1, successor->cost()));
-				trace.pop_back();
-			}
+	const SolutionBase* last = nullptr;
+	PartialPathPtr last_tail;
+	for (const SolutionBase* successor : next) {
+		if (successor->isFailure())
+			continue;  // skip failures
+		assert(depth > 0);  // states at the boundary don't have internal successors
+		const PartialPaths& tail = partialPaths<dir>(*state<dir>(*successor), depth - 1);
+		for (const PartialPathPtr& path : tail.complete)
+			paths.complete.push_back(std::make_shared<const PartialPath>(PartialPath{ successor, path }));
+		if (tail.has_last) {
+			last = successor;
+			last_tail = tail.last;
 		}
 	}
+	if (last) {
+		paths.last = std::make_shared<const PartialPath>(PartialPath{ last, last_tail });
+		paths.has_last = true;
+	}
+	// references into an unordered_map remain valid on insertion
+	return cache.emplace(&s, std::move(paths)).first->second;
+}
 
-	using SolutionCostPairs = std::list<std::pair<SolutionSequence::container_type, InterfaceState::Priority>>;
-	SolutionCostPairs solutions;
-	const size_t max_depth;
-	SolutionSequence::container_type trace;
-};
+template <Interface::Direction dir>
+void SerialContainerPrivate::invalidatePartialPaths(const InterfaceState& s) {
+	// cached paths of a state are computed from the cached paths of its successors (in dir)
+	// Hence, if s is not cached, none of the states depending on s (in the opposite direction) are.
+	if (partial_paths_[dir].erase(&s) == 0)
+		return;
+	for (const SolutionBase* predecessor : trajectories<opposite<dir>()>(s))
+		invalidatePartialPaths<dir>(*state<opposite<dir>()>(*predecessor));
+}
+
+void SerialContainerPrivate::reset() {
+	for (auto& cache : partial_paths_)
+		cache.clear();
+}
+
+void SerialContainerPrivate::onReleaseState(const InterfaceState& state) {
+	for (auto& cache : partial_paths_)
+		cache.erase(&state);
+	ContainerBasePrivate::onReleaseState(state);
+}
+
+// accumulate priority of a partial path, starting from the solution closest to its origin
+inline InterfaceState::Priority pathPriority(const SerialContainerPrivate::PartialPath* path) {
+	InterfaceState::Priority prio(0, 0.0);
+	for (; path; path = path->next.get())
+		prio = prio + InterfaceState::Priority(1, path->solution->cost());
+	return prio;
+}
+
+void SerialContainer::reset() {
+	ContainerBase::reset();
+	pimpl()->reset();
+}
 
 void SerialContainer::onNewSolution(const SolutionBase& current) {
 	ROS_DEBUG_STREAM_NAMED("SerialContainer", fmt::format("'{}' received solution of child stage '{}'", this->name(),
@@ -521,41 +829,86 @@ void SerialContainer::onNewSolution(const SolutionBase& current) {
 	assert(num_before < children.size());  // creator should be one of our children
 	num_after = children.size() - 1 - num_before;
 
+	// current extends the partial paths of all states beyond its start and end
+	impl->invalidatePartialPaths<Interface::BACKWARD>(*current.end());
+	impl->invalidatePartialPaths<Interface::FORWARD>(*current.start());
+
 	// find all incoming and outgoing solution paths originating from current solution
-	SolutionCollector<Interface::BACKWARD> incoming(num_before, current);
-	SolutionCollector<Interface::FORWARD> outgoing(num_after, current);
+	const auto& incoming = impl->partialPaths<Interface::BACKWARD>(*current.start(), num_before);
+	const auto& outgoing = impl->partialPaths<Interface::FORWARD>(*current.end(), num_after);
+
+	std::vector<InterfaceState::Priority> outgoing_prios;
+	outgoing_prios.reserve(outgoing.complete.size());
+	for (const auto& out : outgoing.complete)
+		outgoing_prios.push_back(pathPriority(out.get()));
+
+	// If lifting preserves costs, solutions not entering the top max_retained_solutions don't need to be built at all
+	const bool prune = impl->max_retained_solutions_ > 0 && impl->liftingPreservesCost();
+	double threshold = prune ? impl->retentionThreshold() : std::numeric_limits<double>::infinity();
 
 	// collect (and sort) all solutions spanning from start to end of this container
 	ordered<SolutionSequencePtr> sorted;
-	for (auto& in : incoming.solutions) {
-		for (auto& out : outgoing.solutions) {
-			InterfaceState::Priority prio = in.second + InterfaceState::Priority(1u, current.cost()) + out.second;
+	SolutionSequence::container_type trace;
+	for (const auto& in : incoming.complete) {
+		const InterfaceState::Priority in_prio = pathPriority(in.get()) + InterfaceState::Priority(1u, current.cost());
+		trace.clear();
+		for (const SerialContainerPrivate::PartialPath* p = in.get(); p; p = p->next.get())
+			trace.push_back(p->solution);
+
+		auto out_prio = outgoing_prios.cbegin();
+		for (const auto& out : outgoing.complete) {
+			InterfaceState::Priority prio = in_prio + *out_prio++;
 			assert(prio.enabled());
-			// found a complete solution path connecting start to end?
-			if (prio.depth() == children.size()) {
-				SolutionSequence::container_type solution;
-				solution.reserve(children.size());
-				// insert incoming solutions in reverse order
-				solution.insert(solution.end(), in.first.rbegin(), in.first.rend());
-				// insert current solution
-				solution.push_back(&current);
-				// insert outgoing solutions in normal order
-				solution.insert(solution.end(), out.first.begin(), out.first.end());
-				// store solution in sorted list
-				sorted.insert(std::make_shared<SolutionSequence>(std::move(solution), prio.cost(), this));
-			}
-			if (prio.depth() > 1) {
-				// update state priorities along the whole partial solution path
-				updateStatePrios<Interface::BACKWARD>(*current.start(), prio);
-				updateStatePrios<Interface::FORWARD>(*current.end(), prio);
+			assert(prio.depth() == children.size());
+			if (prio.cost() >= threshold)
+				continue;
+
+			SolutionSequence::container_type solution;
+			solution.reserve(children.size());
+			// insert incoming solutions in reverse order
+			solution.insert(solution.end(), trace.rbegin(), trace.rend());
+			// insert current solution
+			solution.push_back(&current);
+			// insert outgoing solutions in normal order
+			for (const SerialContainerPrivate::PartialPath* p = out.get(); p; p = p->next.get())
+				solution.push_back(p->solution);
+			// store solution in sorted list
+			sorted.insert(impl->makeSolution<SolutionSequence>(std::move(solution), prio.cost(), this));
+
+			// only keep as many new solutions as could possibly be retained
+			if (prune && sorted.size() > impl->max_retained_solutions_) {
+				sorted.pop_back();
+				threshold = std::min(threshold, sorted.back()->cost());
 			}
 		}
 	}
+
+	// update state priorities along the whole partial solution path, using the last path pair
+	if (incoming.has_last && outgoing.has_last) {
+		InterfaceState::Priority prio = pathPriority(incoming.last.get()) +
+		                                InterfaceState::Priority(1u, current.cost()) + pathPriority(outgoing.last.get());
+		if (prio.depth() > 1) {
+			// coalesce the cascade of notifications along both directions of the path
+			Interface::BatchNotify batch;
+			updateStatePrios<Interface::BACKWARD>(*current.start(), prio);
+			updateStatePrios<Interface::FORWARD>(*current.end(), prio);
+		}
+	}
 	// printChildrenInterfaces(*this->pimpl(), true, *current.creator());
 
 	// finally, store + announce new solutions to external interface
+	const double previous_bound = impl->costPruningBound();
 	for (const auto& solution : sorted)
 		impl->liftSolution(solution, solution->internalStart(), solution->internalEnd());
+
+	// branch and bound: prune pending states that cannot lead to a competitive solution anymore
+	const double bound = impl->costPruningBound();
+	if (bound < previous_bound) {  // a better solution was found: check all pending states
+		impl->pruneByCost(bound);
+	} else if (std::isfinite(bound)) {  // only check the new states
+		impl->pruneByCost(*current.start(), bound);
+		impl->pruneByCost(*current.end(), bound);
+	}
 }
 
 SerialContainer::SerialContainer(SerialContainerPrivate* impl) : ContainerBase(impl) {}
@@ -696,11 +1049,162 @@ bool SerialContainer::canCompute() const {
 	return false;
 }
 
+namespace {
+// depth of the most advanced partial solution, represented by the top states of the stage's pull interfaces
+unsigned int topDepth(const StagePrivate& stage) {
+	unsigned int depth = 0;
+	for (const InterfaceConstPtr& interface : { stage.starts(), stage.ends() })
+		if (interface && !interface->empty() && interface->front()->priority().enabled())
+			depth = std::max(depth, interface->front()->priority().depth());
+	return depth;
+}
+}  // namespace
+
 void SerialContainer::compute() {
-	for (const auto& stage : pimpl()->children()) {
-		if (stage->pimpl()->canCompute())
-			stage->pimpl()->runCompute();
+	auto impl = pimpl();
+	if (impl->anytime()) {
+		// Compute the ready child extending the deepest partial solution only.
+		// Ties are broken round-robin, starting after the previously computed child, to not starve any generator.
+		const auto& children = impl->children();
+		const size_t num = children.size();
+		StagePrivate* best = nullptr;
+		unsigned int best_depth = 0;
+		size_t best_index = 0;
+		auto it = children.begin();
+		std::advance(it, impl->anytime_next_ % std::max<size_t>(num, 1));
+		for (size_t i = 0; i < num; ++i, ++it) {
+			if (it == children.end())
+				it = children.begin();
+			StagePrivate* child = (*it)->pimpl();
+			if (!child->canCompute() || impl->withheldByBudget(child))
+				continue;
+			const unsigned int depth = topDepth(*child);
+			if (!best || depth > best_depth) {
+				best = child;
+				best_depth = depth;
+				best_index = (impl->anytime_next_ + i) % num;
+			}
+		}
+		if (best) {
+			impl->anytime_next_ = best_index + 1;
+			best->runCompute();
+		}
+		return;
 	}
+	if (!impl->threadPool()) {
+		for (const auto& stage : impl->children()) {
+			if (stage->pimpl()->canCompute() && !impl->withheldByBudget(stage->pimpl()))
+				stage->pimpl()->runCompute();
+		}
+		return;
+	}
+
+	// compute all ready children concurrently
+	std::vector<StagePrivate*> ready;
+	for (const auto& stage : impl->children()) {
+		if (stage->pimpl()->canCompute() && !impl->withheldByBudget(stage->pimpl()))
+			ready.push_back(stage->pimpl());
+	}
+	impl->computeConcurrently(ready);
+}
+
+ConcurrentSerialContainerPrivate::ConcurrentSerialContainerPrivate(ConcurrentSerialContainer* me,
+                                                                   const std::string& name)
+  : SerialContainerPrivate(me, name) {}
+
+utils::ThreadPool& ConcurrentSerialContainerPrivate::pool() {
+	if (threadPool())
+		return *threadPool();
+	const size_t threads = me()->properties().get<size_t>("threads");
+	if (!own_pool_ || (threads != 0 && own_pool_->size() != threads))
+		own_pool_ = std::make_unique<utils::ThreadPool>(utils::ThreadPool::shared(), threads);
+	return *own_pool_;
+}
+
+ConcurrentSerialContainer::ConcurrentSerialContainer(const std::string& name)
+  : SerialContainer(new ConcurrentSerialContainerPrivate(this, name)) {
+	properties().declare<size_t>("threads", 0, "number of threads if the Task plans sequentially (0: CPU cores)");
+}
+
+void ConcurrentSerialContainer::compute() {
+	auto impl = pimpl();
+	std::vector<StagePrivate*> children;
+	std::vector<size_t> ready;  // children computed (at least) once in this iteration
+	for (const auto& stage : impl->children()) {
+		if (stage->pimpl()->canCompute() && !impl->withheldByBudget(stage->pimpl()))
+			ready.push_back(children.size());
+		children.push_back(stage->pimpl());
+	}
+	if (ready.empty())
+		return;
+
+	// Children's interfaces are only modified by their own compute() and applying deferred actions.
+	// Thus, canCompute() of idle children is still valid while others compute.
+	std::mutex mutex;
+	std::condition_variable finished;
+	size_t next = 0;  // next child in ready to start
+	size_t pending = ready.size();  // number of ready children not yet finished
+	size_t stolen = 0;  // round-robin start for stealing work
+	std::vector<bool> running(children.size(), false);
+	std::vector<std::deque<DeferredActions>> actions(children.size());  // per child and compute, in order
+	std::exception_ptr error;
+
+	auto work = [&, profiling = utils::Profiler::context(), cancellation = utils::CancellationToken::current(),
+	             deadline = utils::TimeSlice::deadline()] {
+		utils::Profiler::Activation activation(profiling);
+		utils::CancellationToken::Activation cancellation_activation(cancellation);
+		utils::TimeSlice::Activation time_slice(deadline);
+		std::unique_lock<std::mutex> lock(mutex);
+		while (!error) {
+			size_t index = children.size();
+			const bool steal = next == ready.size();
+			if (!steal)
+				index = ready[next++];
+			else if (pending == 0 || cancellation.cancelled())
+				break;  // iteration is finished
+			else {  // steal work from children that can compute again, while others are still computing
+				for (size_t i = 0; i < children.size() && index == children.size(); ++i) {
+					const size_t candidate = (stolen + i) % children.size();
+					StagePrivate* child = children[candidate];
+					if (!running[candidate] && !child->overBudget() && child->canCompute())
+						index = candidate;
+				}
+				if (index == children.size()) {
+					finished.wait(lock);
+					continue;
+				}
+				stolen = index + 1;
+			}
+
+			running[index] = true;
+			actions[index].emplace_back();
+			DeferredActions& buffer = actions[index].back();  // references into a deque stay valid
+			lock.unlock();
+			std::exception_ptr e;
+			try {
+				DeferredActions::Scope scope(buffer);
+				children[index]->runCompute();
+			} catch (...) {
+				e = std::current_exception();
+			}
+			lock.lock();
+			running[index] = false;
+			if (!steal)
+				--pending;
+			if (e && !error)
+				error = e;
+			finished.notify_all();
+		}
+	};
+	utils::ThreadPool& pool = impl->pool();
+	pool.run(std::vector<utils::ThreadPool::Job>(std::min(pool.size(), children.size()), work));
+
+	// apply results of all children in original order
+	for (auto& child_actions : actions)
+		for (auto& a : child_actions)
+			a.apply();
+	if (error)
+		std::rethrow_exception(error);
 }
 
 ParallelContainerBasePrivate::ParallelContainerBasePrivate(ParallelContainerBase* me, const std::string& name)
@@ -713,6 +1217,16 @@ void ParallelContainerBasePrivate::resolveInterface(InterfaceFlags expected) {
 
 	InitStageException exceptions;
 
+	// forget predicates of removed children
+	for (auto it = admissions_.begin(); it != admissions_.end();) {
+		const Stage* stage = it->first;
+		if (std::none_of(children().begin(), children().end(),
+		                 [stage](const Stage::pointer& child) { return child.get() == stage; }))
+			it = admissions_.erase(it);
+		else
+			++it;
+	}
+
 	bool first = true;
 	for (const Stage::pointer& child : children()) {
 		try {
@@ -782,7 +1296,23 @@ template <Interface::Direction dir>
 void ParallelContainerBasePrivate::propagateStateToAllChildren(Interface::iterator external,
                                                                Interface::UpdateFlags updated) {
 	for (const Stage::pointer& stage : children())
-		copyState<dir>(external, stage->pimpl()->pullInterface<dir>(), updated);
+		if (updated || admits(*stage, *external, dir))  // updates only affect existing internal copies
+			copyState<dir>(external, stage->pimpl()->pullInterface<dir>(), updated);
+}
+
+void ParallelContainerBasePrivate::setAdmission(const Stage* child, Alternatives::AdmissionPredicate predicate) {
+	if (predicate)
+		admissions_[child] = std::move(predicate);
+	else
+		admissions_.erase(child);
+}
+
+bool ParallelContainerBasePrivate::admits(const Stage& child, const InterfaceState& state,
+                                          Interface::Direction dir) const {
+	if (admissions_.empty())
+		return true;
+	auto it = admissions_.find(&child);
+	return it == admissions_.end() || it->second(state, dir);
 }
 
 ParallelContainerBase::ParallelContainerBase(ParallelContainerBasePrivate* impl) : ContainerBase(impl) {}
@@ -790,20 +1320,21 @@ ParallelContainerBase::ParallelContainerBase(const std::string& name)
   : ParallelContainerBase(new ParallelContainerBasePrivate(this, name)) {}
 
 void ParallelContainerBase::liftSolution(const SolutionBase& solution, double cost, std::string comment) {
-	pimpl()->liftSolution(std::make_shared<WrappedSolution>(this, &solution, cost, std::move(comment)), solution.start(),
-	                      solution.end());
+	auto impl = pimpl();
+	impl->liftSolution(impl->makeSolution<WrappedSolution>(this, &solution, cost, std::move(comment)), solution.start(),
+	                   solution.end());
 }
 
 void ParallelContainerBase::spawn(InterfaceState&& state, SubTrajectory&& t) {
-	pimpl()->StagePrivate::spawn(std::move(state), std::make_shared<SubTrajectory>(std::move(t)));
+	pimpl()->StagePrivate::spawn(std::move(state), pimpl()->makeSolution<SubTrajectory>(std::move(t)));
 }
 
 void ParallelContainerBase::sendForward(const InterfaceState& from, InterfaceState&& to, SubTrajectory&& t) {
-	pimpl()->StagePrivate::sendForward(from, std::move(to), std::make_shared<SubTrajectory>(std::move(t)));
+	pimpl()->StagePrivate::sendForward(from, std::move(to), pimpl()->makeSolution<SubTrajectory>(std::move(t)));
 }
 
 void ParallelContainerBase::sendBackward(InterfaceState&& from, const InterfaceState& to, SubTrajectory&& t) {
-	pimpl()->StagePrivate::sendBackward(std::move(from), to, std::make_shared<SubTrajectory>(std::move(t)));
+	pimpl()->StagePrivate::sendBackward(std::move(from), to, pimpl()->makeSolution<SubTrajectory>(std::move(t)));
 }
 
 WrapperBasePrivate::WrapperBasePrivate(WrapperBase* me, const std::string& name)
@@ -836,6 +1367,10 @@ void WrapperBase::compute() {
 	wrapped()->pimpl()->runCompute();
 }
 
+void Alternatives::setAdmission(const Stage* child, AdmissionPredicate predicate) {
+	pimpl()->setAdmission(child, std::move(predicate));
+}
+
 bool Alternatives::canCompute() const {
 	for (const auto& stage : pimpl()->children())
 		if (stage->pimpl()->canCompute())
@@ -844,9 +1379,13 @@ bool Alternatives::canCompute() const {
 }
 
 void Alternatives::compute() {
-	for (const auto& stage : pimpl()->children()) {
-		stage->pimpl()->runCompute();
-	}
+	auto impl = pimpl();
+	std::vector<StagePrivate*> children;
+	children.reserve(impl->children().size());
+	for (const auto& stage : impl->children())
+		if (!impl->withheldByBudget(stage->pimpl()))
+			children.push_back(stage->pimpl());
+	impl->computeConcurrently(children);
 }
 
 void Alternatives::onNewSolution(const SolutionBase& s) {
@@ -855,7 +1394,10 @@ void Alternatives::onNewSolution(const SolutionBase& s) {
 
 Fallbacks::Fallbacks(const std::string& name) : Fallbacks(new FallbacksPrivate(this, name)) {}
 
-Fallbacks::Fallbacks(FallbacksPrivate* impl) : ParallelContainerBase(impl) {}
+Fallbacks::Fallbacks(FallbacksPrivate* impl) : ParallelContainerBase(impl) {
+	properties().declare<bool>("speculative", false,
+	                           "with a parallel execution policy, compute later children concurrently");
+}
 
 void Fallbacks::reset() {
 	ParallelContainerBase::reset();
@@ -925,6 +1467,8 @@ void FallbacksPrivate::onNewFailure(const Stage& child, const InterfaceState* /*
 
 void FallbacksPrivateCommon::reset() {
 	current_ = children().begin();
+	speculative_ = me()->properties().get<bool>("speculative");
+	speculative_solutions_.clear();
 }
 
 bool FallbacksPrivateCommon::canCompute() const {
@@ -937,7 +1481,47 @@ bool FallbacksPrivateCommon::canCompute() const {
 }
 
 void FallbacksPrivateCommon::compute() {
-	(*current_)->pimpl()->runCompute();
+	if (!speculative_ || !threadPool()) {
+		(*current_)->pimpl()->runCompute();
+		return;
+	}
+
+	// speculatively compute later children too, their solutions are only lifted once they become current_
+	std::vector<StagePrivate*> ready{ (*current_)->pimpl() };
+	for (auto it = std::next(current_), end = children().end(); it != end; ++it)
+		if ((*it)->pimpl()->canCompute())
+			ready.push_back((*it)->pimpl());
+	computeConcurrently(ready);
+}
+
+void FallbacksPrivateCommon::onNewSolution(const SolutionBase& s) {
+	if (speculative_ && (current_ == children().end() || s.creator() != current_->get()))
+		speculative_solutions_[s.creator()].push_back(&s);
+	else
+		FallbacksPrivate::onNewSolution(s);
+}
+
+bool FallbacksPrivateCommon::liftSpeculativeSolutions() {
+	if (current_ == children().end())
+		return false;
+	auto it = speculative_solutions_.find(current_->get());
+	if (it == speculative_solutions_.end())
+		return false;
+
+	std::vector<const SolutionBase*> solutions;
+	for (const SolutionBase* s : it->second)
+		if (matchesJob(*s))
+			solutions.push_back(s);
+	speculative_solutions_.erase(it);
+
+	auto lift = [this, solutions] {
+		for (const SolutionBase* s : solutions)
+			FallbacksPrivate::onNewSolution(*s);
+	};
+	// lifting modifies the parent, which is only allowed from the planning thread
+	if (!DeferredActions::defer(lift))
+		lift();
+	return !solutions.empty();
 }
 
 inline void FallbacksPrivateCommon::nextChild() {
@@ -961,10 +1545,12 @@ bool FallbacksPrivateGenerator::nextJob() {
 
 	do {
 		nextChild();
-	} while (current_ != children().end() && !(*current_)->pimpl()->canCompute());
+	} while (current_ != children().end() && !(*current_)->pimpl()->canCompute() &&
+	         !speculative_solutions_.count(current_->get()));
+	liftSpeculativeSolutions();
 
 	// return value shall indicate current_->canCompute()
-	return current_ != children().end();
+	return current_ != children().end() && (*current_)->pimpl()->canCompute();
 }
 
 FallbacksPrivatePropagator::FallbacksPrivatePropagator(FallbacksPrivate&& old)
@@ -991,24 +1577,53 @@ void FallbacksPrivatePropagator::reset() {
 }
 
 void FallbacksPrivatePropagator::onNewSolution(const SolutionBase& s) {
-	job_has_solutions_ = true;
+	if (!speculative_ || (current_ != children().end() && s.creator() == current_->get()))
+		job_has_solutions_ = true;
 	FallbacksPrivateCommon::onNewSolution(s);
 }
 
+bool FallbacksPrivatePropagator::matchesJob(const SolutionBase& s) const {
+	auto it = internalToExternalMap().find(dir_ == Interface::FORWARD ? s.start() : s.end());
+	return it != internalToExternalMap().end() && it->second == &*job_;
+}
+
+void FallbacksPrivatePropagator::withdrawJob() {
+	const InternalStates& internals = internalStates(&*job_);
+	for (const auto& child : children()) {
+		const InterfacePtr& interface = child->pimpl()->pullInterface(dir_);
+		for (const InterfaceState* internal : internals) {
+			auto pos = interface->find(const_cast<InterfaceState*>(internal));
+			if (pos != interface->end())
+				interface->remove(pos);
+		}
+	}
+	speculative_solutions_.clear();
+}
+
 bool FallbacksPrivatePropagator::nextJob() {
 	assert(current_ != children().end() && !(*current_)->pimpl()->canCompute());
 	const auto jobs = pullInterface(dir_);
 
 	if (job_ != jobs->end()) {  // current job exists, but is exhausted on current child
-		if (!job_has_solutions_)  // job didn't produce solutions -> feed to next child
-			nextChild();
-		else
-			current_ = children().end();  // indicate that this job is exhausted on all children
+		do {
+			if (!job_has_solutions_)  // job didn't produce solutions -> feed to next child
+				nextChild();
+			else
+				current_ = children().end();  // indicate that this job is exhausted on all children
+			// speculative children already hold the job and might have processed it already
+			if (speculative_ && liftSpeculativeSolutions())
+				job_has_solutions_ = true;
+		} while (speculative_ && current_ != children().end() && !(*current_)->pimpl()->canCompute());
+
+		if (speculative_ && current_ != children().end())
+			return true;  // current_ continues processing its copy of job_
 	}
 	job_has_solutions_ = false;
 
 	if (current_ == children().end()) {  // all children processed the job_
 		if (job_ != jobs->end()) {
+			if (speculative_)
+				withdrawJob();  // cancel speculative copies not yet processed by later children
 			jobs->remove(job_);  // we don't need the job in our interface list anymore
 			job_ = jobs->end();  // indicate that we need to fetch a new job
 		}
@@ -1024,7 +1639,11 @@ bool FallbacksPrivatePropagator::nextJob() {
 	}
 
 	// When arriving here, we have a valid job_ and a current_ child to feed it. Let's do that.
-	copyState(dir_, job_, (*current_)->pimpl()->pullInterface(dir_), Interface::UpdateFlags());
+	if (speculative_)  // feed all children at once
+		for (const auto& child : children())
+			copyState(dir_, job_, child->pimpl()->pullInterface(dir_), Interface::UpdateFlags());
+	else
+		copyState(dir_, job_, (*current_)->pimpl()->pullInterface(dir_), Interface::UpdateFlags());
 	return true;
 }
 
@@ -1033,12 +1652,6 @@ FallbacksPrivateConnect::FallbacksPrivateConnect(FallbacksPrivate&& old) : Fallb
 	                                                this, std::placeholders::_1, std::placeholders::_2));
 	ends_ = std::make_shared<Interface>(std::bind(&FallbacksPrivateConnect::propagateStateUpdate<Interface::BACKWARD>,
 	                                              this, std::placeholders::_1, std::placeholders::_2));
-
-	FallbacksPrivateConnect::reset();
-}
-
-void FallbacksPrivateConnect::reset() {
-	active_ = children().end();
 }
 
 template <Interface::Direction dir>
@@ -1049,31 +1662,34 @@ void FallbacksPrivateConnect::propagateStateUpdate(Interface::iterator external,
 }
 
 bool FallbacksPrivateConnect::canCompute() const {
-	for (auto it = children().begin(), end = children().end(); it != end; ++it)
-		if ((*it)->pimpl()->canCompute()) {
-			active_ = it;
+	for (const auto& child : children())
+		if (child->pimpl()->canCompute())
 			return true;
-		}
-	active_ = children().end();
 	return false;
 }
 
 void FallbacksPrivateConnect::compute() {
-	// Alternatively, we could also compute() all children that canCompute()
-	assert(active_ != children().end());
-	(*active_)->pimpl()->runCompute();
+	// A child only receives pairs that all previous children failed to connect.
+	// Thus, with a thread pool, all children can work on their pending pairs concurrently.
+	std::vector<StagePrivate*> ready;
+	for (const auto& child : children())
+		if (child->pimpl()->canCompute()) {
+			ready.push_back(child->pimpl());
+			if (!threadPool())
+				break;  // sequentially, only compute the first child that can compute
+		}
+	computeConcurrently(ready);
 }
 
 void FallbacksPrivateConnect::onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to) {
-	// expect failure to be reported from active child
-	assert(active_ != children().end() && active_->get() == &child);
-	(void)child;
-	// ... thus we can use std::next(active_) to find the next child
-	auto next = std::next(active_);
+	auto it = std::find_if(children().begin(), children().end(),
+	                       [&child](const Stage::pointer& stage) { return stage.get() == &child; });
+	assert(it != children().end());
+	auto next = std::next(it);
 
 	// NOLINTNEXTLINE(readability-identifier-naming)
 	auto findIteratorFor = [](const InterfaceState* state, const Interface& interface) {
-		auto it = std::find(interface.begin(), interface.end(), state);
+		auto it = interface.find(const_cast<InterfaceState*>(state));
 		assert(it != interface.end());
 		return it;
 	};
@@ -1083,12 +1699,19 @@ void FallbacksPrivateConnect::onNewFailure(const Stage& child, const InterfaceSt
 		auto first_con = static_cast<const ConnectingPrivate*>(children().front()->pimpl());
 		auto from_it = findIteratorFor(from, *first_con->starts());
 		auto to_it = findIteratorFor(to, *first_con->ends());
-		next_con->pending.insert(std::make_pair(from_it, to_it));
+		next_con->pending.insert(ConnectingPrivate::StatePair(from_it, to_it));
 	} else  // or report failure to parent
 		parent()->pimpl()->onNewFailure(*me(), from, to);
 }
 
-MergerPrivate::MergerPrivate(Merger* me, const std::string& name) : ParallelContainerBasePrivate(me, name) {}
+void FallbacksPrivateConnect::onEvictChildState(const Stage& child, const InterfaceState& state) {
+	for (const auto& other : children())
+		if (other.get() != &child)
+			static_cast<ConnectingPrivate*>(other->pimpl())->onEvictState(state);
+}
+
+MergerPrivate::MergerPrivate(Merger* me, const std::string& name)
+  : ParallelContainerBasePrivate(me, name), max_merges_(0), merge_timeout_(std::numeric_limits<double>::infinity()) {}
 
 void MergerPrivate::resolveInterface(InterfaceFlags expected) {
 	ParallelContainerBasePrivate::resolveInterface(expected);
@@ -1108,8 +1731,11 @@ void MergerPrivate::resolveInterface(InterfaceFlags expected) {
 }
 
 Merger::Merger(const std::string& name) : Merger(new MergerPrivate(this, name)) {
-	properties().declare<TimeParameterizationPtr>("time_parameterization",
-	                                              std::make_shared<TimeOptimalTrajectoryGeneration>());
+	auto& p = properties();
+	p.declare<TimeParameterizationPtr>("time_parameterization", std::make_shared<TimeOptimalTrajectoryGeneration>());
+	p.declare<uint32_t>("max_merges", 0u, "max number of successful merges per new child solution (0: unlimited)");
+	p.declare<double>("merge_timeout", std::numeric_limits<double>::infinity(),
+	                  "time budget (s) for merging a new child solution with other children's solutions");
 }
 
 void Merger::reset() {
@@ -1121,6 +1747,9 @@ void Merger::reset() {
 
 void Merger::init(const core::RobotModelConstPtr& robot_model) {
 	ParallelContainerBase::init(robot_model);
+	auto impl = pimpl();
+	impl->max_merges_ = properties().get<uint32_t>("max_merges");
+	impl->merge_timeout_ = properties().get<double>("merge_timeout");
 }
 
 Merger::Merger(MergerPrivate* impl) : ParallelContainerBase(impl) {}
@@ -1197,18 +1826,18 @@ void MergerPrivate::onNewPropagateSolution(const SolutionBase& s) {
 
 void MergerPrivate::sendForward(SubTrajectory&& t, const InterfaceState* from) {
 	// generate target state
-	planning_scene::PlanningScenePtr to = from->scene()->diff();
+	planning_scene::PlanningScenePtr to = utils::diffScene(from->scene());
 	if (t.trajectory() && !t.trajectory()->empty())
 		to->setCurrentState(t.trajectory()->getLastWayPoint());
-	StagePrivate::sendForward(*from, InterfaceState(to), std::make_shared<SubTrajectory>(std::move(t)));
+	StagePrivate::sendForward(*from, InterfaceState(to), makeSolution<SubTrajectory>(std::move(t)));
 }
 
 void MergerPrivate::sendBackward(SubTrajectory&& t, const InterfaceState* to) {
 	// generate target state
-	planning_scene::PlanningScenePtr from = to->scene()->diff();
+	planning_scene::PlanningScenePtr from = utils::diffScene(to->scene());
 	if (t.trajectory() && !t.trajectory()->empty())
 		from->setCurrentState(t.trajectory()->getFirstWayPoint());
-	StagePrivate::sendBackward(InterfaceState(from), *to, std::make_shared<SubTrajectory>(std::move(t)));
+	StagePrivate::sendBackward(InterfaceState(from), *to, makeSolution<SubTrajectory>(std::move(t)));
 }
 
 void MergerPrivate::onNewGeneratorSolution(const SolutionBase& /* s */) {
@@ -1218,88 +1847,153 @@ void MergerPrivate::onNewGeneratorSolution(const SolutionBase& /* s */) {
 void MergerPrivate::mergeAnyCombination(const ChildSolutionMap& all_solutions, const SolutionBase& current,
                                         const planning_scene::PlanningSceneConstPtr& start_scene,
                                         const Spawner& spawner) {
-	std::vector<size_t> indices;  // which solution index was considered last for i-th child?
-	indices.reserve(children().size());
-
-	ChildSolutionList sub_solutions;
-	sub_solutions.reserve(children().size());
-
-	// initialize vector of sub solutions
+	// consider other children's solutions in order of increasing cost, keeping the current solution fixed
+	std::vector<ChildSolutionList> sorted;
+	sorted.reserve(all_solutions.size());
 	for (const auto& pair : all_solutions) {
-		// all children, except current solution's creator, start with zero index
-		indices.push_back(pair.first != current.creator() ? 0 : pair.second.size() - 1);
-		sub_solutions.push_back(pair.second[indices.back()]);
+		if (pair.first == current.creator()) {
+			sorted.push_back({ pair.second.back() });
+			continue;
+		}
+		sorted.push_back(pair.second);
+		std::stable_sort(sorted.back().begin(), sorted.back().end(),
+		                 [](const SubTrajectory* a, const SubTrajectory* b) { return a->cost() < b->cost(); });
 	}
-	while (true) {
-		merge(sub_solutions, start_scene, spawner);
-
-		// compose next combination
-		size_t child = 0;
-		for (auto it = all_solutions.cbegin(), end = all_solutions.cend(); it != end; ++it, ++child) {
-			if (it->first == current.creator())
-				continue;  // skip current solution's child
-			if (++indices[child] >= it->second.size()) {
-				indices[child] = 0;  // start over with zero
-				sub_solutions[child] = it->second[indices[child]];
-				continue;  // and continue with next child
+
+	// the merged group is shared by all combinations: create it upfront
+	if (!jmg_merged_) {
+		std::vector<const moveit::core::JointModelGroup*> groups;
+		groups.reserve(sorted.size());
+		for (const auto& solutions : sorted)
+			groups.push_back(solutions.front()->trajectory()->getGroup());
+		try {
+			jmg_merged_.reset(task_constructor::merge(groups));
+		} catch (const std::runtime_error& e) {
+			spawner(SubTrajectory::failure(e.what()));  // all combinations would fail the same way
+			return;
+		}
+	}
+
+	// Best-first enumeration of all combinations, indexing into sorted.
+	// Each combination is generated exactly once, by incrementing its parent's last non-zero index.
+	struct Candidate
+	{
+		double cost;
+		std::vector<size_t> indices;
+		size_t incremented;  // only indices from here on may be incremented to create successors
+	};
+	auto worse = [](const Candidate& a, const Candidate& b) { return a.cost > b.cost; };
+	std::priority_queue<Candidate, std::vector<Candidate>, decltype(worse)> queue(worse);
+	auto push = [&](std::vector<size_t>&& indices, size_t incremented) {
+		double cost = 0.0;
+		for (size_t i = 0; i < sorted.size(); ++i)
+			cost += sorted[i][indices[i]]->cost();
+		queue.push(Candidate{ cost, std::move(indices), incremented });
+	};
+	push(std::vector<size_t>(sorted.size(), 0), 0);
+
+	// merge combinations in batches: all at once if not limited, otherwise as many as can be computed concurrently
+	const bool limited = max_merges_ > 0 || std::isfinite(merge_timeout_);
+	const size_t batch_size = !limited ? std::numeric_limits<size_t>::max() : threadPool() ? threadPool()->size() : 1;
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(limited ? merge_timeout_ : 0);
+	auto timing = me_->properties().get<TimeParameterizationPtr>("time_parameterization");
+
+	size_t successes = 0;
+	std::vector<ChildSolutionList> combinations;
+	while (!queue.empty()) {
+		combinations.clear();
+		while (combinations.size() < batch_size && !queue.empty()) {
+			Candidate best = queue.top();
+			queue.pop();
+			ChildSolutionList combination;
+			combination.reserve(sorted.size());
+			for (size_t i = 0; i < sorted.size(); ++i)
+				combination.push_back(sorted[i][best.indices[i]]);
+			combinations.push_back(std::move(combination));
+
+			for (size_t i = best.incremented; i < sorted.size(); ++i) {
+				if (best.indices[i] + 1 < sorted[i].size()) {
+					std::vector<size_t> indices = best.indices;
+					++indices[i];
+					push(std::move(indices), i);
+				}
 			}
-			// otherwise, a new solution combination is available
-			sub_solutions[child] = it->second[indices[child]];
-			break;
 		}
-		if (child == children().size())  // all combinations exhausted?
-			break;
+
+		// merge all combinations of the batch independently (and concurrently if possible), but spawn them in order
+		std::vector<SubTrajectory> merged(combinations.size());
+		if (!threadPool() || combinations.size() < 2) {
+			for (size_t i = 0; i < combinations.size(); ++i)
+				merged[i] = merge(combinations[i], start_scene, *timing);
+		} else {
+			std::vector<utils::ThreadPool::Job> jobs;
+			jobs.reserve(combinations.size());
+			for (size_t i = 0; i < combinations.size(); ++i)
+				jobs.emplace_back([&, i] { merged[i] = merge(combinations[i], start_scene, *timing); });
+			threadPool()->run(jobs);
+		}
+		for (SubTrajectory& t : merged) {
+			const bool success = !t.isFailure();
+			spawner(std::move(t));
+			if (success && ++successes == max_merges_)
+				return;  // merge budget exhausted
+		}
+		if (limited && std::chrono::steady_clock::now() >= deadline)
+			return;  // time budget exhausted
 	}
 }
 
-void MergerPrivate::merge(const ChildSolutionList& sub_solutions,
-                          const planning_scene::PlanningSceneConstPtr& start_scene, const Spawner& spawner) {
+SubTrajectory MergerPrivate::merge(const ChildSolutionList& sub_solutions,
+                                   const planning_scene::PlanningSceneConstPtr& start_scene,
+                                   const trajectory_processing::TimeParameterization& timing) const {
 	// transform vector of SubTrajectories into vector of RobotTrajectories
 	std::vector<robot_trajectory::RobotTrajectoryConstPtr> sub_trajectories;
+	std::vector<const moveit::core::JointModelGroup*> groups;
 	sub_trajectories.reserve(sub_solutions.size());
-	for (const auto& sub : sub_solutions)
+	for (const auto& sub : sub_solutions) {
 		sub_trajectories.push_back(sub->trajectory());
+		groups.push_back(sub->trajectory()->getGroup());
+	}
 
 	moveit::core::JointModelGroup* jmg = jmg_merged_.get();
+	assert(jmg);  // created by mergeAnyCombination() already, such that merge() doesn't modify it
 	robot_trajectory::RobotTrajectoryPtr merged;
 	try {
-		auto timing = me_->properties().get<TimeParameterizationPtr>("time_parameterization");
-		merged = task_constructor::merge(sub_trajectories, start_scene->getCurrentState(), jmg, *timing);
+		merged = task_constructor::merge(sub_trajectories, start_scene->getCurrentState(), jmg, timing);
 	} catch (const std::runtime_error& e) {
-		SubTrajectory t;
-		t.markAsFailure();
-		t.setComment(e.what());
-		spawner(std::move(t));
-		return;
+		return SubTrajectory::failure(e.what());
 	}
-	if (jmg_merged_.get() != jmg)
-		jmg_merged_.reset(jmg);
 
 	assert(merged);
+	updateKinematics(*merged, groups);
 	SubTrajectory t(merged);
 
 	// check merged trajectory for collisions
 	std::vector<std::size_t> invalid_index;
 	if (!start_scene->isPathValid(*merged, "", true, &invalid_index)) {
-		t.markAsFailure();
-		std::ostringstream oss;
-		oss << "Invalid waypoint(s): ";
-		if (invalid_index.size() == merged->getWayPointCount())
-			oss << "all";
-		else
-			for (size_t i : invalid_index)
-				oss << i << ", ";
-		t.setComment(oss.str());
+		const bool all = invalid_index.size() == merged->getWayPointCount();
+		t.markAsFailure(FailureCode::COLLISION, [all, invalid_index = std::move(invalid_index)] {
+			std::ostringstream oss;
+			oss << "Invalid waypoint(s): ";
+			if (all)
+				oss << "all";
+			else
+				for (size_t i : invalid_index)
+					oss << i << ", ";
+			return oss.str();
+		});
 	} else {
 		// accumulate costs and markers
 		double costs = 0.0;
 		for (const auto& sub : sub_solutions) {
 			costs += sub->cost();
 			t.markers().insert(t.markers().end(), sub->markers().begin(), sub->markers().end());
+			for (const auto& shared : sub->sharedMarkers())
+				t.addSharedMarkers(shared);
 		}
 		t.setCost(costs);
 	}
-	spawner(std::move(t));
+	return t;
 }
 }  // namespace task_constructor
 }  // namespace moveit
@@ -41,9 +41,17 @@
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_state/conversions.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/distance_field/distance_field.h>
+#include <geometric_shapes/shape_operations.h>
 
 #include <Eigen/Geometry>
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <stdexcept>
+
 #include <fmt/core.h>
 #include <utility>
 
@@ -62,6 +70,35 @@ double CostTerm::operator()(const WrappedSolution& s, std::string& /*comment*/)
 	return s.cost();
 }
 
+namespace {
+thread_local double COST_BOUND = std::numeric_limits<double>::infinity();
+thread_local bool EXPLAIN_FAILURES = true;
+}
+
+double CostTerm::bound() {
+	return COST_BOUND;
+}
+
+CostTerm::ScopedBound::ScopedBound(double bound) : previous_(COST_BOUND) {
+	COST_BOUND = bound;
+}
+
+CostTerm::ScopedBound::~ScopedBound() {
+	COST_BOUND = previous_;
+}
+
+bool CostTerm::explainFailures() {
+	return EXPLAIN_FAILURES;
+}
+
+CostTerm::ScopedExplainFailures::ScopedExplainFailures(bool explain) : previous_(EXPLAIN_FAILURES) {
+	EXPLAIN_FAILURES = explain;
+}
+
+CostTerm::ScopedExplainFailures::~ScopedExplainFailures() {
+	EXPLAIN_FAILURES = previous_;
+}
+
 double TrajectoryCostTerm::operator()(const SolutionSequence& s, std::string& comment) const {
 	double cost{ 0.0 };
 	std::string subcomment;
@@ -107,6 +144,90 @@ double Constant::operator()(const WrappedSolution& /*s*/, std::string& /*comment
 	return cost;
 }
 
+/** Joint-space distance between two states, as computed by RobotState::distance(), using precomputed joint weights
+ *
+ * Weights of single-variable joints with plain absolute distance (prismatic and bounded revolute joints) are
+ * scattered into a dense per-variable vector, such that their weighted distance is a single dot product.
+ * Continuous revolute joints and all other joint types are handled individually.
+ */
+class JointDistanceKernel
+{
+public:
+	/// empty weights consider all active joints, weighted by their distance factor
+	JointDistanceKernel(const moveit::core::RobotModelConstPtr& model, const std::map<std::string, double>& weights)
+	  : model_(model), weights_(weights), linear_(Eigen::VectorXd::Zero(model->getVariableCount())) {
+		if (weights.empty()) {
+			for (const moveit::core::JointModel* jm : model->getActiveJointModels())
+				add(jm, jm->getDistanceFactor());
+		} else {
+			for (const auto& item : weights) {
+				if (model->hasJointModel(item.first))
+					add(model->getJointModel(item.first), item.second);
+			}
+		}
+	}
+
+	bool matches(const moveit::core::RobotModelConstPtr& model, const std::map<std::string, double>& weights) const {
+		return model == model_ && weights == weights_;
+	}
+
+	double operator()(const moveit::core::RobotState& a, const moveit::core::RobotState& b) const {
+		return (*this)(a.getVariablePositions(), b.getVariablePositions());
+	}
+	double operator()(const double* a, const double* b) const {
+		const auto n = linear_.size();
+		const Eigen::Map<const Eigen::VectorXd> va(a, n), vb(b, n);
+		double distance = linear_.dot((va - vb).cwiseAbs());
+		for (const auto& item : continuous_) {
+			const double d = std::fmod(std::fabs(a[item.first] - b[item.first]), 2.0 * M_PI);
+			distance += item.second * (d > M_PI ? 2.0 * M_PI - d : d);
+		}
+		for (const auto& item : generic_) {
+			const int index = item.first->getFirstVariableIndex();
+			distance += item.second * item.first->distance(a + index, b + index);
+		}
+		return distance;
+	}
+
+private:
+	void add(const moveit::core::JointModel* jm, double weight) {
+		if (jm->getVariableCount() == 0)
+			return;
+		const int index = jm->getFirstVariableIndex();
+		if (jm->getType() == moveit::core::JointModel::PRISMATIC)
+			linear_[index] += weight;
+		else if (jm->getType() == moveit::core::JointModel::REVOLUTE) {
+			if (static_cast<const moveit::core::RevoluteJointModel*>(jm)->isContinuous())
+				continuous_.emplace_back(index, weight);
+			else
+				linear_[index] += weight;
+		} else
+			generic_.emplace_back(jm, weight);
+	}
+
+	const moveit::core::RobotModelConstPtr model_;
+	const std::map<std::string, double> weights_;  //< weights this kernel was compiled for
+
+	Eigen::VectorXd linear_;  //< per-variable weights of joints with plain absolute distance
+	std::vector<std::pair<int, double>> continuous_;  //< variable indices and weights of continuous joints
+	std::vector<std::pair<const moveit::core::JointModel*, double>> generic_;
+};
+
+namespace {
+// (re)compile the cached kernel if robot model or weights changed since its last use
+JointDistanceKernelConstPtr compiledKernel(JointDistanceKernelConstPtr& cache,
+                                           const moveit::core::RobotModelConstPtr& model,
+                                           const std::map<std::string, double>& weights) {
+	// cost terms might be evaluated concurrently
+	auto kernel = std::atomic_load(&cache);
+	if (!kernel || !kernel->matches(model, weights)) {
+		kernel = std::make_shared<const JointDistanceKernel>(model, weights);
+		std::atomic_store(&cache, kernel);
+	}
+	return kernel;
+}
+}  // namespace
+
 PathLength::PathLength(std::vector<std::string> joints) {
 	for (auto& j : joints)
 		this->joints.emplace(std::move(j), 1.0);
@@ -118,26 +239,10 @@ double PathLength::operator()(const SubTrajectory& s, std::string& /*comment*/)
 	if (traj == nullptr || traj->getWayPointCount() == 0)
 		return 0.0;
 
-	std::map<const moveit::core::JointModel*, double> weights;
-	const auto& first_waypoint = traj->getWayPoint(0);
-	for (auto& joint_weight : joints) {
-		const moveit::core::JointModel* jm = first_waypoint.getJointModel(joint_weight.first);
-		if (jm)
-			weights.emplace(jm, joint_weight.second);
-	}
-
+	const auto distance = compiledKernel(kernel_, traj->getRobotModel(), joints);
 	double path_length{ 0.0 };
-	for (size_t i = 1; i < traj->getWayPointCount(); ++i) {
-		auto& last = traj->getWayPoint(i - 1);
-		auto& curr = traj->getWayPoint(i);
-		if (joints.empty()) {
-			path_length += last.distance(curr);
-		} else {
-			for (const auto& item : weights) {
-				path_length += item.second * last.distance(curr, item.first);
-			}
-		}
-	}
+	for (size_t i = 1; i < traj->getWayPointCount(); ++i)
+		path_length += (*distance)(traj->getWayPoint(i - 1), traj->getWayPoint(i));
 	return path_length;
 }
 
@@ -164,37 +269,23 @@ double DistanceToReference::operator()(const SubTrajectory& s, std::string& /*co
 	moveit::core::RobotState ref_state = state->scene()->getCurrentState();
 	moveit::core::robotStateMsgToRobotState(reference, ref_state, false);
 
-	std::map<const moveit::core::JointModel*, double> w;
-	for (auto& item : weights) {
-		const moveit::core::JointModel* jm = ref_state.getJointModel(item.first);
-		if (jm)
-			w.emplace(jm, item.second);
-	}
-
-	auto distance = [this, &ref_state, &w](const moveit::core::RobotState& state) {
-		if (weights.empty()) {
-			return ref_state.distance(state);
-		} else {
-			double accumulated = 0.0;
-			for (const auto& item : w)
-				accumulated += item.second * ref_state.distance(state, item.first);
-			return accumulated;
-		}
-	};
+	const auto distance = compiledKernel(kernel_, ref_state.getRobotModel(), weights);
+	const double* ref = ref_state.getVariablePositions();
 
 	if (mode == Mode::START_INTERFACE || mode == Mode::END_INTERFACE || (mode == Mode::AUTO && (traj == nullptr))) {
-		return distance(state->scene()->getCurrentState());
+		return (*distance)(ref, state->scene()->getCurrentState().getVariablePositions());
 	} else {
 		double accumulated = 0.0;
 		for (size_t i = 0; i < traj->getWayPointCount(); ++i)
-			accumulated += distance(traj->getWayPoint(i));
+			accumulated += (*distance)(ref, traj->getWayPoint(i).getVariablePositions());
 		accumulated /= traj->getWayPointCount();
 		return accumulated;
 	}
 }
 
 double TrajectoryDuration::operator()(const SubTrajectory& s, std::string& /*comment*/) const {
-	return s.trajectory() ? s.trajectory()->getDuration() : 0.0;
+	const auto& traj = s.trajectory();
+	return traj ? traj->getDuration() : 0.0;
 }
 
 LinkMotion::LinkMotion(std::string link) : link_name{ std::move(link) } {}
@@ -248,8 +339,38 @@ double Clearance::operator()(const SubTrajectory& s, std::string& comment) const
 	request.enableGroup(state->scene()->getRobotModel());
 	request.acm = &state->scene()->getAllowedCollisionMatrix();
 
+	// distances to the static world, approximating the robot's collision bodies by bounding spheres
+	auto field_distance{ [this, &request](const moveit::core::RobotState& robot) {
+		collision_detection::DistanceResultsData result;
+		result.link_names[1] = "distance field";
+		const auto& links = robot.getRobotModel()->getLinkModelsWithCollisionGeometry();
+		for (const moveit::core::LinkModel* link : links) {
+			if (request.active_components_only && !request.active_components_only->count(link))
+				continue;
+			const auto& shapes = link->getShapes();
+			for (size_t i = 0; i < shapes.size(); ++i) {
+				Eigen::Vector3d center;
+				double radius;
+				shapes::computeShapeBoundingSphere(shapes[i].get(), center, radius);
+				const Eigen::Vector3d p = robot.getCollisionBodyTransform(link, i) * center;
+				const double d = std::max(0.0, world_distance_field->getDistance(p.x(), p.y(), p.z()) - radius);
+				if (cumulative)
+					result.distance = (result.link_names[0].empty() ? 0.0 : result.distance) + d;
+				else if (result.link_names[0].empty() || d < result.distance)
+					result.distance = d;
+				else
+					continue;
+				result.link_names[0] = link->getName();
+			}
+		}
+		return result;
+	} };
+
 	// compute relevant distance data for state & robot
 	auto check_distance{ [=](const InterfaceState* state, const moveit::core::RobotState& robot) {
+		if (with_world && world_distance_field)
+			return field_distance(robot);
+
 		collision_detection::DistanceResult result;
 		if (with_world)
 			state->scene()->getCollisionEnv()->distanceRobot(request, result, robot);
@@ -283,7 +404,8 @@ double Clearance::operator()(const SubTrajectory& s, std::string& comment) const
 	    (mode == Mode::AUTO && s.trajectory() == nullptr)) {
 		auto distance_data{ check_distance(state, state->scene()->getCurrentState()) };
 		if (distance_data.distance < 0) {
-			comment = collision_comment(distance_data);
+			if (CostTerm::explainFailures())
+				comment = collision_comment(distance_data);
 			return std::numeric_limits<double>::infinity();
 		}
 		distance = distance_data.distance;
@@ -293,20 +415,130 @@ double Clearance::operator()(const SubTrajectory& s, std::string& comment) const
 		else
 			comment = fmt::format(PREFIX + "cumulative distance {}", distance);
 	} else {  // check trajectory
-		for (size_t i = 0; i < s.trajectory()->getWayPointCount(); ++i) {
-			auto distance_data = check_distance(state, s.trajectory()->getWayPoint(i));
+		// keep the (possibly rebuilt) trajectory alive
+		const auto trajectory{ s.trajectory() };
+		const auto& traj{ *trajectory };
+		const size_t n{ traj.getWayPointCount() };
+		const bool minimum{ aggregation == Aggregation::MINIMUM };
+		const double bound{ minimum ? CostTerm::bound() : std::numeric_limits<double>::infinity() };
+
+		std::vector<double> distances(n);
+		std::vector<bool> evaluated(n, false);
+		double min_distance{ std::numeric_limits<double>::infinity() };
+		bool collides{ false };
+		// evaluate waypoint i, returns false if further evaluation is pointless
+		auto evaluate = [&](size_t i) {
+			auto distance_data = check_distance(state, traj.getWayPoint(i));
 			if (distance_data.distance < 0) {
-				comment = collision_comment(distance_data);
+				if (CostTerm::explainFailures())
+					comment = collision_comment(distance_data);
+				collides = true;
+				return false;
+			}
+			distances[i] = distance_data.distance;
+			evaluated[i] = true;
+			min_distance = std::min(min_distance, distance_data.distance);
+			return distance_to_cost(min_distance) < bound;
+		};
+		auto stopped = [&]() {
+			if (collides)
 				return std::numeric_limits<double>::infinity();
+			comment = fmt::format(PREFIX + "minimum{} distance {} exceeds cost bound", (cumulative ? " cumulative" : ""),
+			                      min_distance);
+			return distance_to_cost(min_distance);
+		};
+
+		// evaluate every stride-th waypoint and bisect intervals with large distance changes
+		const size_t step{ std::max<size_t>(stride, 1) };
+		size_t last{ 0 };
+		if (n > 0 && !evaluate(0))
+			return stopped();
+		for (size_t next = std::min(step, n - 1); last + 1 < n; last = next, next = std::min(next + step, n - 1)) {
+			if (!evaluate(next))
+				return stopped();
+			std::vector<std::pair<size_t, size_t>> intervals{ { last, next } };
+			while (!intervals.empty()) {
+				const auto interval{ intervals.back() };
+				intervals.pop_back();
+				if (interval.second - interval.first < 2 ||
+				    std::fabs(distances[interval.first] - distances[interval.second]) <= refinement_threshold)
+					continue;
+				const size_t mid{ (interval.first + interval.second) / 2 };
+				if (!evaluate(mid))
+					return stopped();
+				intervals.emplace_back(interval.first, mid);
+				intervals.emplace_back(mid, interval.second);
+			}
+		}
+
+		if (minimum) {
+			distance = min_distance;
+			comment = fmt::format(PREFIX + "minimum{} distance: {}", (cumulative ? " cumulative" : ""), distance);
+		} else {
+			// interpolate distances of skipped waypoints
+			for (size_t i = 0, prev = 0; i < n; ++i) {
+				if (evaluated[i]) {
+					prev = i;
+					distance += distances[i];
+					continue;
+				}
+				size_t next = i + 1;
+				while (!evaluated[next])
+					++next;
+				const double t{ static_cast<double>(i - prev) / static_cast<double>(next - prev) };
+				distance += (1.0 - t) * distances[prev] + t * distances[next];
 			}
-			distance += distance_data.distance;
+			distance /= n;
+			comment = fmt::format(PREFIX + "average{} distance: {}", (cumulative ? " cumulative" : ""), distance);
 		}
-		distance /= s.trajectory()->getWayPointCount();
-		comment = fmt::format(PREFIX + "average{} distance: {}", (cumulative ? " cumulative" : ""), distance);
 	}
 
 	return distance_to_cost(distance);
 }
+void Tiered::add(CostTermConstPtr term, Tier tier, double weight) {
+	if (!term)
+		throw std::invalid_argument("Tiered: cost term must not be null");
+	terms_.push_back(Term{ std::move(term), tier, weight });
+}
+
+bool Tiered::hasDeferred() const {
+	return std::any_of(terms_.begin(), terms_.end(), [](const Term& t) { return t.tier == Tier::DEFERRED; });
+}
+
+double Tiered::operator()(const SubTrajectory& s, std::string& comment) const {
+	return evaluate(s, Tier::IMMEDIATE, comment);
+}
+
+double Tiered::operator()(const SolutionSequence& s, std::string& comment) const {
+	return evaluate(s, Tier::IMMEDIATE, comment);
+}
+
+double Tiered::operator()(const WrappedSolution& s, std::string& comment) const {
+	return evaluate(s, Tier::IMMEDIATE, comment);
+}
+
+double Tiered::deferredCost(const SolutionBase& s, std::string& comment) const {
+	return evaluate(s, Tier::DEFERRED, comment);
+}
+
+double Tiered::evaluate(const SolutionBase& s, Tier tier, std::string& comment) const {
+	double cost{ 0.0 };
+	std::string subcomment;
+	for (const Term& t : terms_) {
+		if (t.tier != tier)
+			continue;
+		cost += t.weight * s.computeCost(*t.term, subcomment);
+		if (!subcomment.empty()) {
+			if (!comment.empty())
+				comment.append(", ");
+			comment.append(subcomment);
+			subcomment.clear();
+		}
+		if (!std::isfinite(cost))
+			break;  // failure anyway, skip remaining terms
+	}
+	return cost;
+}
 }  // namespace cost
 }  // namespace task_constructor
 }  // namespace moveit
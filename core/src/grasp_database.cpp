@@ -0,0 +1,171 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Memory-mapped database of precomputed grasps, sorted by quality
+ */
+
+#include <moveit/task_constructor/grasp_database.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+constexpr char MAGIC[8] = "MTCGRSP";
+constexpr uint32_t VERSION = 1;
+constexpr size_t NAME_LENGTH = 64;
+
+// fixed-size file header, followed by one Record per grasp
+struct FileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t record_size;
+	uint64_t count;
+	char object[NAME_LENGTH];
+};
+}  // namespace
+
+struct GraspDatabase::Record
+{
+	double position[3];
+	double orientation[4];  // quaternion x, y, z, w
+	double quality;
+};
+
+void GraspDatabase::save(const std::string& filename, Grasps grasps, const std::string& object) {
+	if (object.size() >= NAME_LENGTH)
+		throw std::runtime_error("object name too long for grasp database: " + object);
+	std::stable_sort(grasps.begin(), grasps.end(),
+	                 [](const Grasp& a, const Grasp& b) { return a.quality > b.quality; });
+
+	FileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	header.record_size = sizeof(Record);
+	header.count = grasps.size();
+	std::memcpy(header.object, object.data(), object.size());
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	for (const Grasp& grasp : grasps) {
+		const Eigen::Quaterniond q(grasp.pose.linear());
+		const Eigen::Vector3d& p = grasp.pose.translation();
+		const Record record{ { p.x(), p.y(), p.z() }, { q.x(), q.y(), q.z(), q.w() }, grasp.quality };
+		file.write(reinterpret_cast<const char*>(&record), sizeof(record));
+	}
+	if (!file)
+		throw std::runtime_error("failed to write grasp database: " + filename);
+}
+
+GraspDatabaseConstPtr GraspDatabase::load(const std::string& filename) {
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("cannot open grasp database: " + filename);
+	struct stat info;
+	if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+		::close(fd);
+		throw std::runtime_error("invalid grasp database: " + filename);
+	}
+	void* mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);  // the mapping stays valid
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error("cannot map grasp database: " + filename);
+	// grasps are usually streamed in order
+	::madvise(mapping, info.st_size, MADV_SEQUENTIAL);
+
+	GraspDatabasePtr db(new GraspDatabase());
+	db->mapping_ = mapping;
+	db->mapping_size_ = info.st_size;
+
+	FileHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+	// the size of the records is derived from the file size, as a corrupted count might overflow
+	const size_t records_size = db->mapping_size_ - sizeof(FileHeader);
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+	    header.record_size != sizeof(Record) || records_size % sizeof(Record) != 0 ||
+	    header.count != records_size / sizeof(Record))
+		throw std::runtime_error("invalid grasp database: " + filename);
+
+	db->object_ = std::string(header.object, strnlen(header.object, NAME_LENGTH));
+	db->size_ = header.count;
+	db->records_ = reinterpret_cast<const Record*>(static_cast<const char*>(mapping) + sizeof(FileHeader));
+	return db;
+}
+
+GraspDatabase::~GraspDatabase() {
+	if (mapping_)
+		::munmap(mapping_, mapping_size_);
+}
+
+const GraspDatabase::Record& GraspDatabase::record(size_t i) const {
+	if (i >= size_)
+		throw std::out_of_range("grasp index out of range");
+	return records_[i];
+}
+
+GraspDatabase::Grasp GraspDatabase::grasp(size_t i) const {
+	const Record& r = record(i);
+	Grasp grasp;
+	grasp.pose = Eigen::Quaterniond(r.orientation[3], r.orientation[0], r.orientation[1], r.orientation[2]).normalized();
+	grasp.pose.translation() = Eigen::Vector3d(r.position[0], r.position[1], r.position[2]);
+	grasp.quality = r.quality;
+	return grasp;
+}
+
+double GraspDatabase::quality(size_t i) const {
+	return record(i).quality;
+}
+
+size_t GraspDatabase::countAbove(double min_quality) const {
+	// records are sorted by decreasing quality
+	const Record* end = std::partition_point(records_, records_ + size_,
+	                                         [min_quality](const Record& r) { return r.quality >= min_quality; });
+	return end - records_;
+}
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
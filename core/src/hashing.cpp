@@ -0,0 +1,278 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+
+/* Desc: canonical hashes of joint states, world objects, and interface states */
+
+#include <moveit/task_constructor/hashing.h>
+#include <moveit/task_constructor/compact_trajectory.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/utils.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/revolute_joint_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <geometric_shapes/shape_operations.h>
+
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+using Pose = Eigen::Matrix<double, 4, 4, Eigen::DontAlign>;  // stored in node-based containers
+
+struct CachedObjectHash
+{
+	// inputs of the hash (besides the immutable id): objects owned by a single world are modified in place
+	Pose pose;
+	std::vector<std::weak_ptr<const shapes::Shape>> shapes;
+	std::vector<Pose> shape_poses;
+	double resolution;
+	size_t hash;
+
+	CachedObjectHash(const collision_detection::World::Object& object, double resolution, size_t hash)
+	  : pose(object.pose_.matrix()), resolution(resolution), hash(hash) {
+		shapes.assign(object.shapes_.begin(), object.shapes_.end());
+		for (const Eigen::Isometry3d& shape_pose : object.shape_poses_)
+			shape_poses.emplace_back(shape_pose.matrix());
+	}
+
+	bool matches(const collision_detection::World::Object& object, double resolution) const {
+		if (resolution != this->resolution || pose != object.pose_.matrix() || shapes.size() != object.shapes_.size())
+			return false;
+		for (size_t i = 0; i < shapes.size(); ++i)
+			if (shapes[i].lock() != object.shapes_[i] || shape_poses[i] != object.shape_poses_[i].matrix())
+				return false;
+		return true;
+	}
+};
+
+using ObjectWeakPtr = std::weak_ptr<const collision_detection::World::Object>;
+std::mutex OBJECT_HASHES_MUTEX;
+// keyed by the objects' control blocks, which outlive them as long as the key: no aliasing of reused addresses
+std::map<ObjectWeakPtr, CachedObjectHash, std::owner_less<ObjectWeakPtr>> OBJECT_HASHES;
+size_t OBJECT_HASHES_PRUNE_SIZE = 64;  // prune released objects when the cache grows beyond this size
+
+size_t computeObjectHash(const collision_detection::World::Object& object, double resolution) {
+	size_t seed = 0;
+	boost::hash_combine(seed, object.id_);
+	hashPose(seed, object.pose_, resolution);
+	for (size_t i = 0; i < object.shapes_.size(); ++i) {
+		boost::hash_combine(seed, static_cast<int>(object.shapes_[i]->type));
+		const Eigen::Vector3d extents = shapes::computeShapeExtents(object.shapes_[i].get());
+		for (Eigen::Index j = 0; j < 3; ++j)
+			boost::hash_combine(seed, std::lround(extents[j] / resolution));
+		hashPose(seed, object.shape_poses_[i], resolution);
+	}
+	return seed;
+}
+
+// joint positions of all waypoints of trajectory, one row per waypoint, restoring all variables of compact ones
+std::vector<double> waypointPositions(const SubTrajectory& trajectory, const moveit::core::RobotModel& model) {
+	std::vector<double> result;
+	if (const CompactTrajectoryConstPtr& compact = trajectory.compactTrajectory()) {
+		const std::vector<int>& variables = compact->variables();
+		const double* positions = compact->positions().data();
+		const double* reference = compact->reference().getVariablePositions();
+		result.reserve(compact->waypointCount() * model.getVariableCount());
+		for (size_t i = 0; i < compact->waypointCount(); ++i, positions += variables.size()) {
+			const size_t offset = result.size();
+			result.insert(result.end(), reference, reference + model.getVariableCount());
+			for (size_t j = 0; j < variables.size(); ++j)
+				result[offset + variables[j]] = positions[j];
+		}
+	} else if (const robot_trajectory::RobotTrajectoryConstPtr& full = trajectory.trajectory()) {
+		result.reserve(full->getWayPointCount() * model.getVariableCount());
+		for (size_t i = 0; i < full->getWayPointCount(); ++i) {
+			const double* positions = full->getWayPoint(i).getVariablePositions();
+			result.insert(result.end(), positions, positions + model.getVariableCount());
+		}
+	}
+	return result;
+}
+
+size_t waypointCount(const SubTrajectory& trajectory) {
+	if (const CompactTrajectoryConstPtr& compact = trajectory.compactTrajectory())
+		return compact->waypointCount();
+	const robot_trajectory::RobotTrajectoryConstPtr& full = trajectory.trajectory();
+	return full ? full->getWayPointCount() : 0;
+}
+
+bool positionsEqual(const moveit::core::RobotModel& model, const double* a, const double* b, double resolution) {
+	for (const moveit::core::JointModel* joint : model.getActiveJointModels()) {
+		const int index = joint->getFirstVariableIndex();
+		if (joint->distance(a + index, b + index) > resolution)
+			return false;
+	}
+	return true;
+}
+}  // namespace
+
+void hashPose(size_t& seed, const Eigen::Isometry3d& pose, double resolution) {
+	for (Eigen::Index i = 0; i < 3; ++i)
+		for (Eigen::Index j = 0; j < 4; ++j)
+			boost::hash_combine(seed, std::lround(pose.matrix()(i, j) / resolution));
+}
+
+size_t jointStateHash(const moveit::core::RobotModel& model, const double* positions,
+                      const moveit::core::JointModelGroup* group, double resolution) {
+	const std::vector<const moveit::core::JointModel*>& joints =
+	    group ? group->getActiveJointModels() : model.getActiveJointModels();
+	size_t seed = 0;
+	double values[7];  // maximum number of variables of a joint (floating)
+	for (const moveit::core::JointModel* joint : joints) {
+		const size_t count = joint->getVariableCount();
+		std::copy_n(positions + joint->getFirstVariableIndex(), count, values);
+		if (joint->getType() == moveit::core::JointModel::REVOLUTE &&
+		    static_cast<const moveit::core::RevoluteJointModel*>(joint)->isContinuous())
+			joint->enforcePositionBounds(values);
+		for (size_t i = 0; i < count; ++i)
+			boost::hash_combine(seed, std::lround(values[i] / resolution));
+	}
+	return seed;
+}
+
+size_t jointStateHash(const moveit::core::RobotState& state, const moveit::core::JointModelGroup* group,
+                      double resolution) {
+	return jointStateHash(*state.getRobotModel(), state.getVariablePositions(), group, resolution);
+}
+
+size_t objectHash(const collision_detection::World::ObjectConstPtr& object, double resolution) {
+	const ObjectWeakPtr key(object);
+	{
+		std::lock_guard<std::mutex> lock(OBJECT_HASHES_MUTEX);
+		auto it = OBJECT_HASHES.find(key);
+		if (it != OBJECT_HASHES.end() && it->second.matches(*object, resolution))
+			return it->second.hash;
+	}
+
+	const size_t hash = computeObjectHash(*object, resolution);
+
+	std::lock_guard<std::mutex> lock(OBJECT_HASHES_MUTEX);
+	auto it = OBJECT_HASHES.find(key);
+	if (it != OBJECT_HASHES.end())
+		it->second = CachedObjectHash(*object, resolution, hash);
+	else
+		OBJECT_HASHES.emplace(key, CachedObjectHash(*object, resolution, hash));
+	if (OBJECT_HASHES.size() > OBJECT_HASHES_PRUNE_SIZE) {
+		for (auto it = OBJECT_HASHES.begin(); it != OBJECT_HASHES.end();)
+			it = it->first.expired() ? OBJECT_HASHES.erase(it) : std::next(it);
+		OBJECT_HASHES_PRUNE_SIZE = std::max<size_t>(64, 2 * OBJECT_HASHES.size());
+	}
+	return hash;
+}
+
+size_t objectHashCacheSize() {
+	std::lock_guard<std::mutex> lock(OBJECT_HASHES_MUTEX);
+	return OBJECT_HASHES.size();
+}
+
+void clearObjectHashCache() {
+	std::lock_guard<std::mutex> lock(OBJECT_HASHES_MUTEX);
+	OBJECT_HASHES.clear();
+	OBJECT_HASHES_PRUNE_SIZE = 64;
+}
+
+size_t stateHash(const InterfaceState& state, const moveit::core::JointModelGroup* group, double resolution) {
+	// lightweight states share world, attached bodies, and allowed collisions with their base scene
+	const planning_scene::PlanningScene& scene = *state.baseScene();
+	size_t seed = worldHash(scene, resolution);
+	boost::hash_combine(seed, acmHash(scene));
+	boost::hash_combine(seed, jointStateHash(*scene.getRobotModel(), state.variablePositions(), group, resolution));
+	return seed;
+}
+
+size_t trajectoryHash(const SubTrajectory& trajectory, double resolution) {
+	const InterfaceState& end = *trajectory.end();
+	const planning_scene::PlanningScene& scene = *end.baseScene();
+	const moveit::core::RobotModel& model = *scene.getRobotModel();
+	size_t seed = worldHash(scene, resolution);
+	boost::hash_combine(seed, jointStateHash(model, end.variablePositions(), nullptr, resolution));
+
+	if (const CompactTrajectoryConstPtr& compact = trajectory.compactTrajectory()) {
+		// restore the full joint positions of each waypoint, as stored by the uncompacted trajectory
+		const std::vector<int>& variables = compact->variables();
+		const double* positions = compact->positions().data();
+		std::vector<double> waypoint(compact->reference().getVariablePositions(),
+		                             compact->reference().getVariablePositions() + model.getVariableCount());
+		for (size_t i = 0; i < compact->waypointCount(); ++i, positions += variables.size()) {
+			for (size_t j = 0; j < variables.size(); ++j)
+				waypoint[variables[j]] = positions[j];
+			boost::hash_combine(seed, jointStateHash(model, waypoint.data(), nullptr, resolution));
+		}
+	} else if (const robot_trajectory::RobotTrajectoryConstPtr& full = trajectory.trajectory()) {
+		for (size_t i = 0; i < full->getWayPointCount(); ++i)
+			boost::hash_combine(seed, jointStateHash(full->getWayPoint(i), nullptr, resolution));
+	}
+	return seed;
+}
+
+size_t coarseTrajectoryHash(const SubTrajectory& trajectory, double resolution) {
+	size_t seed = worldHash(*trajectory.end()->baseScene(), resolution);
+	boost::hash_combine(seed, waypointCount(trajectory));
+	return seed;
+}
+
+bool trajectoriesEqual(const SubTrajectory& a, const SubTrajectory& b, double resolution) {
+	const InterfaceState& a_end = *a.end();
+	const InterfaceState& b_end = *b.end();
+	const moveit::core::RobotModel& model = *a_end.baseScene()->getRobotModel();
+	if (&model != b_end.baseScene()->getRobotModel().get() ||
+	    !positionsEqual(model, a_end.variablePositions(), b_end.variablePositions(), resolution) ||
+	    waypointCount(a) != waypointCount(b) ||
+	    worldHash(*a_end.baseScene(), resolution) != worldHash(*b_end.baseScene(), resolution))
+		return false;
+
+	const std::vector<double> a_positions = waypointPositions(a, model);
+	const std::vector<double> b_positions = waypointPositions(b, model);
+	if (a_positions.size() != b_positions.size())
+		return false;
+	for (size_t i = 0; i < a_positions.size(); i += model.getVariableCount())
+		if (!positionsEqual(model, &a_positions[i], &b_positions[i], resolution))
+			return false;
+	return true;
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
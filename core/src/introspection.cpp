@@ -39,6 +39,7 @@
 #include <moveit/task_constructor/introspection.h>
 #include <moveit/task_constructor/task.h>
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/thread_pool.h>
 #include <moveit_task_constructor_msgs/Property.h>
 
 #include <ros/node_handle.h>
@@ -47,7 +48,15 @@
 #include <moveit/planning_scene/planning_scene.h>
 
 #include <sstream>
+#include <chrono>
+#include <iterator>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
 #include <boost/bimap.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/optional.hpp>
 
 namespace ros {
 namespace names {
@@ -77,6 +86,9 @@ std::string getTaskId(const TaskPrivate* task) {
 class IntrospectionPrivate
 {
 public:
+	using SolutionMsgPtr = moveit_task_constructor_msgs::SolutionConstPtr;
+	using CompressedSolutionMsgPtr = moveit_task_constructor_msgs::CompressedSolutionConstPtr;
+
 	IntrospectionPrivate(const TaskPrivate* task, Introspection* self)
 	  : nh_(std::string("~/") + task->ns())  // topics + services are advertised in private namespace
 	  , task_(task)
@@ -86,8 +98,7 @@ public:
 		// send reset message as early as possible to give subscribers time to see it
 		indicateReset();
 
-		task_statistics_publisher_ =
-		    nh_.advertise<moveit_task_constructor_msgs::TaskStatistics>(STATISTICS_TOPIC, 1, true);
+		statistics_->publisher = nh_.advertise<moveit_task_constructor_msgs::TaskStatistics>(STATISTICS_TOPIC, 1, true);
 		solution_publisher_ = nh_.advertise<moveit_task_constructor_msgs::Solution>(SOLUTION_TOPIC, 1, true);
 
 		get_solution_service_ =
@@ -95,12 +106,43 @@ public:
 
 		resetMaps();
 	}
-	~IntrospectionPrivate() { indicateReset(); }
+	~IntrospectionPrivate() {
+		statistics_->publish();  // pending statistics, not waiting for the posted job
+		indicateReset();
+	}
+
+	/// solution IDs up to this watermark are known to subscribers, 0 if the next message needs to be a keyframe
+	uint32_t statisticsBase() {
+		const bool keyframe = keyframe_interval_ == 0 || num_statistics_++ % keyframe_interval_ == 0 || evicted_;
+		evicted_ = false;
+		if (keyframe)
+			return 0;
+		std::lock_guard<std::mutex> lock(statistics_->mutex);
+		return statistics_->published_watermark;
+	}
+
+	/// hand over statistics to the publishing job, replacing any not yet published message
+	void enqueueStatistics(moveit_task_constructor_msgs::TaskStatisticsConstPtr msg) {
+		bool post;
+		{
+			std::lock_guard<std::mutex> lock(statistics_->mutex);
+			statistics_->pending = std::move(msg);
+			// a replaced incremental message was based on the same published_watermark and is thus covered
+			statistics_->pending_watermark = last_solution_id_;
+			post = !statistics_->scheduled;
+			statistics_->scheduled = true;
+		}
+		// publish from this (planning) thread if all workers are busy, e.g. with Task::planAsync() jobs
+		if (post && !utils::ThreadPool::shared().tryPost([statistics = statistics_] { statistics->publish(); },
+		                                                 utils::ThreadPool::LOW))
+			statistics_->publish();
+		last_statistics_time_ = std::chrono::steady_clock::now();
+	}
 
 	void indicateReset() {
 		// send empty task description message to indicate reset
-		::moveit_task_constructor_msgs::TaskDescription msg;
-		msg.task_id = task_id_;
+		auto msg = boost::make_shared<moveit_task_constructor_msgs::TaskDescription>();
+		msg->task_id = task_id_;
 		task_description_publisher_.publish(msg);
 	}
 
@@ -110,6 +152,88 @@ public:
 		stage_to_id_map_[task_] = 0;  // root is task having ID = 0
 
 		id_solution_bimap_.clear();
+		last_solution_id_ = 0;
+
+		clearSolutionCache();
+	}
+
+	/// look up the cached message of solution s with the given id, marking it as most recently used
+	SolutionMsgPtr cachedSolution(uint32_t id, const SolutionBase& s) {
+		std::lock_guard<std::mutex> lock(solution_cache_mutex_);
+		auto it = solution_cache_index_.find(id);
+		if (it == solution_cache_index_.end())
+			return nullptr;
+		if (it->second->solution.lock().get() != &s) {  // the cached solution is gone, s reuses its address
+			solution_cache_.erase(it->second);
+			solution_cache_index_.erase(it);
+			return nullptr;
+		}
+		solution_cache_.splice(solution_cache_.begin(), solution_cache_, it->second);
+		return it->second->msg;
+	}
+
+	/// cache the message of solution s with the given id, evicting the least recently used messages beyond
+	/// solution_cache_size_
+	void cacheSolution(uint32_t id, const SolutionBase& s, SolutionMsgPtr msg) {
+		std::weak_ptr<const SolutionBase> solution;
+		try {
+			solution = s.shared_from_this();
+		} catch (const std::bad_weak_ptr&) {
+			return;  // not shared: its lifetime cannot be tracked
+		}
+		std::lock_guard<std::mutex> lock(solution_cache_mutex_);
+		if (solution_cache_size_ == 0 || solution_cache_index_.count(id))
+			return;
+		solution_cache_.push_front(CachedSolution{ id, std::move(solution), std::move(msg) });
+		solution_cache_index_[id] = solution_cache_.begin();
+		trimSolutionCache();
+	}
+
+	/// look up the cached compressed message of solution s with the given id, requires its (cached) message
+	CompressedSolutionMsgPtr cachedCompressedSolution(uint32_t id, const SolutionBase& s) {
+		std::lock_guard<std::mutex> lock(solution_cache_mutex_);
+		auto it = solution_cache_index_.find(id);
+		if (it == solution_cache_index_.end() || it->second->solution.lock().get() != &s)
+			return nullptr;
+		return it->second->compressed;
+	}
+
+	/// cache the compressed message of solution s with the given id, along with its message
+	void cacheCompressedSolution(uint32_t id, const SolutionBase& s, CompressedSolutionMsgPtr msg) {
+		std::lock_guard<std::mutex> lock(solution_cache_mutex_);
+		auto it = solution_cache_index_.find(id);
+		if (it != solution_cache_index_.end() && it->second->solution.lock().get() == &s)
+			it->second->compressed = std::move(msg);
+	}
+
+	/// drop compressed messages, e.g. when the compression options change
+	void clearCompressedSolutions() {
+		std::lock_guard<std::mutex> lock(solution_cache_mutex_);
+		for (CachedSolution& cached : solution_cache_)
+			cached.compressed.reset();
+	}
+
+	void clearSolutionCache() {
+		std::lock_guard<std::mutex> lock(solution_cache_mutex_);
+		solution_cache_.clear();
+		solution_cache_index_.clear();
+	}
+
+	void evictSolution(uint32_t id) {
+		std::lock_guard<std::mutex> lock(solution_cache_mutex_);
+		auto it = solution_cache_index_.find(id);
+		if (it == solution_cache_index_.end())
+			return;
+		solution_cache_.erase(it->second);
+		solution_cache_index_.erase(it);
+	}
+
+	// requires solution_cache_mutex_
+	void trimSolutionCache() {
+		while (solution_cache_.size() > solution_cache_size_) {
+			solution_cache_index_.erase(solution_cache_.back().id);
+			solution_cache_.pop_back();
+		}
 	}
 
 	ros::NodeHandle nh_;
@@ -119,15 +243,74 @@ public:
 
 	/// publish task detailed description and current state
 	ros::Publisher task_description_publisher_;
-	ros::Publisher task_statistics_publisher_;
 	/// publish new solutions
 	ros::Publisher solution_publisher_;
+	/// publish new solutions in compressed form instead, if compression_ is set
+	ros::Publisher compressed_solution_publisher_;
+	boost::optional<utils::SolutionCompression> compression_;
 	/// services to provide an individual Solution
 	ros::ServiceServer get_solution_service_;
 
 	/// mapping from stages to their id
 	std::map<const StagePrivate*, moveit_task_constructor_msgs::StageStatistics::_id_type> stage_to_id_map_;
 	boost::bimap<uint32_t, const SolutionBase*> id_solution_bimap_;
+	/// IDs are assigned in order of registration, discarded solutions leave gaps
+	uint32_t last_solution_id_ = 0;
+
+	/// LRU cache of solution messages (most recently used first), as rviz requests the same solutions repeatedly
+	struct CachedSolution
+	{
+		uint32_t id;
+		std::weak_ptr<const SolutionBase> solution;  // detects solutions created at the address of a freed one
+		SolutionMsgPtr msg;
+		CompressedSolutionMsgPtr compressed;  // created on demand by publishSolution()
+	};
+	std::list<CachedSolution> solution_cache_;
+	std::map<uint32_t, std::list<CachedSolution>::iterator> solution_cache_index_;
+	size_t solution_cache_size_ = 32;
+	std::mutex solution_cache_mutex_;  // getSolution() is served by the ROS spinner
+
+	/// minimum period between statistics published by updateTaskState()
+	std::chrono::duration<double> statistics_period_{ 0.1 };
+	std::chrono::steady_clock::time_point last_statistics_time_;
+
+	/// latest statistics, published (and thus serialized for remote subscribers) by a job on the shared thread pool
+	struct StatisticsQueue
+	{
+		ros::Publisher publisher;
+		std::mutex mutex;
+		std::condition_variable cv;  // signals the end of publish()
+		moveit_task_constructor_msgs::TaskStatisticsConstPtr pending;
+		bool scheduled = false;  // a job calling publish() was posted
+		bool publishing = false;  // publish() is running
+		/// incremental statistics: largest solution ID of the pending and of the last published message
+		uint32_t pending_watermark = 0;
+		uint32_t published_watermark = 0;
+
+		/// publish pending messages until there are none left, in order with concurrent calls
+		void publish() {
+			std::unique_lock<std::mutex> lock(mutex);
+			cv.wait(lock, [this] { return !publishing; });
+			publishing = true;
+			while (pending) {
+				moveit_task_constructor_msgs::TaskStatisticsConstPtr msg = std::move(pending);
+				pending.reset();
+				published_watermark = pending_watermark;
+				lock.unlock();
+				publisher.publish(msg);
+				lock.lock();
+			}
+			publishing = false;
+			scheduled = false;
+			cv.notify_all();
+		}
+	};
+	// shared with posted jobs, which might run after destruction
+	std::shared_ptr<StatisticsQueue> statistics_ = std::make_shared<StatisticsQueue>();
+	size_t keyframe_interval_ = 0;
+	size_t num_statistics_ = 0;
+	// solutions were unregistered: incremental messages cannot remove their IDs, so the next one is a keyframe
+	bool evicted_ = false;
 };
 
 Introspection::Introspection(const TaskPrivate* task) : impl(new IntrospectionPrivate(task, this)) {}
@@ -136,17 +319,51 @@ Introspection::~Introspection() {
 	delete impl;
 }
 
+// Messages are published as shared pointers, such that roscpp passes them to intra-process subscribers without
+// serialization. Thus they must not be modified after publishing.
 void Introspection::publishTaskDescription() {
-	::moveit_task_constructor_msgs::TaskDescription msg;
-	impl->task_description_publisher_.publish(fillTaskDescription(msg));
+	auto msg = boost::make_shared<moveit_task_constructor_msgs::TaskDescription>();
+	fillTaskDescription(*msg);
+	impl->task_description_publisher_.publish(msg);
 }
 
 void Introspection::publishTaskState() {
-	::moveit_task_constructor_msgs::TaskStatistics msg;
-	impl->task_statistics_publisher_.publish(fillTaskStatistics(msg));
+	auto msg = boost::make_shared<moveit_task_constructor_msgs::TaskStatistics>();
+	fillTaskStatistics(*msg, impl->statisticsBase());
+	impl->enqueueStatistics(std::move(msg));
+}
+
+void Introspection::updateTaskState() {
+	if (std::chrono::steady_clock::now() - impl->last_statistics_time_ >= impl->statistics_period_)
+		publishTaskState();
+}
+
+void Introspection::setPublishRate(double rate) {
+	impl->statistics_period_ = std::chrono::duration<double>(rate > 0.0 ? 1.0 / rate : 0.0);
+}
+
+double Introspection::publishRate() const {
+	double period = impl->statistics_period_.count();
+	return period > 0.0 ? 1.0 / period : 0.0;
+}
+
+void Introspection::setKeyframeInterval(size_t interval) {
+	impl->keyframe_interval_ = interval;
+	impl->num_statistics_ = 0;
+}
+
+size_t Introspection::keyframeInterval() const {
+	return impl->keyframe_interval_;
 }
 
 void Introspection::reset() {
+	{  // discard statistics of the previous task state
+		std::lock_guard<std::mutex> lock(impl->statistics_->mutex);
+		impl->statistics_->pending.reset();
+		impl->statistics_->published_watermark = 0;  // solution IDs restart: next message needs to be a keyframe
+	}
+	impl->num_statistics_ = 0;
+	impl->evicted_ = false;
 	impl->indicateReset();
 	impl->resetMaps();
 }
@@ -155,15 +372,72 @@ void Introspection::registerSolution(const SolutionBase& s) {
 	solutionId(s);
 }
 
+void Introspection::unregisterSolution(const SolutionBase& s) {
+	auto it = impl->id_solution_bimap_.right.find(&s);
+	if (it == impl->id_solution_bimap_.right.end())
+		return;
+	impl->evictSolution(it->second);
+	impl->id_solution_bimap_.right.erase(it);
+	impl->evicted_ = true;
+}
+
+moveit_task_constructor_msgs::SolutionConstPtr Introspection::solutionMsg(const SolutionBase& s) {
+	const uint32_t id = solutionId(s);
+	if (auto cached = impl->cachedSolution(id, s))
+		return cached;
+
+	auto msg = boost::make_shared<moveit_task_constructor_msgs::Solution>();
+	s.toMsg(*msg, this);
+	msg->task_id = impl->task_id_;
+	impl->cacheSolution(id, s, msg);
+	return msg;
+}
+
 void Introspection::fillSolution(moveit_task_constructor_msgs::Solution& msg, const SolutionBase& s) {
-	s.toMsg(msg, this);
-	msg.task_id = impl->task_id_;
+	msg = *solutionMsg(s);
+}
+
+void Introspection::setSolutionCacheSize(size_t size) {
+	std::lock_guard<std::mutex> lock(impl->solution_cache_mutex_);
+	impl->solution_cache_size_ = size;
+	impl->trimSolutionCache();
+}
+
+size_t Introspection::solutionCacheSize() const {
+	return impl->solution_cache_size_;
+}
+
+void Introspection::invalidateSolutions() {
+	impl->clearSolutionCache();
 }
 
 void Introspection::publishSolution(const SolutionBase& s) {
-	moveit_task_constructor_msgs::Solution msg;
-	fillSolution(msg, s);
-	impl->solution_publisher_.publish(msg);
+	auto msg = solutionMsg(s);
+	if (!impl->compression_) {
+		impl->solution_publisher_.publish(msg);  // shares the cached message
+		return;
+	}
+	const uint32_t id = solutionId(s);
+	if (auto cached = impl->cachedCompressedSolution(id, s)) {
+		impl->compressed_solution_publisher_.publish(cached);
+		return;
+	}
+	auto compressed = boost::make_shared<moveit_task_constructor_msgs::CompressedSolution>();
+	utils::compress(*msg, *compressed, *impl->compression_);
+	impl->cacheCompressedSolution(id, s, compressed);
+	impl->compressed_solution_publisher_.publish(compressed);
+}
+
+void Introspection::enableCompression(bool enable, const utils::SolutionCompression& options) {
+	if (!enable) {
+		impl->compression_.reset();
+		return;
+	}
+	if (!impl->compressed_solution_publisher_)
+		impl->compressed_solution_publisher_ =
+		    impl->nh_.advertise<moveit_task_constructor_msgs::CompressedSolution>(COMPRESSED_SOLUTION_TOPIC, 1, true);
+	impl->compression_ = options;
+	impl->clearCompressedSolutions();  // quantized with the previous options
 }
 
 void Introspection::publishAllSolutions(bool wait) {
@@ -207,24 +481,51 @@ uint32_t Introspection::stageId(const Stage* const s) const {
 }
 
 uint32_t Introspection::solutionId(const SolutionBase& s) {
-	auto result = impl->id_solution_bimap_.left.insert(std::make_pair(1 + impl->id_solution_bimap_.size(), &s));
-	if (result.second)  // new entry
-		ROS_DEBUG_STREAM_NAMED(LOGGER, "new solution #" << result.first->first << " (" << s.creator()->name()
-		                                                << "): " << s.cost() << " " << s.comment());
-	return result.first->first;
+	auto it = impl->id_solution_bimap_.right.find(&s);
+	if (it != impl->id_solution_bimap_.right.end())
+		return it->second;
+
+	uint32_t id = ++impl->last_solution_id_;
+	impl->id_solution_bimap_.left.insert(std::make_pair(id, &s));
+	ROS_DEBUG_STREAM_NAMED(LOGGER, "new solution #" << id << " (" << s.creator()->name() << "): " << s.cost() << " "
+	                                                << s.comment());
+	return id;
 }
 
-void Introspection::fillStageStatistics(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& s) {
-	// successful solutions
-	for (const auto& solution : stage.solutions())
-		s.solved.push_back(solutionId(*solution));
+void Introspection::fillStageStatistics(const Stage& stage, moveit_task_constructor_msgs::StageStatistics& s,
+                                        uint32_t since) {
+	// successful solutions, IDs are assigned in order of creation
+	uint32_t index = 0;
+	for (const auto& solution : stage.solutions()) {
+		uint32_t id = solutionId(*solution);
+		if (id > since) {
+			s.solved.push_back(id);
+			if (since)
+				s.solved_indices.push_back(index);
+		}
+		++index;
+	}
 
-	// failed solution attempts
-	for (const auto& solution : stage.failures())
-		s.failed.push_back(solutionId(*solution));
+	// failed solution attempts, which are appended in order of creation
+	const auto& failures = stage.failures();
+	auto first_new = failures.end();
+	if (since)
+		while (first_new != failures.begin() && solutionId(**std::prev(first_new)) > since)
+			--first_new;
+	else
+		first_new = failures.begin();
+	for (auto it = first_new; it != failures.end(); ++it)
+		s.failed.push_back(solutionId(**it));
 
 	s.total_compute_time = stage.getTotalComputeTime();
 	s.num_failed = stage.numFailures();
+	s.budget_exhausted = stage.budgetExhausted();
+
+	const Stage::MemoryUsage memory = stage.memoryUsage();
+	s.memory_states = memory.states;
+	s.memory_scenes = memory.scenes;
+	s.memory_trajectories = memory.trajectories;
+	s.memory_markers = memory.markers;
 }
 
 moveit_task_constructor_msgs::TaskDescription&
@@ -242,7 +543,7 @@ Introspection::fillTaskDescription(moveit_task_constructor_msgs::TaskDescription
 			p.name = pair.first;
 			p.description = pair.second.description();
 			p.type = pair.second.typeName();
-			p.value = pair.second.serialize();
+			p.value = pair.second.serialized();  // only re-serialized if changed
 			desc.properties.push_back(p);
 		}
 
@@ -264,11 +565,17 @@ Introspection::fillTaskDescription(moveit_task_constructor_msgs::TaskDescription
 
 moveit_task_constructor_msgs::TaskStatistics&
 Introspection::fillTaskStatistics(moveit_task_constructor_msgs::TaskStatistics& msg) {
-	ContainerBase::StageCallback stage_processor = [this, &msg](const Stage& stage, unsigned int /*depth*/) -> bool {
+	return fillTaskStatistics(msg, 0);
+}
+
+moveit_task_constructor_msgs::TaskStatistics&
+Introspection::fillTaskStatistics(moveit_task_constructor_msgs::TaskStatistics& msg, uint32_t since) {
+	ContainerBase::StageCallback stage_processor = [this, &msg, since](const Stage& stage,
+	                                                                   unsigned int /*depth*/) -> bool {
 		// this method is called for each child stage of a given parent
 		moveit_task_constructor_msgs::StageStatistics stat;  // create new Stage msg
 		stat.id = stageId(&stage);
-		fillStageStatistics(stage, stat);
+		fillStageStatistics(stage, stat, since);
 
 		// finally store in msg.stages
 		msg.stages.push_back(std::move(stat));
@@ -279,6 +586,7 @@ Introspection::fillTaskStatistics(moveit_task_constructor_msgs::TaskStatistics&
 	impl->task_->stages()->traverseRecursively(stage_processor);
 
 	msg.task_id = impl->task_id_;
+	msg.incremental = since > 0;
 	return msg;
 }
 }  // namespace task_constructor
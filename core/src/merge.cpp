@@ -36,9 +36,11 @@
 /* Authors: Luca Lach, Robert Haschke */
 
 #include <moveit/task_constructor/merge.h>
+#include <moveit/task_constructor/robot_state_pool.h>
 
 #include <boost/range/adaptor/transformed.hpp>
 #include <boost/algorithm/string/join.hpp>
+#include <algorithm>
 
 namespace {
 std::vector<const moveit::core::JointModel*>
@@ -107,6 +109,14 @@ robot_trajectory::RobotTrajectoryPtr
 merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
       const moveit::core::RobotState& base_state, moveit::core::JointModelGroup*& merged_group,
       const trajectory_processing::TimeParameterization& time_parameterization) {
+	auto merged_traj = merge(sub_trajectories, base_state, merged_group);
+	time_parameterization.computeTimeStamps(*merged_traj, 1.0, 1.0);
+	return merged_traj;
+}
+
+robot_trajectory::RobotTrajectoryPtr
+merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajectories,
+      const moveit::core::RobotState& base_state, moveit::core::JointModelGroup*& merged_group) {
 	if (sub_trajectories.size() <= 1)
 		throw std::runtime_error("Expected multiple sub solutions");
 
@@ -121,7 +131,6 @@ merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajecto
 
 	// sanity checks: all sub solutions must share the same robot model and use disjoint joint sets
 	const moveit::core::RobotModelConstPtr& robot_model = base_state.getRobotModel();
-	unsigned int max_num_vars = 0;  // maximum number of joint variables across sub groups
 	for (const robot_trajectory::RobotTrajectoryConstPtr& sub : sub_trajectories) {
 		if (sub->getRobotModel() != robot_model)
 			throw std::runtime_error("subsolutions refer to multiple robot models");
@@ -133,41 +142,88 @@ merge(const std::vector<robot_trajectory::RobotTrajectoryConstPtr>& sub_trajecto
 			if (std::find(merged_joints->cbegin(), merged_joints->cend(), jm) == merged_joints->cend())
 				throw std::runtime_error("subsolutions refers to unknown joint: " + jm->getName());
 		}
-		max_num_vars = std::max(max_num_vars, jmg->getVariableCount());
 	}
 
 	// do the actual trajectory merging
-	auto merged_traj = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, merged_group);
-	std::vector<double> values;
-	values.reserve(max_num_vars);
-
-	auto merged_state = std::make_shared<moveit::core::RobotState>(base_state);
-	while (true) {
-		bool finished = true;
-		size_t index = merged_traj->getWayPointCount();
+	size_t num_waypoints = 0;
+	for (const robot_trajectory::RobotTrajectoryConstPtr& sub : sub_trajectories)
+		num_waypoints = std::max(num_waypoints, sub->getWayPointCount());
 
+	auto merged_traj = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, merged_group);
+	utils::RobotStatePoolPtr pool = utils::RobotStatePool::get(robot_model);
+	moveit::core::RobotStatePtr merged_state;
+	for (size_t index = 0; index < num_waypoints; ++index) {
+		// start from previous waypoint, such that finished sub trajectories keep their last state
+		merged_state = pool->copy(merged_state ? *merged_state : base_state);
 		for (const robot_trajectory::RobotTrajectoryConstPtr& sub : sub_trajectories) {
 			if (index >= sub->getWayPointCount())
 				continue;  // no more waypoints in this sub solution
 
-			finished = false;  // there was a waypoint, continue while loop
-			const moveit::core::RobotState& sub_state = sub->getWayPoint(index);
-			sub_state.copyJointGroupPositions(sub->getGroup(), values);
-			merged_state->setJointGroupPositions(sub->getGroup(), values);
+			// directly copy the group's variables, without an intermediate buffer
+			const double* positions = sub->getWayPoint(index).getVariablePositions();
+			for (int variable : sub->getGroup()->getVariableIndexList())
+				merged_state->setVariablePosition(variable, positions[variable]);
 		}
-		if (finished)
-			break;
-
-		merged_state->update();
-		// add waypoint without timing
+		// add waypoint without timing, postponing forward kinematics
 		merged_traj->addSuffixWayPoint(merged_state, 0.0);
-		// create new RobotState for next waypoint
-		merged_state = std::make_shared<moveit::core::RobotState>(*merged_state);
 	}
-
-	// add timing
-	time_parameterization.computeTimeStamps(*merged_traj, 1.0, 1.0);
 	return merged_traj;
 }
+
+void updateKinematics(robot_trajectory::RobotTrajectory& trajectory) {
+	for (size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+		trajectory.getWayPointPtr(i)->update();
+}
+
+void updateKinematics(robot_trajectory::RobotTrajectory& trajectory,
+                      const std::vector<const moveit::core::JointModelGroup*>& groups) {
+	if (trajectory.empty())
+		return;
+	trajectory.getWayPointPtr(0)->update();
+
+	std::vector<double> positions, velocities, accelerations;
+	auto save = [](std::vector<double>& values, const double* source, size_t count) {
+		values.assign(source, source + count);
+	};
+	for (size_t i = 1; i < trajectory.getWayPointCount(); ++i) {
+		moveit::core::RobotState& waypoint = *trajectory.getWayPointPtr(i);
+		const size_t count = waypoint.getVariableCount();
+		const bool has_velocities = waypoint.hasVelocities();
+		const bool has_accelerations = waypoint.hasAccelerations();
+		save(positions, waypoint.getVariablePositions(), count);
+		if (has_velocities)
+			save(velocities, waypoint.getVariableVelocities(), count);
+		if (has_accelerations)
+			save(accelerations, waypoint.getVariableAccelerations(), count);
+
+		// start from the (updated) predecessor, copying its transforms
+		waypoint = trajectory.getWayPoint(i - 1);
+		for (const moveit::core::JointModelGroup* jmg : groups) {
+			if (!jmg)
+				continue;
+			const std::vector<int>& variables = jmg->getVariableIndexList();
+			if (std::all_of(variables.begin(), variables.end(),
+			                [&](int v) { return waypoint.getVariablePosition(v) == positions[v]; }))
+				continue;  // group didn't move
+			for (int v : variables)
+				waypoint.setVariablePosition(v, positions[v]);
+			waypoint.update();  // only updates the group's subtree
+		}
+		// fall back to a full update if other variables moved as well
+		if (!std::equal(positions.begin(), positions.end(), waypoint.getVariablePositions())) {
+			waypoint.setVariablePositions(positions);
+			waypoint.update();
+		}
+		// restore timing of the waypoint, overwritten by the assignment
+		if (has_velocities)
+			waypoint.setVariableVelocities(velocities);
+		else
+			waypoint.zeroVelocities();
+		if (has_accelerations)
+			waypoint.setVariableAccelerations(accelerations);
+		else
+			waypoint.zeroAccelerations();
+	}
+}
 }  // namespace task_constructor
 }  // namespace moveit
@@ -0,0 +1,308 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Lightweight runtime metrics of a task, independent of introspection
+ */
+
+#include <moveit/task_constructor/metrics.h>
+#include <moveit/task_constructor/histogram.h>
+#include <moveit/task_constructor/stage_p.h>
+#include <moveit/task_constructor/task_p.h>
+
+#include <boost/algorithm/string/join.hpp>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+using moveit_task_constructor_msgs::PlannerMetrics;
+using moveit_task_constructor_msgs::StageMetrics;
+using moveit_task_constructor_msgs::TaskMetrics;
+
+namespace {
+constexpr const char* METRICS_TOPIC = "metrics";
+
+uint32_t queued(const InterfaceConstPtr& interface) {
+	return interface ? interface->size() + interface->deferredSize() : 0u;
+}
+
+uint32_t pruned(const InterfaceConstPtr& interface) {
+	uint32_t result = 0;
+	if (interface)
+		for (const InterfaceState* state : *interface)
+			result += state->priority().status() == InterfaceState::PRUNED;
+	return result;
+}
+
+// label values need to escape backslash, double quote, and line feed
+std::string label(const std::string& value) {
+	std::string result;
+	result.reserve(value.size());
+	for (char c : value) {
+		if (c == '\\' || c == '"')
+			result.push_back('\\');
+		if (c == '\n')
+			result.append("\\n");
+		else
+			result.push_back(c);
+	}
+	return result;
+}
+
+std::string bound(double value) {
+	if (std::isinf(value))
+		return "+Inf";
+	std::ostringstream os;
+	os << value;
+	return os.str();
+}
+
+void writeHistogram(std::ostream& os, const char* name, const std::string& labels, const std::vector<double>& bounds,
+                    const std::vector<uint64_t>& buckets, double sum, uint64_t count) {
+	uint64_t cumulative = 0;
+	for (size_t b = 0; b < buckets.size() && b < bounds.size(); ++b) {
+		cumulative += buckets[b];
+		os << name << "_bucket{" << labels << ",le=\"" << bound(bounds[b]) << "\"} " << cumulative << '\n';
+	}
+	os << name << "_sum{" << labels << "} " << sum << '\n';
+	os << name << "_count{" << labels << "} " << count << '\n';
+}
+}  // namespace
+
+MetricsPublisher::MetricsPublisher(Task& task, double rate)
+  : task_(task)
+  , nh_(std::string("~/") + task.pimpl()->ns())  // like introspection, publish in private namespace
+  , last_sample_(Clock::now()) {
+	publisher_ = nh_.advertise<TaskMetrics>(METRICS_TOPIC, 1);
+	setPublishRate(rate);
+	callback_ = task_.addTaskCallback([this](const Task& /*task*/) {
+		if (Clock::now() - last_publish_ >= period_)
+			publish();
+	});
+}
+
+MetricsPublisher::~MetricsPublisher() {
+	task_.eraseTaskCallback(callback_);
+}
+
+void MetricsPublisher::setPublishRate(double rate) {
+	period_ = std::chrono::duration<double>(rate > 0.0 ? 1.0 / rate : 0.0);
+}
+
+double MetricsPublisher::publishRate() const {
+	double period = period_.count();
+	return period > 0.0 ? 1.0 / period : 0.0;
+}
+
+void MetricsPublisher::publish() {
+	last_publish_ = Clock::now();
+	if (publisher_.getNumSubscribers() == 0 && textfile_.empty())
+		return;  // nobody is interested: skip sampling
+
+	TaskMetrics msg;
+	fill(msg);
+	publisher_.publish(msg);
+
+	if (textfile_.empty())
+		return;
+	// write to a temporary file first, such that scrapers never read a partial file
+	const std::string tmp = textfile_ + ".tmp";
+	{
+		std::ofstream file(tmp);
+		writePrometheus(msg, file);
+		if (!file) {
+			ROS_WARN_STREAM_THROTTLE_NAMED(10.0, "Metrics", "failed to write metrics to '" << tmp << "'");
+			return;
+		}
+	}
+	if (std::rename(tmp.c_str(), textfile_.c_str()) != 0)
+		ROS_WARN_STREAM_THROTTLE_NAMED(10.0, "Metrics", "failed to replace metrics file '" << textfile_ << "'");
+}
+
+void MetricsPublisher::fill(TaskMetrics& msg) {
+	const Clock::time_point now = Clock::now();
+	const double elapsed = std::chrono::duration<double>(now - last_sample_).count();
+
+	msg.stamp = ros::Time::now();
+	msg.task = task_.name();
+	msg.latency_bounds.resize(utils::LatencyHistogram::BUCKETS);
+	for (size_t i = 0; i < msg.latency_bounds.size(); ++i)
+		msg.latency_bounds[i] = utils::LatencyHistogram::bound(i);
+
+	msg.stages.clear();
+	std::vector<std::string> path;
+	std::unordered_map<const Stage*, size_t> solutions;
+	task_.stages()->traverseRecursively([&](const Stage& stage, unsigned int depth) {
+		path.resize(depth);
+		path.push_back(stage.name());
+
+		const StagePrivate* impl = stage.pimpl();
+		const utils::LatencyHistogram& latency = impl->computeLatency();
+		StageMetrics m;
+		m.path = boost::algorithm::join(path, "/");
+		m.computes = latency.count();
+		m.compute_time = stage.getTotalComputeTime();
+		m.latency_buckets.resize(utils::LatencyHistogram::BUCKETS);
+		for (size_t i = 0; i < m.latency_buckets.size(); ++i)
+			m.latency_buckets[i] = latency.count(i);
+		m.queued_starts = queued(impl->starts());
+		m.queued_ends = queued(impl->ends());
+		m.pruned_states = pruned(impl->starts()) + pruned(impl->ends());
+		m.solutions = stage.solutions().size();
+		m.failures = stage.numFailures();
+
+		// counters restart on reset()
+		auto it = last_solutions_.find(&stage);
+		const size_t previous = it != last_solutions_.end() && it->second <= m.solutions ? it->second : 0u;
+		m.solutions_per_second = elapsed > 0.0 ? (m.solutions - previous) / elapsed : 0.0;
+		solutions[&stage] = m.solutions;
+
+		msg.stages.push_back(std::move(m));
+		return true;
+	});
+	last_solutions_.swap(solutions);
+	last_sample_ = now;
+
+	msg.planners.clear();
+	for (const auto& planner : planners_) {
+		const solvers::InstrumentedPlanner::Statistics statistics = planner->statistics();
+		PlannerMetrics m;
+		m.name = planner->name();
+		m.calls = statistics.calls;
+		m.successes = statistics.successes;
+		m.planning_time = statistics.latency.sum();
+		m.latency_buckets.resize(utils::LatencyHistogram::BUCKETS);
+		for (size_t i = 0; i < m.latency_buckets.size(); ++i)
+			m.latency_buckets[i] = statistics.latency.count(i);
+		for (const auto& failure : statistics.failures) {
+			m.failure_messages.push_back(failure.first);
+			m.failure_counts.push_back(failure.second);
+		}
+		m.waypoints = statistics.waypoints;
+		m.path_length = statistics.path_length;
+		msg.planners.push_back(std::move(m));
+	}
+}
+
+void MetricsPublisher::writePrometheus(const TaskMetrics& msg, std::ostream& os) {
+	struct Metric
+	{
+		const char* name;
+		const char* type;
+		const char* help;
+		double (*value)(const StageMetrics& m);
+	};
+	static const Metric METRICS[] = {
+		{ "mtc_stage_computes_total", "counter", "Number of compute() calls since the last reset",
+		  [](const StageMetrics& m) { return static_cast<double>(m.computes); } },
+		{ "mtc_stage_queued_starts", "gauge", "Number of states in the start interface",
+		  [](const StageMetrics& m) { return static_cast<double>(m.queued_starts); } },
+		{ "mtc_stage_queued_ends", "gauge", "Number of states in the end interface",
+		  [](const StageMetrics& m) { return static_cast<double>(m.queued_ends); } },
+		{ "mtc_stage_pruned_states", "gauge", "Number of pruned states in the pull interfaces",
+		  [](const StageMetrics& m) { return static_cast<double>(m.pruned_states); } },
+		{ "mtc_stage_solutions_total", "counter", "Number of solutions since the last reset",
+		  [](const StageMetrics& m) { return static_cast<double>(m.solutions); } },
+		{ "mtc_stage_failures_total", "counter", "Number of failures since the last reset",
+		  [](const StageMetrics& m) { return static_cast<double>(m.failures); } },
+		{ "mtc_stage_solutions_per_second", "gauge", "Rate of new solutions since the previous sample",
+		  [](const StageMetrics& m) { return m.solutions_per_second; } },
+	};
+
+	const std::string task = label(msg.task);
+	std::vector<std::string> labels;
+	labels.reserve(msg.stages.size());
+	for (const StageMetrics& m : msg.stages)
+		labels.push_back("task=\"" + task + "\",stage=\"" + label(m.path) + "\"");
+
+	for (const Metric& metric : METRICS) {
+		os << "# HELP " << metric.name << ' ' << metric.help << '\n';
+		os << "# TYPE " << metric.name << ' ' << metric.type << '\n';
+		for (size_t i = 0; i < msg.stages.size(); ++i)
+			os << metric.name << '{' << labels[i] << "} " << metric.value(msg.stages[i]) << '\n';
+	}
+
+	const char* name = "mtc_stage_compute_seconds";
+	os << "# HELP " << name << " Duration of compute() calls since the last reset\n# TYPE " << name << " histogram\n";
+	for (size_t i = 0; i < msg.stages.size(); ++i) {
+		const StageMetrics& m = msg.stages[i];
+		writeHistogram(os, name, labels[i], msg.latency_bounds, m.latency_buckets, m.compute_time, m.computes);
+	}
+	if (msg.planners.empty())
+		return;
+
+	labels.clear();
+	for (const PlannerMetrics& m : msg.planners)
+		labels.push_back("task=\"" + task + "\",planner=\"" + label(m.name) + "\"");
+
+	name = "mtc_planner_seconds";
+	os << "# HELP " << name << " Duration of planning calls\n# TYPE " << name << " histogram\n";
+	for (size_t i = 0; i < msg.planners.size(); ++i) {
+		const PlannerMetrics& m = msg.planners[i];
+		writeHistogram(os, name, labels[i], msg.latency_bounds, m.latency_buckets, m.planning_time, m.calls);
+	}
+
+	name = "mtc_planner_successes_total";
+	os << "# HELP " << name << " Number of successful planning calls\n# TYPE " << name << " counter\n";
+	for (size_t i = 0; i < msg.planners.size(); ++i)
+		os << name << '{' << labels[i] << "} " << msg.planners[i].successes << '\n';
+
+	name = "mtc_planner_failures_total";
+	os << "# HELP " << name << " Number of failed planning calls per message\n# TYPE " << name << " counter\n";
+	for (size_t i = 0; i < msg.planners.size(); ++i) {
+		const PlannerMetrics& m = msg.planners[i];
+		for (size_t j = 0; j < m.failure_messages.size() && j < m.failure_counts.size(); ++j)
+			os << name << '{' << labels[i] << ",message=\"" << label(m.failure_messages[j]) << "\"} "
+			   << m.failure_counts[j] << '\n';
+	}
+
+	name = "mtc_planner_waypoints_total";
+	os << "# HELP " << name << " Number of waypoints of successfully planned trajectories\n# TYPE " << name
+	   << " counter\n";
+	for (size_t i = 0; i < msg.planners.size(); ++i)
+		os << name << '{' << labels[i] << "} " << msg.planners[i].waypoints << '\n';
+
+	name = "mtc_planner_path_length_total";
+	os << "# HELP " << name << " Joint-space length of successfully planned trajectories\n# TYPE " << name
+	   << " counter\n";
+	for (size_t i = 0; i < msg.planners.size(); ++i)
+		os << name << '{' << labels[i] << "} " << msg.planners[i].path_length << '\n';
+}
+
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,133 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Action server planning requests and streaming solutions while planning continues
+ */
+
+#include <moveit/task_constructor/planning_action_server.h>
+#include <moveit/task_constructor/properties.h>
+#include <moveit/task_constructor/storage.h>
+
+#include <ros/console.h>
+
+#include <chrono>
+#include <functional>
+
+namespace moveit {
+namespace task_constructor {
+
+PlanningActionServer::PlanningActionServer(const TaskTemplate& task_template, const std::string& action_name,
+                                           const ros::NodeHandle& nh)
+  : server_(task_template, 1)
+  , action_server_(ros::NodeHandle(nh), action_name,
+                   std::bind(&PlanningActionServer::execute, this, std::placeholders::_1), false) {
+	action_server_.start();
+}
+
+PlanningActionServer::~PlanningActionServer() {
+	shutdown_ = true;  // preempt a running goal, such that action_server_'s destructor can join its thread
+	action_server_.shutdown();
+}
+
+void PlanningActionServer::execute(const moveit_task_constructor_msgs::PlanTaskGoalConstPtr& goal) {
+	moveit_task_constructor_msgs::PlanTaskResult result;
+	const auto accepted = std::chrono::steady_clock::now();
+
+	PlanningServer::Request request;
+	request.name = goal->name;
+	request.max_solutions = goal->max_solutions;
+	request.timeout = goal->timeout;
+	for (const auto& p : goal->properties) {
+		boost::any value;
+		try {
+			value = Property::deserialize(p.type, p.value);
+		} catch (const std::exception& e) {
+			ROS_ERROR_STREAM_NAMED("PlanningActionServer", "property '" << p.name << "': " << e.what());
+		}
+		if (value.empty() && p.type != Property::typeName(typeid(std::string))) {
+			result.error_code.val = moveit_msgs::MoveItErrorCodes::INVALID_GOAL_CONSTRAINTS;
+			action_server_.setAborted(result, "failed to deserialize property '" + p.name + "' of type " + p.type);
+			return;
+		}
+		request.properties[p.name] = value;
+	}
+
+	// called from the planning thread, publishing feedback is thread-safe
+	uint32_t num_solutions = 0;
+	request.on_solution = [this, &num_solutions, accepted](const SolutionBase& solution) {
+		if (solution.isFailure())
+			return;
+		moveit_task_constructor_msgs::PlanTaskFeedback feedback;
+		solution.toMsg(feedback.solution);
+		feedback.num_solutions = ++num_solutions;
+		feedback.planning_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - accepted).count();
+		action_server_.publishFeedback(feedback);
+	};
+
+	utils::CancellationToken cancellation = request.cancellation;
+	std::future<PlanningServer::Result> future = server_.submit(std::move(request));
+	while (future.wait_for(std::chrono::milliseconds(50)) != std::future_status::ready) {
+		if (action_server_.isPreemptRequested() || shutdown_ || !ros::ok())
+			cancellation.cancel();
+	}
+
+	try {
+		PlanningServer::Result planned = future.get();
+		result.error_code = planned.error_code;
+		for (const auto& solution : planned.task.solutions()) {
+			if (solution->isFailure() || (goal->max_solutions > 0 && result.solutions.size() >= goal->max_solutions))
+				break;
+			result.solutions.emplace_back();
+			solution->toMsg(result.solutions.back());
+		}
+	} catch (const std::exception& e) {  // e.g. the template failed to instantiate the task
+		result.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+		action_server_.setAborted(result, e.what());
+		return;
+	} catch (...) {
+		result.error_code.val = moveit_msgs::MoveItErrorCodes::FAILURE;
+		action_server_.setAborted(result, "planning failed with an unknown exception");
+		return;
+	}
+
+	if (cancellation.cancelled())
+		action_server_.setPreempted(result);
+	else if (!result.solutions.empty())
+		action_server_.setSucceeded(result);
+	else
+		action_server_.setAborted(result, "planning failed");
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,152 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Plan many requests concurrently on a pool of tasks
+ */
+
+#include <moveit/task_constructor/planning_server.h>
+
+#include <ros/console.h>
+
+#include <algorithm>
+#include <memory>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+double secondsSince(std::chrono::steady_clock::time_point start) {
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+}  // namespace
+
+PlanningServer::PlanningServer(const TaskTemplate& task_template, size_t num_threads) : template_(task_template) {
+	if (num_threads == 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	workers_.reserve(num_threads);
+	for (size_t i = 0; i < num_threads; ++i)
+		workers_.emplace_back(&PlanningServer::work, this);
+}
+
+PlanningServer::~PlanningServer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+		queue_.clear();  // abandon queued requests
+	}
+	cv_.notify_all();
+	for (std::thread& worker : workers_)
+		worker.join();
+}
+
+std::future<PlanningServer::Result> PlanningServer::submit(Request request) {
+	Job job{ std::move(request), std::promise<Result>(), std::chrono::steady_clock::now() };
+	std::future<Result> result = job.promise.get_future();
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.push_back(std::move(job));
+	}
+	cv_.notify_one();
+	return result;
+}
+
+size_t PlanningServer::pending() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return queue_.size();
+}
+
+Task PlanningServer::instantiate(const std::string& name) {
+	std::lock_guard<std::mutex> lock(build_mutex_);
+	return template_.instantiate(name);
+}
+
+void PlanningServer::work() {
+	// keep a task at hand, instantiated while no request is waiting
+	std::unique_ptr<Task> prepared;
+	const auto prepare = [this, &prepared] {
+		try {
+			prepared = std::make_unique<Task>(instantiate(template_.prototype().name()));
+		} catch (...) {
+			prepared.reset();  // retried for the next request, which receives the failure
+		}
+	};
+	prepare();
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+			if (stop_)
+				return;
+			job = std::move(queue_.front());
+			queue_.pop_front();
+		}
+
+		const double queue_time = secondsSince(job.submitted);
+		try {
+			Task task = prepared ? std::move(*prepared) : instantiate(job.request.name);
+			prepared.reset();
+			task.setName(job.request.name);
+			for (const auto& property : job.request.properties)
+				task.setProperty(property.first, property.second);
+
+			if (job.request.timeout > 0.0)
+				task.setTimeout(job.request.timeout);
+
+			const auto start = std::chrono::steady_clock::now();
+			moveit::core::MoveItErrorCode error_code = moveit::core::MoveItErrorCode::PREEMPTED;
+			if (!job.request.cancellation.cancelled()) {
+				Stage::SolutionCallbackList::const_iterator cb;
+				if (job.request.on_solution)
+					cb = task.addSolutionCallback(Task::SolutionCallback(job.request.on_solution));
+				utils::CancellationToken::Registration preempt(job.request.cancellation, [&task] { task.preempt(); });
+				error_code = task.plan(job.request.max_solutions, job.request.policy);
+				if (job.request.on_solution)
+					task.removeSolutionCallback(cb);
+			}
+			const double planning_time = secondsSince(start);
+			const double latency = secondsSince(job.submitted);
+			ROS_DEBUG_STREAM_NAMED("PlanningServer", "request '" << job.request.name << "': " << latency
+			                                                     << "s latency, " << planning_time << "s planning");
+
+			job.promise.set_value(Result{ std::move(task), error_code, queue_time, planning_time, latency });
+		} catch (...) {
+			job.promise.set_exception(std::current_exception());
+		}
+		// prepare a fresh task for the next request
+		prepare();
+	}
+}
+}  // namespace task_constructor
+}  // namespace moveit
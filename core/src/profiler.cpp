@@ -0,0 +1,179 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Scoped timers recording the computation time of stages, solvers, and cost terms
+ */
+
+#include <moveit/task_constructor/profiler.h>
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+void writeJsonString(std::ostream& os, const std::string& s) {
+	static const char* hex = "0123456789abcdef";
+	os << '"';
+	for (char c : s) {
+		switch (c) {
+			case '"':
+				os << "\\\"";
+				break;
+			case '\\':
+				os << "\\\\";
+				break;
+			case '\n':
+				os << "\\n";
+				break;
+			case '\t':
+				os << "\\t";
+				break;
+			default:
+				if (static_cast<unsigned char>(c) < 0x20)
+					os << "\\u00" << hex[(c >> 4) & 0xf] << hex[c & 0xf];
+				else
+					os << c;
+		}
+	}
+	os << '"';
+}
+
+int64_t micros(Profiler::Clock::duration d) {
+	return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+}  // namespace
+
+Profiler::Context& Profiler::context() {
+	static thread_local Context context;
+	return context;
+}
+
+Profiler::Activation::Activation(Context context) : previous_(std::move(Profiler::context())) {
+	Profiler::context() = std::move(context);
+}
+
+Profiler::Activation::~Activation() {
+	Profiler::context() = std::move(previous_);
+}
+
+void Profiler::record(Event&& event) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	event.thread = threads_.emplace(std::this_thread::get_id(), threads_.size()).first->second;
+	events_.push_back(std::move(event));
+}
+
+void Profiler::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	events_.clear();
+	origin_ = Clock::now();
+}
+
+std::vector<Profiler::Event> Profiler::events() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return events_;
+}
+
+void Profiler::writeChromeTrace(std::ostream& os) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	os << "{\"traceEvents\":[";
+	const char* separator = "\n";
+	for (const Event& e : events_) {
+		os << separator << "{\"name\":";
+		writeJsonString(os, e.name);
+		os << ",\"cat\":";
+		writeJsonString(os, e.category);
+		os << ",\"ph\":\"X\",\"ts\":" << micros(e.start - origin_) << ",\"dur\":" << micros(e.duration)
+		   << ",\"pid\":0,\"tid\":" << e.thread << "}";
+		separator = ",\n";
+	}
+	os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+void Profiler::writeFlameGraph(std::ostream& os) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	// accumulate total time per stack, then subtract time of direct children to yield self time
+	std::map<std::string, Clock::duration> total;
+	for (const Event& e : events_)
+		total[e.stack] += e.duration;
+
+	std::map<std::string, Clock::duration> self = total;
+	for (const auto& entry : total) {
+		auto pos = entry.first.rfind(';');
+		if (pos == std::string::npos)
+			continue;
+		auto parent = self.find(entry.first.substr(0, pos));
+		if (parent != self.end())
+			parent->second -= entry.second;
+	}
+	for (const auto& entry : self)  // children computed concurrently might exceed their parent's time
+		os << entry.first << ' ' << std::max<int64_t>(micros(entry.second), 0) << '\n';
+}
+
+ScopedTimer::ScopedTimer(const char* category, const std::string& name)
+  : profiler_(Profiler::context().profiler), category_(category), stack_size_(0) {
+	if (!profiler_)
+		return;
+
+	std::string& stack = Profiler::context().stack;
+	stack_size_ = stack.size();
+	if (!stack.empty())
+		stack.push_back(';');
+	// ';' separates frames in folded stacks
+	std::replace_copy(name.begin(), name.end(), std::back_inserter(stack), ';', ':');
+	start_ = Profiler::Clock::now();
+}
+
+ScopedTimer::~ScopedTimer() {
+	if (!profiler_)
+		return;
+
+	auto stop = Profiler::Clock::now();
+	std::string& stack = Profiler::context().stack;
+	Profiler::Event event;
+	event.category = category_;
+	event.name = stack.substr(stack_size_ == 0 ? 0 : stack_size_ + 1);
+	event.stack = stack;
+	event.start = start_;
+	event.duration = stop - start_;
+	stack.resize(stack_size_);
+	profiler_->record(std::move(event));
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
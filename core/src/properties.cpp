@@ -39,6 +39,7 @@
 #include <moveit/task_constructor/properties.h>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
+#include <atomic>
 #include <functional>
 #include <ros/console.h>
 
@@ -131,6 +132,7 @@ void Property::setCurrentValue(const boost::any& value) {
 		throw Property::type_error(value.type().name(), type_info_.name());
 
 	value_ = value;
+	serialized_valid_ = false;
 	initialized_from_ = 1;  // manually initialized TODO: use enums
 }
 
@@ -139,12 +141,14 @@ void Property::setDefaultValue(const boost::any& value) {
 		throw Property::type_error(value.type().name(), type_info_.name());
 
 	default_ = value;
+	serialized_valid_ = false;
 }
 
 void Property::reset() {
 	if (initialized_from_ == 0)  // TODO: use enum
 		return;  // keep manually set values
 	boost::any().swap(value_);
+	serialized_valid_ = false;
 	initialized_from_ = -1;  // set to max value
 }
 
@@ -154,6 +158,14 @@ std::string Property::serialize(const boost::any& value) {
 	return REGISTRY_SINGLETON.entry(value.type()).serialize_(value);
 }
 
+const std::string& Property::serialized() const {
+	if (!serialized_valid_) {
+		serialized_ = serialize(value());
+		serialized_valid_ = true;
+	}
+	return serialized_;
+}
+
 boost::any Property::deserialize(const std::string& type_name, const std::string& wire) {
 	if (type_name != Property::typeName(typeid(std::string)) && wire.empty())
 		return boost::any();
@@ -185,33 +197,144 @@ Property& Property::configureInitFrom(SourceFlags source, const Property::Initia
 
 	source_flags_ = f ? source : SourceFlags();
 	initializer_ = f;
+	source_name_.clear();
 	return *this;
 }
 
 Property& Property::configureInitFrom(SourceFlags source, const std::string& name) {
-	return configureInitFrom(source, [name](const PropertyMap& other) { return fromName(other, name); });
+	configureInitFrom(source, [name](const PropertyMap& other) { return fromName(other, name); });
+	source_name_ = name;
+	return *this;
+}
+
+uint64_t PropertyMap::nextGeneration() {
+	static std::atomic<uint64_t> generation{ 0 };
+	return ++generation;
+}
+
+PropertyMap::PropertyMap(const PropertyMap& other) : props_(other.props_) {
+	touch();
+	if (other.leaked_)  // other's properties might be modified via references: don't share them
+		unshareAll();
+}
+
+PropertyMap::PropertyMap(PropertyMap&& other) noexcept : props_(std::move(other.props_)), leaked_(other.leaked_) {
+	touch();
+	other.props_.reset();
+	other.leaked_ = false;
+	other.touch();
+}
+
+PropertyMap& PropertyMap::operator=(const PropertyMap& other) {
+	if (this == &other)
+		return *this;
+	props_ = other.props_;
+	leaked_ = false;
+	touch();
+	if (other.leaked_)
+		unshareAll();
+	return *this;
+}
+
+PropertyMap& PropertyMap::operator=(PropertyMap&& other) noexcept {
+	if (this == &other)
+		return *this;
+	props_ = std::move(other.props_);
+	leaked_ = other.leaked_;
+	touch();
+	other.props_.reset();
+	other.leaked_ = false;
+	other.touch();
+	return *this;
+}
+
+PropertyMap::~PropertyMap() {
+	if (anchor_)
+		anchor_->map = nullptr;  // invalidate handles
+}
+
+const PropertyMap::container_type& PropertyMap::props() const {
+	static const container_type EMPTY;
+	return props_ ? *props_ : EMPTY;
+}
+
+PropertyMap::container_type& PropertyMap::mutableProps() {
+	// a stale use_count() > 1 only causes a superfluous copy: while unique, nobody else can start sharing
+	if (!props_)
+		props_ = std::make_shared<container_type>();
+	else if (props_.use_count() > 1) {
+		// the copy shares the individual properties, which are unshared on write
+		props_ = std::make_shared<container_type>(*props_);
+		touch();
+	}
+	return *props_;
+}
+
+Property& PropertyMap::mutableProperty(container_type::iterator it) {
+	if (it->second.use_count() > 1) {  // shared with another container
+		it->second = std::make_shared<value_type>(*it->second);
+		generation_ = nextGeneration();  // this property moved, the container is unchanged
+	}
+	return it->second->second;
+}
+
+PropertyMap::container_type& PropertyMap::unshareAll() {
+	auto& props = mutableProps();
+	for (auto it = props.begin(); it != props.end(); ++it)
+		mutableProperty(it);
+	return props;
 }
 
 Property& PropertyMap::declare(const std::string& name, const Property::type_info& type_info,
                                const std::string& description, const boost::any& default_value) {
-	auto it_inserted = props_.insert(std::make_pair(name, Property(type_info, description, default_value)));
+	auto& props = mutableProps();
+	auto it = props.find(name);
+	if (it == props.end()) {
+		it = props.emplace(name, std::make_shared<value_type>(name, Property(type_info, description, default_value)))
+		         .first;
+		touch();
+		return it->second->second;
+	}
 	// if name was already declared, the new declaration should match in type (except it was boost::any)
-	if (!it_inserted.second && it_inserted.first->second.type_info_ != typeid(boost::any) &&
-	    type_info != it_inserted.first->second.type_info_)
-		throw Property::type_error(type_info.name(), it_inserted.first->second.type_info_.name());
-	return it_inserted.first->second;
+	Property& p = mutableProperty(it);
+	if (p.type_info_ != typeid(boost::any) && type_info != p.type_info_)
+		throw Property::type_error(type_info.name(), p.type_info_.name());
+	return p;
 }
 
 bool PropertyMap::hasProperty(const std::string& name) const {
-	auto it = props_.find(name);
-	return it != props_.end();
+	const auto& props = this->props();
+	auto it = props.find(name);
+	return it != props.end();
 }
 
 Property& PropertyMap::property(const std::string& name) {
-	auto it = props_.find(name);
-	if (it == props_.end())
+	auto& props = mutableProps();
+	auto it = props.find(name);
+	if (it == props.end())
+		throw Property::undeclared(name);
+	leaked_ = true;
+	touch();  // the property might get reconfigured via the returned reference
+	return mutableProperty(it);
+}
+
+const Property& PropertyMap::property(const std::string& name) const {
+	const auto& props = this->props();
+	auto it = props.find(name);
+	if (it == props.end())
 		throw Property::undeclared(name);
-	return it->second;
+	return it->second->second;
+}
+
+PropertyMap::iterator PropertyMap::begin() {
+	leaked_ = true;
+	touch();
+	return iterator(unshareAll().begin());
+}
+
+PropertyMap::iterator PropertyMap::end() {
+	leaked_ = true;
+	return iterator(unshareAll().end());
 }
 
 void PropertyMap::exposeTo(PropertyMap& other, const std::set<std::string>& properties) const {
@@ -225,31 +348,37 @@ void PropertyMap::exposeTo(PropertyMap& other, const std::string& name, const st
 }
 
 void PropertyMap::configureInitFrom(Property::SourceFlags source, const std::set<std::string>& properties) {
-	for (auto& pair : props_) {
-		if (properties.empty() || properties.count(pair.first))
+	auto& props = mutableProps();
+	for (auto it = props.begin(); it != props.end(); ++it) {
+		if (properties.empty() || properties.count(it->first))
 			try {
-				pair.second.configureInitFrom(source, std::bind(&fromName, std::placeholders::_1, pair.first));
+				mutableProperty(it).configureInitFrom(source, it->first);
 			} catch (Property::error& e) {
-				e.setName(pair.first);
+				e.setName(it->first);
 				throw;
 			}
 	}
+	touch();
 }
 
 template <>
 void PropertyMap::set<boost::any>(const std::string& name, const boost::any& value) {
-	auto range = props_.equal_range(name);
-	if (range.first == range.second) {  // name is not yet declared
+	auto& props = mutableProps();
+	auto it = props.find(name);
+	if (it == props.end()) {  // name is not yet declared
 		if (value.empty())
 			throw Property::undeclared(name, "trying to set undeclared property '" + name + "' with NULL value");
-		auto it = props_.insert(range.first, std::make_pair(name, Property(value.type(), "", boost::any())));
-		it->second.setValue(value);
+		declare(name, value.type(), "", boost::any()).setValue(value);
 	} else
-		range.first->second.setValue(value);
+		mutableProperty(it).setValue(value);
 }
 
 void PropertyMap::setCurrent(const std::string& name, const boost::any& value) {
-	property(name).setCurrentValue(value);
+	auto& props = mutableProps();
+	auto it = props.find(name);
+	if (it == props.end())
+		throw Property::undeclared(name);
+	mutableProperty(it).setCurrentValue(value);
 }
 
 const boost::any& PropertyMap::get(const std::string& name) const {
@@ -266,35 +395,84 @@ size_t PropertyMap::countDefined(const std::vector<std::string>& list) const {
 }
 
 void PropertyMap::reset() {
-	for (auto& pair : props_)
-		pair.second.reset();
+	if (!props_)
+		return;
+	auto& props = mutableProps();
+	for (auto it = props.begin(); it != props.end(); ++it)
+		if (it->second->second.initialized_from_ != 0)  // keep manually set values (without unsharing them)
+			mutableProperty(it).reset();
 }
 
-void PropertyMap::performInitFrom(Property::SourceFlags source, const PropertyMap& other) {
-	for (auto& pair : props_) {
-		Property& p = pair.second;
+void PropertyMap::performInitFrom(const std::string& name, Property& p, Property::SourceFlags source,
+                                  const PropertyMap& other) {
+	// don't override value previously set by higher-priority source
+	// MANUAL > CURRENT > PARENT > INTERFACE
+	if (p.initialized_from_ < source && p.defined())
+		return;
+
+	boost::any value;
+	try {
+		value = p.initializer_(other);
+	} catch (const Property::undeclared&) {
+		// ignore undeclared
+		return;
+	} catch (const Property::undefined&) {
+	}
 
-		// don't override value previously set by higher-priority source
-		// MANUAL > CURRENT > PARENT > INTERFACE
-		if (p.initialized_from_ < source && p.defined())
-			continue;
+	ROS_DEBUG_STREAM_NAMED(LOGNAME,
+	                       fmt::format("{}: {} -> {}: {}", name, p.initialized_from_, source, Property::serialize(value)));
+	p.setCurrentValue(value);
+	p.initialized_from_ = source;
+}
+
+void PropertyMap::performInitFrom(Property::SourceFlags source, const PropertyMap& other) {
+	if (!props_)
+		return;
+	auto& props = mutableProps();
+	for (auto it = props.begin(); it != props.end(); ++it) {
 		// is the property configured for initialization from this source?
-		if (!p.initsFrom(source))
-			continue;
+		if (it->second->second.initsFrom(source))
+			performInitFrom(it->first, mutableProperty(it), source, other);
+	}
+}
+
+PropertyMap::InitPlan PropertyMap::initPlan(Property::SourceFlags source) {
+	InitPlan plan;
+	plan.source_ = source;
+	if (!props_)
+		return plan;
+	auto& props = mutableProps();
+	for (auto it = props.begin(); it != props.end(); ++it)
+		if (it->second->second.initsFrom(source))
+			plan.entries_.push_back(it);
+	plan.layout_ = layout_;
+	return plan;
+}
 
-		boost::any value;
-		try {
-			value = p.initializer_(other);
-		} catch (const Property::undeclared&) {
-			// ignore undeclared
+void PropertyMap::performInitFrom(const InitPlan& plan, const PropertyMap& other) {
+	if (!props_)
+		return;
+	mutableProps();  // unshare the container from copies, renewing the layout
+	if (plan.layout_ != layout_) {  // plan is outdated, referring to another container
+		performInitFrom(plan.source_, other);
+		return;
+	}
+	const container_type& other_props = other.props();
+	for (container_type::iterator entry : plan.entries_) {
+		const Property& current = entry->second->second;
+		if (!current.initsFrom(plan.source_) || (current.initialized_from_ < plan.source_ && current.defined()))
+			continue;  // reconfigured, or defined by a higher-priority source
+		Property& p = mutableProperty(entry);
+		if (p.source_name_.empty()) {
+			performInitFrom(entry->first, p, plan.source_, other);
 			continue;
-		} catch (const Property::undefined&) {
 		}
-
-		ROS_DEBUG_STREAM_NAMED(LOGNAME, fmt::format("{}: {} -> {}: {}", pair.first, p.initialized_from_, source,
-		                                            Property::serialize(value)));
-		p.setCurrentValue(value);
-		p.initialized_from_ = source;
+		// initialization by name: directly look up the source property, skipping the initializer function
+		auto it = other_props.find(p.source_name_);
+		if (it == other_props.end())
+			continue;  // ignore undeclared
+		p.setCurrentValue(it->second->second.value());
+		p.initialized_from_ = plan.source_;
 	}
 }
 
@@ -0,0 +1,247 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Precomputed reachability map of an ik frame for fast pre-screening of IK targets
+ */
+
+#include <moveit/task_constructor/reachability_map.h>
+
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <random_numbers/random_numbers.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+constexpr char MAGIC[8] = "MTCRMAP";
+constexpr uint32_t VERSION = 2;  // 2: added offset
+constexpr size_t NAME_LENGTH = 64;
+
+// fixed-size file header, followed by two bytes (score, direction mask) per voxel
+struct FileHeader
+{
+	char magic[8];
+	uint32_t version;
+	uint32_t size[3];
+	double resolution;
+	double origin[3];
+	char robot_name[NAME_LENGTH];
+	char group[NAME_LENGTH];
+	char link[NAME_LENGTH];
+	double offset_translation[3];
+	double offset_rotation[4];  // quaternion (x, y, z, w)
+};
+
+void copyName(char* dest, const std::string& name) {
+	if (name.size() >= NAME_LENGTH)
+		throw std::runtime_error("name too long for reachability map: " + name);
+	std::memset(dest, 0, NAME_LENGTH);
+	std::memcpy(dest, name.data(), name.size());
+}
+
+// bit of the closest of the six axis directions
+uint8_t directionBit(const Eigen::Vector3d& direction) {
+	Eigen::Vector3d::Index axis;
+	direction.cwiseAbs().maxCoeff(&axis);
+	return static_cast<uint8_t>(1u << (2 * axis + (direction[axis] < 0.0 ? 1 : 0)));
+}
+}  // namespace
+
+ReachabilityMapPtr ReachabilityMap::generate(const moveit::core::RobotModelConstPtr& robot_model,
+                                             const std::string& group, const std::string& link,
+                                             const Eigen::Isometry3d& offset, double resolution, size_t samples,
+                                             uint32_t seed) {
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group);
+	if (!jmg)
+		throw std::runtime_error("unknown group: " + group);
+	const moveit::core::LinkModel* link_model = robot_model->getLinkModel(link);
+	if (!link_model)
+		throw std::runtime_error("unknown link: " + link);
+	if (resolution <= 0.0 || samples == 0)
+		throw std::runtime_error("reachability map requires a positive resolution and number of samples");
+
+	// sample poses of the frame w.r.t. the root link
+	moveit::core::RobotState state(robot_model);
+	state.setToDefaultValues();
+	random_numbers::RandomNumberGenerator rng(seed);
+	std::vector<Eigen::Vector3d> positions;
+	std::vector<uint8_t> directions;
+	positions.reserve(samples);
+	directions.reserve(samples);
+	Eigen::Vector3d lower = Eigen::Vector3d::Constant(std::numeric_limits<double>::infinity());
+	Eigen::Vector3d upper = -lower;
+	for (size_t i = 0; i < samples; ++i) {
+		state.setToRandomPositions(jmg, rng);
+		state.updateLinkTransforms();
+		const Eigen::Isometry3d pose = state.getGlobalLinkTransform(robot_model->getRootLink()).inverse() *
+		                               state.getGlobalLinkTransform(link_model) * offset;
+		positions.push_back(pose.translation());
+		directions.push_back(directionBit(pose.linear().col(2)));
+		lower = lower.cwiseMin(pose.translation());
+		upper = upper.cwiseMax(pose.translation());
+	}
+
+	ReachabilityMapPtr map(new ReachabilityMap());
+	map->robot_name_ = robot_model->getName();
+	map->group_ = group;
+	map->link_ = link;
+	map->offset_ = offset;
+	map->resolution_ = resolution;
+	map->origin_ = lower;
+	for (int i = 0; i < 3; ++i)
+		map->size_[i] = static_cast<uint32_t>(std::floor((upper[i] - lower[i]) / resolution)) + 1;
+	const size_t num_voxels = size_t(map->size_[0]) * map->size_[1] * map->size_[2];
+
+	// count hits per voxel
+	std::vector<uint32_t> counts(num_voxels, 0);
+	map->storage_.assign(2 * num_voxels, 0);
+	for (size_t i = 0; i < samples; ++i) {
+		const Eigen::Vector3d cell = ((positions[i] - lower) / resolution).array().floor();
+		const size_t index = (size_t(cell[0]) * map->size_[1] + size_t(cell[1])) * map->size_[2] + size_t(cell[2]);
+		++counts[index];
+		map->storage_[2 * index + 1] |= directions[i];
+	}
+	const uint32_t max_count = *std::max_element(counts.begin(), counts.end());
+	for (size_t index = 0; index < num_voxels; ++index)
+		if (counts[index])  // reached voxels have a score of at least 1
+			map->storage_[2 * index] = static_cast<uint8_t>(std::max(1.0, std::round(255.0 * counts[index] / max_count)));
+	map->data_ = map->storage_.data();
+	return map;
+}
+
+ReachabilityMapConstPtr ReachabilityMap::load(const std::string& filename) {
+	int fd = ::open(filename.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw std::runtime_error("cannot open reachability map: " + filename);
+	struct stat info;
+	if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FileHeader)) {
+		::close(fd);
+		throw std::runtime_error("invalid reachability map: " + filename);
+	}
+	void* mapping = ::mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);  // the mapping stays valid
+	if (mapping == MAP_FAILED)
+		throw std::runtime_error("cannot map reachability map: " + filename);
+
+	ReachabilityMapPtr map(new ReachabilityMap());
+	map->mapping_ = mapping;
+	map->mapping_size_ = info.st_size;
+
+	FileHeader header;
+	std::memcpy(&header, mapping, sizeof(header));
+	const size_t num_voxels = size_t(header.size[0]) * header.size[1] * header.size[2];
+	if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+	    map->mapping_size_ != sizeof(FileHeader) + 2 * num_voxels)
+		throw std::runtime_error("invalid reachability map: " + filename);
+
+	map->robot_name_ = std::string(header.robot_name, strnlen(header.robot_name, NAME_LENGTH));
+	map->group_ = std::string(header.group, strnlen(header.group, NAME_LENGTH));
+	map->link_ = std::string(header.link, strnlen(header.link, NAME_LENGTH));
+	map->offset_ = Eigen::Translation3d(header.offset_translation[0], header.offset_translation[1],
+	                                    header.offset_translation[2]) *
+	               Eigen::Quaterniond(header.offset_rotation[3], header.offset_rotation[0], header.offset_rotation[1],
+	                                  header.offset_rotation[2])
+	                   .normalized();
+	map->resolution_ = header.resolution;
+	map->origin_ = Eigen::Vector3d(header.origin[0], header.origin[1], header.origin[2]);
+	std::copy(std::begin(header.size), std::end(header.size), map->size_);
+	map->data_ = static_cast<const uint8_t*>(mapping) + sizeof(FileHeader);
+	return map;
+}
+
+void ReachabilityMap::save(const std::string& filename) const {
+	FileHeader header;
+	std::memset(&header, 0, sizeof(header));
+	std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+	header.version = VERSION;
+	std::copy(std::begin(size_), std::end(size_), header.size);
+	header.resolution = resolution_;
+	for (int i = 0; i < 3; ++i)
+		header.origin[i] = origin_[i];
+	copyName(header.robot_name, robot_name_);
+	copyName(header.group, group_);
+	copyName(header.link, link_);
+	const Eigen::Quaterniond rotation(offset_.linear());
+	const double quaternion[4] = { rotation.x(), rotation.y(), rotation.z(), rotation.w() };
+	std::copy(std::begin(quaternion), std::end(quaternion), header.offset_rotation);
+	for (int i = 0; i < 3; ++i)
+		header.offset_translation[i] = offset_.translation()[i];
+
+	std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+	file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(data_), 2 * size_t(size_[0]) * size_[1] * size_[2]);
+	if (!file)
+		throw std::runtime_error("failed to write reachability map: " + filename);
+}
+
+ReachabilityMap::~ReachabilityMap() {
+	if (mapping_)
+		::munmap(mapping_, mapping_size_);
+}
+
+bool ReachabilityMap::matches(const std::string& robot_name, const std::string& group, const std::string& link,
+                              const Eigen::Isometry3d& offset) const {
+	if (robot_name != robot_name_ || group != group_ || link != link_)
+		return false;
+	const Eigen::Isometry3d delta = offset_.inverse() * offset;
+	return delta.translation().norm() < 1e-6 && Eigen::AngleAxisd(delta.linear()).angle() < 1e-6;
+}
+
+double ReachabilityMap::score(const Eigen::Isometry3d& pose) const {
+	const Eigen::Vector3d cell = ((pose.translation() - origin_) / resolution_).array().floor();
+	for (int i = 0; i < 3; ++i)
+		if (!(cell[i] >= 0.0 && cell[i] < size_[i]))  // outside grid (or NaN)
+			return 0.0;
+	const size_t index = (size_t(cell[0]) * size_[1] + size_t(cell[1])) * size_[2] + size_t(cell[2]);
+	if (!(data_[2 * index + 1] & directionBit(pose.linear().col(2))))
+		return 0.0;
+	return data_[2 * index] / 255.0;
+}
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
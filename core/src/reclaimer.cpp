@@ -0,0 +1,99 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+/* Desc:    Background thread destroying retired objects off the critical path
+ */
+
+#include <moveit/task_constructor/reclaimer.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+Reclaimer::~Reclaimer() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	if (worker_.joinable())
+		worker_.join();  // worker drains the queue before stopping
+}
+
+Reclaimer& Reclaimer::global() {
+	// Leaked intentionally: retired objects might reference other static objects, and tasks might retire
+	// their graphs during static destruction, both of which must not race with destroying the instance.
+	static Reclaimer* instance = new Reclaimer();
+	return *instance;
+}
+
+void Reclaimer::push(std::unique_ptr<Garbage> garbage) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		queue_.push_back(std::move(garbage));
+		++pending_;
+		if (!worker_.joinable())
+			worker_ = std::thread(&Reclaimer::work, this);
+	}
+	cv_.notify_one();
+}
+
+void Reclaimer::work() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	while (true) {
+		cv_.wait(lock, [this] { return stop_ || !queue_.empty(); });
+		if (queue_.empty())
+			return;  // stop_ requested and everything destroyed
+		std::unique_ptr<Garbage> garbage = std::move(queue_.front());
+		queue_.pop_front();
+		lock.unlock();
+		garbage.reset();  // destroy outside the lock
+		lock.lock();
+		--pending_;
+		done_cv_.notify_all();
+	}
+}
+
+void Reclaimer::wait() {
+	std::unique_lock<std::mutex> lock(mutex_);
+	done_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+size_t Reclaimer::pending() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return pending_;
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,183 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Recycling of RobotState instances for trajectory waypoints
+ */
+
+#include <moveit/task_constructor/robot_state_pool.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <algorithm>
+#include <cassert>
+#include <map>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+// returns a released state to its pool, keeping the pool alive while the state exists
+struct RobotStatePool::Recycler
+{
+	RobotStatePoolPtr pool;
+	void operator()(moveit::core::RobotState* state) const noexcept { pool->release(state); }
+};
+
+RobotStatePoolPtr RobotStatePool::get(const moveit::core::RobotModelConstPtr& robot_model) {
+	static std::mutex mutex;
+	static std::map<const moveit::core::RobotModel*, std::weak_ptr<RobotStatePool>> pools;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (auto it = pools.begin(); it != pools.end();)  // forget expired pools
+		it = it->second.expired() ? pools.erase(it) : std::next(it);
+
+	std::weak_ptr<RobotStatePool>& entry = pools[robot_model.get()];
+	RobotStatePoolPtr pool = entry.lock();
+	if (!pool) {
+		pool.reset(new RobotStatePool(robot_model.get()));
+		entry = pool;
+	}
+	return pool;
+}
+
+RobotStatePool::RobotStatePool(const moveit::core::RobotModel* robot_model)
+  : robot_model_(robot_model), arena_(std::make_shared<Arena>()) {}
+
+RobotStatePool::~RobotStatePool() {
+	clear();
+}
+
+namespace {
+void deleteStates(const std::vector<moveit::core::RobotState*>& states) {
+	for (moveit::core::RobotState* state : states)
+		delete state;
+}
+}  // namespace
+
+moveit::core::RobotStatePtr RobotStatePool::copy(const moveit::core::RobotState& state) {
+	assert(state.getRobotModel().get() == robot_model_);
+	moveit::core::RobotState* result = nullptr;
+	std::vector<moveit::core::RobotState*> excess;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!free_.empty()) {
+			result = free_.back();
+			free_.pop_back();
+			unused_ = std::min(unused_, free_.size());
+		}
+		shrinkPeriodically(excess);
+	}
+	deleteStates(excess);
+	if (result)
+		*result = state;  // copies into the existing buffer
+	else
+		result = new moveit::core::RobotState(state);
+	return moveit::core::RobotStatePtr(result, Recycler{ shared_from_this() },
+	                                   ArenaAllocator<moveit::core::RobotState>(arena_));
+}
+
+void RobotStatePool::release(moveit::core::RobotState* state) noexcept {
+	std::vector<moveit::core::RobotState*> excess;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (free_.size() < capacity_) {
+			state->clearAttachedBodies();  // don't keep attached bodies alive
+			free_.push_back(state);
+			state = nullptr;
+		}
+		shrinkPeriodically(excess);
+	}
+	delete state;
+	deleteStates(excess);
+}
+
+void RobotStatePool::shrink(std::vector<moveit::core::RobotState*>& excess) {
+	// states below the low-water mark of free_ were idle during the whole period
+	excess.insert(excess.end(), free_.begin(), free_.begin() + unused_);
+	free_.erase(free_.begin(), free_.begin() + unused_);
+	unused_ = free_.size();
+	last_shrink_ = std::chrono::steady_clock::now();
+}
+
+void RobotStatePool::shrinkPeriodically(std::vector<moveit::core::RobotState*>& excess) {
+	if (std::chrono::steady_clock::now() - last_shrink_ >= std::chrono::seconds(1))
+		shrink(excess);
+}
+
+void RobotStatePool::shrink() {
+	std::vector<moveit::core::RobotState*> excess;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		shrink(excess);
+	}
+	deleteStates(excess);
+}
+
+void RobotStatePool::setCapacity(size_t capacity) {
+	std::vector<moveit::core::RobotState*> excess;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		capacity_ = capacity;
+		if (free_.size() > capacity_) {
+			excess.assign(free_.begin() + capacity_, free_.end());
+			free_.resize(capacity_);
+			unused_ = std::min(unused_, free_.size());
+		}
+	}
+	deleteStates(excess);
+}
+
+size_t RobotStatePool::capacity() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return capacity_;
+}
+
+size_t RobotStatePool::available() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return free_.size();
+}
+
+void RobotStatePool::clear() {
+	std::vector<moveit::core::RobotState*> states;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		states.swap(free_);
+		unused_ = 0;
+	}
+	deleteStates(states);
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
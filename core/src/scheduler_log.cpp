@@ -0,0 +1,397 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Binary ring-buffer log of scheduling decisions during Task::plan()
+ */
+
+#include <moveit/task_constructor/scheduler_log.h>
+#include <moveit/task_constructor/container.h>
+#include <moveit/task_constructor/storage.h>
+
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+thread_local SchedulerLog* current_log = nullptr;
+thread_local SchedulerLog::Compute* current_compute = nullptr;
+
+const char MAGIC[8] = { 'M', 'T', 'C', 'S', 'L', 'O', 'G', '1' };
+
+uint16_t saturate(size_t value) {
+	return static_cast<uint16_t>(std::min<size_t>(value, std::numeric_limits<uint16_t>::max()));
+}
+
+template <typename T>
+void write(std::ostream& os, const T& value) {
+	os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+void read(std::istream& is, T& value) {
+	if (!is.read(reinterpret_cast<char*>(&value), sizeof(T)))
+		throw std::runtime_error("SchedulerLog: truncated file");
+}
+
+// all existing logs, forgetting released states (leaked, as states might be released during static destruction)
+struct Registry
+{
+	std::mutex mutex;
+	std::vector<SchedulerLog*> logs;
+	std::atomic<size_t> size{ 0 };  // checked without locking: states are released frequently
+};
+Registry& registry() {
+	static Registry* instance = new Registry();
+	return *instance;
+}
+}  // namespace
+
+constexpr size_t SchedulerLog::DEFAULT_CAPACITY;
+
+SchedulerLog::Activation::Activation(SchedulerLog* log) : previous_(current_log) {
+	current_log = log;
+}
+
+SchedulerLog::Activation::~Activation() {
+	current_log = previous_;
+}
+
+SchedulerLog::Compute::Compute(const Stage& stage) : log_(current_log), parent_(nullptr) {
+	if (!log_)
+		return;
+	parent_ = current_compute;
+	current_compute = this;
+	std::memset(&record_, 0, sizeof(record_));
+	record_.kind = dynamic_cast<const ContainerBase*>(&stage) ? CONTAINER : GENERATE;
+	record_.depth = parent_ ? static_cast<uint8_t>(std::min(parent_->record_.depth + 1, 255)) : 0;
+	std::lock_guard<std::mutex> lock(log_->mutex_);
+	record_.iteration = log_->iteration_;
+	record_.stage = log_->stageIndex(stage);
+	start_ = Clock::now();
+}
+
+void SchedulerLog::Compute::finish(size_t solutions, size_t failures) {
+	if (!log_)
+		return;
+	record_.solutions = saturate(solutions);
+	record_.failures = saturate(failures);
+}
+
+SchedulerLog::Compute::~Compute() {
+	if (!log_)
+		return;
+	const Clock::time_point now = Clock::now();
+	record_.time = std::chrono::duration_cast<std::chrono::nanoseconds>(start_ - log_->origin_).count();
+	record_.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start_).count();
+	current_compute = parent_;
+	std::lock_guard<std::mutex> lock(log_->mutex_);
+	log_->append(record_);
+}
+
+SchedulerLog::SchedulerLog(size_t capacity) : origin_(Clock::now()), capacity_(std::max<size_t>(capacity, 1)) {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.logs.push_back(this);
+	r.size = r.logs.size();
+}
+
+SchedulerLog::~SchedulerLog() {
+	Registry& r = registry();
+	std::lock_guard<std::mutex> lock(r.mutex);
+	r.logs.erase(std::remove(r.logs.begin(), r.logs.end(), this), r.logs.end());
+	r.size = r.logs.size();
+}
+
+SchedulerLog* SchedulerLog::current() {
+	return current_log;
+}
+
+void SchedulerLog::job(Kind kind, const InterfaceState* start, const InterfaceState* end) {
+	Compute* compute = current_compute;
+	if (!compute || compute->log_ != current_log)
+		return;
+	std::lock_guard<std::mutex> lock(compute->log_->mutex_);
+	compute->record_.kind = kind;
+	compute->record_.states[0] = compute->log_->stateId(start);
+	compute->record_.states[1] = compute->log_->stateId(end);
+}
+
+void SchedulerLog::status(const InterfaceState* state, unsigned int status) {
+	SchedulerLog* log = current_log;
+	if (!log)
+		return;
+	const Clock::time_point now = Clock::now();
+	std::lock_guard<std::mutex> lock(log->mutex_);
+	auto it = log->states_.find(state);
+	if (it == log->states_.end())
+		return;  // never taken as job
+	Record record;
+	std::memset(&record, 0, sizeof(record));
+	record.iteration = log->iteration_;
+	record.time = std::chrono::duration_cast<std::chrono::nanoseconds>(now - log->origin_).count();
+	record.states[0] = it->second;
+	record.kind = STATUS;
+	record.status = static_cast<uint8_t>(status);
+	log->append(record);
+}
+
+void SchedulerLog::released(const InterfaceState* state) {
+	Registry& r = registry();
+	if (r.size == 0)
+		return;
+	std::lock_guard<std::mutex> registry_lock(r.mutex);
+	for (SchedulerLog* log : r.logs) {
+		std::lock_guard<std::mutex> lock(log->mutex_);
+		log->states_.erase(state);
+	}
+}
+
+void SchedulerLog::nextIteration() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	++iteration_;
+}
+
+void SchedulerLog::forgetStates() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	states_.clear();
+}
+
+size_t SchedulerLog::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return records_.size();
+}
+
+size_t SchedulerLog::dropped() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return dropped_;
+}
+
+void SchedulerLog::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	records_.clear();
+	head_ = 0;
+	dropped_ = 0;
+}
+
+std::vector<SchedulerLog::Record> SchedulerLog::records() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::vector<Record> result;
+	result.reserve(records_.size());
+	result.insert(result.end(), records_.begin() + head_, records_.end());
+	result.insert(result.end(), records_.begin(), records_.begin() + head_);
+	return result;
+}
+
+std::vector<std::string> SchedulerLog::stageNames() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return stage_names_;
+}
+
+void SchedulerLog::append(const Record& record) {
+	if (records_.size() < capacity_) {
+		records_.push_back(record);
+		return;
+	}
+	records_[head_] = record;
+	head_ = (head_ + 1) % capacity_;
+	++dropped_;
+}
+
+uint32_t SchedulerLog::stageIndex(const Stage& stage) {
+	auto it = stages_.find(&stage);
+	if (it != stages_.end())
+		return it->second;
+	const uint32_t index = stage_names_.size();
+	stage_names_.push_back(stage.name());
+	stages_.emplace(&stage, index);
+	return index;
+}
+
+uint32_t SchedulerLog::stateId(const InterfaceState* state) {
+	if (!state)
+		return 0;
+	auto inserted = states_.emplace(state, next_state_id_);
+	if (inserted.second)
+		++next_state_id_;
+	return inserted.first->second;
+}
+
+void SchedulerLog::save(const std::string& path) const {
+	const std::vector<Record> all = records();
+	const std::vector<std::string> names = stageNames();
+	std::ofstream os(path, std::ios::binary | std::ios::trunc);
+	if (!os)
+		throw std::runtime_error(fmt::format("SchedulerLog: failed to open '{}' for writing", path));
+	os.write(MAGIC, sizeof(MAGIC));
+	write(os, static_cast<uint64_t>(dropped()));
+	write(os, static_cast<uint32_t>(names.size()));
+	for (const std::string& name : names) {
+		write(os, static_cast<uint32_t>(name.size()));
+		os.write(name.data(), name.size());
+	}
+	write(os, static_cast<uint64_t>(all.size()));
+	os.write(reinterpret_cast<const char*>(all.data()), all.size() * sizeof(Record));
+	if (!os)
+		throw std::runtime_error(fmt::format("SchedulerLog: failed to write '{}'", path));
+}
+
+void SchedulerLog::load(const std::string& path) {
+	std::ifstream is(path, std::ios::binary);
+	if (!is)
+		throw std::runtime_error(fmt::format("SchedulerLog: failed to open '{}'", path));
+	char magic[sizeof(MAGIC)];
+	if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0)
+		throw std::runtime_error(fmt::format("SchedulerLog: '{}' is not a scheduler log", path));
+
+	uint64_t dropped;
+	read(is, dropped);
+	uint32_t num_names;
+	read(is, num_names);
+	std::vector<std::string> names(num_names);
+	for (std::string& name : names) {
+		uint32_t length;
+		read(is, length);
+		name.resize(length);
+		if (!is.read(&name[0], length))
+			throw std::runtime_error("SchedulerLog: truncated file");
+	}
+	uint64_t num_records;
+	read(is, num_records);
+	std::vector<Record> records;
+	records.reserve(std::min<uint64_t>(num_records, capacity_));
+	for (uint64_t i = 0; i < num_records; ++i) {
+		records.emplace_back();
+		read(is, records.back());
+		if (records.back().kind != STATUS && records.back().stage >= names.size())
+			throw std::runtime_error("SchedulerLog: invalid stage index");
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	capacity_ = std::max(capacity_, records.size());
+	records_ = std::move(records);
+	head_ = 0;
+	dropped_ = dropped;
+	stage_names_ = std::move(names);
+	stages_.clear();
+	states_.clear();
+}
+
+std::vector<SchedulerLog::StageSummary> SchedulerLog::summarize() const {
+	const std::vector<Record> all = records();
+	std::vector<StageSummary> result;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		for (const std::string& name : stage_names_) {
+			result.emplace_back();
+			result.back().stage = name;
+		}
+	}
+
+	// final status of states, ENABLED (0) if it never changed
+	std::unordered_map<uint32_t, uint8_t> status;
+	for (const Record& r : all)
+		if (r.kind == STATUS)
+			status[r.states[0]] = r.status;
+	auto pruned = [&status](uint32_t id) {
+		auto it = status.find(id);
+		return id != 0 && it != status.end() && it->second != InterfaceState::ENABLED;
+	};
+
+	std::vector<bool> seen(result.size(), false);
+	for (const Record& r : all) {
+		if (r.kind == STATUS || r.stage >= result.size())
+			continue;
+		StageSummary& s = result[r.stage];
+		seen[r.stage] = true;
+		const double duration = r.duration * 1e-9;
+		s.container = r.kind == CONTAINER;
+		++s.computes;
+		s.time += duration;
+		s.solutions += r.solutions;
+		s.failures += r.failures;
+		if (r.kind != CONTAINER && (pruned(r.states[0]) || pruned(r.states[1]))) {
+			++s.wasted_computes;
+			s.wasted_time += duration;
+		}
+	}
+	// drop stages whose records were overwritten
+	size_t kept = 0;
+	for (size_t i = 0; i < result.size(); ++i) {
+		if (!seen[i])
+			continue;
+		if (kept != i)
+			result[kept] = std::move(result[i]);
+		++kept;
+	}
+	result.resize(kept);
+	return result;
+}
+
+void SchedulerLog::writeSummary(std::ostream& os) const {
+	const std::vector<StageSummary> summary = summarize();
+	size_t width = 5;
+	for (const StageSummary& s : summary)
+		width = std::max(width, s.stage.size());
+
+	os << fmt::format("{:<{}} {:>9} {:>11} {:>9} {:>9} {:>9} {:>11} {:>7}\n", "stage", width, "computes", "time [s]",
+	                  "solutions", "failures", "wasted", "wasted [s]", "wasted%");
+	double total = 0.0, wasted = 0.0;
+	for (const StageSummary& s : summary) {
+		os << fmt::format("{:<{}} {:>9} {:>11.6f} {:>9} {:>9} {:>9} {:>11.6f} {:>6.1f}%\n", s.stage, width, s.computes,
+		                  s.time, s.solutions, s.failures, s.wasted_computes, s.wasted_time,
+		                  s.time > 0.0 ? 100.0 * s.wasted_time / s.time : 0.0);
+		if (!s.container) {  // containers enclose the computes of their children
+			total += s.time;
+			wasted += s.wasted_time;
+		}
+	}
+	os << fmt::format("compute time of stages: {:.6f}s, wasted on pruned branches: {:.6f}s ({:.1f}%)\n", total, wasted,
+	                  total > 0.0 ? 100.0 * wasted / total : 0.0);
+	if (const size_t lost = dropped())
+		os << fmt::format("{} oldest records were overwritten\n", lost);
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
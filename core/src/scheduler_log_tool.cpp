@@ -0,0 +1,96 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Report the scheduling decisions of a SchedulerLog file, e.g. compute time wasted on pruned branches
+ */
+
+#include <moveit/task_constructor/scheduler_log.h>
+
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+using moveit::task_constructor::utils::SchedulerLog;
+
+namespace {
+const char* kindName(uint8_t kind) {
+	static const char* const NAMES[] = { "generate", "forward", "backward", "connect", "container", "status" };
+	return kind <= SchedulerLog::STATUS ? NAMES[kind] : "unknown";
+}
+
+void writeRecords(const SchedulerLog& log, std::ostream& os) {
+	const std::vector<std::string> stages = log.stageNames();
+	os << "iteration,time_ns,duration_ns,stage,kind,start,end,solutions,failures,status,depth\n";
+	for (const SchedulerLog::Record& r : log.records()) {
+		const bool status = r.kind == SchedulerLog::STATUS;
+		os << r.iteration << ',' << r.time << ',' << r.duration << ',' << (status ? "" : stages[r.stage]) << ','
+		   << kindName(r.kind) << ',' << r.states[0] << ',' << r.states[1] << ',' << r.solutions << ',' << r.failures
+		   << ',' << static_cast<unsigned>(r.status) << ',' << static_cast<unsigned>(r.depth) << '\n';
+	}
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+	bool records = false;
+	const char* path = nullptr;
+	bool valid = true;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--records") == 0)
+			records = true;
+		else if (!path && argv[i][0] != '-')
+			path = argv[i];
+		else
+			valid = false;
+	}
+	if (!valid || !path) {
+		std::cerr << "usage: " << argv[0] << " [--records] <log file>\n"
+		          << "  Summarize scheduling decisions per stage, or write all records as CSV with --records.\n";
+		return 2;
+	}
+
+	SchedulerLog log;
+	try {
+		log.load(path);
+	} catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return 1;
+	}
+	if (records)
+		writeRecords(log, std::cout);
+	else
+		log.writeSummary(std::cout);
+	return 0;
+}
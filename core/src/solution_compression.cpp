@@ -0,0 +1,322 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Compact encoding of Solution messages for remote introspection
+ */
+
+#include <moveit/task_constructor/solution_compression.h>
+
+#include <ros/serialization.h>
+#include <zlib.h>
+
+#include <cmath>
+#include <limits>
+#include <map>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace ser = ros::serialization;
+using moveit_task_constructor_msgs::CompressedSolution;
+using moveit_task_constructor_msgs::Solution;
+using moveit_task_constructor_msgs::SolutionInfo;
+
+namespace {
+// quantized values need to stay well within int32 range, such that differences don't overflow either
+const double MAX_QUANTIZED = std::numeric_limits<int32_t>::max() / 2;
+
+/// Everything stored in CompressedSolution::data
+struct Payload
+{
+	/// solution with markers, and points of quantized trajectories removed
+	Solution solution;
+	/// unique markers of all sub solutions / trajectories
+	std::vector<visualization_msgs::Marker> markers;
+	/// for each SolutionInfo (sub solutions first, then sub trajectories): number of markers, followed by indices
+	std::vector<uint32_t> marker_refs;
+	/// for each sub trajectory: quantized joint trajectory, empty if stored exactly in solution
+	std::vector<std::vector<int32_t>> trajectories;
+};
+
+template <typename F>
+void forEachInfo(Solution& msg, F&& f) {
+	for (auto& sub : msg.sub_solution)
+		f(sub.info);
+	for (auto& sub : msg.sub_trajectory)
+		f(sub.info);
+}
+
+/// move markers of all infos into a table of unique markers
+void deduplicateMarkers(Payload& p) {
+	std::unordered_map<std::string, uint32_t> index;
+	std::string key;
+	forEachInfo(p.solution, [&](SolutionInfo& info) {
+		p.marker_refs.push_back(info.markers.size());
+		for (auto& marker : info.markers) {
+			// identify identical markers by their serialization
+			key.resize(ser::serializationLength(marker));
+			ser::OStream stream(reinterpret_cast<uint8_t*>(&key[0]), key.size());
+			ser::serialize(stream, marker);
+
+			auto it = index.emplace(key, p.markers.size()).first;
+			if (it->second == p.markers.size())
+				p.markers.push_back(std::move(marker));
+			p.marker_refs.push_back(it->second);
+		}
+		info.markers.clear();
+	});
+}
+
+void restoreMarkers(Payload& p) {
+	auto ref = p.marker_refs.cbegin(), end = p.marker_refs.cend();
+	auto next = [&]() {
+		if (ref == end)
+			throw std::runtime_error("compressed solution: truncated marker references");
+		return *ref++;
+	};
+	forEachInfo(p.solution, [&](SolutionInfo& info) {
+		info.markers.resize(next());
+		for (auto& marker : info.markers) {
+			uint32_t i = next();
+			if (i >= p.markers.size())
+				throw std::runtime_error("compressed solution: invalid marker reference");
+			marker = p.markers[i];
+		}
+	});
+}
+
+/// drop joint values of scene diffs, which are unchanged w.r.t. the previous scene
+void deltaEncodeJointStates(Solution& msg) {
+	std::map<std::string, double> current;
+	auto update = [&current](const sensor_msgs::JointState& state) {
+		for (size_t i = 0; i < state.name.size() && i < state.position.size(); ++i)
+			current[state.name[i]] = state.position[i];
+	};
+	update(msg.start_scene.robot_state.joint_state);
+
+	for (auto& sub : msg.sub_trajectory) {
+		auto& diff = sub.scene_diff;
+		auto& state = diff.robot_state.joint_state;
+		if (!diff.is_diff || !diff.robot_state.is_diff || state.name.size() != state.position.size() ||
+		    !state.velocity.empty() || !state.effort.empty()) {
+			update(state);  // state cannot be reduced
+			continue;
+		}
+
+		size_t kept = 0;
+		for (size_t i = 0; i < state.name.size(); ++i) {
+			auto it = current.find(state.name[i]);
+			if (it != current.end() && it->second == state.position[i])
+				continue;
+			current[state.name[i]] = state.position[i];
+			state.name[kept] = std::move(state.name[i]);
+			state.position[kept] = state.position[i];
+			++kept;
+		}
+		state.name.resize(kept);
+		state.position.resize(kept);
+	}
+}
+
+using Point = trajectory_msgs::JointTrajectoryPoint;
+using Field = std::vector<double> Point::*;
+const Field FIELDS[] = { &Point::positions, &Point::velocities, &Point::accelerations, &Point::effort };
+
+/** Encode points of t as: number of points, dimensions of all fields, times, and values of all fields,
+ * each as differences to the previous waypoint in multiples of the corresponding resolution.
+ * Returns an empty vector if t cannot be quantized. */
+std::vector<int32_t> quantize(const trajectory_msgs::JointTrajectory& t, double resolution, double time_resolution) {
+	std::vector<int32_t> result;
+	if (t.points.empty())
+		return result;
+
+	result.push_back(t.points.size());
+	for (Field field : FIELDS) {
+		size_t dim = (t.points.front().*field).size();
+		for (const Point& p : t.points)
+			if ((p.*field).size() != dim)
+				return {};  // inconsistent dimensions
+		result.push_back(dim);
+	}
+
+	bool valid = true;
+	auto append = [&](double value, double step, int32_t& last) {
+		double q = std::round(value / step);
+		if (!(std::abs(q) <= MAX_QUANTIZED)) {  // also catches NaN
+			valid = false;
+			return;
+		}
+		result.push_back(static_cast<int32_t>(q) - last);
+		last = static_cast<int32_t>(q);
+	};
+
+	int32_t last = 0;
+	for (const Point& p : t.points)
+		append(p.time_from_start.toSec(), time_resolution, last);
+	for (Field field : FIELDS) {
+		for (size_t j = 0, dim = (t.points.front().*field).size(); j < dim; ++j) {
+			last = 0;
+			for (const Point& p : t.points)
+				append((p.*field)[j], resolution, last);
+		}
+	}
+	if (!valid)
+		result.clear();
+	return result;
+}
+
+void dequantize(const std::vector<int32_t>& data, double resolution, double time_resolution,
+                trajectory_msgs::JointTrajectory& t) {
+	const size_t header = 1 + std::extent<decltype(FIELDS)>::value;
+	if (data.size() < header || data[0] < 0)
+		throw std::runtime_error("compressed solution: invalid trajectory");
+
+	size_t num = data[0];
+	size_t values = 1;  // time
+	for (size_t f = 0; f < std::extent<decltype(FIELDS)>::value; ++f) {
+		if (data[1 + f] < 0)
+			throw std::runtime_error("compressed solution: invalid trajectory");
+		values += data[1 + f];
+	}
+	if (data.size() != header + num * values)
+		throw std::runtime_error("compressed solution: invalid trajectory");
+
+	t.points.resize(num);
+	for (size_t f = 0; f < std::extent<decltype(FIELDS)>::value; ++f)
+		for (Point& p : t.points)
+			(p.*FIELDS[f]).resize(data[1 + f]);
+
+	auto it = data.cbegin() + header;
+	int64_t acc = 0;
+	for (Point& p : t.points)
+		p.time_from_start = ros::Duration((acc += *it++) * time_resolution);
+	for (Field field : FIELDS) {
+		for (size_t j = 0, dim = (t.points.front().*field).size(); j < dim; ++j) {
+			acc = 0;
+			for (Point& p : t.points)
+				(p.*field)[j] = (acc += *it++) * resolution;
+		}
+	}
+}
+}  // namespace
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
+
+namespace ros {
+namespace serialization {
+template <>
+struct Serializer<moveit::task_constructor::utils::Payload>
+{
+	template <typename Stream, typename T>
+	inline static void allInOne(Stream& stream, T p) {
+		stream.next(p.solution);
+		stream.next(p.markers);
+		stream.next(p.marker_refs);
+		stream.next(p.trajectories);
+	}
+	ROS_DECLARE_ALLINONE_SERIALIZER
+};
+}  // namespace serialization
+}  // namespace ros
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+void compress(const Solution& msg, CompressedSolution& compressed, const SolutionCompression& options) {
+	Payload p;
+	p.solution = msg;
+	deduplicateMarkers(p);
+	deltaEncodeJointStates(p.solution);
+
+	const bool quantized = options.resolution > 0.0 && options.time_resolution > 0.0;
+	p.trajectories.resize(p.solution.sub_trajectory.size());
+	if (quantized) {
+		auto traj = p.trajectories.begin();
+		for (auto& sub : p.solution.sub_trajectory) {
+			auto& t = sub.trajectory.joint_trajectory;
+			*traj = quantize(t, options.resolution, options.time_resolution);
+			if (!traj->empty())
+				t.points.clear();
+			++traj;
+		}
+	}
+
+	std::vector<uint8_t> buffer(ser::serializationLength(p));
+	ser::OStream stream(buffer.data(), buffer.size());
+	ser::serialize(stream, p);
+
+	uLongf size = compressBound(buffer.size());
+	compressed.data.resize(size);
+	if (compress2(compressed.data.data(), &size, buffer.data(), buffer.size(), options.level) != Z_OK)
+		throw std::runtime_error("failed to compress solution");
+	compressed.data.resize(size);
+
+	compressed.task_id = msg.task_id;
+	compressed.resolution = quantized ? options.resolution : 0.0;
+	compressed.time_resolution = quantized ? options.time_resolution : 0.0;
+	compressed.size = buffer.size();
+}
+
+void decompress(const CompressedSolution& compressed, Solution& msg) {
+	std::vector<uint8_t> buffer(compressed.size);
+	uLongf size = buffer.size();
+	if (uncompress(buffer.data(), &size, compressed.data.data(), compressed.data.size()) != Z_OK ||
+	    size != buffer.size())
+		throw std::runtime_error("compressed solution: corrupt data");
+
+	Payload p;
+	ser::IStream stream(buffer.data(), buffer.size());
+	ser::deserialize(stream, p);  // throws ros::serialization::StreamOverrunException, a std::runtime_error
+
+	restoreMarkers(p);
+	if (p.trajectories.size() != p.solution.sub_trajectory.size())
+		throw std::runtime_error("compressed solution: invalid trajectory count");
+	auto traj = p.trajectories.cbegin();
+	for (auto& sub : p.solution.sub_trajectory) {
+		if (!traj->empty())
+			dequantize(*traj, compressed.resolution, compressed.time_resolution, sub.trajectory.joint_trajectory);
+		++traj;
+	}
+	msg = std::move(p.solution);
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,194 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Reuse solutions of repetitive tasks
+ */
+
+#include <moveit/task_constructor/solution_library.h>
+#include <moveit/task_constructor/solution_store.h>
+#include <moveit/task_constructor/utils.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_state/conversions.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <boost/functional/hash.hpp>
+#include <cmath>
+#include <map>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+// hash the configured values of all properties, ignoring values inherited during init()
+void hashProperties(size_t& seed, const PropertyMap& properties, double resolution) {
+	for (const auto& pair : properties) {
+		const boost::any& value = pair.second.defaultValue();  // setValue() sets both, current and default value
+		if (value.empty())
+			continue;
+		boost::hash_combine(seed, pair.first);
+		const std::string serialized = Property::serialize(value);
+		if (!serialized.empty()) {
+			boost::hash_combine(seed, serialized);
+			continue;
+		}
+		// not serializable, e.g. joint goals
+		if (const auto* joints = boost::any_cast<std::map<std::string, double>>(&value)) {
+			for (const auto& joint : *joints) {
+				boost::hash_combine(seed, joint.first);
+				boost::hash_combine(seed, std::lround(joint.second / resolution));
+			}
+		} else
+			boost::hash_combine(seed, Property::typeName(value.type()));
+	}
+}
+}  // namespace
+
+SolutionLibrary::SolutionLibrary(double resolution) : resolution_(resolution) {}
+
+size_t SolutionLibrary::key(const Task& task, const planning_scene::PlanningScene& scene) const {
+	size_t seed = utils::worldHash(scene, resolution_);
+	boost::hash_combine(seed, task.name());
+	hashProperties(seed, task.properties(), resolution_);
+	// the stages' properties comprise e.g. their goals
+	task.stages()->traverseRecursively([this, &seed](const Stage& stage, unsigned int depth) {
+		boost::hash_combine(seed, depth);
+		boost::hash_combine(seed, stage.name());
+		hashProperties(seed, stage.properties(), resolution_);
+		return true;
+	});
+	const moveit::core::RobotState& state = scene.getCurrentState();
+	for (size_t i = 0, end = state.getVariableCount(); i != end; ++i)
+		boost::hash_combine(seed, std::lround(state.getVariablePosition(i) / resolution_));
+	return seed;
+}
+
+moveit::core::MoveItErrorCode SolutionLibrary::plan(Task& task, const planning_scene::PlanningScene& scene,
+                                                    moveit_task_constructor_msgs::Solution& solution) {
+	const size_t k = key(task, scene);
+	if (find(k, solution) && validate(solution, scene)) {
+		std::lock_guard<std::mutex> lock(mutex_);
+		++hits_;
+		return moveit::core::MoveItErrorCode::SUCCESS;
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++misses_;
+	}
+
+	moveit::core::MoveItErrorCode result = task.plan(1);
+	if (!result)
+		return result;
+	solution = moveit_task_constructor_msgs::Solution();
+	task.solutions().front()->toMsg(solution);
+	insert(k, solution);
+	return result;
+}
+
+bool SolutionLibrary::validate(const moveit_task_constructor_msgs::Solution& solution,
+                               const planning_scene::PlanningScene& scene) const {
+	// the solution needs to start from the current state
+	const moveit::core::RobotState& current = scene.getCurrentState();
+	moveit::core::RobotState start(current);
+	moveit::core::robotStateMsgToRobotState(solution.start_scene.robot_state, start);
+	for (size_t i = 0, end = current.getVariableCount(); i != end; ++i)
+		if (std::abs(start.getVariablePosition(i) - current.getVariablePosition(i)) > resolution_)
+			return false;
+
+	// all trajectories need to be valid, applying the solution's scene changes along the way
+	planning_scene::PlanningScenePtr ref = scene.diff();
+	for (const auto& sub : solution.sub_trajectory) {
+		robot_trajectory::RobotTrajectory trajectory(ref->getRobotModel(), nullptr);
+		trajectory.setRobotTrajectoryMsg(ref->getCurrentState(), sub.trajectory);
+		if (!ref->isPathValid(trajectory))
+			return false;
+		ref = ref->diff();
+		ref->setPlanningSceneDiffMsg(sub.scene_diff);
+	}
+	return true;
+}
+
+void SolutionLibrary::insert(size_t key, const moveit_task_constructor_msgs::Solution& solution) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	solutions_[key] = solution;
+}
+
+bool SolutionLibrary::find(size_t key, moveit_task_constructor_msgs::Solution& solution) const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = solutions_.find(key);
+	if (it == solutions_.end())
+		return false;
+	solution = it->second;
+	return true;
+}
+
+size_t SolutionLibrary::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return solutions_.size();
+}
+
+void SolutionLibrary::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	solutions_.clear();
+	hits_ = misses_ = 0;
+}
+
+void SolutionLibrary::save(const std::string& path) const {
+	utils::SolutionStoreWriter writer(path);
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (const auto& pair : solutions_)
+		writer.add(pair.second, 0.0, pair.first);
+	writer.close();
+}
+
+void SolutionLibrary::load(const std::string& path) {
+	utils::SolutionStore store(path);
+	for (size_t i = 0; i != store.size(); ++i) {
+		moveit_task_constructor_msgs::Solution solution;
+		store.load(i, solution);
+		insert(store.id(i), solution);
+	}
+}
+
+size_t SolutionLibrary::hits() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return hits_;
+}
+
+size_t SolutionLibrary::misses() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return misses_;
+}
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,198 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Binary file format to archive and replay solutions
+ */
+
+#include <moveit/task_constructor/solution_store.h>
+
+#include <ros/console.h>
+#include <ros/serialization.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace ser = ros::serialization;
+using namespace solution_store;
+
+namespace {
+constexpr size_t ALIGNMENT = 8;
+static_assert(sizeof(Header) % ALIGNMENT == 0 && sizeof(Entry) % ALIGNMENT == 0 && sizeof(Footer) % ALIGNMENT == 0,
+              "unexpected padding of solution store structs");
+
+std::runtime_error error(const std::string& path, const std::string& what) {
+	return std::runtime_error("solution store '" + path + "': " + what);
+}
+}  // namespace
+
+SolutionStoreWriter::SolutionStoreWriter(const std::string& path) : file_(path, std::ios::binary | std::ios::trunc) {
+	if (!file_)
+		throw error(path, std::strerror(errno));
+
+	Header header{};
+	std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+	header.version = VERSION;
+	file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+SolutionStoreWriter::~SolutionStoreWriter() {
+	if (!file_.is_open())
+		return;
+	try {
+		close();
+	} catch (const std::runtime_error& e) {
+		ROS_ERROR_STREAM_NAMED("SolutionStore", e.what());
+	}
+}
+
+void SolutionStoreWriter::pad() {
+	static const char zeros[ALIGNMENT] = {};
+	file_.write(zeros, (ALIGNMENT - offset() % ALIGNMENT) % ALIGNMENT);
+}
+
+void SolutionStoreWriter::add(const moveit_task_constructor_msgs::Solution& msg, double cost, uint64_t id) {
+	const uint32_t size = ser::serializationLength(msg);  // ROS serialization limits messages to 4GB
+	buffer_.resize(size);
+	ser::OStream stream(buffer_.data(), buffer_.size());
+	ser::serialize(stream, msg);
+
+	pad();
+	index_.push_back(Entry{ offset(), id, size, 0, cost });
+	file_.write(reinterpret_cast<const char*>(buffer_.data()), buffer_.size());
+	if (!file_)
+		throw std::runtime_error("solution store: failed to write solution");
+}
+
+uint64_t SolutionStoreWriter::offset() {
+	const std::streamoff pos = file_.tellp();
+	if (!file_ || pos < 0)
+		throw std::runtime_error("solution store: failed to write");
+	return static_cast<uint64_t>(pos);
+}
+
+void SolutionStoreWriter::close() {
+	pad();
+	Footer footer{ offset(), index_.size() };
+	file_.write(reinterpret_cast<const char*>(index_.data()), index_.size() * sizeof(Entry));
+	file_.write(reinterpret_cast<const char*>(&footer), sizeof(footer));
+	file_.close();
+	if (!file_)
+		throw std::runtime_error("solution store: failed to write index");
+}
+
+SolutionStore::SolutionStore(const std::string& path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0)
+		throw error(path, std::strerror(errno));
+
+	struct stat st;
+	if (::fstat(fd, &st) != 0) {
+		::close(fd);
+		throw error(path, std::strerror(errno));
+	}
+	if (st.st_size < static_cast<off_t>(sizeof(Header) + sizeof(Footer))) {
+		::close(fd);
+		throw error(path, "file too short");
+	}
+	if (static_cast<uintmax_t>(st.st_size) > std::numeric_limits<size_t>::max()) {
+		::close(fd);
+		throw error(path, "file too large to map");
+	}
+	length_ = static_cast<size_t>(st.st_size);
+
+	void* data = ::mmap(nullptr, length_, PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);  // the mapping stays valid
+	if (data == MAP_FAILED)
+		throw error(path, std::strerror(errno));
+	data_ = static_cast<uint8_t*>(data);
+
+	try {
+		const Header& header = *reinterpret_cast<const Header*>(data_);
+		if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0)
+			throw error(path, "not a solution store");
+		if (header.version != VERSION)
+			throw error(path, "unsupported version " + std::to_string(header.version));
+
+		// all sizes are validated by subtraction from bounds already checked, as corrupt values might overflow
+		const Footer& footer = *reinterpret_cast<const Footer*>(data_ + length_ - sizeof(Footer));
+		const uint64_t index_end = length_ - sizeof(Footer);
+		if (footer.index_offset % ALIGNMENT != 0 || footer.index_offset < sizeof(Header) ||
+		    footer.index_offset > index_end || (index_end - footer.index_offset) % sizeof(Entry) != 0 ||
+		    footer.count != (index_end - footer.index_offset) / sizeof(Entry))
+			throw error(path, "corrupt index");
+		index_ = reinterpret_cast<const Entry*>(data_ + footer.index_offset);
+		count_ = static_cast<size_t>(footer.count);  // fits, as the index is mapped
+
+		for (size_t i = 0; i != count_; ++i)
+			if (index_[i].offset < sizeof(Header) || index_[i].offset > footer.index_offset ||
+			    index_[i].size > footer.index_offset - index_[i].offset)
+				throw error(path, "corrupt index entry " + std::to_string(i));
+	} catch (...) {
+		::munmap(data_, length_);
+		throw;
+	}
+}
+
+SolutionStore::~SolutionStore() {
+	::munmap(data_, length_);
+}
+
+const Entry& SolutionStore::entry(size_t i) const {
+	if (i >= count_)
+		throw std::out_of_range("solution store: invalid index " + std::to_string(i));
+	return index_[i];
+}
+
+void SolutionStore::load(size_t i, moveit_task_constructor_msgs::Solution& msg) const {
+	const Entry& e = entry(i);
+	// IStream only reads, but requires a mutable pointer
+	ser::IStream stream(data_ + e.offset, e.size);
+	ser::deserialize(stream, msg);
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
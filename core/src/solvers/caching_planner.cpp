@@ -0,0 +1,218 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    meta planner, caching trajectories of a wrapped planner
+ */
+
+#include <moveit/task_constructor/solvers/caching_planner.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/utils.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <boost/functional/hash.hpp>
+#include <cmath>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+namespace {
+void quantize(const moveit::core::RobotState& state, const moveit::core::JointModelGroup* jmg, double resolution,
+              std::vector<long>& result) {
+	std::vector<double> positions;
+	state.copyJointGroupPositions(jmg, positions);
+	result.reserve(positions.size());
+	for (double p : positions)
+		result.push_back(std::lround(p / resolution));
+}
+
+// copy the group's joint values of a waypoint onto state
+void copyGroupWaypoint(const moveit::core::RobotState& waypoint, const moveit::core::JointModelGroup* jmg,
+                       moveit::core::RobotState& state) {
+	std::vector<double> values;
+	waypoint.copyJointGroupPositions(jmg, values);
+	state.setJointGroupPositions(jmg, values);
+	if (waypoint.hasVelocities()) {
+		waypoint.copyJointGroupVelocities(jmg, values);
+		state.setJointGroupVelocities(jmg, values);
+	}
+	if (waypoint.hasAccelerations()) {
+		waypoint.copyJointGroupAccelerations(jmg, values);
+		state.setJointGroupAccelerations(jmg, values);
+	} else if (waypoint.hasEffort()) {  // efforts share their memory with accelerations
+		for (const moveit::core::JointModel* jm : jmg->getActiveJointModels())
+			state.setJointEfforts(jm, waypoint.getJointEffort(jm));
+	}
+	state.update();
+}
+}  // namespace
+
+size_t CachingPlanner::KeyHash::operator()(const Key& key) const {
+	size_t seed = key.world_hash;
+	boost::hash_combine(seed, key.jmg);
+	boost::hash_range(seed, key.from.begin(), key.from.end());
+	boost::hash_range(seed, key.to.begin(), key.to.end());
+	return seed;
+}
+
+CachingPlanner::CachingPlanner(const PlannerInterfacePtr& planner) : planner_(planner) {
+	auto& p = properties();
+	p.declare<double>("resolution", 1e-3, "quantization of joint values and object poses for cache lookup");
+	p.declare<uint32_t>("max_entries", 1000, "maximum number of cached trajectories");
+	p.declare<bool>("warm_start", false, "keep cache across init() and reuse trajectories after world changes");
+}
+
+void CachingPlanner::init(const core::RobotModelConstPtr& robot_model) {
+	if (!planner_)
+		throw std::runtime_error("CachingPlanner: invalid planner");
+	planner_->initShared(robot_model);
+	if (!properties().get<bool>("warm_start") || robot_model != robot_model_)
+		clear();
+	robot_model_ = robot_model;
+}
+
+PlannerInterface::Result CachingPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                              const planning_scene::PlanningSceneConstPtr& to,
+                                              const moveit::core::JointModelGroup* jmg, double timeout,
+                                              robot_trajectory::RobotTrajectoryPtr& result,
+                                              const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", "CachingPlanner::plan");
+	Key key = makeKey(*from, *to, jmg);
+	if (robot_trajectory::RobotTrajectoryConstPtr cached = lookup(key)) {
+		const moveit::core::RobotState& start_state = from->getCurrentState();
+		auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+		const size_t last = cached->getWayPointCount() - 1;
+		for (size_t i = 0; i <= last; ++i) {
+			moveit::core::RobotState state(start_state);
+			copyGroupWaypoint(cached->getWayPoint(i), jmg, state);
+			// snap end points to exact start and goal positions
+			if (i == 0 || i == last) {
+				std::vector<double> positions;
+				(i == 0 ? start_state : to->getCurrentState()).copyJointGroupPositions(jmg, positions);
+				state.setJointGroupPositions(jmg, positions);
+				state.update();
+			}
+			trajectory->addSuffixWayPoint(state, cached->getWayPointDurationFromPrevious(i));
+		}
+		if (from->isPathValid(*trajectory, path_constraints, jmg->getName())) {
+			result = trajectory;
+			std::lock_guard<std::mutex> lock(mutex_);
+			++hits_;
+			return { true, "" };
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++misses_;
+	}
+	Result r = planner_->plan(from, to, jmg, timeout, result, path_constraints);
+	if (r && result && !result->empty())
+		store(std::move(key), *result);
+	return r;
+}
+
+PlannerInterface::Result CachingPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                              const moveit::core::LinkModel& link, const Eigen::Isometry3d& offset,
+                                              const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
+                                              double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+                                              const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", "CachingPlanner::plan");
+	return planner_->plan(from, link, offset, target, jmg, timeout, result, path_constraints);
+}
+
+void CachingPlanner::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	index_.clear();
+	entries_.clear();
+}
+
+size_t CachingPlanner::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return entries_.size();
+}
+
+size_t CachingPlanner::hits() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return hits_;
+}
+
+size_t CachingPlanner::misses() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return misses_;
+}
+
+CachingPlanner::Key CachingPlanner::makeKey(const planning_scene::PlanningScene& from,
+                                            const planning_scene::PlanningScene& to,
+                                            const moveit::core::JointModelGroup* jmg) const {
+	const double resolution = properties().get<double>("resolution");
+	// in warm-start mode, the world is ignored: hits are validated anyway and changed objects merely invalidate some
+	Key key{ jmg, {}, {}, utils::worldHash(from, resolution, !properties().get<bool>("warm_start")) };
+	quantize(from.getCurrentState(), jmg, resolution, key.from);
+	quantize(to.getCurrentState(), jmg, resolution, key.to);
+	return key;
+}
+
+robot_trajectory::RobotTrajectoryConstPtr CachingPlanner::lookup(const Key& key) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = index_.find(key);
+	if (it == index_.end())
+		return nullptr;
+	entries_.splice(entries_.begin(), entries_, it->second);  // mark as most recently used
+	return it->second->second;
+}
+
+void CachingPlanner::store(Key&& key, const robot_trajectory::RobotTrajectory& trajectory) {
+	// deep copy, as the caller might modify the returned trajectory
+	auto copy = std::make_shared<const robot_trajectory::RobotTrajectory>(trajectory, true);
+	const size_t max_entries = properties().get<uint32_t>("max_entries");
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto it = index_.find(key);
+	if (it != index_.end()) {  // replace existing entry
+		it->second->second = copy;
+		entries_.splice(entries_.begin(), entries_, it->second);
+		return;
+	}
+	entries_.emplace_front(std::move(key), copy);
+	index_.emplace(entries_.front().first, entries_.begin());
+	while (entries_.size() > max_entries) {
+		index_.erase(entries_.back().first);
+		entries_.pop_back();
+	}
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
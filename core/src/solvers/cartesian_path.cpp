@@ -37,17 +37,192 @@
 */
 
 #include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/robot_state_pool.h>
+#include <moveit/task_constructor/thread_pool.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/trajectory_processing/time_parameterization.h>
 #include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/robot_state/cartesian_interpolator.h>
 
+#include <cmath>
+
 using namespace trajectory_processing;
 
 namespace moveit {
 namespace task_constructor {
 namespace solvers {
 
+namespace {
+// same as CartesianInterpolator: jump detection needs a reasonable number of steps
+constexpr size_t MIN_STEPS_FOR_JUMP_THRESHOLD = 10;
+
+struct Waypoint
+{
+	double fraction;  // of the Cartesian path
+	moveit::core::RobotStatePtr state;
+};
+using Waypoints = std::vector<Waypoint>;
+
+/* Cartesian interpolation solving the IK of waypoints in segments, optionally refining the step size
+ *
+ * In contrast to CartesianInterpolator, which measures the jump threshold w.r.t. the mean joint-space distance
+ * of all steps, jumps are measured w.r.t. the mean joint-space velocity along the path, which is robust
+ * against the non-uniform step sizes of a refined path. */
+class SegmentedPath
+{
+public:
+	SegmentedPath(const moveit::core::RobotState& start, const moveit::core::JointModelGroup* jmg,
+	              const moveit::core::LinkModel& link, const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target,
+	              moveit::core::GroupStateValidityCallbackFn is_valid,
+	              const kinematics::KinematicsQueryOptions& options, utils::RobotStatePool& states)
+	  : start_(start)
+	  , jmg_(jmg)
+	  , link_(link)
+	  , inv_offset_(offset.inverse())
+	  , from_(start.getGlobalLinkTransform(&link) * offset)
+	  , to_(target)
+	  , is_valid_(std::move(is_valid))
+	  , options_(options)
+	  , states_(states) {}
+
+	/// compute the path into trajectory, returning the achieved fraction
+	double compute(double step_size, double jump_threshold, double min_step_size, size_t segments,
+	               utils::ThreadPool* pool, std::vector<moveit::core::RobotStatePtr>& trajectory) const;
+
+private:
+	// solve IK for the waypoint at fraction t, seeded from seed
+	moveit::core::RobotStatePtr solve(const moveit::core::RobotState& seed, double t) const;
+	// solve waypoints at fractions[begin, end) sequentially, stopping at the first failure
+	Waypoints solveSegment(const moveit::core::RobotState& seed, const std::vector<double>& fractions, size_t begin,
+	                       size_t end) const;
+	// bisect a -> b until the joint-space velocity is below max_velocity, appending all waypoints after a
+	void refine(const Waypoint& a, const Waypoint& b, double max_velocity, double min_step, Waypoints& result) const;
+
+	double distance(const Waypoint& a, const Waypoint& b) const { return a.state->distance(*b.state, jmg_); }
+	bool jumps(const Waypoint& a, const Waypoint& b, double max_velocity) const {
+		return distance(a, b) > max_velocity * (b.fraction - a.fraction);
+	}
+
+	const moveit::core::RobotState& start_;
+	const moveit::core::JointModelGroup* jmg_;
+	const moveit::core::LinkModel& link_;
+	const Eigen::Isometry3d inv_offset_;
+	const Eigen::Isometry3d from_;
+	const Eigen::Isometry3d& to_;
+	const moveit::core::GroupStateValidityCallbackFn is_valid_;
+	const kinematics::KinematicsQueryOptions& options_;
+	utils::RobotStatePool& states_;  // recycles the states of failed IK attempts and released trajectories
+};
+
+moveit::core::RobotStatePtr SegmentedPath::solve(const moveit::core::RobotState& seed, double t) const {
+	Eigen::Isometry3d pose(Eigen::Quaterniond(from_.linear()).slerp(t, Eigen::Quaterniond(to_.linear())));
+	pose.translation() = from_.translation() + t * (to_.translation() - from_.translation());
+
+	moveit::core::RobotStatePtr state = states_.copy(seed);
+	if (!state->setFromIK(jmg_, pose * inv_offset_, link_.getName(), 0.0, is_valid_, options_))
+		return nullptr;
+	state->update();
+	return state;
+}
+
+Waypoints SegmentedPath::solveSegment(const moveit::core::RobotState& seed, const std::vector<double>& fractions,
+                                      size_t begin, size_t end) const {
+	Waypoints result;
+	const moveit::core::RobotState* current = &seed;
+	for (size_t i = begin; i < end; ++i) {
+		auto state = solve(*current, fractions[i]);
+		if (!state)
+			break;
+		result.push_back(Waypoint{ fractions[i], state });
+		current = state.get();
+	}
+	return result;
+}
+
+void SegmentedPath::refine(const Waypoint& a, const Waypoint& b, double max_velocity, double min_step,
+                           Waypoints& result) const {
+	const double t = 0.5 * (a.fraction + b.fraction);
+	moveit::core::RobotStatePtr state;
+	if (!jumps(a, b, max_velocity) || t - a.fraction < min_step || !(state = solve(*a.state, t))) {
+		result.push_back(b);  // a remaining jump is detected by compute()
+		return;
+	}
+	const Waypoint mid{ t, state };
+	refine(a, mid, max_velocity, min_step, result);
+	refine(mid, b, max_velocity, min_step, result);
+}
+
+double SegmentedPath::compute(double step_size, double jump_threshold, double min_step_size, size_t segments,
+                              utils::ThreadPool* pool, std::vector<moveit::core::RobotStatePtr>& trajectory) const {
+	const double length = (to_.translation() - from_.translation()).norm();
+	size_t steps = 1 + (step_size > 0.0 ? static_cast<size_t>(std::floor(length / step_size)) : 0);
+	if (jump_threshold > 0.0)
+		steps = std::max(steps, MIN_STEPS_FOR_JUMP_THRESHOLD);
+	std::vector<double> fractions(steps);
+	for (size_t i = 0; i < steps; ++i)
+		fractions[i] = static_cast<double>(i + 1) / steps;
+
+	segments = std::max<size_t>(1, std::min(segments, steps));
+	std::vector<size_t> bounds(segments + 1);
+	for (size_t k = 0; k <= segments; ++k)
+		bounds[k] = k * steps / segments;
+
+	// solve all segments concurrently, seeded from the start state
+	std::vector<Waypoints> solved(segments);
+	std::vector<utils::ThreadPool::Job> jobs;
+	for (size_t k = 0; k < segments; ++k)
+		jobs.emplace_back([this, &solved, &fractions, &bounds, k] {
+			solved[k] = solveSegment(start_, fractions, bounds[k], bounds[k + 1]);
+		});
+	if (pool && jobs.size() > 1)
+		pool->run(jobs);
+	else
+		for (const auto& job : jobs)
+			job();
+
+	// stitch segments, solving a segment once more from the preceding one if their boundary jumps
+	Waypoints path{ Waypoint{ 0.0, states_.copy(start_) } };
+	double path_length = 0.0;  // joint-space distance of path
+	for (size_t k = 0; k < segments; ++k) {
+		Waypoints& segment = solved[k];
+		const size_t expected = bounds[k + 1] - bounds[k];
+		if (k > 0 && (segment.size() < expected ||
+		              (jump_threshold > 0.0 &&
+		               jumps(path.back(), segment.front(), jump_threshold * path_length / path.back().fraction))))
+			segment = solveSegment(*path.back().state, fractions, bounds[k], bounds[k + 1]);
+		for (const auto& waypoint : segment) {
+			path_length += distance(path.back(), waypoint);
+			path.push_back(waypoint);
+		}
+		if (segment.size() < expected)
+			break;
+	}
+
+	if (jump_threshold > 0.0 && path.size() > 1) {
+		const double max_velocity = jump_threshold * path_length / path.back().fraction;
+		if (min_step_size > 0.0 && length > 0.0) {
+			Waypoints refined{ path.front() };
+			for (size_t i = 1; i < path.size(); ++i)
+				refine(path[i - 1], path[i], max_velocity, min_step_size / length, refined);
+			path.swap(refined);
+		}
+		// truncate at first remaining jump
+		for (size_t i = 1; i < path.size(); ++i)
+			if (jumps(path[i - 1], path[i], max_velocity)) {
+				path.resize(i);
+				break;
+			}
+	}
+
+	trajectory.clear();
+	for (const auto& waypoint : path)
+		trajectory.push_back(waypoint.state);
+	return path.back().fraction;
+}
+}  // namespace
+
 CartesianPath::CartesianPath() {
 	auto& p = properties();
 	p.declare<double>("step_size", 0.01, "step size between consecutive waypoints");
@@ -55,9 +230,16 @@ CartesianPath::CartesianPath() {
 	p.declare<double>("min_fraction", 1.0, "fraction of motion required for success");
 	p.declare<kinematics::KinematicsQueryOptions>("kinematics_options", kinematics::KinematicsQueryOptions(),
 	                                              "KinematicsQueryOptions to pass to CartesianInterpolator");
+	p.declare<size_t>("segments", 1, "number of path segments solved concurrently");
+	p.declare<double>("min_step_size", 0.0, "minimal step size for adaptive refinement at jumps (0: disabled)");
 }
 
-void CartesianPath::init(const core::RobotModelConstPtr& /*robot_model*/) {}
+std::shared_ptr<utils::ThreadPool> CartesianPath::threadPool(size_t num_threads) {
+	std::lock_guard<std::mutex> lock(thread_pool_mutex_);
+	if (!thread_pool_ || thread_pool_->size() != num_threads)
+		thread_pool_ = std::make_shared<utils::ThreadPool>(utils::ThreadPool::shared(), num_threads);
+	return thread_pool_;
+}
 
 PlannerInterface::Result CartesianPath::plan(const planning_scene::PlanningSceneConstPtr& from,
                                              const planning_scene::PlanningSceneConstPtr& to,
@@ -78,14 +260,19 @@ PlannerInterface::Result CartesianPath::plan(const planning_scene::PlanningScene
                                              const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
                                              double /*timeout*/, robot_trajectory::RobotTrajectoryPtr& result,
                                              const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", "CartesianPath::plan");
 	const auto& props = properties();
 	planning_scene::PlanningScenePtr sandbox_scene = from->diff();
 
 	kinematic_constraints::KinematicConstraintSet kcs(sandbox_scene->getRobotModel());
 	kcs.add(path_constraints, sandbox_scene->getTransforms());
 
-	auto is_valid = [&sandbox_scene, &kcs](moveit::core::RobotState* state, const moveit::core::JointModelGroup* jmg,
-	                                       const double* joint_positions) {
+	const auto cancellation = utils::CancellationToken::current();
+	auto is_valid = [&sandbox_scene, &kcs, &cancellation](moveit::core::RobotState* state,
+	                                                      const moveit::core::JointModelGroup* jmg,
+	                                                      const double* joint_positions) {
+		if (cancellation.cancelled())
+			return false;  // stop interpolation
 		state->setJointGroupPositions(jmg, joint_positions);
 		state->update();
 		return !sandbox_scene->isStateColliding(const_cast<const moveit::core::RobotState&>(*state), jmg->getName()) &&
@@ -93,21 +280,36 @@ PlannerInterface::Result CartesianPath::plan(const planning_scene::PlanningScene
 	};
 
 	std::vector<moveit::core::RobotStatePtr> trajectory;
-	double achieved_fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
-	    &(sandbox_scene->getCurrentStateNonConst()), jmg, trajectory, &link, target, true,
-	    moveit::core::MaxEEFStep(props.get<double>("step_size")),
-	    moveit::core::JumpThreshold(props.get<double>("jump_threshold")), is_valid,
-	    props.get<kinematics::KinematicsQueryOptions>("kinematics_options"), offset);
+	double achieved_fraction;
+	const size_t segments = props.get<size_t>("segments");
+	const double min_step_size = props.get<double>("min_step_size");
+	if (segments > 1 || min_step_size > 0.0) {
+		std::shared_ptr<utils::ThreadPool> pool = segments > 1 ? threadPool(segments) : nullptr;
+		moveit::core::RobotState& start = sandbox_scene->getCurrentStateNonConst();
+		start.update();
+		const std::shared_ptr<utils::RobotStatePool> states = statePool(sandbox_scene->getRobotModel());
+		SegmentedPath path(start, jmg, link, offset, target, is_valid,
+		                   props.get<kinematics::KinematicsQueryOptions>("kinematics_options"), *states);
+		achieved_fraction = path.compute(props.get<double>("step_size"), props.get<double>("jump_threshold"),
+		                                 min_step_size, segments, pool.get(), trajectory);
+	} else {
+		achieved_fraction = moveit::core::CartesianInterpolator::computeCartesianPath(
+		    &(sandbox_scene->getCurrentStateNonConst()), jmg, trajectory, &link, target, true,
+		    moveit::core::MaxEEFStep(props.get<double>("step_size")),
+		    moveit::core::JumpThreshold(props.get<double>("jump_threshold")), is_valid,
+		    props.get<kinematics::KinematicsQueryOptions>("kinematics_options"), offset);
+	}
 
 	assert(!trajectory.empty());  // there should be at least the start state
 	result = std::make_shared<robot_trajectory::RobotTrajectory>(sandbox_scene->getRobotModel(), jmg);
 	for (const auto& waypoint : trajectory)
 		result->addSuffixWayPoint(waypoint, 0.0);
 
-	auto timing = props.get<TimeParameterizationPtr>("time_parameterization");
-	timing->computeTimeStamps(*result, props.get<double>("max_velocity_scaling_factor"),
-	                          props.get<double>("max_acceleration_scaling_factor"));
+	if (!props.get<bool>("defer_timing"))
+		timing()(*result);
 
+	if (cancellation.cancelled() && achieved_fraction < 1.0)
+		return { false, "cancelled" };
 	if (achieved_fraction < props.get<double>("min_fraction")) {
 		return { false, "min_fraction not met. Achieved: " + std::to_string(achieved_fraction) };
 	}
@@ -0,0 +1,162 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    meta planner, recording statistics of a wrapped planner's calls
+ */
+
+#include <moveit/task_constructor/solvers/instrumented_planner.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <boost/core/demangle.hpp>
+#include <chrono>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double seconds(Clock::time_point start) {
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::string className(const PlannerInterface* planner) {
+	if (!planner)
+		return "InstrumentedPlanner";
+	std::string name = boost::core::demangle(typeid(*planner).name());
+	const auto pos = name.rfind("::");
+	return pos == std::string::npos ? name : name.substr(pos + 2);
+}
+}  // namespace
+
+InstrumentedPlanner::InstrumentedPlanner(const PlannerInterfacePtr& planner, const std::string& name)
+  : planner_(planner), name_(name.empty() ? className(planner.get()) : name) {}
+
+void InstrumentedPlanner::init(const core::RobotModelConstPtr& robot_model) {
+	if (!planner_)
+		throw std::runtime_error("InstrumentedPlanner: invalid planner");
+	planner_->initShared(robot_model);
+}
+
+PlannerInterface::Result InstrumentedPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                                   const planning_scene::PlanningSceneConstPtr& to,
+                                                   const moveit::core::JointModelGroup* jmg, double timeout,
+                                                   robot_trajectory::RobotTrajectoryPtr& result,
+                                                   const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", name_);
+	const Clock::time_point start = Clock::now();
+	Result r = planner_->plan(from, to, jmg, timeout, result, path_constraints);
+	record(false, r, seconds(start), result, jmg);
+	return r;
+}
+
+PlannerInterface::Result InstrumentedPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                                   const moveit::core::LinkModel& link,
+                                                   const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target,
+                                                   const moveit::core::JointModelGroup* jmg, double timeout,
+                                                   robot_trajectory::RobotTrajectoryPtr& result,
+                                                   const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", name_);
+	const Clock::time_point start = Clock::now();
+	Result r = planner_->plan(from, link, offset, target, jmg, timeout, result, path_constraints);
+	record(true, r, seconds(start), result, jmg);
+	return r;
+}
+
+std::vector<PlannerInterface::Result>
+InstrumentedPlanner::planBatch(const std::vector<Request>& requests,
+                               std::vector<robot_trajectory::RobotTrajectoryPtr>& results) {
+	utils::ScopedTimer timer("planning", name_);
+	const Clock::time_point start = Clock::now();
+	std::vector<Result> status = planner_->planBatch(requests, results);
+	const double latency = requests.empty() ? 0.0 : seconds(start) / requests.size();
+	for (size_t i = 0; i < status.size() && i < requests.size(); ++i)
+		record(false, status[i], latency, i < results.size() ? results[i] : nullptr, requests[i].jmg);
+	return status;
+}
+
+PlannerInterface::Result
+InstrumentedPlanner::planGoalSet(const planning_scene::PlanningSceneConstPtr& from,
+                                 const std::vector<planning_scene::PlanningSceneConstPtr>& goals,
+                                 const moveit::core::JointModelGroup* jmg, double timeout,
+                                 robot_trajectory::RobotTrajectoryPtr& result, size_t& reached,
+                                 const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", name_);
+	const Clock::time_point start = Clock::now();
+	Result r = planner_->planGoalSet(from, goals, jmg, timeout, result, reached, path_constraints);
+	record(false, r, seconds(start), result, jmg);
+	return r;
+}
+
+void InstrumentedPlanner::record(bool cartesian, const Result& r, double latency,
+                                 const robot_trajectory::RobotTrajectoryPtr& result,
+                                 const moveit::core::JointModelGroup* jmg) {
+	Call call{ cartesian, r.success, r.message, latency, 0, 0.0, 0.0 };
+	if (result) {  // failed calls might return partial trajectories, too
+		call.waypoints = result->getWayPointCount();
+		for (size_t i = 1; i < call.waypoints; ++i)
+			call.path_length += jmg ? result->getWayPoint(i - 1).distance(result->getWayPoint(i), jmg) :
+			                          result->getWayPoint(i - 1).distance(result->getWayPoint(i));
+		call.duration = result->getDuration();
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		++statistics_.calls;
+		statistics_.latency.record(latency);
+		if (call.success) {
+			++statistics_.successes;
+			statistics_.waypoints += call.waypoints;
+			statistics_.path_length += call.path_length;
+		} else
+			++statistics_.failures[call.message.empty() ? "unknown" : call.message];
+	}
+	if (call_cb_)
+		call_cb_(call);
+}
+
+InstrumentedPlanner::Statistics InstrumentedPlanner::statistics() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return statistics_;
+}
+
+void InstrumentedPlanner::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	statistics_ = Statistics();
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
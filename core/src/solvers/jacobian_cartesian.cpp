@@ -0,0 +1,278 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    straight-line Cartesian path by integration of the Jacobian's damped pseudo-inverse
+ */
+
+#include <moveit/task_constructor/solvers/jacobian_cartesian.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/collision_checker.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/robot_state_pool.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+namespace {
+// convergence thresholds of a waypoint
+constexpr double POSITION_TOLERANCE = 1e-5;  // m
+constexpr double ORIENTATION_TOLERANCE = 1e-4;  // rad
+
+using Vector6d = Eigen::Matrix<double, 6, 1>;
+
+// Cartesian error (translation, rotation vector) of current w.r.t. target, both expressed in the model frame
+Vector6d poseError(const Eigen::Isometry3d& current, const Eigen::Isometry3d& target) {
+	Vector6d error;
+	error.head<3>() = target.translation() - current.translation();
+	const Eigen::AngleAxisd rotation(target.linear() * current.linear().transpose());
+	error.tail<3>() = rotation.angle() * rotation.axis();
+	return error;
+}
+
+/* Damped least-squares IK, moving a state towards a nearby target pose of link * offset */
+class DifferentialIK
+{
+public:
+	DifferentialIK(const moveit::core::JointModelGroup* jmg, const moveit::core::LinkModel& link,
+	               const Eigen::Isometry3d& offset, double damping, double max_step, uint32_t max_iterations)
+	  : jmg_(jmg)
+	  , link_(link)
+	  , offset_(offset)
+	  , damping_squared_(damping * damping)
+	  , max_step_(max_step)
+	  , max_iterations_(max_iterations)
+	  , base_(jmg->getJointModels().front()->getParentLinkModel()) {
+		const std::vector<std::string>& names = jmg->getVariableNames();
+		lower_.resize(names.size());
+		upper_.resize(names.size());
+		for (size_t i = 0; i < names.size(); ++i) {
+			const moveit::core::VariableBounds& bounds = jmg->getParentModel().getVariableBounds(names[i]);
+			lower_[i] = bounds.position_bounded_ ? bounds.min_position_ : -std::numeric_limits<double>::infinity();
+			upper_[i] = bounds.position_bounded_ ? bounds.max_position_ : std::numeric_limits<double>::infinity();
+		}
+	}
+
+	Eigen::Isometry3d pose(const moveit::core::RobotState& state) const {
+		return state.getGlobalLinkTransform(&link_) * offset_;
+	}
+
+	/// iterate state towards target, returning true on convergence
+	bool solve(moveit::core::RobotState& state, const Eigen::Isometry3d& target) {
+		state.copyJointGroupPositions(jmg_, q_);
+		const Eigen::Index n = q_.size();
+		for (uint32_t iteration = 0;; ++iteration) {
+			Vector6d error = poseError(pose(state), target);
+			if (error.head<3>().norm() < POSITION_TOLERANCE && error.tail<3>().norm() < ORIENTATION_TOLERANCE)
+				return true;
+			if (iteration == max_iterations_ || !state.getJacobian(jmg_, &link_, offset_.translation(), jacobian_))
+				return false;
+			if (base_) {  // the Jacobian is expressed in the frame of the root joint's parent link
+				const Eigen::Matrix3d rotation = state.getGlobalLinkTransform(base_).linear().transpose();
+				error.head<3>() = rotation * error.head<3>();
+				error.tail<3>() = rotation * error.tail<3>();
+			}
+
+			// lock joints that would leave their bounds and redistribute the motion onto the remaining ones
+			locked_.assign(n, false);
+			for (Eigen::Index pass = 0; pass <= n; ++pass) {
+				for (Eigen::Index j = 0; j < n; ++j)
+					if (locked_[j])
+						jacobian_.col(j).setZero();
+				const Eigen::Matrix<double, 6, 6> jjt =
+				    jacobian_ * jacobian_.transpose() + damping_squared_ * Eigen::Matrix<double, 6, 6>::Identity();
+				dq_ = jacobian_.transpose() * jjt.ldlt().solve(error);
+				const double largest = dq_.cwiseAbs().maxCoeff();
+				if (largest > max_step_)
+					dq_ *= max_step_ / largest;
+
+				bool violated = false;
+				for (Eigen::Index j = 0; j < n; ++j)
+					if (!locked_[j] && (q_[j] + dq_[j] < lower_[j] || q_[j] + dq_[j] > upper_[j]))
+						violated = locked_[j] = true;
+				if (!violated)
+					break;
+			}
+			if (dq_.isZero())
+				return false;  // all joints blocked
+
+			q_ = (q_ + dq_).cwiseMax(lower_).cwiseMin(upper_);
+			state.setJointGroupPositions(jmg_, q_);
+			state.update();
+		}
+	}
+
+private:
+	const moveit::core::JointModelGroup* jmg_;
+	const moveit::core::LinkModel& link_;
+	const Eigen::Isometry3d offset_;
+	const double damping_squared_;
+	const double max_step_;
+	const uint32_t max_iterations_;
+	const moveit::core::LinkModel* base_;  // reference frame of the Jacobian, nullptr: model frame
+	Eigen::VectorXd lower_, upper_;
+
+	// buffers reused across iterations
+	Eigen::VectorXd q_, dq_;
+	Eigen::MatrixXd jacobian_;
+	std::vector<bool> locked_;
+};
+}  // namespace
+
+JacobianCartesian::JacobianCartesian() {
+	auto& p = properties();
+	p.declare<double>("step_size", 0.01, "translation (m) between consecutive waypoints");
+	p.declare<double>("rotation_step_size", 0.05, "rotation (rad) between consecutive waypoints");
+	p.declare<double>("damping", 0.01, "damping factor of the least-squares solution, avoiding singularities");
+	p.declare<uint32_t>("max_iterations", 10, "maximum number of Jacobian steps per waypoint");
+	p.declare<double>("max_joint_step", 0.1, "maximum motion (rad or m) of any joint between consecutive waypoints");
+	p.declare<double>("min_fraction", 1.0, "fraction of motion required for success");
+}
+
+PlannerInterface::Result JacobianCartesian::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                                 const planning_scene::PlanningSceneConstPtr& to,
+                                                 const moveit::core::JointModelGroup* jmg, double timeout,
+                                                 robot_trajectory::RobotTrajectoryPtr& result,
+                                                 const moveit_msgs::Constraints& path_constraints) {
+	const moveit::core::LinkModel* link = jmg->getOnlyOneEndEffectorTip();
+	if (!link)
+		return { false, "no unique tip for joint model group: " + jmg->getName() };
+
+	// reach pose of forward kinematics
+	return plan(from, *link, Eigen::Isometry3d::Identity(), to->getCurrentState().getGlobalLinkTransform(link), jmg,
+	            std::min(timeout, properties().get<double>("timeout")), result, path_constraints);
+}
+
+PlannerInterface::Result JacobianCartesian::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                                 const moveit::core::LinkModel& link, const Eigen::Isometry3d& offset,
+                                                 const Eigen::Isometry3d& target,
+                                                 const moveit::core::JointModelGroup* jmg, double timeout,
+                                                 robot_trajectory::RobotTrajectoryPtr& result,
+                                                 const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", "JacobianCartesian::plan");
+	const auto& props = properties();
+	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(std::min(timeout, 1e6));
+	const auto& cancellation = utils::CancellationToken::current();
+
+	kinematic_constraints::KinematicConstraintSet kcs(from->getRobotModel());
+	kcs.add(path_constraints, from->getTransforms());
+
+	const std::shared_ptr<utils::RobotStatePool> pool = statePool(from->getRobotModel());
+	moveit::core::RobotStatePtr current = pool->copy(from->getCurrentState());
+	current->update();
+	std::vector<moveit::core::RobotStatePtr> path{ current };
+
+	DifferentialIK ik(jmg, link, offset, props.get<double>("damping"), props.get<double>("max_joint_step"),
+	                  props.get<uint32_t>("max_iterations"));
+	const Eigen::Isometry3d start = ik.pose(*current);
+	const Eigen::Quaterniond start_rotation(start.linear()), target_rotation(target.linear());
+	const double length = (target.translation() - start.translation()).norm();
+	const double angle = start_rotation.angularDistance(target_rotation);
+	const double step_size = props.get<double>("step_size");
+	const double rotation_step_size = props.get<double>("rotation_step_size");
+	const size_t steps = std::max<size_t>(
+	    { 1, step_size > 0.0 ? static_cast<size_t>(std::ceil(length / step_size)) : 0,
+	      rotation_step_size > 0.0 ? static_cast<size_t>(std::ceil(angle / rotation_step_size)) : 0 });
+
+	// integrate waypoints, stopping at the first one that cannot be reached
+	const double max_joint_step = props.get<double>("max_joint_step");
+	std::string error;
+	Eigen::VectorXd previous, next;
+	current->copyJointGroupPositions(jmg, previous);
+	while (path.size() <= steps) {
+		if (cancellation.cancelled()) {
+			error = "cancelled";
+			break;
+		}
+		if (std::chrono::steady_clock::now() > deadline) {
+			error = "timeout";
+			break;
+		}
+
+		const double t = static_cast<double>(path.size()) / steps;
+		Eigen::Isometry3d pose(start_rotation.slerp(t, target_rotation));
+		pose.translation() = start.translation() + t * (target.translation() - start.translation());
+
+		moveit::core::RobotStatePtr state = pool->copy(*current);
+		if (!ik.solve(*state, pose)) {
+			error = "failed to reach waypoint";
+			break;
+		}
+		state->copyJointGroupPositions(jmg, next);
+		if ((next - previous).cwiseAbs().maxCoeff() > max_joint_step) {
+			error = "joint-space jump";
+			break;
+		}
+		if (!kcs.empty() && !kcs.decide(*state).satisfied) {
+			error = "path constraints violated";
+			break;
+		}
+		path.push_back(state);
+		current = state;
+		previous.swap(next);
+	}
+
+	// collision-check all waypoints at once, truncating the path at the first collision
+	std::vector<const moveit::core::RobotState*> waypoints;
+	waypoints.reserve(path.size() - 1);
+	for (size_t i = 1; i < path.size(); ++i)
+		waypoints.push_back(path[i].get());
+	const size_t colliding = utils::collisionChecker()->firstCollision(*from, jmg->getName(), waypoints);
+	if (colliding < waypoints.size()) {
+		path.resize(colliding + 1);
+		error = "waypoint in collision";
+	}
+
+	result = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+	for (const auto& waypoint : path)
+		result->addSuffixWayPoint(waypoint, 0.0);
+
+	if (!props.get<bool>("defer_timing"))
+		timing()(*result);
+
+	const double achieved_fraction = static_cast<double>(path.size() - 1) / steps;
+	if (achieved_fraction < props.get<double>("min_fraction"))
+		return { false, error + ", achieved fraction: " + std::to_string(achieved_fraction) };
+	return { true, "achieved fraction: " + std::to_string(achieved_fraction) };
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -37,10 +37,17 @@
 */
 
 #include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/collision_checker.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/robot_state_pool.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/revolute_joint_model.h>
 #include <moveit/trajectory_processing/time_parameterization.h>
 
+#include <Eigen/Core>
+
 #include <chrono>
+#include <cmath>
 
 namespace moveit {
 namespace task_constructor {
@@ -48,6 +55,73 @@ namespace solvers {
 
 using namespace trajectory_processing;
 
+namespace {
+/** Waypoints of a straight line between two states, interpolated at once into a matrix of positions
+ *
+ * Only applicable if all variables differing between both states belong to single-variable joints with linear
+ * interpolation, i.e. prismatic or non-continuous revolute joints. As their bounds are intervals, waypoints
+ * between valid start and goal states are within bounds as well. Other joints need RobotState::interpolate().
+ */
+class LinearInterpolation
+{
+public:
+	LinearInterpolation(const moveit::core::RobotState& from, const moveit::core::RobotState& to) {
+		const moveit::core::RobotModel& model = *from.getRobotModel();
+		for (size_t i = 0, end = from.getVariableCount(); i != end; ++i) {
+			if (from.getVariablePosition(i) == to.getVariablePosition(i))
+				continue;
+			if (!isLinear(*model.getJointOfVariable(i))) {
+				variables_.clear();
+				applicable_ = false;
+				return;
+			}
+			variables_.push_back(static_cast<int>(i));
+		}
+		start_.resize(variables_.size());
+		diff_.resize(variables_.size());
+		for (size_t k = 0; k != variables_.size(); ++k) {
+			start_[k] = from.getVariablePosition(variables_[k]);
+			diff_[k] = to.getVariablePosition(variables_[k]) - start_[k];
+		}
+	}
+
+	bool applicable() const { return applicable_; }
+
+	/// compute waypoints i = 1..num_waypoints at t = i * delta, one column each
+	void compute(double delta, size_t num_waypoints) {
+		const auto n = static_cast<Eigen::Index>(num_waypoints);
+		const Eigen::RowVectorXd t = Eigen::RowVectorXd::LinSpaced(n, delta, n * delta);
+		positions_.noalias() = diff_ * t;
+		positions_.colwise() += start_;
+	}
+
+	/// set waypoint i (1-based) into state, which is a copy of the start state
+	void apply(size_t i, moveit::core::RobotState& state) const {
+		const auto column = positions_.col(static_cast<Eigen::Index>(i) - 1);
+		for (size_t k = 0; k != variables_.size(); ++k)
+			state.setVariablePosition(variables_[k], column[k]);
+	}
+
+private:
+	static bool isLinear(const moveit::core::JointModel& jm) {
+		switch (jm.getType()) {
+			case moveit::core::JointModel::PRISMATIC:
+				return true;
+			case moveit::core::JointModel::REVOLUTE:
+				return !static_cast<const moveit::core::RevoluteJointModel&>(jm).isContinuous();
+			default:
+				return false;
+		}
+	}
+
+	bool applicable_ = true;
+	std::vector<int> variables_;  // indices of differing variables
+	Eigen::VectorXd start_;
+	Eigen::VectorXd diff_;
+	Eigen::MatrixXd positions_;  // variables x waypoints, column-major: one contiguous column per waypoint
+};
+}  // namespace
+
 JointInterpolationPlanner::JointInterpolationPlanner() {
 	auto& p = properties();
 	p.declare<double>("max_step", 0.1, "max joint step");
@@ -55,13 +129,12 @@ JointInterpolationPlanner::JointInterpolationPlanner() {
 	p.declare<double>("max_effort", "max_effort for GripperCommand actions");
 }
 
-void JointInterpolationPlanner::init(const core::RobotModelConstPtr& /*robot_model*/) {}
-
 PlannerInterface::Result JointInterpolationPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
                                                          const planning_scene::PlanningSceneConstPtr& to,
                                                          const moveit::core::JointModelGroup* jmg, double /*timeout*/,
                                                          robot_trajectory::RobotTrajectoryPtr& result,
                                                          const moveit_msgs::Constraints& /*path_constraints*/) {
+	utils::ScopedTimer timer("planning", "JointInterpolationPlanner::plan");
 	const auto& props = properties();
 
 	// Get maximum joint distance
@@ -72,39 +145,111 @@ PlannerInterface::Result JointInterpolationPlanner::plan(const planning_scene::P
 		d = std::max(d, jm->getDistanceFactor() * from_state.distance(to_state, jm));
 
 	result = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+	const std::shared_ptr<utils::RobotStatePool> pool = statePool(from->getRobotModel());
 
 	// add first point
-	result->addSuffixWayPoint(from->getCurrentState(), 0.0);
+	result->addSuffixWayPoint(pool->copy(from_state), 0.0);
 	if (from->isStateColliding(from_state, jmg->getName()))
 		return { false, "Start state is in collision!" };
 
 	if (!from_state.satisfiesBounds(jmg))
 		return { false, "Start state is out of bounds!" };
 
-	moveit::core::RobotState waypoint(from_state);
-	double delta = d < 1e-6 ? 1.0 : props.get<double>("max_step") / d;
-	for (double t = delta; t < 1.0; t += delta) {  // NOLINT(clang-analyzer-security.FloatLoopCounter)
-		from_state.interpolate(to_state, t, waypoint);
-		result->addSuffixWayPoint(waypoint, t);
+	// validate goal before any intermediate waypoint
+	if (from->isStateColliding(to_state, jmg->getName())) {
+		result->addSuffixWayPoint(pool->copy(to_state), 1.0);
+		return { false, "Goal state is in collision!" };
+	}
+	if (!to_state.satisfiesBounds(jmg)) {
+		result->addSuffixWayPoint(pool->copy(to_state), 1.0);
+		return { false, "Goal state is out of bounds!" };
+	}
+
+	// intermediate waypoints are located at t = i * delta < 1.0, i = 1..num_waypoints
+	const double delta = d < 1e-6 ? 1.0 : props.get<double>("max_step") / d;
+	size_t num_waypoints = delta < 1.0 ? static_cast<size_t>(std::ceil(1.0 / delta)) - 1 : 0;
+	if (num_waypoints > 0 && num_waypoints * delta >= 1.0)
+		--num_waypoints;
 
-		if (from->isStateColliding(waypoint, jmg->getName()))
-			return { false, "Waypoint is in collision!" };
+	// fast path: interpolate all waypoints at once, which stay within bounds
+	LinearInterpolation linear(from_state, to_state);
+	if (linear.applicable())
+		linear.compute(delta, num_waypoints);
+	const auto interpolate = [&](size_t i, moveit::core::RobotState& waypoint) {
+		if (linear.applicable())
+			linear.apply(i, waypoint);
+		else
+			from_state.interpolate(to_state, i * delta, waypoint);
+	};
 
-		if (!waypoint.satisfiesBounds(jmg))
-			return { false, "Waypoint is out of bounds!" };
+	// Validate waypoints by recursive bisection, i.e. coarse to fine, to find collisions as early as possible.
+	// Intervals [lo, hi] of unchecked waypoints are processed level by level, submitting the midpoints
+	// of each level to the collision checker at once. States are interpolated into reused buffers.
+	const utils::CollisionCheckerPtr checker = utils::collisionChecker();
+	std::vector<moveit::core::RobotState> buffers;
+	std::vector<const moveit::core::RobotState*> batch;
+	std::vector<size_t> batch_indices;
+	std::vector<std::pair<size_t, size_t>> intervals;
+	intervals.reserve(num_waypoints);
+	if (num_waypoints > 0)
+		intervals.emplace_back(1, num_waypoints);
+	const char* error = nullptr;
+	size_t invalid = 0;  // index of an invalid waypoint
+	for (size_t level_begin = 0; level_begin < intervals.size() && !error;) {
+		const size_t level_end = intervals.size();
+		while (buffers.size() < level_end - level_begin)
+			buffers.emplace_back(from_state);
+		batch.clear();
+		batch_indices.clear();
+		for (size_t next = level_begin; next < level_end; ++next) {
+			const size_t lo = intervals[next].first;
+			const size_t hi = intervals[next].second;
+			const size_t mid = lo + (hi - lo) / 2;
+			moveit::core::RobotState& waypoint = buffers[next - level_begin];
+			interpolate(mid, waypoint);
+			waypoint.update();
+			if (!linear.applicable() && !waypoint.satisfiesBounds(jmg)) {
+				error = "Waypoint is out of bounds!";
+				invalid = mid;
+				break;
+			}
+			batch.push_back(&waypoint);
+			batch_indices.push_back(mid);
+
+			if (lo < mid)
+				intervals.emplace_back(lo, mid - 1);
+			if (mid < hi)
+				intervals.emplace_back(mid + 1, hi);
+		}
+		if (!error) {
+			const size_t colliding = checker->firstCollision(*from, jmg->getName(), batch);
+			if (colliding < batch.size()) {
+				error = "Waypoint is in collision!";
+				invalid = batch_indices[colliding];
+			}
+		}
+		level_begin = level_end;
 	}
 
-	// add goal point
-	result->addSuffixWayPoint(to_state, 1.0);
-	if (from->isStateColliding(to_state, jmg->getName()))
-		return { false, "Goal state is in collision!" };
+	moveit::core::RobotState waypoint(from_state);
+	if (error) {  // report trajectory up to the invalid waypoint
+		for (size_t i = 1; i <= invalid; ++i) {
+			interpolate(i, waypoint);
+			result->addSuffixWayPoint(pool->copy(waypoint), i * delta);
+		}
+		return { false, error };
+	}
 
-	if (!to_state.satisfiesBounds(jmg))
-		return { false, "Goal state is out of bounds!" };
+	for (size_t i = 1; i <= num_waypoints; ++i) {
+		interpolate(i, waypoint);
+		result->addSuffixWayPoint(pool->copy(waypoint), i * delta);
+	}
+
+	// add goal point
+	result->addSuffixWayPoint(pool->copy(to_state), 1.0);
 
-	auto timing = props.get<TimeParameterizationPtr>("time_parameterization");
-	timing->computeTimeStamps(*result, props.get<double>("max_velocity_scaling_factor"),
-	                          props.get<double>("max_acceleration_scaling_factor"));
+	if (!props.get<bool>("defer_timing"))
+		timing()(*result);
 
 	// set max_effort on first and last waypoint (first, because we might reverse the trajectory)
 	const auto& max_effort = properties().get("max_effort");
@@ -127,6 +272,7 @@ PlannerInterface::Result JointInterpolationPlanner::plan(
     const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
     const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
     double timeout, robot_trajectory::RobotTrajectoryPtr& result, const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", "JointInterpolationPlanner::plan");
 	timeout = std::min(timeout, properties().get<double>("timeout"));
 	const auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::ratio<1>>(timeout);
 
@@ -37,70 +37,308 @@
 */
 
 #include <moveit/task_constructor/solvers/multi_planner.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/robot_model/joint_model_group.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <future>
+#include <thread>
 
 namespace moveit {
 namespace task_constructor {
 namespace solvers {
 
+namespace {
+// outcome of a single planner in a race
+struct Attempt
+{
+	bool done = false;
+	PlannerInterface::Result result{ false, "" };
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+};
+
+// state shared between the racing planners and MultiPlanner::race(), which might return before all finished
+struct Race
+{
+	std::mutex mutex;
+	std::condition_variable cv;
+	std::vector<Attempt> attempts;
+	size_t pending = 0;
+	bool succeeded = false;
+};
+
+double duration(const Attempt& attempt) {
+	return attempt.trajectory ? attempt.trajectory->getDuration() : 0.0;
+}
+
+// apply timing deferred by a planner right away: trajectories of different planners are compared by duration
+PlannerInterface::Result timed(const PlannerInterface& planner, const PlannerInterface::Result& r,
+                               const robot_trajectory::RobotTrajectoryPtr& result) {
+	if (r && result)
+		if (auto timing = planner.deferredTiming())
+			timing(*result);
+	return r;
+}
+
+// expected planning time until a success, estimating the success rate with a prior of one success in two attempts
+double expectedTime(const MultiPlanner::Statistics& s) {
+	if (s.attempts == 0)
+		return 0.0;  // untried planners first
+	const double success_rate = (s.successes + 1.0) / (s.attempts + 2.0);
+	return (s.time / s.attempts) / success_rate;
+}
+
+const std::string& groupName(const moveit::core::JointModelGroup* jmg) {
+	static const std::string none;
+	return jmg ? jmg->getName() : none;
+}
+}  // namespace
+
+MultiPlanner::MultiPlanner() {
+	auto& p = properties();
+	p.declare<bool>("race", false, "run all planners concurrently instead of in sequence");
+	p.declare<double>("grace_period", 0.0,
+	                  "in race mode, time (s) to wait for shorter solutions of other planners after the first success");
+	p.declare<bool>("adaptive", false,
+	                "in sequential mode, try planners in order of their recorded expected time to success");
+}
+
+MultiPlanner::MultiPlanner(std::initializer_list<PlannerInterfacePtr> planners) : MultiPlanner() {
+	assign(planners);
+}
+
+MultiPlanner::~MultiPlanner() {
+	waitForPlanners();
+}
+
 void MultiPlanner::init(const core::RobotModelConstPtr& robot_model) {
+	waitForPlanners();
 	for (const auto& p : *this)
-		p->init(robot_model);
+		p->initShared(robot_model);
 }
 
-PlannerInterface::Result MultiPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
-                                            const planning_scene::PlanningSceneConstPtr& to,
-                                            const moveit::core::JointModelGroup* jmg, double timeout,
-                                            robot_trajectory::RobotTrajectoryPtr& result,
-                                            const moveit_msgs::Constraints& path_constraints) {
-	double remaining_time = std::min(timeout, properties().get<double>("timeout"));
+void MultiPlanner::waitForPlanners() {
+	std::map<const PlannerInterface*, std::shared_future<void>> busy;
+	{
+		std::lock_guard<std::mutex> lock(busy_mutex_);
+		busy.swap(busy_);
+	}
+	for (const auto& run : busy)
+		run.second.wait();
+}
+
+std::shared_future<void> MultiPlanner::takeBusy(const PlannerInterface* planner) {
+	std::lock_guard<std::mutex> lock(busy_mutex_);
+	auto it = busy_.find(planner);
+	if (it == busy_.end())
+		return std::shared_future<void>();
+	auto run = std::move(it->second);
+	busy_.erase(it);
+	return run;
+}
+
+MultiPlanner::Statistics MultiPlanner::statistics(const PlannerInterface* planner, const std::string& group,
+                                                  bool cartesian) const {
+	std::lock_guard<std::mutex> lock(statistics_mutex_);
+	auto it = statistics_.find(StatisticsKey(planner, group, cartesian));
+	return it == statistics_.end() ? Statistics() : it->second;
+}
+
+void MultiPlanner::resetStatistics() {
+	std::lock_guard<std::mutex> lock(statistics_mutex_);
+	statistics_.clear();
+}
+
+MultiPlanner::PlannerList MultiPlanner::schedule(const std::string& group, bool cartesian) const {
+	PlannerList planners(begin(), end());
+	if (!properties().get<bool>("adaptive"))
+		return planners;
+
+	std::vector<std::pair<double, PlannerInterfacePtr>> ranked;
+	{
+		std::lock_guard<std::mutex> lock(statistics_mutex_);
+		for (const auto& p : planners) {
+			auto it = statistics_.find(StatisticsKey(p.get(), group, cartesian));
+			ranked.emplace_back(it == statistics_.end() ? 0.0 : expectedTime(it->second), p);
+		}
+	}
+	// keep configured order on ties
+	std::stable_sort(ranked.begin(), ranked.end(), [](const auto& a, const auto& b) { return a.first < b.first; });
+	for (size_t i = 0; i < ranked.size(); ++i)
+		planners[i] = ranked[i].second;
+	return planners;
+}
+
+PlannerInterface::Result MultiPlanner::planSequentially(const PlanFunction& plan,
+                                                        const moveit::core::JointModelGroup* jmg, bool cartesian,
+                                                        double timeout, robot_trajectory::RobotTrajectoryPtr& result) {
+	double remaining_time = timeout;
 	auto start_time = std::chrono::steady_clock::now();
+	const bool adaptive = properties().get<bool>("adaptive");
+	const std::string& group = groupName(jmg);
 
 	std::string comment = "No planner specified";
-	for (const auto& p : *this) {
+	for (const auto& p : schedule(group, cartesian)) {
+		auto previous = takeBusy(p.get());
+		if (previous.valid()) {
+			previous.wait();
+			auto now = std::chrono::steady_clock::now();
+			remaining_time -= std::chrono::duration<double>(now - start_time).count();
+			start_time = now;
+		}
 		if (remaining_time < 0)
 			return { false, "timeout" };
+		if (utils::CancellationToken::current().cancelled())
+			return { false, "cancelled" };
 		if (result)
 			result->clear();
-		auto r = p->plan(from, to, jmg, remaining_time, result, path_constraints);
+		auto r = plan(*p, remaining_time, result);
+
+		auto now = std::chrono::steady_clock::now();
+		const double elapsed = std::chrono::duration<double>(now - start_time).count();
+		remaining_time -= elapsed;
+		start_time = now;
+		if (adaptive && !utils::CancellationToken::current().cancelled()) {  // cancelled runs tell nothing
+			std::lock_guard<std::mutex> lock(statistics_mutex_);
+			Statistics& s = statistics_[StatisticsKey(p.get(), group, cartesian)];
+			++s.attempts;
+			s.successes += r.success;
+			s.time += elapsed;
+		}
+
 		if (r)
 			return r;
 		else
 			comment = r.message;
-
-		auto now = std::chrono::steady_clock::now();
-		remaining_time -= std::chrono::duration<double>(now - start_time).count();
-		start_time = now;
 	}
 	return { false, comment };
 }
 
+PlannerInterface::Result MultiPlanner::race(const PlanFunction& plan, double timeout,
+                                            robot_trajectory::RobotTrajectoryPtr& result) {
+	if (empty())
+		return { false, "No planner specified" };
+
+	using Clock = std::chrono::steady_clock;
+	const auto start_time = Clock::now();
+	auto elapsed = [start_time] { return std::chrono::duration<double>(Clock::now() - start_time).count(); };
+
+	auto state = std::make_shared<Race>();
+	state->attempts.resize(size());
+	state->pending = size();
+	// cancelled when the race is decided (or the caller's token is cancelled)
+	auto cancellation = utils::CancellationToken::current().child();
+
+	for (size_t i = 0; i < size(); ++i) {
+		PlannerInterfacePtr planner = (*this)[i];
+		auto previous = takeBusy(planner.get());
+		// Captures everything by value: the planner might still run after race() returned.
+		// Profiling is not propagated, as the task's profiler might not exist anymore by then.
+		auto racer = std::make_shared<std::packaged_task<void()>>([state, i, planner, plan, previous, timeout, elapsed,
+		                                                            cancellation] {
+			utils::CancellationToken::Activation activation(cancellation);
+			if (previous.valid())
+				previous.wait();  // the planner isn't done with an earlier, abandoned request yet
+
+			Attempt attempt;
+			try {
+				attempt.result = plan(*planner, timeout - elapsed(), attempt.trajectory);
+			} catch (const std::exception& e) {
+				attempt.result = { false, e.what() };
+			} catch (...) {
+				attempt.result = { false, "unknown exception" };
+			}
+			attempt.done = true;
+
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->succeeded |= attempt.result.success;
+			state->attempts[i] = std::move(attempt);
+			--state->pending;
+			state->cv.notify_all();
+		});
+		std::shared_future<void> run = racer->get_future().share();
+		// Race on an idle worker of the shared pool, but fall back to a dedicated thread if there is none:
+		// a queued planner would start too late to compete.
+		if (!utils::ThreadPool::shared().tryPost([racer] { (*racer)(); }, utils::ThreadPool::HIGH))
+			std::thread([racer] { (*racer)(); }).detach();
+
+		std::lock_guard<std::mutex> lock(busy_mutex_);
+		busy_[planner.get()] = std::move(run);
+	}
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	auto wait = [&](double until, auto predicate) {
+		if (std::isfinite(until))
+			state->cv.wait_until(
+			    lock, start_time + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(until)),
+			    predicate);
+		else
+			state->cv.wait(lock, predicate);
+	};
+	wait(timeout, [&state] { return state->succeeded || state->pending == 0; });
+
+	const double grace_period = properties().get<double>("grace_period");
+	if (state->succeeded && state->pending > 0 && grace_period > 0.0)
+		wait(std::min(timeout, elapsed() + grace_period), [&state] { return state->pending == 0; });
+
+	// pick the shortest successful trajectory, preferring earlier planners on ties
+	const Attempt* best = nullptr;
+	std::string comment;
+	for (const Attempt& attempt : state->attempts) {
+		if (!attempt.done)
+			continue;
+		if (!attempt.result)
+			comment = attempt.result.message;
+		else if (!best || duration(attempt) < duration(*best))
+			best = &attempt;
+	}
+	Result r{ false, state->pending > 0 ? "timeout" : comment };
+	if (best) {
+		result = best->trajectory;
+		r = best->result;
+	}
+
+	lock.unlock();
+	cancellation.cancel();  // stop planners still running
+	return r;
+}
+
+PlannerInterface::Result MultiPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                            const planning_scene::PlanningSceneConstPtr& to,
+                                            const moveit::core::JointModelGroup* jmg, double timeout,
+                                            robot_trajectory::RobotTrajectoryPtr& result,
+                                            const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", "MultiPlanner::plan");
+	timeout = std::min(timeout, properties().get<double>("timeout"));
+	auto request = [from, to, jmg, path_constraints](PlannerInterface& planner, double timeout,
+	                                                  robot_trajectory::RobotTrajectoryPtr& result) {
+		return timed(planner, planner.plan(from, to, jmg, timeout, result, path_constraints), result);
+	};
+	if (properties().get<bool>("race"))
+		return race(request, timeout, result);
+	return planSequentially(request, jmg, false, timeout, result);
+}
+
 PlannerInterface::Result MultiPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
                                             const moveit::core::LinkModel& link, const Eigen::Isometry3d& offset,
                                             const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
                                             double timeout, robot_trajectory::RobotTrajectoryPtr& result,
                                             const moveit_msgs::Constraints& path_constraints) {
-	double remaining_time = std::min(timeout, properties().get<double>("timeout"));
-	auto start_time = std::chrono::steady_clock::now();
-
-	std::string comment = "No planner specified";
-	for (const auto& p : *this) {
-		if (remaining_time < 0)
-			return { false, "timeout" };
-		if (result)
-			result->clear();
-		auto r = p->plan(from, link, offset, target, jmg, remaining_time, result, path_constraints);
-		if (r)
-			return r;
-		else
-			comment = r.message;
-
-		auto now = std::chrono::steady_clock::now();
-		remaining_time -= std::chrono::duration<double>(now - start_time).count();
-		start_time = now;
-	}
-	return { false, comment };
+	utils::ScopedTimer timer("planning", "MultiPlanner::plan");
+	timeout = std::min(timeout, properties().get<double>("timeout"));
+	auto request = [from, link = &link, offset, target, jmg, path_constraints](
+	                   PlannerInterface& planner, double timeout, robot_trajectory::RobotTrajectoryPtr& result) {
+		return timed(planner, planner.plan(from, *link, offset, target, jmg, timeout, result, path_constraints),
+		             result);
+	};
+	if (properties().get<bool>("race"))
+		return race(request, timeout, result);
+	return planSequentially(request, jmg, true, timeout, result);
 }
 }  // namespace solvers
 }  // namespace task_constructor
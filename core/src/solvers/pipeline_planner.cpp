@@ -37,23 +37,63 @@
 */
 
 #include <moveit/task_constructor/solvers/pipeline_planner.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/profiler.h>
 #include <moveit/task_constructor/task.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit_msgs/MotionPlanRequest.h>
 #include <moveit/kinematic_constraints/utils.h>
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <limits>
+
 namespace moveit {
 namespace task_constructor {
 namespace solvers {
 
+PipelinePool::Lease::Lease(PipelinePool& pool) : pool_(pool) {
+	std::unique_lock<std::mutex> lock(pool_.mutex_);
+	pool_.idle_cv_.wait(lock, [this] { return !pool_.idle_.empty(); });
+	pipeline_ = pool_.idle_.back();
+	pool_.idle_.pop_back();
+}
+
+PipelinePool::Lease::~Lease() {
+	{
+		std::lock_guard<std::mutex> lock(pool_.mutex_);
+		pool_.idle_.push_back(pipeline_);
+	}
+	pool_.idle_cv_.notify_one();
+}
+
+void PipelinePool::add(const planning_pipeline::PlanningPipelinePtr& pipeline) {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		pipelines_.push_back(pipeline);
+		idle_.push_back(pipeline.get());
+	}
+	idle_cv_.notify_one();
+}
+
+size_t PipelinePool::size() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return pipelines_.size();
+}
+
+std::vector<planning_pipeline::PlanningPipelinePtr> PipelinePool::pipelines() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return pipelines_;
+}
+
 struct PlannerCache
 {
 	using PlannerID = std::tuple<std::string, std::string>;
-	using PlannerMap = std::map<PlannerID, std::weak_ptr<planning_pipeline::PlanningPipeline> >;
+	using PlannerMap = std::map<PlannerID, std::weak_ptr<PipelinePool> >;
 	using ModelList = std::list<std::pair<std::weak_ptr<const moveit::core::RobotModel>, PlannerMap> >;
 	ModelList cache_;
+	std::mutex mutex_;  // protecting cache_, needs to be locked by users of retrieve()
 
 	PlannerMap::mapped_type& retrieve(const moveit::core::RobotModelConstPtr& model, const PlannerID& id) {
 		// find model in cache_ and remove expired entries while doing so
@@ -75,6 +115,10 @@ struct PlannerCache
 };
 
 planning_pipeline::PlanningPipelinePtr PipelinePlanner::create(const PipelinePlanner::Specification& spec) {
+	return createPool(spec, 1)->pipelines().front();
+}
+
+PipelinePoolPtr PipelinePlanner::createPool(const PipelinePlanner::Specification& spec, size_t size) {
 	static PlannerCache cache;
 
 	static constexpr char const* PLUGIN_PARAMETER_NAME = "planning_plugin";
@@ -89,21 +133,26 @@ planning_pipeline::PlanningPipelinePtr PipelinePlanner::create(const PipelinePla
 
 	PlannerCache::PlannerID id(pipeline_ns, spec.adapter_param);
 
-	std::weak_ptr<planning_pipeline::PlanningPipeline>& entry = cache.retrieve(spec.model, id);
-	planning_pipeline::PlanningPipelinePtr planner = entry.lock();
-	if (!planner) {
+	// keep the cache locked while creating pipelines to not create more instances than requested
+	std::lock_guard<std::mutex> lock(cache.mutex_);
+	std::weak_ptr<PipelinePool>& entry = cache.retrieve(spec.model, id);
+	PipelinePoolPtr pool = entry.lock();
+	if (!pool) {
 		// create new entry
-		planner = std::make_shared<planning_pipeline::PlanningPipeline>(spec.model, ros::NodeHandle(pipeline_ns),
-		                                                                PLUGIN_PARAMETER_NAME, spec.adapter_param);
+		pool = std::make_shared<PipelinePool>();
 		// store in cache
-		entry = planner;
+		entry = pool;
 	}
-	return planner;
+	while (pool->size() < std::max<size_t>(size, 1))
+		pool->add(std::make_shared<planning_pipeline::PlanningPipeline>(spec.model, ros::NodeHandle(pipeline_ns),
+		                                                                PLUGIN_PARAMETER_NAME, spec.adapter_param));
+	return pool;
 }
 
 PipelinePlanner::PipelinePlanner(const std::string& pipeline_name) : pipeline_name_{ pipeline_name } {
 	auto& p = properties();
 	p.declare<std::string>("planner", "", "planner id");
+	p.declare<uint>("pool_size", 1u, "number of pipeline instances available for concurrent planning");
 
 	p.declare<uint>("num_planning_attempts", 1u, "number of planning attempts");
 	p.declare<moveit_msgs::WorkspaceParameters>("workspace_parameters", moveit_msgs::WorkspaceParameters(),
@@ -122,6 +171,9 @@ PipelinePlanner::PipelinePlanner(const std::string& pipeline_name) : pipeline_na
 
 PipelinePlanner::PipelinePlanner(const planning_pipeline::PlanningPipelinePtr& planning_pipeline) : PipelinePlanner() {
 	planner_ = planning_pipeline;
+	// a custom pipeline isn't shared with other planners, but cannot be used concurrently either
+	pool_ = std::make_shared<PipelinePool>();
+	pool_->add(planner_);
 }
 
 void PipelinePlanner::init(const core::RobotModelConstPtr& robot_model) {
@@ -129,14 +181,17 @@ void PipelinePlanner::init(const core::RobotModelConstPtr& robot_model) {
 		Specification spec;
 		spec.model = robot_model;
 		spec.pipeline = pipeline_name_;
-		planner_ = create(spec);
+		pool_ = createPool(spec, properties().get<uint>("pool_size"));
+		planner_ = pool_->pipelines().front();
 	} else if (robot_model != planner_->getRobotModel()) {
 		throw std::runtime_error(
 		    "The robot model of the planning pipeline isn't the same as the task's robot model -- "
 		    "use Task::setRobotModel for setting the robot model when using custom planning pipeline");
 	}
-	planner_->displayComputedMotionPlans(properties().get<bool>("display_motion_plans"));
-	planner_->publishReceivedRequests(properties().get<bool>("publish_planning_requests"));
+	for (const auto& pipeline : pool_->pipelines()) {
+		pipeline->displayComputedMotionPlans(properties().get<bool>("display_motion_plans"));
+		pipeline->publishReceivedRequests(properties().get<bool>("publish_planning_requests"));
+	}
 }
 
 void initMotionPlanRequest(moveit_msgs::MotionPlanRequest& req, const PropertyMap& p,
@@ -192,11 +247,55 @@ PlannerInterface::Result PipelinePlanner::plan(const planning_scene::PlanningSce
 	return plan(from, req, result);
 }
 
+PlannerInterface::Result PipelinePlanner::planGoalSet(const planning_scene::PlanningSceneConstPtr& from,
+                                                      const std::vector<planning_scene::PlanningSceneConstPtr>& goals,
+                                                      const moveit::core::JointModelGroup* jmg, double timeout,
+                                                      robot_trajectory::RobotTrajectoryPtr& result, size_t& reached,
+                                                      const moveit_msgs::Constraints& path_constraints) {
+	if (goals.size() < 2)
+		return PlannerInterface::planGoalSet(from, goals, jmg, timeout, result, reached, path_constraints);
+
+	const auto& props = properties();
+	moveit_msgs::MotionPlanRequest req;
+	initMotionPlanRequest(req, props, jmg, timeout);
+
+	// OMPL samples from all goal constraints, i.e. plans towards the whole goal set
+	const double tolerance = props.get<double>("goal_joint_tolerance");
+	req.goal_constraints.reserve(goals.size());
+	for (const planning_scene::PlanningSceneConstPtr& goal : goals)
+		req.goal_constraints.push_back(
+		    kinematic_constraints::constructGoalConstraints(goal->getCurrentState(), jmg, tolerance));
+	req.path_constraints = path_constraints;
+
+	Result status = plan(from, req, result);
+	if (!status)
+		return status;
+
+	// identify the reached goal as the one closest to the trajectory's end point
+	const moveit::core::RobotState& end = result->getLastWayPoint();
+	double min_distance = std::numeric_limits<double>::infinity();
+	for (size_t i = 0; i < goals.size(); ++i) {
+		const double distance = end.distance(goals[i]->getCurrentState(), jmg);
+		if (distance < min_distance) {
+			min_distance = distance;
+			reached = i;
+		}
+	}
+	return status;
+}
+
 PlannerInterface::Result PipelinePlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
                                                const moveit_msgs::MotionPlanRequest& req,
                                                robot_trajectory::RobotTrajectoryPtr& result) {
+	utils::ScopedTimer timer("planning", "PipelinePlanner::plan");
 	::planning_interface::MotionPlanResponse res;
-	bool success = planner_->generatePlan(from, req, res);
+	PipelinePool::Lease pipeline(*pool_);
+	// running planners can only be interrupted via terminate()
+	utils::CancellationToken::Registration cancellation(utils::CancellationToken::current(),
+	                                                    [&pipeline] { pipeline->terminate(); });
+	if (utils::CancellationToken::current().cancelled())
+		return { false, "cancelled" };
+	bool success = pipeline->generatePlan(from, req, res);
 	result = res.trajectory_;
 	return { success, success ? std::string() : static_cast<std::string>(res.error_code_) };
 }
@@ -37,6 +37,7 @@
 */
 
 #include <moveit/task_constructor/solvers/planner_interface.h>
+#include <moveit/task_constructor/robot_state_pool.h>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 
 using namespace trajectory_processing;
@@ -51,6 +52,55 @@ PlannerInterface::PlannerInterface() {
 	p.declare<double>("max_velocity_scaling_factor", 1.0, "scale down max velocity by this factor");
 	p.declare<double>("max_acceleration_scaling_factor", 1.0, "scale down max acceleration by this factor");
 	p.declare<TimeParameterizationPtr>("time_parameterization", std::make_shared<TimeOptimalTrajectoryGeneration>());
+	p.declare<bool>("defer_timing", false, "skip time parameterization until the trajectory is used");
+}
+
+PlannerInterface::Timing PlannerInterface::timing() const {
+	const auto& p = properties();
+	return [timing = p.get<TimeParameterizationPtr>("time_parameterization"),
+	        velocity = p.get<double>("max_velocity_scaling_factor"),
+	        acceleration = p.get<double>("max_acceleration_scaling_factor")](robot_trajectory::RobotTrajectory& t) {
+		timing->computeTimeStamps(t, velocity, acceleration);
+	};
+}
+
+std::vector<PlannerInterface::Result> PlannerInterface::planBatch(const std::vector<Request>& requests,
+                                                                  std::vector<robot_trajectory::RobotTrajectoryPtr>& results) {
+	std::vector<Result> status;
+	status.reserve(requests.size());
+	results.resize(requests.size());
+	for (size_t i = 0; i < requests.size(); ++i) {
+		const Request& r = requests[i];
+		status.push_back(plan(r.from, r.to, r.jmg, r.timeout, results[i], r.path_constraints));
+	}
+	return status;
+}
+
+PlannerInterface::Result PlannerInterface::planGoalSet(const planning_scene::PlanningSceneConstPtr& from,
+                                                       const std::vector<planning_scene::PlanningSceneConstPtr>& goals,
+                                                       const moveit::core::JointModelGroup* jmg, double timeout,
+                                                       robot_trajectory::RobotTrajectoryPtr& result, size_t& reached,
+                                                       const moveit_msgs::Constraints& path_constraints) {
+	Result status{ false, "empty goal set" };
+	for (reached = 0; reached < goals.size(); ++reached) {
+		status = plan(from, goals[reached], jmg, timeout, result, path_constraints);
+		if (status)
+			break;
+	}
+	return status;
+}
+
+void WaypointPlanner::init(const core::RobotModelConstPtr& robot_model) {
+	// keep the pool alive across plan() calls, such that waypoints of released trajectories get reused
+	state_pool_ = utils::RobotStatePool::get(robot_model);
+}
+
+PlannerInterface::Timing WaypointPlanner::deferredTiming() const {
+	return properties().get<bool>("defer_timing") ? timing() : Timing();
+}
+
+std::shared_ptr<utils::RobotStatePool> WaypointPlanner::statePool(const core::RobotModelConstPtr& robot_model) const {
+	return state_pool_ ? state_pool_ : utils::RobotStatePool::get(robot_model);
 }
 }  // namespace solvers
 }  // namespace task_constructor
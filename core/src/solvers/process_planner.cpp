@@ -0,0 +1,820 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    meta planner, isolating a wrapped planner in a pool of worker processes
+ */
+
+#include <moveit/task_constructor/solvers/process_planner.h>
+#include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/solvers/jacobian_cartesian.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/properties.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit_msgs/PlanningScene.h>
+#include <moveit_msgs/RobotTrajectory.h>
+#include <geometry_msgs/Pose.h>
+#include <ros/serialization.h>
+#include <tf2_eigen/tf2_eigen.h>
+#include <srdfdom/srdf_writer.h>
+#include <urdf_parser/urdf_parser.h>
+#include <tinyxml.h>
+
+#include <dirent.h>
+#include <pthread.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <thread>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+namespace ser = ros::serialization;
+
+// initialization of a worker: robot model, and type and properties of the planner to create
+struct ProcessPlanner::Setup
+{
+	std::string factory;  // typeid name of the wrapped planner
+	std::string urdf;
+	std::string srdf;
+	std::vector<std::string> names;  // serialized properties of the wrapped planner
+	std::vector<std::string> types;
+	std::vector<std::string> values;
+
+	template <typename Stream, typename Self>
+	static void fields(Stream& stream, Self& self) {
+		stream.next(self.factory);
+		stream.next(self.urdf);
+		stream.next(self.srdf);
+		stream.next(self.names);
+		stream.next(self.types);
+		stream.next(self.values);
+	}
+};
+
+// joint-space or Cartesian planning request, as sent to a worker
+struct ProcessPlanner::Job
+{
+	uint8_t cartesian = 0;
+	moveit_msgs::PlanningScene from;
+	std::string group;
+	double timeout = 0.0;
+	moveit_msgs::Constraints path_constraints;
+	std::vector<double> to;  // joint-space goal: positions of all variables
+	std::string link;  // Cartesian goal: pose(link) * offset == target
+	geometry_msgs::Pose offset;
+	geometry_msgs::Pose target;
+
+	// (de)serialize self with any ROS serialization stream
+	template <typename Stream, typename Self>
+	static void fields(Stream& stream, Self& self) {
+		stream.next(self.cartesian);
+		stream.next(self.from);
+		stream.next(self.group);
+		stream.next(self.timeout);
+		stream.next(self.path_constraints);
+		stream.next(self.to);
+		stream.next(self.link);
+		stream.next(self.offset);
+		stream.next(self.target);
+	}
+};
+
+struct ProcessPlanner::Response
+{
+	uint8_t success = 0;
+	std::string message;
+	moveit_msgs::RobotTrajectory trajectory;
+
+	template <typename Stream, typename Self>
+	static void fields(Stream& stream, Self& self) {
+		stream.next(self.success);
+		stream.next(self.message);
+		stream.next(self.trajectory);
+	}
+};
+
+/* Channel between requester and worker, placed in shared memory.
+ * The mutex is robust: if a (killed) worker dies while holding it, the next locker recovers it.
+ * A slot is re-initialized before each (re)start of its worker, such that a new worker never inherits its state.
+ */
+struct ProcessPlanner::Slot
+{
+	enum State : uint8_t
+	{
+		SETUP,  // Setup pending for the worker
+		IDLE,
+		REQUEST,  // job pending for the worker
+		DONE,  // response pending for the requester
+		FAILED,  // worker failed to initialize, Response with error message in buffer
+		STOP,
+	};
+	pthread_mutex_t mutex;
+	pthread_cond_t cv;
+	State state = SETUP;
+	uint32_t size = 0;  // bytes used in buffer
+
+	Slot() {
+		pthread_mutexattr_t mutex_attr;
+		pthread_mutexattr_init(&mutex_attr);
+		pthread_mutexattr_setpshared(&mutex_attr, PTHREAD_PROCESS_SHARED);
+		pthread_mutexattr_setrobust(&mutex_attr, PTHREAD_MUTEX_ROBUST);
+		pthread_mutex_init(&mutex, &mutex_attr);
+		pthread_mutexattr_destroy(&mutex_attr);
+
+		pthread_condattr_t cv_attr;
+		pthread_condattr_init(&cv_attr);
+		pthread_condattr_setpshared(&cv_attr, PTHREAD_PROCESS_SHARED);
+		pthread_condattr_setclock(&cv_attr, CLOCK_MONOTONIC);
+		pthread_cond_init(&cv, &cv_attr);
+		pthread_condattr_destroy(&cv_attr);
+	}
+	~Slot() {
+		pthread_cond_destroy(&cv);
+		pthread_mutex_destroy(&mutex);
+	}
+	void notify() { pthread_cond_broadcast(&cv); }
+
+	// buffer follows the slot in shared memory
+	uint8_t* buffer() { return reinterpret_cast<uint8_t*>(this + 1); }
+};
+
+namespace {
+// scoped lock of a slot's robust mutex
+class SlotLock
+{
+public:
+	explicit SlotLock(pthread_mutex_t& mutex) : mutex_(mutex) { lock(); }
+	~SlotLock() {
+		if (locked_)
+			pthread_mutex_unlock(&mutex_);
+	}
+	void lock() {
+		recover(pthread_mutex_lock(&mutex_));
+		locked_ = true;
+	}
+	void unlock() {
+		pthread_mutex_unlock(&mutex_);
+		locked_ = false;
+	}
+	/// wait for a notification until deadline (CLOCK_MONOTONIC), returns false on timeout
+	bool wait(pthread_cond_t& cv, const timespec& deadline) {
+		const int error = pthread_cond_timedwait(&cv, &mutex_, &deadline);
+		recover(error);
+		return error != ETIMEDOUT;
+	}
+	void wait(pthread_cond_t& cv) { recover(pthread_cond_wait(&cv, &mutex_)); }
+	/// did a previous owner die while holding the mutex?
+	bool ownerDied() const { return owner_died_; }
+
+private:
+	void recover(int error) {
+		if (error == EOWNERDEAD) {
+			owner_died_ = true;
+			pthread_mutex_consistent(&mutex_);
+		}
+	}
+	pthread_mutex_t& mutex_;
+	bool locked_ = false;
+	bool owner_died_ = false;
+};
+
+timespec monotonicIn(double seconds) {
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	const double whole = std::floor(seconds);
+	ts.tv_sec += static_cast<time_t>(whole);
+	ts.tv_nsec += static_cast<long>((seconds - whole) * 1e9);
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec += 1;
+		ts.tv_nsec -= 1000000000L;
+	}
+	return ts;
+}
+
+bool alive(pid_t pid) {
+	return pid > 0 && (kill(pid, 0) == 0 || errno == EPERM);
+}
+
+std::map<std::string, ProcessPlanner::Factory>& factories() {
+	static std::map<std::string, ProcessPlanner::Factory> factories{
+		{ typeid(JointInterpolationPlanner).name(), [] { return std::make_shared<JointInterpolationPlanner>(); } },
+		{ typeid(CartesianPath).name(), [] { return std::make_shared<CartesianPath>(); } },
+		{ typeid(JacobianCartesian).name(), [] { return std::make_shared<JacobianCartesian>(); } },
+	};
+	return factories;
+}
+
+template <typename T>
+bool store(const T& value, uint8_t* buffer, uint32_t capacity, uint32_t& size) {
+	ser::LStream length;
+	T::fields(length, value);
+	if (length.getLength() > capacity)
+		return false;
+	size = length.getLength();
+	ser::OStream stream(buffer, size);
+	T::fields(stream, value);
+	return true;
+}
+
+template <typename T>
+bool load(T& value, uint8_t* buffer, uint32_t size) {
+	try {
+		ser::IStream stream(buffer, size);
+		T::fields(stream, value);
+		return true;
+	} catch (const ros::Exception& /*e*/) {  // truncated buffer
+		return false;
+	}
+}
+
+// time granted to a worker beyond the planning timeout before it is killed
+constexpr double GRACE_PERIOD = 1.0;
+// interval of checking a pending request for cancellation, timeout, or death of the worker
+constexpr double POLL_INTERVAL = 0.01;
+}  // namespace
+
+/* Process forking the workers, itself forked while the parent process is still single-threaded.
+ * The parent sends a request {offset, stride, capacity} along with the shared-memory fd of all slots,
+ * and receives the pid of the new worker in reply. The zygote exits when its socket gets closed.
+ */
+class ProcessPlanner::Zygote
+{
+	struct Request
+	{
+		size_t offset;  // of the slot in shared memory
+		size_t size;  // of the shared memory
+		uint32_t capacity;  // of the slot's buffer
+	};
+
+	static std::mutex& mutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+	static int& socket() {
+		static int fd = -1;
+		return fd;
+	}
+
+	static bool singleThreaded() {
+		DIR* dir = opendir("/proc/self/task");
+		if (!dir)
+			return false;
+		size_t threads = 0;
+		while (dirent* entry = readdir(dir))
+			if (entry->d_name[0] != '.')
+				++threads;
+		closedir(dir);
+		return threads == 1;
+	}
+
+	// main loop of the zygote process, never returning
+	[[noreturn]] static void serve(int fd) {
+		signal(SIGCHLD, SIG_IGN);  // reap workers automatically
+		while (true) {
+			Request request;
+			int memory_fd = -1;
+			char control[CMSG_SPACE(sizeof(int))];
+			iovec iov{ &request, sizeof(request) };
+			msghdr msg{};
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			const ssize_t received = recvmsg(fd, &msg, 0);
+			if (received <= 0)
+				_exit(0);  // parent closed the socket or died
+			if (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg))
+				if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+					std::memcpy(&memory_fd, CMSG_DATA(cmsg), sizeof(int));
+
+			pid_t pid = -1;
+			if (received == sizeof(request) && memory_fd >= 0) {
+				pid = fork();
+				if (pid == 0) {  // worker process
+					close(fd);
+					signal(SIGCHLD, SIG_DFL);
+					prctl(PR_SET_PDEATHSIG, SIGKILL);
+					void* memory = mmap(nullptr, request.size, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd, 0);
+					close(memory_fd);
+					if (memory != MAP_FAILED)
+						work(*reinterpret_cast<Slot*>(static_cast<uint8_t*>(memory) + request.offset), request.capacity);
+					_exit(0);
+				}
+			}
+			if (memory_fd >= 0)
+				close(memory_fd);
+			if (write(fd, &pid, sizeof(pid)) != sizeof(pid))
+				_exit(0);
+		}
+	}
+
+public:
+	static bool running() {
+		std::lock_guard<std::mutex> lock(mutex());
+		return socket() >= 0;
+	}
+
+	static bool start() {
+		std::lock_guard<std::mutex> lock(mutex());
+		if (socket() >= 0)
+			return true;
+		if (!singleThreaded())
+			return false;
+
+		int fds[2];
+		if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) != 0)
+			return false;
+		const pid_t pid = fork();
+		if (pid == 0) {  // zygote process
+			close(fds[0]);
+			prctl(PR_SET_PDEATHSIG, SIGKILL);
+			serve(fds[1]);
+		}
+		close(fds[1]);
+		if (pid < 0) {
+			close(fds[0]);
+			return false;
+		}
+		socket() = fds[0];
+		return true;
+	}
+
+	/// fork a new worker serving the slot at offset in memory_fd, returns its pid or -1
+	static pid_t spawn(int memory_fd, size_t size, size_t offset, uint32_t capacity) {
+		std::lock_guard<std::mutex> lock(mutex());
+		if (socket() < 0)
+			return -1;
+
+		Request request{ offset, size, capacity };
+		char control[CMSG_SPACE(sizeof(int))] = {};
+		iovec iov{ &request, sizeof(request) };
+		msghdr msg{};
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		msg.msg_control = control;
+		msg.msg_controllen = sizeof(control);
+		cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		std::memcpy(CMSG_DATA(cmsg), &memory_fd, sizeof(int));
+
+		pid_t pid = -1;
+		if (sendmsg(socket(), &msg, MSG_NOSIGNAL) != sizeof(request) ||
+		    read(socket(), &pid, sizeof(pid)) != sizeof(pid)) {
+			close(socket());  // zygote died
+			socket() = -1;
+			return -1;
+		}
+		return pid;
+	}
+};
+
+bool ProcessPlanner::registerFactory(const std::type_info& type, Factory factory) {
+	if (Zygote::running())
+		return false;  // the zygote's (and thus the workers') registry has been forked already
+	factories()[type.name()] = std::move(factory);
+	return true;
+}
+
+bool ProcessPlanner::startZygote() {
+	factories();  // construct the registry before forking
+	return Zygote::start();
+}
+
+ProcessPlanner::ProcessPlanner(const PlannerInterfacePtr& planner) : planner_(planner) {
+	auto& p = properties();
+	p.declare<uint>("num_processes", 0u, "number of worker processes (0: number of CPU cores)");
+	p.declare<uint32_t>("buffer_size", 16u << 20, "bytes per worker for serialized requests and trajectories");
+}
+
+ProcessPlanner::~ProcessPlanner() {
+	stop();
+}
+
+void ProcessPlanner::init(const core::RobotModelConstPtr& robot_model) {
+	if (!planner_)
+		throw std::runtime_error("ProcessPlanner: invalid planner");
+	if (!startZygote())
+		throw std::runtime_error("ProcessPlanner: workers can only be forked from a single-threaded process. "
+		                         "Call ProcessPlanner::startZygote() before starting any threads.");
+	if (!factories().count(typeid(*planner_).name()))
+		throw std::runtime_error("ProcessPlanner: no factory registered for planner type " +
+		                         std::string(typeid(*planner_).name()));
+	planner_->initShared(robot_model);
+	robot_model_ = robot_model;
+
+	// workers rebuild the robot model and the planner from this setup
+	setup_ = std::make_unique<Setup>();
+	setup_->factory = typeid(*planner_).name();
+	std::unique_ptr<TiXmlDocument> urdf(urdf::exportURDF(*robot_model->getURDF()));
+	TiXmlPrinter printer;
+	urdf->Accept(&printer);
+	setup_->urdf = printer.CStr();
+	srdf::SRDFWriter srdf;
+	srdf.initModel(*robot_model->getURDF(), *robot_model->getSRDF());
+	setup_->srdf = srdf.getSRDFString();
+	for (const auto& pair : planner_->properties()) {
+		const std::string wire = pair.second.defined() ? pair.second.serialize() : std::string();
+		if (wire.empty())
+			continue;  // skip undefined and non-serializable properties
+		setup_->names.push_back(pair.first);
+		setup_->types.push_back(pair.second.typeName());
+		setup_->values.push_back(wire);
+	}
+
+	// restart workers with the new setup
+	stop();
+	size_t num = properties().get<uint>("num_processes");
+	if (num == 0)
+		num = std::max(1u, std::thread::hardware_concurrency());
+	start(num);
+}
+
+size_t ProcessPlanner::numProcesses() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return std::count_if(pids_.begin(), pids_.end(), [](pid_t pid) { return alive(pid); });
+}
+
+ProcessPlanner::Slot& ProcessPlanner::slot(size_t index) const {
+	return *reinterpret_cast<Slot*>(static_cast<uint8_t*>(memory_) + index * stride_);
+}
+
+void ProcessPlanner::start(size_t num) {
+	capacity_ = properties().get<uint32_t>("buffer_size");
+	// buffers also need to fit the setup, which is not limited by buffer_size
+	ser::LStream setup_length;
+	Setup::fields(setup_length, *setup_);
+	const size_t buffer = std::max<size_t>(capacity_, setup_length.getLength());
+	const size_t align = alignof(std::max_align_t);
+	stride_ = (sizeof(Slot) + buffer + align - 1) / align * align;
+	// shared memory, passed as fd to the zygote
+	memory_size_ = num * stride_;
+	memory_fd_ = memfd_create("mtc_process_planner", MFD_CLOEXEC);
+	if (memory_fd_ < 0 || ftruncate(memory_fd_, memory_size_) != 0 ||
+	    (memory_ = mmap(nullptr, memory_size_, PROT_READ | PROT_WRITE, MAP_SHARED, memory_fd_, 0)) == MAP_FAILED) {
+		const std::string error = strerror(errno);
+		if (memory_fd_ >= 0)
+			close(memory_fd_);
+		memory_fd_ = -1;
+		memory_ = nullptr;
+		throw std::runtime_error("ProcessPlanner: failed to allocate shared memory: " + error);
+	}
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	pids_.assign(num, -1);
+	idle_.clear();
+	for (size_t i = 0; i < num; ++i) {
+		new (&slot(i)) Slot();
+		spawn(i);
+		idle_.push_back(i);
+	}
+}
+
+void ProcessPlanner::stop() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	for (size_t i = 0; i < pids_.size(); ++i) {
+		Slot& s = slot(i);
+		{
+			SlotLock slot_lock(s.mutex);
+			s.state = Slot::STOP;
+		}
+		s.notify();
+	}
+	for (size_t i = 0; i < pids_.size(); ++i) {
+		// give the worker some time to finish, kill it otherwise
+		for (int wait = 0; alive(pids_[i]) && wait < 100; ++wait)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		if (alive(pids_[i]))
+			kill(pids_[i], SIGKILL);
+		slot(i).~Slot();
+	}
+	pids_.clear();
+	idle_.clear();
+	if (memory_)
+		munmap(memory_, memory_size_);
+	if (memory_fd_ >= 0)
+		close(memory_fd_);
+	memory_ = nullptr;
+	memory_fd_ = -1;
+}
+
+void ProcessPlanner::spawn(size_t index) {
+	// re-initialize the slot: a previous worker might have died holding its lock
+	Slot& s = slot(index);
+	s.~Slot();
+	new (&s) Slot();
+	store(*setup_, s.buffer(), static_cast<uint32_t>(stride_ - sizeof(Slot)), s.size);
+
+	const pid_t pid = Zygote::spawn(memory_fd_, memory_size_, index * stride_, capacity_);
+	if (pid < 0)
+		ROS_ERROR_STREAM_NAMED("ProcessPlanner", "failed to fork worker process");
+	pids_[index] = pid;
+}
+
+void ProcessPlanner::restart(size_t index, pid_t pid) {
+	if (alive(pid))
+		kill(pid, SIGKILL);
+	// the killed worker is gone before its slot gets re-initialized
+	for (int wait = 0; alive(pid) && wait < 100; ++wait)
+		std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (index < pids_.size() && pids_[index] == pid)
+		spawn(index);
+}
+
+void ProcessPlanner::work(Slot& slot, uint32_t capacity) {
+	PlannerInterfacePtr planner;
+	moveit::core::RobotModelConstPtr robot_model;
+	{
+		SlotLock lock(slot.mutex);
+		Setup setup;
+		Response failure;
+		if (slot.state != Slot::SETUP)
+			return;
+		if (!load(setup, slot.buffer(), slot.size))
+			failure.message = "invalid worker setup";
+		else {
+			try {
+				urdf::ModelInterfaceSharedPtr urdf = urdf::parseURDF(setup.urdf);
+				auto srdf = std::make_shared<srdf::Model>();
+				if (!urdf || !srdf->initString(*urdf, setup.srdf))
+					throw std::runtime_error("failed to parse robot model");
+				robot_model = std::make_shared<moveit::core::RobotModel>(urdf, srdf);
+
+				planner = factories().at(setup.factory)();
+				for (size_t i = 0; i < setup.names.size(); ++i) {
+					boost::any value = Property::deserialize(setup.types[i], setup.values[i]);
+					if (!value.empty())
+						planner->properties().set<boost::any>(setup.names[i], value);
+				}
+				planner->init(robot_model);
+			} catch (const std::exception& e) {
+				planner.reset();
+				failure.message = std::string("worker setup failed: ") + e.what();
+			}
+		}
+		if (planner)
+			slot.state = Slot::IDLE;
+		else {
+			store(failure, slot.buffer(), capacity, slot.size);
+			slot.state = Slot::FAILED;
+		}
+	}
+	slot.notify();
+	if (!planner)
+		return;
+
+	while (true) {
+		Job job;
+		bool valid;
+		{
+			SlotLock lock(slot.mutex);
+			while (slot.state != Slot::REQUEST && slot.state != Slot::STOP)
+				lock.wait(slot.cv);
+			if (slot.state == Slot::STOP)
+				return;
+			valid = load(job, slot.buffer(), slot.size);
+		}
+
+		Response response;
+		if (valid)
+			response = process(planner, robot_model, job);
+		else
+			response.message = "invalid planning request";
+
+		{
+			SlotLock lock(slot.mutex);
+			if (slot.state != Slot::REQUEST)
+				return;  // stopped meanwhile
+			if (!store(response, slot.buffer(), capacity, slot.size)) {
+				response = Response();
+				response.message = "trajectory exceeds buffer_size";
+				store(response, slot.buffer(), capacity, slot.size);
+			}
+			slot.state = Slot::DONE;
+		}
+		slot.notify();
+	}
+}
+
+ProcessPlanner::Response ProcessPlanner::process(const PlannerInterfacePtr& planner,
+                                                 const moveit::core::RobotModelConstPtr& robot_model,
+                                                 const Job& job) {
+	Response response;
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(job.group);
+	if (!jmg) {
+		response.message = "unknown group '" + job.group + "'";
+		return response;
+	}
+
+	auto from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	from->setPlanningSceneMsg(job.from);
+
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	Result result;
+	if (!job.cartesian) {
+		planning_scene::PlanningScenePtr to = from->diff();
+		to->getCurrentStateNonConst().setVariablePositions(job.to);
+		to->getCurrentStateNonConst().update();
+		result = planner->plan(from, to, jmg, job.timeout, trajectory, job.path_constraints);
+	} else {
+		const moveit::core::LinkModel* link = robot_model->getLinkModel(job.link);
+		if (!link) {
+			response.message = "unknown link '" + job.link + "'";
+			return response;
+		}
+		Eigen::Isometry3d offset, target;
+		tf2::fromMsg(job.offset, offset);
+		tf2::fromMsg(job.target, target);
+		result = planner->plan(from, *link, offset, target, jmg, job.timeout, trajectory, job.path_constraints);
+	}
+
+	response.success = result.success;
+	response.message = result.message;
+	if (trajectory)
+		trajectory->getRobotTrajectoryMsg(response.trajectory);
+	return response;
+}
+
+PlannerInterface::Result ProcessPlanner::exchange(size_t index, pid_t pid, const Job& job, Response& response) {
+	const utils::CancellationToken& cancellation = utils::CancellationToken::current();
+	Slot& s = slot(index);
+	SlotLock lock(s.mutex);
+	auto died = [&] { return lock.ownerDied() || !alive(pid); };
+	const char* failure = nullptr;  // reason to abandon (and kill) the worker
+
+	// wait for the worker to finish its setup
+	while (s.state == Slot::SETUP) {
+		if (died()) {
+			failure = "worker process died";
+			break;
+		}
+		if (cancellation.cancelled())
+			return { false, "cancelled" };  // the worker can finish its setup for the next request
+		lock.wait(s.cv, monotonicIn(POLL_INTERVAL));
+	}
+	if (!failure && s.state == Slot::FAILED) {  // keep the slot failed, as a restart would fail again
+		if (!load(response, s.buffer(), s.size))
+			return { false, "worker setup failed" };
+		return { false, response.message };
+	}
+
+	if (!failure) {
+		if (!store(job, s.buffer(), capacity_, s.size))
+			return { false, "planning request exceeds buffer_size" };
+		s.state = Slot::REQUEST;
+		s.notify();
+
+		// the worker's planner should respect the timeout, but might not
+		const bool bounded = std::isfinite(job.timeout) && job.timeout >= 0.0;
+		const auto deadline = std::chrono::steady_clock::now() +
+		                      std::chrono::duration<double>(bounded ? job.timeout + GRACE_PERIOD : 0.0);
+		while (s.state != Slot::DONE) {
+			if (died())
+				failure = "worker process died";
+			else if (cancellation.cancelled())
+				failure = "cancelled";
+			else if (bounded && std::chrono::steady_clock::now() > deadline)
+				failure = "timeout";
+			if (failure)
+				break;
+			lock.wait(s.cv, monotonicIn(POLL_INTERVAL));
+		}
+	}
+
+	if (failure) {  // kill the worker and restart it for the next request
+		lock.unlock();
+		restart(index, pid);
+		return { false, failure };
+	}
+	s.state = Slot::IDLE;
+	if (!load(response, s.buffer(), s.size))
+		return { false, "invalid response of worker process" };
+	return { true, std::string() };
+}
+
+PlannerInterface::Result ProcessPlanner::run(const Job& job, const planning_scene::PlanningSceneConstPtr& from,
+                                             robot_trajectory::RobotTrajectoryPtr& result) {
+	utils::ScopedTimer timer("planning", "ProcessPlanner::plan");
+	if (utils::CancellationToken::current().cancelled())
+		return { false, "cancelled" };
+
+	// check out an idle worker
+	size_t index;
+	pid_t pid;
+	{
+		std::unique_lock<std::mutex> lock(mutex_);
+		if (pids_.empty())
+			return { false, "no worker processes" };
+		idle_cv_.wait(lock, [this] { return !idle_.empty(); });
+		index = idle_.back();
+		idle_.pop_back();
+		pid = pids_[index];
+		if (pid < 0) {  // spawning failed before, retry
+			spawn(index);
+			pid = pids_[index];
+		}
+	}
+
+	Response response;
+	Result status = pid < 0 ? Result{ false, "failed to fork worker process" } : exchange(index, pid, job, response);
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		idle_.push_back(index);
+	}
+	idle_cv_.notify_one();
+	if (!status)
+		return status;
+
+	if (!response.trajectory.joint_trajectory.points.empty() ||
+	    !response.trajectory.multi_dof_joint_trajectory.points.empty()) {
+		result = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model_, job.group);
+		result->setRobotTrajectoryMsg(from->getCurrentState(), response.trajectory);
+	}
+	return { response.success != 0, response.message };
+}
+
+PlannerInterface::Result ProcessPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                              const planning_scene::PlanningSceneConstPtr& to,
+                                              const moveit::core::JointModelGroup* jmg, double timeout,
+                                              robot_trajectory::RobotTrajectoryPtr& result,
+                                              const moveit_msgs::Constraints& path_constraints) {
+	Job job;
+	from->getPlanningSceneMsg(job.from);
+	job.group = jmg->getName();
+	job.timeout = timeout;
+	job.path_constraints = path_constraints;
+	const moveit::core::RobotState& goal = to->getCurrentState();
+	job.to.assign(goal.getVariablePositions(), goal.getVariablePositions() + goal.getVariableCount());
+	return run(job, from, result);
+}
+
+PlannerInterface::Result ProcessPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                              const moveit::core::LinkModel& link, const Eigen::Isometry3d& offset,
+                                              const Eigen::Isometry3d& target, const moveit::core::JointModelGroup* jmg,
+                                              double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+                                              const moveit_msgs::Constraints& path_constraints) {
+	Job job;
+	job.cartesian = 1;
+	from->getPlanningSceneMsg(job.from);
+	job.group = jmg->getName();
+	job.timeout = timeout;
+	job.path_constraints = path_constraints;
+	job.link = link.getName();
+	job.offset = tf2::toMsg(offset);
+	job.target = tf2::toMsg(target);
+	return run(job, from, result);
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,196 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    plan on remote worker nodes
+ */
+
+#include <moveit/task_constructor/solvers/remote_planner.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/clients.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/moveit_error_code.h>
+#include <moveit_task_constructor_msgs/PlanTrajectory.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <mutex>
+#include <thread>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+struct RemotePlanner::Workers
+{
+	std::mutex mutex;
+	std::map<std::string, size_t> pending;  // pending requests per worker
+
+	// reserve the least busy worker not yet tried, empty if there is none
+	std::string acquire(const std::vector<std::string>& tried) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto best = pending.end();
+		for (auto it = pending.begin(); it != pending.end(); ++it) {
+			if (std::find(tried.begin(), tried.end(), it->first) != tried.end())
+				continue;
+			if (best == pending.end() || it->second < best->second)
+				best = it;
+		}
+		if (best == pending.end())
+			return std::string();
+		++best->second;
+		return best->first;
+	}
+
+	void release(const std::string& worker) {
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = pending.find(worker);
+		if (it != pending.end() && it->second > 0)  // the worker might have been reconfigured meanwhile
+			--it->second;
+	}
+};
+
+RemotePlanner::RemotePlanner(const std::vector<std::string>& workers) : workers_(std::make_shared<Workers>()) {
+	auto& p = properties();
+	p.declare<std::vector<std::string>>("workers", workers, "PlanTrajectory services of the planning workers");
+	p.declare<double>("reply_timeout", 5.0, "time allowed for communication beyond the planning time");
+}
+
+void RemotePlanner::init(const moveit::core::RobotModelConstPtr& /*robot_model*/) {
+	std::lock_guard<std::mutex> lock(workers_->mutex);
+	std::map<std::string, size_t> pending;  // keep counting requests still pending at remaining workers
+	for (const std::string& worker : properties().get<std::vector<std::string>>("workers")) {
+		auto it = workers_->pending.find(worker);
+		pending[worker] = it == workers_->pending.end() ? 0 : it->second;
+	}
+	workers_->pending.swap(pending);
+}
+
+size_t RemotePlanner::pending(const std::string& worker) const {
+	std::lock_guard<std::mutex> lock(workers_->mutex);
+	auto it = workers_->pending.find(worker);
+	return it == workers_->pending.end() ? 0 : it->second;
+}
+
+PlannerInterface::Result RemotePlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                             const moveit_msgs::MotionPlanRequest& req,
+                                             robot_trajectory::RobotTrajectoryPtr& result) {
+	utils::ScopedTimer timer("planning", "RemotePlanner::plan");
+	using Service = moveit_task_constructor_msgs::PlanTrajectory;
+	auto srv = std::make_shared<Service>();  // shared with the calling thread, which might be abandoned
+	from->getPlanningSceneMsg(srv->request.scene);  // the worker plans in (a copy of) the start scene
+	srv->request.request = req;
+
+	const utils::CancellationToken& cancellation = utils::CancellationToken::current();
+	const auto deadline = std::chrono::steady_clock::now() +
+	                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(
+	                          std::min(req.allowed_planning_time + properties().get<double>("reply_timeout"), 1e6)));
+	std::vector<std::string> tried;
+	for (std::string worker = workers_->acquire(tried); !worker.empty(); worker = workers_->acquire(tried)) {
+		if (cancellation.cancelled()) {
+			workers_->release(worker);
+			return { false, "cancelled" };
+		}
+
+		// service calls cannot be interrupted: call from a separate thread, which we stop waiting for if needed
+		std::promise<bool> promise;
+		std::future<bool> reply = promise.get_future();
+		std::thread([workers = workers_, worker, srv, promise = std::move(promise)]() mutable {
+			try {
+				const bool reachable = utils::ClientRegistry::instance().serviceClient<Service>(worker).call(*srv);
+				workers->release(worker);
+				promise.set_value(reachable);
+			} catch (...) {
+				workers->release(worker);
+				promise.set_exception(std::current_exception());
+			}
+		}).detach();
+		while (reply.wait_for(std::chrono::milliseconds(10)) != std::future_status::ready) {
+			if (cancellation.cancelled())
+				return { false, "cancelled" };
+			if (std::chrono::steady_clock::now() >= deadline)
+				return { false, "planning worker '" + worker + "' didn't reply within timeout" };
+		}
+		if (!reply.get()) {  // worker not reachable: try another one
+			ROS_WARN_STREAM_NAMED("RemotePlanner", "planning worker '" << worker << "' is not reachable");
+			tried.push_back(worker);
+			continue;
+		}
+
+		const moveit_msgs::MotionPlanResponse& res = srv->response.response;
+		const moveit::core::MoveItErrorCode error_code(res.error_code);
+		if (!error_code)
+			return { false, static_cast<std::string>(error_code) };
+		result = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), res.group_name);
+		result->setRobotTrajectoryMsg(from->getCurrentState(), res.trajectory_start, res.trajectory);
+		return { true, std::string() };
+	}
+	return { false, tried.empty() ? "no planning workers" : "no planning worker reachable" };
+}
+
+std::vector<PlannerInterface::Result>
+RemotePlanner::planBatch(const std::vector<Request>& requests,
+                         std::vector<robot_trajectory::RobotTrajectoryPtr>& results) {
+	std::vector<Result> status(requests.size(), Result{ false, "cancelled" });
+	results.resize(requests.size());
+
+	// each dispatcher thread keeps a single request pending, such that all workers are kept busy
+	std::atomic<size_t> next{ 0 };
+	auto dispatch = [&, cancellation = utils::CancellationToken::current()] {
+		utils::CancellationToken::Activation activation(cancellation);
+		for (size_t i = next++; i < requests.size() && !cancellation.cancelled(); i = next++) {
+			const Request& r = requests[i];
+			status[i] = PipelinePlanner::plan(r.from, r.to, r.jmg, r.timeout, results[i], r.path_constraints);
+		}
+	};
+	size_t num_threads = 1;
+	{
+		std::lock_guard<std::mutex> lock(workers_->mutex);
+		num_threads = std::max(num_threads, std::min(requests.size(), workers_->pending.size()));
+	}
+	std::vector<std::future<void>> threads;
+	for (size_t i = 1; i < num_threads; ++i)
+		threads.push_back(std::async(std::launch::async, dispatch));
+	dispatch();  // the calling thread takes part
+	for (auto& thread : threads)
+		thread.get();
+	return status;
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,490 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    multi-query planner, reusing a lazily validated roadmap across requests
+ */
+
+#include <moveit/task_constructor/solvers/roadmap_planner.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/collision_checker.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/utils.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <random_numbers/random_numbers.h>
+#include <ros/serialization.h>
+
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace solvers {
+
+namespace {
+enum class Validity : uint8_t
+{
+	UNKNOWN,
+	VALID,
+	INVALID
+};
+
+// validity of a roadmap element, remembered for the most recently validated contexts
+struct Validation
+{
+	static constexpr size_t CONTEXTS = 4;
+	std::array<size_t, CONTEXTS> contexts{};
+	std::array<Validity, CONTEXTS> validity{};
+	uint8_t next = 0;  // slot replaced when a new context is validated
+
+	Validity get(size_t current) const {
+		for (size_t i = 0; i < CONTEXTS; ++i)
+			if (validity[i] != Validity::UNKNOWN && contexts[i] == current)
+				return validity[i];
+		return Validity::UNKNOWN;
+	}
+	void set(size_t current, bool valid) {
+		size_t slot = next;
+		for (size_t i = 0; i < CONTEXTS; ++i)
+			if (validity[i] != Validity::UNKNOWN && contexts[i] == current)
+				slot = i;
+		if (slot == next)
+			next = (next + 1) % CONTEXTS;
+		contexts[slot] = current;
+		validity[slot] = valid ? Validity::VALID : Validity::INVALID;
+	}
+};
+
+// hash of everything affecting the validity of the group's configurations in scene
+size_t validationContext(const planning_scene::PlanningScene& scene, const moveit::core::JointModelGroup* jmg,
+                         const moveit_msgs::Constraints& path_constraints, double resolution) {
+	size_t seed = utils::worldHash(scene, resolution);
+
+	// joints outside the group
+	const moveit::core::RobotState& state = scene.getCurrentState();
+	std::vector<bool> planned(state.getVariableCount(), false);
+	for (int index : jmg->getVariableIndexList())
+		planned[index] = true;
+	for (size_t index = 0; index < planned.size(); ++index)
+		if (!planned[index])
+			boost::hash_combine(seed, std::lround(state.getVariablePosition(index) / resolution));
+
+	// allowed collisions
+	const collision_detection::AllowedCollisionMatrix& acm = scene.getAllowedCollisionMatrix();
+	std::vector<std::string> names;
+	acm.getAllEntryNames(names);
+	collision_detection::AllowedCollision::Type type;
+	for (size_t i = 0; i < names.size(); ++i) {
+		if (acm.getDefaultEntry(names[i], type)) {
+			boost::hash_combine(seed, names[i]);
+			boost::hash_combine(seed, static_cast<int>(type));
+		}
+		for (size_t j = i; j < names.size(); ++j)
+			if (acm.getAllowedCollision(names[i], names[j], type)) {
+				boost::hash_combine(seed, names[i]);
+				boost::hash_combine(seed, names[j]);
+				boost::hash_combine(seed, static_cast<int>(type));
+			}
+	}
+
+	// path constraints
+	const uint32_t length = ros::serialization::serializationLength(path_constraints);
+	std::vector<uint8_t> buffer(length);
+	ros::serialization::OStream stream(buffer.data(), length);
+	ros::serialization::serialize(stream, path_constraints);
+	boost::hash_range(seed, buffer.begin(), buffer.end());
+	return seed;
+}
+
+// validity checks of group configurations in a scene, submitting all states of a segment at once
+class Validator
+{
+public:
+	Validator(const planning_scene::PlanningScene& scene, const moveit::core::JointModelGroup* jmg,
+	          const moveit_msgs::Constraints& path_constraints, double resolution)
+	  : scene_(scene)
+	  , jmg_(jmg)
+	  , constraints_(scene.getRobotModel())
+	  , resolution_(resolution)
+	  , checker_(utils::collisionChecker())
+	  , positions_(jmg->getVariableCount()) {
+		constraints_.add(path_constraints, scene.getTransforms());
+	}
+
+	// check a single configuration
+	bool valid(const std::vector<double>& positions) {
+		if (!jmg_->satisfiesPositionBounds(positions.data()))
+			return false;
+		set(0, positions.data());
+		return check(1);
+	}
+
+	// check the interior of the straight-line segment from a to b
+	bool valid(const std::vector<double>& a, const std::vector<double>& b, double length) {
+		const size_t steps = static_cast<size_t>(std::ceil(length / resolution_));
+		for (size_t i = 1; i < steps; ++i) {
+			jmg_->interpolate(a.data(), b.data(), static_cast<double>(i) / steps, positions_.data());
+			set(i - 1, positions_.data());
+		}
+		return steps < 2 || check(steps - 1);
+	}
+
+private:
+	void set(size_t index, const double* positions) {
+		while (buffers_.size() <= index)
+			buffers_.emplace_back(scene_.getCurrentState());
+		buffers_[index].setJointGroupPositions(jmg_, positions);
+		buffers_[index].update();
+	}
+
+	bool check(size_t count) {
+		batch_.clear();
+		for (size_t i = 0; i < count; ++i)
+			batch_.push_back(&buffers_[i]);
+		if (checker_->firstCollision(scene_, jmg_->getName(), batch_) < count)
+			return false;
+		for (const moveit::core::RobotState* state : batch_)
+			if (!scene_.isStateFeasible(*state) || (!constraints_.empty() && !constraints_.decide(*state).satisfied))
+				return false;
+		return true;
+	}
+
+	const planning_scene::PlanningScene& scene_;
+	const moveit::core::JointModelGroup* jmg_;
+	kinematic_constraints::KinematicConstraintSet constraints_;
+	const double resolution_;
+	const utils::CollisionCheckerPtr checker_;
+	std::vector<double> positions_;
+	std::vector<moveit::core::RobotState> buffers_;
+	std::vector<const moveit::core::RobotState*> batch_;
+};
+}  // namespace
+
+struct RoadmapPlanner::Roadmap
+{
+	struct Node
+	{
+		std::vector<double> positions;
+		std::vector<size_t> edges;
+		Validation validation;
+	};
+	struct Edge
+	{
+		size_t a;
+		size_t b;
+		double length;
+		Validation validation;
+
+		size_t other(size_t node) const { return node == a ? b : a; }
+	};
+
+	explicit Roadmap(const moveit::core::JointModelGroup* jmg) : jmg(jmg) {}
+
+	const moveit::core::JointModelGroup* jmg;
+	std::mutex mutex;  // serializing requests
+	std::vector<Node> nodes;
+	std::vector<Edge> edges;
+	random_numbers::RandomNumberGenerator rng;
+
+	// add a node, connected to its nearest neighbors, reusing an existing node at the same position
+	size_t add(std::vector<double>&& positions, size_t neighbors) {
+		std::vector<std::pair<double, size_t>> nearest;
+		nearest.reserve(nodes.size());
+		for (size_t i = 0; i < nodes.size(); ++i) {
+			const double distance = jmg->distance(positions.data(), nodes[i].positions.data());
+			if (distance < 1e-9)
+				return i;
+			nearest.emplace_back(distance, i);
+		}
+		const size_t k = std::min(neighbors, nearest.size());
+		std::partial_sort(nearest.begin(), nearest.begin() + k, nearest.end());
+
+		const size_t index = nodes.size();
+		nodes.push_back(Node{ std::move(positions), {}, {} });
+		for (size_t i = 0; i < k; ++i) {
+			edges.push_back(Edge{ index, nearest[i].second, nearest[i].first, {} });
+			nodes[index].edges.push_back(edges.size() - 1);
+			nodes[nearest[i].second].edges.push_back(edges.size() - 1);
+		}
+		return index;
+	}
+
+	// remove all nodes and edges added after the roadmap had node_count nodes and edge_count edges
+	void truncate(size_t node_count, size_t edge_count) {
+		while (edges.size() > edge_count) {
+			const Edge& edge = edges.back();
+			// edges are appended to the nodes' lists in order, so the last edge is last in the lists, too
+			for (size_t node : { edge.a, edge.b })
+				if (node < node_count)
+					nodes[node].edges.pop_back();
+			edges.pop_back();
+		}
+		nodes.resize(node_count);
+	}
+
+	// A* search for the edges of a shortest path, skipping elements known to be invalid in context
+	bool shortestPath(size_t start, size_t goal, size_t context, std::vector<size_t>& path) const {
+		const double inf = std::numeric_limits<double>::infinity();
+		std::vector<double> cost(nodes.size(), inf);
+		std::vector<size_t> parent_edge(nodes.size());
+		auto heuristic = [this, goal](size_t node) {
+			return jmg->distance(nodes[node].positions.data(), nodes[goal].positions.data());
+		};
+
+		using Entry = std::pair<double, size_t>;  // estimated path cost, node
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+		cost[start] = 0.0;
+		open.emplace(heuristic(start), start);
+		while (!open.empty()) {
+			const Entry top = open.top();
+			open.pop();
+			const size_t node = top.second;
+			if (node == goal)
+				break;
+			if (top.first > cost[node] + heuristic(node))
+				continue;  // outdated entry
+			for (size_t e : nodes[node].edges) {
+				const Edge& edge = edges[e];
+				const size_t next = edge.other(node);
+				if (edge.validation.get(context) == Validity::INVALID ||
+				    nodes[next].validation.get(context) == Validity::INVALID)
+					continue;
+				const double c = cost[node] + edge.length;
+				if (c < cost[next]) {
+					cost[next] = c;
+					parent_edge[next] = e;
+					open.emplace(c + heuristic(next), next);
+				}
+			}
+		}
+
+		path.clear();
+		if (cost[goal] == inf)
+			return false;
+		for (size_t node = goal; node != start; node = edges[parent_edge[node]].other(node))
+			path.push_back(parent_edge[node]);
+		std::reverse(path.begin(), path.end());
+		return true;
+	}
+
+	// lazily validate the nodes and then the edges of path, remembering the results for context
+	bool validate(size_t start, const std::vector<size_t>& path, size_t context, Validator& validator) {
+		size_t node = start;
+		for (size_t e : path) {
+			node = edges[e].other(node);
+			Validation& validation = nodes[node].validation;
+			if (validation.get(context) == Validity::UNKNOWN)
+				validation.set(context, validator.valid(nodes[node].positions));
+			if (validation.get(context) == Validity::INVALID)
+				return false;
+		}
+		for (size_t e : path) {
+			Edge& edge = edges[e];
+			if (edge.validation.get(context) == Validity::UNKNOWN) {
+				const bool valid = validator.valid(nodes[edge.a].positions, nodes[edge.b].positions, edge.length);
+				edge.validation.set(context, valid);
+			}
+			if (edge.validation.get(context) == Validity::INVALID)
+				return false;
+		}
+		return true;
+	}
+};
+
+RoadmapPlanner::RoadmapPlanner() {
+	auto& p = properties();
+	p.declare<uint32_t>("max_nodes", 10000, "maximum number of roadmap nodes per group");
+	p.declare<uint32_t>("neighbors", 10, "number of nearest neighbors a new node is connected to");
+	p.declare<uint32_t>("samples", 100, "number of random samples added when no path is found");
+	p.declare<double>("resolution", 0.05, "joint-space distance between validated states along edges");
+}
+
+RoadmapPlanner::~RoadmapPlanner() = default;
+
+void RoadmapPlanner::init(const core::RobotModelConstPtr& robot_model) {
+	if (robot_model != robot_model_)
+		clear();
+	robot_model_ = robot_model;
+}
+
+PlannerInterface::Timing RoadmapPlanner::deferredTiming() const {
+	return properties().get<bool>("defer_timing") ? timing() : Timing();
+}
+
+std::shared_ptr<RoadmapPlanner::Roadmap> RoadmapPlanner::roadmap(const moveit::core::JointModelGroup* jmg) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	std::shared_ptr<Roadmap>& roadmap = roadmaps_[jmg];
+	if (!roadmap)
+		roadmap = std::make_shared<Roadmap>(jmg);
+	return roadmap;
+}
+
+void RoadmapPlanner::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	roadmaps_.clear();
+}
+
+size_t RoadmapPlanner::size(const moveit::core::JointModelGroup* jmg) const {
+	std::shared_ptr<Roadmap> roadmap;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto it = roadmaps_.find(jmg);
+		if (it == roadmaps_.end())
+			return 0;
+		roadmap = it->second;
+	}
+	std::lock_guard<std::mutex> lock(roadmap->mutex);
+	return roadmap->nodes.size();
+}
+
+PlannerInterface::Result RoadmapPlanner::plan(const planning_scene::PlanningSceneConstPtr& from,
+                                              const planning_scene::PlanningSceneConstPtr& to,
+                                              const moveit::core::JointModelGroup* jmg, double timeout,
+                                              robot_trajectory::RobotTrajectoryPtr& result,
+                                              const moveit_msgs::Constraints& path_constraints) {
+	utils::ScopedTimer timer("planning", "RoadmapPlanner::plan");
+	const auto& props = properties();
+	timeout = std::min(timeout, props.get<double>("timeout"));
+	const auto deadline = std::chrono::steady_clock::now() +
+	                      std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+	                          std::chrono::duration<double>(std::min(timeout, 1e6)));
+	const double resolution = props.get<double>("resolution");
+	const size_t max_nodes = props.get<uint32_t>("max_nodes");
+	const size_t neighbors = props.get<uint32_t>("neighbors");
+	const size_t samples = std::max<size_t>(props.get<uint32_t>("samples"), 1);
+
+	const moveit::core::RobotState& from_state = from->getCurrentState();
+	const moveit::core::RobotState& to_state = to->getCurrentState();
+	result = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+	result->addSuffixWayPoint(from_state, 0.0);
+
+	// validate start and goal in the current scene, independently of the roadmap
+	Validator validator(*from, jmg, path_constraints, resolution);
+	std::vector<double> start_positions, goal_positions;
+	from_state.copyJointGroupPositions(jmg, start_positions);
+	to_state.copyJointGroupPositions(jmg, goal_positions);
+	if (!validator.valid(start_positions))
+		return { false, "Start state is invalid!" };
+	if (!validator.valid(goal_positions)) {
+		result->addSuffixWayPoint(to_state, 0.0);
+		return { false, "Goal state is invalid!" };
+	}
+
+	std::shared_ptr<Roadmap> roadmap = this->roadmap(jmg);
+	std::lock_guard<std::mutex> lock(roadmap->mutex);
+	const size_t context = validationContext(*from, jmg, path_constraints, resolution);
+
+	// start and goal are only kept if the roadmap doesn't exceed max_nodes
+	struct Restore
+	{
+		Roadmap& roadmap;
+		const size_t max_nodes, node_count, edge_count;
+		~Restore() {
+			if (roadmap.nodes.size() > max_nodes)
+				roadmap.truncate(node_count, edge_count);
+		}
+	} restore{ *roadmap, max_nodes, roadmap->nodes.size(), roadmap->edges.size() };
+	const size_t start = roadmap->add(std::move(start_positions), neighbors);
+	const size_t goal = roadmap->add(std::move(goal_positions), neighbors);
+	roadmap->nodes[start].validation.set(context, true);
+	roadmap->nodes[goal].validation.set(context, true);
+
+	const utils::CancellationToken& cancellation = utils::CancellationToken::current();
+	std::vector<size_t> path;
+	std::vector<double> positions(jmg->getVariableCount());
+	while (true) {
+		if (cancellation.cancelled())
+			return { false, "cancelled" };
+		const bool found = roadmap->shortestPath(start, goal, context, path);
+		if (found && roadmap->validate(start, path, context, validator))
+			break;
+		if (std::chrono::steady_clock::now() >= deadline)
+			return { false, "No valid path found within timeout" };
+		if (found)
+			continue;  // search again, avoiding the invalid elements
+		if (roadmap->nodes.size() >= max_nodes)
+			return { false, "Roadmap is exhausted" };
+
+		// grow the roadmap
+		for (size_t i = 0; i < samples && roadmap->nodes.size() < max_nodes; ++i) {
+			jmg->getVariableRandomPositions(roadmap->rng, positions.data());
+			roadmap->add(std::vector<double>(positions), neighbors);
+		}
+	}
+
+	// interpolate along the path's edges, ending at the exact goal state
+	moveit::core::RobotState waypoint(from_state);
+	size_t node = start;
+	for (size_t e : path) {
+		const Roadmap::Edge& edge = roadmap->edges[e];
+		const size_t next = edge.other(node);
+		const std::vector<double>& a = roadmap->nodes[node].positions;
+		const std::vector<double>& b = roadmap->nodes[next].positions;
+		const size_t steps = std::max<size_t>(static_cast<size_t>(std::ceil(edge.length / resolution)), 1);
+		for (size_t i = 1; i <= steps; ++i) {
+			if (next == goal && i == steps)
+				break;
+			jmg->interpolate(a.data(), b.data(), static_cast<double>(i) / steps, positions.data());
+			waypoint.setJointGroupPositions(jmg, positions.data());
+			waypoint.update();
+			result->addSuffixWayPoint(waypoint, 0.0);
+		}
+		node = next;
+	}
+	result->addSuffixWayPoint(to_state, 0.0);
+
+	if (!props.get<bool>("defer_timing"))
+		timing()(*result);
+	return { true, "" };
+}
+
+PlannerInterface::Result RoadmapPlanner::plan(const planning_scene::PlanningSceneConstPtr& /*from*/,
+                                              const moveit::core::LinkModel& /*link*/,
+                                              const Eigen::Isometry3d& /*offset*/, const Eigen::Isometry3d& /*target*/,
+                                              const moveit::core::JointModelGroup* /*jmg*/, double /*timeout*/,
+                                              robot_trajectory::RobotTrajectoryPtr& /*result*/,
+                                              const moveit_msgs::Constraints& /*path_constraints*/) {
+	return { false, "RoadmapPlanner doesn't support Cartesian goals" };
+}
+}  // namespace solvers
+}  // namespace task_constructor
+}  // namespace moveit
@@ -38,15 +38,24 @@
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/task_constructor/container_p.h>
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/reclaimer.h>
+#include <moveit/task_constructor/async_dispatcher.h>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/task_constructor/utils.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 
+#include <boost/functional/hash.hpp>
 #include <ros/console.h>
 #include <fmt/core.h>
 
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <cmath>
+#include <limits>
+#include <mutex>
+#include <unordered_set>
 #include <utility>
 
 namespace moveit {
@@ -96,13 +105,146 @@ std::ostream& operator<<(std::ostream& os, const InitStageException& e) {
 	return os;
 }
 
+namespace {
+// buffer receiving deferred actions of the current thread
+thread_local DeferredActions* active_deferred_actions = nullptr;
+}  // namespace
+
+DeferredActions::Scope::Scope(DeferredActions& actions) : previous_(active_deferred_actions) {
+	active_deferred_actions = &actions;
+}
+
+DeferredActions::Scope::~Scope() {
+	active_deferred_actions = previous_;
+}
+
+bool DeferredActions::defer(Action&& action) {
+	if (!active_deferred_actions)
+		return false;
+	active_deferred_actions->actions_.emplace_back(std::move(action));
+	return true;
+}
+
+void DeferredActions::apply() {
+	std::vector<Action> actions;
+	actions.swap(actions_);
+	// If another scope is active (nested concurrency), actions are just passed on to that scope.
+	for (auto& action : actions)
+		action();
+}
+
+/** Background evaluation of solution costs, enabled by the Stage property async_cost
+ *
+ * Jobs are evaluated in order on a dedicated thread, batches of them concurrently on the task's thread pool
+ * (or the shared one if planning sequentially).
+ * The planning thread collects the store actions of evaluated jobs via finished(), in order of submission, too.
+ */
+class AsyncCosts
+{
+public:
+	using Action = DeferredActions::Action;
+
+	AsyncCosts() : dispatcher_([this](const std::vector<JobPtr>& batch) { evaluate(batch); }) {}
+	~AsyncCosts() { discard(); }
+
+	void push(Action&& evaluate, Action&& store, utils::ThreadPool* pool) {
+		auto job = std::make_shared<Job>();
+		job->evaluate = std::move(evaluate);
+		job->store = std::move(store);
+		job->pool = pool;
+		job->profiling = utils::Profiler::context();
+		{
+			std::lock_guard<std::mutex> lock(mutex_);
+			jobs_.push_back(job);
+		}
+		dispatcher_.push(std::move(job));  // blocks if too many jobs are pending
+	}
+
+	/// store actions of all evaluated jobs, waiting for the remaining ones if wait is true
+	std::vector<Action> finished(bool wait) {
+		if (wait)
+			dispatcher_.flush();
+		std::vector<Action> actions;
+		std::lock_guard<std::mutex> lock(mutex_);
+		while (!jobs_.empty() && jobs_.front()->done.load(std::memory_order_acquire)) {
+			JobPtr job = std::move(jobs_.front());
+			jobs_.pop_front();
+			if (job->error)
+				std::rethrow_exception(job->error);  // thrown by a cost term
+			actions.push_back(std::move(job->store));
+		}
+		return actions;
+	}
+
+	bool empty() const {
+		std::lock_guard<std::mutex> lock(mutex_);
+		return jobs_.empty();
+	}
+
+	/// skip evaluation of queued jobs, wait for running ones, and drop all of them
+	void discard() {
+		discarded_ = true;
+		dispatcher_.flush();
+		std::lock_guard<std::mutex> lock(mutex_);
+		jobs_.clear();
+		discarded_ = false;
+	}
+
+private:
+	struct Job
+	{
+		Action evaluate;
+		Action store;
+		utils::ThreadPool* pool;
+		utils::Profiler::Context profiling;
+		std::exception_ptr error;
+		std::atomic<bool> done{ false };
+	};
+	using JobPtr = std::shared_ptr<Job>;
+
+	void evaluate(const std::vector<JobPtr>& batch) {
+		const auto run = [this](Job& job) {
+			if (!discarded_) {
+				utils::Profiler::Activation activation(job.profiling);
+				try {
+					job.evaluate();
+				} catch (...) {
+					job.error = std::current_exception();
+				}
+			}
+			job.done.store(true, std::memory_order_release);
+		};
+		if (batch.size() < 2) {
+			run(*batch.front());
+			return;
+		}
+		// planning sequentially: evaluate on the shared pool, at low priority like all background work
+		utils::ThreadPool* pool = batch.front()->pool;
+		if (!pool)
+			pool = &utils::ThreadPool::shared();
+		std::vector<utils::ThreadPool::Job> jobs;
+		jobs.reserve(batch.size());
+		for (const JobPtr& job : batch)
+			jobs.emplace_back([&run, job] { run(*job); });
+		pool->run(jobs, utils::ThreadPool::LOW);
+	}
+
+	mutable std::mutex mutex_;
+	std::deque<JobPtr> jobs_;  // submitted jobs, in order
+	std::atomic<bool> discarded_{ false };
+	utils::AsyncDispatcher<JobPtr> dispatcher_;  // declared last: stops evaluating before other members are destroyed
+};
+
 StagePrivate::StagePrivate(Stage* me, const std::string& name)
   : me_{ me }
   , name_{ name }
   , cost_term_{ std::make_unique<CostTerm>() }
   , total_compute_time_{}
   , parent_{ nullptr }
-  , introspection_{ nullptr } {}
+  , introspection_{ nullptr }
+  , thread_pool_{ nullptr } {}
+
+StagePrivate::~StagePrivate() = default;
 
 StagePrivate& StagePrivate::operator=(StagePrivate&& other) {
 	assert(typeid(*this) == typeid(other));
@@ -158,27 +300,181 @@ void StagePrivate::validateConnectivity() const {
 bool StagePrivate::storeSolution(const SolutionBasePtr& solution, const InterfaceState* from,
                                  const InterfaceState* to) {
 	solution->setCreator(me());
+	invalidateMemoryUsage();
 	if (introspection_)
 		introspection_->registerSolution(*solution);
 
 	if (solution->isFailure()) {
 		++num_failures_;
+		++failure_counts_[static_cast<size_t>(solution->failureCode())];
 		if (parent())
 			parent()->pimpl()->onNewFailure(*me(), from, to);
 		if (!storeFailures())
-			return false;  // drop solution
+			return false;  // drop solution, never rendering a lazy comment
+		solution->comment();  // render a lazy comment before sharing the solution
+		compactSolution(*solution);
 		failures_.push_back(solution);
+		if (max_stored_failures_ > 0 && failures_.size() > max_stored_failures_) {
+			SolutionBaseConstPtr oldest = std::move(failures_.front());
+			failures_.pop_front();
+			discardSolution(oldest);
+		}
 	} else {
+		compactSolution(*solution);
 		solutions_.insert(solution);
 	}
 	return true;
 }
 
+namespace {
+// solutions and states released by a reset, destroyed by a Reclaimer
+template <typename Solutions, typename Failures, typename States>
+struct ReleasedGraph
+{
+	Solutions solutions;
+	Failures failures;
+	States states;
+};
+}  // namespace
+
+void StagePrivate::releaseSolutions() {
+	invalidateMemoryUsage();
+	if (!reclaimer_ || (solutions_.empty() && failures_.empty() && states_.empty())) {
+		solutions_.clear();
+		failures_.clear();
+		states_.clear();
+		return;
+	}
+	// pull interfaces were cleared already and solutions don't access their states on destruction
+	using Graph = ReleasedGraph<decltype(solutions_), decltype(failures_), StateList>;
+	Graph graph{ std::move(solutions_), std::move(failures_), StateList(states_.get_allocator()) };
+	graph.states.swap(states_);
+	solutions_.clear();  // moved-from containers are valid, but not necessarily empty
+	failures_.clear();
+	reclaimer_->retire(std::move(graph));
+}
+
+void StagePrivate::compactSolution(SolutionBase& solution) const {
+	if (!compact_trajectories_)
+		return;
+	if (auto* sub = dynamic_cast<SubTrajectory*>(&solution))
+		sub->compact();
+}
+
+void StagePrivate::discardSolution(const SolutionBaseConstPtr& solution) {
+	if (introspection_)
+		introspection_->unregisterSolution(*solution);
+
+	const InterfaceState* start = solution->start();
+	const InterfaceState* end = solution->end();
+	const_cast<SolutionBase&>(*solution).detach();
+	invalidateMemoryUsage();
+
+	// free states created for this solution only, e.g. the end state of a failed forward propagation
+	for (const InterfaceState* state : { start, end }) {
+		if (!state || state->owner() || !state->incomingTrajectories().empty() ||
+		    !state->outgoingTrajectories().empty())
+			continue;
+		auto it = std::find_if(states_.begin(), states_.end(), [state](const InterfaceState& s) { return &s == state; });
+		if (it != states_.end())
+			states_.erase(it);
+	}
+}
+
+void StagePrivate::dropFailures() {
+	drop_failures_ = true;
+	while (!failures_.empty()) {
+		SolutionBaseConstPtr failure = std::move(failures_.front());
+		failures_.pop_front();
+		discardSolution(failure);
+	}
+}
+
+size_t StagePrivate::evictDisabledStates(double fraction) {
+	applyEvaluatedCosts(true);  // pending solutions refer to states, which mustn't be removed before
+	size_t evicted = 0;
+	for (const InterfacePtr& interface : { starts_, ends_ }) {
+		if (!interface)
+			continue;
+		// disabled states are sorted behind the enabled ones, the worst (pruned) ones last
+		std::vector<Interface::iterator> disabled;
+		for (auto it = interface->begin(), end = interface->end(); it != end; ++it)
+			if (!it->priority().enabled())
+				disabled.push_back(it);
+		const auto count = static_cast<size_t>(std::ceil(fraction * disabled.size()));
+		for (auto it = disabled.end() - count; it != disabled.end(); ++it) {
+			onEvictState(**it);
+			if (parent())  // e.g. Fallbacks shares the interfaces of its first child with later ones
+				parent()->pimpl()->onEvictChildState(*me(), **it);
+			interface->remove(*it);
+		}
+		evicted += count;
+	}
+	return evicted;
+}
+
+size_t StagePrivate::releaseOrphanedStates() {
+	applyEvaluatedCosts(true);  // pending solutions refer to states, which aren't linked to them yet
+	size_t released = 0;
+	for (auto it = states_.begin(); it != states_.end();) {
+		if (it->owner() || !it->incomingTrajectories().empty() || !it->outgoingTrajectories().empty()) {
+			++it;
+			continue;
+		}
+		onReleaseState(*it);
+		it = states_.erase(it);  // releasing its scene, unless shared with other states
+		++released;
+	}
+	if (released)
+		invalidateMemoryUsage();
+	return released;
+}
+
+void StagePrivate::compactSolutions() {
+	compact_trajectories_ = true;
+	invalidateMemoryUsage();
+	for (const auto& solution : solutions_)
+		compactSolution(const_cast<SolutionBase&>(*solution));
+	for (const auto& failure : failures_)
+		compactSolution(const_cast<SolutionBase&>(*failure));
+}
+
+void StagePrivate::propagate(Interface& interface, InterfaceState& state) {
+	if (dedup_resolution_ <= 0.0)
+		interface.add(state);
+	else if (!interface.addUnique(state, dedup_resolution_))
+		ROS_DEBUG_STREAM_NAMED("Stage", fmt::format("'{}': skipped duplicate state", name()));
+}
+
+void StagePrivate::propagate(Interface& interface, const std::vector<InterfaceState*>& states) {
+	if (dedup_resolution_ <= 0.0)
+		interface.add(states);
+	else  // duplicates need to be checked one by one
+		for (InterfaceState* state : states)
+			propagate(interface, *state);
+}
+
 void StagePrivate::sendForward(const InterfaceState& from, InterfaceState&& to, const SolutionBasePtr& solution) {
+	if (DeferredActions::defer([this, &from, to = std::make_shared<InterfaceState>(std::move(to)), solution] {
+		    sendForward(from, std::move(*to), solution);
+	    }))
+		return;
 	assert(nextStarts());
 
+	if (async_cost_ && !solution->isFailure()) {
+		// cost terms see a copy of from, which the planning thread may modify meanwhile
+		auto start = std::make_shared<const InterfaceState>(from);
+		auto end = std::make_shared<InterfaceState>(std::move(to));
+		const InterfaceState* source = &from;
+		evaluateCostAsync([this, start, end, solution] { computeCost(*start, *end, *solution); },
+		                  [this, source, end, solution] { storeForward(*source, std::move(*end), solution); });
+		return;
+	}
 	computeCost(from, to, *solution);
+	storeForward(from, std::move(to), solution);
+}
 
+void StagePrivate::storeForward(const InterfaceState& from, InterfaceState&& to, const SolutionBasePtr& solution) {
 	if (!storeSolution(solution, &from, nullptr))
 		return;  // solution dropped
 
@@ -191,16 +487,32 @@ void StagePrivate::sendForward(const InterfaceState& from, InterfaceState&& to,
 	solution->setEndState(*to_it);
 
 	if (!solution->isFailure())
-		nextStarts()->add(*to_it);
+		propagate(*nextStarts(), *to_it);
 
 	newSolution(solution);
 }
 
 void StagePrivate::sendBackward(InterfaceState&& from, const InterfaceState& to, const SolutionBasePtr& solution) {
+	if (DeferredActions::defer([this, from = std::make_shared<InterfaceState>(std::move(from)), &to, solution] {
+		    sendBackward(std::move(*from), to, solution);
+	    }))
+		return;
 	assert(prevEnds());
 
+	if (async_cost_ && !solution->isFailure()) {
+		// cost terms see a copy of to, which the planning thread may modify meanwhile
+		auto start = std::make_shared<InterfaceState>(std::move(from));
+		auto end = std::make_shared<const InterfaceState>(to);
+		const InterfaceState* target = &to;
+		evaluateCostAsync([this, start, end, solution] { computeCost(*start, *end, *solution); },
+		                  [this, start, target, solution] { storeBackward(std::move(*start), *target, solution); });
+		return;
+	}
 	computeCost(from, to, *solution);
+	storeBackward(std::move(from), to, solution);
+}
 
+void StagePrivate::storeBackward(InterfaceState&& from, const InterfaceState& to, const SolutionBasePtr& solution) {
 	if (!storeSolution(solution, nullptr, &to))
 		return;  // solution dropped
 
@@ -212,16 +524,31 @@ void StagePrivate::sendBackward(InterfaceState&& from, const InterfaceState& to,
 	solution->setEndState(to);
 
 	if (!solution->isFailure())
-		prevEnds()->add(*from_it);
+		propagate(*prevEnds(), *from_it);
 
 	newSolution(solution);
 }
 
 void StagePrivate::spawn(InterfaceState&& from, InterfaceState&& to, const SolutionBasePtr& solution) {
+	if (DeferredActions::defer([this, from = std::make_shared<InterfaceState>(std::move(from)),
+	                            to = std::make_shared<InterfaceState>(std::move(to)), solution] {
+		    spawn(std::move(*from), std::move(*to), solution);
+	    }))
+		return;
 	assert(prevEnds() && nextStarts());
 
+	if (async_cost_ && !solution->isFailure()) {
+		auto start = std::make_shared<InterfaceState>(std::move(from));
+		auto end = std::make_shared<InterfaceState>(std::move(to));
+		evaluateCostAsync([this, start, end, solution] { computeCost(*start, *end, *solution); },
+		                  [this, start, end, solution] { storeSpawn(std::move(*start), std::move(*end), solution); });
+		return;
+	}
 	computeCost(from, to, *solution);
+	storeSpawn(std::move(from), std::move(to), solution);
+}
 
+void StagePrivate::storeSpawn(InterfaceState&& from, InterfaceState&& to, const SolutionBasePtr& solution) {
 	if (!storeSolution(solution, nullptr, nullptr))
 		return;  // solution dropped
 
@@ -232,8 +559,8 @@ void StagePrivate::spawn(InterfaceState&& from, InterfaceState&& to, const Solut
 	solution->setEndState(*to_it);
 
 	if (!solution->isFailure()) {
-		prevEnds()->add(*from_it);
-		nextStarts()->add(*to_it);
+		propagate(*prevEnds(), *from_it);
+		propagate(*nextStarts(), *to_it);
 	}
 
 	newSolution(solution);
@@ -243,9 +570,78 @@ void StagePrivate::spawn(InterfaceState&& state, const SolutionBasePtr& solution
 	spawn(InterfaceState(state), std::move(state), solution);
 }
 
+void StagePrivate::spawnBatch(std::vector<std::pair<InterfaceState, SolutionBasePtr>>&& batch) {
+	using Batch = std::vector<std::pair<InterfaceState, SolutionBasePtr>>;
+	if (DeferredActions::defer([this, batch = std::make_shared<Batch>(std::move(batch))] {
+		    spawnBatch(std::move(*batch));
+	    }))
+		return;
+	assert(prevEnds() && nextStarts());
+
+	const auto evaluate = [this](Batch& batch) {
+		for (auto& entry : batch)
+			computeCost(entry.first, entry.first, *entry.second);
+	};
+	if (async_cost_) {
+		auto pending = std::make_shared<Batch>(std::move(batch));
+		evaluateCostAsync([evaluate, pending] { evaluate(*pending); },
+		                  [this, pending] { storeBatch(std::move(*pending)); });
+		return;
+	}
+	evaluate(batch);
+	storeBatch(std::move(batch));
+}
+
+void StagePrivate::storeBatch(std::vector<std::pair<InterfaceState, SolutionBasePtr>>&& batch) {
+	std::vector<SolutionBasePtr> stored;
+	std::vector<InterfaceState*> froms, tos;
+	stored.reserve(batch.size());
+	froms.reserve(batch.size());
+	tos.reserve(batch.size());
+	for (auto& entry : batch) {
+		InterfaceState& state = entry.first;
+		const SolutionBasePtr& solution = entry.second;
+		if (!storeSolution(solution, nullptr, nullptr))
+			continue;  // solution dropped
+
+		auto from_it = states_.insert(states_.end(), InterfaceState(state));
+		auto to_it = states_.insert(states_.end(), std::move(state));
+
+		solution->setStartState(*from_it);
+		solution->setEndState(*to_it);
+
+		if (!solution->isFailure()) {
+			froms.push_back(&*from_it);
+			tos.push_back(&*to_it);
+		}
+		stored.push_back(solution);
+	}
+
+	propagate(*prevEnds(), froms);
+	propagate(*nextStarts(), tos);
+
+	for (const SolutionBasePtr& solution : stored)
+		newSolution(solution);
+}
+
 void StagePrivate::connect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& solution) {
+	if (DeferredActions::defer([this, &from, &to, solution] { connect(from, to, solution); }))
+		return;
+	if (async_cost_ && !solution->isFailure()) {
+		// cost terms see copies of the states, which the planning thread may modify meanwhile
+		auto start = std::make_shared<const InterfaceState>(from);
+		auto end = std::make_shared<const InterfaceState>(to);
+		const InterfaceState* source = &from;
+		const InterfaceState* target = &to;
+		evaluateCostAsync([this, start, end, solution] { computeCost(*start, *end, *solution); },
+		                  [this, source, target, solution] { storeConnect(*source, *target, solution); });
+		return;
+	}
 	computeCost(from, to, *solution);
+	storeConnect(from, to, solution);
+}
 
+void StagePrivate::storeConnect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& solution) {
 	if (!storeSolution(solution, &from, &to))
 		return;  // solution dropped
 
@@ -255,6 +651,31 @@ void StagePrivate::connect(const InterfaceState& from, const InterfaceState& to,
 	newSolution(solution);
 }
 
+void StagePrivate::evaluateCostAsync(DeferredActions::Action&& evaluate, DeferredActions::Action&& store) {
+	if (!async_costs_)
+		async_costs_ = std::make_unique<AsyncCosts>();
+	async_costs_->push(std::move(evaluate), std::move(store), threadPool());
+}
+
+void StagePrivate::applyEvaluatedCosts(bool wait) {
+	if (!async_costs_)
+		return;
+	for (auto& store : async_costs_->finished(wait)) {
+		// storing modifies interfaces, which needs to be deferred while computing concurrently
+		if (!DeferredActions::defer(std::move(store)))
+			store();
+	}
+}
+
+bool StagePrivate::hasPendingCosts() const {
+	return async_costs_ && !async_costs_->empty();
+}
+
+void StagePrivate::discardPendingCosts() {
+	if (async_costs_)
+		async_costs_->discard();
+}
+
 void StagePrivate::newSolution(const SolutionBasePtr& solution) {
 	// call solution callbacks for both, valid solutions and failures
 	for (const auto& cb : solution_cbs_)
@@ -284,18 +705,25 @@ struct TmpSolutionContext
 		solution_.creator_ = nullptr;
 	}
 };
-void StagePrivate::computeCost(const InterfaceState& from, const InterfaceState& to, SolutionBase& solution) {
+void StagePrivate::computeCost(const InterfaceState& from, const InterfaceState& to, SolutionBase& solution,
+                               double bound) {
 	// no reason to compute costs for a failed solution
 	if (solution.isFailure())
 		return;
 
+	utils::ScopedTimer timer("cost", "computeCost");
+
 	// Temporarily set start/end states of the solution w/o actually registering the solution with them
 	// This allows CostTerms to compute costs based on the InterfaceState.
 	TmpSolutionContext tip(solution, me(), from, to);
 
 	std::string comment;
 	assert(cost_term_);
+	CostTerm::ScopedBound scoped_bound(bound);
+	CostTerm::ScopedExplainFailures scoped_explain(storeFailures());
 	solution.setCost(solution.computeCost(*cost_term_, comment));
+	if (solution.isFailure())
+		solution.markAsFailure(FailureCode::COST);
 
 	// If a comment was specified, add it to the solution
 	if (!comment.empty() && !solution.comment().empty()) {
@@ -309,12 +737,27 @@ Stage::Stage(StagePrivate* impl) : pimpl_(impl) {
 	assert(impl);
 	auto& p = properties();
 	p.declare<double>("timeout", "timeout per run (s)");
+	p.declare<double>("compute_budget", 0.0, "total compute time granted per plan (s), 0: unlimited");
+	p.declare<double>("timeout_percentile", 0.0,
+	                  "tune timeout to this fraction in (0, 1] of successful compute durations (0: disabled)");
 	p.declare<std::string>("marker_ns", name(), "marker namespace");
+	p.declare<MarkerLevel>("marker_level", MARKERS_FULL, "amount of generated markers (none, basic, full)");
+	p.declare<bool>("compact_trajectories", false,
+	                "store only the group's joint values of solution trajectories, rebuilding them on demand");
+	p.declare<bool>("async_cost", false,
+	                "evaluate costs of new solutions in the background, storing them once evaluated");
+	p.configureInitFrom(PARENT, { "marker_level", "compact_trajectories", "async_cost" });
 	p.declare<TrajectoryExecutionInfo>("trajectory_execution_info", TrajectoryExecutionInfo(),
 	                                   "settings used when executing the trajectory");
 
 	p.declare<std::set<std::string>>("forwarded_properties", std::set<std::string>(),
 	                                 "set of interface properties to forward");
+	p.declare<uint32_t>("max_stored_failures", 0u, "number of most recent failures to store for introspection (0: all)");
+	p.declare<double>("dedup_resolution", 0.0,
+	                  "don't propagate states whose joints match a previous state within this resolution (0: disabled)");
+	p.declare<size_t>("max_interface_states", 0,
+	                  "beam width: max number of enabled states kept in each input interface, "
+	                  "deferring the worst ones (0: unlimited)");
 }
 
 Stage::~Stage() {
@@ -331,22 +774,26 @@ Stage::operator const StagePrivate*() const {
 
 void Stage::reset() {
 	auto impl = pimpl();
-	// clear solutions + associated states
-	impl->solutions_.clear();
-	impl->failures_.clear();
-	impl->num_failures_ = 0u;
-	impl->states_.clear();
+	// solutions evaluated in the background refer to states released below
+	impl->discardPendingCosts();
 	// clear pull interfaces
 	if (impl->starts_)
 		impl->starts_->clear();
 	if (impl->ends_)
 		impl->ends_->clear();
+	// clear solutions + associated states
+	impl->releaseSolutions();
+	impl->num_failures_ = 0u;
+	impl->failure_counts_.fill(0u);
+	impl->drop_failures_ = false;
 	// reset push interfaces
 	impl->prev_ends_.reset();
 	impl->next_starts_.reset();
 	// reset inherited properties
 	impl->properties_.reset();
 	impl->total_compute_time_ = std::chrono::duration<double>::zero();
+	impl->num_computes_ = 0;
+	impl->compute_latency_.clear();
 }
 
 void Stage::init(const moveit::core::RobotModelConstPtr& /* robot_model */) {
@@ -366,6 +813,23 @@ void Stage::init(const moveit::core::RobotModelConstPtr& /* robot_model */) {
 			throw InitStageException(*this, oss.str());
 		}
 	}
+	impl->dedup_resolution_ = impl->properties_.get<double>("dedup_resolution");
+	impl->max_stored_failures_ = impl->properties_.get<uint32_t>("max_stored_failures");
+	impl->max_interface_states_ = impl->properties_.get<size_t>("max_interface_states");
+	impl->compute_budget_ = impl->properties_.get<double>("compute_budget");
+	impl->timeout_percentile_ = impl->properties_.get<double>("timeout_percentile");
+	if (impl->timeout_percentile_ < 0.0 || impl->timeout_percentile_ > 1.0)
+		throw InitStageException(*this, "timeout_percentile must be a fraction in (0, 1], or 0 to disable tuning");
+	{
+		const boost::any& timeout = impl->properties_.property("timeout").value();
+		impl->configured_timeout_ =
+		    timeout.empty() ? std::numeric_limits<double>::infinity() : boost::any_cast<double>(timeout);
+	}
+	impl->tuneTimeout();
+	impl->marker_level_ = impl->properties_.get<MarkerLevel>("marker_level");
+	impl->compact_trajectories_ = impl->properties_.get<bool>("compact_trajectories");
+	impl->async_cost_ = impl->properties_.get<bool>("async_cost");
+	impl->interface_init_plan_ = impl->properties_.initPlan(INTERFACE);
 }
 
 const ContainerBase* Stage::parent() const {
@@ -415,6 +879,46 @@ void Stage::setCostTerm(const CostTermConstPtr& term) {
 		pimpl()->cost_term_ = term;
 }
 
+namespace {
+// number of recent successful compute durations considered for timeout tuning, and required before tuning
+constexpr size_t TIMEOUT_SAMPLES = 100;
+constexpr size_t MIN_TIMEOUT_SAMPLES = 10;
+}  // namespace
+
+void StagePrivate::recordSuccessfulCompute(double duration) {
+	successful_compute_times_.push_back(duration);
+	if (successful_compute_times_.size() > TIMEOUT_SAMPLES)
+		successful_compute_times_.pop_front();
+	tuneTimeout();
+}
+
+void StagePrivate::tuneTimeout() {
+	if (timeout_percentile_ <= 0.0 || successful_compute_times_.size() < MIN_TIMEOUT_SAMPLES)
+		return;
+
+	std::vector<double> durations(successful_compute_times_.begin(), successful_compute_times_.end());
+	const size_t rank = std::ceil(timeout_percentile_ * durations.size());
+	auto nth = durations.begin() + (std::max<size_t>(rank, 1) - 1);
+	std::nth_element(durations.begin(), nth, durations.end());
+	// set the current value only: the configured one is restored by the next init()
+	properties_.property("timeout").setCurrentValue(std::min(*nth, configured_timeout_));
+}
+
+void Stage::setCostToGo(const CostToGo& cost_to_go) {
+	auto impl = pimpl();
+	impl->cost_to_go_ = cost_to_go;
+	impl->configureInterfaces();
+}
+
+void StagePrivate::configureInterfaces() {
+	for (const InterfacePtr& interface : { starts_, ends_ }) {
+		if (!interface)
+			continue;
+		interface->setCostToGo(cost_to_go_);
+		interface->setBeamWidth(max_interface_states_);
+	}
+}
+
 const ordered<SolutionBaseConstPtr>& Stage::solutions() const {
 	return pimpl()->solutions_;
 }
@@ -427,8 +931,13 @@ size_t Stage::numFailures() const {
 	return pimpl()->num_failures_;
 }
 
-void Stage::silentFailure() {
+size_t Stage::numFailures(FailureCode code) const {
+	return pimpl()->failure_counts_[static_cast<size_t>(code)];
+}
+
+void Stage::silentFailure(FailureCode code) {
 	++(pimpl()->num_failures_);
+	++(pimpl()->failure_counts_[static_cast<size_t>(code)]);
 }
 
 bool Stage::storeFailures() const {
@@ -436,8 +945,19 @@ bool Stage::storeFailures() const {
 }
 
 void Stage::explainFailure(std::ostream& os) const {
-	if (!failures().empty())
+	if (!failures().empty()) {
 		os << ": " << failures().front()->comment();
+		return;
+	}
+	// failures were not stored: report the aggregated reasons instead
+	const char* separator = ": ";
+	for (size_t i = 0; i < NUM_FAILURE_CODES; ++i) {
+		const size_t count = numFailures(static_cast<FailureCode>(i));
+		if (count == 0)
+			continue;
+		os << separator << toString(static_cast<FailureCode>(i)) << " (" << count << ")";
+		separator = ", ";
+	}
 }
 
 PropertyMap& Stage::properties() {
@@ -452,6 +972,64 @@ double Stage::getTotalComputeTime() const {
 	return pimpl()->total_compute_time_.count();
 }
 
+namespace {
+size_t memoryUsage(const visualization_msgs::Marker& marker) {
+	return sizeof(marker) + marker.header.frame_id.size() + marker.ns.size() + marker.text.size() +
+	       marker.mesh_resource.size() + marker.points.size() * sizeof(geometry_msgs::Point) +
+	       marker.colors.size() * sizeof(std_msgs::ColorRGBA);
+}
+}  // namespace
+
+Stage::MemoryUsage Stage::memoryUsage() const {
+	auto impl = pimpl();
+	if (impl->memory_usage_valid_)
+		return impl->memory_usage_;
+	MemoryUsage usage;
+
+	std::unordered_set<const planning_scene::PlanningScene*> scenes;
+	for (const InterfaceState& state : impl->states_) {
+		usage.states += sizeof(InterfaceState);
+		if (state.scene() && scenes.insert(state.scene().get()).second)
+			usage.scenes += utils::memoryUsage(*state.scene());
+	}
+
+	std::unordered_set<const void*> shared_markers;
+	auto account = [&usage, &shared_markers](const SolutionBase& solution) {
+		if (auto* sub = dynamic_cast<const SubTrajectory*>(&solution))
+			usage.trajectories += sub->memoryUsage();
+		else
+			usage.trajectories += sizeof(solution);
+		for (const auto& marker : solution.markers())
+			usage.markers += memoryUsage(marker);
+		for (const auto& shared : solution.sharedMarkers())
+			if (shared_markers.insert(shared.get()).second)
+				for (const auto& marker : *shared)
+					usage.markers += memoryUsage(marker);
+	};
+	for (const auto& solution : impl->solutions_)
+		account(*solution);
+	for (const auto& failure : impl->failures_)
+		account(*failure);
+	impl->memory_usage_ = usage;
+	impl->memory_usage_valid_ = true;
+	return usage;
+}
+
+bool Stage::generatesMarkers(MarkerLevel level) const {
+	return pimpl()->marker_level_ >= level;
+}
+
+bool Stage::budgetExhausted() const {
+	return pimpl()->overBudget();
+}
+
+void StagePrivate::setArena(const utils::ArenaPtr& arena) {
+	if (arena_ == arena || !states_.empty())
+		return;  // keep existing arena until reset
+	arena_ = arena;
+	states_ = StateList(utils::ArenaAllocator<InterfaceState>(arena_));
+}
+
 void StagePrivate::composePropertyErrorMsg(const std::string& property_name, std::ostream& os) {
 	if (property_name.empty())
 		return;
@@ -590,14 +1168,16 @@ void PropagatingEitherWayPrivate::compute() {
 
 	if (hasStartState()) {
 		const InterfaceState& state = fetchStartState();
+		utils::SchedulerLog::job(utils::SchedulerLog::FORWARD, &state);
 		// enforce property initialization from INTERFACE
-		properties_.performInitFrom(Stage::INTERFACE, state.properties());
+		properties_.performInitFrom(interface_init_plan_, state.properties());
 		me->computeForward(state);
 	}
 	if (hasEndState()) {
 		const InterfaceState& state = fetchEndState();
+		utils::SchedulerLog::job(utils::SchedulerLog::BACKWARD, nullptr, &state);
 		// enforce property initialization from INTERFACE
-		properties_.performInitFrom(Stage::INTERFACE, state.properties());
+		properties_.performInitFrom(interface_init_plan_, state.properties());
 		me->computeBackward(state);
 	}
 }
@@ -619,7 +1199,7 @@ void PropagatingEitherWay::restrictDirection(PropagatingEitherWay::Direction dir
 
 template <Interface::Direction dir>
 void PropagatingEitherWay::send(const InterfaceState& start, InterfaceState&& end, SubTrajectory&& trajectory) {
-	pimpl()->send<dir>(start, std::move(end), std::make_shared<SubTrajectory>(std::move(trajectory)));
+	pimpl()->send<dir>(start, std::move(end), pimpl()->makeSolution<SubTrajectory>(std::move(trajectory)));
 }
 // Explicit template instantiation is required. The compiler, otherwise, might just inline them.
 template void PropagatingEitherWay::send<Interface::FORWARD>(const InterfaceState& start, InterfaceState&& end,
@@ -640,7 +1220,7 @@ void PropagatingEitherWay::computeGeneric(const InterfaceState& start) {
 	planning_scene::PlanningScenePtr end;
 	SubTrajectory trajectory;
 
-	if (!compute(start, end, trajectory, dir) && trajectory.comment().empty())
+	if (!compute(start, end, trajectory, dir) && !trajectory.hasComment())
 		silentFailure();  // there is nothing to report (comment is empty)
 	else
 		send<dir>(start, InterfaceState(end), std::move(trajectory));
@@ -690,11 +1270,20 @@ Generator::Generator(GeneratorPrivate* impl) : ComputeBase(impl) {}
 Generator::Generator(const std::string& name) : Generator(new GeneratorPrivate(this, name)) {}
 
 void Generator::spawn(InterfaceState&& from, InterfaceState&& to, SubTrajectory&& t) {
-	pimpl()->spawn(std::move(from), std::move(to), std::make_shared<SubTrajectory>(std::move(t)));
+	pimpl()->spawn(std::move(from), std::move(to), pimpl()->makeSolution<SubTrajectory>(std::move(t)));
 }
 
 void Generator::spawn(InterfaceState&& state, SubTrajectory&& t) {
-	pimpl()->spawn(std::move(state), std::make_shared<SubTrajectory>(std::move(t)));
+	pimpl()->spawn(std::move(state), pimpl()->makeSolution<SubTrajectory>(std::move(t)));
+}
+
+void Generator::spawnBatch(std::vector<std::pair<InterfaceState, SubTrajectory>>&& batch) {
+	auto impl = pimpl();
+	std::vector<std::pair<InterfaceState, SolutionBasePtr>> solutions;
+	solutions.reserve(batch.size());
+	for (auto& entry : batch)
+		solutions.emplace_back(std::move(entry.first), impl->makeSolution<SubTrajectory>(std::move(entry.second)));
+	impl->spawnBatch(std::move(solutions));
 }
 
 MonitoringGeneratorPrivate::MonitoringGeneratorPrivate(MonitoringGenerator* me, const std::string& name)
@@ -737,7 +1326,8 @@ void MonitoringGeneratorPrivate::solutionCB(const SolutionBase& s) {
 		static_cast<MonitoringGenerator*>(me())->onNewSolution(s);
 }
 
-ConnectingPrivate::ConnectingPrivate(Connecting* me, const std::string& name) : ComputeBasePrivate(me, name) {
+ConnectingPrivate::ConnectingPrivate(Connecting* me, const std::string& name)
+  : ComputeBasePrivate(me, name), pending(this) {
 	starts_ = std::make_shared<Interface>(std::bind(&ConnectingPrivate::newState<Interface::BACKWARD>, this,
 	                                                std::placeholders::_1, std::placeholders::_2));
 	ends_ = std::make_shared<Interface>(
@@ -759,6 +1349,273 @@ ConnectingPrivate::StatePair ConnectingPrivate::make_pair<Interface::FORWARD>(In
 	return StatePair(second, first);
 }
 
+void ConnectingPrivate::PendingPairs::add(const InterfaceState* state) {
+	arrival_.emplace(state, arrival_.size());
+	invalidate();
+}
+
+void ConnectingPrivate::PendingPairs::setIncompatible(const InterfaceState* from, const InterfaceState* to) {
+	incompatible_.emplace(from, to);
+	top_valid_ = false;
+}
+
+void ConnectingPrivate::PendingPairs::insert(const StatePair& pair) {
+	explicit_.emplace(Key(&*pair.first, &*pair.second), std::make_pair(num_inserted_++, pair));
+	top_valid_ = false;
+}
+
+void ConnectingPrivate::PendingPairs::clear() {
+	arrival_.clear();
+	incompatible_.clear();
+	consumed_.clear();
+	explicit_.clear();
+	distances_.clear();
+	near_failure_.clear();
+	num_failures_seen_ = 0;
+	num_inserted_ = 0;
+	invalidate();
+	search_starts_.clear();
+	search_ends_.clear();
+	frontier_.clear();
+}
+
+double ConnectingPrivate::PendingPairs::distance(const StatePair& pair) const {
+	Key key(&*pair.first, &*pair.second);
+	auto it = distances_.find(key);
+	if (it == distances_.end())
+		it = distances_.emplace(key, owner_->pairDistance(*pair.first, *pair.second)).first;
+	return it->second;
+}
+
+bool ConnectingPrivate::PendingPairs::tooFar(const StatePair& pair) const {
+	return owner_->max_pair_distance_ > 0.0 && distance(pair) > owner_->max_pair_distance_;
+}
+
+bool ConnectingPrivate::PendingPairs::nearFailure(const StatePair& pair) const {
+	if (owner_->num_failures_ == 0)
+		return false;
+	if (num_failures_seen_ != owner_->num_failures_) {  // new failures might affect any pair
+		near_failure_.clear();
+		num_failures_seen_ = owner_->num_failures_;
+	}
+	Key key(&*pair.first, &*pair.second);
+	auto it = near_failure_.find(key);
+	if (it == near_failure_.end())
+		it = near_failure_.emplace(key, owner_->nearFailure(*pair.first, *pair.second)).first;
+	return it->second;
+}
+
+bool ConnectingPrivate::PendingPairs::contains(const InterfaceState* from, const InterfaceState* to) const {
+	Key key(from, to);
+	if (explicit_.count(key))
+		return true;
+	return arrival_.count(from) && arrival_.count(to) && !incompatible_.count(key) && !consumed_.count(key);
+}
+
+bool ConnectingPrivate::PendingPairs::less(const StatePair& lhs, const StatePair& rhs) const {
+	if (lhs < rhs)
+		return true;
+	if (rhs < lhs)
+		return false;
+	// break ties by arrival: pairs formed by an earlier state come first
+	auto arrival = [this](const InterfaceState* s) {
+		auto it = arrival_.find(s);
+		return it != arrival_.end() ? it->second : std::numeric_limits<size_t>::max();
+	};
+	auto key = [&arrival](const StatePair& p) {
+		size_t a = arrival(&*p.first);
+		size_t b = arrival(&*p.second);
+		return std::make_pair(std::max(a, b), std::min(a, b));
+	};
+	return key(lhs) < key(rhs);
+}
+
+void ConnectingPrivate::PendingPairs::forget(const InterfaceState* state) {
+	arrival_.erase(state);
+	const auto involves = [state](const Key& key) { return key.first == state || key.second == state; };
+	for (auto it = incompatible_.begin(); it != incompatible_.end();)
+		it = involves(*it) ? incompatible_.erase(it) : std::next(it);
+	for (auto it = consumed_.begin(); it != consumed_.end();)
+		it = involves(*it) ? consumed_.erase(it) : std::next(it);
+	// explicit pairs refer to the state by an iterator, which becomes invalid on removal
+	for (auto it = explicit_.begin(); it != explicit_.end();)
+		it = involves(it->first) ? explicit_.erase(it) : std::next(it);
+	for (auto it = distances_.begin(); it != distances_.end();)
+		it = involves(it->first) ? distances_.erase(it) : std::next(it);
+	for (auto it = near_failure_.begin(); it != near_failure_.end();)
+		it = involves(it->first) ? near_failure_.erase(it) : std::next(it);
+	invalidate();
+}
+
+std::vector<Interface::const_iterator> ConnectingPrivate::PendingPairs::states(const Interface& interface,
+                                                                             bool enabled_only) const {
+	std::vector<Interface::const_iterator> result;
+	for (Interface::const_iterator it = interface.begin(), end = interface.end(); it != end; ++it) {
+		if (enabled_only && !it->priority().enabled())
+			break;  // enabled states come first
+		if (arrival_.count(&*it))
+			result.push_back(it);
+	}
+	// sort states of equal priority by arrival
+	std::stable_sort(result.begin(), result.end(), [this](Interface::const_iterator a, Interface::const_iterator b) {
+		if (a->priority() < b->priority())
+			return true;
+		if (b->priority() < a->priority())
+			return false;
+		return arrival_.at(&*a) < arrival_.at(&*b);
+	});
+	return result;
+}
+
+const ConnectingPrivate::StatePair* ConnectingPrivate::PendingPairs::top() const {
+	// the cache becomes stale when states are disabled without notification
+	if (top_valid_ && (!has_top_ || (top_.first->priority().enabled() && top_.second->priority().enabled())))
+		return has_top_ ? &top_ : nullptr;
+
+	top_valid_ = true;
+	has_top_ = false;
+
+	// best explicitly inserted pair, preferring earlier insertions among equal ones
+	size_t top_index = 0;
+	for (const auto& entry : explicit_) {
+		const size_t index = entry.second.first;
+		const StatePair& pair = entry.second.second;
+		if (!pair.first->priority().enabled() || !pair.second->priority().enabled())
+			continue;
+		if (!has_top_ || less(pair, top_) || (!less(top_, pair) && index < top_index)) {
+			top_ = pair;
+			top_index = index;
+			has_top_ = true;
+		}
+	}
+
+	// Best-first search through the grid of enabled (start, end) pairs.
+	// As pair priorities are monotonic in both indices, each cell (i, j) is reached from a single predecessor:
+	// (i, j-1) if j > 0, or (i-1, 0) otherwise. Thus, cells are expanded in order of their priority.
+	// The frontier is kept across calls: expanded cells that are consumed or incompatible are dropped,
+	// all other visited cells are pushed back. Thus, as long as no priorities change, consecutive calls
+	// don't revisit the done cells: popping all P pending pairs in sequence takes O(P log P) grid steps, not O(P^2).
+	if (search_valid_)  // states might have been disabled without notification
+		for (const auto* grid_states : { &search_starts_, &search_ends_ })
+			for (const auto& it : *grid_states)
+				search_valid_ = search_valid_ && it->priority().enabled();
+	if (!search_valid_) {
+		search_starts_ = states(*owner_->starts(), true);
+		search_ends_ = states(*owner_->ends(), true);
+		frontier_.clear();
+		if (!search_starts_.empty() && !search_ends_.empty())
+			frontier_.push_back(Cell{ 0, 0, false });
+		search_valid_ = true;
+	}
+	const auto& starts = search_starts_;
+	const auto& ends = search_ends_;
+	auto worse = [&](const Cell& a, const Cell& b) {
+		return less(StatePair(starts[b.start], ends[b.end]), StatePair(starts[a.start], ends[a.end]));
+	};
+	auto push = [&](const Cell& cell) {
+		frontier_.push_back(cell);
+		std::push_heap(frontier_.begin(), frontier_.end(), worse);
+	};
+	std::vector<Cell> pending_cells;  // visited cells still pending, to be pushed back
+	// if close pairs are preferred, the closest among the first close_pair_candidates_ feasible pairs of best priority
+	bool found = false;
+	size_t num_candidates = 0;
+	StatePair closest;
+	double closest_distance = 0.0;
+	// best pair close to a failure, only used if there is no other one
+	bool postponed = false;
+	StatePair near_failure;
+	while (!frontier_.empty()) {
+		Cell cell = frontier_.front();
+		StatePair pair(starts[cell.start], ends[cell.end]);
+		if (found && closest < pair)
+			break;  // all pairs of the best priority were visited
+		if (!found && has_top_ && !less(pair, top_))
+			break;  // explicitly inserted pair is better
+		std::pop_heap(frontier_.begin(), frontier_.end(), worse);
+		frontier_.pop_back();
+		Key key(&*pair.first, &*pair.second);
+		bool feasible = !incompatible_.count(key) && !consumed_.count(key);
+		if (feasible && tooFar(pair)) {  // consume it right away, such that it is not evaluated again
+			consumed_.insert(key);
+			distances_.erase(key);
+			feasible = false;
+		}
+		bool stop = false;
+		if (feasible && nearFailure(pair)) {
+			if (!postponed && !owner_->skip_near_failures_) {
+				near_failure = pair;
+				postponed = true;
+			}
+		} else if (feasible) {
+			if (!owner_->prefer_close_pairs_) {
+				top_ = pair;
+				has_top_ = true;
+				stop = true;
+			} else {
+				const double d = distance(pair);
+				if (!found || d < closest_distance) {
+					closest = pair;
+					closest_distance = d;
+					found = true;
+				}
+				stop = ++num_candidates == owner_->close_pair_candidates_;
+			}
+		}
+		if (!stop && !cell.expanded) {
+			if (cell.end == 0 && cell.start + 1 < starts.size())
+				push(Cell{ cell.start + 1, 0, false });
+			if (cell.end + 1 < ends.size())
+				push(Cell{ cell.start, cell.end + 1, false });
+			cell.expanded = true;
+		}
+		if (feasible)
+			pending_cells.push_back(cell);
+		if (stop)
+			break;
+	}
+	for (const Cell& cell : pending_cells)
+		push(cell);
+	if (found) {
+		top_ = closest;
+		has_top_ = true;
+	}
+	if (!has_top_ && postponed) {
+		top_ = near_failure;
+		has_top_ = true;
+	}
+	return has_top_ ? &top_ : nullptr;
+}
+
+ConnectingPrivate::StatePair ConnectingPrivate::PendingPairs::pop() {
+	const StatePair* best = top();
+	assert(best);
+	StatePair result = *best;
+	Key key(&*result.first, &*result.second);
+	explicit_.erase(key);
+	consumed_.insert(key);
+	distances_.erase(key);
+	top_valid_ = false;
+	return result;
+}
+
+std::vector<ConnectingPrivate::StatePair> ConnectingPrivate::PendingPairs::sorted() const {
+	std::vector<StatePair> result;
+	for (const auto& entry : explicit_)
+		result.push_back(entry.second.second);
+	const auto starts = states(*owner_->starts(), false);
+	const auto ends = states(*owner_->ends(), false);
+	for (const auto& from : starts)
+		for (const auto& to : ends) {
+			Key key(&*from, &*to);
+			if (!explicit_.count(key) && !incompatible_.count(key) && !consumed_.count(key))
+				result.emplace_back(from, to);
+		}
+	std::stable_sort(result.begin(), result.end(),
+	                 [this](const StatePair& lhs, const StatePair& rhs) { return less(lhs, rhs); });
+	return result;
+}
+
 template <Interface::Direction dir>
 void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags updated) {
 	auto parent_pimpl = parent()->pimpl();
@@ -774,10 +1631,15 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 			if (status == InterfaceState::Status::PRUNED)  // PRUNED becomes ARMED on opposite side
 				status = InterfaceState::Status::ARMED;  // (only for pending state pairs)
 
-			for (const auto& candidate : this->pending) {
-				if (std::get<opposite<dir>()>(candidate) != it)  // only consider pairs with source state == state
-					continue;
-				auto oit = std::get<dir>(candidate);  // opposite target state
+			// collect opposite states of pending pairs with it first, as setStatus() reorders the opposite interface
+			std::vector<Interface::iterator> opposites;
+			InterfacePtr other_interface = pullInterface<dir>();
+			for (Interface::iterator oit = other_interface->begin(), oend = other_interface->end(); oit != oend; ++oit) {
+				const StatePair candidate = make_pair<dir>(it, oit);
+				if (pending.contains(&*candidate.first, &*candidate.second))
+					opposites.push_back(oit);
+			}
+			for (Interface::iterator oit : opposites) {
 				auto ostatus = oit->priority().status();
 				if (ostatus != status) {
 					if (status != InterfaceState::Status::ENABLED) {
@@ -795,18 +1657,22 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 			}
 		}
 
-		// many pairs will have changed priorities: resort pending list
-		pending.sort();
-	} else {  // new state: insert all pairs with other interface
+		// many pairs will have changed priorities: search the best pair again
+		pending.invalidate();
+	} else {  // new state: pair it with all compatible states of the other interface
 		assert(it->priority().enabled());  // new solutions are feasible, aren't they?
 		InterfacePtr other_interface = pullInterface<dir>();
+		pending.add(&*it);
 		bool have_enabled_opposites = false;
 
 		// other interface states to re-enable (post-poned because otherwise order in other_interface changes during loop)
 		std::vector<Interface::iterator> oit_to_enable;
 		for (Interface::iterator oit = other_interface->begin(), oend = other_interface->end(); oit != oend; ++oit) {
-			if (!static_cast<Connecting*>(me_)->compatible(*it, *oit))
+			if (!static_cast<Connecting*>(me_)->compatible(*it, *oit)) {
+				const StatePair pair = make_pair<dir>(it, oit);
+				pending.setIncompatible(&*pair.first, &*pair.second);
 				continue;
+			}
 
 			// re-enable the opposing state oit (and its associated solution branch) if its status is ARMED
 			// https://github.com/moveit/moveit_task_constructor/pull/309#issuecomment-974636202
@@ -816,9 +1682,15 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 			}
 			if (oit->priority().enabled())
 				have_enabled_opposites = true;
-
-			// Remember all pending states, regardless of their status!
-			pending.insert(make_pair<dir>(it, oit));
+			// all compatible pairs are pending now, regardless of their status!
+		}
+		// deferred states of the other interface pair up once revived
+		const Interface::container_type& deferred = other_interface->deferred();
+		for (Interface::const_iterator oit = deferred.begin(), oend = deferred.end(); oit != oend; ++oit) {
+			if (!static_cast<Connecting*>(me_)->compatible(*it, *oit)) {
+				const StatePair pair = make_pair<dir>(it, oit);
+				pending.setIncompatible(&*pair.first, &*pair.second);
+			}
 		}
 		// actually re-enable other interface states, which were scheduled for re-enabling above
 		for (Interface::iterator oit : oit_to_enable)
@@ -827,6 +1699,7 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 		if (!have_enabled_opposites)  // prune new state and associated branch if necessary
 			// pass creator=nullptr to skip hasPendingOpposites() check as we did this here already
 			parent_pimpl->setStatus<dir>(nullptr, nullptr, &*it, InterfaceState::Status::ARMED);
+		pending.invalidate();
 	}
 #if 0
 	auto& os = std::cerr;
@@ -850,18 +1723,20 @@ void ConnectingPrivate::newState(Interface::iterator it, Interface::UpdateFlags
 // If not, we exhausted all solution candidates for target and thus should mark it as failure.
 template <Interface::Direction dir>
 inline bool ConnectingPrivate::hasPendingOpposites(const InterfaceState* source, const InterfaceState* target) const {
-	for (const auto& candidate : this->pending) {
-		static_assert(Interface::FORWARD == 0 && Interface::BACKWARD == 1,
-		              "This code assumes FORWARD=0, BACKWARD=1. Don't change their order!");
-		const InterfaceState* src = &*std::get<dir>(candidate);
-		const InterfaceState* tgt = &*std::get<opposite<dir>()>(candidate);
-
-		if (tgt == target && src != source && src->priority().enabled())
+	static_assert(Interface::FORWARD == 0 && Interface::BACKWARD == 1,
+	              "This code assumes FORWARD=0, BACKWARD=1. Don't change their order!");
+	if (!target->priority().enabled())
+		return false;  // only feasible pairs count
+
+	// src is the start state for FORWARD and the end state for BACKWARD
+	const Interface& src_interface = dir == Interface::FORWARD ? *starts() : *ends();
+	for (const InterfaceState* src : src_interface) {
+		if (!src->priority().enabled())
+			break;  // only disabled states are to come
+		if (src == source)
+			continue;
+		if (dir == Interface::FORWARD ? pending.contains(src, target) : pending.contains(target, src))
 			return true;
-
-		// early stopping when only infeasible pairs are to come
-		if (!std::get<0>(candidate)->priority().enabled() || !std::get<1>(candidate)->priority().enabled())
-			break;
 	}
 	return false;
 }
@@ -874,39 +1749,149 @@ template bool ConnectingPrivate::hasPendingOpposites<Interface::BACKWARD>(const
 bool ConnectingPrivate::canCompute() const {
 	// ROS_DEBUG_STREAM("canCompute " << name() << ": " << pendingPairsPrinter());
 	// Do we still have feasible pending state pairs?
-	return !pending.empty() && pending.front().first->priority().enabled() &&
-	       pending.front().second->priority().enabled();
+	return pending.top() != nullptr;
+}
+
+void ConnectingPrivate::refill() {
+	// Connecting's states stay enabled after all their pairs were tried: revive deferred states beyond the beam
+	while (!pending.top() && (starts_->deferredSize() > 0 || ends_->deferredSize() > 0)) {
+		starts_->reviveDeferred(std::max<size_t>(starts_->beamWidth(), 1));
+		ends_->reviveDeferred(std::max<size_t>(ends_->beamWidth(), 1));
+	}
 }
 
 void ConnectingPrivate::compute() {
-	const StatePair& top = pending.pop();
-	const InterfaceState& from = *top.first;
-	const InterfaceState& to = *top.second;
-	assert(from.priority().enabled() && to.priority().enabled());
-	static_cast<Connecting*>(me_)->compute(from, to);
+	const size_t batch_size = properties_.get<size_t>("batch_size");
+	if (batch_size <= 1) {
+		const StatePair& top = pending.pop();
+		const InterfaceState& from = *top.first;
+		const InterfaceState& to = *top.second;
+		assert(from.priority().enabled() && to.priority().enabled());
+		utils::SchedulerLog::job(utils::SchedulerLog::CONNECT, &from, &to);
+		static_cast<Connecting*>(me_)->compute(from, to);
+		return;
+	}
+
+	// drain the best feasible pairs
+	Connecting::StatePairs pairs;
+	while (pairs.size() < batch_size && canCompute()) {
+		const StatePair top = pending.pop();
+		pairs.emplace_back(&*top.first, &*top.second);
+	}
+	if (!pairs.empty())  // log the best pair of the batch
+		utils::SchedulerLog::job(utils::SchedulerLog::CONNECT, pairs.front().first, pairs.front().second);
+	static_cast<Connecting*>(me_)->computeBatch(pairs);
 }
 
 std::ostream& operator<<(std::ostream& os, const PendingPairsPrinter& p) {
 	const auto* impl = p.instance_;
 	const char* reset = InterfaceState::colorForStatus(3);
-	for (const auto& candidate : impl->pending) {
+	const auto pairs = impl->pending.sorted();
+	for (const auto& candidate : pairs) {
 		size_t first = getIndex(*impl->starts(), candidate.first);
 		size_t second = getIndex(*impl->ends(), candidate.second);
 		os << InterfaceState::colorForStatus(candidate.first->priority().status()) << first << reset << ":"
 		   << InterfaceState::colorForStatus(candidate.second->priority().status()) << second << reset << " ";
 	}
-	if (impl->pending.empty())
+	if (pairs.empty())
 		os << "---";
 	return os;
 }
 
-Connecting::Connecting(const std::string& name) : ComputeBase(new ConnectingPrivate(this, name)) {}
+Connecting::Connecting(const std::string& name) : ComputeBase(new ConnectingPrivate(this, name)) {
+	auto& p = properties();
+	p.declare<size_t>("batch_size", 1, "number of pending state pairs computed at once");
+	p.declare<bool>("prefer_close_pairs", false, "among pairs of equal priority, try the closest ones first");
+	p.declare<size_t>("close_pair_candidates", 16, "number of pairs compared by prefer_close_pairs (0: unlimited)");
+	p.declare<double>("max_pair_distance", 0.0, "skip pairs farther apart (0: unlimited)");
+	p.declare<double>("failure_tolerance", 0.0, "postpone pairs this close to a failed one (0: disabled)");
+	p.declare<bool>("skip_near_failures", false, "skip pairs close to a failed one instead of postponing them");
+}
+
+void Connecting::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	ComputeBase::init(robot_model);
+	auto impl = pimpl();
+	impl->prefer_close_pairs_ = impl->properties_.get<bool>("prefer_close_pairs");
+	impl->close_pair_candidates_ = impl->properties_.get<size_t>("close_pair_candidates");
+	impl->max_pair_distance_ = impl->properties_.get<double>("max_pair_distance");
+	impl->failure_tolerance_ = impl->properties_.get<double>("failure_tolerance");
+	impl->skip_near_failures_ = impl->properties_.get<bool>("skip_near_failures");
+}
+
+double Connecting::pairDistance(const InterfaceState& from, const InterfaceState& to) const {
+	return from.baseScene()->getRobotModel()->distance(from.variablePositions(), to.variablePositions());
+}
+
+double ConnectingPrivate::pairDistance(const InterfaceState& from, const InterfaceState& to) const {
+	return static_cast<const Connecting*>(me_)->pairDistance(from, to);
+}
+
+size_t ConnectingPrivate::sceneHash(const InterfaceState& state) const {
+	auto it = scene_hashes_.find(&state);
+	if (it == scene_hashes_.end()) {
+		// lightweight states share the world of their base scene, only differing in joint positions
+		const planning_scene::PlanningScene& scene = *state.baseScene();
+		size_t seed = utils::worldHash(scene, 1e-4);
+		boost::hash_combine(seed, utils::acmHash(scene));
+		it = scene_hashes_.emplace(&state, seed).first;
+	}
+	return it->second;
+}
+
+void ConnectingPrivate::addFailure(const InterfaceState& from, const InterfaceState& to) {
+	size_t key = sceneHash(from);
+	boost::hash_combine(key, sceneHash(to));
+	failures_[key].push_back(Failure{ &from, &to });
+	++num_failures_;
+	pending.invalidate();
+}
+
+bool ConnectingPrivate::nearFailure(const InterfaceState& from, const InterfaceState& to) const {
+	size_t key = sceneHash(from);
+	boost::hash_combine(key, sceneHash(to));
+	auto it = failures_.find(key);
+	if (it == failures_.end())
+		return false;
+	for (const Failure& failure : it->second)
+		if (pairDistance(*failure.from, from) <= failure_tolerance_ &&
+		    pairDistance(*failure.to, to) <= failure_tolerance_)
+			return true;
+	return false;
+}
+
+void ConnectingPrivate::onEvictState(const InterfaceState& state) {
+	pending.forget(&state);
+	scene_hashes_.erase(&state);
+}
+
+void Connecting::computeBatch(const StatePairs& pairs) {
+	for (const auto& pair : pairs)
+		compute(*pair.first, *pair.second);
+}
 
 void Connecting::reset() {
-	pimpl()->pending.clear();
+	auto impl = pimpl();
+	impl->pending.clear();
+	impl->failures_.clear();
+	impl->invalidateMemoryUsage();
+	impl->num_failures_ = 0;
+	impl->scene_hashes_.clear();
 	ComputeBase::reset();
 }
 
+void Connecting::setJointDistanceCostToGo(double weight) {
+	auto impl = pimpl();
+	setCostToGo([impl, weight](const InterfaceState& state) {
+		const Interface* opposite = state.owner() == impl->starts().get() ? impl->ends().get() : impl->starts().get();
+		const moveit::core::RobotModel& model = *state.baseScene()->getRobotModel();
+		double distance = std::numeric_limits<double>::infinity();
+		for (const InterfaceState* other : opposite->states())
+			if (other->priority().enabled())
+				distance = std::min(distance, model.distance(state.variablePositions(), other->variablePositions()));
+		return std::isfinite(distance) ? weight * distance : 0.0;
+	});
+}
+
 /// compare consistency of planning scenes
 bool Connecting::compatible(const InterfaceState& from_state, const InterfaceState& to_state) const {
 	const planning_scene::PlanningSceneConstPtr& from = from_state.scene();
@@ -977,7 +1962,12 @@ bool Connecting::compatible(const InterfaceState& from_state, const InterfaceSta
 }
 
 void Connecting::connect(const InterfaceState& from, const InterfaceState& to, const SolutionBasePtr& s) {
-	pimpl()->connect(from, to, s);
+	auto impl = pimpl();
+	// remember failures reported by compute(), not those assigned by cost terms later on
+	if (s->isFailure() && impl->failure_tolerance_ > 0.0 &&
+	    !DeferredActions::defer([impl, &from, &to] { impl->addFailure(from, to); }))
+		impl->addFailure(from, to);
+	impl->connect(from, to, s);
 }
 
 std::ostream& operator<<(std::ostream& os, const Stage& stage) {
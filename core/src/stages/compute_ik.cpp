@@ -37,16 +37,27 @@
 #include <moveit/task_constructor/stages/compute_ik.h>
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/marker_tools.h>
+#include <moveit/task_constructor/container_p.h>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/thread_local_scene.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/robot_state/robot_state.h>
+#include <moveit/kinematic_constraints/kinematic_constraint.h>
+#include <moveit/kinematics_base/kinematics_base.h>
 
 #include <Eigen/Geometry>
 #include <tf2_eigen/tf2_eigen.h>
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <functional>
 #include <iterator>
+#include <memory>
+#include <mutex>
 #include <ros/console.h>
 #include <fmt/core.h>
 
@@ -64,6 +75,17 @@ ComputeIK::ComputeIK(const std::string& name, Stage::pointer&& child) : WrapperB
 	p.declare<double>("min_solution_distance", 0.1,
 	                  "minimum distance between seperate IK solutions for the same target");
 	p.declare<moveit_msgs::Constraints>("constraints", moveit_msgs::Constraints(), "additional constraints to obey");
+	p.declare<uint32_t>("num_threads", 1u, "number of IK seeds processed concurrently");
+	p.declare<uint32_t>("batch_size", 1u, "upstream targets per compute(), solved concurrently if num_threads > 1");
+	p.declare<utils::BatchIKSolverPtr>("batch_ik_solver", utils::BatchIKSolverPtr(),
+	                                   "backend solving the IK of all targets of a batch at once");
+	p.declare<utils::ReachabilityMapConstPtr>("reachability_map", utils::ReachabilityMapConstPtr(),
+	                                          "reachability map of the ik frame to pre-screen targets");
+	p.declare<double>("min_reachability", 0.0, "minimum reachability score of targets");
+	p.declare<bool>("rank_by_reachability", false, "process targets in order of decreasing reachability");
+	p.declare<uint32_t>("seed_cache_size", 0u, "number of previous IK solutions kept to seed nearby targets");
+	p.declare<bool>("multi_solution_ik", true,
+	                "query all IK solution branches at once from solvers supporting it (e.g. IKFast) first");
 
 	// ik_frame and target_pose are read from the interface
 	p.declare<geometry_msgs::PoseStamped>("ik_frame", "frame to be moved towards goal pose");
@@ -84,6 +106,55 @@ void ComputeIK::setTargetPose(const Eigen::Isometry3d& pose, const std::string&
 	setTargetPose(pose_msg);
 }
 
+void ComputeIK::SeedCache::setCapacity(size_t capacity) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	capacity_ = capacity;
+	while (entries_.size() > capacity_)
+		entries_.pop_front();
+}
+
+void ComputeIK::SeedCache::clear() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	entries_.clear();
+}
+
+void ComputeIK::SeedCache::insert(const moveit::core::JointModelGroup* jmg, const Eigen::Isometry3d& target_pose,
+                                  const std::vector<double>& solution) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (capacity_ == 0)
+		return;
+	if (entries_.size() == capacity_)
+		entries_.pop_front();
+	entries_.push_back(Entry{ jmg, target_pose.translation(), target_pose.linear(), solution });
+}
+
+std::vector<std::vector<double>> ComputeIK::SeedCache::nearest(const moveit::core::JointModelGroup* jmg,
+                                                               const Eigen::Isometry3d& target_pose, size_t k) const {
+	// weight of orientation differences [m/rad]
+	static constexpr double ROTATION_WEIGHT = 0.1;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+	// the cache is small compared to the cost of an IK call: a linear scan is sufficient
+	std::vector<std::pair<double, const Entry*>> candidates;
+	candidates.reserve(entries_.size());
+	for (const Entry& entry : entries_) {
+		if (entry.jmg != jmg)
+			continue;
+		const double angle = Eigen::AngleAxisd(entry.orientation.transpose() * target_pose.linear()).angle();
+		const double distance = (entry.position - target_pose.translation()).norm() + ROTATION_WEIGHT * angle;
+		candidates.emplace_back(distance, &entry);
+	}
+	k = std::min(k, candidates.size());
+	std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end(),
+	                  [](const auto& a, const auto& b) { return a.first < b.first; });
+
+	std::vector<std::vector<double>> seeds;
+	seeds.reserve(k);
+	for (size_t i = 0; i < k; ++i)
+		seeds.push_back(candidates[i].second->solution);
+	return seeds;
+}
+
 // found IK solutions
 
 struct IKSolution
@@ -98,20 +169,77 @@ using IKSolutions = std::vector<IKSolution>;
 
 namespace {
 
-// ??? TODO: provide callback methods in PlanningScene class / probably not very useful here though...
-// TODO: move into MoveIt core, lift active_components_only_ from fcl to common interface
-bool isTargetPoseCollidingInEEF(const planning_scene::PlanningSceneConstPtr& scene,
-                                moveit::core::RobotState& robot_state, Eigen::Isometry3d pose,
-                                const moveit::core::LinkModel* link, const moveit::core::JointModelGroup* jmg = nullptr,
-                                collision_detection::CollisionResult* collision_result = nullptr) {
+// place link (and all links rigidly connected to it) at pose, returning the rigidly connected parent link
+const moveit::core::LinkModel* placeLink(moveit::core::RobotState& robot_state, Eigen::Isometry3d pose,
+                                         const moveit::core::LinkModel* link) {
 	// consider all rigidly connected parent links as well
 	const moveit::core::LinkModel* parent = moveit::core::RobotModel::getRigidlyConnectedParentLinkModel(link);
 	if (parent != link)  // transform pose into pose suitable to place parent
 		pose = pose * robot_state.getGlobalLinkTransform(link).inverse() * robot_state.getGlobalLinkTransform(parent);
 
-	// place links at given pose
+	// place links at given pose (only updating the transforms of parent's descendants)
 	robot_state.updateStateWithLinkAt(parent, pose);
 	robot_state.updateCollisionBodyTransforms();
+	return parent;
+}
+
+/** cheap pre-check of isTargetPoseCollidingInEEF(): collisions of the eef subtree (incl. attached bodies) with world
+ *
+ * The eef needs to be placed already. Only collisions with world objects are checked, disabling all links
+ * outside the subtree. As the scene's allowed collisions are respected, a collision found here is definite.
+ * Returns false (undecided) if the scene allows collisions of the subtree conditionally.
+ */
+bool isEEFCollidingWithWorld(const planning_scene::PlanningScene& scene, const moveit::core::RobotState& robot_state,
+                             const std::vector<std::string>& subtree, const std::vector<std::string>& others,
+                             collision_detection::CollisionResult* collision_result) {
+	using collision_detection::AllowedCollision::ALWAYS;
+	using collision_detection::AllowedCollision::CONDITIONAL;
+	const collision_detection::AllowedCollisionMatrix& scene_acm = scene.getAllowedCollisionMatrix();
+	// Small matrix, only comprising the entries for the subtree w.r.t. world objects.
+	// Disabled names only get a default entry (and world objects none), because defaults of both names of a pair
+	// are combined: a world object's default forbidding collisions would enable the disabled links again.
+	collision_detection::AllowedCollisionMatrix acm;
+	for (const std::string& name : others)
+		acm.setDefaultEntry(name, true);
+
+	std::vector<std::string> checked(subtree);
+	std::vector<const moveit::core::AttachedBody*> bodies;
+	robot_state.getAttachedBodies(bodies);
+	for (const moveit::core::AttachedBody* body : bodies) {
+		if (std::find(subtree.begin(), subtree.end(), body->getAttachedLinkName()) != subtree.end())
+			checked.push_back(body->getName());
+		else
+			acm.setDefaultEntry(body->getName(), true);
+	}
+
+	// resolve the scene's (explicit or default) entries of checked pairs into explicit ones
+	collision_detection::AllowedCollision::Type type;
+	for (const std::string& name : checked) {
+		for (const auto& object : *scene.getWorld()) {
+			if (!scene_acm.getAllowedCollision(name, object.first, type))
+				continue;  // no entry: collisions are checked
+			if (type == CONDITIONAL)
+				return false;
+			if (type == ALWAYS)
+				acm.setEntry(name, object.first, true);
+		}
+	}
+
+	collision_detection::CollisionRequest req;
+	collision_detection::CollisionResult result;
+	req.contacts = (collision_result != nullptr);
+	collision_detection::CollisionResult& res = collision_result ? *collision_result : result;
+	scene.getCollisionEnv()->checkRobotCollision(req, res, robot_state, acm);
+	return res.collision;
+}
+
+// ??? TODO: provide callback methods in PlanningScene class / probably not very useful here though...
+// TODO: move into MoveIt core, lift active_components_only_ from fcl to common interface
+bool isTargetPoseCollidingInEEF(const planning_scene::PlanningSceneConstPtr& scene,
+                                moveit::core::RobotState& robot_state, Eigen::Isometry3d pose,
+                                const moveit::core::LinkModel* link, const moveit::core::JointModelGroup* jmg = nullptr,
+                                collision_detection::CollisionResult* collision_result = nullptr) {
+	const moveit::core::LinkModel* parent = placeLink(robot_state, pose, link);
 
 	// disable collision checking for parent links (except links fixed to root)
 	auto acm = scene->getAllowedCollisionMatrix();
@@ -151,6 +279,23 @@ std::string listCollisionPairs(const collision_detection::CollisionResult::Conta
 	return result;
 }
 
+// Constraints only referring to robot links (or the model frame) don't depend on the scene's transforms
+bool isSceneIndependent(const moveit_msgs::Constraints& constraints, const moveit::core::RobotModel& robot_model) {
+	auto is_robot_frame = [&robot_model](const std::string& frame) {
+		return frame.empty() || frame == robot_model.getModelFrame() || robot_model.hasLinkModel(frame);
+	};
+	for (const auto& c : constraints.position_constraints)
+		if (!is_robot_frame(c.header.frame_id))
+			return false;
+	for (const auto& c : constraints.orientation_constraints)
+		if (!is_robot_frame(c.header.frame_id))
+			return false;
+	for (const auto& c : constraints.visibility_constraints)
+		if (!is_robot_frame(c.target_pose.header.frame_id) || !is_robot_frame(c.sensor_pose.header.frame_id))
+			return false;
+	return true;
+}
+
 bool validateEEF(const PropertyMap& props, const moveit::core::RobotModelConstPtr& robot_model,
                  const moveit::core::JointModelGroup*& jmg, std::string* msg) {
 	try {
@@ -185,14 +330,97 @@ bool validateGroup(const PropertyMap& props, const moveit::core::RobotModelConst
 	return true;
 }
 
+// score of target pose (w.r.t. planning frame)
+double reachabilityScore(const utils::ReachabilityMap& map, const planning_scene::PlanningScene& scene,
+                         const Eigen::Isometry3d& target_pose) {
+	const moveit::core::RobotState& state = scene.getCurrentState();
+	return map.score(state.getGlobalLinkTransform(state.getRobotModel()->getRootLink()).inverse() * target_pose);
+}
+
+/** Query all IK solutions for target_pose of link in a single call of the group's kinematics solver
+ *
+ * Analytic solvers (e.g. IKFast) return all solution branches at once, numeric solvers a single one from the seed.
+ * Solutions are returned as joint group positions. Returns false if the query is not applicable, i.e. if the group
+ * has no (single) solver or link is not rigidly attached to the solver's tip.
+ */
+bool queryAllIKSolutions(moveit::core::RobotState& state, const moveit::core::JointModelGroup* jmg,
+                         const moveit::core::LinkModel* link, const Eigen::Isometry3d& target_pose,
+                         std::vector<std::vector<double>>& solutions) {
+	const auto solver = jmg->getSolverInstance();
+	if (!solver)
+		return false;
+	auto frame_link = [&model = jmg->getParentModel()](const std::string& frame) {
+		return model.getLinkModel(!frame.empty() && frame[0] == '/' ? frame.substr(1) : frame);
+	};
+	const moveit::core::LinkModel* tip = frame_link(solver->getTipFrame());
+	const moveit::core::LinkModel* base = frame_link(solver->getBaseFrame());
+	if (!tip || !base ||
+	    moveit::core::RobotModel::getRigidlyConnectedParentLinkModel(tip) !=
+	        moveit::core::RobotModel::getRigidlyConnectedParentLinkModel(link))
+		return false;
+
+	state.updateLinkTransforms();
+	// pose of the solver's tip, w.r.t. the solver's base
+	const Eigen::Isometry3d tip_pose = state.getGlobalLinkTransform(base).inverse() * target_pose *
+	                                   state.getGlobalLinkTransform(link).inverse() * state.getGlobalLinkTransform(tip);
+
+	// the solver's joint order differs from the group's
+	const std::vector<unsigned int>& bijection = jmg->getKinematicsSolverJointBijection();
+	std::vector<double> group_positions;
+	state.copyJointGroupPositions(jmg, group_positions);
+	std::vector<double> seed(bijection.size());
+	for (size_t i = 0; i < bijection.size(); ++i)
+		seed[i] = group_positions[bijection[i]];
+
+	const std::vector<geometry_msgs::Pose> poses{ tf2::toMsg(tip_pose) };
+	std::vector<std::vector<double>> solver_solutions;
+	kinematics::KinematicsResult result;
+	if (!solver->getPositionIK(poses, seed, solver_solutions, result, kinematics::KinematicsQueryOptions()))
+		return false;
+
+	solutions.clear();
+	for (const std::vector<double>& solution : solver_solutions) {
+		for (size_t i = 0; i < bijection.size(); ++i)
+			group_positions[bijection[i]] = solution[i];
+		if (jmg->satisfiesPositionBounds(group_positions.data()))
+			solutions.push_back(group_positions);
+	}
+	return true;
+}
+
 }  // anonymous namespace
 
+const ComputeIK::EEFLinks& ComputeIK::eefLinks(const moveit::core::RobotModel& robot_model,
+                                               const moveit::core::LinkModel* parent) {
+	if (eef_links_.parent == parent)
+		return eef_links_;
+
+	eef_links_ = EEFLinks();
+	eef_links_.parent = parent;
+	const auto& descendants = parent->getParentJointModel()->getDescendantLinkModels();
+	for (const moveit::core::LinkModel* l : robot_model.getLinkModelsWithCollisionGeometry()) {
+		const bool in_subtree = std::find(descendants.begin(), descendants.end(), l) != descendants.end();
+		(in_subtree ? eef_links_.subtree : eef_links_.others).push_back(l->getName());
+	}
+	return eef_links_;
+}
+
 void ComputeIK::reset() {
 	upstream_solutions_.clear();
+	suspended_targets_.clear();
+	num_rejected_by_constraints_ = 0;
+	num_rejected_by_collision_ = 0;
+	num_rejected_by_reachability_ = 0;
+	seed_cache_.clear();
 	WrapperBase::reset();
 }
 
 void ComputeIK::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	// invalidate caches depending on the robot model
+	constraint_set_.reset();
+	compare_pose_jmg_ = nullptr;
+	eef_links_ = EEFLinks();
+
 	InitStageException errors;
 	try {
 		WrapperBase::init(robot_model);
@@ -207,6 +435,22 @@ void ComputeIK::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	const moveit::core::JointModelGroup* jmg = nullptr;
 	std::string msg;
 
+	ignore_collisions_ = props.handle<bool>("ignore_collisions");
+	target_pose_ = props.handle<geometry_msgs::PoseStamped>("target_pose");
+	ik_frame_ = props.handle<geometry_msgs::PoseStamped>("ik_frame");
+	default_pose_ = props.handle<std::string>("default_pose");
+	min_solution_distance_ = props.handle<double>("min_solution_distance");
+	constraints_ = props.handle<moveit_msgs::Constraints>("constraints");
+	max_ik_solutions_ = props.handle<uint32_t>("max_ik_solutions");
+	num_threads_ = props.handle<uint32_t>("num_threads");
+	batch_size_ = props.handle<uint32_t>("batch_size");
+	batch_ik_solver_ = props.handle<utils::BatchIKSolverPtr>("batch_ik_solver");
+	reachability_map_ = props.handle<utils::ReachabilityMapConstPtr>("reachability_map");
+	min_reachability_ = props.handle<double>("min_reachability");
+	rank_by_reachability_ = props.handle<bool>("rank_by_reachability");
+	seed_cache_size_ = props.handle<uint32_t>("seed_cache_size");
+	multi_solution_ik_ = props.handle<bool>("multi_solution_ik");
+
 	if (!validateEEF(props, robot_model, eef_jmg, &msg))
 		errors.push_back(*this, msg);
 	if (!validateGroup(props, robot_model, eef_jmg, jmg, &msg))
@@ -221,31 +465,172 @@ void ComputeIK::onNewSolution(const SolutionBase& s) {
 	assert(s.start()->scene() == s.end()->scene());  // wrapped child should be a generator
 
 	// It's safe to store a pointer to the solution, as the generating stage stores it
-	upstream_solutions_.push(&s);
+	upstream_solutions_.push(RankedSolution{ rank_by_reachability_.get() ? reachabilityScore(s) : 0.0, &s });
+}
+
+double ComputeIK::reachabilityScore(const SolutionBase& s) const {
+	const utils::ReachabilityMapConstPtr& map = reachability_map_.get();
+	if (!map)
+		return 0.0;
+
+	// target_pose is usually provided by the interface state, falling back to our own property
+	const PropertyMap& state_props = s.start()->properties();
+	const boost::any& value = state_props.hasProperty("target_pose") && state_props.property("target_pose").defined() ?
+	                              state_props.get("target_pose") :
+	                              target_pose_.property().value();
+	if (value.empty())
+		return 0.0;
+	const auto& target_pose_msg = boost::any_cast<const geometry_msgs::PoseStamped&>(value);
+	const planning_scene::PlanningScene& scene = *s.start()->scene();
+	const std::string& frame = target_pose_msg.header.frame_id;
+	if (!frame.empty() && !scene.knowsFrameTransform(frame))
+		return 0.0;
+
+	Eigen::Isometry3d target_pose;
+	tf2::fromMsg(target_pose_msg.pose, target_pose);
+	if (!frame.empty())
+		target_pose = scene.getFrameTransform(frame) * target_pose;
+	return ::moveit::task_constructor::stages::reachabilityScore(*map, scene, target_pose);
 }
 
 bool ComputeIK::canCompute() const {
-	return !upstream_solutions_.empty() || WrapperBase::canCompute();
+	return !suspended_targets_.empty() || !upstream_solutions_.empty() || WrapperBase::canCompute();
 }
 
+// IK target prepared from a solution of the wrapped stage
+struct ComputeIK::IKTarget
+{
+	const SolutionBase* solution;
+	const moveit::core::JointModelGroup* jmg;
+	const moveit::core::LinkModel* link;  // link to be placed at target_pose
+	Eigen::Isometry3d target_pose;
+	std::unique_ptr<moveit::core::RobotState> sandbox_state;
+	SolutionBase::SharedMarkers frame_markers;  // shared by all solutions of this target
+	SolutionBase::SharedMarkers eef_markers;
+	std::vector<double> compare_pose;  // joint values to compute costs of solutions from
+	kinematic_constraints::KinematicConstraintSetConstPtr constraint_set;
+	bool ignore_collisions;
+	double min_solution_distance;
+	uint32_t max_ik_solutions;
+	uint32_t num_threads;
+	bool concurrent = false;  // solved concurrently to other targets
+	double timeout;
+	bool multi_solution_ik;
+	bool batch_solved = false;  // batch_solutions were provided by the batch IK solver
+	std::vector<std::vector<double>> batch_solutions;
+
+	// state of the search, kept while it is suspended
+	bool started = false;
+	IKSolutions ik_solutions;
+	size_t num_valid_solutions = 0;
+	size_t attempt = 0;
+	double remaining_time;
+	std::vector<std::vector<double>> cached_seeds;
+	std::vector<double> current_seed;
+	planning_scene::PlanningSceneConstPtr solution_parent;  // (flattened) base of solution states, set on demand
+};
+
+ComputeIK::~ComputeIK() = default;
+
 void ComputeIK::compute() {
 	if (WrapperBase::canCompute())
 		WrapperBase::compute();
 
-	if (upstream_solutions_.empty())
+	// resume suspended targets first, then prepare new ones sequentially, as this reads their interface states
+	const uint32_t batch_size = std::max(batch_size_.get(), 1u);
+	std::vector<IKTarget> targets;
+	while (targets.size() < batch_size && !suspended_targets_.empty()) {
+		targets.push_back(std::move(*suspended_targets_.front()));
+		suspended_targets_.pop_front();
+	}
+	const size_t num_resumed = targets.size();
+	while (targets.size() < batch_size && !upstream_solutions_.empty()) {
+		targets.emplace_back();
+		if (!prepareTarget(*upstream_solutions_.pop().solution, targets.back()))
+			targets.pop_back();
+	}
+
+	// query IK candidates of all new targets at once
+	const utils::BatchIKSolverPtr& batch_solver = batch_ik_solver_.get();
+	if (batch_solver && targets.size() > num_resumed) {
+		std::vector<utils::BatchIKSolver::Query> queries;
+		queries.reserve(targets.size() - num_resumed);
+		for (size_t i = num_resumed; i < targets.size(); ++i)
+			queries.push_back({ targets[i].jmg, targets[i].link, targets[i].target_pose, targets[i].sandbox_state.get(),
+			                    targets[i].max_ik_solutions, batchValidity(targets[i]) });
+		utils::BatchIKSolver::Solutions solutions;
+		{
+			utils::ScopedTimer timer("ik", "batchIK");
+			batch_solver->solve(queries, targets[num_resumed].timeout, solutions);
+		}
+		for (size_t i = num_resumed; i < targets.size(); ++i) {
+			targets[i].batch_solved = true;
+			if (i - num_resumed < solutions.size())
+				targets[i].batch_solutions = std::move(solutions[i - num_resumed]);
+		}
+	}
+
+	// solving concurrently requires a thread-safe kinematics solver: only do so if the user opted in via num_threads
+	const uint32_t num_threads = std::max(num_threads_.get(), 1u);
+	utils::ThreadPool* pool = nullptr;
+	if (targets.size() > 1 && num_threads > 1) {
+		pool = pimpl()->threadPool();
+		if (!pool) {  // planning sequentially: use a stage-specific pool
+			if (!ik_thread_pool_ || ik_thread_pool_->size() != num_threads)
+				ik_thread_pool_ = std::make_shared<utils::ThreadPool>(utils::ThreadPool::shared(), num_threads);
+			pool = ik_thread_pool_.get();
+		}
+	}
+	if (!pool) {
+		for (IKTarget& target : targets)
+			if (!solveTarget(target))
+				suspended_targets_.push_back(std::make_unique<IKTarget>(std::move(target)));
 		return;
+	}
 
-	const SolutionBase& s = *upstream_solutions_.pop();
+	// solve targets concurrently (each using a single seed thread), spawning their solutions in order afterwards
+	std::vector<DeferredActions> actions(targets.size());
+	std::vector<char> finished(targets.size(), true);
+	std::vector<utils::ThreadPool::Job> jobs;
+	jobs.reserve(targets.size());
+	for (size_t i = 0; i < targets.size(); ++i) {
+		targets[i].num_threads = 1;
+		targets[i].concurrent = true;
+		jobs.emplace_back([this, &target = targets[i], &actions = actions[i], &finished = finished[i],
+		                   profiling = utils::Profiler::context(), cancellation = utils::CancellationToken::current(),
+		                   deadline = utils::TimeSlice::deadline()] {
+			DeferredActions::Scope scope(actions);
+			utils::Profiler::Activation activation(profiling);
+			utils::CancellationToken::Activation cancellation_activation(cancellation);
+			utils::TimeSlice::Activation time_slice(deadline);
+			finished = solveTarget(target);
+		});
+	}
+	std::exception_ptr error;
+	try {
+		pool->run(jobs);
+	} catch (...) {
+		error = std::current_exception();
+	}
+	for (auto& a : actions)
+		a.apply();
+	if (error)
+		std::rethrow_exception(error);
+	for (size_t i = 0; i < targets.size(); ++i)
+		if (!finished[i])
+			suspended_targets_.push_back(std::make_unique<IKTarget>(std::move(targets[i])));
+}
 
+bool ComputeIK::prepareTarget(const SolutionBase& s, IKTarget& target) {
 	// -1 TODO: this should not be necessary in my opinion: Why do you think so?
 	// It is, because the properties on the interface might change from call to call...
 	// enforced initialization from interface ensures that new target_pose is read
-	properties().performInitFrom(INTERFACE, s.start()->properties());
+	properties().performInitFrom(pimpl()->interface_init_plan_, s.start()->properties());
 	const auto& props = properties();
 
 	const planning_scene::PlanningSceneConstPtr& scene{ s.start()->scene() };
 
-	const bool ignore_collisions = props.get<bool>("ignore_collisions");
+	const bool ignore_collisions = ignore_collisions_.get();
 	const auto& robot_model = scene->getRobotModel();
 	const moveit::core::JointModelGroup* eef_jmg = nullptr;
 	const moveit::core::JointModelGroup* jmg = nullptr;
@@ -253,20 +638,20 @@ void ComputeIK::compute() {
 
 	if (!validateEEF(props, robot_model, eef_jmg, &msg)) {
 		ROS_WARN_STREAM_NAMED("ComputeIK", msg);
-		return;
+		return false;
 	}
 	if (!validateGroup(props, robot_model, eef_jmg, jmg, &msg)) {
 		ROS_WARN_STREAM_NAMED("ComputeIK", msg);
-		return;
+		return false;
 	}
 	if (!eef_jmg && !jmg) {
 		ROS_WARN_STREAM_NAMED("ComputeIK", "Neither eef nor group are well defined");
-		return;
+		return false;
 	}
 	properties().property("timeout").setDefaultValue(jmg->getDefaultIKTimeout());
 
 	// extract target_pose
-	geometry_msgs::PoseStamped target_pose_msg = props.get<geometry_msgs::PoseStamped>("target_pose");
+	geometry_msgs::PoseStamped target_pose_msg = target_pose_.get();
 	if (target_pose_msg.header.frame_id.empty())  // if not provided, assume planning frame
 		target_pose_msg.header.frame_id = scene->getPlanningFrame();
 
@@ -276,22 +661,24 @@ void ComputeIK::compute() {
 		if (!scene->knowsFrameTransform(target_pose_msg.header.frame_id)) {
 			ROS_WARN_STREAM_NAMED("ComputeIK",
 			                      "Unknown reference frame for target pose: " << target_pose_msg.header.frame_id);
-			return;
+			return false;
 		}
 		// transform target_pose w.r.t. planning frame
 		target_pose = scene->getFrameTransform(target_pose_msg.header.frame_id) * target_pose;
 	}
+	const Eigen::Isometry3d ik_frame_target = target_pose;  // target of the ik frame itself
 
 	// determine IK link from ik_frame
 	const moveit::core::LinkModel* link = nullptr;
 	geometry_msgs::PoseStamped ik_pose_msg;
-	const boost::any& value = props.get("ik_frame");
+	Eigen::Isometry3d ik_offset = Eigen::Isometry3d::Identity();  // pose of the ik frame w.r.t. link
+	const boost::any& value = ik_frame_.property().value();
 	if (value.empty()) {  // property undefined
 		//  determine IK link from eef/group
 		if (!(link = eef_jmg ? robot_model->getLinkModel(eef_jmg->getEndEffectorParentGroup().second) :
                              jmg->getOnlyOneEndEffectorTip())) {
 			ROS_WARN_STREAM_NAMED("ComputeIK", "Failed to derive IK target link");
-			return;
+			return false;
 		}
 		ik_pose_msg.header.frame_id = link->getName();
 		ik_pose_msg.pose.orientation.w = 1.0;
@@ -303,166 +690,417 @@ void ComputeIK::compute() {
 		if (!scene->getCurrentState().knowsFrameTransform(ik_pose_msg.header.frame_id)) {
 			ROS_WARN_STREAM_NAMED("ComputeIK",
 			                      fmt::format("ik frame unknown in robot: '{}'", ik_pose_msg.header.frame_id));
-			return;
+			return false;
 		}
 		ik_pose = scene->getCurrentState().getFrameTransform(ik_pose_msg.header.frame_id) * ik_pose;
 
 		link = scene->getCurrentState().getRigidlyConnectedParentLinkModel(ik_pose_msg.header.frame_id);
+		ik_offset = scene->getCurrentState().getFrameTransform(link->getName()).inverse() * ik_pose;
 
 		// transform target pose such that ik frame will reach there if link does
 		target_pose = target_pose * ik_pose.inverse() * scene->getCurrentState().getFrameTransform(link->getName());
 	}
 
+	// pre-screen the target with the reachability map before any (expensive) collision check or IK
+	if (const utils::ReachabilityMapConstPtr& map = reachability_map_.get()) {
+		if (!map->matches(robot_model->getName(), jmg->getName(), link->getName(), ik_offset)) {
+			ROS_WARN_STREAM_ONCE_NAMED("ComputeIK", fmt::format("reachability map of '{}' ({}, {}) doesn't match the "
+			                                                    "ik frame ({}, {}, or its offset): ignoring it",
+			                                                    map->robotName(), map->group(), map->link(),
+			                                                    jmg->getName(), link->getName()));
+		} else {
+			const double score = reachabilityScore(*map, *scene, ik_frame_target);
+			const double min_score = min_reachability_.get();
+			if (score <= 0.0 || score < min_score) {
+				++num_rejected_by_reachability_;
+				if (storeFailures()) {
+					SubTrajectory solution;
+					if (generatesMarkers(MARKERS_BASIC))
+						rviz_marker_tools::appendFrame(solution.markers(), target_pose_msg, 0.1, "target frame");
+					solution.markAsFailure(FailureCode::UNREACHABLE, [comment = s.comment(), score] {
+						return comment + fmt::format(" target unreachable (reachability score {:.3f})", score);
+					});
+					spawn(InterfaceState(scene), std::move(solution));
+				} else
+					silentFailure(FailureCode::UNREACHABLE);
+				return false;
+			}
+		}
+	}
+
 	// validate placed link for collisions
 	collision_detection::CollisionResult collisions;
 	moveit::core::RobotState sandbox_state{ scene->getCurrentState() };
-	bool colliding =
-	    !ignore_collisions && isTargetPoseCollidingInEEF(scene, sandbox_state, target_pose, link, jmg, &collisions);
+	bool colliding = false;
+	if (!ignore_collisions) {
+		// cheap check of the placed eef against the world first, rejecting most colliding targets
+		const EEFLinks& eef = eefLinks(*robot_model, placeLink(sandbox_state, target_pose, link));
+		colliding = isEEFCollidingWithWorld(*scene, sandbox_state, eef.subtree, eef.others, &collisions) ||
+		            isTargetPoseCollidingInEEF(scene, sandbox_state, target_pose, link, jmg, &collisions);
+	}
 
 	// frames at target pose and ik frame
-	std::deque<visualization_msgs::Marker> frame_markers;
-	rviz_marker_tools::appendFrame(frame_markers, target_pose_msg, 0.1, "target frame");
-	rviz_marker_tools::appendFrame(frame_markers, ik_pose_msg, 0.1, "ik frame");
+	std::vector<visualization_msgs::Marker> frame_markers;
+	if (generatesMarkers(MARKERS_BASIC)) {
+		rviz_marker_tools::appendFrame(frame_markers, target_pose_msg, 0.1, "target frame");
+		rviz_marker_tools::appendFrame(frame_markers, ik_pose_msg, 0.1, "ik frame");
+	}
 	// end-effector markers
-	std::deque<visualization_msgs::Marker> eef_markers;
+	std::vector<visualization_msgs::Marker> eef_markers;
 	// visualize placed end-effector
 	auto appender = [&eef_markers](visualization_msgs::Marker& marker, const std::string& /*name*/) {
 		marker.ns = "ik target";
 		marker.color.a *= 0.5;
 		eef_markers.push_back(marker);
 	};
+	const bool eef_markers_enabled = generatesMarkers(MARKERS_FULL);
 	const auto& links_to_visualize = moveit::core::RobotModel::getRigidlyConnectedParentLinkModel(link)
 	                                     ->getParentJointModel()
 	                                     ->getDescendantLinkModels();
 	if (colliding) {
 		SubTrajectory solution;
 		std::copy(frame_markers.begin(), frame_markers.end(), std::back_inserter(solution.markers()));
-		generateCollisionMarkers(sandbox_state, appender, links_to_visualize);
+		if (eef_markers_enabled)
+			generateCollisionMarkers(sandbox_state, appender, links_to_visualize);
 		std::copy(eef_markers.begin(), eef_markers.end(), std::back_inserter(solution.markers()));
-		solution.markAsFailure();
 		// TODO: visualize collisions
-		solution.setComment(s.comment() + " eef in collision: " + listCollisionPairs(collisions.contacts, ", "));
-		auto colliding_scene{ scene->diff() };
+		auto contacts = std::make_shared<const collision_detection::CollisionResult::ContactMap>(
+		    std::move(collisions.contacts));
+		solution.markAsFailure(FailureCode::COLLISION, [comment = s.comment(), contacts] {
+			return comment + " eef in collision: " + listCollisionPairs(*contacts, ", ");
+		});
+		auto colliding_scene{ utils::diffScene(scene) };
 		colliding_scene->setCurrentState(sandbox_state);
 		spawn(InterfaceState(colliding_scene), std::move(solution));
-		return;
-	} else
+		return false;
+	} else if (eef_markers_enabled)
 		generateVisualMarkers(sandbox_state, appender, links_to_visualize);
 
 	// determine joint values of robot pose to compare IK solution with for costs
-	std::vector<double> compare_pose;
-	const std::string& compare_pose_name = props.get<std::string>("default_pose");
+	std::vector<double> current_pose;
+	const std::string& compare_pose_name = default_pose_.get();
 	if (!compare_pose_name.empty()) {
-		moveit::core::RobotState compare_state(robot_model);
-		compare_state.setToDefaultValues(jmg, compare_pose_name);
-		compare_state.copyJointGroupPositions(jmg, compare_pose);
+		if (compare_pose_jmg_ != jmg || compare_pose_name_ != compare_pose_name) {  // update cached pose
+			moveit::core::RobotState compare_state(robot_model);
+			compare_state.setToDefaultValues(jmg, compare_pose_name);
+			compare_state.copyJointGroupPositions(jmg, compare_pose_);
+			compare_pose_jmg_ = jmg;
+			compare_pose_name_ = compare_pose_name;
+		}
 	} else
-		scene->getCurrentState().copyJointGroupPositions(jmg, compare_pose);
+		scene->getCurrentState().copyJointGroupPositions(jmg, current_pose);
 
-	double min_solution_distance = props.get<double>("min_solution_distance");
+	double min_solution_distance = min_solution_distance_.get();
 
-	kinematic_constraints::KinematicConstraintSet constraint_set(robot_model);
-	constraint_set.add(props.get<moveit_msgs::Constraints>("constraints"), scene->getTransforms());
+	// reuse constraint set, if constraints didn't change and don't depend on the scene
+	const auto& constraints = constraints_.get();
+	if (!constraint_set_ || !constraint_set_scene_independent_ || constraint_set_msg_ != constraints) {
+		constraint_set_ = std::make_shared<kinematic_constraints::KinematicConstraintSet>(robot_model);
+		constraint_set_->add(constraints, scene->getTransforms());
+		constraint_set_msg_ = constraints;
+		constraint_set_scene_independent_ = isSceneIndependent(constraints, *robot_model);
+	}
 
-	IKSolutions ik_solutions;
-	auto is_valid = [scene, ignore_collisions, min_solution_distance, &constraint_set = std::as_const(constraint_set),
-	                 &ik_solutions](moveit::core::RobotState* state, const moveit::core::JointModelGroup* jmg,
-	                                const double* joint_positions) {
-		for (const auto& sol : ik_solutions) {
-			if (jmg->distance(joint_positions, sol.joint_positions.data()) < min_solution_distance)
-				return false;  // too close to already found solution
-		}
+	target.solution = &s;
+	target.jmg = jmg;
+	target.link = link;
+	target.target_pose = target_pose;
+	target.sandbox_state = std::make_unique<moveit::core::RobotState>(std::move(sandbox_state));
+	target.frame_markers = std::make_shared<const std::vector<visualization_msgs::Marker>>(std::move(frame_markers));
+	target.eef_markers = std::make_shared<const std::vector<visualization_msgs::Marker>>(std::move(eef_markers));
+	target.compare_pose = compare_pose_name.empty() ? std::move(current_pose) : compare_pose_;
+	target.constraint_set = constraint_set_;
+	target.ignore_collisions = ignore_collisions;
+	target.min_solution_distance = min_solution_distance;
+	target.max_ik_solutions = max_ik_solutions_.get();
+	target.num_threads = std::max(num_threads_.get(), 1u);
+	target.timeout = timeout();
+	target.remaining_time = target.timeout;
+	target.multi_solution_ik = multi_solution_ik_.get();
+	seed_cache_.setCapacity(seed_cache_size_.get());
+	return true;
+}
+
+utils::BatchIKSolver::Validity ComputeIK::batchValidity(const IKTarget& target) const {
+	// only checks validity, candidates are recorded (with their failure reasons) by solveTarget()
+	return [scene = target.solution->start()->scene(), constraint_set = target.constraint_set,
+	        ignore_collisions = target.ignore_collisions](moveit::core::RobotState* state,
+	                                                      const moveit::core::JointModelGroup* jmg,
+	                                                      const double* joint_positions) {
 		state->setJointGroupPositions(jmg, joint_positions);
 		state->update();
+		if (!constraint_set->decide(*state).satisfied)
+			return false;
+		return ignore_collisions || !scene->isStateColliding(*state, jmg->getName());
+	};
+}
 
-		ik_solutions.emplace_back();
-		auto& solution{ ik_solutions.back() };
-		state->copyJointGroupPositions(jmg, solution.joint_positions);
-
-		// validate constraints
-		solution.satisfies_constraints = constraint_set.decide(*state).satisfied;
-
-		// check for collisions
-		collision_detection::CollisionRequest req;
-		collision_detection::CollisionResult res;
-		req.contacts = true;
-		req.max_contacts = 1;
-		req.group_name = jmg->getName();
-		scene->checkCollision(req, res, *state);
-		solution.collision_free = ignore_collisions || !res.collision;
-		if (!res.contacts.empty()) {
-			solution.contact = res.contacts.begin()->second.front();
+bool ComputeIK::solveTarget(IKTarget& target) {
+	const SolutionBase& s = *target.solution;
+	const planning_scene::PlanningSceneConstPtr& scene{ s.start()->scene() };
+	const moveit::core::JointModelGroup* jmg = target.jmg;
+	const moveit::core::LinkModel* link = target.link;
+	const Eigen::Isometry3d& target_pose = target.target_pose;
+	moveit::core::RobotState& sandbox_state = *target.sandbox_state;
+	const SolutionBase::SharedMarkers& frame_markers = target.frame_markers;
+	const SolutionBase::SharedMarkers& eef_markers = target.eef_markers;
+	const std::vector<double>& compare_pose = target.compare_pose;
+	const kinematic_constraints::KinematicConstraintSet& constraint_set = *target.constraint_set;
+	const bool ignore_collisions = target.ignore_collisions;
+	const double min_solution_distance = target.min_solution_distance;
+	const uint32_t max_ik_solutions = target.max_ik_solutions;
+	const uint32_t num_threads = target.num_threads;
+
+	// collision request shared by all candidates: only check the active group, report a single contact
+	collision_detection::CollisionRequest collision_request;
+	collision_request.contacts = true;
+	collision_request.max_contacts = 1;
+	collision_request.group_name = jmg->getName();
+	// concurrent collision checks need their own collision environment: use per-thread clones of the scene
+	const utils::ThreadLocalSceneView scene_view(num_threads > 1 || target.concurrent ? scene : nullptr);
+
+	const auto cancellation = utils::CancellationToken::current();
+	IKSolutions& ik_solutions = target.ik_solutions;
+	size_t& num_valid_solutions = target.num_valid_solutions;
+	// is joint_positions farther than min_solution_distance from all given solutions?
+	auto is_new = [jmg, min_solution_distance](const double* joint_positions, const IKSolutions& solutions) {
+		for (const auto& sol : solutions) {
+			if (jmg->distance(joint_positions, sol.joint_positions.data()) < min_solution_distance)
+				return false;  // too close to already found solution
 		}
-
-		return solution.satisfies_constraints && solution.collision_free;
+		return true;
 	};
+	// create validity callback for a seed, reusing the given CollisionResult for all its candidates
+	// Solutions are appended to found (and counted in found_valid): concurrent seeds use their own lists,
+	// which are merged into ik_solutions in seed order afterwards. Thus, ik_solutions isn't modified meanwhile.
+	auto make_is_valid = [this, scene, &scene_view, ignore_collisions, &is_new,
+	                      &constraint_set = std::as_const(constraint_set),
+	                      &collision_request = std::as_const(collision_request), &ik_solutions, &num_valid_solutions,
+	                      &cancellation, max_ik_solutions](collision_detection::CollisionResult& res, IKSolutions& found,
+	                                                       size_t& found_valid) {
+		return [=, &scene_view, &is_new, &constraint_set, &collision_request, &ik_solutions, &num_valid_solutions,
+		        &cancellation, &res, &found, &found_valid](moveit::core::RobotState* state,
+		                                                   const moveit::core::JointModelGroup* jmg,
+		                                                   const double* joint_positions) {
+			if (cancellation.cancelled())
+				return true;  // planning was cancelled: stop searching
+			if (&found != &ik_solutions) {  // concurrent seed: check against solutions of previous attempts too
+				if (num_valid_solutions + found_valid >= max_ik_solutions)
+					return true;  // this seed found enough solutions already: stop searching
+				if (!is_new(joint_positions, ik_solutions))
+					return false;
+			}
+			if (!is_new(joint_positions, found))
+				return false;
+			state->setJointGroupPositions(jmg, joint_positions);
+			state->update();
+
+			IKSolution solution;
+			state->copyJointGroupPositions(jmg, solution.joint_positions);
+
+			// validate constraints first, skipping the more expensive collision check on failure
+			solution.satisfies_constraints = constraint_set.decide(*state).satisfied;
+			solution.collision_free = true;
+			if (!solution.satisfies_constraints)
+				++num_rejected_by_constraints_;
+			else if (!ignore_collisions) {
+				res.clear();
+				utils::ScopedTimer timer("collision", "checkCollision");
+				(scene_view.scene() ? scene_view.local() : *scene).checkCollision(collision_request, res, *state);
+				solution.collision_free = !res.collision;
+				if (!res.contacts.empty())
+					solution.contact = res.contacts.begin()->second.front();
+				if (!solution.collision_free)
+					++num_rejected_by_collision_;
+			}
 
-	uint32_t max_ik_solutions = props.get<uint32_t>("max_ik_solutions");
-	bool tried_current_state_as_seed = false;
-
-	double remaining_time = timeout();
-	auto start_time = std::chrono::steady_clock::now();
-	while (ik_solutions.size() < max_ik_solutions && remaining_time > 0) {
-		if (tried_current_state_as_seed) {
-			sandbox_state.setToRandomPositions(jmg);
-			sandbox_state.update();
+			const bool valid = solution.satisfies_constraints && solution.collision_free;
+			found.push_back(std::move(solution));
+			if (valid)
+				++found_valid;
+			return valid;
+		};
+	};
+	std::vector<collision_detection::CollisionResult> collision_results(num_threads);
+	planning_scene::PlanningSceneConstPtr& solution_parent = target.solution_parent;
+	const std::vector<int>& group_variables = jmg->getVariableIndexList();
+
+	// Seeds processed concurrently need their own RobotState.
+	// The kinematics solver of the group is shared between them and thus needs to be thread-safe.
+	std::vector<moveit::core::RobotState> seed_states;
+	std::vector<IKSolutions> seed_solutions;
+	std::vector<size_t> seed_valid;
+	std::vector<utils::ThreadPool::Job> seed_jobs;
+	utils::ThreadPool* pool = nullptr;
+	if (num_threads > 1) {
+		pool = pimpl()->threadPool();
+		if (!pool) {  // planning sequentially: use a stage-specific pool
+			if (!ik_thread_pool_ || ik_thread_pool_->size() != num_threads)
+				ik_thread_pool_ = std::make_shared<utils::ThreadPool>(utils::ThreadPool::shared(), num_threads);
+			pool = ik_thread_pool_.get();
 		}
-		tried_current_state_as_seed = true;
-
-		size_t previous = ik_solutions.size();
-		bool succeeded = sandbox_state.setFromIK(jmg, target_pose, link->getName(), remaining_time, is_valid);
+		seed_states.resize(num_threads, sandbox_state);
+		seed_solutions.resize(num_threads);
+		seed_valid.resize(num_threads);
+	}
 
-		auto now = std::chrono::steady_clock::now();
-		remaining_time -= std::chrono::duration<double>(now - start_time).count();
-		start_time = now;
+	// seeds: solutions of nearby previous targets, the current state, random states
+	const std::vector<std::vector<double>>& cached_seeds = target.cached_seeds;
+	const std::vector<double>& current_seed = target.current_seed;
+	size_t& attempt = target.attempt;
+	if (!target.started) {
+		target.cached_seeds = seed_cache_.nearest(jmg, target_pose, num_threads);
+		sandbox_state.copyJointGroupPositions(jmg, target.current_seed);
+	}
+	auto prepare_seed = [&cached_seeds, &current_seed, jmg](moveit::core::RobotState& seed_state, size_t index) {
+		if (index < cached_seeds.size())
+			seed_state.setJointGroupPositions(jmg, cached_seeds[index]);
+		else if (index == cached_seeds.size())
+			seed_state.setJointGroupPositions(jmg, current_seed);
+		else
+			seed_state.setToRandomPositions(jmg);
+		seed_state.update();
+	};
 
-		// for all new solutions (successes and failures)
-		for (size_t i = previous; i != ik_solutions.size(); ++i) {
-			// create a new scene for each solution as they will have different robot states
-			planning_scene::PlanningScenePtr solution_scene = scene->diff();
+	// spawn all solutions found since index first (successes and failures)
+	auto spawn_solutions = [&](size_t first) {
+		for (size_t i = first; i != ik_solutions.size(); ++i) {
+			// solutions only differ in their robot states: create lightweight states, creating their scenes on demand
+			if (!solution_parent)
+				solution_parent = utils::flattenScene(scene);
 			SubTrajectory solution;
 			solution.setComment(s.comment());
-			std::copy(frame_markers.begin(), frame_markers.end(), std::back_inserter(solution.markers()));
+			solution.addSharedMarkers(frame_markers);
 
-			if (ik_solutions[i].collision_free && ik_solutions[i].satisfies_constraints)
+			if (ik_solutions[i].collision_free && ik_solutions[i].satisfies_constraints) {
 				// compute cost as distance to compare_pose
 				solution.setCost(s.cost() + jmg->distance(ik_solutions[i].joint_positions.data(), compare_pose.data()));
-			else if (!ik_solutions[i].collision_free) {  // solution was in collision
-				std::stringstream ss;
-				ss << "Collision between '" << ik_solutions[i].contact.body_name_1 << "' and '"
-				   << ik_solutions[i].contact.body_name_2 << "'";
-				solution.markAsFailure(ss.str());
+				seed_cache_.insert(jmg, target_pose, ik_solutions[i].joint_positions);
+			} else if (!ik_solutions[i].collision_free) {  // solution was in collision
+				solution.markAsFailure(FailureCode::COLLISION, [body_1 = ik_solutions[i].contact.body_name_1,
+				                                                body_2 = ik_solutions[i].contact.body_name_2] {
+					return "Collision between '" + body_1 + "' and '" + body_2 + "'";
+				});
 			} else if (!ik_solutions[i].satisfies_constraints) {  // solution was violating constraints
-				solution.markAsFailure("Constraints violated");
+				solution.markAsFailure(FailureCode::CONSTRAINTS_VIOLATED, "Constraints violated");
 			}
-			// set scene's robot state
-			moveit::core::RobotState& solution_state = solution_scene->getCurrentStateNonConst();
-			solution_state.setJointGroupPositions(jmg, ik_solutions[i].joint_positions.data());
-			solution_state.update();
-
-			InterfaceState state(solution_scene);
+			// set joints of the group
+			const moveit::core::RobotState& base_state = solution_parent->getCurrentState();
+			std::vector<double> positions(base_state.getVariablePositions(),
+			                              base_state.getVariablePositions() + base_state.getVariableCount());
+			for (size_t k = 0; k < group_variables.size(); ++k)
+				positions[group_variables[k]] = ik_solutions[i].joint_positions[k];
+
+			InterfaceState state(solution_parent, std::move(positions));
 			forwardProperties(*s.start(), state);
 
 			// ik target link placement
-			std::copy(eef_markers.begin(), eef_markers.end(), std::back_inserter(solution.markers()));
+			solution.addSharedMarkers(eef_markers);
 
 			spawn(std::move(state), std::move(solution));
 		}
+	};
+
+	double& remaining_time = target.remaining_time;
+	auto start_time = std::chrono::steady_clock::now();
+
+	// validate given candidates like solutions found by setFromIK()
+	auto validate_candidates = [&](const std::vector<std::vector<double>>& candidates) {
+		auto is_valid = make_is_valid(collision_results[0], ik_solutions, num_valid_solutions);
+		for (const std::vector<double>& candidate : candidates) {
+			if (ik_solutions.size() >= max_ik_solutions || cancellation.cancelled())
+				break;
+			if (jmg->satisfiesPositionBounds(candidate.data()))
+				is_valid(&sandbox_state, jmg, candidate.data());
+		}
+		spawn_solutions(0);
+	};
+
+	// the batch IK solver already provided the candidates of this target, seeding continues if they don't suffice
+	// analytic solvers return all solution branches in a single call, rendering random seeds pointless
+	bool all_branches = false;
+	if (!target.started && target.batch_solved) {
+		validate_candidates(target.batch_solutions);
+		const utils::BatchIKSolverPtr& batch_solver = batch_ik_solver_.get();
+		all_branches = batch_solver && batch_solver->allBranches();
+	} else if (!target.started && target.multi_solution_ik && max_ik_solutions > 1) {
+		std::vector<std::vector<double>> branches;
+		bool queried;
+		{
+			utils::ScopedTimer timer("ik", "getPositionIK");
+			queried = queryAllIKSolutions(sandbox_state, jmg, link, target_pose, branches);
+		}
+		if (queried) {
+			validate_candidates(branches);
+			all_branches = branches.size() > 1;
+		}
+	}
+	target.started = true;
+
+	const auto searching = [&] {
+		return !all_branches && ik_solutions.size() < max_ik_solutions && remaining_time > 0 && !cancellation.cancelled();
+	};
+	while (searching()) {
+		size_t previous = ik_solutions.size();
+		bool succeeded = false;
+		// limit the attempt to the time slice, but still grant some time when it is used up already
+		const double attempt_time = std::min(remaining_time, std::max(utils::TimeSlice::remaining(), 1e-3));
+		if (num_threads == 1) {
+			prepare_seed(sandbox_state, attempt);
+			utils::ScopedTimer timer("ik", "setFromIK");
+			succeeded = sandbox_state.setFromIK(jmg, target_pose, link->getName(), attempt_time,
+			                                    make_is_valid(collision_results[0], ik_solutions, num_valid_solutions));
+		} else {
+			std::atomic<bool> any_succeeded{ false };
+			seed_jobs.clear();
+			for (uint32_t i = 0; i < num_threads; ++i)
+				seed_jobs.emplace_back([&, i, profiling = utils::Profiler::context()] {
+					utils::Profiler::Activation activation(profiling);
+					utils::ScopedTimer timer("ik", "setFromIK");
+					moveit::core::RobotState& seed_state = seed_states[i];
+					seed_solutions[i].clear();
+					seed_valid[i] = 0;
+					prepare_seed(seed_state, attempt + i);
+					if (seed_state.setFromIK(jmg, target_pose, link->getName(), attempt_time,
+					                         make_is_valid(collision_results[i], seed_solutions[i], seed_valid[i])))
+						any_succeeded = true;
+				});
+			pool->run(seed_jobs);
+			succeeded = any_succeeded;
+
+			// merge in seed order, independent of thread timing, dropping solutions similar to those of earlier seeds
+			for (IKSolutions& found : seed_solutions)
+				for (IKSolution& solution : found) {
+					if (ik_solutions.size() >= max_ik_solutions || !is_new(solution.joint_positions.data(), ik_solutions))
+						continue;
+					if (solution.collision_free && solution.satisfies_constraints)
+						++num_valid_solutions;
+					ik_solutions.push_back(std::move(solution));
+				}
+		}
+		attempt += num_threads;
+
+		auto now = std::chrono::steady_clock::now();
+		remaining_time -= std::chrono::duration<double>(now - start_time).count();
+		start_time = now;
+
+		spawn_solutions(previous);
 
 		// TODO: magic constant should be a property instead ("current_seed_only", or equivalent)
 		// Yeah, you are right, these are two different semantic concepts:
 		// One could also have multiple IK solutions derived from the same seed
-		if (!succeeded && max_ik_solutions == 1)
-			break;  // first and only attempt failed
+		if (!succeeded && max_ik_solutions == 1 && attempt > cached_seeds.size())
+			break;  // first and only attempt (from the current state) failed
+		if (utils::TimeSlice::expired() && searching())
+			return false;  // suspend the search, resuming it in a later compute()
 	}
 
 	if (ik_solutions.empty()) {  // failed to find any solution
-		planning_scene::PlanningScenePtr scene = s.start()->scene()->diff();
+		planning_scene::PlanningScenePtr scene = utils::diffScene(s.start()->scene());
 		SubTrajectory solution;
 
-		solution.markAsFailure();
-		solution.setComment(s.comment() + " no IK found");
-		std::copy(frame_markers.begin(), frame_markers.end(), std::back_inserter(solution.markers()));
+		solution.markAsFailure(FailureCode::NO_IK_SOLUTION, [comment = s.comment()] { return comment + " no IK found"; });
+		solution.addSharedMarkers(frame_markers);
 
 		// ik target link placement
 		std_msgs::ColorRGBA tint_color;
@@ -470,12 +1108,14 @@ void ComputeIK::compute() {
 		tint_color.g = 0.0;
 		tint_color.b = 0.0;
 		tint_color.a = 0.5;
-		for (auto& marker : eef_markers)
-			marker.color = tint_color;
-		std::copy(eef_markers.begin(), eef_markers.end(), std::back_inserter(solution.markers()));
+		for (const auto& marker : *eef_markers) {
+			solution.markers().push_back(marker);
+			solution.markers().back().color = tint_color;
+		}
 
 		spawn(InterfaceState(scene), std::move(solution));
 	}
+	return true;
 }
 }  // namespace stages
 }  // namespace task_constructor
@@ -38,29 +38,41 @@
 
 #include <moveit/task_constructor/stages/connect.h>
 #include <moveit/task_constructor/merge.h>
+#include <moveit/task_constructor/collision_checker.h>
 #include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/stage_p.h>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/task_constructor/profiler.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <numeric>
+
 using namespace trajectory_processing;
 
 namespace moveit {
 namespace task_constructor {
 namespace stages {
 
-Connect::Connect(const std::string& name, const GroupPlannerVector& planners) : Connecting(name), planner_(planners) {
+Connect::Connect(const std::string& name, const GroupPlannerVector& planners)
+  : Connecting(name)
+  , planner_(planners)
+  , merge_mode_(properties(), "merge_mode", WAYPOINTS, "merge mode")
+  , max_distance_(properties(), "max_distance", 1e-4,
+                  "maximally accepted joint configuration distance between trajectory endpoint and goal state")
+  , path_constraints_(properties(), "path_constraints", moveit_msgs::Constraints(),
+                      "constraints to maintain during trajectory")
+  , goal_set_(properties(), "goal_set", false, "plan pairs sharing their start state towards all their goals at once") {
 	setTimeout(1.0);
 	setCostTerm(std::make_unique<cost::PathLength>());
 
-	auto& p = properties();
-	p.declare<MergeMode>("merge_mode", WAYPOINTS, "merge mode");
-	p.declare<double>("max_distance", 1e-4,
-	                  "maximally accepted joint configuration distance between trajectory endpoint and goal state");
-	p.declare<moveit_msgs::Constraints>("path_constraints", moveit_msgs::Constraints(),
-	                                    "constraints to maintain during trajectory");
 	properties().declare<TimeParameterizationPtr>("merge_time_parameterization",
 	                                              std::make_shared<TimeOptimalTrajectoryGeneration>());
 }
@@ -86,13 +98,24 @@ void Connect::init(const core::RobotModelConstPtr& robot_model) {
 		else if (!pair.second)
 			errors.push_back(*this, "invalid planner for group: " + pair.first);
 		else {
-			pair.second->init(robot_model);
+			pair.second->initShared(robot_model);
 
 			auto jmg = robot_model->getJointModelGroup(pair.first);
 			groups.push_back(jmg);
 		}
 	}
 
+	// collect the variables of all joints we don't plan for, which need to match in compatible() state pairs
+	std::vector<bool> planned(robot_model->getVariableCount(), false);
+	for (const moveit::core::JointModelGroup* jmg : groups)
+		for (const moveit::core::JointModel* jm : jmg->getJointModels())
+			for (size_t i = 0; i < jm->getVariableCount(); ++i)
+				planned[jm->getFirstVariableIndex() + i] = true;
+	unplanned_variables_.clear();
+	for (size_t index = 0; index < planned.size(); ++index)
+		if (!planned[index])
+			unplanned_variables_.push_back(index);
+
 	if (!errors && groups.size() >= 2 && !merged_jmg_) {  // enable merging?
 		try {
 			merged_jmg_.reset(task_constructor::merge(groups));
@@ -106,91 +129,221 @@ void Connect::init(const core::RobotModelConstPtr& robot_model) {
 }
 
 bool Connect::compatible(const InterfaceState& from_state, const InterfaceState& to_state) const {
-	if (!Connecting::compatible(from_state, to_state))
-		return false;
-
-	const moveit::core::RobotState& from = from_state.scene()->getCurrentState();
-	const moveit::core::RobotState& to = to_state.scene()->getCurrentState();
-
-	// compose set of joint names we plan for
-	std::set<std::string> planned_joint_names;
-	for (const GroupPlannerVector::value_type& pair : planner_) {
-		const moveit::core::JointModelGroup* jmg = from.getJointModelGroup(pair.first);
-		const auto& names = jmg->getJointModelNames();
-		planned_joint_names.insert(names.begin(), names.end());
-	}
-	// all active joints that we don't plan for should match
-	for (const moveit::core::JointModel* jm : from.getRobotModel()->getJointModels()) {
-		if (planned_joint_names.count(jm->getName()))
-			continue;  // ignore joints we plan for
-
-		const unsigned int num = jm->getVariableCount();
-		Eigen::Map<const Eigen::VectorXd> positions_from(from.getJointPositions(jm), num);
-		Eigen::Map<const Eigen::VectorXd> positions_to(to.getJointPositions(jm), num);
-		if (!(positions_from - positions_to).isZero(1e-4)) {
-			ROS_INFO_STREAM_NAMED("Connect", fmt::format("Deviation in joint {}: [{}] != [{}]", jm->getName(),
-			                                             positions_from.transpose(), positions_to.transpose()));
+	// all variables of joints we don't plan for should match: check these first, as they are cheap to compare
+	const double* from = from_state.variablePositions();
+	const double* to = to_state.variablePositions();
+	for (int index : unplanned_variables_) {
+		if (std::abs(from[index] - to[index]) > 1e-4) {
+			ROS_INFO_STREAM_NAMED("Connect", fmt::format("Deviation in joint variable {}: {} != {}",
+			                                             from_state.scene()->getRobotModel()->getVariableNames()[index],
+			                                             from[index], to[index]));
 			return false;
 		}
 	}
-	return true;
+	return Connecting::compatible(from_state, to_state);
 }
 
 void Connect::compute(const InterfaceState& from, const InterfaceState& to) {
-	const auto& props = properties();
-	double timeout = this->timeout();
-	MergeMode mode = props.get<MergeMode>("merge_mode");
-	double max_distance = props.get<double>("max_distance");
-	const auto& path_constraints = props.get<moveit_msgs::Constraints>("path_constraints");
+	computeBatch({ { &from, &to } });
+}
 
-	const moveit::core::RobotState& final_goal_state = to.scene()->getCurrentState();
+namespace {
+// intermediate planning result of a single state pair
+struct Attempt
+{
+	const InterfaceState* from;
+	const InterfaceState* to;
 	std::vector<robot_trajectory::RobotTrajectoryConstPtr> sub_trajectories;
-
 	std::vector<planning_scene::PlanningSceneConstPtr> intermediate_scenes;
-	planning_scene::PlanningSceneConstPtr start = from.scene();
-	intermediate_scenes.push_back(start);
-
 	bool success = false;
 	std::string comment = "No planners specified";
+	SubTrajectoryPtr merged;  // result of CONCURRENT planning
+};
+
+// goal scene for planning group jmg: start scene with the group's joints set to their goal positions
+planning_scene::PlanningScenePtr groupGoal(const planning_scene::PlanningSceneConstPtr& start,
+                                           const moveit::core::RobotState& goal,
+                                           const moveit::core::JointModelGroup* jmg, std::vector<double>& positions) {
+	planning_scene::PlanningScenePtr end = utils::diffScene(start);
+	goal.copyJointGroupPositions(jmg, positions);
+	moveit::core::RobotState& goal_state = end->getCurrentStateNonConst();
+	goal_state.setJointGroupPositions(jmg, positions);
+	goal_state.update();
+	return end;
+}
+}  // namespace
+
+void Connect::computeBatch(const StatePairs& pairs) {
+	double timeout = this->timeout();
+	MergeMode mode = merge_mode_.get();
+	double max_distance = max_distance_.get();
+	const auto& path_constraints = path_constraints_.get();
+
+	std::vector<Attempt> attempts;
+	attempts.reserve(pairs.size());
+	for (const auto& pair : pairs)
+		attempts.push_back(Attempt{ pair.first, pair.second, {}, { pair.first->scene() } });
+
+	// record the planning result of the next group
+	auto record = [max_distance](Attempt& attempt, const solvers::PlannerInterface::Result& result,
+	                             const robot_trajectory::RobotTrajectoryPtr& trajectory,
+	                             const solvers::PlannerInterface::Request& request) {
+		attempt.success = bool(result);
+		attempt.sub_trajectories.push_back(trajectory);  // include failed trajectory
+
+		if (!attempt.success)
+			attempt.comment = result.message;
+		else if (trajectory->getLastWayPoint().distance(request.to->getCurrentState(), request.jmg) > max_distance) {
+			attempt.success = false;
+			attempt.comment = "Trajectory end-point deviates too much from goal state";
+		}
+	};
+
 	std::vector<double> positions;
-	for (const GroupPlannerVector::value_type& pair : planner_) {
-		// set intermediate goal state
-		planning_scene::PlanningScenePtr end = start->diff();
-		const moveit::core::JointModelGroup* jmg = final_goal_state.getJointModelGroup(pair.first);
-		final_goal_state.copyJointGroupPositions(jmg, positions);
-		moveit::core::RobotState& goal_state = end->getCurrentStateNonConst();
-		goal_state.setJointGroupPositions(jmg, positions);
-		goal_state.update();
-		intermediate_scenes.push_back(end);
-
-		robot_trajectory::RobotTrajectoryPtr trajectory;
-		auto result = pair.second->plan(start, end, jmg, timeout, trajectory, path_constraints);
-		success = bool(result);
-		sub_trajectories.push_back(trajectory);  // include failed trajectory
-
-		if (!success) {
-			comment = result.message;
-			break;
+	std::vector<Attempt*> pending;  // attempts to plan sequentially
+	if (goal_set_.get() && planner_.size() == 1) {
+		// group attempts by their start state
+		std::vector<std::vector<Attempt*> > sets;
+		std::map<const InterfaceState*, size_t> set_index;
+		for (Attempt& attempt : attempts) {
+			auto inserted = set_index.insert(std::make_pair(attempt.from, sets.size()));
+			if (inserted.second)
+				sets.emplace_back();
+			sets[inserted.first->second].push_back(&attempt);
 		}
 
-		if (trajectory->getLastWayPoint().distance(goal_state, jmg) > max_distance) {
-			success = false;
-			comment = "Trajectory end-point deviates too much from goal state";
-			break;
+		const GroupPlannerVector::value_type& pair = planner_.front();
+		std::vector<solvers::PlannerInterface::Request> requests;
+		std::vector<planning_scene::PlanningSceneConstPtr> goals;
+		for (const std::vector<Attempt*>& set : sets) {
+			if (set.size() < 2) {
+				pending.push_back(set.front());
+				continue;
+			}
+			const planning_scene::PlanningSceneConstPtr& start = set.front()->intermediate_scenes.front();
+			const moveit::core::JointModelGroup* jmg = start->getRobotModel()->getJointModelGroup(pair.first);
+			requests.clear();
+			for (Attempt* attempt : set) {
+				planning_scene::PlanningScenePtr end =
+				    groupGoal(start, attempt->to->scene()->getCurrentState(), jmg, positions);
+				attempt->intermediate_scenes.push_back(end);
+				requests.push_back(solvers::PlannerInterface::Request{ start, end, jmg, timeout, path_constraints });
+			}
+
+			// each request reaches one of the remaining goals, a failure applies to all of them
+			std::vector<size_t> remaining(set.size());  // indices into set and requests
+			std::iota(remaining.begin(), remaining.end(), 0);
+			while (!remaining.empty()) {
+				goals.clear();
+				for (size_t i : remaining)
+					goals.push_back(requests[i].to);
+				robot_trajectory::RobotTrajectoryPtr trajectory;
+				size_t reached = 0;
+				const auto result =
+				    pair.second->planGoalSet(start, goals, jmg, timeout, trajectory, reached, path_constraints);
+				if (!result) {
+					for (size_t i : remaining)
+						record(*set[i], result, nullptr, requests[i]);
+					break;
+				}
+				record(*set[remaining[reached]], result, trajectory, requests[remaining[reached]]);
+				// continue with the goals after the reached one: goals tried before it by sequential planners
+				// (see PlannerInterface::planGoalSet()) are retried last, such that each is retried only once
+				std::rotate(remaining.begin(), remaining.begin() + reached + 1, remaining.end());
+				remaining.pop_back();
+			}
+		}
+	} else if (mode == CONCURRENT && merged_jmg_) {
+		// plan all groups concurrently, each from the start state towards its part of the goal
+		const size_t num_groups = planner_.size();
+		std::vector<std::vector<solvers::PlannerInterface::Request> > group_requests(num_groups);
+		std::vector<std::vector<robot_trajectory::RobotTrajectoryPtr> > group_trajectories(num_groups);
+		std::vector<std::vector<solvers::PlannerInterface::Result> > group_results(num_groups);
+		std::vector<utils::ThreadPool::Job> jobs;
+		jobs.reserve(num_groups);
+		for (size_t group = 0; group < num_groups; ++group) {
+			for (Attempt& attempt : attempts) {
+				const planning_scene::PlanningSceneConstPtr& start = attempt.intermediate_scenes.front();
+				const moveit::core::RobotState& final_goal_state = attempt.to->scene()->getCurrentState();
+				const moveit::core::JointModelGroup* jmg = final_goal_state.getJointModelGroup(planner_[group].first);
+				group_requests[group].push_back(solvers::PlannerInterface::Request{
+				    start, groupGoal(start, final_goal_state, jmg, positions), jmg, timeout, path_constraints });
+			}
+			jobs.emplace_back([this, group, &group_requests, &group_trajectories, &group_results,
+			                   profiling = utils::Profiler::context(), cancellation = utils::CancellationToken::current()] {
+				utils::Profiler::Activation activation(profiling);
+				utils::CancellationToken::Activation cancellation_activation(cancellation);
+				group_results[group] = planner_[group].second->planBatch(group_requests[group], group_trajectories[group]);
+			});
+		}
+		utils::ThreadPool* pool = pimpl()->threadPool();
+		if (!pool) {  // planning sequentially: use a stage-specific pool
+			if (!group_thread_pool_ || group_thread_pool_->size() != num_groups)
+				group_thread_pool_ = std::make_shared<utils::ThreadPool>(utils::ThreadPool::shared(), num_groups);
+			pool = group_thread_pool_.get();
+		}
+		pool->run(jobs);
+
+		for (size_t i = 0; i < attempts.size(); ++i) {
+			Attempt& attempt = attempts[i];
+			for (size_t group = 0; group < num_groups && (group == 0 || attempt.success); ++group)
+				record(attempt, group_results[group][i], group_trajectories[group][i], group_requests[group][i]);
+			if (attempt.success)
+				attempt.merged = merge(attempt.sub_trajectories, attempt.intermediate_scenes,
+				                       attempt.from->scene()->getCurrentState());
+			if (!attempt.merged) {  // planning or merging failed: plan sequentially
+				attempt.sub_trajectories.clear();
+				attempt.success = false;
+				pending.push_back(&attempt);
+			}
+		}
+	} else {
+		for (Attempt& attempt : attempts)
+			pending.push_back(&attempt);
+	}
+
+	// plan all pending pairs in lockstep, passing the requests of each group to its planner at once
+	std::vector<Attempt*> active;
+	std::vector<solvers::PlannerInterface::Request> requests;
+	std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories;
+	for (size_t group = 0; group < planner_.size() && !pending.empty(); ++group) {
+		const GroupPlannerVector::value_type& pair = planner_[group];
+		active.clear();
+		requests.clear();
+		for (Attempt* attempt : pending) {
+			if (group > 0 && !attempt->success)
+				continue;  // failed for a previous group
+
+			// set intermediate goal state
+			const planning_scene::PlanningSceneConstPtr& start = attempt->intermediate_scenes.back();
+			const moveit::core::RobotState& final_goal_state = attempt->to->scene()->getCurrentState();
+			const moveit::core::JointModelGroup* jmg = final_goal_state.getJointModelGroup(pair.first);
+			planning_scene::PlanningScenePtr end = groupGoal(start, final_goal_state, jmg, positions);
+			attempt->intermediate_scenes.push_back(end);
+
+			active.push_back(attempt);
+			requests.push_back(solvers::PlannerInterface::Request{ start, end, jmg, timeout, path_constraints });
 		}
+		if (requests.empty())
+			break;
 
-		// continue from reached state
-		start = end;
+		const auto results = pair.second->planBatch(requests, trajectories);
+		for (size_t i = 0; i < active.size(); ++i)
+			record(*active[i], results[i], trajectories[i], requests[i]);
 	}
 
-	SolutionBasePtr solution;
-	if (success && mode != SEQUENTIAL)  // try to merge
-		solution = merge(sub_trajectories, intermediate_scenes, from.scene()->getCurrentState());
-	if (!solution)  // success == false or merging failed: store sequentially
-		solution = makeSequential(sub_trajectories, intermediate_scenes, from, to);
-	if (!success)  // error during sequential planning
-		solution->markAsFailure(comment);
-	connect(from, to, solution);
+	for (Attempt& attempt : attempts) {
+		const InterfaceState& from = *attempt.from;
+		const InterfaceState& to = *attempt.to;
+		SolutionBasePtr solution = attempt.merged;
+		if (!solution && attempt.success && mode != SEQUENTIAL)  // try to merge
+			solution = merge(attempt.sub_trajectories, attempt.intermediate_scenes, from.scene()->getCurrentState());
+		if (!solution)  // success == false or merging failed: store sequentially
+			solution = makeSequential(attempt.sub_trajectories, attempt.intermediate_scenes, from, to);
+		if (!attempt.success)  // error during sequential planning
+			solution->markAsFailure(FailureCode::PLANNING_FAILED, attempt.comment);
+		connect(from, to, solution);
+	}
 }
 
 SolutionSequencePtr
@@ -211,7 +364,9 @@ Connect::makeSequential(const std::vector<robot_trajectory::RobotTrajectoryConst
 		auto inserted = subsolutions_.insert(subsolutions_.end(), SubTrajectory(sub));
 		inserted->setCreator(this);
 		if (!sub)  // a null RobotTrajectoryPtr indicates a failure
-			inserted->markAsFailure();
+			inserted->markAsFailure(FailureCode::PLANNING_FAILED);
+		else  // sub trajectories are planned by the group planners in order
+			inserted->deferTiming(planner_[sub_solutions.size()].second->deferredTiming());
 		// push back solution pointer
 		sub_solutions.push_back(&*inserted);
 
@@ -234,22 +389,48 @@ SubTrajectoryPtr Connect::merge(const std::vector<robot_trajectory::RobotTraject
                                 const std::vector<planning_scene::PlanningSceneConstPtr>& intermediate_scenes,
                                 const moveit::core::RobotState& state) {
 	// no need to merge if there is only a single sub trajectory
-	if (sub_trajectories.size() == 1)
-		return std::make_shared<SubTrajectory>(sub_trajectories[0]);
+	if (sub_trajectories.size() == 1) {
+		auto solution = std::make_shared<SubTrajectory>(sub_trajectories[0]);
+		solution->deferTiming(planner_.front().second->deferredTiming());
+		return solution;
+	}
 
 	auto jmg = merged_jmg_.get();
 	assert(jmg);
+	// defer timing of the merged trajectory if all planners defer timing
+	const bool defer_timing = std::all_of(planner_.begin(), planner_.end(),
+	                                      [](const auto& pair) { return bool(pair.second->deferredTiming()); });
 	auto timing = properties().get<TimeParameterizationPtr>("merge_time_parameterization");
-	robot_trajectory::RobotTrajectoryPtr trajectory = task_constructor::merge(sub_trajectories, state, jmg, *timing);
+	robot_trajectory::RobotTrajectoryPtr trajectory = defer_timing ?
+	                                                      task_constructor::merge(sub_trajectories, state, jmg) :
+	                                                      task_constructor::merge(sub_trajectories, state, jmg, *timing);
 	if (!trajectory)
 		return SubTrajectoryPtr();
-
-	// check merged trajectory for collisions
-	if (!intermediate_scenes.front()->isPathValid(*trajectory,
-	                                              properties().get<moveit_msgs::Constraints>("path_constraints")))
+	std::vector<const moveit::core::JointModelGroup*> groups;
+	for (const auto& sub : sub_trajectories)
+		groups.push_back(sub->getGroup());
+	updateKinematics(*trajectory, groups);
+
+	// check merged trajectory for collisions, submitting all waypoints at once
+	const planning_scene::PlanningScene& scene = *intermediate_scenes.front();
+	std::vector<const moveit::core::RobotState*> waypoints;
+	waypoints.reserve(trajectory->getWayPointCount());
+	for (size_t i = 0; i < trajectory->getWayPointCount(); ++i)
+		waypoints.push_back(&trajectory->getWayPoint(i));
+	if (utils::collisionChecker()->firstCollision(scene, "", waypoints) < waypoints.size())
 		return SubTrajectoryPtr();
 
-	return std::make_shared<SubTrajectory>(trajectory);
+	// remaining validity checks of isPathValid(): feasibility and path constraints
+	kinematic_constraints::KinematicConstraintSet constraints(scene.getRobotModel());
+	constraints.add(path_constraints_.get(), scene.getTransforms());
+	for (const moveit::core::RobotState* waypoint : waypoints)
+		if (!scene.isStateFeasible(*waypoint) || !constraints.decide(*waypoint).satisfied)
+			return SubTrajectoryPtr();
+
+	auto solution = std::make_shared<SubTrajectory>(trajectory);
+	if (defer_timing)
+		solution->deferTiming([timing](robot_trajectory::RobotTrajectory& t) { timing->computeTimeStamps(t, 1.0, 1.0); });
+	return solution;
 }
 }  // namespace stages
 }  // namespace task_constructor
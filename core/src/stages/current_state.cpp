@@ -39,9 +39,11 @@
 
 #include <moveit/task_constructor/stages/current_state.h>
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/clients.h>
 #include <moveit_msgs/GetPlanningScene.h>
 #include <moveit_msgs/PlanningSceneComponents.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/planning_scene_monitor/planning_scene_monitor.h>
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <ros/ros.h>
 
@@ -57,10 +59,25 @@ CurrentState::CurrentState(const std::string& name) : Generator(name) {
 	Property& timeout = p.property("timeout");
 	timeout.setDescription("max time to wait for get_planning_scene service");
 	timeout.setValue(DEFAULT_TIMEOUT.count());
+
+	p.declare<uint32_t>("components",
+	                    moveit_msgs::PlanningSceneComponents::SCENE_SETTINGS |
+	                        moveit_msgs::PlanningSceneComponents::ROBOT_STATE |
+	                        moveit_msgs::PlanningSceneComponents::ROBOT_STATE_ATTACHED_OBJECTS |
+	                        moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_NAMES |
+	                        moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY |
+	                        moveit_msgs::PlanningSceneComponents::OCTOMAP |
+	                        moveit_msgs::PlanningSceneComponents::TRANSFORMS |
+	                        moveit_msgs::PlanningSceneComponents::ALLOWED_COLLISION_MATRIX |
+	                        moveit_msgs::PlanningSceneComponents::LINK_PADDING_AND_SCALING |
+	                        moveit_msgs::PlanningSceneComponents::OBJECT_COLORS,
+	                    "PlanningSceneComponents requested from get_planning_scene service");
 }
 
 void CurrentState::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	Generator::init(robot_model);
+	if (monitor_ && monitor_->getRobotModel() != robot_model)
+		throw InitStageException(*this, "PlanningSceneMonitor uses a different robot model than the task");
 	robot_model_ = robot_model;
 	scene_.reset();
 }
@@ -70,25 +87,25 @@ bool CurrentState::canCompute() const {
 }
 
 void CurrentState::compute() {
+	if (monitor_) {
+		planning_scene_monitor::LockedPlanningSceneRO monitored(monitor_);
+		// the monitored scene keeps changing: copy it, sharing all world objects
+		scene_ = planning_scene::PlanningScene::clone(monitored);
+		spawn(InterfaceState(scene_), 0.0);
+		return;
+	}
+
 	scene_ = std::make_shared<planning_scene::PlanningScene>(robot_model_);
 
-	ros::NodeHandle h;
-	ros::ServiceClient client = h.serviceClient<moveit_msgs::GetPlanningScene>("get_planning_scene");
+	ros::ServiceClient client =
+	    utils::ClientRegistry::instance().serviceClient<moveit_msgs::GetPlanningScene>("get_planning_scene");
 
 	ros::Duration timeout(this->timeout());
 	if (client.waitForExistence(timeout)) {
 		moveit_msgs::GetPlanningScene::Request req;
 		moveit_msgs::GetPlanningScene::Response res;
 
-		req.components.components =
-		    moveit_msgs::PlanningSceneComponents::SCENE_SETTINGS | moveit_msgs::PlanningSceneComponents::ROBOT_STATE |
-		    moveit_msgs::PlanningSceneComponents::ROBOT_STATE_ATTACHED_OBJECTS |
-		    moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_NAMES |
-		    moveit_msgs::PlanningSceneComponents::WORLD_OBJECT_GEOMETRY | moveit_msgs::PlanningSceneComponents::OCTOMAP |
-		    moveit_msgs::PlanningSceneComponents::TRANSFORMS |
-		    moveit_msgs::PlanningSceneComponents::ALLOWED_COLLISION_MATRIX |
-		    moveit_msgs::PlanningSceneComponents::LINK_PADDING_AND_SCALING |
-		    moveit_msgs::PlanningSceneComponents::OBJECT_COLORS;
+		req.components.components = properties().get<uint32_t>("components");
 
 		if (client.call(req, res)) {
 			scene_->setPlanningSceneMsg(res.scene);
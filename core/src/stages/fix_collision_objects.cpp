@@ -44,10 +44,13 @@
 
 #include <rviz_marker_tools/marker_creation.h>
 #include <Eigen/Geometry>
+#include <Eigen/QR>
 #include <tf2_eigen/tf2_eigen.h>
 #include <ros/console.h>
 #include <fmt/core.h>
 
+#include <map>
+
 namespace vm = visualization_msgs;
 namespace cd = collision_detection;
 
@@ -62,15 +65,17 @@ FixCollisionObjects::FixCollisionObjects(const std::string& name) : PropagatingE
 	auto& p = properties();
 	p.declare<double>("max_penetration", "maximally corrected penetration depth");
 	p.declare<geometry_msgs::Vector3>("direction", "direction vector to use for corrections");
+	p.declare<bool>("joint_correction", false,
+	                "per collision pass, correct all penetrations of an object at once (least squares)");
 }
 
 void FixCollisionObjects::computeForward(const InterfaceState& from) {
-	planning_scene::PlanningScenePtr to = from.scene()->diff();
+	planning_scene::PlanningScenePtr to = utils::diffScene(from.scene());
 	sendForward(from, InterfaceState(to), fixCollisions(*to));
 }
 
 void FixCollisionObjects::computeBackward(const InterfaceState& to) {
-	planning_scene::PlanningScenePtr from = to.scene()->diff();
+	planning_scene::PlanningScenePtr from = utils::diffScene(to.scene());
 	sendBackward(InterfaceState(from), to, fixCollisions(*from));
 }
 
@@ -95,6 +100,36 @@ bool computeCorrection(const std::vector<cd::Contact>& contacts, Eigen::Vector3d
 	return true;
 }
 
+// least-squares translation resolving all penetrations of a single object
+struct JointCorrection
+{
+	Eigen::Matrix3d normal_equations = Eigen::Matrix3d::Zero();
+	Eigen::Vector3d rhs = Eigen::Vector3d::Zero();
+	const cd::Contact* contact = nullptr;  // representative contact for visualization
+
+	// translation t should move the object by depth along the (outward) direction: direction^T t = depth
+	void add(const cd::Contact& c, const Eigen::Vector3d& direction) {
+		normal_equations += direction * direction.transpose();
+		rhs += c.depth * direction;
+		if (!contact)
+			contact = &c;
+	}
+	// solve the normal equations, restricted to the given unit axis if provided
+	Eigen::Vector3d solve(const Eigen::Vector3d* axis) const {
+		Eigen::Vector3d correction;
+		if (axis) {
+			double denominator = axis->dot(normal_equations * *axis);
+			correction = denominator > 0.0 ? Eigen::Vector3d(axis->dot(rhs) / denominator * *axis) : *axis;
+		} else  // rank-deficient if all normals are parallel: use the minimal norm solution
+			correction = normal_equations.completeOrthogonalDecomposition().solve(rhs);
+		// add tolerance
+		double norm = correction.norm();
+		if (norm > 0.0)
+			correction *= (norm + 1.e-3) / norm;
+		return correction;
+	}
+};
+
 SubTrajectory FixCollisionObjects::fixCollisions(planning_scene::PlanningScene& scene) const {
 	SubTrajectory result;
 	const auto& props = properties();
@@ -113,6 +148,15 @@ SubTrajectory FixCollisionObjects::fixCollisions(planning_scene::PlanningScene&
 	vm::Marker m;
 	m.header.frame_id = scene.getPlanningFrame();
 	m.ns = "collisions";
+	auto add_marker = [&](const cd::Contact& c, const Eigen::Vector3d& correction, bool failure) {
+		if (!generatesMarkers())
+			return;
+		rviz_marker_tools::setColor(m.color, failure ? rviz_marker_tools::RED : rviz_marker_tools::GREEN);
+		m.pose = tf2::toMsg(Eigen::Translation3d(c.pos) *
+		                    Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d::UnitX(), correction));
+		rviz_marker_tools::makeArrow(m, correction.norm(), true);
+		result.markers().push_back(m);
+	};
 
 	bool failure = false;
 	while (!failure) {
@@ -122,6 +166,42 @@ SubTrajectory FixCollisionObjects::fixCollisions(planning_scene::PlanningScene&
 		if (!res.collision)
 			return result;
 
+		if (props.get<bool>("joint_correction")) {
+			// accumulate the penetrations of each object
+			std::map<std::string, JointCorrection> objects;
+			for (auto it = res.contacts.cbegin(); !failure && it != res.contacts.cend(); ++it)
+				for (const cd::Contact& c : it->second) {
+					if (c.body_type_1 != cd::BodyTypes::WORLD_OBJECT && c.body_type_2 != cd::BodyTypes::WORLD_OBJECT) {
+						ROS_WARN_STREAM_NAMED("FixCollisionObjects", fmt::format("Cannot fix collision between {} and {}",
+						                                                         c.body_name_1, c.body_name_2));
+						failure = true;
+						break;
+					}
+					if (c.body_type_1 == cd::BodyTypes::WORLD_OBJECT)
+						objects[c.body_name_1].add(c, -c.normal);
+					else
+						objects[c.body_name_2].add(c, c.normal);
+				}
+			if (failure)
+				break;
+
+			Eigen::Vector3d axis;
+			if (!dir.empty()) {
+				tf2::fromMsg(boost::any_cast<geometry_msgs::Vector3>(dir), axis);
+				axis.normalize();
+			}
+			// move all objects at once, re-verifying with the next collision pass
+			for (const auto& object : objects) {
+				Eigen::Vector3d correction = object.second.solve(dir.empty() ? nullptr : &axis);
+				failure = correction.norm() > max_penetration;
+				add_marker(*object.second.contact, correction, failure);
+				if (failure)
+					break;
+				scene.getWorldNonConst()->moveObject(object.first, Eigen::Isometry3d(Eigen::Translation3d(correction)));
+			}
+			continue;
+		}
+
 		for (const auto& info : res.contacts) {
 			Eigen::Vector3d correction;
 			failure = !computeCorrection(info.second, correction, max_penetration);
@@ -132,11 +212,7 @@ SubTrajectory FixCollisionObjects::fixCollisions(planning_scene::PlanningScene&
 
 			// marker indicating correction
 			const cd::Contact& c = info.second.front();
-			rviz_marker_tools::setColor(m.color, failure ? rviz_marker_tools::RED : rviz_marker_tools::GREEN);
-			m.pose = tf2::toMsg(Eigen::Translation3d(c.pos) *
-			                    Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d::UnitX(), correction));
-			rviz_marker_tools::makeArrow(m, depth, true);
-			result.markers().push_back(m);
+			add_marker(c, correction, failure);
 			if (failure)
 				break;
 
@@ -150,7 +226,7 @@ SubTrajectory FixCollisionObjects::fixCollisions(planning_scene::PlanningScene&
 	}
 
 	// failure
-	result.markAsFailure();
+	result.markAsFailure(FailureCode::COLLISION);
 	return result;
 }
 }  // namespace stages
@@ -81,8 +81,11 @@ void FixedCartesianPoses::compute() {
 	if (upstream_solutions_.empty())
 		return;
 
-	planning_scene::PlanningScenePtr scene = upstream_solutions_.pop()->end()->scene()->diff();
-	for (geometry_msgs::PoseStamped pose : properties().get<PosesList>("poses")) {
+	planning_scene::PlanningScenePtr scene = utils::diffScene(upstream_solutions_.pop()->end()->scene());
+	const PosesList& poses = properties().get<PosesList>("poses");
+	std::vector<std::pair<InterfaceState, SubTrajectory>> batch;
+	batch.reserve(poses.size());
+	for (geometry_msgs::PoseStamped pose : poses) {
 		if (pose.header.frame_id.empty())
 			pose.header.frame_id = scene->getPlanningFrame();
 		else if (!scene->knowsFrameTransform(pose.header.frame_id)) {
@@ -96,10 +99,12 @@ void FixedCartesianPoses::compute() {
 		SubTrajectory trajectory;
 		trajectory.setCost(0.0);
 
-		rviz_marker_tools::appendFrame(trajectory.markers(), pose, 0.1, "pose frame");
+		if (generatesMarkers())
+			rviz_marker_tools::appendFrame(trajectory.markers(), pose, 0.1, "pose frame");
 
-		spawn(std::move(state), std::move(trajectory));
+		batch.emplace_back(std::move(state), std::move(trajectory));
 	}
+	spawnBatch(std::move(batch));
 }
 }  // namespace stages
 }  // namespace task_constructor
@@ -65,7 +65,7 @@ bool FixedState::canCompute() const {
 void FixedState::compute() {
 	SubTrajectory trajectory;
 	if (!properties().get<bool>("ignore_collisions") && scene_->isStateColliding()) {
-		trajectory.markAsFailure("in collision");
+		trajectory.markAsFailure(FailureCode::COLLISION, "in collision");
 	}
 
 	spawn(InterfaceState(scene_), std::move(trajectory));
@@ -141,10 +141,8 @@ void GenerateGraspPose::onNewSolution(const SolutionBase& s) {
 	upstream_solutions_.push(&s);
 }
 
-void GenerateGraspPose::compute() {
-	if (upstream_solutions_.empty())
-		return;
-	planning_scene::PlanningScenePtr scene = upstream_solutions_.pop()->end()->scene()->diff();
+planning_scene::PlanningScenePtr GenerateGraspPose::pregraspScene(const SolutionBase& s) {
+	planning_scene::PlanningScenePtr scene = utils::diffScene(s.end()->scene());
 
 	// set end effector pose
 	const auto& props = properties();
@@ -156,33 +154,67 @@ void GenerateGraspPose::compute() {
 		applyPreGrasp(robot_state, jmg, props.property("pregrasp"));
 	} catch (const moveit::Exception& e) {
 		spawn(InterfaceState{ scene }, SubTrajectory::failure(std::string{ "invalid pregrasp: " } + e.what()));
-		return;
+		return nullptr;
 	}
+	return scene;
+}
+
+void GenerateGraspPose::compute() {
+	if (upstream_solutions_.empty())
+		return;
+	planning_scene::PlanningScenePtr scene = pregraspScene(*upstream_solutions_.pop());
+	if (!scene)
+		return;
 
+	const auto& props = properties();
 	geometry_msgs::PoseStamped target_pose_msg;
 	target_pose_msg.header.frame_id = props.get<std::string>("object");
-	Eigen::Vector3d rotation_axis = props.get<Eigen::Vector3d>("rotation_axis");
+	const Eigen::Isometry3d object_pose =
+	    reachability_filter_ ? scene->getFrameTransform(target_pose_msg.header.frame_id) : Eigen::Isometry3d::Identity();
 
-	double current_angle = 0.0;
-	while (current_angle < 2. * M_PI && current_angle > -2. * M_PI) {
-		// rotate object pose about axis
-		Eigen::Isometry3d target_pose(Eigen::AngleAxisd(current_angle, rotation_axis));
-		current_angle += props.get<double>("angle_delta");
+	InterfaceState prototype(scene);
+	props.exposeTo(prototype.properties(), { "pregrasp", "grasp" });
+
+	std::vector<std::pair<InterfaceState, SubTrajectory>> batch;
 
-		InterfaceState state(scene);
-		target_pose_msg.pose = tf2::toMsg(target_pose);
+	for (const Candidate& candidate : candidates(props.get<double>("angle_delta"),
+	                                             props.get<Eigen::Vector3d>("rotation_axis"))) {
+		if (!reachable(scene, object_pose * candidate.pose))
+			continue;
+
+		InterfaceState state(prototype);
+		target_pose_msg.pose = tf2::toMsg(candidate.pose);
 		state.properties().set("target_pose", target_pose_msg);
-		props.exposeTo(state.properties(), { "pregrasp", "grasp" });
 
 		SubTrajectory trajectory;
 		trajectory.setCost(0.0);
-		trajectory.setComment(std::to_string(current_angle));
+		trajectory.setComment(candidate.comment);
 
 		// add frame at target pose
-		rviz_marker_tools::appendFrame(trajectory.markers(), target_pose_msg, 0.1, "grasp frame");
+		if (generatesMarkers())
+			rviz_marker_tools::appendFrame(trajectory.markers(), target_pose_msg, 0.1, "grasp frame");
 
-		spawn(std::move(state), std::move(trajectory));
+		batch.emplace_back(std::move(state), std::move(trajectory));
+	}
+	spawnBatch(std::move(batch));
+}
+
+const GenerateGraspPose::Candidates& GenerateGraspPose::candidates(double angle_delta,
+                                                                   const Eigen::Vector3d& rotation_axis) {
+	if (!candidates_.empty() && angle_delta == candidates_angle_delta_ && rotation_axis == candidates_rotation_axis_)
+		return candidates_;
+
+	candidates_.clear();
+	candidates_angle_delta_ = angle_delta;
+	candidates_rotation_axis_ = rotation_axis;
+	double current_angle = 0.0;
+	while (current_angle < 2. * M_PI && current_angle > -2. * M_PI) {
+		// rotate object pose about axis
+		Eigen::Isometry3d pose(Eigen::AngleAxisd(current_angle, rotation_axis));
+		current_angle += angle_delta;
+		candidates_.push_back(Candidate{ pose, std::to_string(current_angle) });
 	}
+	return candidates_;
 }
 }  // namespace stages
 }  // namespace task_constructor
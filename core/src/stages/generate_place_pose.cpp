@@ -74,8 +74,7 @@ void GeneratePlacePose::onNewSolution(const SolutionBase& s) {
 		if (storeFailures()) {
 			InterfaceState state(scene);
 			SubTrajectory solution;
-			solution.markAsFailure();
-			solution.setComment(msg);
+			solution.markAsFailure(FailureCode::INVALID_INPUT, msg);
 			spawn(std::move(state), std::move(solution));
 		} else
 			ROS_WARN_STREAM_NAMED("GeneratePlacePose", msg);
@@ -90,7 +89,7 @@ void GeneratePlacePose::compute() {
 		return;
 
 	const SolutionBase& s = *upstream_solutions_.pop();
-	planning_scene::PlanningSceneConstPtr scene = s.end()->scene()->diff();
+	planning_scene::PlanningSceneConstPtr scene = utils::diffScene(s.end()->scene());
 	const moveit::core::RobotState& robot_state = scene->getCurrentState();
 	const auto& props = properties();
 
@@ -106,35 +105,37 @@ void GeneratePlacePose::compute() {
 	// target pose w.r.t. planning frame
 	scene->getTransforms().transformPose(pose_msg.header.frame_id, target_pose, target_pose);
 
+	// all spawned states share the properties forwarded from the inner solution
+	InterfaceState prototype(scene);
+	forwardProperties(*s.end(), prototype);
+	prototype.properties().set("ik_frame", ik_frame);
+
 	// spawn the nominal target object pose, considering flip about z and rotations about z-axis
-	auto spawner = [&s, &scene, &ik_frame, this](const Eigen::Isometry3d& nominal, uint z_flips, uint z_rotations = 10) {
-		for (uint flip = 0; flip <= z_flips; ++flip) {
-			// flip about object's x-axis
-			Eigen::Isometry3d object = nominal * Eigen::AngleAxisd(flip * M_PI, Eigen::Vector3d::UnitX());
-			for (uint i = 0; i < z_rotations; ++i) {
-				// rotate object at target pose about world's z-axis
-				Eigen::Vector3d pos = object.translation();
-				object.pretranslate(-pos)
-				    .prerotate(Eigen::AngleAxisd(i * 2. * M_PI / z_rotations, Eigen::Vector3d::UnitZ()))
-				    .pretranslate(pos);
-
-				// target ik_frame's pose w.r.t. planning frame
-				geometry_msgs::PoseStamped target_pose_msg;
-				target_pose_msg.header.frame_id = scene->getPlanningFrame();
-				target_pose_msg.pose = tf2::toMsg(object);
-
-				InterfaceState state(scene);
-				forwardProperties(*s.end(), state);  // forward properties from inner solutions
-				state.properties().set("target_pose", target_pose_msg);
-				state.properties().set("ik_frame", ik_frame);
-
-				SubTrajectory trajectory;
-				trajectory.setCost(0.0);
+	std::vector<std::pair<InterfaceState, SubTrajectory>> batch;
+	auto spawner = [&](const Eigen::Isometry3d& nominal, uint z_flips, uint z_rotations = 10) {
+		for (const Candidate& candidate : candidates(z_flips, z_rotations)) {
+			// flip about object's x-axis, then rotate object at target pose about world's z-axis
+			Eigen::Isometry3d object = nominal * candidate.flip;
+			object.linear() = candidate.rotation * object.linear();
+			if (!reachable(scene, object))
+				continue;
+
+			// target ik_frame's pose w.r.t. planning frame
+			geometry_msgs::PoseStamped target_pose_msg;
+			target_pose_msg.header.frame_id = scene->getPlanningFrame();
+			target_pose_msg.pose = tf2::toMsg(object);
+
+			InterfaceState state(prototype);
+			state.properties().set("target_pose", target_pose_msg);
+
+			SubTrajectory trajectory;
+			trajectory.setCost(0.0);
+			if (generatesMarkers())
 				rviz_marker_tools::appendFrame(trajectory.markers(), target_pose_msg, 0.1, "place frame");
 
-				spawn(std::move(state), std::move(trajectory));
-			}
+			batch.emplace_back(std::move(state), std::move(trajectory));
 		}
+		spawnBatch(std::move(batch));
 	};
 
 	uint z_flips = props.get<bool>("allow_z_flip") ? 1 : 0;
@@ -160,6 +161,25 @@ void GeneratePlacePose::compute() {
 	// any other case: only try given target pose
 	spawner(target_pose, 1, 1);
 }
+
+const std::vector<GeneratePlacePose::Candidate>& GeneratePlacePose::candidates(unsigned int z_flips,
+                                                                               unsigned int z_rotations) {
+	auto inserted = candidates_.insert(std::make_pair(std::make_pair(z_flips, z_rotations), std::vector<Candidate>()));
+	std::vector<Candidate>& result = inserted.first->second;
+	if (!inserted.second)
+		return result;  // already computed
+
+	for (unsigned int flip = 0; flip <= z_flips; ++flip) {
+		Eigen::Matrix3d rotation = Eigen::Matrix3d::Identity();
+		for (unsigned int i = 0; i < z_rotations; ++i) {
+			// successive rotations about z accumulate
+			rotation = Eigen::AngleAxisd(i * 2. * M_PI / z_rotations, Eigen::Vector3d::UnitZ()) * rotation;
+			result.push_back(Candidate{ Eigen::AngleAxisd(flip * M_PI, Eigen::Vector3d::UnitX()).toRotationMatrix(),
+			                            rotation });
+		}
+	}
+	return result;
+}
 }  // namespace stages
 }  // namespace task_constructor
 }  // namespace moveit
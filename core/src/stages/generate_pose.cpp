@@ -40,6 +40,7 @@
 #include <moveit/task_constructor/marker_tools.h>
 #include <moveit/planning_scene/planning_scene.h>
 #include <rviz_marker_tools/marker_creation.h>
+#include <tf2_eigen/tf2_eigen.h>
 
 namespace moveit {
 namespace task_constructor {
@@ -62,6 +63,14 @@ void GeneratePose::onNewSolution(const SolutionBase& s) {
 	upstream_solutions_.push(&s);
 }
 
+bool GeneratePose::reachable(const planning_scene::PlanningSceneConstPtr& scene, const Eigen::Isometry3d& target_pose) {
+	if (!reachability_filter_ || reachability_filter_(target_pose))
+		return true;
+	if (storeFailures())
+		spawn(InterfaceState(scene), SubTrajectory::failure("unreachable target pose"));
+	return false;
+}
+
 bool GeneratePose::canCompute() const {
 	return !upstream_solutions_.empty();
 }
@@ -71,7 +80,7 @@ void GeneratePose::compute() {
 		return;
 
 	const SolutionBase& s = *upstream_solutions_.pop();
-	planning_scene::PlanningSceneConstPtr scene = s.end()->scene()->diff();
+	planning_scene::PlanningSceneConstPtr scene = utils::diffScene(s.end()->scene());
 
 	geometry_msgs::PoseStamped target_pose = properties().get<geometry_msgs::PoseStamped>("pose");
 	if (target_pose.header.frame_id.empty())
@@ -81,6 +90,13 @@ void GeneratePose::compute() {
 		return;
 	}
 
+	if (reachability_filter_) {
+		Eigen::Isometry3d pose;
+		tf2::fromMsg(target_pose.pose, pose);
+		if (!reachable(scene, scene->getFrameTransform(target_pose.header.frame_id) * pose))
+			return;
+	}
+
 	InterfaceState state(scene);
 	forwardProperties(*s.end(), state);  // forward registered properties from received solution
 	state.properties().set("target_pose", target_pose);
@@ -88,7 +104,8 @@ void GeneratePose::compute() {
 	SubTrajectory trajectory;
 	trajectory.setCost(0.0);
 
-	rviz_marker_tools::appendFrame(trajectory.markers(), target_pose, 0.1, "pose frame");
+	if (generatesMarkers())
+		rviz_marker_tools::appendFrame(trajectory.markers(), target_pose, 0.1, "pose frame");
 
 	spawn(std::move(state), std::move(trajectory));
 }
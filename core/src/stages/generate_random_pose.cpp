@@ -35,6 +35,7 @@
 /* Authors: Henning Kayser */
 
 #include <moveit/task_constructor/stages/generate_random_pose.h>
+#include <moveit/task_constructor/cancellation.h>
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/marker_tools.h>
 #include <moveit/planning_scene/planning_scene.h>
@@ -46,9 +47,24 @@
 #include <chrono>
 
 namespace {
-// TODO(henningkayser): support user-defined random number engines
-std::random_device RANDOM_DEVICE;
-std::mt19937 ENGINE(RANDOM_DEVICE());
+// bases of the Halton sequence: sampler i uses the i-th prime (cycling beyond 12 samplers)
+constexpr unsigned int HALTON_BASES[] = { 2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37 };
+constexpr size_t NUM_HALTON_BASES = sizeof(HALTON_BASES) / sizeof(HALTON_BASES[0]);
+
+// radical inverse of index in the given base, yielding the index-th element of the van der Corput sequence
+double halton(size_t index, unsigned int base) {
+	double result = 0.0;
+	double f = 1.0;
+	for (; index > 0; index /= base) {
+		f /= base;
+		result += f * (index % base);
+	}
+	return result;
+}
+
+uint32_t seedEngine(uint32_t seed) {
+	return seed ? seed : std::random_device()();
+}
 }  // namespace
 
 namespace moveit {
@@ -58,76 +74,99 @@ namespace stages {
 GenerateRandomPose::GenerateRandomPose(const std::string& name) : GeneratePose(name) {
 	auto& p = properties();
 	p.declare<size_t>("max_solutions", 20, "maximum number of spawned solutions");
+	p.declare<uint32_t>("seed", 0, "seed of the random number engine (0: random seed)");
+	p.declare<bool>("low_discrepancy", false, "sample uniform distributions from a Halton sequence");
 	p.property("pose").setDescription("seed pose");
 	p.property("timeout").setDefaultValue(1.0 /* seconds */);
+	engine_.seed(seedEngine(0));
 }
 
 template <>
 GenerateRandomPose::PoseDimensionSampler
 GenerateRandomPose::getPoseDimensionSampler<std::normal_distribution>(double stddev) {
-	return [stddev](double mean) {
-		static std::normal_distribution<double> dist(mean, stddev);
-		return dist(ENGINE);
+	return [this, dist = std::normal_distribution<double>(0.0, stddev)](double mean) mutable {
+		return mean + dist(engine_);
 	};
 }
 
 template <>
 GenerateRandomPose::PoseDimensionSampler
 GenerateRandomPose::getPoseDimensionSampler<std::uniform_real_distribution>(double range) {
-	return [range](double mean) {
-		static std::uniform_real_distribution<double> dist(mean - 0.5 * range, mean + 0.5 * range);
-		return dist(ENGINE);
+	return [this, range, index = pose_dimension_samplers_.size()](double mean) {
+		return mean + range * (uniformSample(index) - 0.5);
 	};
 }
 
-bool GenerateRandomPose::canCompute() const {
-	return GeneratePose::canCompute() && !pose_dimension_samplers_.empty();
+double GenerateRandomPose::uniformSample(size_t sampler_index) {
+	if (low_discrepancy_)
+		return halton(sample_index_, HALTON_BASES[sampler_index % NUM_HALTON_BASES]);
+	return std::uniform_real_distribution<double>(0.0, 1.0)(engine_);
 }
 
-void GenerateRandomPose::compute() {
-	if (upstream_solutions_.empty())
-		return;
-
-	const SolutionBase& s = *upstream_solutions_.pop();
-	planning_scene::PlanningScenePtr scene = s.end()->scene()->diff();
-	auto seed_pose = properties().get<geometry_msgs::PoseStamped>("pose");
-	if (seed_pose.header.frame_id.empty())
-		seed_pose.header.frame_id = scene->getPlanningFrame();
-	else if (!scene->knowsFrameTransform(seed_pose.header.frame_id)) {
-		ROS_WARN_NAMED("GenerateRandomPose", "Unknown frame: '%s'", seed_pose.header.frame_id.c_str());
-		return;
-	}
+void GenerateRandomPose::reset() {
+	GeneratePose::reset();
+	engine_.seed(seedEngine(properties().get<uint32_t>("seed")));
+	sample_index_ = 0;
+	sampling_ = Sampling();
+}
+
+bool GenerateRandomPose::canCompute() const {
+	return (sampling_.solution || GeneratePose::canCompute()) && !pose_dimension_samplers_.empty();
+}
 
-	const auto& spawn_target_pose = [&](const geometry_msgs::PoseStamped& target_pose) {
-		InterfaceState state(scene);
-		forwardProperties(*s.end(), state);  // forward registered properties from received solution
-		state.properties().set("target_pose", target_pose);
+void GenerateRandomPose::spawnTargetPose(const geometry_msgs::PoseStamped& target_pose) {
+	InterfaceState state(sampling_.scene);
+	forwardProperties(*sampling_.solution->end(), state);  // forward registered properties from received solution
+	state.properties().set("target_pose", target_pose);
 
-		SubTrajectory trajectory;
-		trajectory.setCost(0.0);
+	SubTrajectory trajectory;
+	trajectory.setCost(0.0);
 
+	if (generatesMarkers())
 		rviz_marker_tools::appendFrame(trajectory.markers(), target_pose, 0.1, "pose frame");
 
-		spawn(std::move(state), std::move(trajectory));
-	};
+	spawn(std::move(state), std::move(trajectory));
+}
 
-	spawn_target_pose(seed_pose);
+void GenerateRandomPose::compute() {
+	if (!sampling_.solution) {  // start sampling around the seed pose of the next upstream solution
+		if (upstream_solutions_.empty())
+			return;
+
+		const SolutionBase& s = *upstream_solutions_.pop();
+		planning_scene::PlanningScenePtr scene = utils::diffScene(s.end()->scene());
+		auto seed_pose = properties().get<geometry_msgs::PoseStamped>("pose");
+		if (seed_pose.header.frame_id.empty())
+			seed_pose.header.frame_id = scene->getPlanningFrame();
+		else if (!scene->knowsFrameTransform(seed_pose.header.frame_id)) {
+			ROS_WARN_NAMED("GenerateRandomPose", "Unknown frame: '%s'", seed_pose.header.frame_id.c_str());
+			return;
+		}
+
+		sampling_.solution = &s;
+		sampling_.scene = std::move(scene);
+		sampling_.seed_pose = seed_pose;
+		spawnTargetPose(seed_pose);
 
-	if (pose_dimension_samplers_.empty())
-		return;
+		if (pose_dimension_samplers_.empty()) {
+			sampling_ = Sampling();
+			return;
+		}
+	}
 
-	auto sample_pose = seed_pose;
+	auto sample_pose = sampling_.seed_pose;
 	Eigen::Isometry3d seed, sample;
-	tf2::fromMsg(seed_pose.pose, seed);
-	double elapsed_time = 0.0;
+	tf2::fromMsg(sampling_.seed_pose.pose, seed);
+	const double previous_time = sampling_.elapsed_time;
 	const auto start_time = std::chrono::steady_clock::now();
-	size_t spawned_solutions = 0;
 	const size_t max_solutions = properties().get<size_t>("max_solutions");
+	low_discrepancy_ = properties().get<bool>("low_discrepancy");
 
-	while (elapsed_time < timeout() && ++spawned_solutions < max_solutions) {
+	while (sampling_.elapsed_time < timeout() && ++sampling_.spawned_solutions < max_solutions) {
 		// Randomize pose using specified dimension samplers applied
 		// in the order in which they have been specified
 		sample = seed;
+		++sample_index_;  // skip the origin of the Halton sequence, which is the seed pose
 		for (const auto& pose_dim_sampler : pose_dimension_samplers_) {
 			switch (pose_dim_sampler.first) {
 				case X:
@@ -150,10 +189,14 @@ void GenerateRandomPose::compute() {
 			}
 		}
 		sample_pose.pose = tf2::toMsg(sample);
-		spawn_target_pose(sample_pose);
+		spawnTargetPose(sample_pose);
 
-		elapsed_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		sampling_.elapsed_time =
+		    previous_time + std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+		if (utils::TimeSlice::expired())
+			return;  // suspend sampling, continuing in the next compute()
 	}
+	sampling_ = Sampling();
 }
 }  // namespace stages
 }  // namespace task_constructor
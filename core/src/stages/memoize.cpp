@@ -0,0 +1,373 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Wrapper caching the solutions of its child for identical inputs
+ */
+
+#include <moveit/task_constructor/stages/memoize.h>
+#include <moveit/task_constructor/hashing.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/utils.h>
+
+#include <moveit/task_constructor/container_p.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <boost/functional/hash.hpp>
+#include <algorithm>
+#include <cmath>
+#include <list>
+#include <unordered_map>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+class MemoizePrivate : public WrapperBasePrivate
+{
+	friend class Memoize;
+
+public:
+	MemoizePrivate(Memoize* me, const std::string& name) : WrapperBasePrivate(me, name) {}
+
+	void onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to) override;
+	void onReleaseState(const InterfaceState& state) override {
+		forgetKey(&state);
+		WrapperBasePrivate::onReleaseState(state);
+	}
+	// waiting external states or pending internal ones are evicted when disabled
+	void onEvictState(const InterfaceState& state) override;
+	void onEvictChildState(const Stage& child, const InterfaceState& state) override;
+
+private:
+	// answer received states from the cache, passing only unknown ones to the child
+	void initializeExternalInterfaces() override;
+	template <Interface::Direction dir>
+	void memoizeState(Interface::iterator external, Interface::UpdateFlags updated);
+
+	// a solution of the child: its trajectory and its new (end resp. start) state
+	struct Outcome
+	{
+		InterfaceState state;
+		robot_trajectory::RobotTrajectoryConstPtr trajectory;
+		double cost;
+		std::string comment;
+		std::vector<visualization_msgs::Marker> markers;
+	};
+	struct Record
+	{
+		std::vector<Outcome> outcomes;
+		bool failed = false;
+		// number of internal states (in keys_) the child is computing for this key
+		size_t users = 0;
+		// external states with this key received while the child's result was pending
+		std::vector<const InterfaceState*> waiting;
+		// position in lru_
+		std::list<size_t>::iterator lru;
+	};
+	Record* record(const InterfaceState* internal);
+	Record& insert(size_t key);
+	void forgetKey(const InterfaceState* internal);
+	// drop least recently used records, keeping those still in use
+	void shrink();
+
+	// replay an outcome (or a failure if nullptr) of the child for the given external state
+	template <Interface::Direction dir>
+	void replay(const InterfaceState& external, const Outcome* outcome);
+	void replay(bool forward, const InterfaceState& external, const Outcome* outcome) {
+		if (forward)
+			replay<Interface::FORWARD>(external, outcome);
+		else
+			replay<Interface::BACKWARD>(external, outcome);
+	}
+
+	std::unordered_map<size_t, Record> cache_;
+	// keys of the cache, most recently used first
+	std::list<size_t> lru_;
+	// keys of the states passed to the child, valid until reset()
+	std::unordered_map<const InterfaceState*, size_t> keys_;
+	// keys of the waiting external states
+	std::unordered_map<const InterfaceState*, size_t> waiting_;
+	// hash of the wrapped stage's properties, computed in init()
+	size_t properties_key_ = 0;
+	size_t max_cache_size_ = 0;
+	moveit::core::RobotModelConstPtr robot_model_;
+	size_t hits_ = 0;
+	size_t misses_ = 0;
+};
+PIMPL_FUNCTIONS(Memoize)
+
+void MemoizePrivate::initializeExternalInterfaces() {
+	const InterfaceFlags required = requiredInterface();
+	const bool reads_start = required & READS_START;
+	const bool reads_end = required & READS_END;
+	if (reads_start == reads_end)
+		throw InitStageException(*me(), "memoize requires a propagating child");
+
+	if (reads_start)
+		starts() = std::make_shared<Interface>([this](Interface::iterator external, Interface::UpdateFlags updated) {
+			this->memoizeState<Interface::FORWARD>(external, updated);
+		});
+	if (reads_end)
+		ends() = std::make_shared<Interface>([this](Interface::iterator external, Interface::UpdateFlags updated) {
+			this->memoizeState<Interface::BACKWARD>(external, updated);
+		});
+}
+
+template <Interface::Direction dir>
+void MemoizePrivate::memoizeState(Interface::iterator external, Interface::UpdateFlags updated) {
+	const InterfacePtr& target = children().front()->pimpl()->pullInterface(dir);
+	if (updated) {  // updates of states answered from the cache are ignored by copyState(), as they were never copied
+		copyState<dir>(external, target, updated);
+		return;
+	}
+
+	const auto& key_function = me()->properties().get("key");
+	const size_t key = key_function.empty() ? static_cast<Memoize*>(me())->defaultKey(*external) :
+	                                          boost::any_cast<Memoize::KeyFunction>(key_function)(*external);
+	Record& record = insert(key);
+	const bool answered = !record.outcomes.empty() || record.failed;
+	if (!answered && record.users == 0) {
+		// unknown input (or the child's computation was dropped): pass the state to the child
+		++misses_;
+		copyState<dir>(external, target, updated);
+		keys_[internalStates(&*external).back()] = key;
+		++record.users;
+		shrink();
+		return;
+	}
+
+	++hits_;
+	if (answered && record.outcomes.empty())
+		replay<dir>(*external, nullptr);
+	for (const Outcome& outcome : record.outcomes)
+		replay<dir>(*external, &outcome);
+	if (record.users > 0) {  // the child is still computing this key: receive its further outcomes as well
+		record.waiting.push_back(&*external);
+		waiting_[&*external] = key;
+	}
+}
+
+template <Interface::Direction dir>
+void MemoizePrivate::replay(const InterfaceState& external, const Outcome* outcome) {
+	if (!outcome) {
+		auto failure = makeSolution<SubTrajectory>(SubTrajectory::failure("memoized failure"));
+		if (dir == Interface::FORWARD)
+			sendForward(external, InterfaceState(external.scene()), failure);
+		else
+			sendBackward(InterfaceState(external.scene()), external, failure);
+		return;
+	}
+	auto solution = makeSolution<SubTrajectory>(outcome->trajectory, outcome->cost, outcome->comment);
+	solution->markers() = outcome->markers;
+	if (dir == Interface::FORWARD)
+		sendForward(external, InterfaceState(outcome->state), solution);
+	else
+		sendBackward(InterfaceState(outcome->state), external, solution);
+}
+
+MemoizePrivate::Record* MemoizePrivate::record(const InterfaceState* internal) {
+	auto it = keys_.find(internal);
+	if (it == keys_.end())
+		return nullptr;
+	auto record = cache_.find(it->second);  // records in use are never dropped by shrink()
+	return record == cache_.end() ? nullptr : &record->second;
+}
+
+MemoizePrivate::Record& MemoizePrivate::insert(size_t key) {
+	auto it = cache_.find(key);
+	if (it != cache_.end()) {
+		lru_.splice(lru_.begin(), lru_, it->second.lru);
+		return it->second;
+	}
+	Record& record = cache_[key];
+	record.lru = lru_.insert(lru_.begin(), key);
+	return record;
+}
+
+void MemoizePrivate::forgetKey(const InterfaceState* internal) {
+	auto it = keys_.find(internal);
+	if (it == keys_.end())
+		return;
+	auto record = cache_.find(it->second);
+	if (record != cache_.end() && record->second.users > 0)
+		--record->second.users;
+	keys_.erase(it);
+}
+
+void MemoizePrivate::shrink() {
+	if (max_cache_size_ == 0)
+		return;
+	for (auto it = lru_.end(); cache_.size() > max_cache_size_ && it != lru_.begin();) {
+		--it;
+		auto record = cache_.find(*it);
+		if (record->second.users > 0 || !record->second.waiting.empty())
+			continue;
+		cache_.erase(record);
+		it = lru_.erase(it);
+	}
+}
+
+void MemoizePrivate::onEvictState(const InterfaceState& state) {
+	auto it = waiting_.find(&state);
+	if (it != waiting_.end()) {
+		auto record = cache_.find(it->second);
+		if (record != cache_.end()) {
+			auto& waiting = record->second.waiting;
+			waiting.erase(std::remove(waiting.begin(), waiting.end(), &state), waiting.end());
+		}
+		waiting_.erase(it);
+	}
+	WrapperBasePrivate::onEvictState(state);
+}
+
+void MemoizePrivate::onEvictChildState(const Stage& child, const InterfaceState& state) {
+	// the child won't compute an evicted state: the next state with this key is passed to the child again,
+	// while states waiting for this one keep waiting for the next result
+	forgetKey(&state);
+	WrapperBasePrivate::onEvictChildState(child, state);
+}
+
+void MemoizePrivate::onNewFailure(const Stage& child, const InterfaceState* from, const InterfaceState* to) {
+	const bool forward = requiredInterface() & READS_START;
+	if (Record* r = record(forward ? from : to)) {
+		r->failed = true;
+		if (r->outcomes.empty()) {
+			// waiting states are answered once, as later outcomes of the child are replayed from the cache
+			std::vector<const InterfaceState*> waiting;
+			waiting.swap(r->waiting);
+			for (const InterfaceState* external : waiting) {
+				waiting_.erase(external);
+				replay(forward, *external, nullptr);
+			}
+		}
+	}
+	WrapperBasePrivate::onNewFailure(child, from, to);
+}
+
+Memoize::Memoize(const std::string& name, Stage::pointer&& child)
+  : WrapperBase(new MemoizePrivate(this, name), std::move(child)) {
+	auto& p = properties();
+	p.declare<KeyFunction>("key", "custom key of a received state");
+	p.declare<std::vector<std::string>>("key_properties", std::vector<std::string>(),
+	                                    "names of properties contributing to the default key");
+	p.declare<double>("resolution", 1e-4, "resolution (rad, m) of joint values and object poses in the default key");
+	p.declare<size_t>("max_cache_size", 1000, "maximum number of cached keys (0: unlimited)");
+}
+
+void Memoize::reset() {
+	auto impl = pimpl();
+	// states are discarded, but the cache is kept
+	impl->keys_.clear();
+	impl->waiting_.clear();
+	for (auto& entry : impl->cache_) {
+		entry.second.users = 0;
+		entry.second.waiting.clear();
+	}
+	WrapperBase::reset();
+}
+
+void Memoize::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	auto impl = pimpl();
+	if (impl->robot_model_ != robot_model)
+		clearCache();  // cached scenes and trajectories refer to the old model
+	impl->robot_model_ = robot_model;
+	WrapperBase::init(robot_model);
+
+	// changed properties of the wrapped stage result in new keys
+	size_t seed = 0;
+	for (const auto& entry : wrapped()->properties()) {
+		if (!entry.second.defined())
+			continue;
+		boost::hash_combine(seed, entry.first);
+		boost::hash_combine(seed, entry.second.serialize());
+	}
+	impl->properties_key_ = seed;
+	impl->max_cache_size_ = properties().get<size_t>("max_cache_size");
+	impl->shrink();
+}
+
+void Memoize::onNewSolution(const SolutionBase& s) {
+	auto impl = pimpl();
+	const bool forward = impl->requiredInterface() & READS_START;
+	const auto* sub = dynamic_cast<const SubTrajectory*>(&s);
+	MemoizePrivate::Record* record = sub ? impl->record(forward ? s.start() : s.end()) : nullptr;
+	if (record) {
+		record->outcomes.push_back(MemoizePrivate::Outcome{ InterfaceState(forward ? *s.end() : *s.start()),
+		                                                    sub->trajectory(), s.cost(), s.comment(), s.markers() });
+		// waiting states receive all outcomes of the pending one, as do later hits
+		std::vector<const InterfaceState*> waiting = record->waiting;
+		const MemoizePrivate::Outcome outcome = record->outcomes.back();
+		for (const InterfaceState* external : waiting)
+			impl->replay(forward, *external, &outcome);
+	}
+	liftSolution(s);
+}
+
+size_t Memoize::defaultKey(const InterfaceState& state) const {
+	const auto& props = properties();
+	const double resolution = props.get<double>("resolution");
+	size_t seed = utils::stateHash(state, nullptr, resolution);
+	boost::hash_combine(seed, pimpl()->properties_key_);
+	for (const std::string& name : props.get<std::vector<std::string>>("key_properties")) {
+		const PropertyMap& source = state.properties().hasProperty(name) ? state.properties() : wrapped()->properties();
+		boost::hash_combine(seed, name);
+		if (source.hasProperty(name))
+			boost::hash_combine(seed, source.property(name).serialize());
+	}
+	return seed;
+}
+
+void Memoize::clearCache() {
+	auto impl = pimpl();
+	impl->cache_.clear();
+	impl->lru_.clear();
+	impl->keys_.clear();
+	impl->waiting_.clear();
+}
+
+size_t Memoize::cacheSize() const {
+	return pimpl()->cache_.size();
+}
+
+size_t Memoize::hits() const {
+	return pimpl()->hits_;
+}
+
+size_t Memoize::misses() const {
+	return pimpl()->misses_;
+}
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
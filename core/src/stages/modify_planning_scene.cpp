@@ -49,6 +49,11 @@ namespace stages {
 
 ModifyPlanningScene::ModifyPlanningScene(const std::string& name) : PropagatingEitherWay(name) {
 	setCostTerm(std::make_unique<cost::Constant>(0.0));
+	properties().declare<bool>("incremental_collision_check", false,
+	                           "only check collisions involving objects affected by the modifications");
+
+	collision_request_.contacts = true;
+	collision_request_.max_contacts = 1;
 }
 
 void ModifyPlanningScene::attachObjects(const Names& objects, const std::string& attach_link, bool attach) {
@@ -132,16 +137,77 @@ void ModifyPlanningScene::allowCollisions(planning_scene::PlanningScene& scene,
 		acm.setEntry(pairs.first, pairs.second, allow);
 }
 
+bool ModifyPlanningScene::affectedNames(std::set<std::string>& names, bool invert) const {
+	if (callback_)
+		return false;  // arbitrary modifications
+
+	for (const auto& object : collision_objects_) {
+		// added, moved, or appended objects might collide. In backward direction, added objects are removed.
+		if (object.operation == moveit_msgs::CollisionObject::REMOVE ||
+		    (invert && object.operation == moveit_msgs::CollisionObject::ADD))
+			continue;
+		names.insert(object.id);
+	}
+	// attached objects might collide with robot links, detached ones with links previously allowed to touch them
+	for (const auto& pair : attach_objects_)
+		names.insert(pair.second.first.begin(), pair.second.first.end());
+
+	for (const auto& pairs : collision_matrix_edits_) {
+		if (pairs.allow != invert)
+			continue;  // allowing collisions cannot introduce new ones
+		names.insert(pairs.first.begin(), pairs.first.end());
+		names.insert(pairs.second.begin(), pairs.second.end());
+	}
+	return true;
+}
+
+namespace {
+// ACM allowing all collisions that don't involve an affected name, in O(affected * names)
+collision_detection::AllowedCollisionMatrix incrementalACM(const planning_scene::PlanningScene& scene,
+                                                           const std::set<std::string>& affected) {
+	std::vector<std::string> names = scene.getRobotModel()->getLinkModelNamesWithCollisionGeometry();
+	const std::vector<std::string> ids = scene.getWorld()->getObjectIds();
+	names.insert(names.end(), ids.begin(), ids.end());
+	std::vector<const moveit::core::AttachedBody*> attached;
+	scene.getCurrentState().getAttachedBodies(attached);
+	for (const moveit::core::AttachedBody* body : attached)
+		names.push_back(body->getName());
+
+	// Allow everything by default and only copy the entries of pairs involving an affected name.
+	// Explicit entries take precedence over default ones, such that these pairs are checked as in the scene's ACM.
+	const collision_detection::AllowedCollisionMatrix& original = scene.getAllowedCollisionMatrix();
+	collision_detection::AllowedCollisionMatrix acm;
+	for (const std::string& name : names)
+		acm.setDefaultEntry(name, true);
+	for (const std::string& name : affected) {
+		for (const std::string& other : names) {
+			collision_detection::AllowedCollision::Type type;
+			if (!original.getAllowedCollision(name, other, type))
+				acm.setEntry(name, other, false);
+			else if (type != collision_detection::AllowedCollision::CONDITIONAL)
+				acm.setEntry(name, other, type == collision_detection::AllowedCollision::ALWAYS);
+			else {
+				collision_detection::DecideContactFn fn;
+				if (original.getEntry(name, other, fn))
+					acm.setEntry(name, other, fn);
+				else  // conditional default entry: check the pair
+					acm.setEntry(name, other, false);
+			}
+		}
+	}
+	return acm;
+}
+}  // namespace
+
 // invert indicates, whether to detach instead of attach (and vice versa)
 // as well as to forbid instead of allow collision (and vice versa)
 std::pair<InterfaceState, SubTrajectory> ModifyPlanningScene::apply(const InterfaceState& from, bool invert) {
-	planning_scene::PlanningScenePtr scene = from.scene()->diff();
+	planning_scene::PlanningScenePtr scene = utils::diffScene(from.scene());
 	InterfaceState state(scene);
 	SubTrajectory traj;
 	try {
 		// add/remove/move objects
-		for (auto& collision_object : collision_objects_)
-			processCollisionObject(*scene, collision_object, invert);
+		processCollisionObjects(*scene, invert);
 
 		// attach/detach objects
 		for (const auto& pair : attach_objects_)
@@ -155,14 +221,17 @@ std::pair<InterfaceState, SubTrajectory> ModifyPlanningScene::apply(const Interf
 			callback_(scene, properties());
 
 		// check for collisions
-		collision_detection::CollisionRequest req;
 		collision_detection::CollisionResult res;
-		req.contacts = true;
-		req.max_contacts = 1;
-		scene->checkCollision(req, res);
+		std::set<std::string> affected;
+		if (!properties().get<bool>("incremental_collision_check") || !affectedNames(affected, invert))
+			scene->checkCollision(collision_request_, res);
+		else if (!affected.empty())
+			scene->checkCollision(collision_request_, res, scene->getCurrentState(), incrementalACM(*scene, affected));
 		if (res.collision) {
-			const auto contact = res.contacts.begin()->second.front();
-			traj.markAsFailure(contact.body_name_1 + " colliding with " + contact.body_name_2);
+			const auto& contact = res.contacts.begin()->second.front();
+			traj.markAsFailure(FailureCode::COLLISION, [body_1 = contact.body_name_1, body_2 = contact.body_name_2] {
+				return body_1 + " colliding with " + body_2;
+			});
 		}
 	} catch (const std::exception& e) {
 		traj.markAsFailure(e.what());
@@ -174,18 +243,34 @@ void ModifyPlanningScene::processCollisionObject(planning_scene::PlanningScene&
                                                  const moveit_msgs::CollisionObject& object, bool invert) {
 	const auto op = object.operation;
 	if (invert) {
-		if (op == moveit_msgs::CollisionObject::ADD)
-			// (temporarily) change operation to REMOVE to revert adding the object
-			const_cast<moveit_msgs::CollisionObject&>(object).operation = moveit_msgs::CollisionObject::REMOVE;
-		else if (op == moveit_msgs::CollisionObject::REMOVE)
+		if (op == moveit_msgs::CollisionObject::ADD) {
+			// revert adding the object, using a lightweight message instead of modifying the shared one
+			moveit_msgs::CollisionObject removal;
+			removal.id = object.id;
+			removal.operation = moveit_msgs::CollisionObject::REMOVE;
+			scene.processCollisionObjectMsg(removal);
+			return;
+		} else if (op == moveit_msgs::CollisionObject::REMOVE)
 			throw std::runtime_error("cannot apply removeObject() backwards");
 		else if (op == moveit_msgs::CollisionObject::MOVE)
 			throw std::runtime_error("cannot apply moveObject() backwards");
 	}
-
 	scene.processCollisionObjectMsg(object);
-	// restore previous operation (for next call)
-	const_cast<moveit_msgs::CollisionObject&>(object).operation = op;
+}
+
+void ModifyPlanningScene::processCollisionObjects(planning_scene::PlanningScene& scene, bool invert) {
+	if (collision_objects_.empty())
+		return;
+
+	// validate all operations first, such that the world is modified by all of them or none
+	if (invert)
+		for (const auto& object : collision_objects_)
+			if (object.operation == moveit_msgs::CollisionObject::REMOVE ||
+			    object.operation == moveit_msgs::CollisionObject::MOVE)
+				processCollisionObject(scene, object, invert);  // throws
+
+	for (const auto& object : collision_objects_)
+		processCollisionObject(scene, object, invert);
 }
 }  // namespace stages
 }  // namespace task_constructor
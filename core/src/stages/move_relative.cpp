@@ -43,6 +43,9 @@
 #include <rviz_marker_tools/marker_creation.h>
 #include <tf2_eigen/tf2_eigen.h>
 
+#include <boost/functional/hash.hpp>
+#include <cmath>
+
 namespace moveit {
 namespace task_constructor {
 namespace stages {
@@ -65,6 +68,8 @@ MoveRelative::MoveRelative(const std::string& name, const solvers::PlannerInterf
 
 	p.declare<moveit_msgs::Constraints>("path_constraints", moveit_msgs::Constraints(),
 	                                    "constraints to maintain during trajectory");
+	p.declare<double>("cache_resolution", 0.0, "reuse results for start states matching within resolution (0: off)");
+	p.declare<bool>("precheck", false, "probe IK along the required distance before Cartesian planning");
 }
 
 void MoveRelative::setIKFrame(const Eigen::Isometry3d& pose, const std::string& link) {
@@ -76,7 +81,9 @@ void MoveRelative::setIKFrame(const Eigen::Isometry3d& pose, const std::string&
 
 void MoveRelative::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	PropagatingEitherWay::init(robot_model);
-	planner_->init(robot_model);
+	planner_->initShared(robot_model);
+	std::lock_guard<std::mutex> lock(cache_mutex_);
+	cache_.clear();
 }
 
 static bool getJointStateFromOffset(const boost::any& direction, const Interface::Direction dir,
@@ -105,8 +112,38 @@ static bool getJointStateFromOffset(const boost::any& direction, const Interface
 	return false;
 }
 
+/** Probe collision-free IK solutions for ik_frame poses along the required fraction of the motion from start to target
+ *
+ * Each sample is seeded from the previous one, like Cartesian planning. If a sample fails, the motion cannot
+ * reach the required distance and the index of the failed sample (1-based) is returned, 0 otherwise.
+ */
+static size_t probeMotion(const planning_scene::PlanningScene& scene, const moveit::core::JointModelGroup* jmg,
+                          const moveit::core::LinkModel& link, const Eigen::Isometry3d& offset,
+                          const Eigen::Isometry3d& start, const Eigen::Isometry3d& target, double fraction) {
+	const Eigen::Quaterniond start_rotation(start.linear()), target_rotation(target.linear());
+	const Eigen::Isometry3d link_offset = offset.inverse();
+	moveit::core::RobotState state(scene.getCurrentState());
+	const moveit::core::GroupStateValidityCallbackFn is_valid = [&scene](moveit::core::RobotState* robot_state,
+	                                                                    const moveit::core::JointModelGroup* group,
+	                                                                    const double* values) {
+		robot_state->setJointGroupPositions(group, values);
+		robot_state->update();
+		return !scene.isStateColliding(*robot_state, group->getName());
+	};
+
+	size_t index = 0;
+	for (double f : { fraction / 3.0, 2.0 * fraction / 3.0, fraction }) {
+		++index;
+		Eigen::Isometry3d pose(start_rotation.slerp(f, target_rotation));
+		pose.translation() = start.translation() + f * (target.translation() - start.translation());
+		if (!state.setFromIK(jmg, pose * link_offset, link.getName(), 0.0, is_valid))
+			return index;
+	}
+	return 0;
+}
+
 // Create an arrow marker from start_pose to reached_pose, split into a red and green part based on achieved distance
-static void visualizePlan(std::deque<visualization_msgs::Marker>& markers, Interface::Direction dir, bool success,
+static void visualizePlan(std::vector<visualization_msgs::Marker>& markers, Interface::Direction dir, bool success,
                           const std::string& ns, const std::string& frame_id, const Eigen::Isometry3d& start_pose,
                           const Eigen::Isometry3d& reached_pose, const Eigen::Vector3d& linear, double distance) {
 	double linear_norm = linear.norm();
@@ -163,9 +200,83 @@ static void visualizePlan(std::deque<visualization_msgs::Marker>& markers, Inter
 	}
 }
 
+MoveRelative::CacheKey MoveRelative::cacheKey(const InterfaceState& state, Interface::Direction dir,
+                                              double resolution) const {
+	const planning_scene::PlanningScene& scene = *state.scene();
+	CacheKey key;
+	key.dir = dir;
+	key.scene_hash = utils::worldHash(scene, resolution);
+	boost::hash_combine(key.scene_hash, utils::acmHash(scene));  // allowed collisions
+
+	// motion specification, which might be initialized from the state
+	const auto& props = properties();
+	for (const char* name : { "group", "ik_frame", "min_distance", "max_distance", "path_constraints" }) {
+		key.specification += props.property(name).serialize();
+		key.specification += '\0';
+	}
+	const boost::any& direction = props.get("direction");
+	if (const auto* joint_deltas = boost::any_cast<std::map<std::string, double>>(&direction)) {
+		for (const auto& delta : *joint_deltas) {  // no serializer registered for maps
+			key.specification += delta.first;
+			key.specification += '\0';
+			key.specification.append(reinterpret_cast<const char*>(&delta.second), sizeof(delta.second));
+		}
+	} else
+		key.specification += Property::serialize(direction);
+
+	// start state
+	const moveit::core::RobotState& robot_state = scene.getCurrentState();
+	key.positions.reserve(robot_state.getVariableCount());
+	for (size_t i = 0, end = robot_state.getVariableCount(); i != end; ++i)
+		key.positions.push_back(std::lround(robot_state.getVariablePosition(i) / resolution));
+
+	key.hash = key.scene_hash;
+	boost::hash_combine(key.hash, static_cast<int>(dir));
+	boost::hash_combine(key.hash, key.specification);
+	boost::hash_range(key.hash, key.positions.begin(), key.positions.end());
+	return key;
+}
+
 bool MoveRelative::compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene,
                            SubTrajectory& solution, Interface::Direction dir) {
-	scene = state.scene()->diff();
+	const double resolution = properties().get<double>("cache_resolution");
+	if (resolution <= 0.0)
+		return plan(state, scene, solution, dir);
+
+	CacheKey key = cacheKey(state, dir, resolution);
+	{
+		std::lock_guard<std::mutex> lock(cache_mutex_);
+		auto it = cache_.find(key);
+		if (it != cache_.end()) {
+			const CacheEntry& entry = it->second;
+			scene = utils::diffScene(state.scene());
+			if (entry.trajectory) {
+				// a backward trajectory was reversed already, ending in the start state
+				scene->setCurrentState(dir == Interface::FORWARD ? entry.trajectory->getLastWayPoint() :
+				                                                   entry.trajectory->getFirstWayPoint());
+				solution.setTrajectory(entry.trajectory);
+				solution.deferTiming(planner_->deferredTiming());
+			}
+			solution.setComment(entry.comment);
+			solution.markers() = entry.markers;
+			if (entry.failure)
+				solution.markAsFailure();
+			return entry.stored;
+		}
+	}
+
+	const bool stored = plan(state, scene, solution, dir);
+	CacheEntry entry{ stored, nullptr, solution.isFailure(), solution.comment(), solution.markers() };
+	if (auto trajectory = solution.trajectory())
+		entry.trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(*trajectory, true);
+	std::lock_guard<std::mutex> lock(cache_mutex_);
+	cache_.emplace(std::move(key), std::move(entry));
+	return stored;
+}
+
+bool MoveRelative::plan(const InterfaceState& state, planning_scene::PlanningScenePtr& scene,
+                        SubTrajectory& solution, Interface::Direction dir) {
+	scene = utils::diffScene(state.scene());
 	const moveit::core::RobotModelConstPtr& robot_model = scene->getRobotModel();
 	assert(robot_model);
 
@@ -174,12 +285,12 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 	const std::string& group = props.get<std::string>("group");
 	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group);
 	if (!jmg) {
-		solution.markAsFailure("invalid joint model group: " + group);
+		solution.markAsFailure(FailureCode::INVALID_INPUT, "invalid joint model group: " + group);
 		return false;
 	}
 	boost::any direction = props.get("direction");
 	if (direction.empty()) {
-		solution.markAsFailure("undefined direction");
+		solution.markAsFailure(FailureCode::INVALID_INPUT, "undefined direction");
 		return false;
 	}
 
@@ -274,7 +385,8 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 			linear = frame_pose.linear() * linear;
 			target_eigen = Eigen::Translation3d(linear) * ik_pose_world;
 		} catch (const boost::bad_any_cast&) {
-			solution.markAsFailure(std::string("invalid direction type: ") + direction.type().name());
+			solution.markAsFailure(FailureCode::INVALID_INPUT,
+			                       std::string("invalid direction type: ") + direction.type().name());
 			return false;
 		}
 
@@ -282,6 +394,21 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 		// offset from link to ik_frame
 		const Eigen::Isometry3d& offset = scene->getCurrentState().getGlobalLinkTransform(link).inverse() * ik_pose_world;
 
+		// fail fast if the required distance (the full one if min_distance < 0) is obviously not reachable
+		const double full_distance = use_rotation_distance ? angular_norm : linear_norm;
+		if (min_distance != 0.0 && full_distance > 0.0 && props.get<bool>("precheck")) {
+			const double fraction = min_distance < 0.0 ? 1.0 : std::min(1.0, min_distance / full_distance);
+			if (size_t failed = probeMotion(*scene, jmg, *link, offset, ik_pose_world, target_eigen, fraction)) {
+				const double at = failed * fraction * full_distance / 3.0;
+				solution.markAsFailure(FailureCode::UNREACHABLE, [at] {
+					char msg[100];
+					snprintf(msg, sizeof(msg), "required distance not reachable (no valid IK at %.3g)", at);
+					return std::string(msg);
+				});
+				return false;
+			}
+		}
+
 		auto result =
 		    planner_->plan(state.scene(), *link, offset, target_eigen, jmg, timeout, robot_trajectory, path_constraints);
 		success = bool(result);
@@ -315,7 +442,7 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 
 			// visualize plan
 			auto ns = props.get<std::string>("marker_ns");
-			if (!ns.empty() && linear_norm > 0) {  // ensures that 'distance' is the norm of the reached distance
+			if (!ns.empty() && linear_norm > 0 && generatesMarkers()) {  // ensures that 'distance' is the norm of the reached distance
 				visualizePlan(solution.markers(), dir, success, ns, scene->getPlanningFrame(), ik_pose_world, reached_pose,
 				              linear, distance);
 			}
@@ -328,9 +455,10 @@ bool MoveRelative::compute(const InterfaceState& state, planning_scene::Planning
 		if (dir == Interface::BACKWARD)
 			robot_trajectory->reverse();
 		solution.setTrajectory(robot_trajectory);
+		solution.deferTiming(planner_->deferredTiming());
 
 		if (!success)
-			solution.markAsFailure(comment);
+			solution.markAsFailure(FailureCode::PLANNING_FAILED, comment);
 		return true;
 	}
 	return false;
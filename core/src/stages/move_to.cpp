@@ -41,6 +41,7 @@
 #include <tf2_eigen/tf2_eigen.h>
 
 #include <moveit/task_constructor/stages/move_to.h>
+#include <moveit/task_constructor/solvers/caching_planner.h>
 #include <moveit/task_constructor/cost_terms.h>
 #include <moveit/task_constructor/utils.h>
 
@@ -67,6 +68,7 @@ MoveTo::MoveTo(const std::string& name, const solvers::PlannerInterfacePtr& plan
 
 	p.declare<moveit_msgs::Constraints>("path_constraints", moveit_msgs::Constraints(),
 	                                    "constraints to maintain during trajectory");
+	p.declare<bool>("cache_plans", false, "reuse trajectories to joint-space goals from identical start states");
 }
 
 void MoveTo::setIKFrame(const Eigen::Isometry3d& pose, const std::string& link) {
@@ -91,8 +93,61 @@ void MoveTo::setGoal(const std::map<std::string, double>& joints) {
 
 void MoveTo::init(const moveit::core::RobotModelConstPtr& robot_model) {
 	PropagatingEitherWay::init(robot_model);
-	planner_->init(robot_model);
+	resolved_goal_ = ResolvedGoal();
+
+	if (properties().get<bool>("cache_plans") && !std::dynamic_pointer_cast<solvers::CachingPlanner>(planner_)) {
+		if (!caching_planner_ || caching_planner_->planner() != planner_) {
+			caching_planner_ = std::make_shared<solvers::CachingPlanner>(planner_);
+			caching_planner_->setWarmStart(true);  // keep trajectories when replanning the task
+		}
+	} else
+		caching_planner_.reset();
+	if (caching_planner_)
+		caching_planner_->initShared(robot_model);
+	else
+		planner_->initShared(robot_model);
+}
+
+namespace {
+// equality of goal specifications, false for unknown types
+bool sameGoal(const boost::any& a, const boost::any& b) {
+	if (a.type() != b.type())
+		return false;
+	if (const auto* name = boost::any_cast<std::string>(&a))
+		return *name == boost::any_cast<const std::string&>(b);
+	if (const auto* msg = boost::any_cast<moveit_msgs::RobotState>(&a))
+		return *msg == boost::any_cast<const moveit_msgs::RobotState&>(b);
+	if (const auto* joints = boost::any_cast<std::map<std::string, double>>(&a))
+		return *joints == boost::any_cast<const std::map<std::string, double>&>(b);
+	if (const auto* pose = boost::any_cast<geometry_msgs::PoseStamped>(&a))
+		return *pose == boost::any_cast<const geometry_msgs::PoseStamped&>(b);
+	if (const auto* point = boost::any_cast<geometry_msgs::PointStamped>(&a))
+		return *point == boost::any_cast<const geometry_msgs::PointStamped&>(b);
+	return false;
+}
+
+// indices of the variables defined by a joint-space goal
+std::vector<int> goalVariables(const boost::any& goal, const moveit::core::JointModelGroup* jmg) {
+	const moveit::core::RobotModel& robot_model = jmg->getParentModel();
+	std::vector<int> variables;
+	auto add_joint = [&](const std::string& name) {
+		const moveit::core::JointModel* joint = robot_model.getJointModel(name);
+		for (size_t i = 0; i < joint->getVariableCount(); ++i)
+			variables.push_back(joint->getFirstVariableIndex() + i);
+	};
+	if (const auto* msg = boost::any_cast<moveit_msgs::RobotState>(&goal)) {
+		for (const auto& name : msg->joint_state.name)
+			variables.push_back(robot_model.getVariableIndex(name));
+		for (const auto& name : msg->multi_dof_joint_state.joint_names)
+			add_joint(name);
+	} else if (const auto* joints = boost::any_cast<std::map<std::string, double>>(&goal)) {
+		for (const auto& joint : *joints)
+			variables.push_back(robot_model.getVariableIndex(joint.first));
+	} else  // named pose
+		variables = jmg->getVariableIndexList();
+	return variables;
 }
+}  // namespace
 
 bool MoveTo::getJointStateGoal(const boost::any& goal, const moveit::core::JointModelGroup* jmg,
                                moveit::core::RobotState& state) {
@@ -143,6 +198,30 @@ bool MoveTo::getJointStateGoal(const boost::any& goal, const moveit::core::Joint
 	return false;
 }
 
+bool MoveTo::applyJointStateGoal(const boost::any& goal, const moveit::core::JointModelGroup* jmg,
+                                 moveit::core::RobotState& state) {
+	if (resolved_goal_.jmg != jmg || !sameGoal(resolved_goal_.goal, goal)) {
+		ResolvedGoal resolved;
+		moveit::core::RobotState goal_state(state);
+		resolved.is_joint_goal = getJointStateGoal(goal, jmg, goal_state);  // might throw: don't cache
+		if (resolved.is_joint_goal) {
+			resolved.variables = goalVariables(goal, jmg);
+			for (int index : resolved.variables)
+				resolved.positions.push_back(goal_state.getVariablePosition(index));
+		}
+		resolved.goal = goal;
+		resolved.jmg = jmg;
+		resolved_goal_ = std::move(resolved);
+	}
+	if (!resolved_goal_.is_joint_goal)
+		return false;
+
+	for (size_t i = 0; i < resolved_goal_.variables.size(); ++i)
+		state.setVariablePosition(resolved_goal_.variables[i], resolved_goal_.positions[i]);
+	state.update();
+	return true;
+}
+
 bool MoveTo::getPoseGoal(const boost::any& goal, const planning_scene::PlanningScenePtr& scene,
                          Eigen::Isometry3d& target) {
 	try {
@@ -176,7 +255,7 @@ bool MoveTo::getPointGoal(const boost::any& goal, const Eigen::Isometry3d& ik_po
 
 bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningScenePtr& scene, SubTrajectory& solution,
                      Interface::Direction dir) {
-	scene = state.scene()->diff();
+	scene = utils::diffScene(state.scene());
 	const moveit::core::RobotModelConstPtr& robot_model = scene->getRobotModel();
 	assert(robot_model);
 
@@ -185,12 +264,12 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 	const std::string& group = props.get<std::string>("group");
 	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group);
 	if (!jmg) {
-		solution.markAsFailure("invalid joint model group: " + group);
+		solution.markAsFailure(FailureCode::INVALID_INPUT, "invalid joint model group: " + group);
 		return false;
 	}
 	boost::any goal = props.get("goal");
 	if (goal.empty()) {
-		solution.markAsFailure("undefined goal");
+		solution.markAsFailure(FailureCode::INVALID_INPUT, "undefined goal");
 		return false;
 	}
 
@@ -199,9 +278,11 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 	bool success = false;
 	std::string comment = "";
 
-	if (getJointStateGoal(goal, jmg, scene->getCurrentStateNonConst())) {
+	const solvers::PlannerInterfacePtr planner =
+	    caching_planner_ ? solvers::PlannerInterfacePtr(caching_planner_) : planner_;
+	if (applyJointStateGoal(goal, jmg, scene->getCurrentStateNonConst())) {
 		// plan to joint-space target
-		auto result = planner_->plan(state.scene(), scene, jmg, timeout, robot_trajectory, path_constraints);
+		auto result = planner->plan(state.scene(), scene, jmg, timeout, robot_trajectory, path_constraints);
 		success = bool(result);
 		if (!success)
 			comment = result.message;
@@ -217,11 +298,13 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 			return false;
 
 		if (!getPoseGoal(goal, scene, target) && !getPointGoal(goal, ik_pose_world, scene, target)) {
-			solution.markAsFailure(std::string("invalid goal type: ") + goal.type().name());
+			solution.markAsFailure(FailureCode::INVALID_INPUT, std::string("invalid goal type: ") + goal.type().name());
 			return false;
 		}
 
 		auto add_frame{ [&](const Eigen::Isometry3d& pose, const char name[]) {
+			if (!generatesMarkers())
+				return;
 			geometry_msgs::PoseStamped msg;
 			msg.header.frame_id = scene->getPlanningFrame();
 			msg.pose = tf2::toMsg(pose);
@@ -237,7 +320,7 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 
 		// plan to Cartesian target
 		const auto result =
-		    planner_->plan(state.scene(), *link, offset, target, jmg, timeout, robot_trajectory, path_constraints);
+		    planner->plan(state.scene(), *link, offset, target, jmg, timeout, robot_trajectory, path_constraints);
 		success = bool(result);
 		if (!success)
 			comment = result.message;
@@ -254,9 +337,10 @@ bool MoveTo::compute(const InterfaceState& state, planning_scene::PlanningSceneP
 		if (dir == Interface::BACKWARD)
 			robot_trajectory->reverse();
 		solution.setTrajectory(robot_trajectory);
+		solution.deferTiming(planner->deferredTiming());
 
 		if (!success)
-			solution.markAsFailure(comment);
+			solution.markAsFailure(FailureCode::PLANNING_FAILED, comment);
 
 		return true;
 	}
@@ -45,6 +45,7 @@ PickPlaceBase::PickPlaceBase(Stage::pointer&& grasp_stage, const std::string& na
 		p.property("group").configureInitFrom(Stage::PARENT, "eef_parent_group");
 		p.property("ik_frame").configureInitFrom(Stage::PARENT, init_ik_frame);
 		p.set("marker_ns", std::string(forward ? "approach" : "retract"));
+		p.set("cache_resolution", 1e-6);  // reuse motions of grasp candidates sharing their start state
 		approach_stage_ = approach.get();
 		insert(std::move(approach), insertion_position);
 	}
@@ -60,6 +61,7 @@ PickPlaceBase::PickPlaceBase(Stage::pointer&& grasp_stage, const std::string& na
 		p.property("group").configureInitFrom(Stage::PARENT, "eef_parent_group");
 		p.property("ik_frame").configureInitFrom(Stage::PARENT, init_ik_frame);
 		p.set("marker_ns", std::string(forward ? "lift" : "place"));
+		p.set("cache_resolution", 1e-6);
 		lift_stage_ = lift.get();
 		insert(std::move(lift), insertion_position);
 	}
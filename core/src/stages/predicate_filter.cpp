@@ -37,6 +37,8 @@
 
 #include <moveit/task_constructor/storage.h>
 
+#include <moveit/task_constructor/container_p.h>
+
 #include <moveit/planning_scene/planning_scene.h>
 
 #include <moveit/robot_state/conversions.h>
@@ -48,10 +50,52 @@ namespace moveit {
 namespace task_constructor {
 namespace stages {
 
+class PredicateFilterPrivate : public WrapperBasePrivate
+{
+public:
+	PredicateFilterPrivate(PredicateFilter* me, const std::string& name) : WrapperBasePrivate(me, name) {}
+
+private:
+	// filter received states by state_predicate before passing them to the child
+	void initializeExternalInterfaces() override;
+	template <Interface::Direction dir>
+	void filterState(Interface::iterator external, Interface::UpdateFlags updated);
+};
+
+void PredicateFilterPrivate::initializeExternalInterfaces() {
+	if (requiredInterface() & READS_START)
+		starts() = std::make_shared<Interface>([this](Interface::iterator external, Interface::UpdateFlags updated) {
+			this->filterState<Interface::FORWARD>(external, updated);
+		});
+	if (requiredInterface() & READS_END)
+		ends() = std::make_shared<Interface>([this](Interface::iterator external, Interface::UpdateFlags updated) {
+			this->filterState<Interface::BACKWARD>(external, updated);
+		});
+}
+
+template <Interface::Direction dir>
+void PredicateFilterPrivate::filterState(Interface::iterator external, Interface::UpdateFlags updated) {
+	const auto& props = me()->properties();
+	const auto& predicate = props.get("state_predicate");
+	std::string comment;
+	// updates of rejected states are ignored by copyState(), as they were never copied
+	if (!updated && !predicate.empty() && !props.get<bool>("ignore_filter") &&
+	    !boost::any_cast<PredicateFilter::StatePredicate>(predicate)(*external, comment)) {
+		auto failure = makeSolution<SubTrajectory>(SubTrajectory::failure(comment));
+		if (dir == Interface::FORWARD && nextStarts())
+			sendForward(*external, InterfaceState(external->scene()), failure);
+		else if (dir == Interface::BACKWARD && prevEnds())
+			sendBackward(InterfaceState(external->scene()), *external, failure);
+		return;
+	}
+	copyState(dir, external, children().front()->pimpl()->pullInterface(dir), updated);
+}
+
 PredicateFilter::PredicateFilter(const std::string& name, Stage::pointer&& child)
-  : WrapperBase(name, std::move(child)) {
+  : WrapperBase(new PredicateFilterPrivate(this, name), std::move(child)) {
 	auto& p = properties();
 	p.declare<Predicate>("predicate", "predicate to filter wrapped solutions");
+	p.declare<StatePredicate>("state_predicate", "predicate to filter states before passing them to the child");
 	p.declare<bool>("ignore_filter", false, "ignore predicate and forward all solutions");
 }
 
@@ -68,7 +112,7 @@ void PredicateFilter::init(const moveit::core::RobotModelConstPtr& robot_model)
 
 	// In theory this could be set in interface states
 	// but we enforce it here to keep code flow sane and maintainable
-	if (props.get("predicate").empty()) {
+	if (props.get("predicate").empty() && props.get("state_predicate").empty()) {
 		InitStageException e(*this, "predicate is not specified");
 		errors.append(e);
 	}
@@ -85,7 +129,8 @@ void PredicateFilter::onNewSolution(const SolutionBase& s) {
 	std::string comment = s.comment();
 
 	double cost = s.cost();
-	if (!props.get<bool>("ignore_filter") && !props.get<Predicate>("predicate")(s, comment))
+	const auto& predicate = props.get("predicate");
+	if (!predicate.empty() && !props.get<bool>("ignore_filter") && !boost::any_cast<Predicate>(predicate)(s, comment))
 		cost = std::numeric_limits<double>::infinity();
 
 	liftSolution(s, cost, comment);
@@ -0,0 +1,277 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Wrapper recording the inputs of its child, to replay them in isolation
+ */
+
+#include <moveit/task_constructor/stages/recorder.h>
+#include <moveit/task_constructor/storage.h>
+
+#include <moveit/task_constructor/container_p.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <geometry_msgs/PointStamped.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TwistStamped.h>
+#include <geometry_msgs/Vector3Stamped.h>
+#include <moveit_msgs/RobotState.h>
+#include <ros/serialization.h>
+
+#include <chrono>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+#include <typeindex>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+using moveit_task_constructor_msgs::RecordedProperty;
+using moveit_task_constructor_msgs::StageInput;
+using moveit_task_constructor_msgs::StageTrace;
+namespace ser = ros::serialization;
+
+namespace {
+template <typename T>
+void serializeMsg(const T& msg, std::vector<uint8_t>& data) {
+	data.resize(ser::serializationLength(msg));
+	ser::OStream stream(data.data(), data.size());
+	ser::serialize(stream, msg);
+}
+
+template <typename T>
+void deserializeMsg(const std::vector<uint8_t>& data, T& msg) {
+	// IStream doesn't modify the buffer
+	ser::IStream stream(const_cast<uint8_t*>(data.data()), data.size());
+	ser::deserialize(stream, msg);  // throws ros::serialization::StreamOverrunException, a std::runtime_error
+}
+
+// message types commonly used as stage or state properties, which don't provide a text deserialization
+struct MessageCodec
+{
+	std::type_index type;
+	std::string name;
+	void (*encode)(const boost::any& value, std::vector<uint8_t>& data);
+	boost::any (*decode)(const std::vector<uint8_t>& data);
+};
+
+template <typename T>
+void encodeMsg(const boost::any& value, std::vector<uint8_t>& data) {
+	serializeMsg(boost::any_cast<const T&>(value), data);
+}
+
+template <typename T>
+boost::any decodeMsg(const std::vector<uint8_t>& data) {
+	T msg;
+	deserializeMsg(data, msg);
+	return msg;
+}
+
+template <typename T>
+MessageCodec codec() {
+	return MessageCodec{ typeid(T), ros::message_traits::DataType<T>::value(), &encodeMsg<T>, &decodeMsg<T> };
+}
+
+const std::vector<MessageCodec>& messageCodecs() {
+	static const std::vector<MessageCodec> codecs{
+		codec<geometry_msgs::Point>(),         codec<geometry_msgs::PointStamped>(),
+		codec<geometry_msgs::Pose>(),          codec<geometry_msgs::PoseStamped>(),
+		codec<geometry_msgs::Vector3>(),       codec<geometry_msgs::Vector3Stamped>(),
+		codec<geometry_msgs::Twist>(),         codec<geometry_msgs::TwistStamped>(),
+		codec<moveit_msgs::RobotState>(),
+	};
+	return codecs;
+}
+}  // namespace
+
+class RecorderPrivate : public WrapperBasePrivate
+{
+	friend class Recorder;
+
+public:
+	RecorderPrivate(Recorder* me, const std::string& name) : WrapperBasePrivate(me, name) {}
+
+private:
+	// record received states before passing them to the child
+	void initializeExternalInterfaces() override;
+	template <Interface::Direction dir>
+	void recordState(Interface::iterator external, Interface::UpdateFlags updated);
+
+	// states might be received from several threads when planning concurrently
+	mutable std::mutex mutex_;
+	StageTrace trace_;
+	std::chrono::steady_clock::time_point origin_;
+};
+PIMPL_FUNCTIONS(Recorder)
+
+void RecorderPrivate::initializeExternalInterfaces() {
+	if (requiredInterface() & READS_START)
+		starts() = std::make_shared<Interface>([this](Interface::iterator external, Interface::UpdateFlags updated) {
+			this->recordState<Interface::FORWARD>(external, updated);
+		});
+	if (requiredInterface() & READS_END)
+		ends() = std::make_shared<Interface>([this](Interface::iterator external, Interface::UpdateFlags updated) {
+			this->recordState<Interface::BACKWARD>(external, updated);
+		});
+}
+
+template <Interface::Direction dir>
+void RecorderPrivate::recordState(Interface::iterator external, Interface::UpdateFlags updated) {
+	if (!updated) {  // only record new states, priority updates are just forwarded
+		StageInput input;
+		input.interface = dir == Interface::FORWARD ? StageInput::START : StageInput::END;
+		external->scene()->getPlanningSceneMsg(input.scene);
+		for (const auto& p : external->properties()) {
+			RecordedProperty property;
+			if (Recorder::encode(p.first, p.second.value(), property))
+				input.properties.push_back(std::move(property));
+		}
+
+		std::lock_guard<std::mutex> lock(mutex_);
+		const auto now = std::chrono::steady_clock::now();
+		if (trace_.inputs.empty())
+			origin_ = now;
+		input.time = std::chrono::duration<double>(now - origin_).count();
+		trace_.inputs.push_back(std::move(input));
+	}
+	copyState<dir>(external, children().front()->pimpl()->pullInterface(dir), updated);
+}
+
+Recorder::Recorder(const std::string& name, Stage::pointer&& child)
+  : WrapperBase(new RecorderPrivate(this, name), std::move(child)) {}
+
+void Recorder::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	WrapperBase::init(robot_model);
+
+	// the child's properties are complete now, including those inherited from its parent
+	std::vector<RecordedProperty> properties;
+	for (const auto& p : wrapped()->properties()) {
+		RecordedProperty property;
+		if (encode(p.first, p.second.value(), property))
+			properties.push_back(std::move(property));
+	}
+
+	auto impl = pimpl();
+	std::lock_guard<std::mutex> lock(impl->mutex_);
+	impl->trace_.stage = wrapped()->name();
+	impl->trace_.properties = std::move(properties);
+}
+
+void Recorder::onNewSolution(const SolutionBase& s) {
+	liftSolution(s);
+}
+
+StageTrace Recorder::trace() const {
+	auto impl = pimpl();
+	std::lock_guard<std::mutex> lock(impl->mutex_);
+	return impl->trace_;
+}
+
+size_t Recorder::size() const {
+	auto impl = pimpl();
+	std::lock_guard<std::mutex> lock(impl->mutex_);
+	return impl->trace_.inputs.size();
+}
+
+void Recorder::clear() {
+	auto impl = pimpl();
+	std::lock_guard<std::mutex> lock(impl->mutex_);
+	impl->trace_.inputs.clear();
+}
+
+void Recorder::save(const std::string& filename) const {
+	std::vector<uint8_t> buffer;
+	serializeMsg(trace(), buffer);
+
+	std::ofstream file(filename, std::ios::binary);
+	file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
+	if (!file)
+		throw std::runtime_error("failed to write stage trace '" + filename + "'");
+}
+
+StageTrace Recorder::load(const std::string& filename) {
+	std::ifstream file(filename, std::ios::binary);
+	if (!file)
+		throw std::runtime_error("failed to read stage trace '" + filename + "'");
+	std::vector<uint8_t> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	StageTrace trace;
+	deserializeMsg(buffer, trace);
+	return trace;
+}
+
+bool Recorder::encode(const std::string& name, const boost::any& value, RecordedProperty& msg) {
+	if (value.empty())
+		return false;
+
+	msg.name = name;
+	for (const MessageCodec& codec : messageCodecs()) {
+		if (codec.type != value.type())
+			continue;
+		msg.type = codec.name;
+		msg.encoding = RecordedProperty::MESSAGE;
+		codec.encode(value, msg.data);
+		return true;
+	}
+
+	// Property::deserialize() reads strings only up to the first whitespace: store them verbatim
+	const std::string text =
+	    value.type() == typeid(std::string) ? boost::any_cast<const std::string&>(value) : Property::serialize(value);
+	if (text.empty() && value.type() != typeid(std::string))
+		return false;  // no serialization available
+
+	msg.type = Property::typeName(value.type());
+	msg.encoding = RecordedProperty::TEXT;
+	msg.data.assign(text.begin(), text.end());
+	return true;
+}
+
+boost::any Recorder::decode(const RecordedProperty& msg) {
+	if (msg.encoding == RecordedProperty::MESSAGE) {
+		for (const MessageCodec& codec : messageCodecs())
+			if (codec.name == msg.type)
+				return codec.decode(msg.data);
+		return boost::any();
+	}
+
+	std::string text(msg.data.begin(), msg.data.end());
+	if (msg.type == Property::typeName(typeid(std::string)))
+		return text;
+	return Property::deserialize(msg.type, text);  // empty for unregistered types
+}
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
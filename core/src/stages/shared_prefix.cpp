@@ -0,0 +1,125 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Generator spawning the end states of a prefix Task shared by several Tasks
+ */
+
+#include <moveit/task_constructor/stages/shared_prefix.h>
+#include <moveit/task_constructor/storage.h>
+
+#include <moveit/task_constructor/stage_p.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit_task_constructor_msgs/Solution.h>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+namespace {
+/// wraps a prefix solution, reporting its trajectories as our own
+class PrefixSolution : public WrappedSolution
+{
+public:
+	using WrappedSolution::WrappedSolution;
+
+	void appendTo(moveit_task_constructor_msgs::Solution& msg, Introspection* introspection) const override {
+		// stages of the prefix Task are unknown to our introspection: serialize without, then claim the trajectories
+		moveit_task_constructor_msgs::Solution prefix;
+		wrapped()->appendTo(prefix, nullptr);
+
+		moveit_task_constructor_msgs::SolutionInfo info;
+		fillInfo(info, introspection);
+		msg.sub_trajectory.reserve(msg.sub_trajectory.size() + prefix.sub_trajectory.size());
+		for (auto& trajectory : prefix.sub_trajectory) {
+			trajectory.info.id = info.id;
+			trajectory.info.stage_id = info.stage_id;
+			msg.sub_trajectory.push_back(std::move(trajectory));
+		}
+	}
+};
+}  // namespace
+
+moveit::core::MoveItErrorCode SharedPrefix::Source::plan() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (!planned_) {
+		result_ = task_.plan(max_solutions_);
+		planned_ = true;
+		++runs_;
+	}
+	return result_;
+}
+
+void SharedPrefix::Source::reset() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	planned_ = false;
+}
+
+SharedPrefix::SharedPrefix(const std::string& name, SourcePtr source) : Generator(name), source_(std::move(source)) {}
+
+void SharedPrefix::reset() {
+	Generator::reset();
+	prefixes_.clear();
+	ran_ = false;
+}
+
+void SharedPrefix::init(const moveit::core::RobotModelConstPtr& robot_model) {
+	Generator::init(robot_model);
+	if (!source_)
+		throw InitStageException(*this, "no prefix task defined");
+
+	const auto& prefix_model = source_->task().getRobotModel();
+	if (prefix_model && prefix_model != robot_model)
+		throw InitStageException(*this, "prefix task uses a different robot model");
+}
+
+bool SharedPrefix::canCompute() const {
+	return !ran_ && source_;
+}
+
+void SharedPrefix::compute() {
+	ran_ = true;
+	if (!source_->plan())
+		return;  // prefix task already reported its failure
+
+	auto* impl = pimpl();
+	for (const SolutionBaseConstPtr& prefix : source_->task().solutions()) {
+		prefixes_.push_back(prefix);
+		auto solution = impl->makeSolution<PrefixSolution>(this, prefix.get(), prefix->cost(), prefix->comment());
+		impl->spawn(InterfaceState(*prefix->start()), InterfaceState(*prefix->end()), solution);
+	}
+}
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,159 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc:    Stream grasp poses from a memory-mapped grasp database
+ */
+
+#include <moveit/task_constructor/stages/stream_grasp_poses.h>
+#include <moveit/task_constructor/stage_p.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/marker_tools.h>
+#include <rviz_marker_tools/marker_creation.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <tf2_eigen/tf2_eigen.h>
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace moveit {
+namespace task_constructor {
+namespace stages {
+
+StreamGraspPoses::StreamGraspPoses(const std::string& name) : GenerateGraspPose(name) {
+	auto& p = properties();
+	p.declare<utils::GraspDatabaseConstPtr>("database", utils::GraspDatabaseConstPtr(), "grasps of the object");
+	p.declare<uint32_t>("chunk_size", 32u, "number of grasps spawned per compute()");
+	p.declare<uint32_t>("max_pending", 0u, "pause while the downstream interface holds as many states (0: never)");
+	p.declare<double>("min_quality", -std::numeric_limits<double>::infinity(), "minimum quality of grasps");
+}
+
+void StreamGraspPoses::reset() {
+	streams_.clear();
+	num_streamed_ = 0;
+	GenerateGraspPose::reset();
+}
+
+void StreamGraspPoses::init(const core::RobotModelConstPtr& robot_model) {
+	InitStageException errors;
+	try {
+		GenerateGraspPose::init(robot_model);
+	} catch (InitStageException& e) {
+		errors.append(e);
+	}
+	if (!properties().get<utils::GraspDatabaseConstPtr>("database"))
+		errors.push_back(*this, "no grasp database provided");
+	if (errors)
+		throw errors;
+}
+
+void StreamGraspPoses::onNewSolution(const SolutionBase& s) {
+	const planning_scene::PlanningSceneConstPtr& scene = s.end()->scene();
+	const std::string& object = properties().get<std::string>("object");
+	if (!scene->knowsFrameTransform(object)) {
+		spawn(InterfaceState{ scene }, SubTrajectory::failure("object '" + object + "' not in scene"));
+		return;
+	}
+	streams_.push_back(Stream{ &s, nullptr, 0 });
+}
+
+bool StreamGraspPoses::canCompute() const {
+	if (streams_.empty())
+		return false;
+	const uint32_t max_pending = properties().get<uint32_t>("max_pending");
+	if (max_pending == 0)
+		return true;
+	// states spawned previously, not yet processed by the downstream stage
+	size_t pending = 0;
+	if (InterfaceConstPtr next = pimpl()->nextStarts())
+		pending += next->size();
+	if (InterfaceConstPtr prev = pimpl()->prevEnds())
+		pending += prev->size();
+	return pending < max_pending;
+}
+
+void StreamGraspPoses::compute() {
+	if (streams_.empty())
+		return;
+	Stream& stream = streams_.front();
+	const auto& props = properties();
+	const utils::GraspDatabase& db = *props.get<utils::GraspDatabaseConstPtr>("database");
+	const size_t end = db.countAbove(props.get<double>("min_quality"));
+
+	if (!stream.scene && !(stream.scene = pregraspScene(*stream.solution))) {
+		streams_.pop_front();
+		return;
+	}
+	const planning_scene::PlanningSceneConstPtr& scene = stream.scene;
+
+	geometry_msgs::PoseStamped target_pose_msg;
+	target_pose_msg.header.frame_id = props.get<std::string>("object");
+	const Eigen::Isometry3d object_pose =
+	    reachability_filter_ ? scene->getFrameTransform(target_pose_msg.header.frame_id) : Eigen::Isometry3d::Identity();
+
+	InterfaceState prototype(scene);
+	props.exposeTo(prototype.properties(), { "pregrasp", "grasp" });
+
+	const double best_quality = end > 0 ? db.quality(0) : 0.0;
+	const size_t chunk_end = std::min(end, stream.next + std::max(props.get<uint32_t>("chunk_size"), 1u));
+	std::vector<std::pair<InterfaceState, SubTrajectory>> batch;
+	batch.reserve(chunk_end - stream.next);
+	for (; stream.next < chunk_end; ++stream.next) {
+		const utils::GraspDatabase::Grasp grasp = db.grasp(stream.next);
+		if (!reachable(scene, object_pose * grasp.pose))
+			continue;
+
+		InterfaceState state(prototype);
+		target_pose_msg.pose = tf2::toMsg(grasp.pose);
+		state.properties().set("target_pose", target_pose_msg);
+
+		SubTrajectory trajectory;
+		trajectory.setCost(best_quality - grasp.quality);
+		trajectory.setComment(fmt::format("grasp {} (quality {:.3g})", stream.next, grasp.quality));
+
+		if (generatesMarkers())
+			rviz_marker_tools::appendFrame(trajectory.markers(), target_pose_msg, 0.1, "grasp frame");
+
+		batch.emplace_back(std::move(state), std::move(trajectory));
+	}
+	num_streamed_ += batch.size();
+	if (stream.next >= end)
+		streams_.pop_front();
+	spawnBatch(std::move(batch));
+}
+}  // namespace stages
+}  // namespace task_constructor
+}  // namespace moveit
@@ -37,15 +37,128 @@
 
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/flat_map.h>
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/task_constructor/scheduler_log.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/robot_state/conversions.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit_msgs/PlanningSceneComponents.h>
 #include <assert.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
+#include <thread>
 
 namespace moveit {
 namespace task_constructor {
 
+namespace {
+/** Fill msg with the changes of scene to w.r.t. scene from
+ *
+ * In contrast to PlanningScene::getPlanningSceneDiffMsg(), to doesn't need to be a direct child of from.
+ * World objects are shared copy-on-write between scenes, such that unchanged ones are found by pointer.
+ */
+void getPlanningSceneDiffMsg(const planning_scene::PlanningScene& from, const planning_scene::PlanningScene& to,
+                             moveit_msgs::PlanningScene& msg) {
+	using moveit_msgs::PlanningSceneComponents;
+	PlanningSceneComponents components;
+	components.components = PlanningSceneComponents::SCENE_SETTINGS | PlanningSceneComponents::TRANSFORMS |
+	                        PlanningSceneComponents::ALLOWED_COLLISION_MATRIX |
+	                        PlanningSceneComponents::LINK_PADDING_AND_SCALING | PlanningSceneComponents::OBJECT_COLORS;
+	to.getPlanningSceneMsg(msg, components);
+	msg.is_diff = true;
+
+	// robot state, including (re-)attaching all attached bodies and detaching the ones not attached anymore
+	const moveit::core::RobotState& to_state = to.getCurrentState();
+	moveit::core::robotStateToRobotStateMsg(to_state, msg.robot_state, true);
+	msg.robot_state.is_diff = true;
+	std::vector<const moveit::core::AttachedBody*> from_bodies;
+	from.getCurrentState().getAttachedBodies(from_bodies);
+	for (const moveit::core::AttachedBody* body : from_bodies) {
+		if (to_state.hasAttachedBody(body->getName()))
+			continue;
+		moveit_msgs::AttachedCollisionObject detach;
+		detach.link_name = body->getAttachedLinkName();
+		detach.object.id = body->getName();
+		detach.object.operation = moveit_msgs::CollisionObject::REMOVE;
+		msg.robot_state.attached_collision_objects.push_back(std::move(detach));
+	}
+
+	const auto& from_world = from.getWorld();
+	const auto& to_world = to.getWorld();
+	for (const auto& object : *to_world) {
+		if (from_world->getObject(object.first) == object.second)
+			continue;  // unchanged
+		if (object.first == planning_scene::PlanningScene::OCTOMAP_NS) {
+			to.getOctomapMsg(msg.world.octomap);
+			continue;
+		}
+		moveit_msgs::CollisionObject co;
+		if (to.getCollisionObjectMsg(co, object.first))
+			msg.world.collision_objects.push_back(std::move(co));
+	}
+
+	auto remove = [&msg](const std::string& id) {
+		moveit_msgs::CollisionObject co;
+		co.id = id;
+		co.operation = moveit_msgs::CollisionObject::REMOVE;
+		msg.world.collision_objects.push_back(std::move(co));
+	};
+	// objects removed from the world: attached ones were moved by attaching them already
+	for (const auto& object : *from_world)
+		if (!to_world->hasObject(object.first) && !to_state.hasAttachedBody(object.first) &&
+		    object.first != planning_scene::PlanningScene::OCTOMAP_NS)
+			remove(object.first);
+	// detached bodies are moved into the world: remove them, if they shouldn't be there
+	for (const moveit::core::AttachedBody* body : from_bodies)
+		if (!to_state.hasAttachedBody(body->getName()) && !to_world->hasObject(body->getName()))
+			remove(body->getName());
+}
+
+// compare joint variables of group (all if nullptr) of both states
+bool sameState(const moveit::core::RobotState& a, const moveit::core::RobotState& b,
+               const moveit::core::JointModelGroup* group, double tolerance) {
+	auto differs = [&](size_t i) { return std::abs(a.getVariablePosition(i) - b.getVariablePosition(i)) > tolerance; };
+	if (group)
+		return std::none_of(group->getVariableIndexList().begin(), group->getVariableIndexList().end(), differs);
+	for (size_t i = 0, end = a.getVariableCount(); i != end; ++i)
+		if (differs(i))
+			return false;
+	return true;
+}
+
+/** Create a diff of scene to check a trajectory starting in start, which was planned from origin
+ *
+ * Scene's world is modified like start's world differs from origin's world, i.e. objects removed (or attached)
+ * along the solution are removed and objects added (or modified) are copied. As the world objects are shared
+ * copy-on-write between the scenes of a solution, they are compared by pointer.
+ */
+planning_scene::PlanningScenePtr checkScene(const planning_scene::PlanningScene& scene,
+                                            const planning_scene::PlanningScene& origin,
+                                            const planning_scene::PlanningScene& start) {
+	planning_scene::PlanningScenePtr result = scene.diff();
+	const collision_detection::WorldConstPtr& origin_world = origin.getWorld();
+	const collision_detection::WorldConstPtr& start_world = start.getWorld();
+	const collision_detection::WorldPtr& world = result->getWorldNonConst();
+	for (const std::string& id : origin_world->getObjectIds())
+		if (!start_world->hasObject(id))
+			world->removeObject(id);
+	for (const auto& object : *start_world) {
+		if (origin_world->getObject(object.first) == object.second)
+			continue;
+		world->removeObject(object.first);
+		world->addToObject(object.first, object.second->pose_, object.second->shapes_, object.second->shape_poses_);
+	}
+	result->setCurrentState(start.getCurrentState());  // including attached bodies
+	result->getAllowedCollisionMatrixNonConst() = start.getAllowedCollisionMatrix();
+	return result;
+}
+}  // namespace
+
 planning_scene::PlanningSceneConstPtr ensureUpdated(const planning_scene::PlanningScenePtr& scene) {
 	// ensure scene's state is updated
 	if (scene->getCurrentState().dirty())
@@ -53,21 +166,70 @@ planning_scene::PlanningSceneConstPtr ensureUpdated(const planning_scene::Planni
 	return scene;
 }
 
+uint64_t InterfaceState::nextRevision() {
+	static std::atomic<uint64_t> revision{ 0 };
+	return ++revision;
+}
+
 InterfaceState::InterfaceState(const planning_scene::PlanningScenePtr& ps) : InterfaceState(ensureUpdated(ps)) {}
 
-InterfaceState::InterfaceState(const planning_scene::PlanningSceneConstPtr& ps)
-  : scene_(ps), priority_(Priority(0, 0.0)) {
-	if (scene_->getCurrentState().dirty())
+InterfaceState::InterfaceState(const planning_scene::PlanningSceneConstPtr& ps) : schedule_{ Priority(0, 0.0) } {
+	auto payload = std::make_shared<Payload>();
+	payload->scene = ps;
+	payload_ = std::move(payload);
+	if (ps->getCurrentState().dirty())
 		ROS_ERROR_NAMED("InterfaceState", "Dirty PlanningScene! Please only forward clean ones into InterfaceState.");
 }
 
 InterfaceState::InterfaceState(const planning_scene::PlanningSceneConstPtr& ps, const Priority& p)
   : InterfaceState(ps) {
-	priority_ = p;
+	schedule_.priority = p;
+}
+
+InterfaceState::InterfaceState(const planning_scene::PlanningSceneConstPtr& base, std::vector<double> positions)
+  : schedule_{ Priority(0, 0.0) } {
+	assert(positions.size() == base->getCurrentState().getVariableCount());
+	auto payload = std::make_shared<Payload>();
+	payload->lazy = std::make_shared<LazyScene>();
+	payload->lazy->base = base;
+	payload->lazy->positions = std::move(positions);
+	payload_ = std::move(payload);
+}
+
+void InterfaceState::removeIncoming(const SolutionBase* t) const {
+	Solutions& incoming = schedule_.incoming_trajectories;
+	incoming.erase(std::remove(incoming.begin(), incoming.end(), t), incoming.end());
+}
+
+void InterfaceState::removeOutgoing(const SolutionBase* t) const {
+	Solutions& outgoing = schedule_.outgoing_trajectories;
+	outgoing.erase(std::remove(outgoing.begin(), outgoing.end(), t), outgoing.end());
 }
 
+// share the payload, but start with fresh scheduling metadata (only keeping the priority)
 InterfaceState::InterfaceState(const InterfaceState& other)
-  : scene_(other.scene_), properties_(other.properties_), priority_(other.priority_) {}
+  : payload_(other.payload_), properties_(other.properties_), schedule_{ other.schedule_.priority } {}
+
+InterfaceState::~InterfaceState() {
+	utils::SchedulerLog::released(this);  // a new state at this address is a different one
+}
+
+const planning_scene::PlanningSceneConstPtr& InterfaceState::LazyScene::scene() {
+	std::call_once(created, [this] {
+		planning_scene::PlanningScenePtr scene = utils::diffScene(base);
+		moveit::core::RobotState& state = scene->getCurrentStateNonConst();
+		state.setVariablePositions(positions);
+		state.update();
+		result = scene;
+	});
+	return result;
+}
+
+const double* InterfaceState::variablePositions() const {
+	// positions of lightweight states are kept after creating their scene for thread-safe access
+	return payload_->scene ? payload_->scene->getCurrentState().getVariablePositions() :
+	                         payload_->lazy->positions.data();
+}
 
 bool InterfaceState::Priority::operator<(const InterfaceState::Priority& other) const {
 	// first order by status if that differs
@@ -78,29 +240,112 @@ bool InterfaceState::Priority::operator<(const InterfaceState::Priority& other)
 	if (depth() != other.depth())
 		return depth() > other.depth();  // larger depth = smaller prio!
 
+	// then by estimated total cost, i.e. accumulated cost plus cost-to-go
+	const double total = cost() + estimate();
+	const double other_total = other.cost() + other.estimate();
+	if (total != other_total)
+		return total < other_total;
+
 	// finally by cost
 	return cost() < other.cost();
 }
 
-void InterfaceState::updatePriority(const InterfaceState::Priority& priority) {
+void InterfaceState::updatePriority(const InterfaceState::Priority& priority) const {
 	// Never overwrite ARMED with PRUNED
-	if (priority.status() == InterfaceState::Status::PRUNED && priority_.status() == InterfaceState::Status::ARMED)
+	if (priority.status() == InterfaceState::Status::PRUNED &&
+	    schedule_.priority.status() == InterfaceState::Status::ARMED)
 		return;
+	if (priority.status() != schedule_.priority.status())
+		utils::SchedulerLog::status(this, priority.status());
 
-	if (owner()) {
-		owner()->updatePriority(this, priority);
+	if (owner()) {  // the owning interface lists the state as modifiable
+		owner()->updatePriority(const_cast<InterfaceState*>(this), priority);
 	} else {
-		setPriority(priority);
+		setPriority(Priority(priority.depth(), priority.cost(), priority.status(), schedule_.priority.estimate()));
 	}
 }
-void InterfaceState::updateStatus(Status status) {
-	updatePriority(InterfaceState::Priority(priority_, status));
+void InterfaceState::updateStatus(Status status) const {
+	updatePriority(InterfaceState::Priority(schedule_.priority, status));
 }
 
 Interface::Interface(const Interface::NotifyFunction& notify) : notify_(notify) {}
 
+namespace {
+// notifications deferred by Interface::BatchNotify scopes of the current thread
+struct NotifyBatch
+{
+	struct Entry
+	{
+		Interface* interface;
+		Interface::iterator it;
+		Interface::UpdateFlags updated;
+	};
+	size_t depth = 0;  // number of nested scopes
+	std::vector<Entry> entries;  // in order of first notification
+	utils::FlatPointerMap<const InterfaceState*, size_t> index;  // state -> entry
+
+	void clear() {
+		entries.clear();
+		index.clear();
+	}
+};
+thread_local NotifyBatch notify_batch;
+}  // namespace
+
+Interface::BatchNotify::BatchNotify() {
+	++notify_batch.depth;
+}
+
+Interface::BatchNotify::~BatchNotify() noexcept(false) {
+	NotifyBatch& batch = notify_batch;
+	if (batch.depth > 1) {  // only the outermost scope delivers
+		--batch.depth;
+		return;
+	}
+	if (std::uncaught_exception()) {  // unwinding: don't call back into the failing stages
+		batch.clear();
+		batch.depth = 0;
+		return;
+	}
+	// deliver in rounds, keeping the scope active to coalesce notifications raised by the callbacks
+	std::vector<NotifyBatch::Entry> round;
+	try {
+		while (!batch.entries.empty()) {
+			round.clear();
+			round.swap(batch.entries);
+			batch.index.clear();
+			for (const NotifyBatch::Entry& entry : round)
+				if (entry.it->owner() == entry.interface && entry.interface->notify_)
+					entry.interface->notify_(entry.it, entry.updated);
+		}
+	} catch (...) {
+		batch.clear();
+		batch.depth = 0;
+		throw;
+	}
+	batch.depth = 0;
+}
+
+void Interface::notify(iterator it, UpdateFlags updated) {
+	NotifyBatch& batch = notify_batch;
+	if (batch.depth == 0) {
+		notify_(it, updated);
+		return;
+	}
+	auto inserted = batch.index.insert(std::make_pair(&*it, batch.entries.size()));
+	if (inserted.second) {
+		batch.entries.push_back(NotifyBatch::Entry{ this, it, updated });
+		return;
+	}
+	NotifyBatch::Entry& entry = batch.entries[inserted.first->second];
+	if (entry.interface != this || !updated)  // state moved to another interface or was added anew
+		entry = NotifyBatch::Entry{ this, it, updated };
+	else if (entry.updated)  // a pending notification of a new state (without flags) already covers updates
+		entry.updated |= updated;
+}
+
 // Announce a new InterfaceState
-void Interface::add(InterfaceState& state) {
+Interface::iterator Interface::prepare(InterfaceState& state, container_type& container) {
 	// require valid scene
 	assert(state.scene());
 	// incoming and outgoing must not contain elements both
@@ -109,46 +354,206 @@ void Interface::add(InterfaceState& state) {
 	assert(state.incomingTrajectories().empty() || state.incomingTrajectories().size() == 1);
 	assert(state.outgoingTrajectories().empty() || state.outgoingTrajectories().size() == 1);
 	// state can only be added once to an interface
-	assert(state.owner_ == nullptr);
+	assert(state.schedule_.owner == nullptr);
 
 	// move state to a list node
-	std::list<InterfaceState*> container;
 	Interface::iterator it = container.insert(container.end(), &state);
-	it->owner_ = this;
+	it->schedule_.owner = this;
 
 	// if either incoming or outgoing is defined, derive priority from there
 	if (!state.incomingTrajectories().empty())
-		it->priority_ = InterfaceState::Priority(1, state.incomingTrajectories().front()->cost());
+		it->schedule_.priority = InterfaceState::Priority(1, state.incomingTrajectories().front()->cost());
 	else if (!state.outgoingTrajectories().empty())
-		it->priority_ = InterfaceState::Priority(1, state.outgoingTrajectories().front()->cost());
+		it->schedule_.priority = InterfaceState::Priority(1, state.outgoingTrajectories().front()->cost());
 	else {  // otherwise, assume priority was well defined before
-		assert(it->priority_.enabled());
-		assert(it->priority_.depth() >= 1u);
+		assert(it->priority().enabled());
+		assert(it->priority().depth() >= 1u);
+	}
+	if (cost_to_go_) {
+		const InterfaceState::Priority& prio = it->schedule_.priority;
+		it->schedule_.priority = InterfaceState::Priority(prio.depth(), prio.cost(), prio.status(), cost_to_go_(*it));
 	}
 
+	registerSlot(*it);
+	return it;
+}
+
+void Interface::add(InterfaceState& state) {
+	container_type container;
+	Interface::iterator it = prepare(state, container);
 	// move list node into interface's state list (sorted by priority)
 	moveFrom(it, container);
 	// and finally call notify callback
 	if (notify_)
-		notify_(it, UpdateFlags());
+		notify(it, UpdateFlags());
+	trimToBeam();
+}
+
+void Interface::add(const std::vector<InterfaceState*>& states) {
+	container_type container;
+	std::vector<Interface::iterator> added;
+	added.reserve(states.size());
+	for (InterfaceState* state : states)
+		added.push_back(prepare(*state, container));
+
+	if (added.size() * 8 < size()) {  // only a few new states: sorted insertion is cheaper than reindexing
+		for (Interface::iterator& it : added)
+			moveFrom(it, container);
+	} else
+		merge(container);  // list nodes (and thus iterators) are spliced over
+
+	if (notify_)
+		for (const Interface::iterator& it : added)
+			notify(it, UpdateFlags());
+	trimToBeam();
+}
+
+namespace {
+// key identifying (almost) equal states: quantized joint positions, names of world objects and attached bodies
+std::string uniqueKey(const InterfaceState& state, double resolution) {
+	// use the base scene of lightweight states, which shares world and attached bodies, to not create their scene
+	const planning_scene::PlanningSceneConstPtr& scene = state.baseScene();
+	const moveit::core::RobotState& robot_state = scene->getCurrentState();
+	const double* positions = state.variablePositions();
+	std::string key;
+	key.reserve(robot_state.getVariableCount() * sizeof(long long));
+	for (size_t i = 0; i < robot_state.getVariableCount(); ++i) {
+		const long long quantized = std::llround(positions[i] / resolution);
+		key.append(reinterpret_cast<const char*>(&quantized), sizeof(quantized));
+	}
+	for (const auto& object : *scene->getWorld())
+		key.append(object.first).push_back('\0');
+	key.push_back('\0');  // separate world objects from attached bodies
+	std::vector<const moveit::core::AttachedBody*> bodies;
+	robot_state.getAttachedBodies(bodies);
+	for (const moveit::core::AttachedBody* body : bodies)
+		key.append(body->getName()).append("@").append(body->getAttachedLinkName()).push_back('\0');
+	return key;
+}
+}  // namespace
+
+bool Interface::addUnique(InterfaceState& state, double resolution) {
+	assert(resolution > 0.0);
+	if (!unique_keys_.insert(uniqueKey(state, resolution)).second)
+		return false;
+	add(state);
+	return true;
+}
+
+void Interface::clear() {
+	base_type::clear();
+	deferred_.clear();
+	priorities_.clear();
+	slots_.clear();
+	unique_keys_.clear();
 }
 
 Interface::container_type Interface::remove(iterator it) {
 	container_type result;
 	moveTo(it, result, result.end());
-	it->owner_ = nullptr;
+	releaseSlot(*it);
+	it->schedule_.owner = nullptr;
+	reviveIfExhausted();
 	return result;
 }
 
-void Interface::updatePriority(InterfaceState* state, const InterfaceState::Priority& priority) {
+void Interface::setBeamWidth(size_t width) {
+	beam_width_ = width;
+	trimToBeam();
+	reviveDeferred();  // fill up a widened beam
+}
+
+void Interface::trimToBeam() {
+	if (beam_width_ == 0 || size() <= beam_width_)
+		return;
+
+	// states are sorted by status first: all enabled states beyond the beam width are deferred
+	Interface::iterator pos = begin();
+	std::advance(pos, beam_width_);
+	std::vector<Interface::iterator> displaced;
+	while (pos != end() && pos->priority().enabled()) {
+		Interface::iterator it = pos++;
+		releaseSlot(*it);
+		it->schedule_.deferred = true;
+		moveTo(it, deferred_, deferred_.end());
+		displaced.push_back(it);
+	}
+	if (notify_)
+		for (const Interface::iterator& it : displaced)
+			notify(it, UpdateFlags(PRIORITY));
+}
+
+size_t Interface::reviveDeferred() {
+	size_t capacity = deferred_.size();
+	if (beam_width_ > 0) {  // only fill up the beam
+		size_t enabled = 0;
+		for (auto it = cbegin(), end = cend(); it != end && enabled < beam_width_ && (*it)->priority().enabled(); ++it)
+			++enabled;
+		capacity = std::min(capacity, beam_width_ - enabled);
+	}
+	return reviveDeferred(capacity);
+}
+
+size_t Interface::reviveDeferred(size_t count) {
+	const size_t capacity = std::min(count, deferred_.size());
+	if (capacity == 0)
+		return 0;
+
+	// deferred states are only sorted when needed: best ones first
+	deferred_.sort([](const InterfaceState* a, const InterfaceState* b) { return *a < *b; });
+	std::vector<Interface::iterator> revived;
+	revived.reserve(capacity);
+	while (revived.size() < capacity) {
+		Interface::iterator it = deferred_.begin();
+		it->schedule_.deferred = false;
+		moveFrom(it, deferred_);
+		registerSlot(*it);
+		revived.push_back(it);
+	}
+	if (notify_)
+		for (const Interface::iterator& it : revived)
+			notify(it, UpdateFlags(PRIORITY));
+	return revived.size();
+}
+
+void Interface::reviveIfExhausted() {
+	if (!deferred_.empty() && (empty() || !front()->priority().enabled()))
+		reviveDeferred();
+}
+
+void Interface::registerSlot(InterfaceState& state) {
+	state.schedule_.slot = slots_.size();
+	slots_.push_back(&state);
+	priorities_.push_back(state.priority());
+}
+
+void Interface::releaseSlot(InterfaceState& state) {
+	// move the last entry into the released slot to keep the table dense
+	const size_t slot = state.schedule_.slot;
+	assert(slot < slots_.size() && slots_[slot] == &state);
+	slots_[slot] = slots_.back();
+	priorities_[slot] = priorities_.back();
+	slots_[slot]->schedule_.slot = slot;
+	slots_.pop_back();
+	priorities_.pop_back();
+}
+
+void Interface::updatePriority(InterfaceState* state, const InterfaceState::Priority& new_prio) {
 	const auto old_prio = state->priority();
+	// the estimated cost-to-go is a property of the state, evaluated once when it was added
+	const InterfaceState::Priority priority(new_prio.depth(), new_prio.cost(), new_prio.status(), old_prio.estimate());
 	if (priority == old_prio)
 		return;  // nothing to do
+	if (state->schedule_.deferred) {  // deferred states are neither sorted nor notified
+		state->schedule_.priority = priority;
+		return;
+	}
 
-	auto it = std::find(begin(), end(), state);  // find iterator to state
+	auto it = find(state);  // find iterator to state
 	assert(it != end());  // state should be part of this interface
 
-	state->priority_ = priority;  // update priority
+	state->schedule_.priority = priority;  // update priority
+	priorities_[state->schedule_.slot] = priority;
 	update(it);  // update position in ordered list
 
 	if (notify_) {
@@ -156,8 +561,12 @@ void Interface::updatePriority(InterfaceState* state, const InterfaceState::Prio
 		if (old_prio.status() == priority.status())
 			updated &= ~STATUS;
 
-		notify_(it, updated);  // notify callback
+		notify(it, updated);  // notify callback
 	}
+	if (priority.enabled() && !old_prio.enabled())  // re-enabled state might exceed the beam
+		trimToBeam();
+	else
+		reviveIfExhausted();
 }
 
 std::ostream& operator<<(std::ostream& os, const Interface& interface) {
@@ -167,6 +576,22 @@ std::ostream& operator<<(std::ostream& os, const Interface& interface) {
 		os << istate->priority() << "  ";
 	return os;
 }
+const char* toString(FailureCode code) {
+	static const char* names[NUM_FAILURE_CODES] = {
+		"none",
+		"unspecified",
+		"invalid input",
+		"collision",
+		"no IK solution",
+		"unreachable",
+		"constraints violated",
+		"planning failed",
+		"cost",
+	};
+	const size_t index = static_cast<size_t>(code);
+	return index < NUM_FAILURE_CODES ? names[index] : "unknown";
+}
+
 const char* InterfaceState::STATUS_COLOR_[] = {
 	"\033[32m",  // ENABLED - green
 	"\033[33m",  // ARMED - yellow
@@ -175,8 +600,10 @@ const char* InterfaceState::STATUS_COLOR_[] = {
 };
 std::ostream& operator<<(std::ostream& os, const InterfaceState::Priority& prio) {
 	// maps InterfaceState::Status values to output (color-changing) prefix
-	os << InterfaceState::colorForStatus(prio.status()) << prio.depth() << ":" << prio.cost()
-	   << InterfaceState::colorForStatus(3);
+	os << InterfaceState::colorForStatus(prio.status()) << prio.depth() << ":" << prio.cost();
+	if (prio.estimate() != 0.0)
+		os << "+" << prio.estimate();
+	os << InterfaceState::colorForStatus(3);
 	return os;
 }
 std::ostream& operator<<(std::ostream& os, Interface::Direction dir) {
@@ -184,6 +611,15 @@ std::ostream& operator<<(std::ostream& os, Interface::Direction dir) {
 	return os;
 }
 
+void SolutionBase::detach() {
+	if (start_)
+		start_->removeOutgoing(this);
+	if (end_)
+		end_->removeIncoming(this);
+	start_ = nullptr;
+	end_ = nullptr;
+}
+
 void SolutionBase::setCreator(Stage* creator) {
 	assert(creator_ == nullptr || creator_ == creator);  // creator must only set once
 	creator_ = creator;
@@ -193,8 +629,9 @@ void SolutionBase::setCost(double cost) {
 	cost_ = cost;
 }
 
-void SolutionBase::markAsFailure(const std::string& msg) {
+void SolutionBase::markAsFailure(FailureCode code, const std::string& msg) {
 	setCost(std::numeric_limits<double>::infinity());
+	failure_code_ = code;
 	if (!msg.empty()) {
 		std::stringstream ss;
 		ss << msg;
@@ -204,9 +641,36 @@ void SolutionBase::markAsFailure(const std::string& msg) {
 	}
 }
 
+void SolutionBase::markAsFailure(FailureCode code, LazyMessage msg) {
+	setCost(std::numeric_limits<double>::infinity());
+	failure_code_ = code;
+	if (lazy_comment_)
+		renderComment();  // keep the order of earlier messages
+	lazy_comment_ = std::move(msg);
+}
+
+void SolutionBase::renderComment() const {
+	LazyMessage render;
+	std::swap(render, lazy_comment_);
+	std::string msg = render();
+	if (msg.empty())
+		return;
+	if (!comment_.empty())
+		msg.append("\n").append(comment_);
+	comment_ = std::move(msg);
+}
+
 void SolutionBase::toMsg(moveit_task_constructor_msgs::Solution& msg, Introspection* introspection) const {
 	appendTo(msg, introspection);
-	start()->scene()->getPlanningSceneMsg(msg.start_scene);
+
+	auto start_scene = std::atomic_load(&start_scene_msg_);
+	if (!start_scene) {
+		auto scene = std::make_shared<moveit_msgs::PlanningScene>();
+		start()->scene()->getPlanningSceneMsg(*scene);
+		start_scene = scene;
+		std::atomic_store(&start_scene_msg_, start_scene);
+	}
+	msg.start_scene = *start_scene;
 }
 
 void SolutionBase::fillInfo(moveit_task_constructor_msgs::SolutionInfo& info, Introspection* introspection) const {
@@ -219,26 +683,212 @@ void SolutionBase::fillInfo(moveit_task_constructor_msgs::SolutionInfo& info, In
 	const auto& markers = this->markers();
 	info.markers.resize(markers.size());
 	std::copy(markers.begin(), markers.end(), info.markers.begin());
+	for (const auto& shared : shared_markers_)
+		info.markers.insert(info.markers.end(), shared->begin(), shared->end());
+}
+
+bool SolutionBase::validate(const planning_scene::PlanningScene& scene, double tolerance,
+                            utils::ThreadPool* pool) const {
+	if (isFailure() || !start())
+		return false;
+	if (!sameState(start()->scene()->getCurrentState(), scene.getCurrentState(), nullptr, tolerance))
+		return false;
+
+	std::vector<const SubTrajectory*> subs;
+	flatten(*this, subs);
+
+	// cheap checks first: sub trajectories need to connect seamlessly
+	std::vector<robot_trajectory::RobotTrajectoryConstPtr> trajectories;
+	trajectories.reserve(subs.size());
+	const InterfaceState* previous = start();
+	for (const SubTrajectory* sub : subs) {
+		if (!sub->start() || !sub->end())
+			return false;
+		const moveit::core::RobotState& start_state = sub->start()->scene()->getCurrentState();
+		if (sub->start() != previous &&
+		    !sameState(previous->scene()->getCurrentState(), start_state, nullptr, tolerance))
+			return false;
+		previous = sub->end();
+
+		auto trajectory = sub->trajectory();
+		if (!trajectory || trajectory->empty()) {
+			trajectories.emplace_back();
+			continue;
+		}
+		const moveit::core::JointModelGroup* group = trajectory->getGroup();
+		if (!sameState(trajectory->getFirstWayPoint(), start_state, group, tolerance) ||
+		    !sameState(trajectory->getLastWayPoint(), sub->end()->scene()->getCurrentState(), group, tolerance))
+			return false;
+		trajectories.push_back(std::move(trajectory));
+	}
+
+	// check all waypoints for validity, equivalent to PlanningScene::isPathValid() without constraints
+	std::atomic<bool> valid{ true };
+	std::vector<utils::ThreadPool::Job> jobs;
+	for (size_t i = 0; i < subs.size(); ++i) {
+		if (!trajectories[i])
+			continue;
+		jobs.emplace_back([&, i] {
+			if (!valid)
+				return;  // some other trajectory is invalid already
+			auto check_scene = checkScene(scene, *start()->scene(), *subs[i]->start()->scene());
+			const robot_trajectory::RobotTrajectory& trajectory = *trajectories[i];
+			const std::string& group = trajectory.getGroupName();
+			for (size_t w = 0, end = trajectory.getWayPointCount(); w != end && valid; ++w)
+				if (!check_scene->isStateValid(trajectory.getWayPoint(w), group))
+					valid = false;
+		});
+	}
+	if (jobs.size() < 2) {
+		for (const auto& job : jobs)
+			job();
+	} else if (pool)
+		pool->run(jobs);
+	else {
+		utils::ThreadPool local(utils::ThreadPool::shared(), jobs.size());  // limited by the workers of the shared pool
+		local.run(jobs);
+	}
+	return valid;
+}
+
+uint64_t SubTrajectory::nextRevision() {
+	static std::atomic<uint64_t> revision{ 0 };
+	return ++revision;
+}
+
+robot_trajectory::RobotTrajectoryConstPtr SubTrajectory::trajectory() const {
+	auto t = std::atomic_load(&trajectory_);
+	if (t || !compact_)
+		return t;
+
+	std::lock_guard<std::mutex> lock(compact_->mutex);
+	t = compact_->expanded.lock();
+	if (!t) {
+		t = compact_->trajectory->expand();
+		compact_->expanded = t;
+	}
+	return t;
+}
+
+void SubTrajectory::compact() {
+	auto t = std::atomic_load(&trajectory_);
+	if (!t || timingPending())
+		return;
+	auto compact = utils::CompactTrajectory::create(*t);
+	if (!compact)
+		return;
+
+	compact_ = std::make_shared<CompactStorage>();
+	compact_->trajectory = std::move(compact);
+	compact_->expanded = t;  // reuse the original trajectory while it's still referenced
+	std::atomic_store(&trajectory_, robot_trajectory::RobotTrajectoryConstPtr());
+	std::atomic_store(&msg_, std::shared_ptr<const moveit_task_constructor_msgs::SubTrajectory>());
+}
+
+void SubTrajectory::deferTiming(Timing timing) {
+	pending_timing_.reset();
+	if (timing) {
+		pending_timing_ = std::make_shared<PendingTiming>();
+		pending_timing_->timing = std::move(timing);
+	}
+}
+
+size_t SubTrajectory::memoryUsage() const {
+	size_t bytes = sizeof(SubTrajectory);
+	if (compact_)
+		bytes += compact_->trajectory->memoryUsage();
+	if (auto t = std::atomic_load(&trajectory_))
+		for (size_t i = 0; i < t->getWayPointCount(); ++i)
+			bytes += utils::memoryUsage(t->getWayPoint(i));
+	return bytes;
+}
+
+bool SubTrajectory::timingPending() const {
+	return pending_timing_ && !pending_timing_->done && trajectory();
+}
+
+void SubTrajectory::computeTiming() const {
+	if (!timingPending())
+		return;
+	PendingTiming& pending = *pending_timing_;
+	std::call_once(pending.once, [this, &pending] {
+		// time a copy, such that concurrent readers of trajectory() are not affected
+		auto timed = std::make_shared<robot_trajectory::RobotTrajectory>(*trajectory(), true);
+		pending.timing(*timed);
+		std::atomic_store(&trajectory_, robot_trajectory::RobotTrajectoryConstPtr(timed));
+		std::atomic_store(&msg_, std::shared_ptr<const moveit_task_constructor_msgs::SubTrajectory>());
+		pending.done = true;
+	});
 }
 
 void SubTrajectory::appendTo(moveit_task_constructor_msgs::Solution& msg, Introspection* introspection) const {
-	msg.sub_trajectory.emplace_back();
-	moveit_task_constructor_msgs::SubTrajectory& t = msg.sub_trajectory.back();
-	SolutionBase::fillInfo(t.info, introspection);
+	computeTiming();
+	// serialization of trajectory and scene is independent of introspection and thus cached
+	auto cached = std::atomic_load(&msg_);
+	if (!cached) {
+		auto t = std::make_shared<moveit_task_constructor_msgs::SubTrajectory>();
+		t->execution_info = creator()->trajectoryExecutionInfo();
 
-	t.execution_info = creator()->trajectoryExecutionInfo();
+		if (auto trajectory = this->trajectory())
+			trajectory->getRobotTrajectoryMsg(t->trajectory);
 
-	if (trajectory())
-		trajectory()->getRobotTrajectoryMsg(t.trajectory);
+		getSceneDiffMsg(t->scene_diff);
+
+		cached = t;
+		std::atomic_store(&msg_, cached);
+	}
+
+	msg.sub_trajectory.push_back(*cached);
+	SolutionBase::fillInfo(msg.sub_trajectory.back().info, introspection);
+}
 
-	if (this->end()->scene()->getParent() == this->start()->scene())
-		this->end()->scene()->getPlanningSceneDiffMsg(t.scene_diff);
+void SubTrajectory::getSceneDiffMsg(moveit_msgs::PlanningScene& msg) const {
+	const auto& start_scene = this->start()->scene();
+	const auto& end_scene = this->end()->scene();
+	if (end_scene->getParent() == start_scene)
+		end_scene->getPlanningSceneDiffMsg(msg);
 	else
-		this->end()->scene()->getPlanningSceneMsg(t.scene_diff);
+		getPlanningSceneDiffMsg(*start_scene, *end_scene, msg);
+}
+
+struct SolutionBase::CostMemo
+{
+	struct Entry
+	{
+		const CostTerm* term;
+		double cost;
+		std::string comment;
+	};
+	std::vector<Entry> entries;
+};
+
+template <typename T>
+double SolutionBase::memoizedCost(const CostTerm& f, std::string& comment) const {
+	// the memo is replaced atomically (copy on write), because solutions might be evaluated concurrently
+	auto memo = std::atomic_load(&cost_memo_);
+	if (memo) {
+		for (const auto& entry : memo->entries)
+			if (entry.term == &f) {
+				comment = entry.comment;
+				return entry.cost;
+			}
+	}
+
+	const double cost = f(static_cast<const T&>(*this), comment);
+	const double bound = CostTerm::bound();
+	if (std::isfinite(bound) && cost >= bound)
+		return cost;  // cost term might have stopped early
+	if (!std::isfinite(cost) && !CostTerm::explainFailures())
+		return cost;  // comment might be missing
+
+	auto updated = memo ? std::make_shared<CostMemo>(*memo) : std::make_shared<CostMemo>();
+	updated->entries.push_back(CostMemo::Entry{ &f, cost, comment });
+	std::atomic_store(&cost_memo_, std::shared_ptr<const CostMemo>(std::move(updated)));
+	return cost;
 }
 
 double SubTrajectory::computeCost(const CostTerm& f, std::string& comment) const {
-	return f(*this, comment);
+	return memoizedCost<SubTrajectory>(f, comment);
 }
 
 void SolutionSequence::push_back(const SolutionBase& solution) {
@@ -281,7 +931,7 @@ void SolutionSequence::appendTo(moveit_task_constructor_msgs::Solution& msg, Int
 }
 
 double SolutionSequence::computeCost(const CostTerm& f, std::string& comment) const {
-	return f(*this, comment);
+	return memoizedCost<SolutionSequence>(f, comment);
 }
 
 void WrappedSolution::appendTo(moveit_task_constructor_msgs::Solution& solution, Introspection* introspection) const {
@@ -295,7 +945,17 @@ void WrappedSolution::appendTo(moveit_task_constructor_msgs::Solution& solution,
 }
 
 double WrappedSolution::computeCost(const CostTerm& f, std::string& comment) const {
-	return f(*this, comment);
+	return memoizedCost<WrappedSolution>(f, comment);
+}
+
+void flatten(const SolutionBase& solution, std::vector<const SubTrajectory*>& trajectories) {
+	if (const auto* trajectory = dynamic_cast<const SubTrajectory*>(&solution))
+		trajectories.push_back(trajectory);
+	else if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution))
+		for (const SolutionBase* sub : sequence->solutions())
+			flatten(*sub, trajectories);
+	else if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(&solution))
+		flatten(*wrapped->wrapped(), trajectories);
 }
 
 }  // namespace task_constructor
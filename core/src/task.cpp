@@ -36,17 +36,32 @@
 /* Authors: Michael Goerner, Robert Haschke */
 
 #include <moveit/task_constructor/container_p.h>
+#include <moveit/task_constructor/cost_terms.h>
 #include <moveit/task_constructor/task_p.h>
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/solution_store.h>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/task_constructor/thread_local_scene.h>
+#include <moveit/task_constructor/reclaimer.h>
+#include <moveit/task_constructor/clients.h>
 #include <moveit_task_constructor_msgs/ExecuteTaskSolutionAction.h>
 
 #include <ros/ros.h>
-#include <actionlib/client/simple_action_client.h>
 
 #include <moveit/robot_model_loader/robot_model_loader.h>
 #include <moveit/planning_pipeline/planning_pipeline.h>
+#include <moveit/plan_execution/plan_execution.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/message_checks.h>
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
+#include <future>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <unordered_map>
 
 namespace {
 std::string rosNormalizeName(const std::string& name) {
@@ -66,6 +81,146 @@ std::string rosNormalizeName(const std::string& name) {
 	}
 	return n;
 }
+
+/** Process-wide cache of robot models, keyed on robot_description parameter and URDF/SRDF content
+ *
+ * Sharing the model between tasks also enables sharing of planning pipelines (PlannerCache is keyed on the model).
+ * Entries are kept alive until Task::clearRobotModelCache() is called. The cache is intentionally never destroyed:
+ * unloading kinematics plugins during static destruction is unsafe.
+ */
+struct RobotModelCache
+{
+	using Key = std::tuple<std::string, std::size_t, std::size_t>;  // resolved parameter, URDF hash, SRDF hash
+	std::map<Key, robot_model_loader::RobotModelLoaderPtr> cache_;
+	std::mutex mutex_;  // protecting cache_, kept locked while loading to not parse the same model twice
+
+	static RobotModelCache& instance() {
+		static RobotModelCache* cache = new RobotModelCache();
+		return *cache;
+	}
+
+	robot_model_loader::RobotModelLoaderPtr load(const std::string& robot_description) {
+		// identify the model by the content of its parameters, such that updated descriptions are reloaded
+		ros::NodeHandle nh("~");
+		std::string param, urdf, srdf;
+		if (!nh.searchParam(robot_description, param) || !nh.getParam(param, urdf))
+			return std::make_shared<robot_model_loader::RobotModelLoader>(robot_description);  // reports the error
+		nh.getParam(param + "_semantic", srdf);
+
+		std::hash<std::string> hash;
+		Key key(param, hash(urdf), hash(srdf));
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto& entry = cache_[key];
+		if (!entry || !entry->getModel())
+			entry = std::make_shared<robot_model_loader::RobotModelLoader>(robot_description);
+		return entry;
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex_);
+		cache_.clear();
+	}
+};
+
+using ExecutionFeedback = std::function<void(const moveit_task_constructor_msgs::ExecuteTaskSolutionFeedback&)>;
+
+moveit::core::MoveItErrorCode executeSolution(const moveit_task_constructor_msgs::Solution& solution,
+                                              const ExecutionFeedback& feedback = ExecutionFeedback()) {
+	using Client = actionlib::SimpleActionClient<moveit_task_constructor_msgs::ExecuteTaskSolutionAction>;
+	auto ac = moveit::task_constructor::utils::ClientRegistry::instance()
+	              .actionClient<moveit_task_constructor_msgs::ExecuteTaskSolutionAction>("execute_task_solution");
+	if (!ac->waitForServer(ros::Duration(0.5))) {
+		ROS_ERROR("Failed to connect to the 'execute_task_solution' action server");
+		return moveit::core::MoveItErrorCode::FAILURE;
+	}
+
+	moveit_task_constructor_msgs::ExecuteTaskSolutionGoal goal;
+	goal.solution = solution;
+
+	// the shared client tracks a single goal only
+	static std::mutex execution_mutex;
+	std::lock_guard<std::mutex> lock(execution_mutex);
+	if (feedback)
+		ac->sendGoal(goal, Client::SimpleDoneCallback(), Client::SimpleActiveCallback(),
+		             [&feedback](const moveit_task_constructor_msgs::ExecuteTaskSolutionFeedbackConstPtr& msg) {
+			             feedback(*msg);
+		             });
+	else
+		ac->sendGoal(goal);
+	ac->waitForResult();
+	return ac->getResult()->error_code;
+}
+
+// apply deferred time parameterizations of the best count solutions (all if 0), concurrently if possible
+void computeTiming(const moveit::task_constructor::ordered<moveit::task_constructor::SolutionBaseConstPtr>& solutions,
+                   size_t count, moveit::task_constructor::utils::ThreadPool* pool) {
+	using namespace moveit::task_constructor;
+	std::vector<const SubTrajectory*> trajectories;
+	size_t n = 0;
+	for (const auto& solution : solutions) {
+		if (solution->isFailure() || (count > 0 && n++ == count))
+			break;  // solutions are sorted by cost, failures last
+		flatten(*solution, trajectories);
+	}
+	trajectories.erase(std::remove_if(trajectories.begin(), trajectories.end(),
+	                                  [](const SubTrajectory* t) { return !t->timingPending(); }),
+	                   trajectories.end());
+	if (!pool || trajectories.size() < 2) {
+		for (const SubTrajectory* t : trajectories)
+			t->computeTiming();
+		return;
+	}
+	std::vector<utils::ThreadPool::Job> jobs;
+	jobs.reserve(trajectories.size());
+	for (const SubTrajectory* t : trajectories)
+		jobs.emplace_back([t] { t->computeTiming(); });  // computed once, even if shared by several solutions
+	pool->run(jobs);
+}
+
+using SolutionChain = std::vector<const moveit::task_constructor::SolutionBase*>;
+
+moveit_task_constructor_msgs::Solution toMsg(const SolutionChain& chain,
+                                             moveit::task_constructor::Introspection* introspection) {
+	moveit_task_constructor_msgs::Solution msg;
+	for (const auto* solution : chain)
+		solution->appendTo(msg, introspection);
+	chain.front()->start()->scene()->getPlanningSceneMsg(msg.start_scene);
+	return msg;
+}
+
+// cheapest chain of solutions through the first num_stages children (empty if there is none)
+SolutionChain bestPrefix(const moveit::task_constructor::ContainerBasePrivate::container_type& children,
+                         size_t num_stages) {
+	using moveit::task_constructor::InterfaceState;
+	std::unordered_map<const InterfaceState*, std::pair<double, SolutionChain>> best;  // chains ending at a state
+	auto child = children.begin();
+	for (size_t i = 0; i < num_stages; ++i, ++child) {
+		std::unordered_map<const InterfaceState*, std::pair<double, SolutionChain>> next;
+		for (const auto& solution : (*child)->solutions()) {
+			std::pair<double, SolutionChain> chain;
+			if (i > 0) {  // extend the best chain ending at the solution's start
+				auto it = best.find(solution->start());
+				if (it == best.end())
+					continue;
+				chain = it->second;
+			}
+			chain.first += solution->cost();
+			chain.second.push_back(solution.get());
+
+			auto inserted = next.emplace(solution->end(), chain);
+			if (!inserted.second && chain.first < inserted.first->second.first)
+				inserted.first->second = std::move(chain);
+		}
+		best = std::move(next);
+	}
+
+	// prefixes ending in a pruned state cannot be continued
+	for (auto it = best.begin(); it != best.end();)
+		it = it->first->priority().status() == InterfaceState::PRUNED ? best.erase(it) : std::next(it);
+	auto it = std::min_element(best.begin(), best.end(),
+	                           [](const auto& a, const auto& b) { return a.second.first < b.second.first; });
+	return it == best.end() ? SolutionChain() : it->second.second;
+}
 }  // namespace
 
 namespace moveit {
@@ -74,22 +229,237 @@ namespace task_constructor {
 TaskPrivate::TaskPrivate(Task* me, const std::string& ns)
   : WrapperBasePrivate(me, std::string()), ns_(rosNormalizeName(ns)), preempt_requested_(false) {}
 
+TaskPrivate::~TaskPrivate() = default;
+
 TaskPrivate& TaskPrivate::operator=(TaskPrivate&& other) {
 	this->WrapperBasePrivate::operator=(std::move(other));
 	ns_ = std::move(other.ns_);
 	robot_model_ = std::move(other.robot_model_);
 	robot_model_loader_ = std::move(other.robot_model_loader_);
 	task_cbs_ = std::move(other.task_cbs_);
+	solution_batch_cbs_ = std::move(other.solution_batch_cbs_);
+	async_solutions_ = other.async_solutions_;
+	deferred_costs_top_k_ = other.deferred_costs_top_k_;
+	time_slice_ = other.time_slice_;
+	memory_budget_ = other.memory_budget_;
+	setReclaimer(other.reclaimer());
+	profiler_ = std::move(other.profiler_);
+	scheduler_log_ = std::move(other.scheduler_log_);
 	// Ensure same introspection status, but keep the existing introspection instance,
 	// which stores this task pointer and includes it in its task_id_
 	static_cast<Task*>(me_)->enableIntrospection(static_cast<bool>(other.introspection_));
 	return *this;
 }
 
+namespace {
+// cost term of the solution's creator, if it has deferred terms
+const cost::Tiered* deferredCostTerm(const SolutionBase& s) {
+	if (!s.creator())
+		return nullptr;
+	const auto* tiered = dynamic_cast<const cost::Tiered*>(s.creator()->pimpl()->costTerm().get());
+	return tiered && tiered->hasDeferred() ? tiered : nullptr;
+}
+
+template <typename F>
+void forEachSubSolution(const SolutionBase& s, const F& f) {
+	if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&s)) {
+		for (const SolutionBase* sub : sequence->solutions())
+			f(*sub);
+	} else if (const auto* wrapped = dynamic_cast<const WrappedSolution*>(&s))
+		f(*wrapped->wrapped());
+}
+}  // namespace
+
+void TaskPrivate::evaluateDeferredCosts(size_t count) {
+	utils::ScopedTimer timer("cost", "evaluateDeferredCosts");
+	std::vector<const SolutionBase*> best;  // best solutions not evaluated yet
+	std::vector<const SolutionBase*> pending;  // their (sub) solutions with deferred cost terms
+	std::unordered_map<const SolutionBase*, size_t> pending_index;
+
+	const std::function<void(const SolutionBase&)> collect = [&](const SolutionBase& s) {
+		if (deferred_costs_.count(&s) || pending_index.count(&s))
+			return;
+		forEachSubSolution(s, collect);
+		if (deferredCostTerm(s)) {
+			pending_index.emplace(&s, pending.size());
+			pending.push_back(&s);
+		}
+	};
+
+	std::vector<double> costs;
+	std::vector<std::string> comments;
+	// add deferred costs of s and its sub solutions to their costs, return the total cost added to s
+	const std::function<double(const SolutionBase&)> apply = [&](const SolutionBase& s) {
+		auto it = deferred_costs_.find(&s);
+		if (it != deferred_costs_.end())
+			return it->second;
+
+		double delta = 0.0;
+		forEachSubSolution(s, [&](const SolutionBase& sub) { delta += apply(sub); });
+		std::string comment;
+		auto own = pending_index.find(&s);
+		if (own != pending_index.end()) {
+			delta += costs[own->second];
+			comment = std::move(comments[own->second]);
+		}
+
+		// planning is finished: nobody else accesses the stored solutions now
+		auto& solution = const_cast<SolutionBase&>(s);
+		if (!comment.empty())
+			solution.setComment(s.comment().empty() ? comment : s.comment() + " (" + comment + ")");
+		if (!std::isfinite(delta))
+			solution.markAsFailure(FailureCode::COST);
+		else if (delta != 0.0)
+			solution.setCost(s.cost() + delta);
+		deferred_costs_.emplace(&s, delta);
+		return delta;
+	};
+
+	while (true) {
+		best.clear();
+		size_t n = 0;
+		for (const auto& solution : stages()->solutions()) {
+			if (solution->isFailure() || (count > 0 && n++ == count))
+				break;  // solutions are sorted by cost, failures last
+			if (!deferred_costs_.count(solution.get()))
+				best.push_back(solution.get());
+		}
+		if (best.empty())
+			return;
+
+		pending.clear();
+		pending_index.clear();
+		for (const SolutionBase* solution : best)
+			collect(*solution);
+
+		// evaluate the expensive terms concurrently if possible
+		costs.assign(pending.size(), 0.0);
+		comments.assign(pending.size(), std::string());
+		const auto evaluate = [&](size_t i) {
+			costs[i] = deferredCostTerm(*pending[i])->deferredCost(*pending[i], comments[i]);
+		};
+		if (!thread_pool_ || pending.size() < 2) {
+			for (size_t i = 0; i < pending.size(); ++i)
+				evaluate(i);
+		} else {
+			std::vector<utils::ThreadPool::Job> jobs;
+			jobs.reserve(pending.size());
+			for (size_t i = 0; i < pending.size(); ++i)
+				jobs.emplace_back([&evaluate, i] { evaluate(i); });
+			thread_pool_->run(jobs);
+		}
+
+		for (const SolutionBase* solution : best)
+			apply(*solution);
+		children().front()->pimpl()->sortSolutions();
+		if (introspection_)  // cached messages carry the previous costs and comments
+			introspection_->invalidateSolutions();
+	}
+}
+
+namespace {
+// memory usage above this fraction of the budget triggers degradation
+constexpr double MEMORY_BUDGET_THRESHOLD = 0.9;
+// number of plan() iterations between checks of the memory budget, as measuring traverses all stages
+constexpr size_t MEMORY_CHECK_INTERVAL = 32;
+
+const char* description(TaskPrivate::MemoryDegradation step) {
+	switch (step) {
+		case TaskPrivate::DROP_FAILURES:
+			return "dropping failures";
+		case TaskPrivate::EVICT_STATES:
+			return "evicting disabled states";
+		case TaskPrivate::COMPACT_TRAJECTORIES:
+			return "compacting trajectories";
+		default:
+			return "";
+	}
+}
+}  // namespace
+
+bool TaskPrivate::enforceMemoryBudget() {
+	if (memory_budget_ == 0)
+		return true;
+	const auto threshold = static_cast<size_t>(MEMORY_BUDGET_THRESHOLD * memory_budget_);
+	size_t usage = static_cast<const Task*>(me())->memoryUsage().total();
+	// earlier steps are repeated: new failures or disabled states might have accumulated meanwhile
+	for (int step = DROP_FAILURES; step <= COMPACT_TRAJECTORIES && usage > threshold; ++step) {
+		const auto degradation = static_cast<MemoryDegradation>(step);
+		if (degradation > memory_degradation_)
+			ROS_WARN_STREAM_NAMED("Task", fmt::format("'{}': memory usage of {} bytes approaches budget of {} bytes, {}",
+			                                          me()->name(), usage, memory_budget_, description(degradation)));
+		degradeMemory(degradation);
+		usage = static_cast<const Task*>(me())->memoryUsage().total();
+	}
+	if (usage <= memory_budget_)
+		return true;
+	ROS_WARN_STREAM_NAMED("Task", fmt::format("'{}': memory usage of {} bytes exceeds budget of {} bytes after all "
+	                                          "degradation steps",
+	                                          me()->name(), usage, memory_budget_));
+	return false;
+}
+
+void TaskPrivate::degradeMemory(MemoryDegradation step) {
+	traverseStages(
+	    [step](Stage& stage, int /*depth*/) {
+		    StagePrivate* impl = stage.pimpl();
+		    switch (step) {
+			    case DROP_FAILURES:
+				    impl->dropFailures();
+				    break;
+			    case EVICT_STATES:
+				    // containers forward their interface states to their children
+				    if (dynamic_cast<ComputeBase*>(&stage))
+					    impl->evictDisabledStates(0.5);
+				    break;
+			    case COMPACT_TRAJECTORIES:
+				    impl->compactSolutions();
+				    break;
+			    default:
+				    break;
+		    }
+		    return true;
+	    },
+	    1, UINT_MAX);
+	if (step == DROP_FAILURES || step == EVICT_STATES) {
+		// states only used by dropped failures, e.g. containers' copies of evicted states, can be freed now
+		traverseStages(
+		    [](Stage& stage, int /*depth*/) {
+			    stage.pimpl()->releaseOrphanedStates();
+			    return true;
+		    },
+		    1, UINT_MAX);
+		// threads' clones of the freed states' scenes aren't accounted for, but would keep them alive
+		utils::ThreadLocalSceneView::releaseUnused();
+	}
+	memory_degradation_ = std::max(memory_degradation_, step);
+}
+
 const ContainerBase* TaskPrivate::stages() const {
 	return children().empty() ? nullptr : static_cast<ContainerBase*>(children().front().get());
 }
 
+void TaskPrivate::setupExecution(const ExecutionPolicy& policy) {
+	if (policy.threads == 1)
+		thread_pool_.reset();
+	else if (!thread_pool_ || (policy.threads != 0 && thread_pool_->size() != policy.threads))
+		thread_pool_ = std::make_unique<utils::ThreadPool>(utils::ThreadPool::shared(), policy.threads);
+	anytime_ = policy.scheduling == ExecutionPolicy::ANYTIME && !thread_pool_ &&
+	           static_cast<Task*>(me_)->numSolutions() == 0;
+	global_scheduling_ = policy.scheduling == ExecutionPolicy::GLOBAL && !thread_pool_;
+
+	auto* pool = thread_pool_.get();
+	setThreadPool(pool);
+	setAnytimeFlag(&anytime_);
+	traverseStages(
+	    [this, pool](Stage& stage, int /*depth*/) {
+		    stage.pimpl()->setThreadPool(pool);
+		    stage.pimpl()->setAnytimeFlag(&anytime_);
+		    return true;
+	    },
+	    1, UINT_MAX);
+}
+
 Task::Task(const std::string& ns, bool introspection, ContainerBase::pointer&& container)
   : WrapperBase(new TaskPrivate(this, ns), std::move(container)) {
 	setTimeout(std::numeric_limits<double>::max());
@@ -107,6 +477,9 @@ Task::Task(Task&& other)  // NOLINT(performance-noexcept-move-constructor)
 }
 
 Task& Task::operator=(Task&& other) {  // NOLINT(performance-noexcept-move-constructor)
+	// the asynchronous planning job refers to the task's implementation
+	if (pimpl()->planningAsync() || other.pimpl()->planningAsync())
+		throw std::logic_error("Task: cannot move a task while it is planning asynchronously");
 	clear();  // remove all stages of current task
 	*static_cast<TaskPrivate*>(pimpl_) = std::move(*static_cast<TaskPrivate*>(other.pimpl_));
 	return *this;
@@ -114,8 +487,18 @@ Task& Task::operator=(Task&& other) {  // NOLINT(performance-noexcept-move-const
 
 Task::~Task() {
 	auto impl = pimpl();
+	if (impl->async_planning_.valid()) {  // stop asynchronous planning still using this task
+		preempt();
+		impl->async_planning_.wait();
+	}
 	impl->introspection_.reset();  // stop introspection
 	clear();  // remove all stages
+	if (utils::Reclaimer* reclaimer = impl->reclaimer()) {
+		// the retired graph still references the model: release it afterwards, in order
+		reclaimer->retire(std::move(impl->robot_model_));
+		reclaimer->retire(std::move(impl->robot_model_loader_));
+		return;
+	}
 	impl->robot_model_.reset();
 	// only destroy loader after all references to the model are gone!
 	impl->robot_model_loader_.reset();
@@ -134,12 +517,16 @@ void Task::setRobotModel(const core::RobotModelConstPtr& robot_model) {
 
 void Task::loadRobotModel(const std::string& robot_description) {
 	auto impl = pimpl();
-	impl->robot_model_loader_ = std::make_shared<robot_model_loader::RobotModelLoader>(robot_description);
+	impl->robot_model_loader_ = RobotModelCache::instance().load(robot_description);
 	setRobotModel(impl->robot_model_loader_->getModel());
 	if (!impl->robot_model_)
 		throw Exception("Task failed to construct RobotModel");
 }
 
+void Task::clearRobotModelCache() {
+	RobotModelCache::instance().clear();
+}
+
 void Task::add(Stage::pointer&& stage) {
 	stages()->add(std::move(stage));
 }
@@ -176,6 +563,30 @@ Introspection& Task::introspection() {
 	return *impl->introspection_;
 }
 
+void Task::enableProfiling(bool enable) {
+	auto impl = pimpl();
+	if (enable && !impl->profiler_)
+		impl->profiler_ = std::make_shared<utils::Profiler>();
+	else if (!enable)
+		impl->profiler_.reset();
+}
+
+const utils::ProfilerPtr& Task::profiler() const {
+	return pimpl()->profiler_;
+}
+
+void Task::enableSchedulerLog(bool enable, size_t capacity) {
+	auto impl = pimpl();
+	if (enable && (!impl->scheduler_log_ || impl->scheduler_log_->capacity() != capacity))
+		impl->scheduler_log_ = std::make_shared<utils::SchedulerLog>(capacity);
+	else if (!enable)
+		impl->scheduler_log_.reset();
+}
+
+const utils::SchedulerLogPtr& Task::schedulerLog() const {
+	return pimpl()->scheduler_log_;
+}
+
 Task::TaskCallbackList::const_iterator Task::addTaskCallback(TaskCallback&& cb) {
 	auto impl = pimpl();
 	impl->task_cbs_.emplace_back(std::move(cb));
@@ -186,6 +597,48 @@ void Task::eraseTaskCallback(TaskCallbackList::const_iterator which) {
 	pimpl()->task_cbs_.erase(which);
 }
 
+Task::SolutionBatchCallbackList::const_iterator Task::addSolutionBatchCallback(SolutionBatchCallback&& cb) {
+	auto impl = pimpl();
+	impl->solution_batch_cbs_.emplace_back(std::move(cb));
+	return --(impl->solution_batch_cbs_.cend());
+}
+
+void Task::removeSolutionBatchCallback(SolutionBatchCallbackList::const_iterator which) {
+	pimpl()->solution_batch_cbs_.erase(which);
+}
+
+void Task::setAsyncSolutionCallbacks(size_t queue_size, size_t max_batch, SolutionDispatcher::Backpressure policy) {
+	pimpl()->async_solutions_ = { queue_size, max_batch, policy };
+}
+
+void TaskPrivate::deliverSolutions(const std::vector<SolutionBaseConstPtr>& solutions) const {
+	for (const SolutionBaseConstPtr& s : solutions)
+		for (const auto& cb : solution_cbs_)
+			cb(*s);
+	for (const auto& cb : solution_batch_cbs_)
+		cb(solutions);
+}
+
+void TaskPrivate::startSolutionDispatch() {
+	if (async_solutions_.queue_size == 0 || solution_dispatcher_)
+		return;
+	solution_dispatcher_ = std::make_unique<Task::SolutionDispatcher>(
+	    [this](const std::vector<SolutionBaseConstPtr>& solutions) { deliverSolutions(solutions); },
+	    async_solutions_.queue_size, async_solutions_.max_batch, async_solutions_.policy);
+}
+
+void TaskPrivate::finishSolutionDispatch(bool rethrow) {
+	if (!solution_dispatcher_)
+		return;
+	auto dispatcher = std::move(solution_dispatcher_);  // deliver further solutions synchronously
+	if (size_t dropped = dispatcher->dropped())
+		ROS_WARN_STREAM_NAMED("Task", fmt::format("'{}': {} solutions were not passed to callbacks (queue full)",
+		                                          name(), dropped));
+	if (rethrow)
+		dispatcher->flush();
+	// destruction delivers pending solutions in any case
+}
+
 void Task::reset() {
 	auto impl = pimpl();
 	// signal introspection, that this task was reset
@@ -193,6 +646,54 @@ void Task::reset() {
 		impl->introspection_->reset();
 
 	WrapperBase::reset();
+	impl->deferred_costs_.clear();
+	impl->memory_degradation_ = TaskPrivate::NO_DEGRADATION;
+	if (impl->scheduler_log_)  // states are released
+		impl->scheduler_log_->forgetStates();
+	// stages release their solutions and states: a new arena is created on next init()
+	impl->arena_.reset();
+	// idle threads of the pool would keep clones of the released scenes otherwise
+	utils::ThreadLocalSceneView::releaseUnused();
+}
+
+void Task::setDeferredCostsTopK(size_t k) {
+	pimpl()->deferred_costs_top_k_ = k;
+}
+
+size_t Task::deferredCostsTopK() const {
+	return pimpl()->deferred_costs_top_k_;
+}
+
+void Task::setTimeSlice(double seconds) {
+	pimpl()->time_slice_ = seconds;
+}
+
+double Task::timeSlice() const {
+	return pimpl()->time_slice_;
+}
+
+void Task::setMemoryBudget(size_t bytes) {
+	pimpl()->memory_budget_ = bytes;
+}
+
+size_t Task::memoryBudget() const {
+	return pimpl()->memory_budget_;
+}
+
+void Task::setBackgroundTeardown(bool enable) {
+	auto impl = pimpl();
+	utils::Reclaimer* reclaimer = enable ? &utils::Reclaimer::global() : nullptr;
+	impl->setReclaimer(reclaimer);
+	impl->traverseStages(
+	    [reclaimer](Stage& stage, int /*depth*/) {
+		    stage.pimpl()->setReclaimer(reclaimer);
+		    return true;
+	    },
+	    1, UINT_MAX);
+}
+
+bool Task::backgroundTeardown() const {
+	return pimpl()->reclaimer() != nullptr;
 }
 
 void Task::init() {
@@ -210,74 +711,525 @@ void Task::init() {
 	// task expects its wrapped child to push to both ends, this triggers interface resolution
 	stages()->pimpl()->resolveInterface(InterfaceFlags({ GENERATE }));
 
-	// provide introspection instance to all stages
+	if (!impl->arena_)
+		impl->arena_ = std::make_shared<utils::Arena>();
+	impl->setArena(impl->arena_);
+
+	// provide introspection instance, memory arena, and reclaimer to all stages,
+	// and configure interfaces created during interface resolution (cost-to-go estimators, beam width)
 	auto* introspection = impl->introspection_.get();
+	const utils::ArenaPtr& arena = impl->arena_;
+	auto* reclaimer = impl->reclaimer();
 	impl->traverseStages(
-	    [introspection](Stage& stage, int /*depth*/) {
+	    [introspection, &arena, reclaimer](Stage& stage, int /*depth*/) {
 		    stage.pimpl()->setIntrospection(introspection);
+		    stage.pimpl()->setArena(arena);
+		    stage.pimpl()->setReclaimer(reclaimer);
+		    stage.pimpl()->configureInterfaces();
 		    return true;
 	    },
 	    1, UINT_MAX);
+	// Stage::init() restored the configured compact_trajectories
+	if (impl->memory_degradation_ >= TaskPrivate::COMPACT_TRAJECTORIES)
+		impl->degradeMemory(TaskPrivate::COMPACT_TRAJECTORIES);
 
 	// first time publish task
 	if (introspection)
 		introspection->publishTaskDescription();
 }
 
+void Task::prewarm(const ExecutionPolicy& policy) {
+	pimpl()->setupExecution(policy);
+	init();
+}
+
 bool Task::canCompute() const {
 	return stages()->canCompute();
 }
 
-void Task::compute() {
+namespace {
+struct Job
+{
+	StagePrivate* stage;
+	InterfaceState::Priority priority;  // of the best partial solution extended by the stage
+	double mean_time;
+
+	bool operator<(const Job& other) const {
+		if (priority != other.priority)
+			return priority < other.priority;
+		return mean_time < other.mean_time;
+	}
+};
+
+// collect ready stages, descending into containers that don't schedule their children themselves
+void collectJobs(const StagePrivate& container, std::vector<Job>& jobs) {
+	const auto& parent = static_cast<const ContainerBasePrivate&>(container);
+	for (const Stage::pointer& child : parent.children()) {
+		StagePrivate* impl = child->pimpl();
+		if (!impl->canCompute() || parent.withheldByBudget(impl))
+			continue;
+		if ((dynamic_cast<const SerialContainer*>(child.get()) &&
+		     !dynamic_cast<const ConcurrentSerialContainer*>(child.get())) ||
+		    dynamic_cast<const Alternatives*>(child.get())) {
+			collectJobs(*impl, jobs);
+			continue;
+		}
+		Job job{ impl, InterfaceState::Priority(0, 0.0), impl->meanComputeTime() };
+		for (const InterfaceConstPtr& interface : { impl->starts(), impl->ends() })
+			if (interface && !interface->empty() && interface->front()->priority() < job.priority)
+				job.priority = interface->front()->priority();
+		jobs.push_back(job);
+	}
+}
+}  // namespace
+
+StagePrivate* TaskPrivate::nextGlobalJob() const {
+	const ContainerBase* root = stages();
+	if (!root || !root->pimpl()->canCompute())
+		return nullptr;
+	// The set of ready stages and their priorities change with every compute. Thus, the queue is rebuilt each time.
+	std::vector<Job> jobs;
+	if (dynamic_cast<const SerialContainer*>(root) || dynamic_cast<const Alternatives*>(root))
+		collectJobs(*root->pimpl(), jobs);
+	if (jobs.empty())
+		return nullptr;
+	return std::min_element(jobs.begin(), jobs.end())->stage;
+}
+
+void TaskPrivate::refillStages() {
+	traverseStages(
+	    [](Stage& stage, int /*depth*/) {
+		    stage.pimpl()->refill();
+		    return true;
+	    },
+	    1, UINT_MAX);
+}
+
+void TaskPrivate::computeNext() {
+	if (global_scheduling_) {
+		if (StagePrivate* job = nextGlobalJob()) {
+			job->runCompute();
+			return;
+		}
+	}
 	stages()->pimpl()->runCompute();
 }
 
-moveit::core::MoveItErrorCode Task::plan(size_t max_solutions) {
-	auto impl = pimpl();
-	init();
+bool TaskPrivate::prefixFinalized(size_t num_stages) const {
+	const auto& children = stages()->pimpl()->children();
+	const auto finished = [](const Stage::pointer& stage) {
+		const StagePrivate* impl = stage->pimpl();
+		return !impl->canCompute() && !impl->hasPendingCosts();
+	};
+	auto prefix_end = std::next(children.begin(), num_stages);
+	if (!std::all_of(children.begin(), prefix_end, finished))
+		return false;
+	// the following stages feed the prefix backwards as long as the receiving stages pull from their end interface
+	auto receiver = std::prev(prefix_end);
+	for (auto feeder = prefix_end; feeder != children.end() && (*receiver)->pimpl()->ends(); receiver = feeder++)
+		if (!finished(*feeder))
+			return false;
+	return true;
+}
 
-	// Print state and return success if there are solutions otherwise the input error_code
-	const auto success_or = [this](const int32_t error_code) -> int32_t {
-		if (numSolutions() > 0)
+void Task::compute() {
+	pimpl()->refillStages();
+	pimpl()->computeNext();
+}
+
+namespace {
+// asynchronous delivery of solutions to callbacks during planning, stopped when leaving the scope
+struct AsyncSolutionsScope
+{
+	TaskPrivate& impl;
+	AsyncSolutionsScope(TaskPrivate& impl) : impl(impl) { impl.startSolutionDispatch(); }
+	~AsyncSolutionsScope() { impl.finishSolutionDispatch(false); }
+	void flush() { impl.finishSolutionDispatch(); }
+};
+}  // namespace
+
+/** planning loop shared by Task::plan() and Task::planAndExecute()
+ *
+ * Activates profiling, scheduler log, cancellation, and the planning deadline in its scope:
+ * while (loop.next()) loop.iterate(); return loop.finish();
+ */
+class TaskPrivate::PlanningLoop
+{
+public:
+	PlanningLoop(Task& task, size_t max_solutions)
+	  : task_(task)
+	  , impl_(*task.pimpl())
+	  , max_solutions_(max_solutions)
+	  , available_time_(task.timeout())
+	  , start_time_(std::chrono::steady_clock::now())
+	  , profiling_(impl_.profiler_.get())
+	  , scheduler_log_(impl_.scheduler_log_.get())
+	  , timer_("task", task.name())
+	  , async_solutions_(impl_)
+	  // interrupt long-running computations of stages and solvers on timeout, too
+	  , cancellation_(impl_.cancellation_)
+	  , deadline_(impl_.cancellation_, available_time_)
+	  // resumable stages rather suspend their work at the deadline than being cancelled
+	  , planning_deadline_(available_time_) {}
+
+	/// whether to continue planning, otherwise remember why planning stopped
+	bool next() {
+		const bool enough = max_solutions_ > 0 && task_.numSolutions() >= max_solutions_;
+		if (!enough)
+			impl_.refillStages();
+		if (enough || !impl_.stages()->pimpl()->canCompute())
+			error_code_ = moveit::core::MoveItErrorCode::PLANNING_FAILED;
+		else if (impl_.preempt_requested_)
+			error_code_ = moveit::core::MoveItErrorCode::PREEMPTED;
+		else if (memory_exceeded_)  // continuing would allocate beyond the memory budget
+			error_code_ = moveit::core::MoveItErrorCode::FAILURE;
+		else if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time_).count() >=
+		         available_time_)
+			error_code_ = moveit::core::MoveItErrorCode::TIMED_OUT;
+		else
+			return true;
+		return false;
+	}
+
+	/// compute the task once and notify monitors
+	void iterate() {
+		if (impl_.scheduler_log_)
+			impl_.scheduler_log_->nextIteration();
+		{
+			utils::TimeSlice::Activation time_slice(impl_.timeSlice());
+			impl_.computeNext();
+		}
+		if (++iterations_ % MEMORY_CHECK_INTERVAL == 0 && !impl_.enforceMemoryBudget())
+			memory_exceeded_ = true;
+		if (impl_.progress_)
+			impl_.progress_->pushIteration(task_.solutions());
+		for (const auto& cb : impl_.task_cbs_)
+			cb(task_);
+		if (impl_.introspection_)
+			impl_.introspection_->updateTaskState();
+	}
+
+	/// finalize the solutions, returning success if there are any, otherwise the reason planning stopped
+	moveit::core::MoveItErrorCode finish() {
+		// store solutions still evaluated in the background
+		impl_.traverseStages(
+		    [](Stage& stage, int /*depth*/) {
+			    stage.pimpl()->applyEvaluatedCosts(true);
+			    return true;
+		    },
+		    1, UINT_MAX);
+		impl_.enforceMemoryBudget();  // stages keep their solutions and states beyond plan()
+		async_solutions_.flush();  // all solutions were passed to callbacks before returning
+		impl_.evaluateDeferredCosts(impl_.deferred_costs_top_k_);
+		computeTiming(task_.solutions(), max_solutions_, impl_.thread_pool_.get());
+		if (impl_.introspection_)  // publish final state, which might have been skipped by updateTaskState()
+			impl_.introspection_->publishTaskState();
+		if (task_.numSolutions() > 0)
 			return moveit::core::MoveItErrorCode::SUCCESS;
-		printState();
-		explainFailure();
-		return error_code;
-	};
-	impl->preempt_requested_ = false;
-	const double available_time = timeout();
-	const auto start_time = std::chrono::steady_clock::now();
-	while (canCompute() && (max_solutions == 0 || numSolutions() < max_solutions)) {
-		if (impl->preempt_requested_)
-			return success_or(moveit::core::MoveItErrorCode::PREEMPTED);
-		if (std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count() >= available_time)
-			return success_or(moveit::core::MoveItErrorCode::TIMED_OUT);
-		compute();
-		for (const auto& cb : impl->task_cbs_)
-			cb(*this);
-		if (impl->introspection_)
-			impl->introspection_->publishTaskState();
-	};
-	return success_or(moveit::core::MoveItErrorCode::PLANNING_FAILED);
+		task_.printState();
+		task_.explainFailure();
+		return error_code_;
+	}
+
+	/// reason planning stopped, or PREEMPTED if preempted meanwhile
+	moveit::core::MoveItErrorCode stopReason() const {
+		return impl_.preempt_requested_ ? moveit::core::MoveItErrorCode::PREEMPTED : error_code_;
+	}
+
+private:
+	Task& task_;
+	TaskPrivate& impl_;
+	const size_t max_solutions_;
+	const double available_time_;
+	const std::chrono::steady_clock::time_point start_time_;
+	utils::Profiler::Activation profiling_;
+	utils::SchedulerLog::Activation scheduler_log_;
+	utils::ScopedTimer timer_;
+	AsyncSolutionsScope async_solutions_;
+	utils::CancellationToken::Activation cancellation_;
+	utils::CancellationTimer deadline_;
+	utils::TimeSlice::Activation planning_deadline_;
+	size_t iterations_ = 0;
+	bool memory_exceeded_ = false;  // memory budget exceeded despite all degradation steps
+	moveit::core::MoveItErrorCode error_code_{ moveit::core::MoveItErrorCode::PLANNING_FAILED };
+};
+
+moveit::core::MoveItErrorCode Task::plan(size_t max_solutions, const ExecutionPolicy& policy) {
+	pimpl()->resetPreemption();
+	return pimpl()->plan(max_solutions, policy);
+}
+
+moveit::core::MoveItErrorCode TaskPrivate::plan(size_t max_solutions, const ExecutionPolicy& policy) {
+	Task& task = *static_cast<Task*>(me());
+	setupExecution(policy);  // before init(), which initializes subtrees concurrently on the pool
+	task.init();
+
+	PlanningLoop loop(task, max_solutions);
+	while (loop.next())
+		loop.iterate();
+	return loop.finish();
+}
+
+bool PlanningProgress::next(Event& event, double timeout) {
+	std::unique_lock<std::mutex> lock(mutex_);
+	const auto ready = [this] { return !events_.empty() || finished_; };
+	if (std::isinf(timeout))
+		cv_.wait(lock, ready);
+	else if (!cv_.wait_for(lock, std::chrono::duration<double>(std::max(timeout, 0.0)), ready))
+		return false;
+	if (events_.empty())
+		return false;  // finished
+	event = std::move(events_.front());
+	events_.pop_front();
+	return true;
+}
+
+bool PlanningProgress::finished() const {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return finished_;
+}
+
+void PlanningProgress::setNotify(std::function<void()> notify) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	notify_ = notify ? std::make_shared<const std::function<void()>>(std::move(notify)) : nullptr;
+}
+
+void PlanningProgress::pushSolution(const SolutionBaseConstPtr& solution,
+                                    const ordered<SolutionBaseConstPtr>& solutions) {
+	push(solution, solutions);
+}
+
+void PlanningProgress::pushIteration(const ordered<SolutionBaseConstPtr>& solutions) {
+	push(nullptr, solutions);
+}
+
+void PlanningProgress::push(SolutionBaseConstPtr solution, const ordered<SolutionBaseConstPtr>& solutions) {
+	Event event;
+	event.solution = std::move(solution);
+	event.solutions = solutions.size();
+	if (!solutions.empty())
+		event.best_cost = solutions.front()->cost();
+	event.elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count();
+	std::shared_ptr<const std::function<void()>> notify;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		if (!event.solution)
+			++iterations_;
+		event.iterations = iterations_;
+		if (!event.solution && !events_.empty() && !events_.back().solution)
+			events_.back() = std::move(event);  // coalesce statistics updates not consumed yet
+		else
+			events_.push_back(std::move(event));
+		notify = notify_;
+	}
+	cv_.notify_all();
+	if (notify)
+		(*notify)();
+}
+
+void PlanningProgress::finish() {
+	std::shared_ptr<const std::function<void()>> notify;
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		finished_ = true;
+		notify = std::move(notify_);  // release the callback, e.g. holding resources of an event loop
+	}
+	cv_.notify_all();
+	if (notify)
+		(*notify)();
+}
+
+AsyncPlanning Task::planAsync(size_t max_solutions, const ExecutionPolicy& policy) {
+	auto impl = pimpl();
+	if (impl->planningAsync())
+		throw std::logic_error("Task::planAsync(): task is still planning");
+	// reset before queueing the job, such that a preempt() while waiting for a free worker isn't lost
+	impl->resetPreemption();
+
+	auto promise = std::make_shared<std::promise<moveit::core::MoveItErrorCode>>();
+	AsyncPlanning planning{ promise->get_future().share(), std::make_shared<PlanningProgress>() };
+	impl->async_planning_ = planning.result;
+	impl->progress_ = planning.progress;
+	utils::ThreadPool::shared().post([impl, promise, max_solutions, policy] {
+		moveit::core::MoveItErrorCode result{ moveit::core::MoveItErrorCode::PREEMPTED };
+		std::exception_ptr error;
+		try {
+			if (!impl->preempt_requested_)
+				result = impl->plan(max_solutions, policy);
+		} catch (...) {
+			error = std::current_exception();
+		}
+		// detach the progress before the result is ready, such that a new planAsync() can start right away
+		const PlanningProgressPtr progress = std::move(impl->progress_);
+		progress->finish();
+		if (error)
+			promise->set_exception(error);
+		else
+			promise->set_value(result);
+	});
+	return planning;
 }
 
 void Task::preempt() {
 	pimpl()->preempt_requested_ = true;
+	pimpl()->cancellation_.cancel();
 }
 
 moveit::core::MoveItErrorCode Task::execute(const SolutionBase& s) {
-	actionlib::SimpleActionClient<moveit_task_constructor_msgs::ExecuteTaskSolutionAction> ac("execute_task_solution");
-	if (!ac.waitForServer(ros::Duration(0.5))) {
-		ROS_ERROR("Failed to connect to the 'execute_task_solution' action server");
-		return moveit::core::MoveItErrorCode::FAILURE;
+	moveit_task_constructor_msgs::Solution msg;
+	s.toMsg(msg, pimpl()->introspection_.get());
+	return executeSolution(msg);
+}
+
+moveit::core::MoveItErrorCode Task::execute(const moveit_task_constructor_msgs::Solution& msg) {
+	return executeSolution(msg);
+}
+
+moveit::core::MoveItErrorCode Task::execute(const SolutionBase& s, const ExecutionMonitor& monitor) {
+	moveit_task_constructor_msgs::Solution msg;
+	s.toMsg(msg, pimpl()->introspection_.get());
+	return execute(std::move(msg), monitor);
+}
+
+moveit::core::MoveItErrorCode Task::execute(moveit_task_constructor_msgs::Solution msg,
+                                            const ExecutionMonitor& monitor) {
+	auto& subs = msg.sub_trajectory;
+	// report feedback w.r.t. the full solution, while executing sub trajectories from offset
+	size_t offset = 0;
+	const ExecutionFeedback feedback = [&](const moveit_task_constructor_msgs::ExecuteTaskSolutionFeedback& fb) {
+		if (monitor.feedback)
+			monitor.feedback(offset + fb.sub_id, subs.size(), fb.progress);
+	};
+	if (!monitor.replan)
+		return executeSolution(msg, feedback);
+
+	moveit_task_constructor_msgs::Solution segment;
+	segment.task_id = msg.task_id;
+	for (; offset < subs.size(); ++offset) {
+		segment.sub_trajectory.assign(1, subs[offset]);
+
+		// replan the remainder in the background
+		std::future<bool> replanned;
+		moveit_task_constructor_msgs::Solution remaining;
+		if (offset + 1 < subs.size()) {
+			remaining.task_id = msg.task_id;
+			remaining.start_scene = msg.start_scene;
+			remaining.sub_trajectory.assign(subs.begin() + offset + 1, subs.end());
+			replanned = std::async(std::launch::async, monitor.replan, offset, std::ref(remaining));
+		}
+
+		auto result = executeSolution(segment, feedback);
+		const bool splice = replanned.valid() && replanned.get();  // always wait for replanning to finish
+		if (!result)
+			return result;
+		if (splice) {
+			subs.erase(subs.begin() + offset + 1, subs.end());
+			subs.insert(subs.end(), remaining.sub_trajectory.begin(), remaining.sub_trajectory.end());
+		}
 	}
+	return moveit::core::MoveItErrorCode::SUCCESS;
+}
 
-	moveit_task_constructor_msgs::ExecuteTaskSolutionGoal goal;
-	s.toMsg(goal.solution, pimpl()->introspection_.get());
+moveit::core::MoveItErrorCode Task::execute(const SolutionBase& s, const plan_execution::PlanExecutionPtr& executor) {
+	std::vector<const SubTrajectory*> trajectories;
+	flatten(s, trajectories);
+
+	plan_execution::ExecutableMotionPlan plan;
+	plan.planning_scene_monitor_ = executor->getPlanningSceneMonitor();
+	plan.planning_scene_ = s.start()->scene();
+	plan.plan_components_.reserve(trajectories.size());
+	for (size_t i = 0; i < trajectories.size(); ++i) {
+		const SubTrajectory* sub = trajectories[i];
+		plan.plan_components_.emplace_back();
+		plan_execution::ExecutableTrajectory& exec_traj = plan.plan_components_.back();
+		exec_traj.description_ = std::to_string(i + 1) + "/" + std::to_string(trajectories.size());
+
+		// plan execution requires a mutable trajectory: share the waypoints with a shallow copy
+		sub->computeTiming();
+		if (auto trajectory = sub->trajectory())
+			exec_traj.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(*trajectory);
+		else
+			exec_traj.trajectory_ = std::make_shared<robot_trajectory::RobotTrajectory>(getRobotModel(), nullptr);
+		exec_traj.controller_names_ = sub->creator()->trajectoryExecutionInfo().controller_names;
 
-	ac.sendGoal(goal);
-	ac.waitForResult();
-	return ac.getResult()->error_code;
+		exec_traj.effect_on_success_ = [sub, description = exec_traj.description_](
+		                                   const plan_execution::ExecutableMotionPlan* plan) {
+			// the robot state is the result of execution
+			moveit_msgs::PlanningScene scene_diff;
+			sub->getSceneDiffMsg(scene_diff);
+			scene_diff.robot_state.joint_state = sensor_msgs::JointState();
+			scene_diff.robot_state.multi_dof_joint_state = sensor_msgs::MultiDOFJointState();
+
+			if (!moveit::core::isEmpty(scene_diff)) {
+				ROS_DEBUG_STREAM_NAMED("Task", "apply effect of " << description);
+				return plan->planning_scene_monitor_->newPlanningSceneMessage(scene_diff);
+			}
+			return true;
+		};
+	}
+	return executor->executeAndMonitor(plan);
+}
+
+moveit::core::MoveItErrorCode Task::planAndExecute(size_t prefix_stages, const ExecutionPolicy& policy) {
+	auto impl = pimpl();
+	const auto& children = stages()->pimpl()->children();
+	if (!dynamic_cast<SerialContainer*>(stages()) || prefix_stages == 0 || prefix_stages >= children.size()) {
+		auto result = plan(1, policy);
+		return result ? execute(*solutions().front()) : result;
+	}
+
+	impl->resetPreemption();
+	impl->setupExecution(policy);  // before init(), which initializes subtrees concurrently on the pool
+	init();
+
+	SolutionChain prefix;  // executed prefix
+	std::future<moveit::core::MoveItErrorCode> prefix_execution;
+
+	// best full solution continuing the executed prefix
+	const auto find_continuation = [&]() -> const SolutionSequence* {
+		for (const auto& solution : solutions()) {
+			auto* sequence = dynamic_cast<const SolutionSequence*>(solution.get());
+			if (sequence && std::equal(prefix.begin(), prefix.end(), sequence->solutions().begin()))
+				return sequence;
+		}
+		return nullptr;
+	};
+
+	TaskPrivate::PlanningLoop loop(*this, 0);
+	while (loop.next()) {
+		loop.iterate();
+		if (prefix.empty()) {
+			if (!impl->prefixFinalized(prefix_stages))
+				continue;
+			prefix = bestPrefix(children, prefix_stages);
+			if (prefix.empty())
+				break;  // prefix failed
+			prefix_execution = std::async(std::launch::async, executeSolution, toMsg(prefix, impl->introspection_.get()),
+			                              ExecutionFeedback());
+		} else if (find_continuation())
+			break;
+	}
+	const auto planned = loop.finish();
+
+	if (prefix.empty())  // planning finished before the prefix was finalized (or it failed)
+		return planned ? execute(*solutions().front()) : planned;
+
+	// evaluation of deferred costs might have reordered the solutions
+	const SolutionSequence* continuation = find_continuation();
+	auto result = prefix_execution.get();
+	if (!result)
+		return result;
+	if (!continuation) {
+		if (planned) {  // solutions exist, but none of them continues the prefix
+			printState();
+			explainFailure();
+		}
+		return loop.stopReason();
+	}
+
+	const auto& subsolutions = continuation->solutions();
+	return executeSolution(toMsg(SolutionChain(std::next(subsolutions.begin(), prefix_stages), subsolutions.end()),
+	                             impl->introspection_.get()));
 }
 
 void Task::publishAllSolutions(bool wait) {
@@ -285,11 +1237,34 @@ void Task::publishAllSolutions(bool wait) {
 	pimpl()->introspection_->publishAllSolutions(wait);
 }
 
+void Task::saveSolutions(const std::string& path) const {
+	auto impl = pimpl();
+	utils::SolutionStoreWriter writer(path);
+	for (const auto& s : solutions()) {
+		moveit_task_constructor_msgs::Solution msg;
+		s->toMsg(msg, impl->introspection_.get());
+		writer.add(msg, s->cost(), impl->introspection_ ? impl->introspection_->solutionId(*s) : writer.size());
+	}
+	writer.close();
+}
+
 void Task::onNewSolution(const SolutionBase& s) {
 	// no need to call WrapperBase::onNewSolution!
 	auto impl = pimpl();
+	impl->anytime_ = false;  // first solution found: switch to cost improvement
+	if (impl->progress_)
+		impl->progress_->pushSolution(s.shared_from_this(), solutions());
+	if (impl->solution_dispatcher_) {
+		impl->solution_dispatcher_->push(s.shared_from_this());
+		return;
+	}
 	for (const auto& cb : impl->solution_cbs_)
 		cb(s);
+	if (!impl->solution_batch_cbs_.empty()) {
+		const std::vector<SolutionBaseConstPtr> batch{ s.shared_from_this() };
+		for (const auto& cb : impl->solution_batch_cbs_)
+			cb(batch);
+	}
 }
 
 ContainerBase* Task::stages() {
@@ -305,6 +1280,25 @@ PropertyMap& Task::properties() {
 	return wrapped()->properties();
 }
 
+TaskTemplate::TaskTemplate(BuildFunction build, const moveit::core::RobotModelConstPtr& robot_model,
+                           const std::string& ns, bool introspection)
+  : build_(std::move(build)), ns_(ns), introspection_(introspection), prototype_(ns, introspection) {
+	if (robot_model)
+		prototype_.setRobotModel(robot_model);
+	build_(prototype_);
+	prototype_.init();
+}
+
+Task TaskTemplate::instantiate(const std::string& name, const std::map<std::string, boost::any>& properties) const {
+	Task task(ns_, introspection_);
+	task.setRobotModel(getRobotModel());
+	build_(task);
+	task.setName(name);
+	for (const auto& property : properties)
+		task.setProperty(property.first, property.second);
+	return task;
+}
+
 void Task::setProperty(const std::string& name, const boost::any& value) {
 	// forward to wrapped() stage
 	wrapped()->setProperty(name, value);
@@ -315,6 +1309,16 @@ const core::RobotModelConstPtr& Task::getRobotModel() const {
 	return impl->robot_model_;
 }
 
+Stage::MemoryUsage Task::memoryUsage() const {
+	MemoryUsage usage = Stage::memoryUsage();  // the task's wrapped solutions
+	// includes the root container, each stage's usage is only recomputed if its states or solutions changed
+	stages()->traverseRecursively([&usage](const Stage& stage, unsigned int /*depth*/) {
+		usage += stage.memoryUsage();
+		return true;
+	});
+	return usage;
+}
+
 void Task::printState(std::ostream& os) const {
 	os << *stages();
 }
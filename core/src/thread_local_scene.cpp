@@ -0,0 +1,138 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: per-thread read-only clones of planning scenes for concurrent collision queries */
+
+#include <moveit/task_constructor/thread_local_scene.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+struct Clone
+{
+	const planning_scene::PlanningScene* source;
+	planning_scene::PlanningSceneConstPtr scene;  // diff of source, keeping it alive
+};
+
+// whether nobody but the clone refers to its scene anymore
+bool unused(const Clone& c) {
+	return c.scene->getParent().use_count() == 1;
+}
+
+// clones of a thread, most recently used first
+struct ThreadCache;
+struct Registry
+{
+	std::mutex mutex;
+	std::set<ThreadCache*> caches;
+};
+// leaked, such that caches of threads exiting during static destruction can still deregister
+Registry& registry() {
+	static Registry* instance = new Registry();
+	return *instance;
+}
+
+struct ThreadCache
+{
+	std::mutex mutex;  // only contended by releaseUnused() from other threads
+	std::vector<Clone> clones;
+
+	ThreadCache() {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		registry().caches.insert(this);
+	}
+	~ThreadCache() {
+		std::lock_guard<std::mutex> lock(registry().mutex);
+		registry().caches.erase(this);
+	}
+};
+thread_local ThreadCache CACHE;
+}  // namespace
+
+constexpr size_t ThreadLocalSceneView::CACHE_SIZE;
+
+ThreadLocalSceneView::ThreadLocalSceneView(planning_scene::PlanningSceneConstPtr scene) : scene_(std::move(scene)) {}
+
+const planning_scene::PlanningScene& ThreadLocalSceneView::local() const {
+	if (!scene_)
+		throw std::logic_error("ThreadLocalSceneView: no scene to view");
+
+	std::lock_guard<std::mutex> lock(CACHE.mutex);
+	std::vector<Clone>& clones = CACHE.clones;
+	// release clones of scenes nobody else refers to anymore
+	clones.erase(std::remove_if(clones.begin(), clones.end(),
+	                            [this](const Clone& c) { return c.source != scene_.get() && unused(c); }),
+	             clones.end());
+
+	auto it = std::find_if(clones.begin(), clones.end(), [this](const Clone& c) { return c.source == scene_.get(); });
+	if (it == clones.end()) {
+		if (clones.size() >= CACHE_SIZE)
+			clones.pop_back();
+		clones.insert(clones.begin(), Clone{ scene_.get(), scene_->diff() });
+	} else if (it != clones.begin())
+		std::rotate(clones.begin(), it, it + 1);
+	return *clones.front().scene;
+}
+
+void ThreadLocalSceneView::clearThreadCache() {
+	std::lock_guard<std::mutex> lock(CACHE.mutex);
+	CACHE.clones.clear();
+}
+
+void ThreadLocalSceneView::releaseUnused() {
+	std::lock_guard<std::mutex> registry_lock(registry().mutex);
+	for (ThreadCache* cache : registry().caches) {
+		std::lock_guard<std::mutex> lock(cache->mutex);
+		cache->clones.erase(std::remove_if(cache->clones.begin(), cache->clones.end(), unused), cache->clones.end());
+	}
+}
+
+size_t ThreadLocalSceneView::threadCacheSize() {
+	std::lock_guard<std::mutex> lock(CACHE.mutex);
+	return CACHE.clones.size();
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,263 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include <moveit/task_constructor/thread_pool.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+// pin a thread to the given CPUs, ignoring CPUs not available on this machine
+void pin(std::thread& thread, const std::vector<unsigned int>& cpus) {
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (unsigned int cpu : cpus)
+		if (cpu < CPU_SETSIZE)
+			CPU_SET(cpu, &set);
+	// best effort: the workers remain unpinned if the mask is rejected (e.g. by a restricting cgroup)
+	pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+	(void)thread;
+	(void)cpus;
+#endif
+}
+}  // namespace
+
+ThreadPool::ThreadPool(size_t num_threads, const std::vector<unsigned int>& cpus) {
+	if (num_threads == 0)
+		num_threads = std::max(1u, std::thread::hardware_concurrency());
+	size_ = num_threads;
+	// the thread calling run() participates in processing jobs
+	workers_.reserve(num_threads - 1);
+	for (size_t i = 1; i < num_threads; ++i) {
+		workers_.emplace_back(&ThreadPool::work, this);
+		if (!cpus.empty())
+			pin(workers_.back(), cpus);
+	}
+}
+
+ThreadPool::ThreadPool(ThreadPool& executor, size_t num_threads)
+  : executor_(&executor.executor()), size_(num_threads == 0 ? executor.size() : num_threads) {}
+
+ThreadPool::~ThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	for (auto& worker : workers_)
+		worker.join();
+}
+
+void ThreadPool::work() {
+	while (true) {
+		Job job;
+		{
+			std::unique_lock<std::mutex> lock(mutex_);
+			++idle_;
+			cv_.wait(lock, [this] { return stop_ || queued_ > 0; });
+			--idle_;
+			if (queued_ == 0)
+				return;  // stop_ requested
+			for (auto& queue : queues_)
+				if (!queue.empty()) {
+					job = std::move(queue.front());
+					queue.pop_front();
+					break;
+				}
+			--queued_;
+		}
+		job();
+	}
+}
+
+void ThreadPool::enqueue(Job&& job, Priority priority) {
+	queues_[priority].push_back(std::move(job));
+	++queued_;
+}
+
+namespace {
+// state shared between all threads processing a batch
+struct Batch
+{
+	explicit Batch(const std::vector<ThreadPool::Job>& jobs) : jobs(&jobs), size(jobs.size()) {}
+
+	// process jobs until all of them are claimed
+	void process() {
+		for (size_t i; (i = next++) < size;) {
+			std::exception_ptr e;
+			try {
+				(*jobs)[i]();
+			} catch (...) {
+				e = std::current_exception();
+			}
+			std::lock_guard<std::mutex> lock(mutex);
+			if (e && !error)
+				error = e;
+			if (++done == size)
+				cv.notify_all();
+		}
+	}
+
+	const std::vector<ThreadPool::Job>* jobs;  // only accessed while jobs are left
+	const size_t size;
+	std::atomic<size_t> next{ 0 };
+	size_t done = 0;
+	std::exception_ptr error;
+	std::mutex mutex;
+	std::condition_variable cv;
+};
+}  // namespace
+
+void ThreadPool::run(const std::vector<Job>& jobs, Priority priority) {
+	if (jobs.empty())
+		return;
+
+	auto batch = std::make_shared<Batch>(jobs);
+	// recruit workers to help with the batch, up to the size of a view minus the helpers of its other batches
+	// If they start late, i.e. after the batch was finished, they find no more jobs to claim.
+	ThreadPool& pool = executor();
+	const size_t wanted = std::min({ size_ - 1, pool.workers_.size(), jobs.size() - 1 });
+	size_t helpers = 0;
+	for (size_t busy = helpers_->load(); wanted > 0;) {
+		helpers = std::min(wanted, size_ - 1 - std::min(busy, size_ - 1));
+		if (helpers == 0 || helpers_->compare_exchange_weak(busy, busy + helpers))
+			break;
+	}
+	if (helpers > 0) {
+		{
+			std::lock_guard<std::mutex> lock(pool.mutex_);
+			for (size_t i = 0; i < helpers; ++i)
+				pool.enqueue(
+				    [batch, busy = helpers_] {
+					    batch->process();
+					    --*busy;
+				    },
+				    priority);
+		}
+		pool.cv_.notify_all();
+	}
+	batch->process();
+
+	std::unique_lock<std::mutex> lock(batch->mutex);
+	batch->cv.wait(lock, [&batch] { return batch->done == batch->size; });
+	if (batch->error)
+		std::rethrow_exception(batch->error);
+}
+
+void ThreadPool::post(Job job, Priority priority) {
+	auto guarded = [job = std::move(job)] {
+		try {
+			job();
+		} catch (...) {  // NOLINT(bugprone-empty-catch): discarded, see post()
+		}
+	};
+	ThreadPool& pool = executor();
+	if (pool.workers_.empty()) {
+		guarded();
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex_);
+		pool.enqueue(std::move(guarded), priority);
+	}
+	pool.cv_.notify_one();
+}
+
+bool ThreadPool::tryPost(Job job, Priority priority) {
+	ThreadPool& pool = executor();
+	{
+		std::lock_guard<std::mutex> lock(pool.mutex_);
+		if (pool.idle_ <= pool.queued_)  // all idle workers have a job to pick up already
+			return false;
+	}
+	// An idle worker might pick up another job meanwhile. But that one would have found a worker anyway.
+	post(std::move(job), priority);
+	return true;
+}
+
+namespace {
+// configuration of the shared pool, fixed on its creation
+struct SharedConfig
+{
+	std::mutex mutex;
+	size_t num_workers = 0;
+	std::vector<unsigned int> cpus;
+	bool created = false;
+};
+
+SharedConfig& sharedConfig() {
+	static SharedConfig config;
+	return config;
+}
+}  // namespace
+
+ThreadPool& ThreadPool::shared() {
+	static const std::unique_ptr<ThreadPool> pool = [] {
+		SharedConfig& config = sharedConfig();
+		std::lock_guard<std::mutex> lock(config.mutex);
+		config.created = true;
+		// the calling thread doesn't take part in posted jobs: add one to get the requested number of workers
+		const size_t workers = config.num_workers ? config.num_workers :
+		                                            std::max(1u, std::thread::hardware_concurrency());
+		return std::make_unique<ThreadPool>(workers + 1, config.cpus);
+	}();
+	return *pool;
+}
+
+bool ThreadPool::configureShared(size_t num_workers, const std::vector<unsigned int>& cpus) {
+	SharedConfig& config = sharedConfig();
+	std::lock_guard<std::mutex> lock(config.mutex);
+	if (config.created)
+		return false;
+	config.num_workers = num_workers;
+	config.cpus = cpus;
+	return true;
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
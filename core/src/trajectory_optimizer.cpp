@@ -0,0 +1,322 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+/* Desc:    Post-optimization of the free-space segments of planned solutions
+ */
+
+#include <moveit/task_constructor/trajectory_optimizer.h>
+#include <moveit/task_constructor/collision_checker.h>
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/thread_pool.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/trajectory_processing/time_optimal_trajectory_generation.h>
+
+#include <cmath>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace moveit {
+namespace task_constructor {
+namespace utils {
+
+namespace {
+/* velocity and acceleration scaling a trajectory was timed with, estimated from its peak ratios w.r.t. the joint
+ * limits of its group (1.0 if unknown) */
+std::pair<double, double> estimateScaling(const robot_trajectory::RobotTrajectory& trajectory) {
+	constexpr double MIN_SCALING = 0.01;
+	double velocity = 0.0, acceleration = 0.0;
+	const moveit::core::RobotModel& model = *trajectory.getRobotModel();
+	const std::vector<int>& indices = trajectory.getGroup() ? trajectory.getGroup()->getVariableIndexList() :
+	                                                          std::vector<int>();
+	for (size_t k = 0; k < trajectory.getWayPointCount(); ++k) {
+		const moveit::core::RobotState& waypoint = trajectory.getWayPoint(k);
+		for (int index : indices) {
+			const moveit::core::VariableBounds& bounds = model.getVariableBounds(model.getVariableNames()[index]);
+			if (waypoint.hasVelocities() && bounds.velocity_bounded_ && bounds.max_velocity_ > 0.0)
+				velocity = std::max(velocity, std::abs(waypoint.getVariableVelocity(index)) / bounds.max_velocity_);
+			if (waypoint.hasAccelerations() && bounds.acceleration_bounded_ && bounds.max_acceleration_ > 0.0)
+				acceleration =
+				    std::max(acceleration, std::abs(waypoint.getVariableAcceleration(index)) / bounds.max_acceleration_);
+		}
+	}
+	auto clamp = [](double scaling) { return scaling > 0.0 ? std::min(1.0, std::max(MIN_SCALING, scaling)) : 1.0; };
+	return { clamp(velocity), clamp(acceleration) };
+}
+
+// copy of a solution, keeping the solutions it refers to alive
+template <typename T>
+struct OwningCopy : T
+{
+	template <typename... Args>
+	OwningCopy(std::vector<SolutionBaseConstPtr>&& owned, Args&&... args)
+	  : T(std::forward<Args>(args)...), owned_(std::move(owned)) {}
+
+	std::vector<SolutionBaseConstPtr> owned_;
+};
+
+using Replacements = std::unordered_map<const SubTrajectory*, robot_trajectory::RobotTrajectoryPtr>;
+
+// copy of solution with replaced trajectories, nullptr if none of its SubTrajectories is replaced
+SolutionBaseConstPtr replace(const SolutionBase& solution, const Replacements& replacements) {
+	if (const auto* sub = dynamic_cast<const SubTrajectory*>(&solution)) {
+		auto it = replacements.find(sub);
+		if (it == replacements.end())
+			return nullptr;
+		auto copy = std::make_shared<SubTrajectory>(*sub);
+		copy->setTrajectory(it->second);
+		return copy;
+	}
+	if (const auto* sequence = dynamic_cast<const SolutionSequence*>(&solution)) {
+		std::vector<SolutionBaseConstPtr> owned;
+		SolutionSequence::container_type subsolutions;
+		bool replaced = false;
+		for (const SolutionBase* sub : sequence->solutions()) {
+			SolutionBaseConstPtr copy = replace(*sub, replacements);
+			replaced |= copy != nullptr;
+			owned.push_back(copy ? copy : sub->shared_from_this());
+			subsolutions.push_back(owned.back().get());
+		}
+		if (!replaced)
+			return nullptr;
+		return std::make_shared<OwningCopy<SolutionSequence>>(std::move(owned), *sequence, std::move(subsolutions));
+	}
+	if (const auto* wrapper = dynamic_cast<const WrappedSolution*>(&solution)) {
+		SolutionBaseConstPtr copy = replace(*wrapper->wrapped(), replacements);
+		if (!copy)
+			return nullptr;
+		const SolutionBase* wrapped = copy.get();
+		return std::make_shared<OwningCopy<WrappedSolution>>(std::vector<SolutionBaseConstPtr>{ std::move(copy) },
+		                                                     *wrapper, wrapped);
+	}
+	return nullptr;
+}
+}  // namespace
+
+TrajectoryOptimizer::TrajectoryOptimizer(const Options& options)
+  : options_(options)
+  , filter_([](const SubTrajectory& s) { return dynamic_cast<const Connecting*>(s.creator()) != nullptr; }) {}
+
+TrajectoryOptimizer::Timing TrajectoryOptimizer::timing(const robot_trajectory::RobotTrajectory& original) const {
+	if (timing_)
+		return timing_;
+	const std::pair<double, double> scaling = estimateScaling(original);
+	return [scaling](robot_trajectory::RobotTrajectory& t) {
+		trajectory_processing::TimeOptimalTrajectoryGeneration().computeTimeStamps(t, scaling.first, scaling.second);
+	};
+}
+
+robot_trajectory::RobotTrajectoryPtr TrajectoryOptimizer::shortcut(const planning_scene::PlanningScene& scene,
+                                                                   const robot_trajectory::RobotTrajectory& trajectory,
+                                                                   const Timing& timing, unsigned int seed) const {
+	if (trajectory.getWayPointCount() < 3 || options_.shortcut_iterations == 0)
+		return nullptr;
+
+	const moveit::core::JointModelGroup* jmg = trajectory.getGroup();
+	const std::string group = jmg ? jmg->getName() : "";
+	auto distance = [jmg](const moveit::core::RobotState& a, const moveit::core::RobotState& b) {
+		return jmg ? a.distance(b, jmg) : a.distance(b);
+	};
+	std::vector<moveit::core::RobotStatePtr> path;
+	path.reserve(trajectory.getWayPointCount());
+	for (size_t i = 0; i < trajectory.getWayPointCount(); ++i)
+		path.push_back(std::make_shared<moveit::core::RobotState>(trajectory.getWayPoint(i)));
+
+	const CollisionCheckerPtr checker = collisionChecker();
+	std::mt19937 engine(seed);
+	std::vector<moveit::core::RobotStatePtr> segment;
+	std::vector<const moveit::core::RobotState*> batch;
+	bool shortened = false;
+	for (size_t iteration = 0; iteration < options_.shortcut_iterations && path.size() > 2; ++iteration) {
+		std::uniform_int_distribution<size_t> pick(0, path.size() - 1);
+		size_t i = pick(engine), j = pick(engine);
+		if (i > j)
+			std::swap(i, j);
+		if (j - i < 2)
+			continue;
+
+		double current = 0.0;
+		for (size_t k = i; k < j; ++k)
+			current += distance(*path[k], *path[k + 1]);
+		const double direct = distance(*path[i], *path[j]);
+		if (direct >= current - 1e-6)
+			continue;  // nothing to gain
+
+		// interpolate i -> j with max_step resolution and check all intermediate waypoints
+		const size_t steps = std::max<size_t>(1, std::ceil(direct / options_.max_step));
+		segment.clear();
+		batch.clear();
+		for (size_t k = 1; k < steps; ++k) {
+			auto state = std::make_shared<moveit::core::RobotState>(*path[i]);
+			if (jmg)
+				path[i]->interpolate(*path[j], static_cast<double>(k) / steps, *state, jmg);
+			else
+				path[i]->interpolate(*path[j], static_cast<double>(k) / steps, *state);
+			state->update();
+			batch.push_back(state.get());
+			segment.push_back(std::move(state));
+		}
+		if (checker->firstCollision(scene, group, batch) < batch.size())
+			continue;
+
+		path.erase(path.begin() + i + 1, path.begin() + j);
+		path.insert(path.begin() + i + 1, segment.begin(), segment.end());
+		shortened = true;
+	}
+	if (!shortened)
+		return nullptr;
+
+	auto result = std::make_shared<robot_trajectory::RobotTrajectory>(trajectory.getRobotModel(), jmg);
+	for (const moveit::core::RobotStatePtr& state : path)
+		result->addSuffixWayPoint(state, 0.0);
+	timing(*result);
+	return result;
+}
+
+robot_trajectory::RobotTrajectoryPtr TrajectoryOptimizer::optimize(const planning_scene::PlanningSceneConstPtr& scene,
+                                                                   const planning_scene::PlanningSceneConstPtr& goal,
+                                                                   const robot_trajectory::RobotTrajectory& trajectory,
+                                                                   unsigned int seed) const {
+	double baseline;
+	return optimize(scene, goal, trajectory, seed, baseline);
+}
+
+robot_trajectory::RobotTrajectoryPtr TrajectoryOptimizer::optimize(const planning_scene::PlanningSceneConstPtr& scene,
+                                                                   const planning_scene::PlanningSceneConstPtr& goal,
+                                                                   const robot_trajectory::RobotTrajectory& trajectory,
+                                                                   unsigned int seed, double& baseline) const {
+	ScopedTimer timer("optimization", "TrajectoryOptimizer");
+	const Timing timing = this->timing(trajectory);
+	{  // compare against the original path timed the same way
+		robot_trajectory::RobotTrajectory original(trajectory, true);
+		timing(original);
+		baseline = original.getDuration();
+	}
+	robot_trajectory::RobotTrajectoryPtr best = shortcut(*scene, trajectory, timing, seed);
+	double best_duration = best ? best->getDuration() : baseline;
+
+	if (planner_ && goal && trajectory.getGroup()) {
+		robot_trajectory::RobotTrajectoryPtr replanned;
+		bool success;
+		{
+			std::lock_guard<std::mutex> lock(planner_mutex_);
+			success = planner_->plan(scene, goal, trajectory.getGroup(), options_.replan_timeout, replanned);
+		}
+		if (success && replanned) {
+			if (robot_trajectory::RobotTrajectoryPtr shortened = shortcut(*scene, *replanned, timing, seed + 1))
+				replanned = shortened;
+			else
+				timing(*replanned);
+			if (replanned->getDuration() < best_duration) {
+				best = replanned;
+				best_duration = replanned->getDuration();
+			}
+		}
+	}
+	if (best && !(best_duration < baseline))
+		return nullptr;  // e.g. shortcuts didn't pay off after retiming
+	return best;
+}
+
+TrajectoryOptimizer::Result TrajectoryOptimizer::optimize(const std::vector<SolutionBaseConstPtr>& solutions) const {
+	// collect the selected segments, each only once
+	std::vector<const SubTrajectory*> segments, subs;
+	std::unordered_set<const SubTrajectory*> seen;
+	for (const SolutionBaseConstPtr& solution : solutions) {
+		subs.clear();
+		flatten(*solution, subs);
+		for (const SubTrajectory* sub : subs)
+			if (sub->trajectory() && sub->start() && sub->end() && filter_(*sub) && seen.insert(sub).second)
+				segments.push_back(sub);
+	}
+
+	std::vector<robot_trajectory::RobotTrajectoryPtr> optimized(segments.size());
+	std::vector<double> before(segments.size());
+	std::vector<ThreadPool::Job> jobs;
+	jobs.reserve(segments.size());
+	for (size_t i = 0; i < segments.size(); ++i)
+		jobs.emplace_back([this, &segments, &optimized, &before, i] {
+			const SubTrajectory& sub = *segments[i];
+			sub.computeTiming();  // estimate the scaling from the timed trajectory
+			optimized[i] =
+			    optimize(sub.start()->scene(), sub.end()->scene(), *sub.trajectory(), options_.seed + i, before[i]);
+		});
+	if (options_.threads != 1 && jobs.size() > 1)
+		ThreadPool(ThreadPool::shared(), options_.threads).run(jobs);
+	else
+		for (const ThreadPool::Job& job : jobs)
+			job();
+
+	Result result;
+	result.segments = segments.size();
+	Replacements replacements;
+	for (size_t i = 0; i < segments.size(); ++i) {
+		result.duration_before += before[i];
+		if (!optimized[i]) {
+			result.duration_after += before[i];
+			continue;
+		}
+		replacements.emplace(segments[i], optimized[i]);
+		result.duration_after += optimized[i]->getDuration();
+		++result.improved;
+	}
+	// stored solutions are shared (and their costs and messages cached): copy instead of modifying them
+	result.solutions.reserve(solutions.size());
+	for (const SolutionBaseConstPtr& solution : solutions) {
+		SolutionBaseConstPtr copy = replacements.empty() ? nullptr : replace(*solution, replacements);
+		result.solutions.push_back(copy ? copy : solution);
+	}
+	return result;
+}
+
+TrajectoryOptimizer::Result TrajectoryOptimizer::optimize(const SolutionBase& solution) const {
+	std::vector<SolutionBaseConstPtr> solutions{ solution.shared_from_this() };
+	return optimize(solutions);
+}
+
+TrajectoryOptimizer::Result TrajectoryOptimizer::optimize(const Task& task, size_t k) const {
+	std::vector<SolutionBaseConstPtr> best;
+	for (const SolutionBaseConstPtr& solution : task.solutions()) {
+		if (solution->isFailure() || (k > 0 && best.size() >= k))
+			break;  // solutions are sorted by cost, failures last
+		best.push_back(solution);
+	}
+	return optimize(best);
+}
+
+}  // namespace utils
+}  // namespace task_constructor
+}  // namespace moveit
@@ -40,13 +40,104 @@
 #include <moveit/robot_state/robot_state.h>
 #include <moveit/planning_scene/planning_scene.h>
 
+#include <moveit/task_constructor/hashing.h>
 #include <moveit/task_constructor/properties.h>
 #include <moveit/task_constructor/storage.h>
 
+#include <boost/functional/hash.hpp>
+#include <atomic>
+#include <cmath>
+
 namespace moveit {
 namespace task_constructor {
 namespace utils {
 
+namespace {
+std::atomic<unsigned int> MAX_SCENE_DEPTH{ 8 };
+}  // namespace
+
+unsigned int maxSceneDepth() {
+	return MAX_SCENE_DEPTH;
+}
+
+void setMaxSceneDepth(unsigned int depth) {
+	MAX_SCENE_DEPTH = depth;
+}
+
+unsigned int sceneDepth(const planning_scene::PlanningScene& scene) {
+	unsigned int depth = 0;
+	for (const planning_scene::PlanningScene* parent = scene.getParent().get(); parent;
+	     parent = parent->getParent().get())
+		++depth;
+	return depth;
+}
+
+planning_scene::PlanningSceneConstPtr flattenScene(const planning_scene::PlanningSceneConstPtr& scene) {
+	const unsigned int max_depth = MAX_SCENE_DEPTH;
+	if (max_depth == 0 || sceneDepth(*scene) < max_depth)
+		return scene;
+	return planning_scene::PlanningScene::clone(scene);
+}
+
+planning_scene::PlanningScenePtr diffScene(const planning_scene::PlanningSceneConstPtr& scene) {
+	return flattenScene(scene)->diff();
+}
+
+size_t memoryUsage(const moveit::core::RobotState& state) {
+	const moveit::core::RobotModel& model = *state.getRobotModel();
+	// positions, velocities, and accelerations, as well as joint, link, and collision body transforms
+	size_t bytes = sizeof(moveit::core::RobotState) + 3 * sizeof(double) * model.getVariableCount() +
+	               sizeof(Eigen::Isometry3d) * (model.getJointModelCount() + 2 * model.getLinkModelCount());
+	std::vector<const moveit::core::AttachedBody*> bodies;
+	state.getAttachedBodies(bodies);
+	for (const moveit::core::AttachedBody* body : bodies)
+		bytes += sizeof(moveit::core::AttachedBody) + 2 * sizeof(Eigen::Isometry3d) * body->getShapes().size();
+	return bytes;
+}
+
+size_t memoryUsage(const planning_scene::PlanningScene& scene) {
+	size_t bytes = sizeof(planning_scene::PlanningScene) + memoryUsage(scene.getCurrentState());
+	if (!scene.getParent())
+		for (const auto& object : *scene.getWorld())
+			bytes += sizeof(collision_detection::World::Object) +
+			         2 * sizeof(Eigen::Isometry3d) * object.second->shapes_.size();  // local and global poses
+	return bytes;
+}
+
+size_t worldHash(const planning_scene::PlanningScene& scene, double resolution, bool include_objects) {
+	size_t seed = 0;
+	for (const auto& object : *scene.getWorld()) {
+		if (!include_objects)
+			break;
+		boost::hash_combine(seed, objectHash(object.second, resolution));
+	}
+	std::vector<const moveit::core::AttachedBody*> bodies;
+	scene.getCurrentState().getAttachedBodies(bodies);
+	for (const moveit::core::AttachedBody* body : bodies) {
+		boost::hash_combine(seed, body->getName());
+		boost::hash_combine(seed, body->getAttachedLinkName());
+	}
+	return seed;
+}
+
+size_t acmHash(const planning_scene::PlanningScene& scene) {
+	const collision_detection::AllowedCollisionMatrix& acm = scene.getAllowedCollisionMatrix();
+	std::vector<std::string> names;
+	acm.getAllEntryNames(names);
+	size_t seed = 0;
+	for (size_t i = 0; i < names.size(); ++i)
+		for (size_t j = i; j < names.size(); ++j) {
+			collision_detection::AllowedCollision::Type type;
+			if (acm.getEntry(names[i], names[j], type)) {
+				boost::hash_combine(seed, i);
+				boost::hash_combine(seed, j);
+				boost::hash_combine(seed, static_cast<int>(type));
+			}
+		}
+	boost::hash_combine(seed, names);
+	return seed;
+}
+
 bool getRobotTipForFrame(const Property& property, const planning_scene::PlanningScene& scene,
                          const moveit::core::JointModelGroup* jmg, SolutionBase& solution,
                          const moveit::core::LinkModel*& robot_link, Eigen::Isometry3d& tip_in_global_frame) {
@@ -63,7 +154,7 @@ bool getRobotTipForFrame(const Property& property, const planning_scene::Plannin
 	if (property.value().empty()) {  // property undefined
 		robot_link = get_tip();
 		if (!robot_link) {
-			solution.markAsFailure("missing ik_frame");
+			solution.markAsFailure(FailureCode::INVALID_INPUT, "missing ik_frame");
 			return false;
 		}
 		tip_in_global_frame = scene.getCurrentState().getGlobalLinkTransform(robot_link);
@@ -77,13 +168,13 @@ bool getRobotTipForFrame(const Property& property, const planning_scene::Plannin
 		if (!found && !ik_pose_msg.header.frame_id.empty()) {
 			std::stringstream ss;
 			ss << "ik_frame specified in unknown frame '" << ik_pose_msg.header.frame_id << "'";
-			solution.markAsFailure(ss.str());
+			solution.markAsFailure(FailureCode::INVALID_INPUT, ss.str());
 			return false;
 		}
 		if (!robot_link)
 			robot_link = get_tip();
 		if (!robot_link) {
-			solution.markAsFailure("ik_frame doesn't specify a link frame");
+			solution.markAsFailure(FailureCode::INVALID_INPUT, "ik_frame doesn't specify a link frame");
 			return false;
 		} else if (!found) {  // use robot link's frame as reference by default
 			ref_frame = scene.getCurrentState().getGlobalLinkTransform(robot_link);
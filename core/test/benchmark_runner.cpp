@@ -0,0 +1,349 @@
+#include "benchmark_runner.h"
+
+#include <moveit/task_constructor/stages/recorder.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+namespace moveit {
+namespace task_constructor {
+
+namespace {
+struct StageStats
+{
+	std::string name;
+	unsigned int depth;
+	double compute_time;
+	size_t solutions;
+	size_t failures;
+};
+
+struct RunStats
+{
+	double time_to_first = std::numeric_limits<double>::quiet_NaN();
+	double time_to_k = std::numeric_limits<double>::quiet_NaN();
+	double planning_time = 0.0;
+	size_t solutions = 0;
+	bool success = false;
+	long peak_rss_kb = -1;  // peak resident set size of the process during the run (-1: unknown)
+	long rss_growth_kb = -1;  // part of the peak exceeding the resident set size at the start of the run
+	std::vector<StageStats> stages;
+};
+
+// a replayed input: indices of the recorded start and end states (none if not used)
+struct InputStats
+{
+	static constexpr size_t NONE = std::numeric_limits<size_t>::max();
+	size_t start;
+	size_t end;
+	double compute_time = 0.0;
+	double planning_time = 0.0;
+	size_t solutions = 0;
+	size_t failures = 0;
+};
+constexpr size_t InputStats::NONE;
+
+// generator providing a recorded state to the replayed stage
+class ReplayState : public Generator
+{
+public:
+	ReplayState(const std::string& name, const InterfaceState& state) : Generator(name), state_(state) {}
+
+	void reset() override {
+		Generator::reset();
+		spawned_ = false;
+	}
+	bool canCompute() const override { return !spawned_; }
+	void compute() override {
+		spawned_ = true;
+		spawn(InterfaceState(state_), 0.0);
+	}
+
+private:
+	InterfaceState state_;
+	bool spawned_ = false;
+};
+
+InterfaceState restoreState(const moveit_task_constructor_msgs::StageInput& input,
+                            const moveit::core::RobotModelConstPtr& robot_model) {
+	auto scene = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	scene->setPlanningSceneMsg(input.scene);
+	InterfaceState state(scene);
+	for (const auto& property : input.properties) {
+		boost::any value = stages::Recorder::decode(property);
+		if (!value.empty())
+			state.properties().set(property.name, value);
+	}
+	return state;
+}
+
+void restoreProperties(Stage& stage, const std::vector<moveit_task_constructor_msgs::RecordedProperty>& properties) {
+	PropertyMap& props = stage.properties();
+	for (const auto& property : properties) {
+		boost::any value = stages::Recorder::decode(property);
+		if (value.empty() || !props.hasProperty(property.name))
+			continue;  // keep the configuration of make_stage
+		try {
+			props.set(property.name, value);
+		} catch (const Property::error& e) {
+			std::cerr << "replay: cannot restore property '" << property.name << "': " << e.what() << std::endl;
+		}
+	}
+}
+
+std::string quoted(const std::string& s) {
+	std::string result = "\"";
+	for (char c : s) {
+		if (c == '"' || c == '\\')
+			result.push_back('\\');
+		if (static_cast<unsigned char>(c) < 0x20) {
+			char buffer[8];
+			std::snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+			result.append(buffer);
+		} else
+			result.push_back(c);
+	}
+	return result.append("\"");
+}
+
+// JSON has no representation for NaN: use null
+std::string number(double value) {
+	if (std::isnan(value))
+		return "null";
+	std::ostringstream os;
+	os << std::setprecision(9) << value;
+	return os.str();
+}
+
+// peak resident set size of the process since its start, in kilobytes
+long peakRSS() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss;  // kilobytes on Linux
+}
+
+// read a memory field of /proc/self/status (in kilobytes), -1 if not available
+long procStatus(const char* field) {
+	std::ifstream status("/proc/self/status");
+	const size_t len = std::strlen(field);
+	std::string line;
+	while (std::getline(status, line))
+		if (line.compare(0, len, field) == 0 && line.size() > len && line[len] == ':')
+			return std::strtol(line.c_str() + len + 1, nullptr, 10);
+	return -1;
+}
+
+// reset the peak resident set size reported as VmHWM (Linux >= 4.0), returning false if not supported
+bool resetPeakRSS() {
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+	clear_refs.close();
+	return bool(clear_refs);
+}
+
+// JSON number of a memory size, null if unknown
+std::string memory(long kb) {
+	return kb < 0 ? "null" : std::to_string(kb);
+}
+
+bool parseArg(const char* arg, const char* name, std::string& value) {
+	const size_t len = std::strlen(name);
+	if (std::strncmp(arg, name, len) != 0 || arg[len] != '=')
+		return false;
+	value = arg + len + 1;
+	return true;
+}
+}  // namespace
+
+BenchmarkOptions& BenchmarkOptions::instance() {
+	static BenchmarkOptions options;
+	return options;
+}
+
+BenchmarkOptions& BenchmarkOptions::fromArgs(int& argc, char** argv) {
+	BenchmarkOptions& options = instance();
+	int kept = 1;
+	for (int i = 1; i < argc; ++i) {
+		std::string value;
+		if (parseArg(argv[i], "--benchmark-runs", value))
+			options.runs = std::stoul(value);
+		else if (parseArg(argv[i], "--benchmark-k", value))
+			options.k = std::stoul(value);
+		else if (parseArg(argv[i], "--benchmark-seed", value))
+			options.seed = std::stoul(value);
+		else if (parseArg(argv[i], "--benchmark-output", value))
+			options.output = value;
+		else
+			argv[kept++] = argv[i];
+	}
+	argc = kept;
+	return options;
+}
+
+bool runBenchmark(const std::string& name, Task& task, const BenchmarkOptions& options) {
+	using clock = std::chrono::steady_clock;
+	std::vector<RunStats> runs;
+	for (size_t run = 0; run < options.runs; ++run) {
+		RunStats stats;
+		std::srand(options.seed + run);
+
+		clock::time_point start;
+		size_t found = 0;
+		auto cb = task.addSolutionCallback([&](const SolutionBase& /*s*/) {
+			const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+			if (++found == 1)
+				stats.time_to_first = elapsed;
+			if (found == options.k)
+				stats.time_to_k = elapsed;
+		});
+		// measure the memory peak of this run rather than of the whole process, if supported
+		const long start_rss = procStatus("VmRSS");
+		const bool peak_reset = start_rss >= 0 && resetPeakRSS();
+		start = clock::now();
+		try {
+			stats.success = bool(task.plan());
+		} catch (const InitStageException& e) {
+			std::cerr << "benchmark " << name << ": planning failed with exception" << std::endl << e;
+		}
+		stats.planning_time = std::chrono::duration<double>(clock::now() - start).count();
+		task.removeSolutionCallback(cb);
+
+		stats.solutions = task.numSolutions();
+		if (peak_reset) {
+			stats.peak_rss_kb = procStatus("VmHWM");
+			if (stats.peak_rss_kb >= 0)
+				stats.rss_growth_kb = std::max(0l, stats.peak_rss_kb - start_rss);
+		}
+		task.stages()->traverseRecursively([&stats](const Stage& stage, unsigned int depth) {
+			stats.stages.push_back(StageStats{ stage.name(), depth, stage.getTotalComputeTime(),
+			                                   stage.solutions().size(), stage.failures().size() });
+			return true;
+		});
+		runs.push_back(std::move(stats));
+	}
+
+	std::ostringstream os;
+	os << "{\n  \"name\": " << quoted(name) << ",\n  \"seed\": " << options.seed << ",\n  \"k\": " << options.k
+	   << ",\n  \"peak_rss_kb\": " << peakRSS() << ",\n  \"runs\": [";
+	for (size_t i = 0; i < runs.size(); ++i) {
+		const RunStats& r = runs[i];
+		os << (i ? "," : "") << "\n    {\"success\": " << (r.success ? "true" : "false")
+		   << ", \"solutions\": " << r.solutions << ", \"planning_time\": " << number(r.planning_time)
+		   << ", \"time_to_first_solution\": " << number(r.time_to_first)
+		   << ", \"time_to_k_solutions\": " << number(r.time_to_k) << ", \"peak_rss_kb\": " << memory(r.peak_rss_kb)
+		   << ", \"rss_growth_kb\": " << memory(r.rss_growth_kb)
+		   << ",\n     \"stages\": [";
+		for (size_t j = 0; j < r.stages.size(); ++j) {
+			const StageStats& s = r.stages[j];
+			os << (j ? "," : "") << "\n       {\"name\": " << quoted(s.name) << ", \"depth\": " << s.depth
+			   << ", \"compute_time\": " << number(s.compute_time) << ", \"solutions\": " << s.solutions
+			   << ", \"failures\": " << s.failures << "}";
+		}
+		os << "]}";
+	}
+	os << "\n  ]\n}\n";
+
+	if (options.output.empty() || options.output == "-") {
+		std::cout << os.str();
+		return true;
+	}
+	std::ofstream file(options.output);
+	file << os.str();
+	return bool(file);
+}
+
+bool runReplay(const std::string& name, const moveit_task_constructor_msgs::StageTrace& trace,
+               const std::function<Stage::pointer()>& make_stage, const moveit::core::RobotModelConstPtr& robot_model,
+               const BenchmarkOptions& options) {
+	using clock = std::chrono::steady_clock;
+	using moveit_task_constructor_msgs::StageInput;
+	std::vector<InterfaceState> starts, ends;
+	for (const auto& input : trace.inputs)
+		(input.interface == StageInput::START ? starts : ends).push_back(restoreState(input, robot_model));
+
+	std::vector<std::pair<size_t, size_t>> inputs;
+	if (starts.empty() && ends.empty())  // generator
+		inputs.emplace_back(InputStats::NONE, InputStats::NONE);
+	for (size_t i = 0; i < starts.size(); ++i) {
+		if (ends.empty())
+			inputs.emplace_back(i, InputStats::NONE);
+		for (size_t j = 0; j < ends.size(); ++j)
+			inputs.emplace_back(i, j);
+	}
+	if (starts.empty())
+		for (size_t j = 0; j < ends.size(); ++j)
+			inputs.emplace_back(InputStats::NONE, j);
+
+	std::vector<std::vector<InputStats>> runs;
+	for (size_t run = 0; run < options.runs; ++run) {
+		std::vector<InputStats> stats;
+		std::srand(options.seed + run);
+		for (const auto& input : inputs) {
+			Task task(trace.stage, false);
+			task.setRobotModel(robot_model);
+			if (input.first != InputStats::NONE)
+				task.add(std::make_unique<ReplayState>("start", starts[input.first]));
+			Stage::pointer stage = make_stage();
+			restoreProperties(*stage, trace.properties);
+			const Stage* replayed = stage.get();
+			task.add(std::move(stage));
+			if (input.second != InputStats::NONE)
+				task.add(std::make_unique<ReplayState>("end", ends[input.second]));
+
+			InputStats s{ input.first, input.second };
+			const clock::time_point start = clock::now();
+			try {
+				task.plan();
+			} catch (const InitStageException& e) {
+				std::cerr << "replay " << name << ": planning failed with exception" << std::endl << e;
+			}
+			s.planning_time = std::chrono::duration<double>(clock::now() - start).count();
+			s.compute_time = replayed->getTotalComputeTime();
+			s.solutions = replayed->solutions().size();
+			s.failures = replayed->failures().size();
+			stats.push_back(s);
+		}
+		runs.push_back(std::move(stats));
+	}
+
+	auto index = [](size_t i) { return i == InputStats::NONE ? std::string("null") : std::to_string(i); };
+	std::ostringstream os;
+	os << "{\n  \"name\": " << quoted(name) << ",\n  \"stage\": " << quoted(trace.stage)
+	   << ",\n  \"seed\": " << options.seed << ",\n  \"starts\": " << starts.size() << ",\n  \"ends\": " << ends.size()
+	   << ",\n  \"peak_rss_kb\": " << peakRSS() << ",\n  \"runs\": [";
+	for (size_t i = 0; i < runs.size(); ++i) {
+		os << (i ? "," : "") << "\n    {\"inputs\": [";
+		for (size_t j = 0; j < runs[i].size(); ++j) {
+			const InputStats& s = runs[i][j];
+			os << (j ? "," : "") << "\n       {\"start\": " << index(s.start) << ", \"end\": " << index(s.end)
+			   << ", \"compute_time\": " << number(s.compute_time) << ", \"planning_time\": " << number(s.planning_time)
+			   << ", \"solutions\": " << s.solutions << ", \"failures\": " << s.failures << "}";
+		}
+		os << "]}";
+	}
+	os << "\n  ]\n}\n";
+
+	if (options.output.empty() || options.output == "-") {
+		std::cout << os.str();
+		return true;
+	}
+	std::ofstream file(options.output);
+	file << os.str();
+	return bool(file);
+}
+
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <moveit/task_constructor/task.h>
+#include <moveit_task_constructor_msgs/StageTrace.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+namespace moveit {
+namespace task_constructor {
+
+/* Options of the end-to-end benchmark mode of the pick_* integration tests
+ *
+ * Enabled by passing --benchmark-runs=N on the command line, optionally with
+ * --benchmark-k=K (solutions to wait for), --benchmark-seed=S, and --benchmark-output=FILE (JSON, default: stdout).
+ */
+struct BenchmarkOptions
+{
+	size_t runs = 0;  // 0: disabled
+	size_t k = 10;
+	uint32_t seed = 42;
+	std::string output;
+
+	/// parse (and remove) --benchmark-* arguments from argv
+	static BenchmarkOptions& fromArgs(int& argc, char** argv);
+	/// options parsed last
+	static BenchmarkOptions& instance();
+};
+
+/** Plan task repeatedly, reporting timing, memory, and per-stage compute time as JSON
+ *
+ * Each run seeds std::rand() with the configured seed to make sampling-based components reproducible
+ * as far as they rely on it. Returns false if writing the report failed.
+ *
+ * Memory is measured for the whole process: the top-level peak_rss_kb is the peak since the process started.
+ * Where Linux allows resetting the peak (/proc/self/clear_refs), each run reports its own peak_rss_kb as well as
+ * rss_growth_kb, the part of the peak exceeding the resident memory at the start of the run, which is attributable
+ * to planning the task. Otherwise, both are null.
+ */
+bool runBenchmark(const std::string& name, Task& task, const BenchmarkOptions& options = BenchmarkOptions::instance());
+
+/** Replay the inputs recorded by stages::Recorder into fresh stages, reporting the compute time per input as JSON
+ *
+ * make_stage creates the stage to benchmark, on top of which the recorded stage properties are restored.
+ * Each recorded input is planned in a task of its own. Connecting stages receive all pairs of recorded
+ * start and end inputs, like the original stage did. Returns false if writing the report failed.
+ */
+bool runReplay(const std::string& name, const moveit_task_constructor_msgs::StageTrace& trace,
+               const std::function<Stage::pointer()>& make_stage, const moveit::core::RobotModelConstPtr& robot_model,
+               const BenchmarkOptions& options = BenchmarkOptions::instance());
+
+}  // namespace task_constructor
+}  // namespace moveit
@@ -0,0 +1,347 @@
+/* Benchmarks of the scheduling core, using the synthetic stages of stage_mockups.h
+ *
+ * Run with --benchmark_filter=<regex> to select individual benchmarks.
+ * Counters report rates per second of CPU time.
+ */
+
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/container.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/flat_map.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include "stage_mockups.h"
+#include "models.h"
+
+#include <benchmark/benchmark.h>
+
+#include <boost/bimap.hpp>
+#include <boost/bimap/unordered_set_of.hpp>
+#include <boost/bimap/unordered_multiset_of.hpp>
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <random>
+#include <vector>
+
+using namespace moveit::task_constructor;
+
+namespace {
+std::list<double> costs(size_t num, double cost = 0.0) {
+	return std::list<double>(num, cost);
+}
+
+struct Stats
+{
+	size_t computes = 0;
+	size_t solutions = 0;
+};
+
+void report(benchmark::State& state, const Stats& stats) {
+	state.counters["computes"] = benchmark::Counter(stats.computes, benchmark::Counter::kIsRate);
+	state.counters["solutions"] = benchmark::Counter(stats.solutions, benchmark::Counter::kIsRate);
+}
+
+Task createTask() {
+	Task t("", false);
+	t.setRobotModel(getModel());
+	return t;
+}
+}  // namespace
+
+// GEN - CON - GEN - ... - GEN: depth generators with fan-out solutions each, enumerating fan-out^depth solutions
+static void serialConnect(benchmark::State& state) {
+	const size_t depth = state.range(0);
+	const size_t fanout = state.range(1);
+	Stats stats;
+	for (auto _ : state) {
+		state.PauseTiming();
+		resetMockupIds();
+		Task t = createTask();
+		std::vector<GeneratorMockup*> generators;
+		std::vector<ConnectMockup*> connects;
+		for (size_t i = 0; i < depth; ++i) {
+			if (i > 0) {
+				connects.push_back(new ConnectMockup());
+				t.add(Stage::pointer(connects.back()));
+			}
+			generators.push_back(new GeneratorMockup(PredefinedCosts(costs(fanout, 1.0))));
+			t.add(Stage::pointer(generators.back()));
+		}
+		state.ResumeTiming();
+
+		t.plan();
+
+		for (const auto* g : generators)
+			stats.computes += g->runs_;
+		for (const auto* c : connects)
+			stats.computes += c->runs_;
+		stats.solutions += t.numSolutions();
+	}
+	report(state, stats);
+}
+BENCHMARK(serialConnect)->ArgNames({ "depth", "fanout" })->ArgsProduct({ { 2, 3, 4 }, { 2, 4, 8 } });
+
+// GEN - FW - ... - FW: propagating fan-out solutions through depth stages, i.e. measuring onNewSolution()
+static void serialPropagate(benchmark::State& state) {
+	const size_t depth = state.range(0);
+	const size_t fanout = state.range(1);
+	Stats stats;
+	for (auto _ : state) {
+		state.PauseTiming();
+		resetMockupIds();
+		Task t = createTask();
+		auto* generator = new GeneratorMockup(PredefinedCosts(costs(fanout)), fanout);
+		t.add(Stage::pointer(generator));
+		std::vector<ForwardMockup*> forwards;
+		for (size_t i = 0; i < depth; ++i) {
+			forwards.push_back(new ForwardMockup());
+			t.add(Stage::pointer(forwards.back()));
+		}
+		state.ResumeTiming();
+
+		t.plan();
+
+		stats.computes += generator->runs_;
+		for (const auto* f : forwards)
+			stats.computes += f->runs_;
+		stats.solutions += t.numSolutions();
+	}
+	report(state, stats);
+}
+BENCHMARK(serialPropagate)->ArgNames({ "depth", "fanout" })->ArgsProduct({ { 1, 4, 16 }, { 1, 16, 128 } });
+
+// GEN - CON - GEN with failing connects: all state pairs fail, pruning both interfaces
+static void pruning(benchmark::State& state) {
+	const size_t fanout = state.range(0);
+	Stats stats;
+	for (auto _ : state) {
+		state.PauseTiming();
+		resetMockupIds();
+		Task t = createTask();
+		t.add(std::make_unique<GeneratorMockup>(PredefinedCosts(costs(fanout))));
+		auto* connect = new ConnectMockup(PredefinedCosts::constant(INF));
+		t.add(Stage::pointer(connect));
+		t.add(std::make_unique<GeneratorMockup>(PredefinedCosts(costs(fanout))));
+		state.ResumeTiming();
+
+		t.plan();
+
+		stats.computes += connect->runs_;
+	}
+	report(state, stats);
+}
+BENCHMARK(pruning)->ArgName("fanout")->RangeMultiplier(4)->Range(4, 256);
+
+namespace {
+/* Random stage trees of Serial, Alternatives, Fallbacks, and Merger containers over mockup propagators
+ *
+ * Inner nodes, up to the given depth, have width children each (Merger always merges two group motions).
+ * Propagators draw their costs uniformly from [0, 1), failing with the given rate.
+ */
+class RandomTree
+{
+public:
+	RandomTree(unsigned int seed, double failure_rate) : engine_(seed), failure_rate_(failure_rate) {}
+
+	// forward-propagating subtree
+	Stage::pointer propagator(size_t depth, size_t width) {
+		if (depth == 0)
+			return track(new ForwardMockup(randomCosts()));
+
+		std::unique_ptr<ContainerBase> container;
+		switch (std::uniform_int_distribution<int>(0, 3)(engine_)) {
+			case 0:
+				container = std::make_unique<SerialContainer>("SER" + std::to_string(++containers_));
+				break;
+			case 1:
+				container = std::make_unique<Alternatives>("ALT" + std::to_string(++containers_));
+				break;
+			case 2:
+				container = std::make_unique<Fallbacks>("FB" + std::to_string(++containers_));
+				break;
+			default:  // Merger requires disjoint groups: there are only two of them in getModel()
+				container = std::make_unique<Merger>("MRG" + std::to_string(++containers_));
+				container->add(track(new GroupForwardMockup("group", randomCosts())));
+				container->add(track(new GroupForwardMockup("eef_group", randomCosts())));
+				return container;
+		}
+		for (size_t i = 0; i < width; ++i)
+			container->add(propagator(depth - 1, width));
+		return container;
+	}
+
+	// GEN - tree - CON - GEN - tree, with the given number of solutions per generator
+	void populate(Task& t, size_t depth, size_t width, size_t solutions) {
+		auto* generator = new GeneratorMockup(PredefinedCosts(costs(solutions)));
+		generators_.push_back(generator);
+		t.add(Stage::pointer(generator));
+		t.add(propagator(depth, width));
+
+		connect_ = new ConnectMockup(randomCosts());
+		t.add(Stage::pointer(connect_));
+
+		generator = new GeneratorMockup(PredefinedCosts(costs(solutions)));
+		generators_.push_back(generator);
+		t.add(Stage::pointer(generator));
+		t.add(propagator(depth, width));
+	}
+
+	size_t computes() const {
+		size_t result = connect_ ? connect_->runs_ : 0;
+		for (const auto* g : generators_)
+			result += g->runs_;
+		for (const auto* p : propagators_)
+			result += p->runs_;
+		return result;
+	}
+	size_t stages() const { return generators_.size() + propagators_.size() + containers_ + (connect_ ? 1 : 0); }
+
+private:
+	Stage::pointer track(PropagatorMockup* stage) {
+		propagators_.push_back(stage);
+		return Stage::pointer(stage);
+	}
+
+	// random costs, repeating the last one forever, such that any number of computes is served
+	PredefinedCosts randomCosts(size_t num = 8) {
+		std::uniform_real_distribution<double> cost(0.0, 1.0);
+		std::bernoulli_distribution fail(failure_rate_);
+		std::list<double> result;
+		for (size_t i = 0; i < num; ++i)
+			result.push_back(fail(engine_) ? INF : cost(engine_));
+		return PredefinedCosts(std::move(result), false);
+	}
+
+	std::mt19937 engine_;
+	double failure_rate_;
+	size_t containers_ = 0;
+	std::vector<GeneratorMockup*> generators_;
+	std::vector<PropagatorMockup*> propagators_;
+	ConnectMockup* connect_ = nullptr;
+};
+}  // namespace
+
+// random trees of given depth and width, fed by generators with the given number of solutions, 10% failure rate
+static void randomTree(benchmark::State& state) {
+	const size_t depth = state.range(0);
+	const size_t width = state.range(1);
+	const size_t solutions = state.range(2);
+	Stats stats;
+	size_t stages = 0, seed = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		resetMockupIds();
+		Task t = createTask();
+		RandomTree tree(seed++, 0.1);  // a different tree per iteration
+		tree.populate(t, depth, width, solutions);
+		state.ResumeTiming();
+
+		t.plan();
+
+		stats.computes += tree.computes();
+		stats.solutions += t.numSolutions();
+		stages += tree.stages();
+	}
+	report(state, stats);
+	state.counters["stages"] = benchmark::Counter(stages, benchmark::Counter::kAvgIterations);
+	// computes per solution should grow with the tree size, not combinatorially
+	state.counters["computes/solution"] = stats.solutions ? static_cast<double>(stats.computes) / stats.solutions : 0.0;
+}
+BENCHMARK(randomTree)
+    ->ArgNames({ "depth", "width", "solutions" })
+    ->ArgsProduct({ { 1, 2, 3 }, { 2, 3 }, { 2, 8 } })
+    ->Unit(benchmark::kMillisecond);
+
+// insertion of states with random priorities into an Interface, which keeps them sorted
+static void interfaceInsertion(benchmark::State& state) {
+	const size_t num = state.range(0);
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	std::mt19937 engine(42);
+	std::uniform_real_distribution<double> cost(0.0, 1.0);
+	std::uniform_int_distribution<unsigned int> depth(0, 10);
+
+	size_t inserted = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		std::vector<std::unique_ptr<InterfaceState>> states;
+		states.reserve(num);
+		for (size_t i = 0; i < num; ++i)
+			states.push_back(
+			    std::make_unique<InterfaceState>(scene, InterfaceState::Priority(depth(engine), cost(engine))));
+		Interface interface;
+		state.ResumeTiming();
+
+		for (auto& s : states)
+			interface.add(*s);
+		benchmark::DoNotOptimize(interface.size());
+		inserted += num;
+
+		state.PauseTiming();
+		interface.clear();  // states need to be removed before they are destroyed
+		state.ResumeTiming();
+	}
+	state.counters["insertions"] = benchmark::Counter(inserted, benchmark::Counter::kIsRate);
+}
+BENCHMARK(interfaceInsertion)->ArgName("states")->RangeMultiplier(8)->Range(8, 4096);
+
+// internal->external lookups as done for every lifted solution: boost::bimap (as used before) vs. flat maps
+namespace {
+struct INTERNAL
+{};
+struct EXTERNAL
+{};
+using StateBimap = boost::bimap<boost::bimaps::unordered_set_of<boost::bimaps::tagged<const int*, INTERNAL>>,
+                                boost::bimaps::unordered_multiset_of<boost::bimaps::tagged<const int*, EXTERNAL>>>;
+
+// num internal states, linked to num / 2 external ones
+std::vector<std::pair<const int*, const int*>> stateLinks(const std::vector<int>& internals,
+                                                         const std::vector<int>& externals) {
+	std::vector<std::pair<const int*, const int*>> links;
+	for (size_t i = 0; i < internals.size(); ++i)
+		links.emplace_back(&internals[i], &externals[i / 2]);
+	std::shuffle(links.begin(), links.end(), std::mt19937(42));
+	return links;
+}
+}  // namespace
+
+static void stateMappingBimap(benchmark::State& state) {
+	std::vector<int> internals(state.range(0)), externals(state.range(0) / 2 + 1);
+	const auto links = stateLinks(internals, externals);
+	StateBimap map;
+	for (const auto& link : links)
+		map.insert(StateBimap::value_type(link.first, link.second));
+
+	for (auto _ : state) {
+		for (const auto& link : links) {
+			benchmark::DoNotOptimize(map.by<INTERNAL>().find(link.first)->get<EXTERNAL>());
+			auto range = map.by<EXTERNAL>().equal_range(link.second);
+			benchmark::DoNotOptimize(std::distance(range.first, range.second));
+		}
+	}
+	state.counters["lookups"] = benchmark::Counter(2 * links.size() * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(stateMappingBimap)->ArgName("states")->RangeMultiplier(8)->Range(8, 32768);
+
+static void stateMappingFlat(benchmark::State& state) {
+	std::vector<int> internals(state.range(0)), externals(state.range(0) / 2 + 1);
+	const auto links = stateLinks(internals, externals);
+	utils::FlatPointerMap<const int*, const int*> internal_external;
+	utils::FlatPointerMap<const int*, utils::SmallVector<const int*>> external_internal;
+	for (const auto& link : links) {
+		internal_external.insert(link);
+		external_internal[link.second].push_back(link.first);
+	}
+
+	for (auto _ : state) {
+		for (const auto& link : links) {
+			benchmark::DoNotOptimize(internal_external.find(link.first)->second);
+			benchmark::DoNotOptimize(external_internal.find(link.second)->second.size());
+		}
+	}
+	state.counters["lookups"] = benchmark::Counter(2 * links.size() * state.iterations(), benchmark::Counter::kIsRate);
+}
+BENCHMARK(stateMappingFlat)->ArgName("states")->RangeMultiplier(8)->Range(8, 32768);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,187 @@
+/* Benchmarks of cost terms and solvers on synthetic trajectories of the test models in models.cpp
+ *
+ * Run with --benchmark_filter=<regex> to select individual benchmarks.
+ * Benchmarks using the panda model (Clearance, CartesianPath) require robot_description
+ * (and kinematics parameters for CartesianPath) on the parameter server and are skipped otherwise.
+ */
+
+#include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include "stage_mockups.h"
+#include "models.h"
+
+#include <benchmark/benchmark.h>
+#include <ros/init.h>
+
+#include <cmath>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace moveit::task_constructor;
+
+namespace {
+// panda model, if available, loaded once
+moveit::core::RobotModelConstPtr panda() {
+	static const moveit::core::RobotModelConstPtr model = loadModel();
+	return model;
+}
+
+// trajectory of num waypoints, moving all joints of the model along phase-shifted sine waves
+robot_trajectory::RobotTrajectoryPtr sineTrajectory(const moveit::core::RobotModelConstPtr& model, size_t num) {
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(model, nullptr);
+	moveit::core::RobotState state(model);
+	state.setToDefaultValues();
+	std::vector<double> positions(model->getVariableCount());
+	for (size_t i = 0; i < num; ++i) {
+		for (size_t j = 0; j < positions.size(); ++j)
+			positions[j] = 0.5 * std::sin(2 * M_PI * i / num + j);
+		state.setVariablePositions(positions);
+		state.enforceBounds();
+		state.update();
+		trajectory->addSuffixWayPoint(state, 0.01);
+	}
+	return trajectory;
+}
+
+// a SubTrajectory connected to a creator stage and start/end states, as needed by all cost terms
+struct Fixture
+{
+	GeneratorMockup creator;
+	planning_scene::PlanningScenePtr scene;
+	InterfaceState start;
+	InterfaceState end;
+	SubTrajectory solution;
+
+	Fixture(const moveit::core::RobotModelConstPtr& model, size_t num, const std::string& group)
+	  : scene(std::make_shared<planning_scene::PlanningScene>(model))
+	  , start(scene)
+	  , end(scene)
+	  , solution(sineTrajectory(model, num)) {
+		creator.properties().declare<std::string>("group", group);
+		solution.setCreator(&creator);
+		solution.setStartState(start);
+		solution.setEndState(end);
+	}
+	~Fixture() { solution.detach(); }
+};
+
+void evaluate(benchmark::State& state, const CostTerm& term, Fixture& fixture) {
+	std::string comment;
+	for (auto _ : state)
+		benchmark::DoNotOptimize(term(fixture.solution, comment));
+	state.SetItemsProcessed(state.iterations() * state.range(0));  // waypoints per second
+}
+}  // namespace
+
+static void pathLength(benchmark::State& state) {
+	Fixture fixture(getModel(), state.range(0), "group");
+	evaluate(state, cost::PathLength(), fixture);
+}
+BENCHMARK(pathLength)->ArgName("waypoints")->RangeMultiplier(10)->Range(10, 10000);
+
+static void distanceToReference(benchmark::State& state) {
+	Fixture fixture(getModel(), state.range(0), "group");
+	std::map<std::string, double> reference;
+	for (const std::string& name : fixture.scene->getRobotModel()->getVariableNames())
+		reference[name] = 0.25;
+	evaluate(state, cost::DistanceToReference(reference), fixture);
+}
+BENCHMARK(distanceToReference)->ArgName("waypoints")->RangeMultiplier(10)->Range(10, 10000);
+
+static void linkMotion(benchmark::State& state) {
+	Fixture fixture(getModel(), state.range(0), "group");
+	evaluate(state, cost::LinkMotion("tip"), fixture);
+}
+BENCHMARK(linkMotion)->ArgName("waypoints")->RangeMultiplier(10)->Range(10, 10000);
+
+// clearance requires collision geometry, which the synthetic model of getModel() doesn't provide
+static void clearance(benchmark::State& state) {
+	if (!panda()) {
+		state.SkipWithError("robot_description not available");
+		return;
+	}
+	Fixture fixture(panda(), state.range(0), "panda_arm");
+	moveit_msgs::CollisionObject box;
+	box.header.frame_id = panda()->getModelFrame();
+	box.id = "box";
+	box.operation = box.ADD;
+	box.primitives.resize(1);
+	box.primitives[0].type = shape_msgs::SolidPrimitive::BOX;
+	box.primitives[0].dimensions = { 0.2, 0.2, 0.2 };
+	box.primitive_poses.resize(1);
+	box.primitive_poses[0].position.x = 0.6;
+	box.primitive_poses[0].orientation.w = 1.0;
+	fixture.scene->processCollisionObjectMsg(box);
+
+	cost::Clearance term;
+	term.stride = state.range(1);
+	evaluate(state, term, fixture);
+}
+BENCHMARK(clearance)->ArgNames({ "waypoints", "stride" })->ArgsProduct({ { 10, 100, 1000, 10000 }, { 1, 10 } });
+
+static void jointInterpolation(benchmark::State& state) {
+	const moveit::core::RobotModelConstPtr model = getModel();
+	const moveit::core::JointModelGroup* jmg = model->getJointModelGroup("group");
+	auto from = std::make_shared<planning_scene::PlanningScene>(model);
+	from->getCurrentStateNonConst().setToDefaultValues();
+	auto to = from->diff();
+	to->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 1.0));
+	to->getCurrentStateNonConst().update();
+
+	solvers::JointInterpolationPlanner planner;
+	planner.setProperty("max_step", 1.0 / state.range(0));  // interpolated waypoints per joint-space unit
+	planner.init(model);
+	robot_trajectory::RobotTrajectoryPtr result;
+	for (auto _ : state) {
+		if (!planner.plan(from, to, jmg, 1.0, result)) {
+			state.SkipWithError("planning failed");
+			break;
+		}
+		benchmark::DoNotOptimize(result);
+	}
+	state.counters["waypoints"] = result ? result->getWayPointCount() : 0;
+}
+BENCHMARK(jointInterpolation)->ArgName("steps_per_rad")->RangeMultiplier(10)->Range(10, 1000);
+
+static void cartesianPath(benchmark::State& state) {
+	if (!panda()) {
+		state.SkipWithError("robot_description not available");
+		return;
+	}
+	const moveit::core::JointModelGroup* jmg = panda()->getJointModelGroup("panda_arm");
+	const moveit::core::LinkModel* link = panda()->getLinkModel("panda_link8");
+	auto from = std::make_shared<planning_scene::PlanningScene>(panda());
+	from->getCurrentStateNonConst().setToDefaultValues(jmg, "ready");
+	from->getCurrentStateNonConst().update();
+	Eigen::Isometry3d target = from->getCurrentState().getGlobalLinkTransform(link);
+	target.translation().z() -= 0.01 * state.range(0);  // move down by given cm
+
+	solvers::CartesianPath planner;
+	planner.init(panda());
+	robot_trajectory::RobotTrajectoryPtr result;
+	for (auto _ : state) {
+		if (!planner.plan(from, *link, Eigen::Isometry3d::Identity(), target, jmg, 1.0, result)) {
+			state.SkipWithError("planning failed, are kinematics parameters loaded?");
+			break;
+		}
+		benchmark::DoNotOptimize(result);
+	}
+	state.counters["waypoints"] = result ? result->getWayPointCount() : 0;
+}
+BENCHMARK(cartesianPath)->ArgName("cm")->RangeMultiplier(4)->Range(1, 16);
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "mtc_solver_benchmarks", ros::init_options::AnonymousName);
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
@@ -17,6 +17,8 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <gtest/gtest.h>
 
+#include "benchmark_runner.h"
+
 using namespace moveit::task_constructor;
 
 void spawnObject(const planning_scene::PlanningScenePtr& scene) {
@@ -185,10 +187,14 @@ TEST(PA10, pick) {
 	auto solutions = t.solutions().size();
 	EXPECT_GE(solutions, 5u);
 	EXPECT_LE(solutions, 10u);
+
+	if (BenchmarkOptions::instance().runs)
+		EXPECT_TRUE(runBenchmark("pick_pa10", t));
 }
 
 int main(int argc, char** argv) {
 	testing::InitGoogleTest(&argc, argv);
+	BenchmarkOptions::fromArgs(argc, argv);
 	ros::init(argc, argv, "pa10");
 	ros::AsyncSpinner spinner(1);
 	spinner.start();
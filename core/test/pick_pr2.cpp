@@ -11,6 +11,8 @@
 #include <moveit/planning_scene_interface/planning_scene_interface.h>
 #include <gtest/gtest.h>
 
+#include "benchmark_runner.h"
+
 using namespace moveit::task_constructor;
 
 void spawnObject() {
@@ -83,10 +85,14 @@ TEST(PR2, pick) {
 	auto solutions = t.solutions().size();
 	EXPECT_GE(solutions, 5u);
 	EXPECT_LE(solutions, 10u);
+
+	if (BenchmarkOptions::instance().runs)
+		EXPECT_TRUE(runBenchmark("pick_pr2", t));
 }
 
 int main(int argc, char** argv) {
 	testing::InitGoogleTest(&argc, argv);
+	BenchmarkOptions::fromArgs(argc, argv);
 	ros::init(argc, argv, "pr2");
 	ros::AsyncSpinner spinner(1);
 	spinner.start();
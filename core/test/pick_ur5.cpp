@@ -11,6 +11,8 @@
 #include <moveit/planning_scene_interface/planning_scene_interface.h>
 #include <gtest/gtest.h>
 
+#include "benchmark_runner.h"
+
 using namespace moveit::task_constructor;
 
 void spawnObject() {
@@ -85,10 +87,14 @@ TEST(UR5, pick) {
 	auto solutions = t.solutions().size();
 	EXPECT_GE(solutions, 15u);
 	EXPECT_LE(solutions, 60u);
+
+	if (BenchmarkOptions::instance().runs)
+		EXPECT_TRUE(runBenchmark("pick_ur5", t));
 }
 
 int main(int argc, char** argv) {
 	testing::InitGoogleTest(&argc, argv);
+	BenchmarkOptions::fromArgs(argc, argv);
 	ros::init(argc, argv, "ur5");
 	ros::AsyncSpinner spinner(1);
 	spinner.start();
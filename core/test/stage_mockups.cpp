@@ -1,5 +1,6 @@
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 
 #include "stage_mockups.h"
 
@@ -12,6 +13,7 @@ unsigned int ConnectMockup::id_ = 0;
 unsigned int PropagatorMockup::id_ = 0;
 unsigned int ForwardMockup::id_ = 0;
 unsigned int BackwardMockup::id_ = 0;
+unsigned int GroupForwardMockup::id_ = 0;
 
 void resetMockupIds() {
 	GeneratorMockup::id_ = 0;
@@ -20,6 +22,7 @@ void resetMockupIds() {
 	PropagatorMockup::id_ = 0;
 	ForwardMockup::id_ = 0;
 	BackwardMockup::id_ = 0;
+	GroupForwardMockup::id_ = 0;
 }
 
 PredefinedCosts::PredefinedCosts(std::list<double>&& costs, bool finite)
@@ -136,5 +139,31 @@ BackwardMockup::BackwardMockup(PredefinedCosts&& costs, std::size_t solutions_pe
 	setName("BWD" + std::to_string(++id_));
 }
 
+GroupForwardMockup::GroupForwardMockup(const std::string& group, PredefinedCosts&& costs)
+  : ForwardMockup{ std::move(costs) }, group_{ group } {
+	setName("GRP" + std::to_string(++id_));
+}
+
+void GroupForwardMockup::computeForward(const InterfaceState& from) {
+	++runs_;
+
+	const moveit::core::JointModelGroup* jmg = from.scene()->getRobotModel()->getJointModelGroup(group_);
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(from.scene()->getRobotModel(), jmg);
+	moveit::core::RobotState state(from.scene()->getCurrentState());
+	trajectory->addSuffixWayPoint(state, 0.0);
+
+	std::vector<double> positions;
+	state.copyJointGroupPositions(jmg, positions);
+	for (double& position : positions)
+		position += 0.1;
+	state.setJointGroupPositions(jmg, positions);
+	state.update();
+	trajectory->addSuffixWayPoint(state, 1.0);
+
+	planning_scene::PlanningScenePtr to = from.scene()->diff();
+	to->setCurrentState(state);
+	sendForward(from, InterfaceState{ to }, SubTrajectory{ trajectory, costs_.cost() });
+}
+
 }  // namespace task_constructor
 }  // namespace moveit
@@ -133,6 +133,17 @@ struct BackwardMockup : public PropagatorMockup
 	  : BackwardMockup{ PredefinedCosts{ std::list<double>{ costs }, true } } {}
 };
 
+/* forward propagator moving the joints of a group, producing the trajectories required by Merger */
+struct GroupForwardMockup : public ForwardMockup
+{
+	static unsigned int id_;
+	std::string group_;
+
+	GroupForwardMockup(const std::string& group, PredefinedCosts&& costs = PredefinedCosts::constant(0.0));
+
+	void computeForward(const InterfaceState& from) override;
+};
+
 // reset ids of all Mockup types (used to generate unique stage names)
 void resetMockupIds();
 
@@ -0,0 +1,63 @@
+#include <moveit/task_constructor/arena.h>
+
+#include <gtest/gtest.h>
+
+#include <list>
+#include <string>
+#include <thread>
+
+using namespace moveit::task_constructor::utils;
+
+TEST(Arena, recycle) {
+	Arena arena(1024);
+	void* p = arena.allocate(24);
+	void* q = arena.allocate(24);
+	EXPECT_NE(p, q);
+	EXPECT_EQ(arena.capacity(), 1024u);
+
+	arena.deallocate(p, 24);
+	EXPECT_EQ(arena.allocate(24), p);  // released memory is reused for same size
+	EXPECT_NE(arena.allocate(100), p);
+
+	arena.deallocate(q, 24);
+	arena.deallocate(p, 24);
+}
+
+TEST(Arena, lifetime) {
+	auto arena = std::make_shared<Arena>();
+	std::weak_ptr<Arena> weak = arena;
+
+	auto s = std::allocate_shared<std::string>(ArenaAllocator<std::string>(arena), "solution");
+	{
+		std::list<int, ArenaAllocator<int>> l{ ArenaAllocator<int>(arena) };
+		l.assign(100, 42);
+	}
+	arena.reset();
+	EXPECT_FALSE(weak.expired());  // kept alive by s
+	EXPECT_EQ(*s, "solution");
+	s.reset();
+	EXPECT_TRUE(weak.expired());
+}
+
+TEST(Arena, fallback) {
+	// without arena, allocators use global operator new
+	std::list<int, ArenaAllocator<int>> l;
+	l.assign(10, 1);
+	EXPECT_EQ(l.size(), 10u);
+	EXPECT_FALSE(l.get_allocator().arena());
+}
+
+TEST(Arena, concurrent) {
+	auto arena = std::make_shared<Arena>(4096);
+	auto job = [arena] {
+		std::list<int, ArenaAllocator<int>> l{ ArenaAllocator<int>(arena) };
+		for (int i = 0; i < 1000; ++i) {
+			l.push_back(i);
+			if (i % 3 == 0)
+				l.pop_front();
+		}
+	};
+	std::thread t1(job), t2(job);
+	t1.join();
+	t2.join();
+}
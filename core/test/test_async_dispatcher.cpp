@@ -0,0 +1,78 @@
+#include <moveit/task_constructor/async_dispatcher.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace moveit::task_constructor::utils;
+
+TEST(AsyncDispatcher, order) {
+	std::vector<int> received;
+	size_t batches = 0;
+	AsyncDispatcher<int> dispatcher(
+	    [&](const std::vector<int>& batch) {
+		    EXPECT_LE(batch.size(), 8u);
+		    received.insert(received.end(), batch.begin(), batch.end());
+		    ++batches;
+	    },
+	    16, 8);
+	for (int i = 0; i < 100; ++i)
+		EXPECT_TRUE(dispatcher.push(i));
+	dispatcher.flush();
+
+	ASSERT_EQ(received.size(), 100u);
+	for (int i = 0; i < 100; ++i)
+		EXPECT_EQ(received[i], i);
+	EXPECT_GE(batches, 100u / 8);
+	EXPECT_EQ(dispatcher.dropped(), 0u);
+}
+
+TEST(AsyncDispatcher, drop) {
+	std::mutex blocker;
+	std::unique_lock<std::mutex> blocked(blocker);
+	std::atomic<size_t> received{ 0 };
+	AsyncDispatcher<int> dispatcher(
+	    [&](const std::vector<int>& batch) {
+		    std::lock_guard<std::mutex> lock(blocker);  // stall the consumer until released
+		    received += batch.size();
+	    },
+	    4, 1, AsyncDispatcher<int>::DROP);
+
+	size_t accepted = 0;
+	for (int i = 0; i < 20; ++i)
+		accepted += dispatcher.push(i);
+	// at most the queue capacity and the batch being delivered are accepted
+	EXPECT_LE(accepted, 5u);
+	EXPECT_EQ(dispatcher.dropped(), 20 - accepted);
+
+	blocked.unlock();
+	dispatcher.flush();
+	EXPECT_EQ(received, accepted);
+}
+
+TEST(AsyncDispatcher, block) {
+	std::atomic<size_t> received{ 0 };
+	AsyncDispatcher<int> dispatcher(
+	    [&](const std::vector<int>& batch) {
+		    std::this_thread::sleep_for(std::chrono::microseconds(100));
+		    received += batch.size();
+	    },
+	    2, 1, AsyncDispatcher<int>::BLOCK);
+	for (int i = 0; i < 50; ++i)
+		EXPECT_TRUE(dispatcher.push(i));
+	dispatcher.flush();
+	EXPECT_EQ(received, 50u);
+	EXPECT_EQ(dispatcher.dropped(), 0u);
+}
+
+TEST(AsyncDispatcher, exception) {
+	AsyncDispatcher<int> dispatcher([](const std::vector<int>& /*batch*/) { throw std::runtime_error("failed"); });
+	dispatcher.push(1);
+	EXPECT_THROW(dispatcher.flush(), std::runtime_error);
+	dispatcher.flush();  // error was reported once
+}
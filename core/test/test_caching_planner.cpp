@@ -0,0 +1,112 @@
+#include <moveit/task_constructor/solvers/caching_planner.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/task_constructor/storage.h>
+#include <geometric_shapes/shapes.h>
+
+#include "models.h"
+#include <gtest/gtest.h>
+
+using namespace moveit::task_constructor;
+
+struct CachingPlannerTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	solvers::CachingPlannerPtr planner =
+	    std::make_shared<solvers::CachingPlanner>(std::make_shared<solvers::JointInterpolationPlanner>());
+	planning_scene::PlanningScenePtr from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+
+	CachingPlannerTest() {
+		planner->init(robot_model);
+		from->getCurrentStateNonConst().setToDefaultValues();
+	}
+
+	planning_scene::PlanningScenePtr goal(double value) {
+		auto to = from->diff();
+		auto& state = to->getCurrentStateNonConst();
+		state.setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), value));
+		state.update();
+		return to;
+	}
+
+	// plan and validate that the trajectory exactly reaches the goal
+	bool plan(const planning_scene::PlanningSceneConstPtr& to) {
+		robot_trajectory::RobotTrajectoryPtr trajectory;
+		return planner->plan(from, to, jmg, 1.0, trajectory) && trajectory &&
+		       trajectory->getLastWayPoint().distance(to->getCurrentState(), jmg) < 1e-9;
+	}
+};
+
+TEST_F(CachingPlannerTest, hits) {
+	EXPECT_TRUE(plan(goal(0.5)));
+	EXPECT_EQ(planner->misses(), 1u);
+	EXPECT_EQ(planner->hits(), 0u);
+	EXPECT_EQ(planner->size(), 1u);
+
+	EXPECT_TRUE(plan(goal(0.5)));
+	EXPECT_EQ(planner->hits(), 1u);
+
+	// goals within resolution share a cache entry, but the returned trajectory reaches the exact goal
+	EXPECT_TRUE(plan(goal(0.5 + 1e-4)));
+	EXPECT_EQ(planner->hits(), 2u);
+
+	EXPECT_TRUE(plan(goal(1.0)));
+	EXPECT_EQ(planner->misses(), 2u);
+	EXPECT_EQ(planner->size(), 2u);
+}
+
+TEST_F(CachingPlannerTest, eviction) {
+	planner->setMaxEntries(1);
+	EXPECT_TRUE(plan(goal(0.5)));
+	EXPECT_TRUE(plan(goal(1.0)));
+	EXPECT_EQ(planner->size(), 1u);
+
+	EXPECT_TRUE(plan(goal(0.5)));  // evicted
+	EXPECT_EQ(planner->misses(), 3u);
+	EXPECT_EQ(planner->hits(), 0u);
+}
+
+TEST_F(CachingPlannerTest, deferredTiming) {
+	EXPECT_FALSE(planner->deferredTiming());
+	planner->planner()->setDeferTiming(true);
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	ASSERT_TRUE(planner->plan(from, goal(0.5), jmg, 1.0, trajectory));
+
+	// timing of the wrapped planner is forwarded and applied on demand
+	SubTrajectory solution(trajectory);
+	solution.deferTiming(planner->deferredTiming());
+	EXPECT_TRUE(solution.timingPending());
+	solution.computeTiming();
+	EXPECT_FALSE(solution.timingPending());
+	EXPECT_NE(solution.trajectory(), trajectory);  // timed copy
+	EXPECT_EQ(solution.trajectory()->getWayPointCount(), trajectory->getWayPointCount());
+}
+
+TEST_F(CachingPlannerTest, warmStart) {
+	auto move_box = [this](double x) {
+		from->getWorldNonConst()->removeObject("box");
+		from->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.1, 0.1, 0.1),
+		                                      Eigen::Isometry3d(Eigen::Translation3d(x, 10.0, 0.0)));
+	};
+	move_box(0.0);
+	EXPECT_TRUE(plan(goal(0.5)));
+
+	// by default, a moved object invalidates the cache entry
+	move_box(1.0);
+	EXPECT_TRUE(plan(goal(0.5)));
+	EXPECT_EQ(planner->misses(), 2u);
+
+	// in warm-start mode, the entry survives init() and is reused after validation in the changed world
+	planner->clear();
+	planner->setWarmStart(true);
+	EXPECT_TRUE(plan(goal(0.5)));
+	EXPECT_EQ(planner->misses(), 3u);
+	planner->init(robot_model);
+	EXPECT_EQ(planner->size(), 1u);
+	move_box(2.0);
+	EXPECT_TRUE(plan(goal(0.5)));
+	EXPECT_EQ(planner->hits(), 1u);
+	EXPECT_EQ(planner->misses(), 3u);
+}
@@ -0,0 +1,116 @@
+#include <moveit/task_constructor/cancellation.h>
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <thread>
+
+using namespace moveit::task_constructor::utils;
+
+TEST(CancellationToken, cancel) {
+	CancellationToken token;
+	CancellationToken copy = token;
+	EXPECT_FALSE(copy.cancelled());
+	token.cancel();
+	EXPECT_TRUE(copy.cancelled());
+	copy.reset();
+	EXPECT_FALSE(token.cancelled());
+}
+
+TEST(CancellationToken, children) {
+	CancellationToken parent;
+	CancellationToken child = parent.child();
+
+	child.cancel();
+	EXPECT_TRUE(child.cancelled());
+	EXPECT_FALSE(parent.cancelled());
+
+	child.reset();
+	parent.cancel();
+	EXPECT_TRUE(child.cancelled());
+}
+
+TEST(CancellationToken, callbacks) {
+	CancellationToken parent;
+	CancellationToken child = parent.child();
+	int calls = 0;
+	{
+		CancellationToken::Registration registration(child, [&calls] { ++calls; });
+		child.cancel();
+		EXPECT_EQ(calls, 1);
+		parent.cancel();  // called only once
+		EXPECT_EQ(calls, 1);
+	}
+	{  // already cancelled: call immediately
+		CancellationToken::Registration registration(child, [&calls] { ++calls; });
+		EXPECT_EQ(calls, 2);
+	}
+	parent.reset();
+	child.reset();
+	{ CancellationToken::Registration registration(child, [&calls] { ++calls; }); }
+	parent.cancel();  // registration was removed
+	EXPECT_EQ(calls, 2);
+}
+
+TEST(CancellationToken, current) {
+	EXPECT_FALSE(CancellationToken::current().cancelled());
+	CancellationToken token;
+	{
+		CancellationToken::Activation activation(token);
+		token.cancel();
+		EXPECT_TRUE(CancellationToken::current().cancelled());
+		// other threads don't see it
+		std::thread([] { EXPECT_FALSE(CancellationToken::current().cancelled()); }).join();
+	}
+	EXPECT_FALSE(CancellationToken::current().cancelled());
+}
+
+TEST(CancellationTimer, timeout) {
+	CancellationToken token;
+	std::atomic<bool> called{ false };
+	CancellationToken::Registration registration(token, [&called] { called = true; });
+	{
+		CancellationTimer timer(token, 0.01);
+		auto start = std::chrono::steady_clock::now();
+		while (!token.cancelled() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+	EXPECT_TRUE(token.cancelled());
+	EXPECT_TRUE(called);
+
+	token.reset();
+	{ CancellationTimer timer(token, 10.0); }  // destroyed before timeout
+	{ CancellationTimer timer(token, std::numeric_limits<double>::max()); }
+	EXPECT_FALSE(token.cancelled());
+}
+
+TEST(TimeSlice, nesting) {
+	EXPECT_FALSE(TimeSlice::expired());
+	EXPECT_TRUE(std::isinf(TimeSlice::remaining()));
+	{
+		TimeSlice::Activation outer(10.0);
+		EXPECT_FALSE(TimeSlice::expired());
+		EXPECT_LE(TimeSlice::remaining(), 10.0);
+		{  // an inner slice cannot extend the outer one
+			TimeSlice::Activation inner(100.0);
+			EXPECT_LE(TimeSlice::remaining(), 10.0);
+		}
+		{
+			TimeSlice::Activation inner(0.0);
+			EXPECT_TRUE(TimeSlice::expired());
+			EXPECT_EQ(TimeSlice::remaining(), 0.0);
+			// other threads don't see it, unless it is propagated explicitly
+			std::thread([] { EXPECT_FALSE(TimeSlice::expired()); }).join();
+			std::thread([deadline = TimeSlice::deadline()] {
+				TimeSlice::Activation activation(deadline);
+				EXPECT_TRUE(TimeSlice::expired());
+			}).join();
+		}
+		EXPECT_FALSE(TimeSlice::expired());
+		{ TimeSlice::Activation unlimited(std::numeric_limits<double>::infinity()); }
+	}
+	EXPECT_TRUE(std::isinf(TimeSlice::remaining()));
+}
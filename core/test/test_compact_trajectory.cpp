@@ -0,0 +1,88 @@
+#include "models.h"
+
+#include <moveit/task_constructor/compact_trajectory.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+
+using namespace moveit::task_constructor;
+
+struct CompactTrajectoryTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	robot_trajectory::RobotTrajectoryPtr trajectory =
+	    std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, jmg);
+
+	CompactTrajectoryTest() {
+		moveit::core::RobotState state(robot_model);
+		state.setToDefaultValues();
+		for (size_t i = 0; i < 5; ++i) {
+			state.setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 0.1 * i));
+			state.setJointGroupVelocities(jmg, std::vector<double>(jmg->getVariableCount(), 0.2 * i));
+			state.update();
+			trajectory->addSuffixWayPoint(state, 0.5 * i);
+		}
+	}
+};
+
+TEST_F(CompactTrajectoryTest, roundtrip) {
+	auto compact = utils::CompactTrajectory::create(*trajectory);
+	ASSERT_TRUE(compact);
+	EXPECT_EQ(compact->waypointCount(), trajectory->getWayPointCount());
+
+	auto expanded = compact->expand();
+	ASSERT_EQ(expanded->getWayPointCount(), trajectory->getWayPointCount());
+	EXPECT_EQ(expanded->getGroup(), jmg);
+	for (size_t i = 0; i < trajectory->getWayPointCount(); ++i) {
+		const auto& expected = trajectory->getWayPoint(i);
+		const auto& actual = expanded->getWayPoint(i);
+		EXPECT_DOUBLE_EQ(expanded->getWayPointDurationFromPrevious(i), trajectory->getWayPointDurationFromPrevious(i));
+		EXPECT_LT(actual.distance(expected), 1e-12);
+		EXPECT_TRUE(actual.hasVelocities());
+		for (int variable : jmg->getVariableIndexList())
+			EXPECT_DOUBLE_EQ(actual.getVariableVelocity(variable), expected.getVariableVelocity(variable));
+		EXPECT_FALSE(actual.dirtyLinkTransforms());
+	}
+}
+
+TEST_F(CompactTrajectoryTest, rejectsMovingNonGroupJoints) {
+	// change a variable outside the group
+	const auto& group_variables = jmg->getVariableIndexList();
+	for (int v = 0; v < static_cast<int>(robot_model->getVariableCount()); ++v) {
+		if (std::find(group_variables.begin(), group_variables.end(), v) != group_variables.end())
+			continue;
+		auto& last = trajectory->getLastWayPointNonConst();
+		last.setVariablePosition(v, last.getVariablePosition(v) + 0.1);
+		EXPECT_FALSE(utils::CompactTrajectory::create(*trajectory));
+		return;
+	}
+	GTEST_SKIP() << "all variables are part of the group";
+}
+
+TEST_F(CompactTrajectoryTest, subTrajectory) {
+	SubTrajectory solution(trajectory);
+	solution.compact();
+	EXPECT_TRUE(solution.isCompact());
+
+	// original trajectory is reused while it's alive
+	EXPECT_EQ(solution.trajectory(), trajectory);
+
+	const size_t waypoints = trajectory->getWayPointCount();
+	const double duration = trajectory->getDuration();
+	trajectory.reset();
+	auto expanded = solution.trajectory();
+	ASSERT_TRUE(expanded);
+	EXPECT_EQ(expanded->getWayPointCount(), waypoints);
+	EXPECT_DOUBLE_EQ(expanded->getDuration(), duration);
+	EXPECT_EQ(solution.trajectory(), expanded);  // rebuilt once while referenced
+
+	// setting a new trajectory discards the compact one
+	solution.setTrajectory(std::make_shared<robot_trajectory::RobotTrajectory>(*expanded, true));
+	EXPECT_FALSE(solution.isCompact());
+}
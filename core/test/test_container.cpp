@@ -2,15 +2,28 @@
 #include <moveit/task_constructor/stage_p.h>
 #include <moveit/task_constructor/task_p.h>
 #include <moveit/task_constructor/stages/fixed_state.h>
+#include <moveit/task_constructor/stages/memoize.h>
+#include <moveit/task_constructor/stages/shared_prefix.h>
+#include <moveit/task_constructor/stages/predicate_filter.h>
+#include <moveit/task_constructor/stages/recorder.h>
+#include <moveit/task_constructor/planning_server.h>
+#include <moveit/task_constructor/static_serial.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <geometry_msgs/PoseStamped.h>
 
 #include "stage_mockups.h"
 #include "models.h"
 #include "gtest_value_printers.h"
 
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <initializer_list>
+#include <atomic>
 #include <chrono>
+#include <future>
+#include <sstream>
+#include <stdexcept>
 #include <thread>
 
 using namespace moveit::task_constructor;
@@ -629,6 +642,49 @@ TEST(Task, reuse) {
 	}
 }
 
+// GeneratorMockup counting its init() calls, optionally failing
+class InitCountingMockup : public GeneratorMockup
+{
+	std::atomic<size_t>& count_;
+	bool fail_;
+
+public:
+	InitCountingMockup(std::atomic<size_t>& count, bool fail) : count_(count), fail_(fail) {}
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override {
+		GeneratorMockup::init(robot_model);
+		++count_;
+		if (fail_)
+			throw InitStageException(*this, "init failed");
+	}
+};
+
+// prewarm() initializes independent subtrees concurrently, reporting init errors in order of stages
+TEST(Task, prewarm) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	std::atomic<size_t> count{ 0 };
+	auto alternatives = std::make_unique<Alternatives>();
+	for (size_t i = 0; i < 8; ++i)
+		alternatives->add(std::make_unique<InitCountingMockup>(count, i == 2 || i == 5));
+	t.add(std::move(alternatives));
+
+	try {
+		t.prewarm(ExecutionPolicy::parallel(4));
+		ADD_FAILURE() << "expected InitStageException";
+	} catch (const InitStageException& e) {
+		std::ostringstream oss;
+		oss << e;
+		const std::string msg = oss.str();
+		const size_t first = msg.find("GEN3");
+		const size_t second = msg.find("GEN6");
+		ASSERT_NE(first, std::string::npos) << msg;
+		ASSERT_NE(second, std::string::npos) << msg;
+		EXPECT_LT(first, second);
+	}
+	EXPECT_EQ(count, 8u);
+}
+
 // ForwardMockup that takes a while for its computation
 class TimedForwardMockup : public ForwardMockup
 {
@@ -672,3 +728,520 @@ TEST(Task, timeout) {
 	EXPECT_TRUE(t.plan());
 	EXPECT_EQ(t.solutions().size(), 2u);
 }
+
+TEST(Task, computeBudget) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::constant(0.0)));
+	auto alternatives = std::make_unique<Alternatives>();
+	auto slow = std::make_unique<TimedForwardMockup>(std::chrono::milliseconds(10));
+	slow->setComputeBudget(0.001);  // exhausted by the first computation
+	auto* slow_ptr = slow.get();
+	auto fast = std::make_unique<ForwardMockup>();
+	auto* fast_ptr = fast.get();
+	alternatives->add(std::move(slow));
+	alternatives->add(std::move(fast));
+	t.add(std::move(alternatives));
+
+	EXPECT_TRUE(t.plan(4));
+	EXPECT_EQ(t.solutions().size(), 4u);
+	// after its first computation, the slow stage is withheld as long as the fast one has pending work
+	EXPECT_EQ(slow_ptr->runs_, 1u);
+	EXPECT_EQ(fast_ptr->runs_, 3u);
+	EXPECT_TRUE(slow_ptr->budgetExhausted());
+	EXPECT_FALSE(fast_ptr->budgetExhausted());
+}
+
+TEST(Task, markerLevel) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+
+	auto gen = std::make_unique<GeneratorMockup>(PredefinedCosts::constant(0.0));
+	auto* gen_ptr = gen.get();
+	auto fwd = std::make_unique<ForwardMockup>();
+	fwd->setMarkerLevel(Stage::MARKERS_FULL);  // explicitly set level overrides the inherited one
+	auto* fwd_ptr = fwd.get();
+	t.add(std::move(gen));
+	t.add(std::move(fwd));
+
+	t.setMarkerLevel(Stage::MARKERS_BASIC);
+	EXPECT_TRUE(t.plan(1));
+	EXPECT_EQ(gen_ptr->markerLevel(), Stage::MARKERS_BASIC);
+	EXPECT_TRUE(gen_ptr->generatesMarkers(Stage::MARKERS_BASIC));
+	EXPECT_FALSE(gen_ptr->generatesMarkers(Stage::MARKERS_FULL));
+	EXPECT_TRUE(fwd_ptr->generatesMarkers(Stage::MARKERS_FULL));
+
+	t.setMarkerLevel(Stage::MARKERS_NONE);
+	EXPECT_TRUE(t.plan(1));
+	EXPECT_FALSE(gen_ptr->generatesMarkers());
+}
+
+// ForwardMockup that computes for a long time, unless cancelled
+class CancellableForwardMockup : public ForwardMockup
+{
+public:
+	void computeForward(const InterfaceState& from) override {
+		const auto& cancellation = utils::CancellationToken::current();
+		const auto end = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+		while (!cancellation.cancelled() && std::chrono::steady_clock::now() < end)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		ForwardMockup::computeForward(from);
+	}
+};
+
+TEST(Task, timeoutCancelsCompute) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::constant(0.0)));
+	t.add(std::make_unique<CancellableForwardMockup>());
+
+	t.setTimeout(0.05);
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_TRUE(t.plan());  // the cancelled computation still finishes its solution
+	EXPECT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 1.0);
+	EXPECT_EQ(t.solutions().size(), 1u);
+}
+
+TEST(Task, preemptCancelsCompute) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::constant(0.0)));
+	t.add(std::make_unique<CancellableForwardMockup>());
+
+	std::thread preempter([&t] {
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		t.preempt();
+	});
+	auto start = std::chrono::steady_clock::now();
+	t.plan();
+	EXPECT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 1.0);
+	preempter.join();
+}
+
+TEST(Task, dedupResolution) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto gen = std::make_unique<GeneratorMockup>(std::initializer_list<double>{ 1.0, 2.0, 3.0 });
+	gen->setProperty("dedup_resolution", 1e-3);
+	auto* gen_ptr = gen.get();
+	t.add(std::move(gen));
+	auto fwd = std::make_unique<ForwardMockup>();
+	auto* fwd_ptr = fwd.get();
+	t.add(std::move(fwd));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(gen_ptr->solutions().size(), 3u);  // duplicates are still stored as solutions
+	EXPECT_EQ(fwd_ptr->runs_, 1u);  // but only the first one is propagated
+	EXPECT_EQ(t.solutions().size(), 1u);
+}
+
+TEST(PredicateFilter, statePredicate) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<GeneratorMockup>(std::initializer_list<double>{ 1.0, 2.0, 3.0 }));
+	auto fwd = std::make_unique<ForwardMockup>();
+	auto* fwd_ptr = fwd.get();
+	auto filter = std::make_unique<stages::PredicateFilter>("filter", std::move(fwd));
+	size_t num_states = 0;
+	filter->setStatePredicate([&num_states](const InterfaceState& /*state*/, std::string& comment) {
+		comment = "rejected";
+		return ++num_states != 2;  // reject the second state
+	});
+	auto* filter_ptr = filter.get();
+	t.add(std::move(filter));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(num_states, 3u);
+	EXPECT_EQ(fwd_ptr->runs_, 2u);  // the rejected state is not passed to the child
+	EXPECT_EQ(t.solutions().size(), 2u);
+	ASSERT_EQ(filter_ptr->failures().size(), 1u);
+	EXPECT_EQ(filter_ptr->failures().front()->comment(), "rejected");
+}
+
+TEST(Memoize, replayAfterReset) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto scene = std::make_shared<planning_scene::PlanningScene>(t.getRobotModel());
+	t.add(std::make_unique<stages::FixedState>("start", scene));
+	auto fwd = std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0));
+	auto* fwd_ptr = fwd.get();
+	auto memoize = std::make_unique<stages::Memoize>("memoize", std::move(fwd));
+	auto* memoize_ptr = memoize.get();
+	t.add(std::move(memoize));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 1u);
+	EXPECT_EQ(memoize_ptr->misses(), 1u);
+	EXPECT_EQ(memoize_ptr->cacheSize(), 1u);
+
+	// identical input: the cached solution is replayed without computing the child
+	t.reset();
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 1u);
+	EXPECT_EQ(memoize_ptr->hits(), 1u);
+	ASSERT_EQ(t.solutions().size(), 1u);
+	EXPECT_EQ(t.solutions().front()->cost(), 1.0);
+
+	// modified start state: the child is computed again
+	t.reset();
+	auto& state = scene->getCurrentStateNonConst();
+	state.setVariablePosition(0, state.getVariablePosition(0) + 0.1);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 2u);
+	EXPECT_EQ(memoize_ptr->misses(), 2u);
+	EXPECT_EQ(memoize_ptr->cacheSize(), 2u);
+}
+
+TEST(Memoize, boundedCache) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto scene = std::make_shared<planning_scene::PlanningScene>(t.getRobotModel());
+	t.add(std::make_unique<stages::FixedState>("start", scene));
+	auto fwd = std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0));
+	auto* fwd_ptr = fwd.get();
+	auto memoize = std::make_unique<stages::Memoize>("memoize", std::move(fwd));
+	auto* memoize_ptr = memoize.get();
+	memoize->setMaxCacheSize(1);
+	t.add(std::move(memoize));
+
+	auto& state = scene->getCurrentStateNonConst();
+	const double position = state.getVariablePosition(0);
+	EXPECT_TRUE(t.plan());
+	t.reset();
+	state.setVariablePosition(0, position + 0.1);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 2u);
+	EXPECT_EQ(memoize_ptr->cacheSize(), 1u);
+
+	// the first key was dropped in favor of the second one
+	t.reset();
+	state.setVariablePosition(0, position);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 3u);
+	EXPECT_EQ(memoize_ptr->hits(), 0u);
+	EXPECT_EQ(memoize_ptr->cacheSize(), 1u);
+}
+
+TEST(Memoize, childPropertiesInKey) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	t.add(std::make_unique<stages::FixedState>("start", std::make_shared<planning_scene::PlanningScene>(getModel())));
+	auto fwd = std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0));
+	auto* fwd_ptr = fwd.get();
+	t.add(std::make_unique<stages::Memoize>("memoize", std::move(fwd)));
+
+	EXPECT_TRUE(t.plan());
+	t.reset();
+	fwd_ptr->setTimeout(2.0);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 2u);
+
+	// unchanged properties hit the cache again
+	t.reset();
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 2u);
+}
+
+TEST(Memoize, pendingKeyComputedOnce) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	// both (identical) states are spawned before the child computes the first one
+	t.add(std::make_unique<GeneratorMockup>(std::initializer_list<double>{ 1.0, 2.0 }, 2));
+	auto fwd = std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0));
+	auto* fwd_ptr = fwd.get();
+	auto memoize = std::make_unique<stages::Memoize>("memoize", std::move(fwd));
+	auto* memoize_ptr = memoize.get();
+	t.add(std::move(memoize));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(fwd_ptr->runs_, 1u);
+	EXPECT_EQ(memoize_ptr->misses(), 1u);
+	EXPECT_EQ(memoize_ptr->hits(), 1u);
+	ASSERT_EQ(t.solutions().size(), 2u);
+	EXPECT_EQ(t.solutions().front()->cost(), 2.0);
+	EXPECT_EQ(t.solutions().back()->cost(), 3.0);
+}
+
+TEST(SharedPrefix, plannedOnce) {
+	resetMockupIds();
+	Task prefix;
+	prefix.setRobotModel(getModel());
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	prefix.add(std::make_unique<stages::FixedState>("start", scene));
+	auto fwd = std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0));
+	auto* fwd_ptr = fwd.get();
+	prefix.add(std::move(fwd));
+	auto source = std::make_shared<stages::SharedPrefix::Source>(std::move(prefix));
+
+	std::vector<Task> tasks(2);
+	for (Task& t : tasks) {
+		t.setRobotModel(getModel());
+		t.add(std::make_unique<stages::SharedPrefix>("prefix", source));
+		t.add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(2.0)));
+	}
+	for (Task& t : tasks) {
+		EXPECT_TRUE(t.plan());
+		ASSERT_EQ(t.solutions().size(), 1u);
+		EXPECT_EQ(t.solutions().front()->cost(), 3.0);
+
+		// the solution comprises the prefix trajectories
+		moveit_task_constructor_msgs::Solution msg;
+		t.solutions().front()->toMsg(msg);
+		EXPECT_EQ(msg.sub_trajectory.size(), 3u);
+	}
+	EXPECT_EQ(fwd_ptr->runs_, 1u);
+	EXPECT_EQ(source->runs(), 1u);
+}
+
+TEST(Recorder, traceRoundTrip) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	scene->setName("recorded");
+	t.add(std::make_unique<stages::FixedState>("start", scene));
+	auto fwd = std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0));
+	geometry_msgs::PoseStamped pose;
+	pose.header.frame_id = "world";
+	pose.pose.position.x = 0.5;
+	fwd->properties().set("target", pose);
+	auto recorder = std::make_unique<stages::Recorder>("recorder", std::move(fwd));
+	auto* recorder_ptr = recorder.get();
+	t.add(std::move(recorder));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 1u);
+
+	const std::string filename = ::testing::TempDir() + "stage_trace.bin";
+	recorder_ptr->save(filename);
+	const auto trace = stages::Recorder::load(filename);
+	EXPECT_EQ(trace.stage, "FWD1");
+	ASSERT_EQ(trace.inputs.size(), 1u);
+	EXPECT_EQ(trace.inputs.front().interface, moveit_task_constructor_msgs::StageInput::START);
+	EXPECT_EQ(trace.inputs.front().scene.name, "recorded");
+
+	// message-typed properties are restored from their ROS serialization
+	auto it = std::find_if(trace.properties.begin(), trace.properties.end(),
+	                       [](const moveit_task_constructor_msgs::RecordedProperty& p) { return p.name == "target"; });
+	ASSERT_NE(it, trace.properties.end());
+	boost::any value = stages::Recorder::decode(*it);
+	ASSERT_FALSE(value.empty());
+	EXPECT_EQ(boost::any_cast<geometry_msgs::PoseStamped>(value).pose.position.x, 0.5);
+
+	// planning again accumulates the inputs
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(recorder_ptr->size(), 2u);
+	recorder_ptr->clear();
+	EXPECT_EQ(recorder_ptr->size(), 0u);
+}
+
+// interfaces of adjacent stages are validated at compile time
+static_assert(detail::ValidSerial<GeneratorMockup, ConnectMockup, GeneratorMockup>::value, "");
+static_assert(detail::ValidSerial<GeneratorMockup, ForwardMockup>::value, "resolved at runtime");
+static_assert(!detail::ValidSerial<GeneratorMockup, GeneratorMockup>::value, "");
+static_assert(!detail::ValidSerial<GeneratorMockup, ConnectMockup, ConnectMockup>::value, "");
+
+// combinations merged concurrently are spawned in the same order as when merged sequentially
+TEST(Merger, concurrentMerging) {
+	auto plan = [](const ExecutionPolicy& policy) {
+		resetMockupIds();
+		Task t;
+		t.setRobotModel(getModel());
+		t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(0.0)));
+
+		auto merger = std::make_unique<Merger>();
+		auto arm = std::make_unique<Alternatives>("arm");
+		for (double cost : { 3.0, 1.0, 2.0 })
+			arm->add(std::make_unique<GroupForwardMockup>("group", PredefinedCosts::single(cost)));
+		auto eef = std::make_unique<Alternatives>("eef");
+		for (double cost : { 20.0, 10.0 })
+			eef->add(std::make_unique<GroupForwardMockup>("eef_group", PredefinedCosts::single(cost)));
+		merger->add(std::move(arm));
+		merger->add(std::move(eef));
+
+		std::vector<std::pair<double, size_t>> spawned;  // cost and number of waypoints
+		merger->addSolutionCallback([&spawned](const SolutionBase& s) {
+			const auto* trajectory = dynamic_cast<const SubTrajectory*>(&s);
+			ASSERT_TRUE(trajectory && trajectory->trajectory());
+			spawned.emplace_back(s.cost(), trajectory->trajectory()->getWayPointCount());
+		});
+		t.add(std::move(merger));
+		EXPECT_TRUE(t.plan(0, policy));
+		EXPECT_EQ(t.solutions().size(), 6u);
+		return spawned;
+	};
+
+	const auto sequential = plan(ExecutionPolicy::sequential());
+	ASSERT_EQ(sequential.size(), 6u);  // all combinations of 3 arm and 2 eef motions
+	EXPECT_EQ(plan(ExecutionPolicy::parallel(4)), sequential);
+}
+
+// max_merges and merge_timeout bound the combinations merged per new child solution, cheapest first
+TEST(Merger, mergeBudget) {
+	auto plan = [](const std::string& property, const boost::any& value) {
+		resetMockupIds();
+		Task t;
+		t.setRobotModel(getModel());
+		t.add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(0.0)));
+
+		auto merger = std::make_unique<Merger>();
+		merger->setProperty(property, value);
+		auto arm = std::make_unique<Alternatives>("arm");
+		for (double cost : { 3.0, 1.0, 2.0 })
+			arm->add(std::make_unique<GroupForwardMockup>("group", PredefinedCosts::single(cost)));
+		auto eef = std::make_unique<Alternatives>("eef");
+		for (double cost : { 20.0, 10.0 })
+			eef->add(std::make_unique<GroupForwardMockup>("eef_group", PredefinedCosts::single(cost)));
+		merger->add(std::move(arm));
+		merger->add(std::move(eef));
+		t.add(std::move(merger));
+		EXPECT_TRUE(t.plan());
+
+		std::vector<double> costs;
+		for (const auto& solution : t.solutions())
+			costs.push_back(solution->cost());
+		return costs;
+	};
+
+	EXPECT_EQ(plan("max_merges", 0u).size(), 6u);  // unlimited: all combinations
+	// a single merge for each of the 5 child solutions but the very first one, which has no partners yet
+	for (const auto& costs : { plan("max_merges", 1u), plan("merge_timeout", 0.0) }) {
+		ASSERT_FALSE(costs.empty());
+		EXPECT_LE(costs.size(), 4u);
+		EXPECT_EQ(*std::min_element(costs.begin(), costs.end()), 11.0);  // the best combination is always found
+	}
+}
+
+TEST(StaticSerial, plan) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto serial = std::make_unique<StaticSerial<GeneratorMockup, ForwardMockup>>();
+	auto* serial_ptr = serial.get();
+	t.add(std::move(serial));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 1u);
+	EXPECT_EQ(serial_ptr->numChildren(), 2u);
+	EXPECT_EQ(serial_ptr->get<0>().runs_, 1u);
+	EXPECT_EQ(serial_ptr->get<1>().runs_, 1u);
+	EXPECT_THROW(serial_ptr->remove(0), std::runtime_error);
+}
+
+TEST(TaskTemplate, instantiate) {
+	resetMockupIds();
+	TaskTemplate tmpl(
+	    [](Task& t) {
+		    t.add(std::make_unique<GeneratorMockup>());
+		    t.add(std::make_unique<ForwardMockup>());
+	    },
+	    getModel());
+	EXPECT_EQ(tmpl.prototype().stages()->numChildren(), 2u);
+
+	Task first = tmpl.instantiate("first", { { "timeout", boost::any(10.0) } });
+	Task second = tmpl.instantiate("second");
+	EXPECT_EQ(first.getRobotModel(), tmpl.getRobotModel());
+	EXPECT_EQ(second.getRobotModel(), tmpl.getRobotModel());
+	EXPECT_EQ(first.name(), "first");
+	EXPECT_EQ(first.stages()->properties().get<double>("timeout"), 10.0);
+
+	EXPECT_TRUE(first.plan());
+	EXPECT_TRUE(second.plan());
+	EXPECT_EQ(first.solutions().size(), 1u);
+	EXPECT_EQ(second.solutions().size(), 1u);
+	EXPECT_EQ(tmpl.prototype().solutions().size(), 0u);  // prototype isn't planned
+}
+
+TEST(PlanningServer, concurrentRequests) {
+	resetMockupIds();
+	TaskTemplate tmpl(
+	    [](Task& t) {
+		    t.add(std::make_unique<GeneratorMockup>());
+		    t.add(std::make_unique<TimedForwardMockup>(std::chrono::milliseconds(10)));
+	    },
+	    getModel());
+	PlanningServer server(tmpl, 2);
+	EXPECT_EQ(server.numThreads(), 2u);
+
+	std::vector<std::future<PlanningServer::Result>> results;
+	for (size_t i = 0; i < 4; ++i) {
+		PlanningServer::Request request;
+		request.name = "request " + std::to_string(i);
+		request.properties["timeout"] = 10.0;
+		results.push_back(server.submit(std::move(request)));
+	}
+
+	for (size_t i = 0; i < results.size(); ++i) {
+		PlanningServer::Result result = results[i].get();
+		EXPECT_TRUE(result.error_code);
+		EXPECT_EQ(result.task.name(), "request " + std::to_string(i));
+		EXPECT_EQ(result.task.solutions().size(), 1u);
+		EXPECT_EQ(result.task.getRobotModel(), tmpl.getRobotModel());
+		EXPECT_GE(result.planning_time, 0.01);
+		EXPECT_GE(result.latency, result.queue_time + result.planning_time);
+	}
+	EXPECT_EQ(server.pending(), 0u);
+}
+
+TEST(PlanningServer, streamSolutions) {
+	resetMockupIds();
+	TaskTemplate tmpl(
+	    [](Task& t) {
+		    t.add(std::make_unique<GeneratorMockup>(std::initializer_list<double>{ 3.0, 2.0, 1.0 }));
+		    t.add(std::make_unique<ForwardMockup>());
+	    },
+	    getModel());
+	PlanningServer server(tmpl, 1);
+
+	PlanningServer::Request request;
+	request.max_solutions = 0;  // plan exhaustively
+	std::vector<double> streamed;
+	request.on_solution = [&streamed](const SolutionBase& s) { streamed.push_back(s.cost()); };
+	PlanningServer::Result result = server.submit(std::move(request)).get();
+	EXPECT_TRUE(result.error_code);
+	EXPECT_EQ(streamed, (std::vector<double>{ 3.0, 2.0, 1.0 }));  // in the order of discovery
+	EXPECT_EQ(result.task.solutions().size(), 3u);
+}
+
+// a template failing to instantiate the task reports the failure to the request, keeping the worker alive
+TEST(PlanningServer, failingInstantiation) {
+	resetMockupIds();
+	std::atomic<size_t> builds{ 0 };
+	TaskTemplate tmpl(
+	    [&builds](Task& t) {
+		    if (builds++ > 0)  // only the prototype is built successfully
+			    throw std::runtime_error("build failed");
+		    t.add(std::make_unique<GeneratorMockup>());
+	    },
+	    getModel());
+	PlanningServer server(tmpl, 1);
+
+	for (size_t i = 0; i < 2; ++i) {
+		std::future<PlanningServer::Result> result = server.submit(PlanningServer::Request());
+		EXPECT_THROW(result.get(), std::runtime_error);
+	}
+	EXPECT_EQ(server.pending(), 0u);
+}
+
+TEST(PlanningServer, cancelledRequest) {
+	resetMockupIds();
+	TaskTemplate tmpl([](Task& t) { t.add(std::make_unique<GeneratorMockup>()); }, getModel());
+	PlanningServer server(tmpl, 1);
+
+	PlanningServer::Request request;
+	request.cancellation.cancel();
+	PlanningServer::Result result = server.submit(std::move(request)).get();
+	EXPECT_EQ(result.error_code.val, moveit::core::MoveItErrorCode::PREEMPTED);
+	EXPECT_EQ(result.task.solutions().size(), 0u);
+}
@@ -177,3 +177,73 @@ TEST_F(CostOrderedTestInt, update) {
 	EXPECT_EQ(queue.top(), first);
 	EXPECT_EQ(*(++queue.begin()), added);
 }
+
+class IndexedOrderedTest : public ::testing::Test, public indexed_ordered<int*>
+{
+protected:
+	std::list<int> storage;
+	int* add(int v) {
+		storage.push_back(v);
+		insert(&storage.back());
+		return &storage.back();
+	}
+	std::vector<int> values() const {
+		std::vector<int> result;
+		std::transform(begin(), end(), std::back_inserter(result), [](int* item) { return *item; });
+		return result;
+	}
+};
+
+TEST_F(IndexedOrderedTest, sorting) {
+	for (int v : { 3, 1, 4, 1, 5, 9, 2, 6 })
+		add(v);
+	EXPECT_THAT(values(), ::testing::ElementsAre(1, 1, 2, 3, 4, 5, 6, 9));
+	while (!empty())
+		pop();
+	EXPECT_TRUE(nodes_.empty() && index_.empty());
+}
+
+TEST_F(IndexedOrderedTest, stableInsertion) {
+	int* first = add(1);
+	int* second = add(1);
+	EXPECT_EQ(front(), first);
+	EXPECT_EQ(*std::next(begin()), second);
+}
+
+TEST_F(IndexedOrderedTest, merge) {
+	int* first = add(2);
+	add(5);
+	std::list<int> other_storage{ 7, 2, 1 };
+	container_type other;
+	for (int& v : other_storage)
+		other.push_back(&v);
+	merge(other);
+	EXPECT_TRUE(other.empty());
+	EXPECT_THAT(values(), ::testing::ElementsAre(1, 2, 2, 5, 7));
+	EXPECT_EQ(*std::next(begin()), first);  // existing items precede merged ones of same value
+	EXPECT_NE(find(&other_storage.front()), end());
+}
+
+TEST_F(IndexedOrderedTest, update) {
+	int* one = add(1);
+	add(2);
+	int* three = add(3);
+
+	auto it = find(one);
+	ASSERT_NE(it, end());
+	*one = 4;
+	update(it);
+	EXPECT_THAT(values(), ::testing::ElementsAre(2, 3, 4));
+	EXPECT_EQ(back(), one);
+
+	// updated item is inserted behind items with same value
+	it = find(three);
+	*three = 4;
+	update(it);
+	EXPECT_THAT(values(), ::testing::ElementsAre(2, 4, 4));
+	EXPECT_EQ(back(), three);
+
+	erase(find(one));
+	EXPECT_EQ(find(one), end());
+	EXPECT_THAT(values(), ::testing::ElementsAre(2, 4));
+}
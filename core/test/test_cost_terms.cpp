@@ -11,6 +11,10 @@
 
 #include <gtest/gtest.h>
 
+#include <mutex>
+#include <set>
+#include <thread>
+
 #include "stage_mockups.h"
 
 using namespace moveit::task_constructor;
@@ -346,3 +350,150 @@ TEST(CostTerm, CompositeSolutionsContainerCost) {
 	    << "container cost term overwrites stage costs";
 	EXPECT_EQ(s1_ptr->solutions().front()->cost(), STAGE_COST) << "child cost is not affected";
 }
+
+TEST(CostTerm, JointDistances) {
+	const moveit::core::RobotModelConstPtr robot{ getModel() };
+	auto traj{ std::make_shared<robot_trajectory::RobotTrajectory>(robot, nullptr) };
+	moveit::core::RobotState state(robot);
+	for (double position : { 0.0, 1.0, -3.0, 3.0, 10.0 }) {
+		state.setVariablePositions(std::vector<double>(robot->getVariableCount(), position));
+		traj->addSuffixWayPoint(state, 1.0);
+	}
+	SubTrajectory solution(traj);
+
+	double expected{ 0.0 };
+	for (size_t i = 1; i < traj->getWayPointCount(); ++i)
+		expected += traj->getWayPoint(i - 1).distance(traj->getWayPoint(i));
+
+	std::string comment;
+	cost::PathLength path_length;
+	EXPECT_DOUBLE_EQ(path_length(solution, comment), expected);
+	EXPECT_DOUBLE_EQ(path_length(solution, comment), expected) << "cached kernel yields same result";
+
+	// restrict to a single, weighted joint
+	const moveit::core::JointModel* jm{ robot->getActiveJointModels().front() };
+	path_length.joints = { { jm->getName(), 2.0 } };
+	expected = 0.0;
+	for (size_t i = 1; i < traj->getWayPointCount(); ++i)
+		expected += 2.0 * traj->getWayPoint(i - 1).distance(traj->getWayPoint(i), jm);
+	EXPECT_DOUBLE_EQ(path_length(solution, comment), expected) << "kernel follows changed joint weights";
+}
+
+TEST(CostTerm, ScopedBound) {
+	const double inf{ std::numeric_limits<double>::infinity() };
+	EXPECT_EQ(CostTerm::bound(), inf) << "costs are not bounded by default";
+	{
+		CostTerm::ScopedBound outer(3.0);
+		EXPECT_EQ(CostTerm::bound(), 3.0);
+		{
+			CostTerm::ScopedBound inner(1.0);
+			EXPECT_EQ(CostTerm::bound(), 1.0);
+		}
+		EXPECT_EQ(CostTerm::bound(), 3.0) << "nested bound restores previous one";
+	}
+	EXPECT_EQ(CostTerm::bound(), inf);
+}
+
+TEST(CostTerm, MemoizedCost) {
+	struct CountingCostTerm : public TrajectoryCostTerm
+	{
+		mutable size_t calls{ 0 };
+		double operator()(const SubTrajectory& /*s*/, std::string& comment) const override {
+			++calls;
+			comment = "counted";
+			return TERM_COST;
+		}
+	} term;
+
+	SubTrajectory solution;
+	SolutionSequence sequence({ &solution, &solution });
+	std::string comment;
+	EXPECT_EQ(sequence.computeCost(term, comment), 2 * TERM_COST);
+	EXPECT_EQ(term.calls, 1u) << "shared sub solution is evaluated once";
+
+	comment.clear();
+	EXPECT_EQ(solution.computeCost(term, comment), TERM_COST);
+	EXPECT_EQ(comment, "counted") << "memoized comment is restored";
+	EXPECT_EQ(term.calls, 1u);
+
+	// costs reaching the bound might be inexact and are not memoized
+	SubTrajectory bounded;
+	CostTerm::ScopedBound bound(TERM_COST);
+	bounded.computeCost(term, comment);
+	bounded.computeCost(term, comment);
+	EXPECT_EQ(term.calls, 3u);
+}
+
+TEST(CostTerm, TieredDeferredCosts) {
+	// deferred cost reverses the ranking of the generator's solutions
+	struct ReversingCostTerm : public TrajectoryCostTerm
+	{
+		mutable size_t calls{ 0 };
+		double operator()(const SubTrajectory& s, std::string& comment) const override {
+			++calls;
+			comment = "deferred";
+			const double generator_cost = s.start()->incomingTrajectories().front()->cost();
+			return std::max(0.0, 3.0 * (2.0 - generator_cost));
+		}
+	};
+	auto deferred{ std::make_shared<ReversingCostTerm>() };
+	auto immediate{ std::make_shared<cost::Constant>(TERM_COST) };
+
+	auto plan = [&](size_t top_k) {
+		resetMockupIds();
+		deferred->calls = 0;
+		Task t("", false);
+		t.setRobotModel(getModel());
+		t.setDeferredCostsTopK(top_k);
+		t.add(std::make_unique<GeneratorMockup>(PredefinedCosts{ { 0.0, 1.0, 2.0, 10.0 } }));
+		auto forward{ std::make_unique<ForwardMockup>() };
+		auto tiered{ std::make_shared<cost::Tiered>() };
+		tiered->add(immediate);
+		tiered->add(deferred, cost::Tiered::Tier::DEFERRED);
+		forward->setCostTerm(tiered);
+		t.add(std::move(forward));
+		EXPECT_TRUE(t.plan());
+
+		std::vector<double> costs;
+		for (const auto& s : t.solutions())
+			costs.push_back(s->cost());
+		return costs;
+	};
+
+	// total costs 1, 2, 3 of generator costs 0, 1, 2 turn into 7, 5, 3 after evaluation
+	EXPECT_EQ(plan(1), std::vector<double>({ 3.0, 5.0, 7.0, 11.0 }));
+	EXPECT_EQ(deferred->calls, 3u) << "solutions dropping out of the top-k are replaced until the best is evaluated";
+
+	EXPECT_EQ(plan(0), std::vector<double>({ 3.0, 5.0, 7.0, 11.0 }));
+	EXPECT_EQ(deferred->calls, 4u) << "all solutions are evaluated with top-k = 0";
+}
+
+TEST(CostTerm, AsyncCost) {
+	resetMockupIds();
+	Task t("", false);
+	t.setRobotModel(getModel());
+	t.setAsyncCost();
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts{ { 3.0, 1.0, 2.0 } }));
+	auto forward{ std::make_unique<ForwardMockup>() };
+	std::set<std::thread::id> threads;
+	size_t linked_starts = 0;
+	std::mutex mutex;
+	forward->setCostTerm([&](const SubTrajectory& s) {
+		std::lock_guard<std::mutex> lock(mutex);
+		threads.insert(std::this_thread::get_id());
+		if (!s.start()->incomingTrajectories().empty())
+			++linked_starts;
+		return 1.0;
+	});
+	t.add(std::move(forward));
+
+	EXPECT_TRUE(t.plan());
+	std::vector<double> costs;
+	for (const auto& s : t.solutions())
+		costs.push_back(s->cost());
+	EXPECT_EQ(costs, std::vector<double>({ 2.0, 3.0, 4.0 })) << "all solutions are stored once evaluated";
+
+	std::lock_guard<std::mutex> lock(mutex);
+	EXPECT_EQ(threads.count(std::this_thread::get_id()), 0u) << "costs are evaluated in the background";
+	EXPECT_EQ(linked_starts, 0u) << "cost terms see copies of the start states";
+}
@@ -3,6 +3,7 @@
 #include <moveit/task_constructor/task_p.h>
 #include <moveit/task_constructor/stages/fixed_state.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 
 #include "stage_mockups.h"
 #include "models.h"
@@ -29,6 +30,20 @@ TEST_F(FallbacksFixtureGenerator, stayWithFirstSuccessful) {
 	EXPECT_EQ(t.solutions().front()->cost(), 1.0);
 }
 
+// speculatively computed children must not change the result
+TEST_F(FallbacksFixtureGenerator, speculativeParallel) {
+	auto fallback = std::make_unique<Fallbacks>("Fallbacks");
+	fallback->setProperty("speculative", true);
+	fallback->add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(INF)));
+	fallback->add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(1.0)));
+	fallback->add(std::make_unique<GeneratorMockup>(PredefinedCosts::single(2.0)));
+	t.add(std::move(fallback));
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::parallel(4)));
+	ASSERT_EQ(t.solutions().size(), 1u);
+	EXPECT_EQ(t.solutions().front()->cost(), 1.0);
+}
+
 using FallbacksFixturePropagate = TaskTestBase;
 
 TEST_F(FallbacksFixturePropagate, failingNoSolutions) {
@@ -81,6 +96,21 @@ TEST_F(FallbacksFixturePropagate, computeFirstSuccessfulStagePerSolutionOnly) {
 	EXPECT_COSTS(t.solutions(), testing::ElementsAre(113, 124, 212, 221));
 }
 
+TEST_F(FallbacksFixturePropagate, speculativeParallel) {
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 2.0, 1.0 })));
+	// duplicate generator solutions with resulting costs: 4, 2 | 3, 1
+	t.add(std::make_unique<ForwardMockup>(PredefinedCosts({ 2.0, 0.0, 2.0, 0.0 }), 2));
+
+	auto fallbacks = std::make_unique<Fallbacks>("Fallbacks");
+	fallbacks->setProperty("speculative", true);
+	fallbacks->add(std::make_unique<ForwardMockup>(PredefinedCosts({ INF, INF, 110.0, 120.0 })));
+	fallbacks->add(std::make_unique<ForwardMockup>(PredefinedCosts({ 210.0, 220.0, 0, 0 })));
+	t.add(std::move(fallbacks));
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::parallel(4)));
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(113, 124, 212, 221));
+}
+
 // requires individual job control in Fallbacks's children
 TEST_F(FallbacksFixturePropagate, DISABLED_updateSolutionOrder) {
 	t.add(std::make_unique<BackwardMockup>(PredefinedCosts({ 10.0, 0.0 })));
@@ -174,3 +204,134 @@ TEST_F(FallbacksFixtureConnect, connectStageInsideFallbacks) {
 	EXPECT_TRUE(t.plan());
 	EXPECT_COSTS(t.solutions(), testing::ElementsAre(11, 12, 22, 121));
 }
+
+TEST_F(FallbacksFixtureConnect, connectStagesInParallel) {
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0 })));
+
+	auto fallbacks = std::make_unique<Fallbacks>("Fallbacks");
+	fallbacks->add(std::make_unique<ConnectMockup>(PredefinedCosts::constant(INF)));
+	fallbacks->add(std::make_unique<ConnectMockup>(PredefinedCosts::constant(100.0)));
+	t.add(std::move(fallbacks));
+
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 10.0, 20.0 })));
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::parallel(4)));
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(111, 112, 121, 122));
+}
+
+// evicting a state of the first child forgets the pairs passed on to later children as explicit pairs
+TEST_F(FallbacksFixtureConnect, evictStates) {
+	auto gen = add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	auto fallbacks = add(t, new Fallbacks("Fallbacks"));
+	auto con1 = add(*fallbacks, new ConnectMockup(PredefinedCosts::constant(INF)));
+	auto con2 = add(*fallbacks, new ConnectMockup(PredefinedCosts::constant(100.0)));
+	auto goal = add(t, new GeneratorMockup({ 10.0 }));
+	t.init();
+
+	gen->pimpl()->runCompute();
+	gen->pimpl()->runCompute();
+	goal->pimpl()->runCompute();
+	while (con1->pimpl()->canCompute())
+		con1->pimpl()->runCompute();
+	EXPECT_EQ(con1->runs_, 2u);  // both pairs failed and were passed on to con2
+
+	// disable the worse start state, such that it is evicted
+	InterfacePtr starts = con1->pimpl()->starts();
+	ASSERT_EQ(starts->size(), 2u);
+	InterfaceState* worse = *std::next(starts->begin());
+	starts->updatePriority(worse, InterfaceState::Priority(worse->priority(), InterfaceState::PRUNED));
+	const size_t num_links = fallbacks->pimpl()->internalToExternalMap().size();
+
+	t.pimpl()->degradeMemory(TaskPrivate::DROP_FAILURES);
+	t.pimpl()->degradeMemory(TaskPrivate::EVICT_STATES);
+	EXPECT_EQ(starts->size(), 1u);
+	// only dropped failures used the evicted copy, so it was freed
+	EXPECT_EQ(fallbacks->pimpl()->internalToExternalMap().size(), num_links - 1);
+
+	while (con2->pimpl()->canCompute())
+		con2->pimpl()->runCompute();
+	EXPECT_EQ(con2->runs_, 1u);
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(111));
+}
+
+using AlternativesFixture = TaskTestBase;
+
+TEST_F(AlternativesFixture, computeChildrenInParallel) {
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0 })));
+
+	auto alternatives = std::make_unique<Alternatives>("Alternatives");
+	alternatives->add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(10.0)));
+	alternatives->add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(20.0)));
+	t.add(std::move(alternatives));
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::parallel(4)));
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(11, 12, 21, 22));
+}
+
+// children only receive the states admitted for them
+TEST_F(AlternativesFixture, admission) {
+	t.add(std::make_unique<GeneratorMockup>(PredefinedCosts({ 1.0, 2.0 })));
+
+	auto alternatives = std::make_unique<Alternatives>("Alternatives");
+	auto first = new ForwardMockup(PredefinedCosts::constant(10.0));
+	auto second = new ForwardMockup(PredefinedCosts::constant(20.0));
+	alternatives->add(Stage::pointer(first));
+	alternatives->add(Stage::pointer(second));
+	alternatives->setAdmission(second, [](const InterfaceState& state, Interface::Direction dir) {
+		EXPECT_EQ(dir, Interface::FORWARD);
+		return state.priority().cost() < 1.5;
+	});
+	t.add(std::move(alternatives));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(11, 12, 21));
+	EXPECT_EQ(first->runs_, 2u);
+	EXPECT_EQ(second->runs_, 1u);
+	EXPECT_EQ(second->pimpl()->starts()->size(), 1u);
+}
+
+// the task keeps only the cheapest of identical solutions
+TEST_F(AlternativesFixture, solutionDedup) {
+	add(t, new GeneratorMockup({ 0.0 }));
+
+	auto alternatives = new Alternatives("Alternatives");
+	alternatives->add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(2.0)));
+	alternatives->add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(1.0)));
+	alternatives->add(std::make_unique<ForwardMockup>(PredefinedCosts::constant(3.0)));
+	add(t, alternatives);
+	t.setProperty("solution_dedup_resolution", 1e-3);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1));
+	EXPECT_EQ(alternatives->solutions().size(), 3u);
+}
+
+// Forward stage moving the first joint to position in a single waypoint
+struct PositionForward : public PropagatingForward
+{
+	double position_;
+	double cost_;
+	PositionForward(double position, double cost) : PropagatingForward("POSITION"), position_(position), cost_(cost) {}
+	void computeForward(const InterfaceState& from) override {
+		auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(from.scene()->getRobotModel(), nullptr);
+		moveit::core::RobotState state(from.scene()->getCurrentState());
+		state.setVariablePosition(0, position_);
+		trajectory->addSuffixWayPoint(state, 0.0);
+		sendForward(from, InterfaceState(from.scene()), SubTrajectory(trajectory, cost_));
+	}
+};
+
+// solutions are compared on a hash hit: distinct trajectories are kept, identical ones across a bin edge are not
+TEST_F(AlternativesFixture, solutionDedupCompares) {
+	add(t, new GeneratorMockup({ 0.0 }));
+
+	auto alternatives = new Alternatives("Alternatives");
+	alternatives->add(std::make_unique<PositionForward>(0.0004999, 2.0));
+	alternatives->add(std::make_unique<PositionForward>(0.0005001, 1.0));
+	alternatives->add(std::make_unique<PositionForward>(0.3, 3.0));
+	add(t, alternatives);
+	t.setProperty("solution_dedup_resolution", 1e-3);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), testing::ElementsAre(1, 3));
+}
@@ -0,0 +1,84 @@
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/stages/fix_collision_objects.h>
+#include <moveit/task_constructor/stages/fixed_state.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
+
+#include <gtest/gtest.h>
+
+using namespace moveit::task_constructor;
+
+// a robot consisting of a single box, penetrated by a world object along the x-axis
+struct FixCollisionObjectsTest : public testing::Test
+{
+	Task t;
+	stages::FixCollisionObjects* fix;
+
+	FixCollisionObjectsTest() {
+		moveit::core::RobotModelBuilder builder("robot", "base");
+		builder.addChain("base->tip", "fixed");
+		geometry_msgs::Pose origin;
+		origin.orientation.w = 1.0;
+		builder.addCollisionBox("base", { 0.2, 0.2, 0.2 }, origin);
+		t.setRobotModel(builder.build());
+
+		auto scene = std::make_shared<planning_scene::PlanningScene>(t.getRobotModel());
+		scene->getCurrentStateNonConst().setToDefaultValues();
+		scene->getWorldNonConst()->addToObject("box", std::make_shared<const shapes::Box>(0.1, 0.1, 0.1),
+		                                       Eigen::Isometry3d(Eigen::Translation3d(0.12, 0.0, 0.0)));
+		t.add(std::make_unique<stages::FixedState>("start", scene));
+
+		auto stage = std::make_unique<stages::FixCollisionObjects>();
+		stage->setMaxPenetration(0.1);
+		fix = stage.get();
+		t.add(std::move(stage));
+	}
+
+	// position of the corrected box, validating that the robot is collision-free
+	Eigen::Vector3d correctedPosition() {
+		EXPECT_EQ(t.solutions().size(), 1u);
+		const planning_scene::PlanningSceneConstPtr& scene = t.solutions().front()->end()->scene();
+		EXPECT_FALSE(scene->isStateColliding());
+		return scene->getWorld()->getObject("box")->pose_.translation();
+	}
+};
+
+TEST_F(FixCollisionObjectsTest, perContact) {
+	ASSERT_TRUE(t.plan());
+	EXPECT_GT(correctedPosition().x(), 0.15);
+}
+
+// a single contact normal leaves the normal equations rank-deficient, solved by the minimal norm solution
+TEST_F(FixCollisionObjectsTest, jointCorrection) {
+	fix->setJointCorrection(true);
+	ASSERT_TRUE(t.plan());
+	const Eigen::Vector3d position = correctedPosition();
+	EXPECT_GT(position.x(), 0.15);
+	EXPECT_NEAR(position.y(), 0.0, 1e-3);
+	EXPECT_NEAR(position.z(), 0.0, 1e-3);
+}
+
+TEST_F(FixCollisionObjectsTest, jointCorrectionAlongAxis) {
+	fix->setJointCorrection(true);
+	geometry_msgs::Vector3 direction;
+	direction.x = 2.0;  // normalized by the stage
+	direction.y = 1.0;
+	fix->setDirection(direction);
+	ASSERT_TRUE(t.plan());
+	const Eigen::Vector3d position = correctedPosition();
+	EXPECT_GT(position.x(), 0.15);
+	EXPECT_NEAR(position.y(), 0.5 * (position.x() - 0.12), 1e-9);  // moved along the axis only
+	EXPECT_EQ(position.z(), 0.0);
+}
+
+// an axis orthogonal to the penetration cannot resolve it within max_penetration
+TEST_F(FixCollisionObjectsTest, jointCorrectionOrthogonalAxis) {
+	fix->setJointCorrection(true);
+	geometry_msgs::Vector3 direction;
+	direction.z = 1.0;
+	fix->setDirection(direction);
+	EXPECT_FALSE(t.plan());
+	EXPECT_EQ(fix->numFailures(), 1u);
+}
@@ -0,0 +1,112 @@
+#include <moveit/task_constructor/flat_map.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+using namespace moveit::task_constructor::utils;
+
+TEST(SmallVector, spill) {
+	std::vector<int> values(5);
+	SmallVector<const int*, 2> v;
+	EXPECT_TRUE(v.empty());
+	for (const int& value : values)
+		v.push_back(&value);
+	ASSERT_EQ(v.size(), values.size());
+	for (size_t i = 0; i < values.size(); ++i)
+		EXPECT_EQ(v[i], &values[i]);
+
+	SmallVector<const int*, 2> copy(v);
+	EXPECT_TRUE(std::equal(copy.begin(), copy.end(), v.begin()));
+	v.clear();
+	EXPECT_TRUE(v.empty());
+	EXPECT_EQ(copy.size(), values.size());
+}
+
+TEST(SmallVector, erase) {
+	SmallVector<int, 2> v;
+	for (int i = 0; i < 5; ++i)
+		v.push_back(i);
+	v.erase(std::remove(v.begin(), v.end(), 3), v.end());
+	EXPECT_EQ(std::vector<int>(v.begin(), v.end()), std::vector<int>({ 0, 1, 2, 4 }));
+	// shrinking below N moves elements back to inline storage
+	v.erase(v.begin() + 1, v.begin() + 3);
+	EXPECT_EQ(std::vector<int>(v.begin(), v.end()), std::vector<int>({ 0, 4 }));
+	v.pop_back();
+	ASSERT_EQ(v.size(), 1u);
+	EXPECT_EQ(v.front(), 0);
+	EXPECT_EQ(v.back(), 0);
+	v.erase(v.begin());
+	EXPECT_TRUE(v.empty());
+}
+
+TEST(FlatPointerMap, insertFind) {
+	std::vector<int> keys(1000);
+	FlatPointerMap<const int*, size_t> map;
+	EXPECT_EQ(map.find(&keys[0]), map.end());
+	for (size_t i = 0; i < keys.size(); ++i)
+		EXPECT_TRUE(map.insert(std::make_pair(&keys[i], i)).second);
+	EXPECT_EQ(map.size(), keys.size());
+
+	// an existing entry is not overwritten
+	auto result = map.insert(std::make_pair(&keys[42], 0));
+	EXPECT_FALSE(result.second);
+	EXPECT_EQ(result.first->second, 42u);
+
+	for (size_t i = 0; i < keys.size(); ++i)
+		EXPECT_EQ(map.at(&keys[i]), i);
+	int other;
+	EXPECT_EQ(map.count(&other), 0u);
+	EXPECT_THROW(map.at(&other), std::out_of_range);
+
+	// iteration visits every entry once
+	std::set<size_t> visited;
+	for (const auto& entry : map)
+		EXPECT_TRUE(visited.insert(entry.second).second);
+	EXPECT_EQ(visited.size(), keys.size());
+
+	map.clear();
+	EXPECT_TRUE(map.empty());
+	EXPECT_EQ(map.begin(), map.end());
+}
+
+TEST(FlatPointerMap, erase) {
+	std::vector<int> keys(1000);
+	FlatPointerMap<const int*, size_t> map;
+	for (size_t i = 0; i < keys.size(); ++i)
+		map.insert(std::make_pair(&keys[i], i));
+	int other;
+	EXPECT_EQ(map.erase(&other), 0u);
+
+	// erasing every other entry keeps the remaining ones reachable
+	for (size_t i = 0; i < keys.size(); i += 2)
+		EXPECT_EQ(map.erase(&keys[i]), 1u);
+	EXPECT_EQ(map.size(), keys.size() / 2);
+	for (size_t i = 0; i < keys.size(); ++i) {
+		if (i % 2)
+			EXPECT_EQ(map.at(&keys[i]), i);
+		else
+			EXPECT_EQ(map.count(&keys[i]), 0u);
+	}
+	size_t visited = 0;
+	for (const auto& entry : map)
+		visited += entry.second % 2;
+	EXPECT_EQ(visited, map.size());
+
+	// erased keys can be inserted again
+	EXPECT_TRUE(map.insert(std::make_pair(&keys[0], 0)).second);
+	EXPECT_EQ(map.at(&keys[0]), 0u);
+}
+
+TEST(FlatPointerMap, oneToMany) {
+	int external, internal[3];
+	FlatPointerMap<const int*, SmallVector<const int*>> map;
+	for (const int& i : internal)
+		map[&external].push_back(&i);
+	ASSERT_EQ(map.size(), 1u);
+	EXPECT_EQ(map.at(&external).size(), 3u);
+	EXPECT_EQ(map.at(&external)[2], &internal[2]);
+}
@@ -0,0 +1,116 @@
+#include "models.h"
+#include "stage_mockups.h"
+
+#include <moveit/task_constructor/grasp_database.h>
+#include <moveit/task_constructor/stages/fixed_state.h>
+#include <moveit/task_constructor/stages/stream_grasp_poses.h>
+#include <moveit/task_constructor/task.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <unistd.h>
+
+using namespace moveit::task_constructor;
+using utils::GraspDatabase;
+
+namespace {
+// n grasps rotated about the z-axis, quality increasing with the index
+GraspDatabase::Grasps rotatedGrasps(size_t n) {
+	GraspDatabase::Grasps grasps;
+	for (size_t i = 0; i < n; ++i) {
+		GraspDatabase::Grasp grasp;
+		grasp.pose = Eigen::AngleAxisd(0.1 * i, Eigen::Vector3d::UnitZ());
+		grasp.pose.translation() = Eigen::Vector3d(0.0, 0.0, 0.01 * i);
+		grasp.quality = 0.1 * i;
+		grasps.push_back(grasp);
+	}
+	return grasps;
+}
+}  // namespace
+
+TEST(GraspDatabase, saveLoad) {
+	const std::string filename = ::testing::TempDir() + "grasps.bin";
+	const GraspDatabase::Grasps grasps = rotatedGrasps(10);
+	GraspDatabase::save(filename, grasps, "object");
+
+	auto db = GraspDatabase::load(filename);
+	EXPECT_EQ(db->object(), "object");
+	ASSERT_EQ(db->size(), grasps.size());
+	for (size_t i = 0; i < db->size(); ++i) {  // sorted by decreasing quality
+		const GraspDatabase::Grasp grasp = db->grasp(i);
+		const GraspDatabase::Grasp& expected = grasps[grasps.size() - 1 - i];
+		EXPECT_DOUBLE_EQ(grasp.quality, expected.quality);
+		EXPECT_TRUE(grasp.pose.isApprox(expected.pose, 1e-12));
+	}
+	EXPECT_EQ(db->countAbove(0.65), 3u);
+	EXPECT_EQ(db->countAbove(0.0), 10u);
+	EXPECT_EQ(db->countAbove(1.0), 0u);
+	EXPECT_THROW(db->grasp(10), std::out_of_range);
+	std::remove(filename.c_str());
+}
+
+TEST(GraspDatabase, invalid) {
+	const std::string filename = ::testing::TempDir() + "invalid_grasps.bin";
+	EXPECT_THROW(GraspDatabase::load(filename), std::runtime_error);  // missing
+
+	GraspDatabase::save(filename, rotatedGrasps(2));
+	{  // truncated
+		std::FILE* file = std::fopen(filename.c_str(), "r+b");
+		ASSERT_NE(file, nullptr);
+		std::fseek(file, 0, SEEK_END);
+		EXPECT_EQ(::ftruncate(::fileno(file), std::ftell(file) - 1), 0);
+		std::fclose(file);
+	}
+	EXPECT_THROW(GraspDatabase::load(filename), std::runtime_error);
+
+	GraspDatabase::save(filename, rotatedGrasps(2));
+	{  // count overflowing the size computation: (2 + 2^58) * 64 bytes wrap around to the actual size
+		std::FILE* file = std::fopen(filename.c_str(), "r+b");
+		ASSERT_NE(file, nullptr);
+		const uint64_t count = 2 + (uint64_t(1) << 58);
+		std::fseek(file, 16, SEEK_SET);  // behind magic, version, and record size
+		EXPECT_EQ(std::fwrite(&count, sizeof(count), 1, file), 1u);
+		std::fclose(file);
+	}
+	EXPECT_THROW(GraspDatabase::load(filename), std::runtime_error);
+	std::remove(filename.c_str());
+}
+
+TEST(StreamGraspPoses, chunks) {
+	const std::string filename = ::testing::TempDir() + "streamed_grasps.bin";
+	GraspDatabase::save(filename, rotatedGrasps(10));
+
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto scene = std::make_shared<planning_scene::PlanningScene>(t.getRobotModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	auto initial = std::make_unique<stages::FixedState>("start", scene);
+	auto* initial_stage = initial.get();
+	t.add(std::move(initial));
+	t.add(std::make_unique<ConnectMockup>());
+
+	auto stream = std::make_unique<stages::StreamGraspPoses>();
+	stream->setMonitoredStage(initial_stage);
+	stream->setEndEffector("eef");
+	stream->setObject("base");
+	stream->setPreGraspPose([] {
+		moveit_msgs::RobotState pregrasp;
+		pregrasp.is_diff = true;
+		return pregrasp;
+	}());
+	stream->setDatabase(GraspDatabase::load(filename));
+	stream->setChunkSize(3);
+	stream->setMinQuality(0.15);
+	auto* stream_stage = stream.get();
+	t.add(std::move(stream));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(stream_stage->numStreamed(), 8u);  // grasps with quality >= 0.15
+	ASSERT_EQ(stream_stage->solutions().size(), 8u);
+	EXPECT_EQ(stream_stage->solutions().front()->cost(), 0.0);  // best grasp
+	std::remove(filename.c_str());
+}
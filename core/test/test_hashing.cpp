@@ -0,0 +1,129 @@
+#include "models.h"
+
+#include <moveit/task_constructor/hashing.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/utils.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <geometric_shapes/shapes.h>
+
+#include <gtest/gtest.h>
+#include <cmath>
+#include <initializer_list>
+
+using namespace moveit::task_constructor;
+
+TEST(Hashing, jointStateHash) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	moveit::core::RobotState state(robot_model);
+	state.setToDefaultValues();
+	const size_t hash = utils::jointStateHash(state, nullptr, 0.01);
+
+	state.setVariablePosition(0, 0.001);  // below resolution
+	EXPECT_EQ(utils::jointStateHash(state, nullptr, 0.01), hash);
+	state.setVariablePosition(0, 2 * M_PI);  // continuous joints are normalized
+	EXPECT_EQ(utils::jointStateHash(state, nullptr, 0.01), hash);
+	state.setVariablePosition(0, 0.1);
+	EXPECT_NE(utils::jointStateHash(state, nullptr, 0.01), hash);
+
+	// joints outside the group don't matter
+	const moveit::core::JointModelGroup* group = robot_model->getJointModelGroup("group");
+	const size_t group_hash = utils::jointStateHash(state, group, 0.01);
+	state.setVariablePosition(2, 0.5);
+	EXPECT_EQ(utils::jointStateHash(state, group, 0.01), group_hash);
+	EXPECT_EQ(utils::jointStateHash(*robot_model, state.getVariablePositions(), group, 0.01), group_hash);
+}
+
+TEST(Hashing, worldHash) {
+	utils::clearObjectHashCache();
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	scene->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.1, 0.1, 0.1),
+	                                       Eigen::Isometry3d::Identity());
+	const size_t hash = utils::worldHash(*scene, 0.01);
+	EXPECT_EQ(utils::objectHashCacheSize(), 1u);
+
+	// unmodified objects are shared with diffs and not hashed again
+	planning_scene::PlanningScenePtr diff = scene->diff();
+	EXPECT_EQ(utils::worldHash(*diff, 0.01), hash);
+	EXPECT_EQ(utils::objectHashCacheSize(), 1u);
+
+	// modified objects are copied and hashed again
+	diff->getWorldNonConst()->moveObject("box", Eigen::Isometry3d(Eigen::Translation3d(0.1, 0, 0)));
+	EXPECT_NE(utils::worldHash(*diff, 0.01), hash);
+	EXPECT_EQ(utils::worldHash(*scene, 0.01), hash);
+
+	// objects owned by a single scene are modified in place, invalidating their cached hash
+	diff.reset();
+	const collision_detection::World::Object* box = scene->getWorld()->getObject("box").get();
+	scene->getWorldNonConst()->moveObject("box", Eigen::Isometry3d(Eigen::Translation3d(0, 0.1, 0)));
+	EXPECT_EQ(scene->getWorld()->getObject("box").get(), box);
+	EXPECT_NE(utils::worldHash(*scene, 0.01), hash);
+
+	// same content yields same hash
+	auto other = std::make_shared<planning_scene::PlanningScene>(scene->getRobotModel());
+	other->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.1, 0.1, 0.1),
+	                                       Eigen::Isometry3d::Identity());
+	EXPECT_EQ(utils::worldHash(*other, 0.01), hash);
+
+	// the cache doesn't keep hashed objects alive
+	std::weak_ptr<const collision_detection::World::Object> object = other->getWorld()->getObject("box");
+	other.reset();
+	EXPECT_TRUE(object.expired());
+
+	utils::clearObjectHashCache();
+	EXPECT_EQ(utils::objectHashCacheSize(), 0u);
+}
+
+TEST(Hashing, stateHash) {
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	InterfaceState state(scene);
+	InterfaceState copy(state);
+	InterfaceState other(scene);
+	EXPECT_EQ(copy.sceneRevision(), state.sceneRevision());
+	EXPECT_NE(other.sceneRevision(), state.sceneRevision());
+	EXPECT_EQ(utils::stateHash(other, nullptr, 0.01), utils::stateHash(state, nullptr, 0.01));
+
+	// lightweight states hash like full ones, without creating their scene
+	std::vector<double> positions(scene->getCurrentState().getVariablePositions(),
+	                              scene->getCurrentState().getVariablePositions() +
+	                                  scene->getCurrentState().getVariableCount());
+	InterfaceState lightweight(scene, positions);
+	EXPECT_EQ(utils::stateHash(lightweight, nullptr, 0.01), utils::stateHash(state, nullptr, 0.01));
+	positions[0] = 0.5;
+	EXPECT_NE(utils::stateHash(InterfaceState(scene, positions), nullptr, 0.01), utils::stateHash(state, nullptr, 0.01));
+}
+
+TEST(Hashing, trajectoriesEqual) {
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	InterfaceState end(scene);
+	auto make_trajectory = [&scene](double position) {
+		auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(scene->getRobotModel(), nullptr);
+		moveit::core::RobotState state(scene->getCurrentState());
+		state.setVariablePosition(0, position);
+		trajectory->addSuffixWayPoint(state, 0.0);
+		return trajectory;
+	};
+	SubTrajectory a(make_trajectory(0.004999));
+	SubTrajectory b(make_trajectory(0.005001));
+	SubTrajectory c(make_trajectory(0.1));
+	for (SubTrajectory* trajectory : { &a, &b, &c })
+		trajectory->setEndState(end);
+
+	// positions on either side of a bin edge hash differently, but compare equal
+	EXPECT_NE(utils::trajectoryHash(a, 0.01), utils::trajectoryHash(b, 0.01));
+	EXPECT_EQ(utils::coarseTrajectoryHash(a, 0.01), utils::coarseTrajectoryHash(b, 0.01));
+	EXPECT_TRUE(utils::trajectoriesEqual(a, b, 0.01));
+
+	// distinct trajectories of the same length share the coarse hash only
+	EXPECT_EQ(utils::coarseTrajectoryHash(a, 0.01), utils::coarseTrajectoryHash(c, 0.01));
+	EXPECT_FALSE(utils::trajectoriesEqual(a, c, 0.01));
+
+	// replacing the trajectory renews the revision, copies share it
+	const SubTrajectory copy(a);
+	EXPECT_EQ(copy.trajectoryRevision(), a.trajectoryRevision());
+	EXPECT_NE(b.trajectoryRevision(), a.trajectoryRevision());
+	const uint64_t revision = a.trajectoryRevision();
+	a.setTrajectory(std::const_pointer_cast<robot_trajectory::RobotTrajectory>(c.trajectory()));
+	EXPECT_NE(a.trajectoryRevision(), revision);
+	EXPECT_TRUE(utils::trajectoriesEqual(a, c, 0.01));
+}
@@ -0,0 +1,92 @@
+#include <moveit/task_constructor/solvers/instrumented_planner.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include "models.h"
+#include <gtest/gtest.h>
+
+using namespace moveit::task_constructor;
+
+namespace {
+// planner that always fails
+struct FailingPlanner : public solvers::PlannerInterface
+{
+	void init(const moveit::core::RobotModelConstPtr& /*robot_model*/) override {}
+	Result plan(const planning_scene::PlanningSceneConstPtr& /*from*/,
+	            const planning_scene::PlanningSceneConstPtr& /*to*/, const moveit::core::JointModelGroup* /*jmg*/,
+	            double /*timeout*/, robot_trajectory::RobotTrajectoryPtr& /*result*/,
+	            const moveit_msgs::Constraints& /*path_constraints*/) override {
+		return { false, "always failing" };
+	}
+	Result plan(const planning_scene::PlanningSceneConstPtr& /*from*/, const moveit::core::LinkModel& /*link*/,
+	            const Eigen::Isometry3d& /*offset*/, const Eigen::Isometry3d& /*target*/,
+	            const moveit::core::JointModelGroup* /*jmg*/, double /*timeout*/,
+	            robot_trajectory::RobotTrajectoryPtr& /*result*/,
+	            const moveit_msgs::Constraints& /*path_constraints*/) override {
+		return { false, "always failing" };
+	}
+};
+}  // namespace
+
+struct InstrumentedPlannerTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	planning_scene::PlanningScenePtr from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	planning_scene::PlanningScenePtr to = from->diff();
+
+	InstrumentedPlannerTest() {
+		from->getCurrentStateNonConst().setToDefaultValues();
+		auto& state = to->getCurrentStateNonConst();
+		state.setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 0.5));
+		state.update();
+	}
+};
+
+TEST_F(InstrumentedPlannerTest, success) {
+	auto planner =
+	    std::make_shared<solvers::InstrumentedPlanner>(std::make_shared<solvers::JointInterpolationPlanner>());
+	EXPECT_EQ(planner->name(), "JointInterpolationPlanner");
+	planner->init(robot_model);
+
+	size_t observed = 0;
+	planner->setCallCallback([&observed](const solvers::InstrumentedPlanner::Call& call) {
+		EXPECT_TRUE(call.success);
+		EXPECT_FALSE(call.cartesian);
+		EXPECT_GT(call.waypoints, 1u);
+		++observed;
+	});
+
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	ASSERT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(observed, 1u);
+
+	const auto statistics = planner->statistics();
+	EXPECT_EQ(statistics.calls, 1u);
+	EXPECT_EQ(statistics.successes, 1u);
+	EXPECT_EQ(statistics.latency.count(), 1u);
+	EXPECT_EQ(statistics.waypoints, trajectory->getWayPointCount());
+	// joint-space distance of start and goal
+	EXPECT_NEAR(statistics.path_length, from->getCurrentState().distance(to->getCurrentState(), jmg), 1e-6);
+	EXPECT_TRUE(statistics.failures.empty());
+
+	planner->clear();
+	EXPECT_EQ(planner->statistics().calls, 0u);
+}
+
+TEST_F(InstrumentedPlannerTest, failures) {
+	auto planner = std::make_shared<solvers::InstrumentedPlanner>(std::make_shared<FailingPlanner>(), "failing");
+	EXPECT_EQ(planner->name(), "failing");
+	planner->init(robot_model);
+
+	std::vector<solvers::PlannerInterface::Request> requests(2, { from, to, jmg, 1.0, moveit_msgs::Constraints() });
+	std::vector<robot_trajectory::RobotTrajectoryPtr> trajectories;
+	planner->planBatch(requests, trajectories);
+
+	const auto statistics = planner->statistics();
+	EXPECT_EQ(statistics.calls, 2u);
+	EXPECT_EQ(statistics.successes, 0u);
+	ASSERT_EQ(statistics.failures.size(), 1u);
+	EXPECT_EQ(statistics.failures.at("always failing"), 2u);
+}
@@ -1,11 +1,16 @@
 #include <moveit/task_constructor/storage.h>
 #include <moveit/task_constructor/stage_p.h>
+#include <moveit/task_constructor/thread_pool.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/robot_model_test_utils.h>
+#include <geometric_shapes/shapes.h>
 
 #include "models.h"
 #include <memory>
 #include <algorithm>
 #include <iterator>
+#include <limits>
 #include <vector>
 #include <gtest/gtest.h>
 #include <gmock/gmock-matchers.h>
@@ -35,6 +40,12 @@ TEST(InterfaceStatePriority, compare) {
 	EXPECT_TRUE(Prio(0, 0) > Prio(1, 10));
 	EXPECT_TRUE(Prio(0, 0) >= Prio(0, 0));
 	EXPECT_TRUE(Prio(0, 10) >= Prio(0, 0));
+
+	// estimated cost-to-go is added to the cost, but doesn't override depth
+	auto enabled = InterfaceState::Status::ENABLED;
+	EXPECT_TRUE(Prio(0, 1, enabled, 0) < Prio(0, 0, enabled, 2));
+	EXPECT_TRUE(Prio(1, 0, enabled, 100) < Prio(0, 0));
+	EXPECT_TRUE(Prio(0, 1, enabled, 1) < Prio(0, 2, enabled, 0));  // ties are broken by cost
 }
 
 using Prio = InterfaceState::Priority;
@@ -72,6 +83,112 @@ TEST(Interface, update) {
 	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 3, 6 }));
 }
 
+TEST(Interface, costToGo) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	StoringInterface i;
+	i.setCostToGo([](const InterfaceState& state) { return state.priority().cost() < 1.0 ? 10.0 : 0.0; });
+	i.add(InterfaceState(ps, Prio(1, 0.0)));
+	i.add(InterfaceState(ps, Prio(1, 5.0)));
+	EXPECT_EQ(i.front()->priority().cost(), 5.0);  // lower estimated total cost
+	EXPECT_EQ(i.back()->priority().estimate(), 10.0);
+
+	// updates keep the estimate of a state
+	i.updatePriority(i.back(), Prio(1, 0.5));
+	EXPECT_EQ(i.back()->priority().estimate(), 10.0);
+	EXPECT_EQ(i.front()->priority().cost(), 5.0);
+}
+
+TEST(Interface, priorityTable) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	StoringInterface i;
+	for (unsigned int depth = 1; depth <= 4; ++depth)
+		i.add(InterfaceState(ps, Prio(depth, 0.0)));
+	auto consistent = [&i] {
+		if (i.priorities().size() != i.size() || i.states().size() != i.size())
+			return false;
+		for (size_t k = 0; k < i.size(); ++k)
+			if (!(i.priorities()[k] == i.states()[k]->priority()))
+				return false;
+		return true;
+	};
+	EXPECT_TRUE(consistent());
+
+	i.updatePriority(*i.rbegin(), Prio(5, 0.0));
+	EXPECT_TRUE(consistent());
+
+	// removing a state keeps the table dense
+	auto removed = i.remove(std::next(i.begin()));
+	EXPECT_EQ(i.size(), 3u);
+	EXPECT_TRUE(consistent());
+	EXPECT_EQ(std::count(i.states().begin(), i.states().end(), removed.front()), 0);
+
+	i.clear();
+	EXPECT_TRUE(i.priorities().empty());
+}
+
+TEST(Interface, beamWidth) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	size_t notified = 0;
+	StoringInterface i([&notified](Interface::iterator /*it*/, Interface::UpdateFlags /*updated*/) { ++notified; });
+	i.setBeamWidth(2);
+	for (unsigned int depth = 1; depth <= 3; ++depth)
+		i.add(InterfaceState(ps, Prio(depth, 0.0)));
+	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 3, 2 }));
+	EXPECT_EQ(i.deferredSize(), 1u);
+	EXPECT_EQ(i.priorities().size(), 2u);
+
+	// a better state pushes the worst one out of the beam
+	notified = 0;
+	i.add(InterfaceState(ps, Prio(4, 0.0)));
+	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 4, 3 }));
+	EXPECT_EQ(i.deferredSize(), 2u);
+	EXPECT_EQ(notified, 2u);  // new state + deferred one
+
+	// once all states of the beam are pruned, the best deferred ones are revived
+	i.updatePriority(*i.begin(), Prio(4, 0.0, InterfaceState::Status::PRUNED));
+	EXPECT_EQ(i.deferredSize(), 2u);
+	i.updatePriority(*i.begin(), Prio(3, 0.0, InterfaceState::Status::PRUNED));
+	EXPECT_THAT(i.depths(), ::testing::ElementsAreArray({ 2, 1, 4, 3 }));
+	EXPECT_EQ(i.deferredSize(), 0u);
+	EXPECT_EQ(i.priorities().size(), 4u);
+}
+
+TEST(Interface, batchNotify) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	std::vector<std::pair<unsigned int, Interface::UpdateFlags>> notified;
+	StoringInterface i([&notified](Interface::iterator it, Interface::UpdateFlags updated) {
+		notified.emplace_back(it->priority().depth(), updated);
+	});
+	i.add(InterfaceState(ps, Prio(1, 0.0)));
+	i.add(InterfaceState(ps, Prio(2, 0.0)));
+	notified.clear();
+	{
+		Interface::BatchNotify batch;
+		i.updatePriority(i.back(), Prio(3, 0.0));
+		i.updatePriority(i.front(), Prio(4, 0.0));
+		i.updatePriority(*i.rbegin(), Prio(5, 0.0, InterfaceState::Status::ARMED));
+		{
+			Interface::BatchNotify nested;  // doesn't deliver on its own
+			i.add(InterfaceState(ps, Prio(6, 0.0)));
+			i.updatePriority(i.front(), Prio(7, 0.0));
+		}
+		EXPECT_TRUE(notified.empty());
+	}
+	// one notification per state, in order of first occurrence, with accumulated flags
+	ASSERT_EQ(notified.size(), 3u);
+	EXPECT_EQ(notified[0].first, 4u);
+	EXPECT_EQ(notified[0].second, Interface::UpdateFlags(Interface::PRIORITY));
+	EXPECT_EQ(notified[1].first, 5u);
+	EXPECT_EQ(notified[1].second, Interface::UpdateFlags(Interface::ALL));
+	EXPECT_EQ(notified[2].first, 7u);
+	EXPECT_FALSE(notified[2].second);  // new state
+
+	// unbatched notifications are delivered immediately again
+	notified.clear();
+	i.updatePriority(i.back(), Prio(8, 0.0, InterfaceState::Status::ARMED));
+	EXPECT_EQ(notified.size(), 1u);
+}
+
 using PrioPair = std::pair<Prio, Prio>;
 inline bool operator<(const PrioPair& lhs, const PrioPair& rhs) {
 	return ConnectingPrivate::StatePair::less(lhs.first, lhs.second, rhs.first, rhs.second);
@@ -95,3 +212,211 @@ TEST(StatePairs, compare) {
 		EXPECT_TRUE(good_good < pair(bad, bad));
 	}
 }
+
+TEST(InterfaceState, sharedPayload) {
+	auto ps = std::make_shared<planning_scene::PlanningScene>(getModel());
+	InterfaceState original(ps, Prio(1, 0.0));
+	original.properties().set("answer", 42);
+
+	InterfaceState copy(original);
+	const InterfaceState& shared = copy;
+	const PropertyMap& original_props = static_cast<const InterfaceState&>(original).properties();
+	EXPECT_EQ(&shared.properties().property("answer"), &original_props.property("answer"));
+	EXPECT_EQ(copy.scene(), original.scene());
+
+	// modifying properties detaches the copy, leaving the original untouched
+	copy.properties().set("answer", 0);
+	EXPECT_EQ(copy.properties().get<int>("answer"), 0);
+	EXPECT_EQ(original.properties().get<int>("answer"), 42);
+
+	// references to the properties of a state don't alias copies taken afterwards
+	PropertyMap& props = original.properties();
+	InterfaceState later(original);
+	props.set("answer", 1);
+	EXPECT_EQ(later.properties().get<int>("answer"), 42);
+	EXPECT_EQ(&props, &original.properties());
+
+	// scheduling metadata can be updated on const states
+	shared.updateStatus(InterfaceState::Status::PRUNED);
+	EXPECT_EQ(copy.priority().status(), InterfaceState::Status::PRUNED);
+	EXPECT_EQ(original.priority().status(), InterfaceState::Status::ENABLED);
+}
+
+TEST(InterfaceState, diffScene) {
+	const unsigned int previous = utils::maxSceneDepth();
+	utils::setMaxSceneDepth(3);
+
+	planning_scene::PlanningScenePtr scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	scene->getCurrentStateNonConst().setVariablePosition(0, 0.5);
+	planning_scene::PlanningSceneConstPtr current = scene;
+	for (unsigned int i = 1; i <= 3; ++i) {
+		current = utils::diffScene(current);
+		EXPECT_EQ(utils::sceneDepth(*current), i);
+	}
+	// once the maximum depth is reached, the chain is flattened
+	planning_scene::PlanningScenePtr flat = utils::diffScene(current);
+	EXPECT_EQ(utils::sceneDepth(*flat), 1u);
+	EXPECT_EQ(flat->getCurrentState().getVariablePosition(0), 0.5);
+
+	utils::setMaxSceneDepth(0);  // never flatten
+	EXPECT_EQ(utils::sceneDepth(*utils::diffScene(current)), 4u);
+	utils::setMaxSceneDepth(previous);
+}
+
+TEST(InterfaceState, lightweight) {
+	planning_scene::PlanningScenePtr base = std::make_shared<planning_scene::PlanningScene>(getModel());
+	base->getCurrentStateNonConst().setToDefaultValues();
+	base->getCurrentStateNonConst().update();
+	const moveit::core::RobotState& base_state = base->getCurrentState();
+	std::vector<double> positions(base_state.getVariablePositions(),
+	                              base_state.getVariablePositions() + base_state.getVariableCount());
+	positions[0] += 0.5;
+
+	InterfaceState state(base, positions);
+	EXPECT_EQ(state.baseScene(), base);
+	EXPECT_EQ(state.variablePositions()[0], positions[0]);
+
+	// copies share the lazily created scene
+	InterfaceState copy(state);
+	const planning_scene::PlanningSceneConstPtr& scene = state.scene();
+	EXPECT_EQ(scene->getParent(), base);
+	EXPECT_EQ(scene->getCurrentState().getVariablePosition(0), positions[0]);
+	EXPECT_FALSE(scene->getCurrentState().dirty());
+	EXPECT_EQ(copy.scene(), scene);
+	EXPECT_EQ(copy.variablePositions()[0], positions[0]);
+}
+
+TEST(SolutionBase, sharedMarkers) {
+	visualization_msgs::Marker marker;
+	marker.ns = "shared";
+	auto shared = std::make_shared<const std::vector<visualization_msgs::Marker>>(2, marker);
+
+	SubTrajectory first, second;
+	first.markers().push_back(marker);
+	first.addSharedMarkers(shared);
+	second.addSharedMarkers(shared);
+	second.addSharedMarkers(std::make_shared<const std::vector<visualization_msgs::Marker>>());  // ignored
+	EXPECT_EQ(first.sharedMarkers().front(), second.sharedMarkers().front());
+	EXPECT_EQ(second.sharedMarkers().size(), 1u);
+
+	// messages contain own and shared markers
+	moveit_task_constructor_msgs::SolutionInfo info;
+	first.fillInfo(info);
+	EXPECT_EQ(info.markers.size(), 3u);
+	second.fillInfo(info);
+	EXPECT_EQ(info.markers.size(), 2u);
+}
+
+TEST(SolutionBase, lazyFailureMessage) {
+	SubTrajectory solution;
+	EXPECT_EQ(solution.failureCode(), FailureCode::NONE);
+	solution.setComment("base");
+
+	size_t rendered = 0;
+	solution.markAsFailure(FailureCode::COLLISION, [&rendered] {
+		++rendered;
+		return std::string("in collision");
+	});
+	EXPECT_TRUE(solution.isFailure());
+	EXPECT_EQ(solution.failureCode(), FailureCode::COLLISION);
+	EXPECT_TRUE(solution.hasComment());
+	EXPECT_EQ(rendered, 0u) << "message rendered before being accessed";
+
+	// messages are prepended to the existing comment, like eager ones
+	EXPECT_EQ(solution.comment(), "in collision\nbase");
+	EXPECT_EQ(solution.comment(), "in collision\nbase");
+	EXPECT_EQ(rendered, 1u);
+
+	SubTrajectory cost_failure;
+	cost_failure.setCost(std::numeric_limits<double>::infinity());
+	EXPECT_EQ(cost_failure.failureCode(), FailureCode::UNSPECIFIED);
+	EXPECT_STREQ(toString(FailureCode::NO_IK_SOLUTION), "no IK solution");
+}
+
+struct SolutionValidation : public testing::Test
+{
+	planning_scene::PlanningScenePtr scene;
+	std::vector<InterfaceState> states;
+	std::vector<SubTrajectory> subs;
+	std::unique_ptr<SolutionSequence> solution;
+
+	SolutionValidation() {
+		// like getModel(), but with a collision body at the tip
+		moveit::core::RobotModelBuilder builder("robot", "base");
+		builder.addChain("base->link1->link2->tip", "continuous");
+		geometry_msgs::Pose origin;
+		origin.orientation.w = 1.0;
+		builder.addCollisionBox("tip", { 0.1, 0.1, 0.1 }, origin);
+		builder.addGroupChain("base", "link2", "group");
+		scene = std::make_shared<planning_scene::PlanningScene>(builder.build());
+		scene->getCurrentStateNonConst().setToDefaultValues();
+		scene->getCurrentStateNonConst().setVariablePosition(0, 0.0);
+		scene->getCurrentStateNonConst().update();
+	}
+
+	// chain of sub trajectories, moving the first joint along the given positions
+	SolutionSequence& createSolution(const std::vector<double>& positions) {
+		states.reserve(positions.size());  // states are referenced by the solutions
+		for (double position : positions) {
+			auto state_scene = scene->diff();
+			state_scene->getCurrentStateNonConst().setVariablePosition(0, position);
+			states.emplace_back(state_scene);
+		}
+		subs.reserve(positions.size() - 1);
+		SolutionSequence::container_type solutions;
+		for (size_t i = 1; i < positions.size(); ++i) {
+			auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(scene->getRobotModel(), nullptr);
+			trajectory->addSuffixWayPoint(states[i - 1].scene()->getCurrentState(), 0.0);
+			trajectory->addSuffixWayPoint(states[i].scene()->getCurrentState(), 0.1);
+			subs.emplace_back(trajectory);
+			subs.back().setStartState(states[i - 1]);
+			subs.back().setEndState(states[i]);
+			solutions.push_back(&subs.back());
+		}
+		solution = std::make_unique<SolutionSequence>(std::move(solutions));
+		solution->setStartState(states.front());
+		solution->setEndState(states.back());
+		return *solution;
+	}
+};
+
+TEST_F(SolutionValidation, valid) {
+	SolutionSequence& solution = createSolution({ 0.0, 0.1, 0.2 });
+	EXPECT_TRUE(solution.validate(*scene));
+
+	utils::ThreadPool pool(2);
+	EXPECT_TRUE(solution.validate(*scene, 1e-4, &pool));
+}
+
+TEST_F(SolutionValidation, startState) {
+	SolutionSequence& solution = createSolution({ 0.0, 0.1 });
+	scene->getCurrentStateNonConst().setVariablePosition(0, 0.05);
+	EXPECT_FALSE(solution.validate(*scene));
+	EXPECT_TRUE(solution.validate(*scene, 0.1));  // within tolerance
+}
+
+TEST_F(SolutionValidation, disconnected) {
+	SolutionSequence& solution = createSolution({ 0.0, 0.1, 0.2 });
+	// trajectory of the second sub solution doesn't start from its start state anymore
+	auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(scene->getRobotModel(), nullptr);
+	trajectory->addSuffixWayPoint(states[0].scene()->getCurrentState(), 0.0);
+	trajectory->addSuffixWayPoint(states[2].scene()->getCurrentState(), 0.1);
+	subs[1].setTrajectory(trajectory);
+	EXPECT_FALSE(solution.validate(*scene));
+}
+
+TEST_F(SolutionValidation, collision) {
+	SolutionSequence& solution = createSolution({ 0.0, 0.1, 0.2 });
+	ASSERT_TRUE(solution.validate(*scene));
+
+	// an obstacle added after planning collides with the tip
+	scene->getWorldNonConst()->addToObject("obstacle", std::make_shared<const shapes::Box>(0.1, 0.1, 0.1),
+	                                       Eigen::Isometry3d::Identity());
+	EXPECT_FALSE(solution.validate(*scene));
+	utils::ThreadPool pool(2);
+	EXPECT_FALSE(solution.validate(*scene, 1e-4, &pool));
+
+	scene->getWorldNonConst()->removeObject("obstacle");
+	EXPECT_TRUE(solution.validate(*scene, 1e-4, &pool));
+}
@@ -0,0 +1,101 @@
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+using namespace moveit::task_constructor;
+
+struct JointInterpolationTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model;
+	solvers::JointInterpolationPlannerPtr planner = std::make_shared<solvers::JointInterpolationPlanner>();
+	planning_scene::PlanningScenePtr from;
+
+	JointInterpolationTest() {
+		moveit::core::RobotModelBuilder builder("robot", "base");
+		builder.addChain("base->revolute", "revolute");
+		builder.addChain("revolute->prismatic", "prismatic");
+		builder.addChain("prismatic->continuous", "continuous");
+		builder.addGroupChain("base", "revolute", "revolute");
+		builder.addGroupChain("revolute", "prismatic", "prismatic");
+		builder.addGroupChain("base", "prismatic", "mixed");
+		builder.addGroupChain("base", "continuous", "all");
+		robot_model = builder.build();
+		planner->init(robot_model);
+		from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+		from->getCurrentStateNonConst().setToDefaultValues();
+	}
+
+	planning_scene::PlanningScenePtr goal(const std::string& group, const std::vector<double>& positions) {
+		auto to = from->diff();
+		auto& state = to->getCurrentStateNonConst();
+		state.setJointGroupPositions(group, positions);
+		state.update();
+		return to;
+	}
+
+	// plan to goal, validating that all waypoints match RobotState::interpolate()
+	robot_trajectory::RobotTrajectoryPtr plan(const std::string& group,
+	                                          const planning_scene::PlanningSceneConstPtr& to) {
+		const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup(group);
+		robot_trajectory::RobotTrajectoryPtr trajectory;
+		EXPECT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+		if (!trajectory)
+			return trajectory;
+
+		// waypoints are located at t = i * delta, as computed by the planner
+		const moveit::core::RobotState& start = from->getCurrentState();
+		const moveit::core::RobotState& end = to->getCurrentState();
+		double d = 0.0;
+		for (const moveit::core::JointModel* jm : robot_model->getActiveJointModels())
+			d = std::max(d, jm->getDistanceFactor() * start.distance(end, jm));
+		const double delta = planner->properties().get<double>("max_step") / d;
+		EXPECT_GT(trajectory->getWayPointCount(), 2u);
+
+		moveit::core::RobotState expected(start);
+		for (size_t i = 1; i + 1 < trajectory->getWayPointCount(); ++i) {
+			start.interpolate(end, i * delta, expected);
+			const moveit::core::RobotState& waypoint = trajectory->getWayPoint(i);
+			for (size_t v = 0; v < robot_model->getVariableCount(); ++v)
+				EXPECT_NEAR(waypoint.getVariablePosition(v), expected.getVariablePosition(v), 1e-12)
+				    << robot_model->getVariableNames()[v] << " of waypoint " << i;
+		}
+		EXPECT_EQ(trajectory->getLastWayPoint().distance(end), 0.0);
+		return trajectory;
+	}
+};
+
+TEST_F(JointInterpolationTest, revolute) {
+	plan("revolute", goal("revolute", { 0.95 }));
+}
+
+TEST_F(JointInterpolationTest, prismatic) {
+	plan("prismatic", goal("prismatic", { -0.73 }));
+}
+
+TEST_F(JointInterpolationTest, mixed) {
+	plan("mixed", goal("mixed", { 0.95, -0.73 }));
+}
+
+// the fast path applies as long as continuous joints don't move
+TEST_F(JointInterpolationTest, unchangedContinuous) {
+	plan("all", goal("all", { 0.95, -0.73, 0.0 }));
+}
+
+// continuous joints are interpolated by RobotState::interpolate(), taking the shorter way across the wrap-around
+TEST_F(JointInterpolationTest, continuousFallback) {
+	from->getCurrentStateNonConst().setVariablePosition("prismatic-continuous-joint", 3.0);
+	from->getCurrentStateNonConst().update();
+	auto trajectory = plan("all", goal("all", { 0.2, -0.1, -3.0 }));
+	ASSERT_TRUE(trajectory);
+	for (size_t i = 0; i < trajectory->getWayPointCount(); ++i)
+		EXPECT_GE(std::abs(trajectory->getWayPoint(i).getVariablePosition("prismatic-continuous-joint")), 3.0 - 1e-9)
+		    << "waypoint " << i << " was interpolated linearly";
+}
@@ -0,0 +1,87 @@
+#include <moveit/task_constructor/merge.h>
+#include <moveit/robot_state/robot_state.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/robot_model_test_utils.h>
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+using namespace moveit::task_constructor;
+
+// two arms mounted on a revolute torso
+struct UpdateKinematicsTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model;
+	std::vector<const moveit::core::JointModelGroup*> groups;
+
+	UpdateKinematicsTest() {
+		std::vector<geometry_msgs::Pose> origins(2);
+		for (auto& pose : origins) {
+			pose.position.x = 0.3;
+			pose.orientation.w = 1.0;
+		}
+		moveit::core::RobotModelBuilder builder("robot", "base");
+		builder.addChain("base->torso", "revolute", { origins[0] });
+		origins[0].position.y = 0.2;
+		builder.addChain("torso->left1->left2", "revolute", origins);
+		origins[0].position.y = -0.2;
+		builder.addChain("torso->right1->right2", "revolute", origins);
+		builder.addGroupChain("torso", "left2", "left");
+		builder.addGroupChain("torso", "right2", "right");
+		robot_model = builder.build();
+		groups = { robot_model->getJointModelGroup("left"), robot_model->getJointModelGroup("right") };
+	}
+
+	// waypoints moving the given joint variables (by name) to the given positions, with velocities
+	robot_trajectory::RobotTrajectory
+	trajectory(const std::vector<std::vector<std::pair<std::string, double>>>& changes) {
+		robot_trajectory::RobotTrajectory trajectory(robot_model, nullptr);
+		moveit::core::RobotState state(robot_model);
+		state.setToDefaultValues();
+		state.update();
+		trajectory.addSuffixWayPoint(state, 0.0);
+		for (size_t i = 0; i < changes.size(); ++i) {
+			for (const auto& change : changes[i])
+				state.setVariablePosition(change.first, change.second);
+			state.setVariableVelocity(0, 0.1 * i);  // dirties nothing, but needs to be retained
+			trajectory.addSuffixWayPoint(state, 0.1);  // transforms are dirty
+		}
+		return trajectory;
+	}
+
+	// link transforms and velocities need to match a full update of each waypoint
+	void expectUpdated(const robot_trajectory::RobotTrajectory& trajectory) {
+		moveit::core::RobotState expected(robot_model);
+		for (size_t i = 0; i < trajectory.getWayPointCount(); ++i) {
+			const moveit::core::RobotState& waypoint = trajectory.getWayPoint(i);
+			expected.setVariablePositions(waypoint.getVariablePositions());
+			expected.update(true);
+			for (const moveit::core::LinkModel* link : robot_model->getLinkModels())
+				EXPECT_TRUE(waypoint.getGlobalLinkTransform(link).isApprox(expected.getGlobalLinkTransform(link), 1e-12))
+				    << link->getName() << " of waypoint " << i;
+			if (i > 0) {
+				ASSERT_TRUE(waypoint.hasVelocities());
+				EXPECT_EQ(waypoint.getVariableVelocity(0), 0.1 * (i - 1));
+			}
+		}
+	}
+};
+
+TEST_F(UpdateKinematicsTest, groupwise) {
+	auto t = trajectory({ { { "torso-left1-joint", 0.5 } },
+	                      { { "right1-right2-joint", -0.4 } },
+	                      { { "torso-left1-joint", 0.7 }, { "right1-right2-joint", 0.2 } },
+	                      {} });
+	updateKinematics(t, groups);
+	expectUpdated(t);
+}
+
+// joints outside of the groups fall back to a full update
+TEST_F(UpdateKinematicsTest, otherJoints) {
+	auto t = trajectory(
+	    { { { "base-torso-joint", 0.3 } }, { { "torso-left1-joint", 0.5 }, { "base-torso-joint", -0.3 } } });
+	updateKinematics(t, groups);
+	expectUpdated(t);
+}
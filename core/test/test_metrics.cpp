@@ -0,0 +1,75 @@
+#include <moveit/task_constructor/metrics.h>
+#include <moveit/task_constructor/histogram.h>
+#include <moveit/task_constructor/stage_p.h>
+
+#include "stage_mockups.h"
+#include "models.h"
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+#include <sstream>
+
+using namespace moveit::task_constructor;
+
+TEST(LatencyHistogram, buckets) {
+	utils::LatencyHistogram h;
+	h.record(0.0);
+	h.record(utils::LatencyHistogram::bound(0));  // upper bounds are inclusive
+	h.record(1.5 * utils::LatencyHistogram::bound(0));
+	h.record(1e6);
+
+	EXPECT_EQ(h.count(), 4u);
+	EXPECT_EQ(h.count(0), 2u);
+	EXPECT_EQ(h.count(1), 1u);
+	EXPECT_EQ(h.count(utils::LatencyHistogram::BUCKETS - 1), 1u);
+	EXPECT_TRUE(std::isinf(utils::LatencyHistogram::bound(utils::LatencyHistogram::BUCKETS - 1)));
+	EXPECT_DOUBLE_EQ(utils::LatencyHistogram::bound(1), 2 * utils::LatencyHistogram::bound(0));
+
+	h.clear();
+	EXPECT_EQ(h.count(), 0u);
+	EXPECT_EQ(h.sum(), 0.0);
+}
+
+TEST(LatencyHistogram, recordedByCompute) {
+	resetMockupIds();
+	Task t;
+	t.setRobotModel(getModel());
+	auto gen = std::make_unique<GeneratorMockup>(std::initializer_list<double>{ 0.0, 0.0, 0.0 });
+	auto* gen_ptr = gen.get();
+	t.add(std::move(gen));
+	t.add(std::make_unique<ForwardMockup>());
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(gen_ptr->pimpl()->computeLatency().count(), gen_ptr->runs_);
+	EXPECT_EQ(gen_ptr->pimpl()->computeLatency().count(), gen_ptr->pimpl()->numComputes());
+
+	t.reset();
+	EXPECT_EQ(gen_ptr->pimpl()->computeLatency().count(), 0u);
+}
+
+TEST(MetricsPublisher, prometheus) {
+	moveit_task_constructor_msgs::TaskMetrics msg;
+	msg.task = "task";
+	msg.latency_bounds = { 0.1, std::numeric_limits<double>::infinity() };
+	moveit_task_constructor_msgs::StageMetrics m;
+	m.path = "task/\"quoted\"";
+	m.computes = 3;
+	m.compute_time = 0.5;
+	m.latency_buckets = { 2, 1 };
+	m.solutions = 4;
+	msg.stages.push_back(m);
+
+	std::ostringstream os;
+	MetricsPublisher::writePrometheus(msg, os);
+	const std::string text = os.str();
+	const std::string labels = "task=\"task\",stage=\"task/\\\"quoted\\\"\"";
+	EXPECT_NE(text.find("# TYPE mtc_stage_computes_total counter\n"), std::string::npos);
+	EXPECT_NE(text.find("mtc_stage_computes_total{" + labels + "} 3\n"), std::string::npos);
+	EXPECT_NE(text.find("mtc_stage_solutions_total{" + labels + "} 4\n"), std::string::npos);
+	// buckets are cumulative
+	EXPECT_NE(text.find("mtc_stage_compute_seconds_bucket{" + labels + ",le=\"0.1\"} 2\n"), std::string::npos);
+	EXPECT_NE(text.find("mtc_stage_compute_seconds_bucket{" + labels + ",le=\"+Inf\"} 3\n"), std::string::npos);
+	EXPECT_NE(text.find("mtc_stage_compute_seconds_count{" + labels + "} 3\n"), std::string::npos);
+}
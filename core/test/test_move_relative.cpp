@@ -1,13 +1,16 @@
 #include "models.h"
 
 #include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/container.h>
 #include <moveit/task_constructor/stages/move_relative.h>
 #include <moveit/task_constructor/stages/fixed_state.h>
 #include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/solvers/jacobian_cartesian.h>
 #include <moveit/task_constructor/solvers/pipeline_planner.h>
 
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
+#include <moveit/utils/robot_model_test_utils.h>
 
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/TwistStamped.h>
@@ -32,6 +35,10 @@ solvers::CartesianPathPtr create<solvers::CartesianPath>() {
 	return std::make_shared<solvers::CartesianPath>();
 }
 template <>
+solvers::JacobianCartesianPtr create<solvers::JacobianCartesian>() {
+	return std::make_shared<solvers::JacobianCartesian>();
+}
+template <>
 solvers::PipelinePlannerPtr create<solvers::PipelinePlanner>() {
 	auto p = std::make_shared<solvers::PipelinePlanner>("pilz_industrial_motion_planner");
 	p->setPlannerId("LIN");
@@ -68,6 +75,7 @@ struct PandaMoveRelative : public testing::Test
 	}
 };
 using PandaMoveRelativeCartesian = PandaMoveRelative<solvers::CartesianPath>;
+using PandaMoveRelativeJacobian = PandaMoveRelative<solvers::JacobianCartesian>;
 
 moveit_msgs::CollisionObject createObject(const std::string& id, const geometry_msgs::Pose& pose) {
 	moveit_msgs::CollisionObject co;
@@ -163,7 +171,63 @@ TEST_F(PandaMoveRelativeCartesian, cartesianRotateAttachedIKFrame) {
 	EXPECT_CONST_POSITION(move->solutions().front(), attached_object);
 }
 
-using PlannerTypes = ::testing::Types<solvers::CartesianPath, solvers::PipelinePlanner>;
+TEST_F(PandaMoveRelativeCartesian, cartesianSegmented) {
+	planner->setSegments(4);
+	planner->setStepSize(0.02);
+	planner->setMinStepSize(0.002);
+	const std::string tip = group->getOnlyOneEndEffectorTip()->getName();
+	move->setIKFrame(tip);
+	geometry_msgs::Vector3Stamped v;
+	v.header.frame_id = "world";
+	v.vector.z = -0.2;
+	move->setDirection(v);
+
+	ASSERT_TRUE(t.plan()) << "Failed to plan";
+	const auto& trajectory = *std::dynamic_pointer_cast<const SubTrajectory>(move->solutions().front())->trajectory();
+	ASSERT_GT(trajectory.getWayPointCount(), 10u);
+	const Eigen::Isometry3d start = trajectory.getFirstWayPoint().getFrameTransform(tip);
+	const Eigen::Isometry3d end = trajectory.getLastWayPoint().getFrameTransform(tip);
+	EXPECT_TRUE(end.translation().isApprox(start.translation() - Eigen::Vector3d(0, 0, 0.2), 1e-3));
+	for (size_t i = 0; i < trajectory.getWayPointCount(); ++i) {
+		const Eigen::Isometry3d pose = trajectory.getWayPoint(i).getFrameTransform(tip);
+		EXPECT_TRUE(pose.linear().isApprox(start.linear(), 1e-3)) << "orientation changed at waypoint " << i;
+	}
+}
+
+TEST_F(PandaMoveRelativeJacobian, jacobianLinear) {
+	const std::string tip = group->getOnlyOneEndEffectorTip()->getName();
+	move->setIKFrame(tip);
+	geometry_msgs::Vector3Stamped v;
+	v.header.frame_id = "world";
+	v.vector.z = -0.2;
+	move->setDirection(v);
+
+	ASSERT_TRUE(t.plan()) << "Failed to plan";
+	const auto& trajectory = *std::dynamic_pointer_cast<const SubTrajectory>(move->solutions().front())->trajectory();
+	ASSERT_GE(trajectory.getWayPointCount(), 21u);  // 0.2m with default step size of 0.01m
+	const Eigen::Isometry3d start = trajectory.getFirstWayPoint().getFrameTransform(tip);
+	const Eigen::Isometry3d end = trajectory.getLastWayPoint().getFrameTransform(tip);
+	EXPECT_TRUE(end.translation().isApprox(start.translation() - Eigen::Vector3d(0, 0, 0.2), 1e-4));
+	for (size_t i = 0; i < trajectory.getWayPointCount(); ++i) {
+		const Eigen::Isometry3d pose = trajectory.getWayPoint(i).getFrameTransform(tip);
+		EXPECT_TRUE(pose.linear().isApprox(start.linear(), 1e-3)) << "orientation changed at waypoint " << i;
+		EXPECT_TRUE(trajectory.getWayPoint(i).satisfiesBounds(group));
+	}
+}
+
+TEST_F(PandaMoveRelativeJacobian, jacobianRotateEEF) {
+	move->setDirection([] {
+		geometry_msgs::TwistStamped twist;
+		twist.header.frame_id = "world";
+		twist.twist.angular.z = TAU / 8.0;
+		return twist;
+	}());
+
+	ASSERT_TRUE(t.plan()) << "Failed to plan";
+	EXPECT_CONST_POSITION(move->solutions().front(), group->getOnlyOneEndEffectorTip()->getName());
+}
+
+using PlannerTypes = ::testing::Types<solvers::CartesianPath, solvers::JacobianCartesian, solvers::PipelinePlanner>;
 TYPED_TEST_SUITE(PandaMoveRelative, PlannerTypes);
 TYPED_TEST(PandaMoveRelative, cartesianCollisionMinMaxDistance) {
 	if (std::is_same<TypeParam, solvers::PipelinePlanner>::value)
@@ -192,6 +256,140 @@ TYPED_TEST(PandaMoveRelative, cartesianCollisionMinMaxDistance) {
 	EXPECT_TRUE(this->scene->isPathValid(*trajectory->trajectory(), "panda_arm", false));
 }
 
+// CartesianPath counting its Cartesian planning requests
+struct CountingCartesianPath : public solvers::CartesianPath
+{
+	size_t calls = 0;
+
+	using CartesianPath::plan;
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const moveit::core::LinkModel& link,
+	            const Eigen::Isometry3d& offset, const Eigen::Isometry3d& target, const JointModelGroup* jmg,
+	            double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints) override {
+		++calls;
+		return CartesianPath::plan(from, link, offset, target, jmg, timeout, result, path_constraints);
+	}
+};
+
+TEST(MoveRelative, cache) {
+	Task t;
+	t.setRobotModel(loadModel());
+	auto scene = std::make_shared<PlanningScene>(t.getRobotModel());
+	scene->getCurrentStateNonConst().setToDefaultValues(t.getRobotModel()->getJointModelGroup("panda_arm"), "ready");
+
+	// two identical start states
+	auto starts = std::make_unique<Alternatives>("starts");
+	starts->add(std::make_unique<stages::FixedState>("start 1", scene));
+	starts->add(std::make_unique<stages::FixedState>("start 2", scene));
+	t.add(std::move(starts));
+
+	auto planner = std::make_shared<CountingCartesianPath>();
+	auto move = std::make_unique<stages::MoveRelative>("move", planner);
+	move->setGroup("panda_arm");
+	move->setIKFrame("panda_hand");
+	geometry_msgs::Vector3Stamped v;
+	v.header.frame_id = "panda_hand";
+	v.vector.z = 0.05;
+	move->setDirection(v);
+	move->setCacheResolution(1e-6);
+	auto* move_ptr = move.get();
+	t.add(std::move(move));
+
+	ASSERT_TRUE(t.plan());
+	EXPECT_EQ(planner->calls, 1u);  // second state is served from the cache
+	ASSERT_EQ(move_ptr->solutions().size(), 2u);
+	auto first = std::dynamic_pointer_cast<const SubTrajectory>(move_ptr->solutions().front())->trajectory();
+	auto second = std::dynamic_pointer_cast<const SubTrajectory>(move_ptr->solutions().back())->trajectory();
+	EXPECT_EQ(first->getWayPointCount(), second->getWayPointCount());
+
+	// the cache is cleared when the task is initialized again
+	t.reset();
+	ASSERT_TRUE(t.plan());
+	EXPECT_EQ(planner->calls, 2u);
+}
+
+TEST(MoveRelative, precheck) {
+	Task t;
+	t.setRobotModel(loadModel());
+	auto scene = std::make_shared<PlanningScene>(t.getRobotModel());
+	scene->getCurrentStateNonConst().setToDefaultValues(t.getRobotModel()->getJointModelGroup("panda_arm"), "ready");
+	t.add(std::make_unique<stages::FixedState>("start", scene));
+
+	auto planner = std::make_shared<CountingCartesianPath>();
+	auto move = std::make_unique<stages::MoveRelative>("move", planner);
+	move->setGroup("panda_arm");
+	move->setIKFrame("panda_hand");
+	geometry_msgs::Vector3Stamped v;
+	v.header.frame_id = "panda_hand";
+	v.vector.x = 2.0;  // far beyond the reach of the arm
+	move->setDirection(v);
+	move->setMinMaxDistance(1.5, 2.0);
+	auto* move_ptr = move.get();
+	t.add(std::move(move));
+
+	// by default, the Cartesian path is planned and fails short of min_distance
+	EXPECT_FALSE(t.plan());
+	EXPECT_EQ(planner->calls, 1u);
+	EXPECT_EQ(move_ptr->numFailures(), 1u);
+
+	// with precheck, the stage fails without planning
+	t.reset();
+	move_ptr->setPrecheck(true);
+	EXPECT_FALSE(t.plan());
+	EXPECT_EQ(planner->calls, 1u);
+	EXPECT_EQ(move_ptr->numFailures(), 1u);
+	ASSERT_EQ(move_ptr->failures().size(), 1u);
+	EXPECT_EQ(move_ptr->failures().front()->comment().rfind("required distance not reachable", 0), 0u);
+
+	// reachable motions pass the precheck and are planned as usual
+	t.reset();
+	v.vector.x = 0.0;
+	v.vector.z = 0.05;
+	move_ptr->setDirection(v);
+	move_ptr->setMinMaxDistance(0.05, 0.05);
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(planner->calls, 2u);
+}
+
+// JacobianCartesian needs to account for the Jacobian's reference frame, i.e. the base of the group
+TEST(JacobianCartesian, transformedBase) {
+	geometry_msgs::Pose base;
+	base.position.x = 0.5;
+	base.position.z = 0.2;
+	base.orientation.x = 0.3;
+	base.orientation.z = std::sqrt(0.5);
+	base.orientation.w = std::sqrt(0.5 - 0.09);
+	geometry_msgs::Pose offset;
+	offset.position.z = 0.3;
+	offset.orientation.w = 1.0;
+
+	moveit::core::RobotModelBuilder builder("robot", "world");
+	builder.addChain("world->base", "fixed", { base });
+	builder.addChain("base->link1->link2->tip", "continuous", { offset, offset, offset });
+	builder.addGroupChain("base", "tip", "arm");
+	auto robot_model = builder.build();
+	const JointModelGroup* jmg = robot_model->getJointModelGroup("arm");
+	const LinkModel* tip = robot_model->getLinkModel("tip");
+
+	// a reachable target of the planar arm
+	auto scene = std::make_shared<PlanningScene>(robot_model);
+	RobotState& state = scene->getCurrentStateNonConst();
+	state.setJointGroupPositions(jmg, std::vector<double>{ 0.5, 0.4, 0.3 });
+	state.update();
+	const Eigen::Isometry3d target = state.getGlobalLinkTransform(tip);
+	state.setJointGroupPositions(jmg, std::vector<double>{ 0.3, 0.6, 0.4 });
+	state.update();
+
+	auto planner = std::make_shared<solvers::JacobianCartesian>();
+	planner->init(robot_model);
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	ASSERT_TRUE(planner->plan(scene, *tip, Eigen::Isometry3d::Identity(), target, jmg, 1.0, trajectory));
+	ASSERT_TRUE(trajectory);
+	const Eigen::Isometry3d reached = trajectory->getLastWayPoint().getGlobalLinkTransform(tip);
+	EXPECT_LT((reached.translation() - target.translation()).norm(), 1e-3);
+	EXPECT_LT(Eigen::AngleAxisd(reached.linear().transpose() * target.linear()).angle(), 1e-2);
+}
+
 int main(int argc, char** argv) {
 	testing::InitGoogleTest(&argc, argv);
 	ros::init(argc, argv, "move_relative_test");
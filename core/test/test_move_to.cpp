@@ -58,6 +58,95 @@ TEST_F(PandaMoveTo, namedTarget) {
 	EXPECT_ONE_SOLUTION;
 }
 
+// JointInterpolationPlanner counting its joint-space planning requests
+struct CountingJointInterpolation : public solvers::JointInterpolationPlanner
+{
+	size_t calls = 0;
+
+	using JointInterpolationPlanner::plan;
+	Result plan(const PlanningSceneConstPtr& from, const PlanningSceneConstPtr& to, const JointModelGroup* jmg,
+	            double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints) override {
+		++calls;
+		return JointInterpolationPlanner::plan(from, to, jmg, timeout, result, path_constraints);
+	}
+};
+
+TEST(MoveTo, cachedNamedTarget) {
+	Task t;
+	t.setRobotModel(loadModel());
+	auto scene = std::make_shared<PlanningScene>(t.getRobotModel());
+	scene->getCurrentStateNonConst().setToDefaultValues(t.getRobotModel()->getJointModelGroup("panda_arm"), "extended");
+	auto fixed = std::make_unique<stages::FixedState>("start", scene);
+	auto* start = fixed.get();
+	t.add(std::move(fixed));
+
+	auto planner = std::make_shared<CountingJointInterpolation>();
+	auto move = std::make_unique<stages::MoveTo>("move", planner);
+	auto* move_to = move.get();
+	move_to->setGroup("panda_arm");
+	move_to->setGoal("ready");
+	move_to->setCachePlans(true);
+	t.add(std::move(move));
+
+	EXPECT_ONE_SOLUTION;
+	EXPECT_EQ(planner->calls, 1u);
+	EXPECT_ONE_SOLUTION;  // replanning from the identical start state reuses the trajectory
+	EXPECT_EQ(planner->calls, 1u);
+
+	// another start state needs planning
+	auto other = scene->diff();
+	other->getCurrentStateNonConst().setToDefaultValues(t.getRobotModel()->getJointModelGroup("panda_arm"), "ready");
+	other->getCurrentStateNonConst().setVariablePosition("panda_joint1", TAU / 8);
+	other->getCurrentStateNonConst().update();
+	start->setState(other);
+	EXPECT_ONE_SOLUTION;
+	EXPECT_EQ(planner->calls, 2u);
+
+	// so does another goal
+	move_to->setGoal(std::map<std::string, double>{ { "panda_joint1", -TAU / 8 } });
+	EXPECT_ONE_SOLUTION;
+	EXPECT_EQ(planner->calls, 3u);
+}
+
+// exposes the goal resolution of MoveTo
+struct ResolvingMoveTo : public stages::MoveTo
+{
+	using MoveTo::applyJointStateGoal;
+	using MoveTo::resolved_goal_;
+};
+
+TEST_F(PandaMoveTo, resolvedGoalChanges) {
+	ResolvingMoveTo stage;
+	const RobotModelConstPtr& model = t.getRobotModel();
+	const JointModelGroup* arm = model->getJointModelGroup("panda_arm");
+	const JointModelGroup* hand = model->getJointModelGroup("hand");
+	RobotState state(scene->getCurrentState());
+	RobotState expected(state);
+	std::vector<double> positions, expected_positions;
+
+	const auto expectGoal = [&](const JointModelGroup* jmg, const std::string& name) {
+		expected.setToDefaultValues(jmg, name);
+		state.copyJointGroupPositions(jmg, positions);
+		expected.copyJointGroupPositions(jmg, expected_positions);
+		ASSERT_EQ(positions.size(), expected_positions.size());
+		for (size_t i = 0; i < positions.size(); ++i)
+			EXPECT_NEAR(positions[i], expected_positions[i], 1e-9) << name << ", variable " << i;
+		EXPECT_EQ(stage.resolved_goal_.jmg, jmg);
+	};
+
+	ASSERT_TRUE(stage.applyJointStateGoal(std::string("ready"), arm, state));
+	expectGoal(arm, "ready");
+	// a changed goal is resolved again
+	ASSERT_TRUE(stage.applyJointStateGoal(std::string("extended"), arm, state));
+	expectGoal(arm, "extended");
+	// so is a goal for another group
+	ASSERT_TRUE(stage.applyJointStateGoal(std::string("open"), hand, state));
+	expectGoal(hand, "open");
+	ASSERT_TRUE(stage.applyJointStateGoal(std::string("close"), hand, state));
+	expectGoal(hand, "close");
+}
+
 TEST_F(PandaMoveTo, mapTarget) {
 	move_to->setGoal(std::map<std::string, double>{ { "panda_joint1", TAU / 8 }, { "panda_joint2", TAU / 8 } });
 	EXPECT_ONE_SOLUTION;
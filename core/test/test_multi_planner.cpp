@@ -0,0 +1,146 @@
+#include <moveit/task_constructor/solvers/multi_planner.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include "models.h"
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+using namespace moveit::task_constructor;
+
+// planner taking delay seconds to return a trajectory of given duration, or failure for duration < 0
+// Planning stops early when cancelled.
+struct DelayedPlanner : public solvers::PlannerInterface
+{
+	double delay;
+	double duration;
+
+	DelayedPlanner(double delay, double duration) : delay(delay), duration(duration) {}
+
+	void init(const moveit::core::RobotModelConstPtr& /*robot_model*/) override {}
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	            const moveit::core::JointModelGroup* jmg, double /*timeout*/,
+	            robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& /*path_constraints*/) override {
+		const auto& cancellation = utils::CancellationToken::current();
+		const auto end = std::chrono::steady_clock::now() + std::chrono::duration<double>(delay);
+		while (std::chrono::steady_clock::now() < end) {
+			if (cancellation.cancelled())
+				return { false, "cancelled" };
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		if (duration < 0)
+			return { false, "failed" };
+		result = std::make_shared<robot_trajectory::RobotTrajectory>(from->getRobotModel(), jmg);
+		result->addSuffixWayPoint(from->getCurrentState(), 0.0);
+		result->addSuffixWayPoint(to->getCurrentState(), duration);
+		return { true, "" };
+	}
+
+	Result plan(const planning_scene::PlanningSceneConstPtr& /*from*/, const moveit::core::LinkModel& /*link*/,
+	            const Eigen::Isometry3d& /*offset*/, const Eigen::Isometry3d& /*target*/,
+	            const moveit::core::JointModelGroup* /*jmg*/, double /*timeout*/,
+	            robot_trajectory::RobotTrajectoryPtr& /*result*/,
+	            const moveit_msgs::Constraints& /*path_constraints*/) override {
+		return { false, "not implemented" };
+	}
+};
+
+struct MultiPlannerTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	planning_scene::PlanningScenePtr scene = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	solvers::MultiPlanner planner;
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+
+	void add(double delay, double duration) { planner.push_back(std::make_shared<DelayedPlanner>(delay, duration)); }
+
+	bool plan(double timeout = 10.0) {
+		planner.init(robot_model);
+		return planner.plan(scene, scene, jmg, timeout, trajectory);
+	}
+};
+
+TEST_F(MultiPlannerTest, sequential) {
+	add(0.0, -1.0);
+	add(0.0, 2.0);
+	add(0.0, 1.0);
+
+	EXPECT_TRUE(plan());
+	ASSERT_TRUE(trajectory);
+	EXPECT_EQ(trajectory->getDuration(), 2.0);
+}
+
+TEST_F(MultiPlannerTest, raceFirstSuccess) {
+	add(1.0, 1.0);  // slow planner is cancelled
+	add(0.0, -1.0);
+	add(0.05, 2.0);
+	planner.setRace(true);
+
+	auto start = std::chrono::steady_clock::now();
+	EXPECT_TRUE(plan());
+	EXPECT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 0.5);
+	ASSERT_TRUE(trajectory);
+	EXPECT_EQ(trajectory->getDuration(), 2.0);
+
+	// planning again waits for the cancelled planner to finish first, which happens quickly
+	EXPECT_TRUE(plan());
+	EXPECT_LT(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(), 0.5);
+}
+
+TEST_F(MultiPlannerTest, cancelSequential) {
+	add(1.0, 1.0);
+	add(0.0, 1.0);
+
+	utils::CancellationToken token;
+	utils::CancellationToken::Activation activation(token);
+	utils::CancellationTimer timer(token, 0.05);
+	EXPECT_FALSE(plan());  // cancelled planners fail, the sequence isn't continued
+}
+
+TEST_F(MultiPlannerTest, raceGracePeriod) {
+	add(0.0, 2.0);
+	add(0.1, 1.0);
+	add(1.0, 0.5);  // too slow for the grace period
+	planner.setRace(true);
+	planner.setGracePeriod(0.5);
+
+	EXPECT_TRUE(plan());
+	ASSERT_TRUE(trajectory);
+	EXPECT_EQ(trajectory->getDuration(), 1.0);
+}
+
+TEST_F(MultiPlannerTest, raceFailure) {
+	add(0.0, -1.0);
+	add(0.05, -1.0);
+	planner.setRace(true);
+	EXPECT_FALSE(plan());
+
+	add(1.0, 1.0);
+	EXPECT_FALSE(plan(0.1));  // timeout
+}
+
+TEST_F(MultiPlannerTest, adaptive) {
+	add(0.01, -1.0);  // failing planner is tried first initially
+	add(0.01, 1.0);
+	planner.setAdaptive(true);
+
+	for (size_t i = 0; i < 10; ++i)
+		EXPECT_TRUE(plan());
+	// after the first request, the successful planner runs first
+	auto failing = planner.statistics(planner[0].get(), jmg->getName(), false);
+	EXPECT_EQ(failing.attempts, 1u);
+	EXPECT_EQ(failing.successes, 0u);
+	auto succeeding = planner.statistics(planner[1].get(), jmg->getName(), false);
+	EXPECT_EQ(succeeding.attempts, 10u);
+	EXPECT_EQ(succeeding.successes, 10u);
+	EXPECT_GT(succeeding.time, 0.0);
+
+	planner.resetStatistics();
+	EXPECT_EQ(planner.statistics(planner[1].get(), jmg->getName(), false).attempts, 0u);
+}
@@ -0,0 +1,111 @@
+#include <moveit/task_constructor/solvers/process_planner.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/cancellation.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include "models.h"
+#include <gtest/gtest.h>
+#include <chrono>
+#include <future>
+#include <thread>
+
+using namespace moveit::task_constructor;
+
+// joint interpolation, ignoring the timeout by sleeping for 10s
+struct SlowPlanner : solvers::JointInterpolationPlanner
+{
+	Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+	            const moveit::core::JointModelGroup* jmg, double timeout, robot_trajectory::RobotTrajectoryPtr& result,
+	            const moveit_msgs::Constraints& path_constraints) override {
+		std::this_thread::sleep_for(std::chrono::seconds(10));
+		return JointInterpolationPlanner::plan(from, to, jmg, timeout, result, path_constraints);
+	}
+	using JointInterpolationPlanner::plan;
+};
+
+// fork the zygote before gtest (or anything else) starts a thread
+static const bool ZYGOTE = solvers::ProcessPlanner::registerFactory<SlowPlanner>() &&
+                           solvers::ProcessPlanner::startZygote();
+
+struct ProcessPlannerTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	solvers::ProcessPlannerPtr planner =
+	    std::make_shared<solvers::ProcessPlanner>(std::make_shared<solvers::JointInterpolationPlanner>());
+	planning_scene::PlanningScenePtr from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+
+	ProcessPlannerTest() {
+		EXPECT_TRUE(ZYGOTE);
+		planner->setNumProcesses(2);
+		planner->init(robot_model);
+		from->getCurrentStateNonConst().setToDefaultValues();
+	}
+
+	planning_scene::PlanningScenePtr goal(double value) {
+		auto to = from->diff();
+		auto& state = to->getCurrentStateNonConst();
+		state.setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), value));
+		state.update();
+		return to;
+	}
+
+	// plan and validate that the trajectory reaches the goal
+	bool plan(const planning_scene::PlanningSceneConstPtr& to) {
+		robot_trajectory::RobotTrajectoryPtr trajectory;
+		return planner->plan(from, to, jmg, 1.0, trajectory) && trajectory &&
+		       trajectory->getLastWayPoint().distance(to->getCurrentState(), jmg) < 1e-6;
+	}
+};
+
+TEST_F(ProcessPlannerTest, plan) {
+	EXPECT_EQ(planner->numProcesses(), 2u);
+	EXPECT_TRUE(plan(goal(0.5)));
+	EXPECT_TRUE(plan(goal(-0.5)));
+}
+
+TEST_F(ProcessPlannerTest, concurrent) {
+	std::vector<std::future<bool>> results;
+	for (double value : { 0.1, 0.2, 0.3, 0.4 })
+		results.push_back(std::async(std::launch::async, [this, value] { return plan(goal(value)); }));
+	for (auto& result : results)
+		EXPECT_TRUE(result.get());
+}
+
+TEST_F(ProcessPlannerTest, bufferSize) {
+	planner->setBufferSize(16);
+	planner->init(robot_model);
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	auto result = planner->plan(from, goal(0.5), jmg, 1.0, trajectory);
+	EXPECT_FALSE(result);
+	EXPECT_EQ(result.message, "planning request exceeds buffer_size");
+}
+
+TEST_F(ProcessPlannerTest, timeout) {
+	planner = std::make_shared<solvers::ProcessPlanner>(std::make_shared<SlowPlanner>());
+	planner->setNumProcesses(1);
+	planner->init(robot_model);
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	const auto start = std::chrono::steady_clock::now();
+	auto result = planner->plan(from, goal(0.5), jmg, 0.1, trajectory);
+	EXPECT_FALSE(result);
+	EXPECT_EQ(result.message, "timeout");
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+	EXPECT_EQ(planner->numProcesses(), 1u);  // killed worker was restarted
+}
+
+TEST_F(ProcessPlannerTest, cancel) {
+	planner = std::make_shared<solvers::ProcessPlanner>(std::make_shared<SlowPlanner>());
+	planner->setNumProcesses(1);
+	planner->init(robot_model);
+	utils::CancellationToken token;
+	utils::CancellationTimer timer(token, 0.2);
+	utils::CancellationToken::Activation activation(token);
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	const auto start = std::chrono::steady_clock::now();
+	auto result = planner->plan(from, goal(0.5), jmg, 100.0, trajectory);
+	EXPECT_FALSE(result);
+	EXPECT_EQ(result.message, "cancelled");
+	EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+}
@@ -0,0 +1,72 @@
+#include <moveit/task_constructor/profiler.h>
+#include <moveit/task_constructor/thread_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+
+using namespace moveit::task_constructor::utils;
+
+TEST(Profiler, inactive) {
+	Profiler profiler;
+	{ ScopedTimer timer("test", "outer"); }
+	EXPECT_TRUE(profiler.events().empty());
+	EXPECT_EQ(Profiler::context().profiler, nullptr);
+}
+
+TEST(Profiler, nesting) {
+	Profiler profiler;
+	{
+		Profiler::Activation activation(&profiler);
+		ScopedTimer outer("test", "outer");
+		{ ScopedTimer inner("test", "in;ner"); }
+		{ ScopedTimer inner("test", "in;ner"); }
+	}
+	EXPECT_EQ(Profiler::context().profiler, nullptr);
+	EXPECT_TRUE(Profiler::context().stack.empty());
+
+	auto events = profiler.events();
+	ASSERT_EQ(events.size(), 3u);
+	EXPECT_EQ(events[0].name, "in:ner");
+	EXPECT_EQ(events[0].stack, "outer;in:ner");
+	EXPECT_EQ(events[2].name, "outer");
+	EXPECT_EQ(events[2].stack, "outer");
+	EXPECT_GE(events[2].duration, events[0].duration + events[1].duration);
+
+	std::ostringstream folded;
+	profiler.writeFlameGraph(folded);
+	std::istringstream lines(folded.str());
+	std::string first, second;
+	std::getline(lines, first);
+	std::getline(lines, second);
+	EXPECT_EQ(first.substr(0, first.find(' ')), "outer");
+	EXPECT_EQ(second.substr(0, second.find(' ')), "outer;in:ner");
+
+	std::ostringstream trace;
+	profiler.writeChromeTrace(trace);
+	EXPECT_EQ(trace.str().find("{\"traceEvents\":["), 0u);
+	EXPECT_NE(trace.str().find("\"name\":\"outer\",\"cat\":\"test\",\"ph\":\"X\""), std::string::npos);
+
+	profiler.clear();
+	EXPECT_TRUE(profiler.events().empty());
+}
+
+TEST(Profiler, threads) {
+	Profiler profiler;
+	ThreadPool pool(4);
+	Profiler::Activation activation(&profiler);
+	ScopedTimer outer("test", "outer");
+
+	std::vector<ThreadPool::Job> jobs;
+	for (size_t i = 0; i < 16; ++i)
+		jobs.emplace_back([context = Profiler::context()] {
+			Profiler::Activation activation(context);
+			ScopedTimer timer("test", "job");
+		});
+	pool.run(jobs);
+
+	auto events = profiler.events();
+	ASSERT_EQ(events.size(), jobs.size());
+	for (const auto& e : events)
+		EXPECT_EQ(e.stack, "outer;job");
+}
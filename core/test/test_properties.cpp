@@ -76,6 +76,172 @@ TEST(Property, reset) {
 	EXPECT_EQ(props.get<double>("double1"), 1.0);
 }
 
+TEST(Property, copyOnWrite) {
+	PropertyMap props;
+	props.set("double1", 1.0);
+	props.set("int1", 1);
+
+	// copies share their properties as long as they are not modified
+	PropertyMap copy = props;
+	const PropertyMap& const_props = props;
+	const PropertyMap& const_copy = copy;
+	EXPECT_EQ(&const_props.property("double1"), &const_copy.property("double1"));
+	EXPECT_EQ(const_copy.get<double>("double1"), 1.0);
+
+	// modifying the copy doesn't affect the original
+	copy.set("double1", 2.0);
+	copy.set("double2", 3.0);
+	EXPECT_NE(&const_props.property("double1"), &const_copy.property("double1"));
+	EXPECT_EQ(props.get<double>("double1"), 1.0);
+	EXPECT_FALSE(props.hasProperty("double2"));
+	EXPECT_EQ(copy.get<double>("double1"), 2.0);
+	EXPECT_EQ(copy.get<int>("int1"), 1);
+
+	// and vice versa
+	props.reset();
+	props.set("int1", 2);
+	EXPECT_EQ(copy.get<int>("int1"), 1);
+
+	// an empty map doesn't hold any properties
+	PropertyMap empty;
+	EXPECT_EQ(empty.begin(), empty.end());
+	EXPECT_THROW(static_cast<const PropertyMap&>(empty).property("double1"), Property::undeclared);
+}
+
+TEST(Property, copyOnWriteReferences) {
+	PropertyMap props;
+	props.set("double1", 1.0);
+	props.set("double2", 2.0);
+
+	// references remain valid when other properties are modified, even if those are unshared from copies
+	const double& double1 = props.get<double>("double1");
+	auto copy = std::make_unique<PropertyMap>(props);
+	props.set("double2", 3.0);
+	copy.reset();
+	EXPECT_EQ(double1, 1.0);
+	EXPECT_EQ(&double1, &props.get<double>("double1"));
+
+	// copies don't share properties that might be modified via references
+	Property& p = props.property("double1");
+	PropertyMap leaked_copy = props;
+	p.setValue(4.0);
+	EXPECT_EQ(props.get<double>("double1"), 4.0);
+	EXPECT_EQ(leaked_copy.get<double>("double1"), 1.0);
+}
+
+TEST(Property, handle) {
+	PropertyMap props;
+	props.declare<double>("double1", 1.0);
+	props.declare<double>("double2");
+	props.declare<boost::any>("any");
+
+	auto double1 = props.handle<double>("double1");
+	auto double2 = props.handle<double>("double2");
+	auto any = props.handle<int>("any");
+	EXPECT_THROW(props.handle<double>("double3"), Property::undeclared);
+	EXPECT_THROW(props.handle<int>("double1"), Property::type_error);
+
+	EXPECT_TRUE(double1);
+	EXPECT_FALSE(PropertyHandle<double>());
+	EXPECT_EQ(double1.name(), "double1");
+	EXPECT_EQ(double1.get(), 1.0);
+	EXPECT_THROW(double2.get(), Property::undefined);
+	EXPECT_EQ(double2.get(2.0), 2.0);
+
+	// handles follow value changes
+	props.set("double1", 3.0);
+	props.setCurrent("double2", 4.0);
+	EXPECT_EQ(double1.get(), 3.0);
+	EXPECT_EQ(double2.get(), 4.0);
+
+	// values of boost::any properties are type-checked on access
+	props.set("any", 1);
+	EXPECT_EQ(any.get(), 1);
+	props.set("any", 1.0);
+	EXPECT_THROW(any.get(), boost::bad_any_cast);
+}
+
+TEST(Property, handleLifetime) {
+	auto props = std::make_unique<PropertyMap>();
+	props->set("double1", 1.0);
+	auto double1 = props->handle<double>("double1");
+
+	// replacing all properties of the map, e.g. by assignment, resolves the property again
+	PropertyMap other;
+	other.set("double1", 2.0);
+	*props = other;
+	EXPECT_EQ(double1.get(), 2.0);
+	other.set("double1", 3.0);  // unshares other's properties, but not those of props
+	EXPECT_EQ(double1.get(), 2.0);
+
+	// handles don't dangle when their map is gone
+	props.reset();
+	EXPECT_THROW(double1.get(), Property::undeclared);
+}
+
+TEST(Property, typed) {
+	PropertyMap props;
+	TypedProperty<double> value(props, "value", 1.0, "typed value");
+	TypedProperty<std::string> name(props, "name");
+
+	// declared in the map as usual
+	EXPECT_EQ(props.get<double>("value"), 1.0);
+	EXPECT_EQ(props.property("value").description(), "typed value");
+	EXPECT_EQ(value.get(), 1.0);
+	EXPECT_THROW(name.get(), Property::undefined);
+	EXPECT_EQ(name.get("fallback"), "fallback");
+
+	// changes via the map or the typed property are visible on both sides
+	props.set("value", 2.0);
+	EXPECT_EQ(value.get(), 2.0);
+	name.set("foo");
+	EXPECT_EQ(props.get<std::string>("name"), "foo");
+
+	// after unsharing the map from a copy, the typed property follows the map
+	PropertyMap copy = props;
+	props.set("value", 3.0);
+	EXPECT_EQ(value.get(), 3.0);
+	EXPECT_EQ(copy.get<double>("value"), 2.0);
+}
+
+TEST(Property, initPlan) {
+	const Property::SourceFlags source = 4;
+	PropertyMap props;
+	props.declare<double>("by_name");
+	props.declare<double>("by_function");
+	props.declare<double>("manual");
+	props.declare<double>("other");
+	props.configureInitFrom(source, { "by_name", "manual" });
+	props.property("by_function").configureInitFrom(
+	    source, [](const PropertyMap& other) { return boost::any(other.get<double>("by_name") + 1.0); });
+	props.set("manual", 0.0);
+
+	PropertyMap::InitPlan plan = props.initPlan(source);
+	EXPECT_EQ(plan.size(), 3u);
+
+	PropertyMap other;
+	other.declare<double>("by_name", 1.0);
+	other.declare<double>("manual", 2.0);
+	props.performInitFrom(plan, other);
+	EXPECT_EQ(props.get<double>("by_name"), 1.0);
+	EXPECT_EQ(props.get<double>("by_function"), 2.0);
+	EXPECT_EQ(props.get<double>("manual"), 0.0);  // manually set values take precedence
+	EXPECT_FALSE(props.property("other").defined());
+
+	// repeated initialization updates values from the same source
+	other.set("by_name", 3.0);
+	props.performInitFrom(plan, other);
+	EXPECT_EQ(props.get<double>("by_name"), 3.0);
+	EXPECT_EQ(props.get<double>("by_function"), 4.0);
+
+	// an outdated plan falls back to a full initialization
+	PropertyMap copy = props;
+	other.set("by_name", 5.0);
+	props.performInitFrom(plan, other);
+	EXPECT_EQ(props.get<double>("by_name"), 5.0);
+	EXPECT_EQ(copy.get<double>("by_name"), 3.0);
+}
+
 TEST(Property, anytype) {
 	PropertyMap props;
 	props.declare<boost::any>("any", "store any type");
@@ -107,6 +273,24 @@ TEST(Property, serialize) {
 	EXPECT_EQ(props.property("map").serialize(), "");
 }
 
+TEST(Property, serializedCache) {
+	PropertyMap props;
+	props.declare<int>("int", 1);
+	const Property& p = props.property("int");
+	EXPECT_EQ(p.serialized(), "1");
+
+	// all modifications invalidate the cached serialization
+	props.set("int", 2);
+	EXPECT_EQ(p.serialized(), "2");
+	props.property("int").setCurrentValue(3);
+	EXPECT_EQ(p.serialized(), "3");
+	props.property("int").setDefaultValue(4);
+	props.property("int").reset();
+	EXPECT_EQ(p.serialized(), "4");
+	boost::any_cast<int&>(props.property("int").value()) = 5;
+	EXPECT_EQ(p.serialized(), "5");
+}
+
 class InitFromTest : public ::testing::Test
 {
 protected:
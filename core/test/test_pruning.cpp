@@ -1,10 +1,12 @@
 #include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/stage_p.h>
 
 #include "stage_mockups.h"
 #include "models.h"
 
 #include <list>
 #include <memory>
+#include <vector>
 
 using namespace moveit::task_constructor;
 
@@ -203,3 +205,48 @@ TEST_F(Pruning, BackPropagateFailure) {
 	EXPECT_EQ(con1->runs_, 2u);
 	EXPECT_EQ(con2->runs_, 3u);  // 100 - 20 is pruned
 }
+
+TEST_F(Pruning, CostBound) {
+	add(t, new GeneratorMockup({ 0.0, 0.0 }, 2));  // create both states on first run
+	add(t, new ForwardMockup({ 1.0, 10.0 }));
+	auto fw = add(t, new ForwardMockup());
+
+	// without pruning, both branches are completed
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1.0, 10.0));
+	EXPECT_EQ(fw->runs_, 2u);
+
+	// the second branch exceeds the best solution by more than the slack
+	resetMockupIds();
+	t.clear();
+	add(t, new GeneratorMockup({ 0.0, 0.0 }, 2));
+	add(t, new ForwardMockup({ 1.0, 10.0 }));
+	fw = add(t, new ForwardMockup());
+	t.stages()->setProperty("cost_pruning_slack", 5.0);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1.0));
+	EXPECT_EQ(fw->runs_, 1u);
+}
+
+// failing at the end of a long chain prunes all states back to the generator, keeping their path priorities
+TEST_F(Pruning, DeepChain) {
+	const size_t depth = 2000;
+	add(t, new GeneratorMockup({ 0 }));
+	std::vector<ForwardMockup*> chain;
+	for (size_t i = 0; i < depth; ++i)
+		chain.push_back(add(t, new ForwardMockup({ 1.0 })));
+	chain.push_back(add(t, new ForwardMockup({ INF })));
+
+	EXPECT_FALSE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 0u);
+	for (const ForwardMockup* fw : chain) {
+		EXPECT_EQ(fw->runs_, 1u);
+		ASSERT_EQ(fw->pimpl()->starts()->size(), 1u);
+		const InterfaceState::Priority& prio = fw->pimpl()->starts()->front()->priority();
+		EXPECT_EQ(prio.status(), InterfaceState::Status::PRUNED) << fw->name();
+		// the path up to the failure: generator and depth forward solutions of cost 1
+		EXPECT_EQ(prio.depth(), depth + 1) << fw->name();
+		EXPECT_EQ(prio.cost(), static_cast<double>(depth)) << fw->name();
+	}
+}
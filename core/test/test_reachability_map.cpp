@@ -0,0 +1,86 @@
+#include "models.h"
+
+#include <moveit/task_constructor/reachability_map.h>
+#include <moveit/robot_model/robot_model.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+
+using namespace moveit::task_constructor::utils;
+
+namespace {
+// poses at position with the z-axis pointing along each of the six axis directions
+std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d>>
+directions(const Eigen::Vector3d& position = Eigen::Vector3d::Zero()) {
+	std::vector<Eigen::Isometry3d, Eigen::aligned_allocator<Eigen::Isometry3d>> poses;
+	for (const Eigen::Vector3d& axis : { Eigen::Vector3d::UnitX(), Eigen::Vector3d::UnitY(), Eigen::Vector3d::UnitZ() })
+		for (double sign : { 1.0, -1.0 }) {
+			Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+			pose.linear() = Eigen::Quaterniond::FromTwoVectors(Eigen::Vector3d::UnitZ(), sign * axis).toRotationMatrix();
+			pose.translation() = position;
+			poses.push_back(pose);
+		}
+	return poses;
+}
+}  // namespace
+
+TEST(ReachabilityMap, generate) {
+	auto map = ReachabilityMap::generate(getModel(), "group", "link2", Eigen::Isometry3d::Identity(), 0.1, 1000);
+	EXPECT_EQ(map->robotName(), "robot");
+	EXPECT_EQ(map->group(), "group");
+	EXPECT_EQ(map->link(), "link2");
+
+	// all links of the model are located at the origin, but rotate about a single axis
+	size_t reached = 0;
+	for (const auto& pose : directions()) {
+		const double score = map->score(pose);
+		EXPECT_GE(score, 0.0);
+		EXPECT_LE(score, 1.0);
+		reached += score > 0.0;
+	}
+	EXPECT_GE(reached, 1u);
+	EXPECT_LE(reached, 4u);  // directions along the rotation axis are never reached
+
+	for (const auto& pose : directions(Eigen::Vector3d(1.0, 0.0, 0.0)))
+		EXPECT_EQ(map->score(pose), 0.0);  // outside of the grid
+
+	EXPECT_THROW(ReachabilityMap::generate(getModel(), "unknown", "link2"), std::runtime_error);
+}
+
+TEST(ReachabilityMap, matchesOffset) {
+	Eigen::Isometry3d offset = Eigen::Translation3d(0.0, 0.0, 0.1) * Eigen::AngleAxisd(0.5, Eigen::Vector3d::UnitX());
+	auto map = ReachabilityMap::generate(getModel(), "group", "link2", offset, 0.1, 100);
+	EXPECT_TRUE(map->offset().isApprox(offset));
+	EXPECT_TRUE(map->matches("robot", "group", "link2", offset));
+	EXPECT_FALSE(map->matches("robot", "group", "tip", offset));
+	// the same link with another offset
+	EXPECT_FALSE(map->matches("robot", "group", "link2", Eigen::Isometry3d::Identity()));
+	EXPECT_FALSE(map->matches("robot", "group", "link2", offset * Eigen::AngleAxisd(0.1, Eigen::Vector3d::UnitZ())));
+
+	// saved maps keep their offset
+	const std::string filename = testing::TempDir() + "reachability_map_offset.bin";
+	map->save(filename);
+	auto loaded = ReachabilityMap::load(filename);
+	std::remove(filename.c_str());
+	EXPECT_TRUE(loaded->matches("robot", "group", "link2", offset));
+	EXPECT_FALSE(loaded->matches("robot", "group", "link2", Eigen::Isometry3d::Identity()));
+}
+
+TEST(ReachabilityMap, saveLoad) {
+	auto map = ReachabilityMap::generate(getModel(), "group", "link2", Eigen::Isometry3d::Identity(), 0.1, 1000);
+	const std::string filename = testing::TempDir() + "reachability_map.bin";
+	map->save(filename);
+
+	auto loaded = ReachabilityMap::load(filename);
+	std::remove(filename.c_str());  // the mapping stays valid
+	EXPECT_EQ(loaded->robotName(), map->robotName());
+	EXPECT_EQ(loaded->group(), map->group());
+	EXPECT_EQ(loaded->link(), map->link());
+	EXPECT_EQ(loaded->resolution(), map->resolution());
+	EXPECT_TRUE(loaded->offset().isApprox(map->offset()));
+	for (const auto& pose : directions())
+		EXPECT_EQ(loaded->score(pose), map->score(pose));
+
+	EXPECT_THROW(ReachabilityMap::load(filename), std::runtime_error);
+}
@@ -0,0 +1,65 @@
+#include <moveit/task_constructor/reclaimer.h>
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace moveit::task_constructor::utils;
+
+namespace {
+// records the id and thread of its destruction
+struct Tracked
+{
+	int id;
+	std::vector<std::pair<int, std::thread::id>>* log;
+	std::mutex* mutex;
+	Tracked(int id, std::vector<std::pair<int, std::thread::id>>* log, std::mutex* mutex)
+	  : id(id), log(log), mutex(mutex) {}
+	Tracked(Tracked&& other) : id(other.id), log(other.log), mutex(other.mutex) { other.log = nullptr; }
+	~Tracked() {
+		if (!log)
+			return;  // moved-from
+		std::lock_guard<std::mutex> lock(*mutex);
+		log->emplace_back(id, std::this_thread::get_id());
+	}
+};
+}  // namespace
+
+TEST(Reclaimer, destroysInOrderInBackground) {
+	std::vector<std::pair<int, std::thread::id>> log;
+	std::mutex mutex;
+	Reclaimer reclaimer;
+	for (int i = 0; i < 10; ++i)
+		reclaimer.retire(Tracked(i, &log, &mutex));
+	reclaimer.wait();
+	EXPECT_EQ(reclaimer.pending(), 0u);
+
+	ASSERT_EQ(log.size(), 10u);
+	for (int i = 0; i < 10; ++i) {
+		EXPECT_EQ(log[i].first, i);
+		EXPECT_NE(log[i].second, std::this_thread::get_id());
+	}
+}
+
+TEST(Reclaimer, ownsSharedGarbage) {
+	auto shared = std::make_shared<int>(42);
+	std::weak_ptr<int> weak = shared;
+	Reclaimer reclaimer;
+	reclaimer.retire(std::move(shared));
+	reclaimer.wait();
+	EXPECT_TRUE(weak.expired());
+}
+
+TEST(Reclaimer, destructorDrains) {
+	std::vector<std::pair<int, std::thread::id>> log;
+	std::mutex mutex;
+	{
+		Reclaimer reclaimer;
+		for (int i = 0; i < 100; ++i)
+			reclaimer.retire(Tracked(i, &log, &mutex));
+	}
+	EXPECT_EQ(log.size(), 100u);
+}
@@ -0,0 +1,149 @@
+#include <moveit/task_constructor/solvers/roadmap_planner.h>
+#include <moveit/task_constructor/collision_checker.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+#include <geometric_shapes/shapes.h>
+
+#include "models.h"
+#include <gtest/gtest.h>
+#include <cmath>
+
+using namespace moveit::task_constructor;
+
+namespace {
+// reports states of the group within a box around (0.5, 0.5) as colliding
+struct ObstacleChecker : utils::CollisionChecker
+{
+	const moveit::core::JointModelGroup* jmg;
+	explicit ObstacleChecker(const moveit::core::JointModelGroup* jmg) : jmg(jmg) {}
+
+	static bool inObstacle(const std::vector<double>& positions) {
+		return std::abs(positions[0] - 0.5) < 0.15 && std::abs(positions[1] - 0.5) < 0.15;
+	}
+	size_t firstCollision(const planning_scene::PlanningScene& /*scene*/, const std::string& /*group*/,
+	                      const std::vector<const moveit::core::RobotState*>& states) const override {
+		std::vector<double> positions;
+		for (size_t i = 0; i < states.size(); ++i) {
+			states[i]->copyJointGroupPositions(jmg, positions);
+			if (inObstacle(positions))
+				return i;
+		}
+		return states.size();
+	}
+};
+
+// counts the collision queries, reporting all states as collision-free
+struct CountingChecker : utils::CollisionChecker
+{
+	mutable size_t calls = 0;
+
+	size_t firstCollision(const planning_scene::PlanningScene& /*scene*/, const std::string& /*group*/,
+	                      const std::vector<const moveit::core::RobotState*>& states) const override {
+		++calls;
+		return states.size();
+	}
+};
+}  // namespace
+
+struct RoadmapPlannerTest : public testing::Test
+{
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	solvers::RoadmapPlannerPtr planner = std::make_shared<solvers::RoadmapPlanner>();
+	planning_scene::PlanningScenePtr from = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	planning_scene::PlanningScenePtr to;
+
+	RoadmapPlannerTest() {
+		planner->init(robot_model);
+		from->getCurrentStateNonConst().setToDefaultValues();
+		to = from->diff();
+		auto& state = to->getCurrentStateNonConst();
+		state.setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 1.0));
+		state.update();
+	}
+	~RoadmapPlannerTest() override { utils::setCollisionChecker(nullptr); }
+
+	// joint-space length of trajectory
+	double length(const robot_trajectory::RobotTrajectory& trajectory) const {
+		double result = 0.0;
+		for (size_t i = 1; i < trajectory.getWayPointCount(); ++i)
+			result += trajectory.getWayPoint(i - 1).distance(trajectory.getWayPoint(i), jmg);
+		return result;
+	}
+};
+
+TEST_F(RoadmapPlannerTest, reuse) {
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	ASSERT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_LT(trajectory->getLastWayPoint().distance(to->getCurrentState(), jmg), 1e-9);
+	EXPECT_EQ(planner->size(jmg), 2u);  // start and goal, connected directly
+
+	ASSERT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(planner->size(jmg), 2u);  // nodes are reused
+
+	planner->init(robot_model);  // the roadmap survives init() with the same model
+	EXPECT_EQ(planner->size(jmg), 2u);
+}
+
+TEST_F(RoadmapPlannerTest, revalidation) {
+	utils::setCollisionChecker(std::make_shared<ObstacleChecker>(jmg));
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	ASSERT_TRUE(planner->plan(from, to, jmg, 5.0, trajectory));
+	EXPECT_GT(planner->size(jmg), 2u);  // roadmap was grown to pass the obstacle
+	std::vector<double> positions;
+	for (size_t i = 0; i < trajectory->getWayPointCount(); ++i) {
+		trajectory->getWayPoint(i).copyJointGroupPositions(jmg, positions);
+		EXPECT_FALSE(ObstacleChecker::inObstacle(positions));
+	}
+	const double direct = from->getCurrentState().distance(to->getCurrentState(), jmg);
+	EXPECT_GT(length(*trajectory), direct + 1e-6);
+
+	// after the world changed, the blocked direct edge is revalidated
+	utils::setCollisionChecker(nullptr);
+	from->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.1, 0.1, 0.1),
+	                                      Eigen::Isometry3d(Eigen::Translation3d(0.0, 10.0, 0.0)));
+	ASSERT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_NEAR(length(*trajectory), direct, 1e-6);
+}
+
+TEST_F(RoadmapPlannerTest, alternatingContexts) {
+	auto checker = std::make_shared<CountingChecker>();
+	utils::setCollisionChecker(checker);
+	auto other = from->diff();
+	other->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.1, 0.1, 0.1),
+	                                       Eigen::Isometry3d(Eigen::Translation3d(0.0, 10.0, 0.0)));
+
+	// start, goal, and the direct edge are validated once per context
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	ASSERT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(checker->calls, 3u);
+	ASSERT_TRUE(planner->plan(other, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(checker->calls, 6u);
+
+	// switching back reuses the edge's result, only start and goal are checked again
+	ASSERT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(checker->calls, 8u);
+	ASSERT_TRUE(planner->plan(other, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(checker->calls, 10u);
+}
+
+TEST_F(RoadmapPlannerTest, maxNodes) {
+	planner->setMaxNodes(2);
+	robot_trajectory::RobotTrajectoryPtr trajectory;
+	ASSERT_TRUE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(planner->size(jmg), 2u);
+
+	// goals of further requests are not kept in the full roadmap
+	auto goal = from->diff();
+	goal->getCurrentStateNonConst().setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 0.5));
+	goal->getCurrentStateNonConst().update();
+	ASSERT_TRUE(planner->plan(from, goal, jmg, 1.0, trajectory));
+	EXPECT_EQ(planner->size(jmg), 2u);
+
+	// the full roadmap is not grown to pass an obstacle (the changed world invalidates the known direct edge)
+	utils::setCollisionChecker(std::make_shared<ObstacleChecker>(jmg));
+	from->getWorldNonConst()->addToObject("box", std::make_shared<shapes::Box>(0.1, 0.1, 0.1),
+	                                      Eigen::Isometry3d(Eigen::Translation3d(0.0, 10.0, 0.0)));
+	EXPECT_FALSE(planner->plan(from, to, jmg, 1.0, trajectory));
+	EXPECT_EQ(planner->size(jmg), 2u);
+}
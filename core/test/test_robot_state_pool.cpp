@@ -0,0 +1,72 @@
+#include "models.h"
+
+#include <moveit/task_constructor/robot_state_pool.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/robot_state.h>
+
+#include <gtest/gtest.h>
+#include <vector>
+
+using namespace moveit::task_constructor::utils;
+
+TEST(RobotStatePool, shared) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	RobotStatePoolPtr pool = RobotStatePool::get(robot_model);
+	EXPECT_EQ(RobotStatePool::get(robot_model), pool);
+	EXPECT_NE(RobotStatePool::get(getModel()), pool);  // other model
+
+	std::weak_ptr<RobotStatePool> weak = pool;
+	moveit::core::RobotState state(robot_model);
+	moveit::core::RobotStatePtr copy = pool->copy(state);
+	pool.reset();
+	EXPECT_FALSE(weak.expired());  // kept alive by its state
+	copy.reset();
+	EXPECT_TRUE(weak.expired());
+}
+
+TEST(RobotStatePool, recycle) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	RobotStatePoolPtr pool = RobotStatePool::get(robot_model);
+	moveit::core::RobotState state(robot_model);
+	state.setToDefaultValues();
+
+	moveit::core::RobotStatePtr a = pool->copy(state);
+	const moveit::core::RobotState* address = a.get();
+	EXPECT_EQ(pool->available(), 0u);
+	a.reset();
+	EXPECT_EQ(pool->available(), 1u);
+
+	state.setVariablePosition(0, 0.5);
+	moveit::core::RobotStatePtr b = pool->copy(state);
+	EXPECT_EQ(b.get(), address);
+	EXPECT_EQ(pool->available(), 0u);
+	EXPECT_EQ(b->getVariablePosition(0), 0.5);
+
+	pool->setCapacity(0);
+	b.reset();
+	EXPECT_EQ(pool->available(), 0u);  // exceeding capacity, state is deleted
+}
+
+TEST(RobotStatePool, shrink) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	RobotStatePoolPtr pool = RobotStatePool::get(robot_model);
+	moveit::core::RobotState state(robot_model);
+	state.setToDefaultValues();
+
+	std::vector<moveit::core::RobotStatePtr> states;
+	for (size_t i = 0; i < 10; ++i)
+		states.push_back(pool->copy(state));
+	states.clear();
+	EXPECT_EQ(pool->available(), 10u);
+	pool->shrink();  // all states were released only after the previous shrink
+	EXPECT_EQ(pool->available(), 10u);
+
+	// three states are reused, the other seven stay idle until the next shrink
+	for (size_t i = 0; i < 3; ++i)
+		states.push_back(pool->copy(state));
+	states.clear();
+	pool->shrink();
+	EXPECT_EQ(pool->available(), 3u);
+	pool->shrink();
+	EXPECT_EQ(pool->available(), 0u);
+}
@@ -0,0 +1,151 @@
+#include <moveit/task_constructor/scheduler_log.h>
+#include <moveit/task_constructor/storage.h>
+#include <moveit/task_constructor/task.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include "stage_mockups.h"
+#include "models.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+using namespace moveit::task_constructor;
+using utils::SchedulerLog;
+
+using SchedulerLogTest = TaskTestBase;
+
+namespace {
+const SchedulerLog::StageSummary* find(const std::vector<SchedulerLog::StageSummary>& summary,
+                                       const std::string& name) {
+	for (const auto& s : summary)
+		if (s.stage == name)
+			return &s;
+	return nullptr;
+}
+}  // namespace
+
+TEST_F(SchedulerLogTest, prunedBranch) {
+	add(t, new GeneratorMockup({ 0 }));
+	add(t, new ForwardMockup({ 0 }));
+	add(t, new ForwardMockup({ INF }));  // fails, pruning the branch
+	t.enableSchedulerLog();
+	EXPECT_FALSE(t.plan());
+
+	const utils::SchedulerLogPtr& log = t.schedulerLog();
+	ASSERT_TRUE(log);
+	bool forward = false, status = false;
+	for (const SchedulerLog::Record& r : log->records()) {
+		EXPECT_GE(r.iteration, 1u);
+		if (r.kind == SchedulerLog::FORWARD) {
+			forward = true;
+			EXPECT_NE(r.states[0], 0u);
+			EXPECT_EQ(r.states[1], 0u);
+		}
+		status |= r.kind == SchedulerLog::STATUS;
+	}
+	EXPECT_TRUE(forward);
+	EXPECT_TRUE(status);
+
+	const auto summary = log->summarize();
+	const auto* gen = find(summary, "GEN1");
+	const auto* fwd1 = find(summary, "FWD1");
+	const auto* fwd2 = find(summary, "FWD2");
+	ASSERT_TRUE(gen && fwd1 && fwd2);
+	EXPECT_EQ(gen->computes, 1u);
+	EXPECT_EQ(gen->solutions, 1u);
+	EXPECT_EQ(gen->wasted_computes, 0u);
+	EXPECT_EQ(fwd1->solutions, 1u);
+	EXPECT_EQ(fwd1->wasted_computes, 1u);  // its start state was pruned by the failure of FWD2
+	EXPECT_EQ(fwd2->failures, 1u);
+	EXPECT_EQ(fwd2->wasted_computes, 1u);
+
+	std::ostringstream os;
+	log->writeSummary(os);
+	EXPECT_NE(os.str().find("FWD1"), std::string::npos);
+}
+
+TEST_F(SchedulerLogTest, saveLoad) {
+	add(t, new GeneratorMockup({ 0, 1 }));
+	add(t, new ForwardMockup());
+	t.enableSchedulerLog();
+	EXPECT_TRUE(t.plan());
+
+	const std::string path = testing::TempDir() + "scheduler_log.bin";
+	t.schedulerLog()->save(path);
+	SchedulerLog loaded;
+	loaded.load(path);
+	EXPECT_EQ(loaded.stageNames(), t.schedulerLog()->stageNames());
+	const auto expected = t.schedulerLog()->records();
+	const auto actual = loaded.records();
+	ASSERT_EQ(actual.size(), expected.size());
+	for (size_t i = 0; i < actual.size(); ++i) {
+		EXPECT_EQ(actual[i].iteration, expected[i].iteration);
+		EXPECT_EQ(actual[i].stage, expected[i].stage);
+		EXPECT_EQ(actual[i].kind, expected[i].kind);
+		EXPECT_EQ(actual[i].duration, expected[i].duration);
+	}
+
+	std::ofstream(path, std::ios::trunc) << "garbage";
+	EXPECT_THROW(loaded.load(path), std::runtime_error);
+	std::remove(path.c_str());
+	EXPECT_THROW(loaded.load(path), std::runtime_error);
+}
+
+TEST(SchedulerLog, ringBuffer) {
+	resetMockupIds();
+	GeneratorMockup stage;
+	SchedulerLog log(2);
+	{
+		SchedulerLog::Compute ignored(stage);  // no active log
+	}
+	EXPECT_EQ(log.size(), 0u);
+
+	SchedulerLog::Activation activation(&log);
+	for (int i = 0; i < 3; ++i) {
+		log.nextIteration();
+		SchedulerLog::Compute compute(stage);
+		compute.finish(i, 0);
+	}
+	EXPECT_EQ(log.size(), 2u);
+	EXPECT_EQ(log.dropped(), 1u);
+	const auto records = log.records();
+	ASSERT_EQ(records.size(), 2u);
+	EXPECT_EQ(records[0].iteration, 2u);  // oldest first
+	EXPECT_EQ(records[1].iteration, 3u);
+	EXPECT_EQ(records[1].solutions, 2u);
+	EXPECT_EQ(records[1].kind, SchedulerLog::GENERATE);
+	EXPECT_EQ(log.stageNames(), std::vector<std::string>{ "GEN1" });
+}
+
+// a state created at the address of a released one gets a new id
+TEST(SchedulerLog, releasedStates) {
+	resetMockupIds();
+	GeneratorMockup stage;
+	SchedulerLog log;
+	SchedulerLog::Activation activation(&log);
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+
+	std::aligned_storage<sizeof(InterfaceState), alignof(InterfaceState)>::type storage;
+	auto* state = new (&storage) InterfaceState(scene);
+	const auto take = [&] {
+		SchedulerLog::Compute compute(stage);
+		SchedulerLog::job(SchedulerLog::FORWARD, state);
+	};
+	take();
+	take();
+	state->~InterfaceState();
+	state = new (&storage) InterfaceState(scene);
+	take();
+	state->~InterfaceState();
+
+	const auto records = log.records();
+	ASSERT_EQ(records.size(), 3u);
+	EXPECT_EQ(records[1].states[0], records[0].states[0]);
+	EXPECT_NE(records[2].states[0], records[0].states[0]);
+}
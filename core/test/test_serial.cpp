@@ -1,14 +1,27 @@
 #include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/task_p.h>
 #include <moveit/task_constructor/stages.h>
 #include <moveit/task_constructor/cost_terms.h>
+#include <moveit/task_constructor/collision_checker.h>
+#include <moveit/task_constructor/reclaimer.h>
 #include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/thread_pool.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
 #include <moveit/utils/robot_model_test_utils.h>
 
 #include "stage_mockups.h"
 #include "models.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <limits>
 #include <list>
+#include <map>
 #include <memory>
+#include <thread>
+#include <vector>
 
 using namespace moveit::task_constructor;
 using namespace planning_scene;
@@ -58,6 +71,194 @@ TEST_F(ConnectConnect, SuccSucc) {
 	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
 }
 
+// connecting pending pairs in batches yields the same solutions
+TEST_F(ConnectConnect, Batch) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	auto con1 = add(t, new Connect());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	auto con2 = add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 0.0 }));
+	con1->setBatchSize(4);
+	con2->setBatchSize(4);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
+	EXPECT_EQ(con1->calls_, 0u);  // Connect plans all pairs in computeBatch()
+	EXPECT_EQ(con2->runs_, 2u);  // default computeBatch() calls compute() for each pair
+}
+
+// states deferred by the beam of a Connecting stage are revived once all pairs of the beam were tried
+TEST_F(ConnectConnect, BeamRevival) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	auto con = add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	con->setProperty("max_interface_states", size_t(1));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(con->runs_, 6u);
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
+	EXPECT_EQ(con->pimpl()->starts()->deferredSize(), 0u);
+	EXPECT_EQ(con->pimpl()->ends()->deferredSize(), 0u);
+}
+
+// probing a Connecting stage for work doesn't revive deferred states: the scheduler refills it explicitly
+TEST_F(ConnectConnect, BeamProbe) {
+	auto gen1 = add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	auto con = add(t, new ConnectMockup());
+	auto gen2 = add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	con->setProperty("max_interface_states", size_t(1));
+	t.init();
+	for (size_t i = 0; i < 3; ++i)
+		gen1->pimpl()->runCompute();
+	for (size_t i = 0; i < 2; ++i)
+		gen2->pimpl()->runCompute();
+	const Interface& starts = *con->pimpl()->starts();
+	const Interface& ends = *con->pimpl()->ends();
+	EXPECT_EQ(starts.deferredSize(), 2u);
+	EXPECT_EQ(ends.deferredSize(), 1u);
+
+	EXPECT_TRUE(con->pimpl()->canCompute());
+	con->pimpl()->runCompute();  // the only pair of the beam
+	for (size_t i = 0; i < 2; ++i)
+		EXPECT_FALSE(con->pimpl()->canCompute());
+	EXPECT_EQ(starts.deferredSize(), 2u);
+	EXPECT_EQ(ends.deferredSize(), 1u);
+
+	con->pimpl()->refill();
+	EXPECT_TRUE(con->pimpl()->canCompute());
+	EXPECT_LT(starts.deferredSize() + ends.deferredSize(), 3u);
+}
+
+// planning disjoint groups concurrently yields the same, merged solutions
+TEST_F(ConnectConnect, Concurrent) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	auto con = add(t, new Connect());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	con->setProperty("merge_mode", stages::Connect::CONCURRENT);
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::parallel(2)));
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
+	for (const auto& solution : con->solutions())
+		EXPECT_NE(dynamic_cast<const SubTrajectory*>(solution.get()), nullptr);
+}
+
+// planning towards goal sets connects each start with all its goals
+TEST_F(ConnectConnect, GoalSet) {
+	struct Planner : solvers::JointInterpolationPlanner
+	{
+		size_t requests = 0;
+		Result planGoalSet(const planning_scene::PlanningSceneConstPtr& from,
+		                   const std::vector<planning_scene::PlanningSceneConstPtr>& goals,
+		                   const moveit::core::JointModelGroup* jmg, double timeout,
+		                   robot_trajectory::RobotTrajectoryPtr& result, size_t& reached,
+		                   const moveit_msgs::Constraints& path_constraints) override {
+			++requests;
+			return JointInterpolationPlanner::planGoalSet(from, goals, jmg, timeout, result, reached, path_constraints);
+		}
+	};
+	auto planner = std::make_shared<Planner>();
+	add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	auto con = add(t, new stages::Connect("connect", { { "group", planner } }));
+	add(t, new GeneratorMockup({ 10.0, 20.0, 30.0 }));
+	con->setCostTerm(std::make_shared<PredefinedCosts>(std::list<double>{ 0.0 }, false));
+	con->setBatchSize(6);
+	con->setGoalSet(true);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 21, 22, 31, 32));
+	EXPECT_GT(planner->requests, 0u);  // pairs sharing their start state were planned as goal sets
+	EXPECT_LE(planner->requests, 6u);  // one request per reached goal
+}
+
+// all pairs of many start and end states are connected exactly once, in order of their costs
+TEST_F(ConnectConnect, ManyPairs) {
+	std::list<double> start_costs, end_costs;
+	for (size_t i = 0; i < 20; ++i) {
+		start_costs.push_back(i);
+		end_costs.push_back(100.0 * (20 - i));
+	}
+	add(t, new GeneratorMockup(PredefinedCosts(std::move(start_costs))));
+	auto con = add(t, new ConnectMockup());
+	add(t, new GeneratorMockup(PredefinedCosts(std::move(end_costs))));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(con->runs_, 400u);
+	EXPECT_EQ(t.solutions().size(), 400u);
+	EXPECT_EQ(t.solutions().front()->cost(), 100.0);
+	EXPECT_EQ(t.solutions().back()->cost(), 2019.0);
+}
+
+// a custom collision checker receives the waypoints of merged trajectories in a single batch
+TEST_F(ConnectConnect, CollisionChecker) {
+	struct Checker : utils::CollisionChecker
+	{
+		mutable std::atomic<size_t> batches{ 0 };
+		size_t firstCollision(const planning_scene::PlanningScene& scene, const std::string& group,
+		                      const std::vector<const moveit::core::RobotState*>& states) const override {
+			++batches;
+			return CollisionChecker::firstCollision(scene, group, states);
+		}
+	};
+	auto checker = std::make_shared<Checker>();
+	utils::setCollisionChecker(checker);
+
+	add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	add(t, new Connect());
+	add(t, new GeneratorMockup({ 10.0 }));
+
+	const bool success = t.plan();
+	utils::setCollisionChecker(nullptr);
+	EXPECT_TRUE(success);
+	EXPECT_EQ(t.solutions().size(), 2u);
+	EXPECT_GT(checker->batches, 0u);  // merged solutions were validated by the custom checker
+	EXPECT_NE(utils::collisionChecker(), checker);
+}
+
+// anytime scheduling propagates the deepest partial solution first, finding the first solution with fewer computes
+TEST_F(ConnectConnect, Anytime) {
+	auto bw2 = add(t, new BackwardMockup());
+	auto bw1 = add(t, new BackwardMockup());
+	auto gen = add(t, new GeneratorMockup({ 1.0, 2.0, 3.0, 4.0, 5.0 }));
+
+	// ordered scheduling would compute the generator in each of the three iterations
+	EXPECT_TRUE(t.plan(1, ExecutionPolicy::anytime()));
+	EXPECT_EQ(gen->runs_, 1u);
+	EXPECT_EQ(bw1->runs_, 1u);
+	EXPECT_EQ(bw2->runs_, 1u);
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1));
+}
+
+// after the first solution, anytime scheduling switches to ordered scheduling, computing all ready children again
+TEST_F(ConnectConnect, AnytimeSwitch) {
+	auto bw2 = add(t, new BackwardMockup());
+	auto bw1 = add(t, new BackwardMockup());
+	auto gen = add(t, new GeneratorMockup({ 1.0, 2.0, 3.0, 4.0, 5.0 }));
+	std::vector<size_t> gen_runs;  // generator computes when a solution is found
+	t.addSolutionCallback([&](const SolutionBase& /*s*/) { gen_runs.push_back(gen->runs_); });
+
+	EXPECT_TRUE(t.plan(2, ExecutionPolicy::anytime()));
+	// Staying with anytime scheduling, the second solution would be found like the first one, after 2 generator runs.
+	// Ordered scheduling computes the generator in each iteration, already running it a third time before.
+	EXPECT_THAT(gen_runs, ::testing::ElementsAre(1u, 3u));
+	EXPECT_EQ(gen->runs_, 4u);
+	EXPECT_EQ(bw1->runs_, 3u);
+	EXPECT_EQ(bw2->runs_, 2u);
+}
+
+// global scheduling picks the best ready stage across containers, yielding the same solutions
+TEST_F(ConnectConnect, GlobalScheduling) {
+	add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	add(t, new ConnectMockup());
+	auto inner = add(t, new SerialContainer());
+	auto bw = add(*inner, new BackwardMockup());
+	auto gen = add(*inner, new GeneratorMockup({ 10.0, 20.0 }));
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::global()));
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 21, 22));
+	EXPECT_EQ(gen->runs_, 2u);
+	EXPECT_EQ(bw->runs_, 2u);
+}
+
 // https://github.com/moveit/moveit_task_constructor/issues/218
 TEST_F(ConnectConnect, FailSucc) {
 	add(t, new GeneratorMockup());
@@ -83,3 +284,520 @@ TEST_F(ConnectConnect, UniqueEnumeration) {
 	EXPECT_EQ(con1->runs_, 3u * 2u);
 	EXPECT_EQ(con2->runs_, 2u * 2u);
 }
+
+// concurrently computed stages must yield the same solutions as sequential planning
+TEST_F(ConnectConnect, Parallel) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 100.0, 200.0 }));
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::parallel(4)));
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(111, 112, 113, 121, 122, 123, 211, 212, 213, 221, 222, 223));
+}
+
+// a ConcurrentSerialContainer yields the same solutions, also within a sequentially planning task
+TEST_F(ConnectConnect, ConcurrentSerialContainer) {
+	auto container = std::make_unique<ConcurrentSerialContainer>();
+	container->setThreads(4);
+	add(*container, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(*container, new ConnectMockup());
+	add(*container, new GeneratorMockup({ 10.0, 20.0 }));
+	add(*container, new ConnectMockup());
+	add(*container, new GeneratorMockup({ 100.0, 200.0 }));
+	t.add(std::move(container));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(111, 112, 113, 121, 122, 123, 211, 212, 213, 221, 222, 223));
+}
+
+// Generator spawning all its states at once
+struct BatchGenerator : Generator
+{
+	std::vector<double> costs_;
+	planning_scene::PlanningScenePtr ps_;
+	bool done_ = false;
+
+	BatchGenerator(std::vector<double> costs) : Generator("BATCH"), costs_(std::move(costs)) {}
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override {
+		ps_ = std::make_shared<planning_scene::PlanningScene>(robot_model);
+		Generator::init(robot_model);
+	}
+	bool canCompute() const override { return !done_; }
+	void compute() override {
+		std::vector<std::pair<InterfaceState, SubTrajectory>> batch;
+		for (double cost : costs_) {
+			SubTrajectory trajectory;
+			trajectory.setCost(cost);
+			batch.emplace_back(InterfaceState(ps_), std::move(trajectory));
+		}
+		spawnBatch(std::move(batch));
+		done_ = true;
+	}
+};
+
+// spawning a batch yields the same solutions as spawning states one by one
+TEST_F(ConnectConnect, SpawnBatch) {
+	auto gen = add(t, new BatchGenerator({ 3.0, 1.0, 2.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(gen->solutions().size(), 3u);
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12, 13, 21, 22, 23));
+}
+
+// Generator spawning all its states at once, placing the first joint at the given positions
+struct PositionGenerator : Generator
+{
+	std::vector<double> positions_;
+	planning_scene::PlanningScenePtr ps_;
+	bool done_ = false;
+
+	PositionGenerator(const std::string& name, std::vector<double> positions)
+	  : Generator(name), positions_(std::move(positions)) {}
+	void init(const moveit::core::RobotModelConstPtr& robot_model) override {
+		ps_ = std::make_shared<planning_scene::PlanningScene>(robot_model);
+		Generator::init(robot_model);
+	}
+	bool canCompute() const override { return !done_; }
+	void compute() override {
+		std::vector<std::pair<InterfaceState, SubTrajectory>> batch;
+		for (double position : positions_) {
+			auto scene = ps_->diff();
+			scene->getCurrentStateNonConst().setVariablePosition(0, position);
+			scene->getCurrentStateNonConst().update();
+			batch.emplace_back(InterfaceState(scene), SubTrajectory());
+		}
+		spawnBatch(std::move(batch));
+		done_ = true;
+	}
+};
+
+// Connecting stage recording the first joint position of the end states it was asked to connect
+struct RecordingConnect : ConnectMockup
+{
+	using ConnectMockup::ConnectMockup;
+	std::vector<double> ends_;
+	void compute(const InterfaceState& from, const InterfaceState& to) override {
+		ends_.push_back(to.scene()->getCurrentState().getVariablePosition(0));
+		ConnectMockup::compute(from, to);
+	}
+};
+
+// among pairs of equal priority, prefer_close_pairs connects the closest ones first
+TEST_F(ConnectConnect, PreferClosePairs) {
+	add(t, new PositionGenerator("START", { 0.0 }));
+	auto connect = add(t, new RecordingConnect());
+	add(t, new PositionGenerator("GOAL", { 0.9, 0.1, 0.5 }));
+	connect->setPreferClosePairs();
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 3u);
+	EXPECT_THAT(connect->ends_, ::testing::ElementsAre(0.1, 0.5, 0.9));
+}
+
+// pairs further apart than max_pair_distance are never attempted
+TEST_F(ConnectConnect, MaxPairDistance) {
+	add(t, new PositionGenerator("START", { 0.0 }));
+	auto connect = add(t, new RecordingConnect());
+	add(t, new PositionGenerator("GOAL", { 0.9, 0.1, 0.5 }));
+	connect->setMaxPairDistance(0.6);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 2u);
+	EXPECT_THAT(connect->ends_, ::testing::ElementsAre(0.1, 0.5));
+}
+
+// sequential goal set planning retries each unreachable goal only once, after all others were tried
+TEST_F(ConnectConnect, GoalSetRetries) {
+	struct Planner : solvers::JointInterpolationPlanner
+	{
+		std::vector<double> goals;  // first joint position of all planned goals
+		using JointInterpolationPlanner::plan;
+		Result plan(const planning_scene::PlanningSceneConstPtr& from, const planning_scene::PlanningSceneConstPtr& to,
+		            const moveit::core::JointModelGroup* jmg, double timeout,
+		            robot_trajectory::RobotTrajectoryPtr& result,
+		            const moveit_msgs::Constraints& path_constraints) override {
+			goals.push_back(to->getCurrentState().getVariablePosition(0));
+			if (goals.back() > 0.5)
+				return { false, "unreachable" };
+			return JointInterpolationPlanner::plan(from, to, jmg, timeout, result, path_constraints);
+		}
+	};
+	auto planner = std::make_shared<Planner>();
+	add(t, new PositionGenerator("START", { 0.0 }));
+	auto con = add(t, new stages::Connect("connect", { { "group", planner } }));
+	add(t, new PositionGenerator("GOAL", { 0.9, 0.1, 0.8, 0.2, 0.7, 0.3 }));
+	con->setBatchSize(6);
+	con->setGoalSet(true);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 3u);
+	EXPECT_THAT(planner->goals, ::testing::ElementsAre(0.9, 0.1, 0.8, 0.2, 0.7, 0.3, 0.9, 0.8, 0.7));
+}
+
+// Connecting stage counting the pair distances evaluated before its first computation
+struct CountingConnect : RecordingConnect
+{
+	using RecordingConnect::RecordingConnect;
+	mutable size_t distances_ = 0;
+	size_t distances_before_compute_ = 0;
+	double pairDistance(const InterfaceState& from, const InterfaceState& to) const override {
+		++distances_;
+		return RecordingConnect::pairDistance(from, to);
+	}
+	void compute(const InterfaceState& from, const InterfaceState& to) override {
+		if (ends_.empty())
+			distances_before_compute_ = distances_;
+		RecordingConnect::compute(from, to);
+	}
+};
+
+// prefer_close_pairs only compares close_pair_candidates pairs of equal priority
+TEST_F(ConnectConnect, ClosePairCandidates) {
+	add(t, new PositionGenerator("START", { 0.0 }));
+	auto connect = add(t, new CountingConnect());
+	add(t, new PositionGenerator("GOAL", { 0.9, 0.5, 0.7, 0.1 }));
+	connect->setPreferClosePairs();
+	connect->setClosePairCandidates(2);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 4u);
+	EXPECT_EQ(connect->distances_before_compute_, 2u);
+	EXPECT_THAT(connect->ends_, ::testing::ElementsAre(0.5, 0.7, 0.1, 0.9));
+}
+
+// pairs exceeding max_pair_distance are discarded, such that their distance is evaluated only once
+TEST_F(ConnectConnect, MaxPairDistanceEvaluatedOnce) {
+	add(t, new PositionGenerator("START", { 0.0 }));
+	auto connect = add(t, new CountingConnect());
+	add(t, new PositionGenerator("GOAL", { 0.9, 0.1, 0.8, 0.5 }));
+	connect->setMaxPairDistance(0.6);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 2u);
+	EXPECT_EQ(connect->distances_, 4u);
+}
+
+// pairs close to a failed one are postponed until all other pairs were tried
+TEST_F(ConnectConnect, PostponeNearFailures) {
+	const double inf = std::numeric_limits<double>::infinity();
+	add(t, new PositionGenerator("START", { 0.0 }));
+	auto connect = add(t, new RecordingConnect({ inf, 0.0, 0.0 }));
+	add(t, new PositionGenerator("GOAL", { 0.5, 0.52, 0.9 }));
+	connect->setFailureTolerance(0.1);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 2u);
+	EXPECT_THAT(connect->ends_, ::testing::ElementsAre(0.5, 0.9, 0.52));
+}
+
+// skip_near_failures never tries pairs close to a failed one
+TEST_F(ConnectConnect, SkipNearFailures) {
+	const double inf = std::numeric_limits<double>::infinity();
+	add(t, new PositionGenerator("START", { 0.0 }));
+	auto connect = add(t, new RecordingConnect({ inf, 0.0, 0.0 }));
+	add(t, new PositionGenerator("GOAL", { 0.5, 0.52, 0.9 }));
+	connect->setFailureTolerance(0.1);
+	connect->setSkipNearFailures();
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 1u);
+	EXPECT_THAT(connect->ends_, ::testing::ElementsAre(0.5, 0.9));
+}
+
+// planAsync() plans on the shared thread pool, reporting new solutions and iterations via its progress
+TEST_F(ConnectConnect, PlanAsync) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new ForwardMockup());
+
+	AsyncPlanning planning = t.planAsync();
+	std::vector<double> costs;
+	size_t iterations = 0;
+	PlanningProgress::Event event;
+	while (planning.progress->next(event)) {
+		if (event.solution)
+			costs.push_back(event.solution->cost());
+		iterations = event.iterations;
+	}
+	EXPECT_TRUE(planning.progress->finished());
+	EXPECT_EQ(planning.result.get().val, moveit::core::MoveItErrorCode::SUCCESS);
+	EXPECT_THAT(costs, ::testing::UnorderedElementsAre(1, 2, 3));
+	EXPECT_GT(iterations, 0u);
+	EXPECT_EQ(t.numSolutions(), 3u);
+}
+
+// preempt() stops asynchronous planning, even while it still waits for a free worker of the shared pool
+TEST_F(ConnectConnect, PreemptQueuedPlanAsync) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new ForwardMockup());
+
+	// occupy all shared workers
+	auto& pool = utils::ThreadPool::shared();
+	std::promise<void> release;
+	std::shared_future<void> released = release.get_future().share();
+	std::atomic<size_t> blocked{ 0 };
+	for (size_t i = 0; i < pool.size(); ++i)
+		pool.post([released, &blocked] {
+			++blocked;
+			released.wait();
+		});
+	while (blocked < pool.size())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	AsyncPlanning planning = t.planAsync();
+	t.preempt();
+	release.set_value();
+	EXPECT_EQ(planning.result.get().val, moveit::core::MoveItErrorCode::PREEMPTED);
+	EXPECT_EQ(t.numSolutions(), 0u);
+}
+
+// solution callbacks are called on another thread, but all solutions are delivered when plan() returns
+TEST_F(ConnectConnect, AsyncSolutionCallbacks) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+
+	const auto planning_thread = std::this_thread::get_id();
+	std::atomic<size_t> called{ 0 }, delivered{ 0 }, other_thread{ 0 };
+	t.addSolutionCallback([&](const SolutionBase& /*s*/) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));  // slow consumer
+		other_thread += std::this_thread::get_id() != planning_thread;
+		++called;
+	});
+	t.addSolutionBatchCallback([&](const std::vector<SolutionBaseConstPtr>& solutions) {
+		EXPECT_LE(solutions.size(), 2u);
+		delivered += solutions.size();
+	});
+	t.setAsyncSolutionCallbacks(4, 2);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(called, 6u);
+	EXPECT_EQ(delivered, 6u);
+	EXPECT_EQ(other_thread, 6u);
+}
+
+// with background teardown, reset() hands the planning graph to the reclaimer
+TEST_F(ConnectConnect, BackgroundTeardown) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	t.setBackgroundTeardown();
+	EXPECT_TRUE(t.backgroundTeardown());
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), 6u);
+	std::weak_ptr<const SolutionBase> solution = t.solutions().front();
+	t.reset();
+	EXPECT_TRUE(t.solutions().empty());
+	utils::Reclaimer::global().wait();
+	EXPECT_TRUE(solution.expired());
+}
+
+// profiling records nested timers of all stages, also when computed concurrently
+TEST_F(ConnectConnect, Profiling) {
+	add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	t.enableProfiling();
+
+	EXPECT_TRUE(t.plan(0, ExecutionPolicy::parallel(4)));
+	ASSERT_TRUE(t.profiler());
+	auto events = t.profiler()->events();
+	ASSERT_FALSE(events.empty());
+
+	std::map<std::string, size_t> categories;
+	for (const auto& e : events) {
+		++categories[e.category];
+		EXPECT_EQ(e.stack.rfind(t.name(), 0), 0u) << e.stack;  // nested within the task's timer
+	}
+	EXPECT_EQ(categories["task"], 1u);
+	EXPECT_GT(categories["compute"], 0u);
+	EXPECT_GT(categories["lift"], 0u);
+	EXPECT_GT(categories["cost"], 0u);
+
+	t.enableProfiling(false);
+	EXPECT_FALSE(t.profiler());
+}
+
+// solutions arriving after their neighbors were already enumerated need to extend the cached partial paths
+TEST_F(ConnectConnect, LateSolutions) {
+	add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	add(t, new ForwardMockup(PredefinedCosts::constant(100.0)));
+	add(t, new ForwardMockup());
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(111, 112, 121, 122));
+}
+
+// containers only retain their best max_retained_solutions
+TEST_F(ConnectConnect, MaxRetainedSolutions) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0 }));
+	add(t, new ConnectMockup());
+	add(t, new GeneratorMockup({ 10.0, 20.0 }));
+	t.stages()->setProperty("max_retained_solutions", 2u);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(11, 12));
+}
+
+// the task's root container releases solutions dropping out of its best max_retained_solutions
+TEST_F(ConnectConnect, RetainedSolutionsEvicted) {
+	add(t, new GeneratorMockup({ 3.0, 2.0, 1.0 }));
+	add(t, new ForwardMockup());
+	t.stages()->setProperty("max_retained_solutions", 2u);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_COSTS(t.solutions(), ::testing::ElementsAre(1, 2));
+}
+
+// a Connect in the prefix of planAndExecute() is fed backwards by the following stage: the prefix isn't final before
+TEST_F(ConnectConnect, PrefixWithConnect) {
+	auto gen = add(t, new GeneratorMockup({ 1.0 }));
+	auto con = add(t, new Connect({ 0.0, 0.0 }));
+	auto goal = add(t, new GeneratorMockup({ 2.0, 3.0 }));
+	t.init();
+	const TaskPrivate* impl = t.pimpl();
+	EXPECT_FALSE(impl->prefixFinalized(1));
+
+	gen->pimpl()->runCompute();
+	EXPECT_TRUE(impl->prefixFinalized(1));
+	EXPECT_FALSE(con->pimpl()->canCompute());  // no end states yet
+	EXPECT_FALSE(impl->prefixFinalized(2));  // but the goal generator will push some
+
+	goal->pimpl()->runCompute();
+	EXPECT_FALSE(impl->prefixFinalized(2));
+	while (con->pimpl()->canCompute())
+		con->pimpl()->runCompute();
+	EXPECT_FALSE(impl->prefixFinalized(2));  // the second goal might provide a better prefix
+	EXPECT_EQ(con->solutions().size(), 1u);
+
+	goal->pimpl()->runCompute();
+	while (con->pimpl()->canCompute())
+		con->pimpl()->runCompute();
+	EXPECT_FALSE(goal->pimpl()->canCompute());
+	EXPECT_TRUE(impl->prefixFinalized(2));
+	EXPECT_EQ(con->solutions().size(), 2u);
+}
+
+// approaching the memory budget, stages drop their failures first, but keep all solutions
+TEST_F(ConnectConnect, MemoryBudget) {
+	add(t, new GeneratorMockup({ 1.0, 2.0, 3.0, 4.0 }));
+	auto fwd = add(t, new ForwardMockup(PredefinedCosts({ INF, 0.0, INF, 0.0 })));
+	t.setMemoryBudget(1);
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.numSolutions(), 2u);
+	EXPECT_EQ(fwd->solutions().size(), 2u);
+	EXPECT_EQ(fwd->numFailures(), 2u);  // still counted
+	EXPECT_TRUE(fwd->failures().empty());
+
+	// degradation persists until reset
+	EXPECT_FALSE(fwd->storeFailures());
+	t.reset();
+	EXPECT_TRUE(fwd->storeFailures());
+}
+
+// the task's usage comprises each stage once, recomputed only for changed stages
+TEST_F(ConnectConnect, MemoryUsage) {
+	auto gen = add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	auto fwd = add(t, new ForwardMockup());
+	t.init();
+
+	gen->pimpl()->runCompute();
+	fwd->pimpl()->runCompute();
+	const auto sum = [&] {
+		return t.Stage::memoryUsage().total() + t.stages()->memoryUsage().total() + gen->memoryUsage().total() +
+		       fwd->memoryUsage().total();
+	};
+	const size_t usage = t.memoryUsage().total();
+	EXPECT_GT(usage, 0u);
+	EXPECT_EQ(usage, sum());
+
+	gen->pimpl()->runCompute();
+	EXPECT_GT(t.memoryUsage().total(), usage);
+	EXPECT_EQ(t.memoryUsage().total(), sum());
+
+	t.reset();
+	EXPECT_EQ(t.memoryUsage().total(), 0u);
+}
+
+// forward stage moving the group along a short, timed trajectory
+struct TrajectoryForward : public PropagatingForward
+{
+	TrajectoryForward() : PropagatingForward("TRAJ") {}
+	void computeForward(const InterfaceState& from) override {
+		const auto& robot_model = from.scene()->getRobotModel();
+		const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+		auto trajectory = std::make_shared<robot_trajectory::RobotTrajectory>(robot_model, jmg);
+		moveit::core::RobotState state(from.scene()->getCurrentState());
+		for (size_t i = 0; i < 5; ++i) {
+			state.setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), 0.1 * i));
+			state.update();
+			trajectory->addSuffixWayPoint(state, 0.5 * i);
+		}
+		sendForward(from, InterfaceState(from.scene()->diff()), SubTrajectory(trajectory));
+	}
+};
+
+// the last degradation step compacts the trajectories of stored solutions, and of further ones
+TEST_F(ConnectConnect, MemoryBudgetCompaction) {
+	auto gen = add(t, new GeneratorMockup({ 1.0, 2.0 }));
+	auto fwd = add(t, new TrajectoryForward());
+	t.init();
+	const auto is_compact = [](const SolutionBaseConstPtr& solution) {
+		return static_cast<const SubTrajectory&>(*solution).isCompact();
+	};
+
+	gen->pimpl()->runCompute();
+	fwd->pimpl()->runCompute();
+	ASSERT_EQ(fwd->solutions().size(), 1u);
+	EXPECT_FALSE(is_compact(fwd->solutions().front()));
+	const size_t trajectories = fwd->memoryUsage().trajectories;
+
+	t.pimpl()->degradeMemory(TaskPrivate::COMPACT_TRAJECTORIES);
+	EXPECT_TRUE(is_compact(fwd->solutions().front()));
+	EXPECT_LT(fwd->memoryUsage().trajectories, trajectories);
+	// compacted trajectories are rebuilt on demand
+	auto trajectory = static_cast<const SubTrajectory&>(*fwd->solutions().front()).trajectory();
+	ASSERT_TRUE(trajectory);
+	EXPECT_EQ(trajectory->getWayPointCount(), 5u);
+
+	gen->pimpl()->runCompute();
+	fwd->pimpl()->runCompute();
+	ASSERT_EQ(fwd->solutions().size(), 2u);
+	EXPECT_TRUE(std::all_of(fwd->solutions().begin(), fwd->solutions().end(), is_compact));
+}
+
+// if all degradation steps cannot keep the memory usage within the budget, planning stops
+TEST_F(ConnectConnect, MemoryBudgetExceeded) {
+	auto gen = add(t, new GeneratorMockup(PredefinedCosts::constant(0.0)));
+	add(t, new ForwardMockup(PredefinedCosts::constant(INF)));
+	t.setMemoryBudget(1);
+	t.setTimeout(10.0);
+
+	EXPECT_EQ(t.plan(), moveit::core::MoveItErrorCode::FAILURE);
+	EXPECT_LT(gen->runs_, 100u);  // instead of running into the timeout
+}
+
+// stages only store their most recent max_stored_failures failures
+TEST_F(ConnectConnect, MaxStoredFailures) {
+	auto gen = add(t, new GeneratorMockup({ 1.0, 2.0, 3.0, 4.0 }));
+	auto fwd = add(t, new ForwardMockup(PredefinedCosts::constant(INF)));
+	fwd->setProperty("max_stored_failures", 2u);
+
+	EXPECT_FALSE(t.plan());
+	EXPECT_EQ(fwd->numFailures(), 4u);
+	EXPECT_EQ(fwd->numFailures(FailureCode::UNSPECIFIED), 4u);
+	EXPECT_EQ(fwd->failures().size(), 2u);
+
+	// discarded failures were unregistered from their start states
+	size_t num_outgoing = 0;
+	for (const auto& solution : gen->solutions())
+		num_outgoing += solution->end()->outgoingTrajectories().size();
+	EXPECT_EQ(num_outgoing, 2u);
+}
@@ -0,0 +1,115 @@
+#include <moveit/task_constructor/solution_compression.h>
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+
+using namespace moveit::task_constructor;
+using moveit_task_constructor_msgs::CompressedSolution;
+using moveit_task_constructor_msgs::Solution;
+
+namespace {
+visualization_msgs::Marker marker(const std::string& ns, double x) {
+	visualization_msgs::Marker m;
+	m.ns = ns;
+	m.pose.position.x = x;
+	m.pose.orientation.w = 1.0;
+	return m;
+}
+
+Solution createSolution() {
+	Solution msg;
+	msg.task_id = "task";
+	msg.start_scene.robot_state.joint_state.name = { "a", "b" };
+	msg.start_scene.robot_state.joint_state.position = { 0.0, 0.0 };
+
+	for (size_t i = 0; i < 3; ++i) {
+		moveit_task_constructor_msgs::SubTrajectory sub;
+		sub.info.id = i + 1;
+		sub.info.markers = { marker("shared", 1.0), marker("own", i) };
+
+		auto& t = sub.trajectory.joint_trajectory;
+		t.joint_names = { "a" };
+		for (size_t w = 0; w < 10; ++w) {
+			trajectory_msgs::JointTrajectoryPoint p;
+			p.positions = { 0.1 * i + 0.01 * w + 1e-9 };
+			p.velocities = { 0.01 };
+			p.time_from_start = ros::Duration(0.1 * w);
+			t.points.push_back(p);
+		}
+
+		sub.scene_diff.is_diff = true;
+		sub.scene_diff.robot_state.is_diff = true;
+		sub.scene_diff.robot_state.joint_state.name = { "a", "b" };
+		sub.scene_diff.robot_state.joint_state.position = { 0.1 * i + 0.09 + 1e-9, 0.0 };
+		msg.sub_trajectory.push_back(sub);
+	}
+	return msg;
+}
+}  // namespace
+
+TEST(SolutionCompression, roundtrip) {
+	Solution msg = createSolution();
+	CompressedSolution compressed;
+	utils::compress(msg, compressed);
+	EXPECT_EQ(compressed.task_id, msg.task_id);
+
+	Solution restored;
+	utils::decompress(compressed, restored);
+	ASSERT_EQ(restored.sub_trajectory.size(), msg.sub_trajectory.size());
+
+	for (size_t i = 0; i < msg.sub_trajectory.size(); ++i) {
+		const auto& expected = msg.sub_trajectory[i];
+		const auto& actual = restored.sub_trajectory[i];
+		EXPECT_EQ(actual.info.id, expected.info.id);
+		EXPECT_EQ(actual.info.markers, expected.info.markers);
+
+		const auto& points = actual.trajectory.joint_trajectory.points;
+		ASSERT_EQ(points.size(), expected.trajectory.joint_trajectory.points.size());
+		for (size_t w = 0; w < points.size(); ++w) {
+			const auto& p = expected.trajectory.joint_trajectory.points[w];
+			ASSERT_EQ(points[w].positions.size(), 1u);
+			EXPECT_NEAR(points[w].positions[0], p.positions[0], 1e-5);
+			EXPECT_NEAR(points[w].velocities[0], p.velocities[0], 1e-5);
+			EXPECT_TRUE(points[w].accelerations.empty());
+			EXPECT_NEAR(points[w].time_from_start.toSec(), p.time_from_start.toSec(), 1e-4);
+		}
+
+		// unchanged joint b is only kept where it differs from the previous scene
+		const auto& state = actual.scene_diff.robot_state.joint_state;
+		EXPECT_EQ(state.name, std::vector<std::string>{ "a" });
+		EXPECT_EQ(state.position, std::vector<double>{ expected.scene_diff.robot_state.joint_state.position.front() });
+	}
+}
+
+TEST(SolutionCompression, exact) {
+	Solution msg = createSolution();
+	utils::SolutionCompression options;
+	options.resolution = 0.0;
+	CompressedSolution compressed;
+	utils::compress(msg, compressed, options);
+
+	Solution restored;
+	utils::decompress(compressed, restored);
+	for (size_t i = 0; i < msg.sub_trajectory.size(); ++i)
+		EXPECT_EQ(restored.sub_trajectory[i].trajectory, msg.sub_trajectory[i].trajectory);
+}
+
+TEST(SolutionCompression, smaller) {
+	Solution msg = createSolution();
+	for (size_t i = 0; i < 100; ++i)
+		msg.sub_trajectory.push_back(msg.sub_trajectory.back());
+
+	CompressedSolution compressed;
+	utils::compress(msg, compressed);
+	EXPECT_LT(compressed.data.size() * 5, ros::serialization::serializationLength(msg));
+}
+
+TEST(SolutionCompression, corrupt) {
+	CompressedSolution compressed;
+	utils::compress(createSolution(), compressed);
+	compressed.data.resize(compressed.data.size() / 2);
+
+	Solution restored;
+	EXPECT_THROW(utils::decompress(compressed, restored), std::runtime_error);
+}
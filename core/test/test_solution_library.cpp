@@ -0,0 +1,110 @@
+#include "models.h"
+
+#include <moveit/task_constructor/solution_library.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
+#include <moveit/task_constructor/stages/move_to.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_state/conversions.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <map>
+
+using namespace moveit::task_constructor;
+
+struct SolutionLibraryTest : public testing::Test
+{
+	Task task{ "", false };
+	planning_scene::PlanningScenePtr scene;
+	SolutionLibrary library;
+
+	SolutionLibraryTest() {
+		task.setRobotModel(getModel());
+		scene = std::make_shared<planning_scene::PlanningScene>(task.getRobotModel());
+		scene->getCurrentStateNonConst().setToDefaultValues();
+	}
+
+	// a solution moving all joints from the scene's state to target
+	moveit_task_constructor_msgs::Solution createSolution(double target) {
+		moveit_task_constructor_msgs::Solution msg;
+		scene->getPlanningSceneMsg(msg.start_scene);
+
+		const moveit::core::RobotState& state = scene->getCurrentState();
+		msg.sub_trajectory.resize(1);
+		auto& t = msg.sub_trajectory[0].trajectory.joint_trajectory;
+		t.joint_names = state.getVariableNames();
+		for (double value : { state.getVariablePosition(0), target }) {
+			t.points.emplace_back();
+			t.points.back().positions.assign(t.joint_names.size(), value);
+		}
+		msg.sub_trajectory[0].scene_diff.is_diff = true;
+		return msg;
+	}
+};
+
+TEST_F(SolutionLibraryTest, key) {
+	scene->getCurrentStateNonConst().setVariablePosition(0, 0.0);
+	const size_t key = library.key(task, *scene);
+	EXPECT_EQ(library.key(task, *scene), key);
+
+	// small deviations of the start state are ignored
+	scene->getCurrentStateNonConst().setVariablePosition(0, 1e-5);
+	EXPECT_EQ(library.key(task, *scene), key);
+	scene->getCurrentStateNonConst().setVariablePosition(0, 0.1);
+	EXPECT_NE(library.key(task, *scene), key);
+	scene->getCurrentStateNonConst().setVariablePosition(0, 0.0);
+
+	// properties are part of the key
+	task.properties().set("group", std::string("group"));
+	const size_t group_key = library.key(task, *scene);
+	EXPECT_NE(group_key, key);
+
+	// as are the stages and their goals
+	auto move_to = std::make_unique<stages::MoveTo>("move", std::make_shared<solvers::JointInterpolationPlanner>());
+	auto* move_to_ptr = move_to.get();
+	task.add(std::move(move_to));
+	const size_t stage_key = library.key(task, *scene);
+	EXPECT_NE(stage_key, group_key);
+	move_to_ptr->setGoal(std::map<std::string, double>{ { "base-link1-joint", 0.5 } });
+	const size_t goal_key = library.key(task, *scene);
+	EXPECT_NE(goal_key, stage_key);
+	move_to_ptr->setGoal(std::map<std::string, double>{ { "base-link1-joint", 1.0 } });
+	EXPECT_NE(library.key(task, *scene), goal_key);
+	move_to_ptr->setGoal(std::map<std::string, double>{ { "base-link1-joint", 0.5 } });
+	EXPECT_EQ(library.key(task, *scene), goal_key);
+
+	// values inherited from parents during init() are not part of the key
+	move_to_ptr->properties().property("group").setCurrentValue(std::string("group"));
+	EXPECT_EQ(library.key(task, *scene), goal_key);
+}
+
+TEST_F(SolutionLibraryTest, validate) {
+	auto solution = createSolution(0.1);
+	EXPECT_TRUE(library.validate(solution, *scene));
+
+	// solution needs to start from the current state
+	scene->getCurrentStateNonConst().setVariablePosition(0, 0.5);
+	EXPECT_FALSE(library.validate(solution, *scene));
+}
+
+TEST_F(SolutionLibraryTest, storage) {
+	moveit_task_constructor_msgs::Solution solution;
+	EXPECT_FALSE(library.find(42, solution));
+
+	library.insert(42, createSolution(0.1));
+	library.insert(43, createSolution(0.2));
+	ASSERT_TRUE(library.find(42, solution));
+	EXPECT_EQ(solution, createSolution(0.1));
+
+	const std::string path = testing::TempDir() + "test_solution_library.mtc";
+	library.save(path);
+
+	SolutionLibrary loaded;
+	loaded.load(path);
+	std::remove(path.c_str());
+	EXPECT_EQ(loaded.size(), 2u);
+	ASSERT_TRUE(loaded.find(43, solution));
+	EXPECT_EQ(solution, createSolution(0.2));
+}
@@ -0,0 +1,74 @@
+#include <moveit/task_constructor/solution_store.h>
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+
+using namespace moveit::task_constructor;
+
+namespace {
+moveit_task_constructor_msgs::Solution createSolution(size_t waypoints) {
+	moveit_task_constructor_msgs::Solution msg;
+	msg.task_id = "task";
+	msg.sub_trajectory.resize(1);
+	auto& t = msg.sub_trajectory[0].trajectory.joint_trajectory;
+	t.joint_names = { "joint" };
+	for (size_t i = 0; i < waypoints; ++i) {
+		t.points.emplace_back();
+		t.points.back().positions = { 0.1 * i };
+	}
+	return msg;
+}
+}  // namespace
+
+struct SolutionStoreTest : public testing::Test
+{
+	const std::string path = testing::TempDir() + "test_solution_store.mtc";
+	~SolutionStoreTest() override { std::remove(path.c_str()); }
+};
+
+TEST_F(SolutionStoreTest, roundtrip) {
+	{
+		utils::SolutionStoreWriter writer(path);
+		for (size_t i = 0; i < 5; ++i)
+			writer.add(createSolution(i), 0.5 * i, 10 + i);
+		EXPECT_EQ(writer.size(), 5u);
+	}  // closed on destruction
+
+	utils::SolutionStore store(path);
+	ASSERT_EQ(store.size(), 5u);
+	for (size_t i = 0; i < store.size(); ++i) {
+		EXPECT_EQ(store.cost(i), 0.5 * i);
+		EXPECT_EQ(store.id(i), 10 + i);
+
+		moveit_task_constructor_msgs::Solution msg;
+		store.load(i, msg);
+		EXPECT_EQ(msg, createSolution(i));
+	}
+	EXPECT_THROW(store.cost(5), std::out_of_range);
+}
+
+TEST_F(SolutionStoreTest, empty) {
+	utils::SolutionStoreWriter(path).close();
+	EXPECT_EQ(utils::SolutionStore(path).size(), 0u);
+}
+
+TEST_F(SolutionStoreTest, invalid) {
+	EXPECT_THROW(utils::SolutionStore store(path), std::runtime_error);  // missing
+
+	std::ofstream(path) << "not a solution store, but long enough to hold a header and a footer";
+	EXPECT_THROW(utils::SolutionStore store(path), std::runtime_error);
+
+	// an entry count overflowing the index size: 2^60 * 32 bytes wrap around to the actual (empty) size
+	utils::SolutionStoreWriter(path).close();
+	{
+		std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+		const uint64_t count = uint64_t(1) << 60;
+		static_assert(sizeof(utils::solution_store::Entry) == 32, "unexpected entry size");
+		file.seekp(-static_cast<std::streamoff>(sizeof(count)), std::ios::end);
+		file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+	}
+	EXPECT_THROW(utils::SolutionStore store(path), std::runtime_error);
+}
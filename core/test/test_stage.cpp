@@ -1,15 +1,29 @@
 #include "models.h"
 
 #include <moveit/task_constructor/stage_p.h>
+#include <moveit/task_constructor/batch_ik.h>
 #include <moveit/task_constructor/stages/compute_ik.h>
+#include <moveit/task_constructor/stages/connect.h>
+#include <moveit/task_constructor/stages/fixed_state.h>
+#include <moveit/task_constructor/stages/generate_random_pose.h>
+#include <moveit/task_constructor/solvers/joint_interpolation.h>
 #include <moveit/task_constructor/stages/modify_planning_scene.h>
+#include <moveit/task_constructor/task.h>
+#include <moveit/kinematics_base/kinematics_base.h>
 #include <moveit/planning_scene/planning_scene.h>
+#include <moveit/utils/robot_model_test_utils.h>
 #include <geometry_msgs/PoseStamped.h>
 
 #include "stage_mockups.h"
 #include <ros/console.h>
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <thread>
+
 using namespace moveit::task_constructor;
 using namespace planning_scene;
 
@@ -49,6 +63,57 @@ TEST(Stage, registerCallbacks) {
 	EXPECT_EQ(called, 1u);
 }
 
+TEST(Stage, memoryUsage) {
+	StandaloneGeneratorMockup g{ PredefinedCosts::constant(0.0) };
+	g.init(getModel());
+	EXPECT_EQ(g.memoryUsage().total(), 0u);
+
+	g.compute();
+	auto usage = g.memoryUsage();
+	EXPECT_GT(usage.states, 0u);
+	EXPECT_GT(usage.scenes, 0u);
+	EXPECT_GT(usage.trajectories, 0u);
+	EXPECT_EQ(usage.total(), usage.states + usage.scenes + usage.trajectories + usage.markers);
+
+	// a second solution adds a new state, but shares the generator's scene
+	g.compute();
+	auto next = g.memoryUsage();
+	EXPECT_EQ(next.states, 2 * usage.states);
+	EXPECT_EQ(next.scenes, usage.scenes);
+	EXPECT_EQ(next.trajectories, 2 * usage.trajectories);
+
+	g.reset();
+	EXPECT_EQ(g.memoryUsage().total(), 0u);
+}
+
+TEST(Stage, timeoutPercentile) {
+	StandaloneGeneratorMockup g{ PredefinedCosts::constant(0.0) };
+	g.setTimeout(10.0);
+	g.setTimeoutPercentile(0.9);
+	g.init(getModel());
+
+	// the timeout is only tuned once enough successful computes were observed
+	for (size_t i = 0; i < 9; ++i)
+		g.pimpl()->runCompute();
+	EXPECT_EQ(g.timeout(), 10.0);
+	g.pimpl()->runCompute();
+	EXPECT_LT(g.timeout(), 1.0);
+
+	// tuning survives re-initialization, while the configured timeout stays an upper bound
+	g.reset();
+	g.init(getModel());
+	EXPECT_LT(g.timeout(), 1.0);
+	g.setTimeoutPercentile(0.0);
+	g.reset();
+	g.init(getModel());
+	EXPECT_EQ(g.timeout(), 10.0);
+
+	// the percentile is a fraction: larger values are rejected instead of being clamped
+	g.setTimeoutPercentile(90.0);
+	g.reset();
+	EXPECT_THROW(g.init(getModel()), InitStageException);
+}
+
 TEST(ComputeIK, init) {
 	auto g = std::make_unique<GeneratorMockup>();
 	stages::ComputeIK ik("ik", std::move(g));
@@ -77,6 +142,471 @@ TEST(ComputeIK, init) {
 	EXPECT_NO_THROW(ik.init(robot_model));
 }
 
+TEST(ComputeIK, seedCache) {
+	struct Access : stages::ComputeIK
+	{
+		using ComputeIK::SeedCache;
+	};
+	moveit::core::RobotModelPtr robot_model = getModel();
+	const moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	const moveit::core::JointModelGroup* eef_jmg = robot_model->getJointModelGroup("eef_group");
+
+	Access::SeedCache cache;
+	Eigen::Isometry3d pose = Eigen::Isometry3d::Identity();
+	cache.insert(jmg, pose, { 0.0, 0.0 });
+	EXPECT_TRUE(cache.nearest(jmg, pose, 1).empty());  // disabled without capacity
+
+	cache.setCapacity(3);
+	for (int i = 0; i < 4; ++i) {
+		pose.translation().x() = i;
+		cache.insert(jmg, pose, { double(i), 0.0 });
+	}
+	cache.insert(eef_jmg, Eigen::Isometry3d::Identity(), { 42.0 });  // drops the solution for x = 1
+
+	pose.translation().x() = 0.2;
+	auto seeds = cache.nearest(jmg, pose, 5);
+	ASSERT_EQ(seeds.size(), 2u);
+	EXPECT_EQ(seeds[0][0], 2.0);  // closest target first
+	EXPECT_EQ(seeds[1][0], 3.0);
+	EXPECT_EQ(cache.nearest(eef_jmg, pose, 5).size(), 1u);
+
+	cache.clear();
+	EXPECT_TRUE(cache.nearest(jmg, pose, 5).empty());
+}
+
+// kinematics solver returning all solution branches in a single call, like IKFast, while numeric searches fail
+struct BranchingSolver : public kinematics::KinematicsBase
+{
+	std::vector<std::string> joints;
+	std::vector<std::string> links;
+	std::string base = "base";
+	std::string tip = "link2";
+	std::vector<std::vector<double>> branches{ { 0.0, 0.0 }, { 1.0, 1.0 }, { -1.0, 2.0 } };
+	mutable size_t searches = 0;
+
+	BranchingSolver(const moveit::core::JointModelGroup* jmg)
+	  : joints(jmg->getActiveJointModelNames()), links(jmg->getLinkModelNames()) {}
+
+	const std::string& getBaseFrame() const override { return base; }
+	const std::string& getTipFrame() const override { return tip; }
+	const std::vector<std::string>& getJointNames() const override { return joints; }
+	const std::vector<std::string>& getLinkNames() const override { return links; }
+
+	bool getPositionIK(const std::vector<geometry_msgs::Pose>& /*poses*/, const std::vector<double>& /*seed*/,
+	                   std::vector<std::vector<double>>& solutions, kinematics::KinematicsResult& /*result*/,
+	                   const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		solutions = branches;
+		return true;
+	}
+	bool getPositionIK(const geometry_msgs::Pose& /*pose*/, const std::vector<double>& /*seed*/,
+	                   std::vector<double>& /*solution*/, moveit_msgs::MoveItErrorCodes& /*error_code*/,
+	                   const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return false;
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& /*pose*/, const std::vector<double>& /*seed*/, double /*timeout*/,
+	                      std::vector<double>& /*solution*/, moveit_msgs::MoveItErrorCodes& /*error_code*/,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		++searches;
+		return false;
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& /*pose*/, const std::vector<double>& /*seed*/, double /*timeout*/,
+	                      const std::vector<double>& /*consistency_limits*/, std::vector<double>& /*solution*/,
+	                      moveit_msgs::MoveItErrorCodes& /*error_code*/,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		++searches;
+		return false;
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& /*pose*/, const std::vector<double>& /*seed*/, double /*timeout*/,
+	                      std::vector<double>& /*solution*/, const IKCallbackFn& /*callback*/,
+	                      moveit_msgs::MoveItErrorCodes& /*error_code*/,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		++searches;
+		return false;
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& /*pose*/, const std::vector<double>& /*seed*/, double /*timeout*/,
+	                      const std::vector<double>& /*consistency_limits*/, std::vector<double>& /*solution*/,
+	                      const IKCallbackFn& /*callback*/, moveit_msgs::MoveItErrorCodes& /*error_code*/,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		++searches;
+		return false;
+	}
+	bool getPositionFK(const std::vector<std::string>& /*link_names*/, const std::vector<double>& /*joint_angles*/,
+	                   std::vector<geometry_msgs::Pose>& /*poses*/) const override {
+		return false;
+	}
+};
+
+TEST(ComputeIK, multiSolutionIK) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	auto solver = std::make_shared<BranchingSolver>(jmg);
+	jmg->setSolverAllocators([solver](const moveit::core::JointModelGroup* /*jmg*/) { return solver; });
+
+	auto plan = [&robot_model](bool multi_solution_ik) {
+		Task t;
+		t.setRobotModel(robot_model);
+		auto ik = std::make_unique<stages::ComputeIK>("ik", std::make_unique<GeneratorMockup>());
+		ik->setGroup("group");
+		ik->setIKFrame("link2");
+		ik->setTargetPose(Eigen::Isometry3d::Identity(), "base");
+		ik->setMaxIKSolutions(5);
+		ik->setIgnoreCollisions(true);
+		ik->setMultiSolutionIK(multi_solution_ik);
+		t.add(std::move(ik));
+		t.plan();
+		return t.solutions().size();
+	};
+
+	// all branches are found at once, without numeric searches from random seeds
+	EXPECT_EQ(plan(true), 3u);
+	EXPECT_EQ(solver->searches, 0u);
+
+	EXPECT_EQ(plan(false), 0u);
+	EXPECT_GT(solver->searches, 0u);
+}
+
+// kinematics solver returning a new solution on each (numeric) search, recording its seeds and timeouts
+struct SequentialSolver : public kinematics::KinematicsBase
+{
+	std::vector<std::string> joints;
+	std::vector<std::string> links;
+	std::string base = "base";
+	std::string tip = "link2";
+	mutable std::vector<std::vector<double>> seeds;
+	mutable std::vector<double> timeouts;
+
+	SequentialSolver(const moveit::core::JointModelGroup* jmg)
+	  : joints(jmg->getActiveJointModelNames()), links(jmg->getLinkModelNames()) {}
+
+	const std::string& getBaseFrame() const override { return base; }
+	const std::string& getTipFrame() const override { return tip; }
+	const std::vector<std::string>& getJointNames() const override { return joints; }
+	const std::vector<std::string>& getLinkNames() const override { return links; }
+
+	bool search(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double timeout,
+	            std::vector<double>& solution, const IKCallbackFn& callback,
+	            moveit_msgs::MoveItErrorCodes& error_code) const {
+		seeds.push_back(seed);
+		timeouts.push_back(timeout);
+		solution.assign(seed.size(), 0.3 * seeds.size());
+		error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+		if (callback)
+			callback(pose, solution, error_code);
+		return error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS;
+	}
+	bool getPositionIK(const geometry_msgs::Pose& /*pose*/, const std::vector<double>& /*seed*/,
+	                   std::vector<double>& /*solution*/, moveit_msgs::MoveItErrorCodes& /*error_code*/,
+	                   const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return false;
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double timeout,
+	                      std::vector<double>& solution, moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, timeout, solution, IKCallbackFn(), error_code);
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double timeout,
+	                      const std::vector<double>& /*consistency_limits*/, std::vector<double>& solution,
+	                      moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, timeout, solution, IKCallbackFn(), error_code);
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double timeout,
+	                      std::vector<double>& solution, const IKCallbackFn& callback,
+	                      moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, timeout, solution, callback, error_code);
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double timeout,
+	                      const std::vector<double>& /*consistency_limits*/, std::vector<double>& solution,
+	                      const IKCallbackFn& callback, moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, timeout, solution, callback, error_code);
+	}
+	bool getPositionFK(const std::vector<std::string>& /*link_names*/, const std::vector<double>& /*joint_angles*/,
+	                   std::vector<geometry_msgs::Pose>& /*poses*/) const override {
+		return false;
+	}
+};
+
+// the seed search suspends at the end of each time slice, resuming with the remaining timeout and seeds
+TEST(ComputeIK, timeSlice) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	std::shared_ptr<SequentialSolver> solver;
+
+	auto plan = [&](double time_slice) {
+		solver = std::make_shared<SequentialSolver>(jmg);
+		jmg->setSolverAllocators([solver](const moveit::core::JointModelGroup* /*jmg*/) { return solver; });
+		Task t;
+		t.setRobotModel(robot_model);
+		t.setTimeSlice(time_slice);
+		auto ik = std::make_unique<stages::ComputeIK>("ik", std::make_unique<GeneratorMockup>());
+		ik->setGroup("group");
+		ik->setIKFrame("link2");
+		ik->setTargetPose(Eigen::Isometry3d::Identity(), "base");
+		ik->setMaxIKSolutions(3);
+		ik->setIgnoreCollisions(true);
+		ik->setMultiSolutionIK(false);
+		ik->setTimeout(10.0);
+		t.add(std::move(ik));
+		EXPECT_TRUE(t.plan());
+		std::vector<double> positions;
+		for (const auto& solution : t.solutions())
+			positions.push_back(solution->end()->variablePositions()[0]);
+		return positions;
+	};
+
+	const std::vector<double> uninterrupted = plan(0.0);
+	ASSERT_EQ(uninterrupted.size(), 3u);
+	EXPECT_GT(solver->timeouts.front(), 1.0);  // a single slice spanning the whole timeout
+
+	EXPECT_EQ(plan(1e-6), uninterrupted);
+	ASSERT_EQ(solver->seeds.size(), 3u);
+	for (double timeout : solver->timeouts)
+		EXPECT_LT(timeout, 0.1);  // each attempt is limited to its slice
+	// only the first attempt is seeded with the current state, resumed searches continue with random seeds
+	EXPECT_EQ(solver->seeds[0], std::vector<double>(jmg->getVariableCount(), 0.0));
+	EXPECT_NE(solver->seeds[1], solver->seeds[0]);
+	EXPECT_NE(solver->seeds[2], solver->seeds[0]);
+}
+
+// thread-safe kinematics solver snapping seeds to a coarse grid, i.e. many seeds yield similar solutions
+// Searches from the zero seed (the current state) are delayed, finishing after those of concurrent seeds.
+struct GridSolver : public kinematics::KinematicsBase
+{
+	std::vector<std::string> joints;
+	std::vector<std::string> links;
+	std::string base = "base";
+	std::string tip = "link2";
+	mutable std::atomic<size_t> searches{ 0 };
+
+	GridSolver(const moveit::core::JointModelGroup* jmg)
+	  : joints(jmg->getActiveJointModelNames()), links(jmg->getLinkModelNames()) {}
+
+	const std::string& getBaseFrame() const override { return base; }
+	const std::string& getTipFrame() const override { return tip; }
+	const std::vector<std::string>& getJointNames() const override { return joints; }
+	const std::vector<std::string>& getLinkNames() const override { return links; }
+
+	bool search(const geometry_msgs::Pose& pose, const std::vector<double>& seed, std::vector<double>& solution,
+	            const IKCallbackFn& callback, moveit_msgs::MoveItErrorCodes& error_code) const {
+		++searches;
+		if (std::all_of(seed.begin(), seed.end(), [](double v) { return v == 0.0; }))
+			std::this_thread::sleep_for(std::chrono::milliseconds(20));
+		solution.resize(seed.size());
+		for (size_t i = 0; i < seed.size(); ++i) {
+			const double grid = M_PI * std::round(seed[i] / M_PI);
+			solution[i] = grid + 0.1 * (seed[i] - grid);
+		}
+		error_code.val = moveit_msgs::MoveItErrorCodes::SUCCESS;
+		if (callback)
+			callback(pose, solution, error_code);
+		return error_code.val == moveit_msgs::MoveItErrorCodes::SUCCESS;
+	}
+	bool getPositionIK(const geometry_msgs::Pose& /*pose*/, const std::vector<double>& /*seed*/,
+	                   std::vector<double>& /*solution*/, moveit_msgs::MoveItErrorCodes& /*error_code*/,
+	                   const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return false;
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double /*timeout*/,
+	                      std::vector<double>& solution, moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, solution, IKCallbackFn(), error_code);
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double /*timeout*/,
+	                      const std::vector<double>& /*consistency_limits*/, std::vector<double>& solution,
+	                      moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, solution, IKCallbackFn(), error_code);
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double /*timeout*/,
+	                      std::vector<double>& solution, const IKCallbackFn& callback,
+	                      moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, solution, callback, error_code);
+	}
+	bool searchPositionIK(const geometry_msgs::Pose& pose, const std::vector<double>& seed, double /*timeout*/,
+	                      const std::vector<double>& /*consistency_limits*/, std::vector<double>& solution,
+	                      const IKCallbackFn& callback, moveit_msgs::MoveItErrorCodes& error_code,
+	                      const kinematics::KinematicsQueryOptions& /*options*/) const override {
+		return search(pose, seed, solution, callback, error_code);
+	}
+	bool getPositionFK(const std::vector<std::string>& /*link_names*/, const std::vector<double>& /*joint_angles*/,
+	                   std::vector<geometry_msgs::Pose>& /*poses*/) const override {
+		return false;
+	}
+};
+
+// concurrent seeds: similar solutions are dropped and solutions are spawned in seed order
+TEST(ComputeIK, concurrentSeeds) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	auto solver = std::make_shared<GridSolver>(jmg);
+	jmg->setSolverAllocators([solver](const moveit::core::JointModelGroup* /*jmg*/) { return solver; });
+
+	Task t;
+	t.setRobotModel(robot_model);
+	auto ik = std::make_unique<stages::ComputeIK>("ik", std::make_unique<GeneratorMockup>());
+	ik->setGroup("group");
+	ik->setIKFrame("link2");
+	ik->setTargetPose(Eigen::Isometry3d::Identity(), "base");
+	ik->setMaxIKSolutions(5);  // more than distinct grid cells: search until timeout
+	ik->setMinSolutionDistance(1.0);
+	ik->setIgnoreCollisions(true);
+	ik->setMultiSolutionIK(false);
+	ik->setTimeout(0.2);
+	ik->setNumThreads(4);
+
+	std::vector<std::vector<double>> spawned;
+	ik->addSolutionCallback([&spawned, jmg](const SolutionBase& s) {
+		std::vector<double> positions;
+		s.end()->scene()->getCurrentState().copyJointGroupPositions(jmg, positions);
+		spawned.push_back(positions);
+	});
+	t.add(std::move(ik));
+	EXPECT_TRUE(t.plan());
+
+	// two joints snapped to {0, pi} yield 4 grid cells, found by many more searches
+	ASSERT_EQ(spawned.size(), 4u);
+	EXPECT_GT(solver->searches, spawned.size());
+	for (size_t i = 0; i < spawned.size(); ++i)
+		for (size_t j = 0; j < i; ++j)
+			EXPECT_GE(jmg->distance(spawned[i].data(), spawned[j].data()), 1.0);
+
+	// the delayed first seed (the current state) is spawned first nevertheless
+	EXPECT_EQ(spawned.front(), std::vector<double>(jmg->getVariableCount(), 0.0));
+}
+
+// batch IK solver providing two candidates for even and none for odd queries
+struct AlternatingBatchIKSolver : public utils::BatchIKSolver
+{
+	mutable std::vector<size_t> batches;  // number of queries per call
+
+	void solve(const std::vector<Query>& queries, double /*timeout*/, Solutions& solutions) const override {
+		batches.push_back(queries.size());
+		solutions.assign(queries.size(), {});
+		for (size_t i = 0; i < queries.size(); i += 2)
+			solutions[i] = { { 0.0, 0.0 }, { 1.0, 1.0 } };
+	}
+};
+
+TEST(ComputeIK, batchIKSolver) {
+	auto solver = std::make_shared<AlternatingBatchIKSolver>();
+	Task t;
+	t.setRobotModel(getModel());
+	auto ik = std::make_unique<stages::ComputeIK>(
+	    "ik", std::make_unique<GeneratorMockup>(std::initializer_list<double>{ 0.0, 0.0, 0.0, 0.0 }, 4));
+	ik->setGroup("group");
+	ik->setIKFrame("link2");
+	ik->setTargetPose(Eigen::Isometry3d::Identity(), "base");
+	ik->setMaxIKSolutions(2);
+	ik->setIgnoreCollisions(true);
+	ik->setBatchSize(4);
+	ik->setTimeout(0.01);  // odd targets fall back to seeded searches
+	ik->setBatchIKSolver(solver);
+	auto* stage = ik.get();
+	t.add(std::move(ik));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(solver->batches, std::vector<size_t>{ 4u });  // all targets were solved in a single call
+	EXPECT_EQ(t.solutions().size(), 4u);  // both candidates of two targets
+	EXPECT_EQ(stage->failures().size(), 2u);  // no IK for the remaining targets
+}
+
+// batch IK solver never providing candidates, optionally claiming to provide all branches
+struct EmptyBatchIKSolver : public utils::BatchIKSolver
+{
+	bool all_branches = false;
+
+	void solve(const std::vector<Query>& queries, double /*timeout*/, Solutions& solutions) const override {
+		solutions.assign(queries.size(), {});
+	}
+	bool allBranches() const override { return all_branches; }
+};
+
+TEST(ComputeIK, batchIKFallback) {
+	moveit::core::RobotModelPtr robot_model = getModel();
+	moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	auto solver = std::make_shared<BranchingSolver>(jmg);
+	jmg->setSolverAllocators([solver](const moveit::core::JointModelGroup* /*jmg*/) { return solver; });
+
+	auto plan = [&robot_model](bool all_branches) {
+		auto batch_solver = std::make_shared<EmptyBatchIKSolver>();
+		batch_solver->all_branches = all_branches;
+		Task t;
+		t.setRobotModel(robot_model);
+		auto ik = std::make_unique<stages::ComputeIK>("ik", std::make_unique<GeneratorMockup>());
+		ik->setGroup("group");
+		ik->setIKFrame("link2");
+		ik->setTargetPose(Eigen::Isometry3d::Identity(), "base");
+		ik->setIgnoreCollisions(true);
+		ik->setTimeout(0.01);
+		ik->setBatchIKSolver(batch_solver);
+		t.add(std::move(ik));
+		t.plan();
+	};
+
+	// targets without batch candidates are searched from seeds
+	plan(false);
+	EXPECT_GT(solver->searches, 0u);
+
+	solver->searches = 0;
+	plan(true);
+	EXPECT_EQ(solver->searches, 0u);
+}
+
+// GenerateRandomPose counting its compute() calls
+struct CountingRandomPose : public stages::GenerateRandomPose
+{
+	size_t computes = 0;
+	using GenerateRandomPose::GenerateRandomPose;
+	void compute() override {
+		++computes;
+		GenerateRandomPose::compute();
+	}
+};
+
+// sampling suspends at the end of each time slice, resuming with the same sequence of samples
+TEST(GenerateRandomPose, timeSlice) {
+	auto plan = [](double time_slice, size_t& computes) {
+		Task t;
+		t.setRobotModel(getModel());
+		t.setTimeSlice(time_slice);
+		auto* monitored = new GeneratorMockup();
+		t.add(Stage::pointer(monitored));
+		t.add(std::make_unique<ConnectMockup>());
+		auto pose = std::make_unique<CountingRandomPose>("pose");
+		geometry_msgs::PoseStamped seed_pose;
+		seed_pose.header.frame_id = "base";
+		seed_pose.pose.orientation.w = 1.0;
+		pose->setPose(seed_pose);
+		pose->setMonitoredStage(monitored);
+		pose->sampleDimension<std::uniform_real_distribution>(stages::GenerateRandomPose::X, 0.1);
+		pose->setSeed(42);
+		pose->setMaxSolutions(5);
+		pose->setTimeout(10.0);
+		auto* stage = pose.get();
+		t.add(std::move(pose));
+		EXPECT_TRUE(t.plan());
+		computes = stage->computes;
+		std::vector<double> samples;
+		for (const auto& solution : stage->solutions()) {
+			const auto& props = solution->end()->properties();
+			samples.push_back(props.get<geometry_msgs::PoseStamped>("target_pose").pose.position.x);
+		}
+		return samples;
+	};
+
+	size_t uninterrupted_computes = 0;
+	const std::vector<double> uninterrupted = plan(0.0, uninterrupted_computes);
+	EXPECT_EQ(uninterrupted.size(), 5u);
+	EXPECT_EQ(uninterrupted_computes, 1u);
+
+	size_t sliced_computes = 0;
+	EXPECT_EQ(plan(1e-6, sliced_computes), uninterrupted);
+	EXPECT_GT(sliced_computes, 1u);
+}
+
 TEST(ModifyPlanningScene, allowCollisions) {
 	auto s = std::make_unique<stages::ModifyPlanningScene>();
 	std::string first = "foo", second = "boom";
@@ -124,6 +654,102 @@ void attachObject(PlanningScene& scene, const std::string& object, const std::st
 	scene.processAttachedCollisionObjectMsg(obj);
 }
 
+// only collisions of modified objects are detected, respecting the scene's allowed collisions
+TEST(ModifyPlanningScene, incrementalCollisionCheck) {
+	moveit::core::RobotModelBuilder builder("robot", "base");
+	builder.addChain("base->link1->link2->tip", "continuous");
+	geometry_msgs::Pose origin;
+	origin.orientation.w = 1.0;
+	builder.addCollisionBox("tip", { 0.1, 0.1, 0.1 }, origin);
+	builder.addGroupChain("base", "tip", "group");
+	auto scene = std::make_shared<PlanningScene>(builder.build());
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	spawnObject(*scene, "old", shape_msgs::SolidPrimitive::SPHERE);  // colliding with tip already
+	spawnObject(*scene, "allowed", shape_msgs::SolidPrimitive::SPHERE, { 1.0, 0, 0 });
+	scene->getAllowedCollisionMatrixNonConst().setEntry("allowed", "tip", true);
+
+	const auto object = [&scene](const std::string& name, double x) {
+		moveit_msgs::CollisionObject o;
+		o.id = name;
+		o.header.frame_id = scene->getPlanningFrame();
+		o.operation = moveit_msgs::CollisionObject::ADD;
+		o.primitive_poses.resize(1);
+		o.primitive_poses[0].position.x = x;
+		o.primitive_poses[0].orientation.w = 1.0;
+		o.primitives.resize(1);
+		o.primitives[0].type = shape_msgs::SolidPrimitive::SPHERE;
+		o.primitives[0].dimensions = { 0.05 };
+		return o;
+	};
+	const auto plan = [&scene](const std::function<void(stages::ModifyPlanningScene&)>& configure) {
+		Task t;
+		t.setRobotModel(scene->getRobotModel());
+		auto start = std::make_unique<stages::FixedState>("start", scene);
+		start->setIgnoreCollisions(true);
+		t.add(std::move(start));
+		auto modify = std::make_unique<stages::ModifyPlanningScene>("modify");
+		modify->setIncrementalCollisionCheck(true);
+		configure(*modify);
+		t.add(std::move(modify));
+		return static_cast<bool>(t.plan());
+	};
+
+	EXPECT_TRUE(plan([&](stages::ModifyPlanningScene& s) { s.addObject(object("new", 1.0)); }))
+	    << "collision of an unmodified object";
+	EXPECT_FALSE(plan([&](stages::ModifyPlanningScene& s) { s.addObject(object("new", 0.0)); }))
+	    << "new object colliding";
+	EXPECT_TRUE(plan([&](stages::ModifyPlanningScene& s) { s.addObject(object("allowed", 0.0)); }))
+	    << "replaced object allowed to collide";
+	EXPECT_FALSE(plan([&](stages::ModifyPlanningScene& s) {
+		s.addObject(object("new", 1.0));
+		s.allowCollisions("old", "tip", false);
+	})) << "forbidden collision";
+}
+
+// the eef pre-check respects a scene's default entries of world objects, not enabling links outside the eef again
+TEST(ComputeIK, eefPreCheckDefaultEntries) {
+	moveit::core::RobotModelBuilder builder("robot", "base");
+	std::vector<geometry_msgs::Pose> joint_origins(3);
+	for (auto& pose : joint_origins)
+		pose.orientation.w = 1.0;
+	joint_origins[1].position.x = 1.0;  // keep link2 and tip away from base for all joint values
+	builder.addChain("base->link1->link2->tip", "continuous", joint_origins);
+	geometry_msgs::Pose origin;
+	origin.orientation.w = 1.0;
+	builder.addCollisionBox("base", { 0.1, 0.1, 0.1 }, origin);
+	builder.addCollisionBox("tip", { 0.1, 0.1, 0.1 }, origin);
+	builder.addGroupChain("base", "link2", "group");
+	moveit::core::RobotModelPtr robot_model = builder.build();
+	moveit::core::JointModelGroup* jmg = robot_model->getJointModelGroup("group");
+	auto solver = std::make_shared<BranchingSolver>(jmg);
+	jmg->setSolverAllocators([solver](const moveit::core::JointModelGroup* /*jmg*/) { return solver; });
+
+	// the object only collides with base, which is explicitly allowed, while all other links are forbidden
+	auto scene = std::make_shared<PlanningScene>(robot_model);
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	spawnObject(*scene, "object", shape_msgs::SolidPrimitive::SPHERE);
+	scene->getAllowedCollisionMatrixNonConst().setDefaultEntry("object", false);
+	scene->getAllowedCollisionMatrixNonConst().setEntry("object", "base", true);
+
+	Task t;
+	t.setRobotModel(robot_model);
+	auto ik = std::make_unique<stages::ComputeIK>("ik", std::make_unique<stages::FixedState>("start", scene));
+	ik->setGroup("group");
+	ik->setIKFrame("link2");
+	Eigen::Isometry3d target = Eigen::Isometry3d::Identity();
+	target.translation().x() = 1.0;
+	ik->setTargetPose(target, "base");
+	ik->setMaxIKSolutions(5);
+	ik->setMultiSolutionIK(true);
+	auto* stage = ik.get();
+	t.add(std::move(ik));
+
+	EXPECT_TRUE(t.plan());
+	EXPECT_EQ(t.solutions().size(), solver->branches.size());
+	EXPECT_TRUE(stage->failures().empty()) << "eef wrongly considered colliding";
+	EXPECT_EQ(stage->numRejectedByCollision(), 0u);
+}
+
 TEST(Connect, compatible) {
 	ConnectMockup connect;
 	auto scene = std::make_shared<PlanningScene>(getModel());
@@ -156,3 +782,26 @@ TEST(Connect, compatible) {
 	attachObject(*other, "object", "tip", true);
 	EXPECT_FALSE(connect.compatible(scene, other)) << "different pose";
 }
+
+TEST(Connect, compatibleJoints) {
+	struct TestConnect : stages::Connect
+	{
+		using stages::Connect::Connect;
+		using stages::Connect::compatible;
+	};
+	auto model = getModel();
+	TestConnect connect("connect", { { "eef_group", std::make_shared<solvers::JointInterpolationPlanner>() } });
+	connect.init(model);
+
+	auto scene = std::make_shared<PlanningScene>(model);
+	scene->getCurrentStateNonConst().setToDefaultValues();
+	InterfaceState from(scene);
+
+	auto other = scene->diff();
+	other->getCurrentStateNonConst().setVariablePosition("link2-tip-joint", 1.0);
+	EXPECT_TRUE(connect.compatible(from, InterfaceState(other))) << "planned joint differs";
+
+	other = scene->diff();
+	other->getCurrentStateNonConst().setVariablePosition("base-link1-joint", 1.0);
+	EXPECT_FALSE(connect.compatible(from, InterfaceState(other))) << "unplanned joint differs";
+}
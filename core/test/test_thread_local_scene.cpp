@@ -0,0 +1,88 @@
+#include "models.h"
+
+#include <moveit/task_constructor/thread_local_scene.h>
+#include <moveit/planning_scene/planning_scene.h>
+
+#include <gtest/gtest.h>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+using namespace moveit::task_constructor::utils;
+
+TEST(ThreadLocalSceneView, clones) {
+	ThreadLocalSceneView::clearThreadCache();
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	ThreadLocalSceneView view(scene);
+	const planning_scene::PlanningScene* local = &view.local();
+	EXPECT_NE(local, scene.get());
+	EXPECT_EQ(local->getParent(), scene);
+	EXPECT_EQ(&view.local(), local);  // cached
+	EXPECT_EQ(&ThreadLocalSceneView(scene).local(), local);  // shared by views of the same scene
+	EXPECT_EQ(ThreadLocalSceneView::threadCacheSize(), 1u);
+
+	const planning_scene::PlanningScene* other = nullptr;
+	std::thread([&] { other = &view.local(); }).join();
+	EXPECT_NE(other, local);  // each thread has its own clone
+	EXPECT_EQ(ThreadLocalSceneView::threadCacheSize(), 1u);
+
+	EXPECT_THROW(ThreadLocalSceneView().local(), std::logic_error);
+}
+
+TEST(ThreadLocalSceneView, release) {
+	ThreadLocalSceneView::clearThreadCache();
+	moveit::core::RobotModelPtr robot_model = getModel();
+	auto scene = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	std::weak_ptr<const planning_scene::PlanningScene> weak = scene;
+	ThreadLocalSceneView view(scene);
+	view.local();
+	view.setScene(std::make_shared<planning_scene::PlanningScene>(robot_model));
+	scene.reset();
+	EXPECT_FALSE(weak.expired());  // kept alive by its clone
+	view.local();
+	EXPECT_TRUE(weak.expired());  // released, nobody else viewing it
+	EXPECT_EQ(ThreadLocalSceneView::threadCacheSize(), 1u);
+
+	std::vector<planning_scene::PlanningScenePtr> scenes;
+	for (size_t i = 0; i < ThreadLocalSceneView::CACHE_SIZE + 2; ++i) {
+		scenes.push_back(std::make_shared<planning_scene::PlanningScene>(robot_model));
+		ThreadLocalSceneView(scenes.back()).local();
+	}
+	EXPECT_EQ(ThreadLocalSceneView::threadCacheSize(), ThreadLocalSceneView::CACHE_SIZE);
+	ThreadLocalSceneView::clearThreadCache();
+	EXPECT_EQ(ThreadLocalSceneView::threadCacheSize(), 0u);
+}
+
+TEST(ThreadLocalSceneView, releaseUnused) {
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	std::weak_ptr<const planning_scene::PlanningScene> weak = scene;
+	bool viewed = false;
+	bool release = false;
+	std::mutex mutex;
+	std::condition_variable cv;
+	// an idle thread keeping its clone
+	std::thread idle([&] {
+		ThreadLocalSceneView(scene).local();
+		std::unique_lock<std::mutex> lock(mutex);
+		viewed = true;
+		cv.notify_all();
+		cv.wait(lock, [&] { return release; });
+	});
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		cv.wait(lock, [&] { return viewed; });
+	}
+	ThreadLocalSceneView::releaseUnused();
+	EXPECT_FALSE(weak.expired()) << "released a clone of a referenced scene";
+	scene.reset();
+	EXPECT_FALSE(weak.expired());  // kept alive by the clone of the idle thread
+	ThreadLocalSceneView::releaseUnused();
+	EXPECT_TRUE(weak.expired());
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		release = true;
+	}
+	cv.notify_all();
+	idle.join();
+}
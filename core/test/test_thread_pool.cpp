@@ -0,0 +1,134 @@
+#include <moveit/task_constructor/thread_pool.h>
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using namespace moveit::task_constructor::utils;
+
+namespace {
+// block the workers of a pool until release() is called
+struct Blocker
+{
+	std::promise<void> released;
+	std::shared_future<void> future{ released.get_future().share() };
+	void block(ThreadPool& pool, size_t workers) {
+		for (size_t i = 0; i < workers; ++i)
+			pool.post([f = future] { f.wait(); });
+	}
+	void release() { released.set_value(); }
+};
+}  // namespace
+
+TEST(ThreadPool, run) {
+	ThreadPool pool(4);
+	EXPECT_EQ(pool.size(), 4u);
+	std::atomic<size_t> count{ 0 };
+	std::vector<ThreadPool::Job> jobs(100, [&count] { ++count; });
+	pool.run(jobs);
+	EXPECT_EQ(count, 100u);
+
+	jobs.push_back([] { throw std::runtime_error("failed"); });
+	EXPECT_THROW(pool.run(jobs), std::runtime_error);
+}
+
+TEST(ThreadPool, view) {
+	ThreadPool pool(4);
+	ThreadPool view(pool, 2);
+	EXPECT_EQ(view.size(), 2u);
+	EXPECT_EQ(ThreadPool(pool, 0).size(), 4u);
+
+	// the view processes at most two jobs concurrently
+	std::mutex mutex;
+	size_t running = 0, max_running = 0;
+	std::vector<ThreadPool::Job> jobs(20, [&] {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			max_running = std::max(max_running, ++running);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::lock_guard<std::mutex> lock(mutex);
+		--running;
+	});
+	view.run(jobs);
+	EXPECT_LE(max_running, 2u);
+	EXPECT_EQ(running, 0u);
+
+	// with busy workers, the calling thread processes all jobs itself
+	Blocker blocker;
+	blocker.block(pool, 3);
+	std::atomic<size_t> count{ 0 };
+	view.run(std::vector<ThreadPool::Job>(10, [&count] { ++count; }));
+	EXPECT_EQ(count, 10u);
+	blocker.release();
+}
+
+TEST(ThreadPool, viewNested) {
+	ThreadPool pool(4);
+	ThreadPool view(pool, 2);
+
+	// nested batches share the limit of the view
+	std::mutex mutex;
+	size_t running = 0, max_running = 0;
+	std::vector<ThreadPool::Job> inner(10, [&] {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			max_running = std::max(max_running, ++running);
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		std::lock_guard<std::mutex> lock(mutex);
+		--running;
+	});
+	view.run(std::vector<ThreadPool::Job>(4, [&] { view.run(inner); }));
+	EXPECT_LE(max_running, 2u);
+	EXPECT_EQ(running, 0u);
+}
+
+TEST(ThreadPool, priorities) {
+	ThreadPool pool(2);  // a single worker
+	Blocker blocker;
+	blocker.block(pool, 1);
+
+	std::mutex mutex;
+	std::vector<int> order;
+	std::promise<void> done;
+	auto record = [&](int value) {
+		return [&, value] {
+			std::lock_guard<std::mutex> lock(mutex);
+			order.push_back(value);
+		};
+	};
+	pool.post(record(ThreadPool::LOW), ThreadPool::LOW);
+	pool.post(record(ThreadPool::NORMAL));
+	pool.post(record(ThreadPool::HIGH), ThreadPool::HIGH);
+	pool.post([&done] { done.set_value(); }, ThreadPool::LOW);
+	blocker.release();
+	done.get_future().wait();
+	EXPECT_EQ(order, std::vector<int>({ ThreadPool::HIGH, ThreadPool::NORMAL, ThreadPool::LOW }));
+}
+
+TEST(ThreadPool, tryPost) {
+	ThreadPool pool(2);  // a single worker
+	// wait until the worker is idle
+	std::promise<void> started;
+	while (!pool.tryPost([&started] { started.set_value(); }))
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	started.get_future().wait();
+
+	Blocker blocker;
+	blocker.block(pool, 1);
+	EXPECT_FALSE(pool.tryPost([] { FAIL() << "job shouldn't be queued"; }));
+	blocker.release();
+}
+
+TEST(ThreadPool, configureShared) {
+	ThreadPool::shared();
+	EXPECT_FALSE(ThreadPool::configureShared(1));  // already created
+}
@@ -0,0 +1,84 @@
+#include "models.h"
+
+#include <moveit/task_constructor/trajectory_optimizer.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+#include <moveit/robot_trajectory/robot_trajectory.h>
+
+#include <gtest/gtest.h>
+
+using namespace moveit::task_constructor;
+
+namespace {
+// duration proportional to the joint-space path length, independent of joint limits
+utils::TrajectoryOptimizer::Timing lengthTiming(const moveit::core::JointModelGroup* jmg) {
+	return [jmg](robot_trajectory::RobotTrajectory& t) {
+		for (size_t i = 1; i < t.getWayPointCount(); ++i)
+			t.setWayPointDurationFromPrevious(i, t.getWayPoint(i - 1).distance(t.getWayPoint(i), jmg));
+	};
+}
+
+robot_trajectory::RobotTrajectory path(const planning_scene::PlanningScene& scene,
+                                       const moveit::core::JointModelGroup* jmg, std::initializer_list<double> values) {
+	robot_trajectory::RobotTrajectory trajectory(scene.getRobotModel(), jmg);
+	moveit::core::RobotState state(scene.getCurrentState());
+	for (double value : values) {
+		state.setJointGroupPositions(jmg, std::vector<double>(jmg->getVariableCount(), value));
+		state.update();
+		trajectory.addSuffixWayPoint(state, 0.0);
+	}
+	lengthTiming(jmg)(trajectory);
+	return trajectory;
+}
+}  // namespace
+
+TEST(TrajectoryOptimizer, shortcut) {
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	const moveit::core::JointModelGroup* jmg = scene->getRobotModel()->getJointModelGroup("group");
+	const robot_trajectory::RobotTrajectory detour = path(*scene, jmg, { 0.0, 0.5, -0.3, 0.4, 0.2 });
+
+	utils::TrajectoryOptimizer optimizer;
+	optimizer.setTiming(lengthTiming(jmg));
+	robot_trajectory::RobotTrajectoryPtr optimized = optimizer.optimize(scene, scene, detour, 0);
+	ASSERT_TRUE(optimized);
+	EXPECT_LT(optimized->getDuration(), detour.getDuration());
+	// start and goal are kept
+	EXPECT_EQ(optimized->getFirstWayPoint().distance(detour.getFirstWayPoint()), 0.0);
+	EXPECT_EQ(optimized->getLastWayPoint().distance(detour.getLastWayPoint()), 0.0);
+	// an already straight path cannot be improved
+	EXPECT_FALSE(optimizer.optimize(scene, scene, path(*scene, jmg, { 0.0, 0.1, 0.2 }), 0));
+}
+
+TEST(TrajectoryOptimizer, keepsOriginalSolutions) {
+	auto scene = std::make_shared<planning_scene::PlanningScene>(getModel());
+	const moveit::core::JointModelGroup* jmg = scene->getRobotModel()->getJointModelGroup("group");
+	const robot_trajectory::RobotTrajectory detour = path(*scene, jmg, { 0.0, 0.5, -0.3, 0.4, 0.2 });
+
+	InterfaceState start(scene), end(scene);
+	auto sub = std::make_shared<SubTrajectory>(std::make_shared<robot_trajectory::RobotTrajectory>(detour));
+	sub->setStartState(start);
+	sub->setEndState(end);
+	auto sequence = std::make_shared<SolutionSequence>(SolutionSequence::container_type{ sub.get() });
+
+	utils::TrajectoryOptimizer optimizer;
+	optimizer.setFilter([](const SubTrajectory& /* unused */) { return true; });
+	optimizer.setTiming(lengthTiming(jmg));
+	const utils::TrajectoryOptimizer::Result result = optimizer.optimize(*sequence);
+	EXPECT_EQ(result.improved, 1u);
+	EXPECT_DOUBLE_EQ(result.duration_before, detour.getDuration());
+	EXPECT_LT(result.duration_after, result.duration_before);
+
+	// the original solution is untouched
+	EXPECT_DOUBLE_EQ(sub->trajectory()->getDuration(), detour.getDuration());
+	ASSERT_EQ(result.solutions.size(), 1u);
+	auto copy = std::dynamic_pointer_cast<const SolutionSequence>(result.solutions.front());
+	ASSERT_TRUE(copy);
+	EXPECT_NE(copy, sequence);
+	ASSERT_EQ(copy->solutions().size(), 1u);
+	const auto* optimized = dynamic_cast<const SubTrajectory*>(copy->solutions().front());
+	ASSERT_TRUE(optimized);
+	EXPECT_NE(optimized, sub.get());
+	EXPECT_DOUBLE_EQ(optimized->trajectory()->getDuration(), result.duration_after);
+	EXPECT_EQ(optimized->start(), &start);
+	EXPECT_EQ(optimized->end(), &end);
+}
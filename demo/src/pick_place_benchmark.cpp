@@ -0,0 +1,409 @@
+/*********************************************************************
+ * Copyright (c) 2023, Bielefeld University
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ *  * Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ *  * Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ *  * Neither the name of the copyright holder nor the names of its
+ *    contributors may be used to endorse or promote products derived from
+ *    this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/* Desc:   Pick-place benchmark scaling the number of objects, grasp candidates, and subtasks
+*/
+
+#include <moveit/task_constructor/task.h>
+#include <moveit/task_constructor/stages/compute_ik.h>
+#include <moveit/task_constructor/stages/connect.h>
+#include <moveit/task_constructor/stages/fixed_state.h>
+#include <moveit/task_constructor/stages/generate_grasp_pose.h>
+#include <moveit/task_constructor/stages/generate_place_pose.h>
+#include <moveit/task_constructor/stages/modify_planning_scene.h>
+#include <moveit/task_constructor/stages/move_relative.h>
+#include <moveit/task_constructor/stages/move_to.h>
+#include <moveit/task_constructor/solvers/cartesian_path.h>
+#include <moveit/task_constructor/solvers/pipeline_planner.h>
+
+#include <ros/ros.h>
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/robot_model/robot_model.h>
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sys/resource.h>
+#include <unistd.h>
+
+using namespace moveit::task_constructor;
+
+constexpr char LOGNAME[] = "pick_place_benchmark";
+
+namespace {
+
+const std::string ARM = "panda_arm";
+const std::string HAND = "hand";
+const std::string HAND_FRAME = "panda_link8";
+const std::string TABLE = "table";
+constexpr double OBJECT_HEIGHT = 0.2;
+constexpr double OBJECT_RADIUS = 0.02;
+constexpr double SPACING = 0.1;  // distance between neighbouring objects
+
+struct Scenario
+{
+	unsigned int objects;  // N objects in clutter
+	unsigned int grasps;  // M grasp candidates per object
+	unsigned int subtasks;  // K sequential pick-place subtasks (picking the first K objects)
+};
+
+std::string objectName(unsigned int i) {
+	return "object" + std::to_string(i);
+}
+
+moveit_msgs::CollisionObject primitive(const std::string& id, const std::string& frame, uint8_t type,
+                                       const std::vector<double>& dimensions, double x, double y, double z) {
+	moveit_msgs::CollisionObject object;
+	object.id = id;
+	object.header.frame_id = frame;
+	object.primitives.resize(1);
+	object.primitives[0].type = type;
+	object.primitives[0].dimensions = dimensions;
+	object.primitive_poses.resize(1);
+	object.primitive_poses[0].position.x = x;
+	object.primitive_poses[0].position.y = y;
+	object.primitive_poses[0].position.z = z;
+	object.primitive_poses[0].orientation.w = 1.0;
+	return object;
+}
+
+// place location of the k-th picked object: a row on the (otherwise free) left half of the table
+geometry_msgs::PoseStamped placePose(unsigned int k, const std::string& frame) {
+	geometry_msgs::PoseStamped p;
+	p.header.frame_id = frame;
+	p.pose.position.x = 0.35 + SPACING * (k % 4);
+	p.pose.position.y = 0.15 + SPACING * (k / 4);
+	p.pose.position.z = 0.5 * OBJECT_HEIGHT + 0.0001;
+	p.pose.orientation.w = 1.0;
+	return p;
+}
+
+// table with N cylinders arranged in a grid on its right half, robot in its "ready" pose with open hand
+planning_scene::PlanningScenePtr createScene(const moveit::core::RobotModelConstPtr& robot_model,
+                                             unsigned int objects) {
+	auto scene = std::make_shared<planning_scene::PlanningScene>(robot_model);
+	auto& state = scene->getCurrentStateNonConst();
+	state.setToDefaultValues(state.getJointModelGroup(ARM), "ready");
+	state.setToDefaultValues(state.getJointModelGroup(HAND), "open");
+	const std::string& frame = robot_model->getModelFrame();
+
+	scene->processCollisionObjectMsg(
+	    primitive(TABLE, frame, shape_msgs::SolidPrimitive::BOX, { 0.5, 1.2, 0.1 }, 0.5, 0.0, -0.05));
+	const unsigned int columns = std::max(1u, static_cast<unsigned int>(std::ceil(std::sqrt(objects))));
+	for (unsigned int i = 0; i < objects; ++i)
+		scene->processCollisionObjectMsg(primitive(objectName(i), frame, shape_msgs::SolidPrimitive::CYLINDER,
+		                                           { OBJECT_HEIGHT, OBJECT_RADIUS }, 0.35 + SPACING * (i % columns),
+		                                           -0.1 - SPACING * (i / columns), 0.5 * OBJECT_HEIGHT));
+	return scene;
+}
+
+// pick object (approach, grasp, lift), monitoring the given stage for grasp generation
+std::unique_ptr<SerialContainer> createPick(Task& t, const std::string& object, unsigned int grasps,
+                                            Stage* monitored, const solvers::PlannerInterfacePtr& sampling,
+                                            const solvers::PlannerInterfacePtr& cartesian) {
+	auto pick = std::make_unique<SerialContainer>("pick " + object);
+	t.properties().exposeTo(pick->properties(), { "eef", "hand", "group", "ik_frame" });
+	pick->properties().configureInitFrom(Stage::PARENT, { "eef", "hand", "group", "ik_frame" });
+	const auto hand_links = t.getRobotModel()->getJointModelGroup(HAND)->getLinkModelNamesWithCollisionGeometry();
+	{
+		auto stage = std::make_unique<stages::MoveRelative>("approach object", cartesian);
+		stage->properties().set("link", HAND_FRAME);
+		stage->properties().configureInitFrom(Stage::PARENT, { "group" });
+		stage->setMinMaxDistance(0.1, 0.15);
+		geometry_msgs::Vector3Stamped vec;
+		vec.header.frame_id = HAND_FRAME;
+		vec.vector.z = 1.0;
+		stage->setDirection(vec);
+		pick->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::GenerateGraspPose>("generate grasp pose");
+		stage->properties().configureInitFrom(Stage::PARENT);
+		stage->setPreGraspPose("open");
+		stage->setObject(object);
+		stage->setAngleDelta(2.0 * M_PI / grasps);
+		stage->setMonitoredStage(monitored);
+
+		auto wrapper = std::make_unique<stages::ComputeIK>("grasp pose IK", std::move(stage));
+		wrapper->setMaxIKSolutions(8);
+		wrapper->setMinSolutionDistance(1.0);
+		// same grasp frame as the pick-place demo: [0, 0, 0.1, pi/2, pi/4, pi/2]
+		Eigen::Isometry3d grasp_frame = Eigen::Isometry3d::Identity();
+		grasp_frame.translate(Eigen::Vector3d(0, 0, 0.1));
+		grasp_frame.rotate(Eigen::AngleAxisd(M_PI_2, Eigen::Vector3d::UnitX()) *
+		                   Eigen::AngleAxisd(M_PI_4, Eigen::Vector3d::UnitY()) *
+		                   Eigen::AngleAxisd(M_PI_2, Eigen::Vector3d::UnitZ()));
+		wrapper->setIKFrame(grasp_frame, HAND_FRAME);
+		wrapper->properties().configureInitFrom(Stage::PARENT, { "eef", "group" });
+		wrapper->properties().configureInitFrom(Stage::INTERFACE, { "target_pose" });
+		pick->insert(std::move(wrapper));
+	}
+	{
+		auto stage = std::make_unique<stages::ModifyPlanningScene>("allow collision (hand,object)");
+		stage->allowCollisions(object, hand_links, true);
+		pick->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::MoveTo>("close hand", sampling);
+		stage->setGroup(HAND);
+		stage->setGoal("close");
+		pick->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::ModifyPlanningScene>("attach object");
+		stage->attachObject(object, HAND_FRAME);
+		pick->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::ModifyPlanningScene>("allow collision (object,support)");
+		stage->allowCollisions(object, TABLE, true);
+		pick->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::MoveRelative>("lift object", cartesian);
+		stage->properties().configureInitFrom(Stage::PARENT, { "group" });
+		stage->setMinMaxDistance(0.01, 0.1);
+		stage->setIKFrame(HAND_FRAME);
+		geometry_msgs::Vector3Stamped vec;
+		vec.header.frame_id = t.getRobotModel()->getModelFrame();
+		vec.vector.z = 1.0;
+		stage->setDirection(vec);
+		pick->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::ModifyPlanningScene>("forbid collision (object,support)");
+		stage->allowCollisions(object, TABLE, false);
+		pick->insert(std::move(stage));
+	}
+	return pick;
+}
+
+// place object at its place pose (lower, release, retreat), monitoring the given pick stage
+std::unique_ptr<SerialContainer> createPlace(Task& t, const std::string& object, unsigned int k, Stage* pick,
+                                             const solvers::PlannerInterfacePtr& sampling,
+                                             const solvers::PlannerInterfacePtr& cartesian) {
+	auto place = std::make_unique<SerialContainer>("place " + object);
+	t.properties().exposeTo(place->properties(), { "eef", "hand", "group" });
+	place->properties().configureInitFrom(Stage::PARENT, { "eef", "hand", "group" });
+	{
+		auto stage = std::make_unique<stages::MoveRelative>("lower object", cartesian);
+		stage->properties().set("link", HAND_FRAME);
+		stage->properties().configureInitFrom(Stage::PARENT, { "group" });
+		stage->setMinMaxDistance(.03, .13);
+		geometry_msgs::Vector3Stamped vec;
+		vec.header.frame_id = t.getRobotModel()->getModelFrame();
+		vec.vector.z = -1.0;
+		stage->setDirection(vec);
+		place->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::GeneratePlacePose>("generate place pose");
+		stage->properties().configureInitFrom(Stage::PARENT, { "ik_frame" });
+		stage->setObject(object);
+		stage->setPose(placePose(k, t.getRobotModel()->getModelFrame()));
+		stage->setMonitoredStage(pick);
+
+		auto wrapper = std::make_unique<stages::ComputeIK>("place pose IK", std::move(stage));
+		wrapper->setMaxIKSolutions(2);
+		wrapper->setIKFrame(HAND_FRAME);
+		wrapper->properties().configureInitFrom(Stage::PARENT, { "eef", "group" });
+		wrapper->properties().configureInitFrom(Stage::INTERFACE, { "target_pose" });
+		place->insert(std::move(wrapper));
+	}
+	{
+		auto stage = std::make_unique<stages::MoveTo>("open hand", sampling);
+		stage->setGroup(HAND);
+		stage->setGoal("open");
+		place->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::ModifyPlanningScene>("release object");
+		stage->allowCollisions(object, *t.getRobotModel()->getJointModelGroup(HAND), false);
+		stage->detachObject(object, HAND_FRAME);
+		place->insert(std::move(stage));
+	}
+	{
+		auto stage = std::make_unique<stages::MoveRelative>("retreat after place", cartesian);
+		stage->properties().configureInitFrom(Stage::PARENT, { "group" });
+		stage->setMinMaxDistance(.12, .25);
+		stage->setIKFrame(HAND_FRAME);
+		geometry_msgs::Vector3Stamped vec;
+		vec.header.frame_id = HAND_FRAME;
+		vec.vector.z = -1.0;
+		stage->setDirection(vec);
+		place->insert(std::move(stage));
+	}
+	return place;
+}
+
+std::unique_ptr<Task> createTask(const moveit::core::RobotModelConstPtr& robot_model, const Scenario& s) {
+	auto task = std::make_unique<Task>("", false);
+	Task& t = *task;
+	t.stages()->setName("pick-place benchmark (" + std::to_string(s.objects) + " objects, " +
+	                    std::to_string(s.grasps) + " grasps, " + std::to_string(s.subtasks) + " subtasks)");
+	t.setRobotModel(robot_model);
+	t.setProperty("group", ARM);
+	t.setProperty("eef", HAND);
+	t.setProperty("hand", HAND);
+	t.setProperty("hand_grasping_frame", HAND_FRAME);
+	t.setProperty("ik_frame", HAND_FRAME);
+
+	auto sampling = std::make_shared<solvers::PipelinePlanner>();
+	sampling->setProperty("goal_joint_tolerance", 1e-5);
+	auto cartesian = std::make_shared<solvers::CartesianPath>();
+	cartesian->setStepSize(.01);
+
+	auto initial = std::make_unique<stages::FixedState>("initial state");
+	initial->setState(createScene(robot_model, s.objects));
+	Stage* previous = initial.get();
+	t.add(std::move(initial));
+
+	for (unsigned int k = 0; k < s.subtasks; ++k) {
+		const std::string object = objectName(k);
+		auto to_pick = std::make_unique<stages::Connect>("move to pick " + object,
+		                                                 stages::Connect::GroupPlannerVector{ { ARM, sampling } });
+		to_pick->setTimeout(5.0);
+		to_pick->properties().configureInitFrom(Stage::PARENT);
+		t.add(std::move(to_pick));
+
+		auto pick = createPick(t, object, s.grasps, previous, sampling, cartesian);
+		Stage* pick_ptr = pick.get();
+		t.add(std::move(pick));
+
+		auto to_place = std::make_unique<stages::Connect>("move to place " + object,
+		                                                  stages::Connect::GroupPlannerVector{ { ARM, sampling } });
+		to_place->setTimeout(5.0);
+		to_place->properties().configureInitFrom(Stage::PARENT);
+		t.add(std::move(to_place));
+
+		auto place = createPlace(t, object, k, pick_ptr, sampling, cartesian);
+		previous = place.get();  // the next grasp is generated from states after this place
+		t.add(std::move(place));
+	}
+	return task;
+}
+
+// resident set size of the process in bytes: current and peak
+size_t currentRSS() {
+	long pages = 0;
+	std::ifstream statm("/proc/self/statm");
+	statm >> pages >> pages;  // skip total program size
+	return static_cast<size_t>(pages) * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+size_t peakRSS() {
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+}
+
+std::vector<unsigned int> listParam(const ros::NodeHandle& pnh, const std::string& name, int default_value) {
+	std::vector<int> values;
+	if (!pnh.getParam(name, values)) {
+		int value = default_value;
+		pnh.getParam(name, value);  // allow scalars too
+		values = { value };
+	}
+	std::vector<unsigned int> result;
+	for (int value : values)
+		if (value > 0)
+			result.push_back(static_cast<unsigned int>(value));
+	return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "pick_place_benchmark");
+	ros::NodeHandle pnh("~");
+	ros::AsyncSpinner spinner(1);
+	spinner.start();
+
+	// scaling dimensions: all combinations are benchmarked
+	const std::vector<unsigned int> objects = listParam(pnh, "objects", 4);
+	const std::vector<unsigned int> grasps = listParam(pnh, "grasps", 24);
+	const std::vector<unsigned int> subtasks = listParam(pnh, "subtasks", 1);
+	const int repetitions = pnh.param("repetitions", 3);
+	const int max_solutions = pnh.param("max_solutions", 10);
+	const double timeout = pnh.param("timeout", 60.0);
+	const std::string output = pnh.param<std::string>("output", "");
+
+	Task loader;
+	loader.loadRobotModel();
+	const moveit::core::RobotModelConstPtr robot_model = loader.getRobotModel();
+
+	std::ofstream csv;
+	if (!output.empty()) {
+		csv.open(output);
+		if (!csv)
+			throw std::runtime_error("failed to open output file: " + output);
+		csv << "objects,grasps,subtasks,run,init_time,planning_time,solutions,best_cost,rss_delta,peak_rss\n";
+	}
+
+	for (unsigned int n : objects)
+		for (unsigned int m : grasps)
+			for (unsigned int k : subtasks) {
+				if (k > n) {
+					ROS_WARN_NAMED(LOGNAME, "skipping %u subtasks with only %u objects", k, n);
+					continue;
+				}
+				for (int run = 0; run < repetitions && ros::ok(); ++run) {
+					const size_t rss_before = currentRSS();
+					auto start = std::chrono::steady_clock::now();
+					std::unique_ptr<Task> task = createTask(robot_model, Scenario{ n, m, k });
+					task->setTimeout(timeout);
+					try {
+						task->init();
+					} catch (const InitStageException& e) {
+						ROS_ERROR_STREAM_NAMED(LOGNAME, "initialization failed: " << e);
+						return 1;
+					}
+					auto planning = std::chrono::steady_clock::now();
+					task->plan(max_solutions);
+					auto end = std::chrono::steady_clock::now();
+
+					const double init_time = std::chrono::duration<double>(planning - start).count();
+					const double planning_time = std::chrono::duration<double>(end - planning).count();
+					const size_t solutions = task->solutions().size();
+					const double best_cost =
+					    solutions ? task->solutions().front()->cost() : std::numeric_limits<double>::infinity();
+					const size_t rss_delta = std::max(currentRSS(), rss_before) - rss_before;
+					ROS_INFO_NAMED(LOGNAME,
+					               "N=%u M=%u K=%u run %d: planning %.3fs (init %.3fs), %zu solutions (best cost %g), "
+					               "memory +%.1f MB (peak %.1f MB)",
+					               n, m, k, run, planning_time, init_time, solutions, best_cost, rss_delta / 1e6,
+					               peakRSS() / 1e6);
+					if (csv)
+						csv << n << ',' << m << ',' << k << ',' << run << ',' << init_time << ',' << planning_time
+						    << ',' << solutions << ',' << best_cost << ',' << rss_delta << ',' << peakRSS() << '\n'
+						    << std::flush;
+				}
+			}
+	return 0;
+}
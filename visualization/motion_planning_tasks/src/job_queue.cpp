@@ -37,18 +37,29 @@
 #include "job_queue.h"
 #include <ros/console.h>
 
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 namespace moveit {
 namespace tools {
 
 JobQueue::JobQueue(QObject* parent) : QObject(parent) {}
 
+JobQueue::~JobQueue() {
+	stopWorker();
+}
+
 void JobQueue::addJob(const std::function<void()>& job) {
 	boost::unique_lock<boost::mutex> ulock(jobs_mutex_);
 	jobs_.push_back(job);
+	job_condition_.notify_one();
 }
 
 void JobQueue::clear() {
+	boost::unique_lock<boost::mutex> ulock(jobs_mutex_);
 	jobs_.clear();
+	idle_condition_.notify_all();
 }
 
 size_t JobQueue::numPending() {
@@ -77,5 +88,151 @@ void JobQueue::executeJobs() {
 	}
 	idle_condition_.notify_all();
 }
+
+void JobQueue::startWorker() {
+	if (worker_.joinable())
+		return;
+	stop_worker_ = false;
+	worker_ = boost::thread(&JobQueue::work, this);
+}
+
+void JobQueue::stopWorker() {
+	if (!worker_.joinable())
+		return;
+	{
+		boost::unique_lock<boost::mutex> ulock(jobs_mutex_);
+		stop_worker_ = true;
+		jobs_.clear();
+		job_condition_.notify_all();
+	}
+	worker_.join();
+	idle_condition_.notify_all();
+}
+
+void JobQueue::work() {
+	boost::unique_lock<boost::mutex> ulock(jobs_mutex_);
+	while (true) {
+		while (!stop_worker_ && jobs_.empty())
+			job_condition_.wait(ulock);
+		if (stop_worker_)
+			return;
+
+		ulock.unlock();
+		executeJobs();
+		ulock.lock();
+	}
+}
+
+namespace {
+size_t nextPowerOfTwo(size_t n) {
+	size_t result = 1;
+	while (result < n)
+		result <<= 1;
+	return result;
+}
+}  // namespace
+
+SpscJobQueue::SpscJobQueue(size_t capacity) : ring_(nextPowerOfTwo(capacity)), mask_(ring_.size() - 1) {}
+
+SpscJobQueue::~SpscJobQueue() {
+	clear();
+	for (const auto& slot : slots_)
+		delete slot.second->job.load();
+}
+
+bool SpscJobQueue::push(Job&& job, Slot* slot) {
+	const size_t tail = tail_.load(std::memory_order_relaxed);
+	if (tail - head_.load(std::memory_order_acquire) >= ring_.size())
+		return false;  // full
+
+	Entry& entry = ring_[tail & mask_];
+	entry.job = std::move(job);
+	entry.slot = slot;
+	tail_.store(tail + 1, std::memory_order_release);
+	return true;
+}
+
+bool SpscJobQueue::tryAddJob(Job job) {
+	return push(std::move(job), nullptr);
+}
+
+bool SpscJobQueue::pushWaiting(Job&& job, Slot* slot) {
+	const std::chrono::microseconds max_sleep(1000);
+	std::chrono::microseconds sleep(1);
+	for (unsigned int attempt = 0; !push(std::move(job), slot); ++attempt) {  // push() moves only on success
+		if (closed_.load(std::memory_order_acquire))
+			return false;
+		if (attempt < 16)  // the consumer is likely busy executing jobs: retry soon
+			std::this_thread::yield();
+		else {
+			std::this_thread::sleep_for(sleep);
+			sleep = std::min(2 * sleep, max_sleep);
+		}
+	}
+	return true;
+}
+
+bool SpscJobQueue::addJob(Job job) {
+	if (closed_.load(std::memory_order_acquire))
+		return false;
+	return pushWaiting(std::move(job), nullptr);
+}
+
+bool SpscJobQueue::addJob(const void* key, Job job) {
+	if (closed_.load(std::memory_order_acquire))
+		return false;
+	std::unique_ptr<Slot>& slot = slots_[key];
+	if (!slot)
+		slot.reset(new Slot);
+
+	// if the previous job is still pending, the consumer will pick up the new one instead
+	if (Job* previous = slot->job.exchange(new Job(std::move(job)), std::memory_order_acq_rel)) {
+		delete previous;
+		return true;
+	}
+	if (pushWaiting(Job(), slot.get()))
+		return true;
+	// no entry refers to the slot: the consumer doesn't access it
+	delete slot->job.exchange(nullptr, std::memory_order_acq_rel);
+	return false;
+}
+
+void SpscJobQueue::consume(bool execute) {
+	size_t head = head_.load(std::memory_order_relaxed);
+	const size_t tail = tail_.load(std::memory_order_acquire);
+	for (; head != tail; ++head) {
+		Entry& entry = ring_[head & mask_];
+		Job job = std::move(entry.job);
+		Slot* slot = entry.slot;
+		entry.job = nullptr;
+		entry.slot = nullptr;
+		head_.store(head + 1, std::memory_order_release);  // free the entry for the producer
+
+		if (slot) {
+			std::unique_ptr<Job> latest(slot->job.exchange(nullptr, std::memory_order_acq_rel));
+			if (latest)
+				job = std::move(*latest);
+		}
+		if (!execute || !job)
+			continue;
+		try {
+			job();
+		} catch (std::exception& ex) {
+			ROS_ERROR("Exception caught executing main loop job: %s", ex.what());
+		}
+	}
+}
+
+void SpscJobQueue::executeJobs() {
+	consume(true);
+}
+
+void SpscJobQueue::clear() {
+	consume(false);
+}
+
+size_t SpscJobQueue::numPending() const {
+	return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+}
 }  // namespace tools
 }  // namespace moveit
@@ -38,30 +38,110 @@
 #include <QObject>
 
 #include <QObject>
+#include <atomic>
 #include <deque>
 #include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition_variable.hpp>
+#include <boost/thread/thread.hpp>
 
 namespace moveit {
 namespace tools {
 
-/** Job Queue (of std::functions) */
+/** Job Queue (of std::functions)
+ *
+ * Jobs are either executed by explicitly calling executeJobs(), e.g. from Qt's main loop,
+ * or by a background thread started with startWorker().
+ */
 class JobQueue : public QObject
 {
 	Q_OBJECT
 	boost::mutex jobs_mutex_;
 	std::deque<std::function<void()> > jobs_;
 	boost::condition_variable idle_condition_;
+	boost::condition_variable job_condition_;  // signals new jobs to the worker thread
+	boost::thread worker_;
+	bool stop_worker_ = false;
+
+	void work();
 
 public:
 	explicit JobQueue(QObject* parent = nullptr);
+	~JobQueue() override;
 	void addJob(const std::function<void()>& job);
 	void clear();
 	size_t numPending();
 
 	void waitForAllJobs();
 	void executeJobs();
+
+	/// execute jobs in a background thread as soon as they are added
+	void startWorker();
+	/// stop the background thread after its current job, discarding pending jobs
+	void stopWorker();
+};
+
+/** Lock-free job queue for a single producer thread and a single consumer thread
+ *
+ * Jobs added with a key coalesce: while a job of the same key is pending, adding another one replaces it.
+ * Thus, only the latest of e.g. repeated refreshes of the same item is executed (at the position of the first).
+ * Keys are remembered for the lifetime of the queue and should denote a bounded set of items.
+ */
+class SpscJobQueue
+{
+public:
+	using Job = std::function<void()>;
+
+	/// capacity is rounded up to the next power of two
+	explicit SpscJobQueue(size_t capacity = 1024);
+	~SpscJobQueue();
+
+	/** producer: add a job, waiting while the queue is full
+	 *
+	 * Waiting backs off from yielding to sleeping (up to 1ms) between attempts.
+	 * Returns false (dropping the job) if the queue is or gets closed meanwhile.
+	 */
+	bool addJob(Job job);
+	/// producer: add a job replacing a pending one of the same key, waiting as addJob()
+	bool addJob(const void* key, Job job);
+	/// producer: add a job if there is space left
+	bool tryAddJob(Job job);
+
+	/// consumer: execute all jobs added so far (jobs must not add jobs themselves)
+	void executeJobs();
+	/// consumer: discard all pending jobs
+	void clear();
+	size_t numPending() const;
+
+	/// reject further jobs, releasing a producer waiting for space, e.g. before the consumer stops
+	void close() { closed_.store(true, std::memory_order_release); }
+	/// accept jobs again
+	void open() { closed_.store(false, std::memory_order_release); }
+
+private:
+	struct Slot
+	{
+		std::atomic<Job*> job{ nullptr };  // latest job of this key, owned by whoever exchanges it
+	};
+	struct Entry
+	{
+		Job job;
+		Slot* slot = nullptr;  // set for keyed jobs, which are stored in the slot instead
+	};
+	std::vector<Entry> ring_;
+	const size_t mask_;
+	alignas(64) std::atomic<size_t> head_{ 0 };  // next entry to consume
+	alignas(64) std::atomic<size_t> tail_{ 0 };  // next entry to produce
+	std::unordered_map<const void*, std::unique_ptr<Slot>> slots_;  // only accessed by the producer
+	std::atomic<bool> closed_{ false };
+
+	bool push(Job&& job, Slot* slot);
+	// push, waiting with backoff while the queue is full, unless it is closed
+	bool pushWaiting(Job&& job, Slot* slot);
+	void consume(bool execute);
 };
 }  // namespace tools
 }  // namespace moveit
@@ -46,6 +46,11 @@
 #include <rviz/properties/string_property.h>
 #include <ros/console.h>
 
+#include <algorithm>
+#include <map>
+#include <set>
+#include <unordered_map>
+
 #include <QApplication>
 #include <QPalette>
 #include <qglobal.h>
@@ -69,13 +74,11 @@ struct RemoteTaskModel::Node
 	InterfaceFlags interface_flags_;
 	NodeFlags node_flags_;
 	std::unique_ptr<RemoteSolutionModel> solutions_;
-	std::unique_ptr<rviz::PropertyTreeModel> property_tree_;
+	std::unique_ptr<rviz::PropertyTreeModel> property_tree_;  // created on first request
+	std::vector<moveit_task_constructor_msgs::Property> pending_properties_;  // not yet applied to missing tree
 	std::map<std::string, Property> properties_;
 
-	inline Node(Node* parent) : parent_(parent) {
-		solutions_.reset(new RemoteSolutionModel());
-		property_tree_.reset(new rviz::PropertyTreeModel(new rviz::Property()));
-	}
+	inline Node(Node* parent) : parent_(parent) { solutions_.reset(new RemoteSolutionModel()); }
 
 	bool setName(const QString& name) {
 		if (name == name_)
@@ -84,8 +87,14 @@ struct RemoteTaskModel::Node
 		return true;
 	}
 
+	/// update the property tree, if created already, or defer the update until its first request
 	void setProperties(const std::vector<moveit_task_constructor_msgs::Property>& props,
 	                   const planning_scene::PlanningSceneConstPtr& scene_, rviz::DisplayContext* display_context_);
+	/// the property tree, created from the latest properties on demand
+	rviz::PropertyTreeModel* propertyTree(const planning_scene::PlanningSceneConstPtr& scene_,
+	                                      rviz::DisplayContext* display_context_);
+	void updateProperties(const std::vector<moveit_task_constructor_msgs::Property>& props,
+	                      const planning_scene::PlanningSceneConstPtr& scene_, rviz::DisplayContext* display_context_);
 	rviz::Property* createProperty(const moveit_task_constructor_msgs::Property& prop, rviz::Property* old,
 	                               const planning_scene::PlanningSceneConstPtr& scene_,
 	                               rviz::DisplayContext* display_context_);
@@ -94,6 +103,26 @@ struct RemoteTaskModel::Node
 void RemoteTaskModel::Node::setProperties(const std::vector<moveit_task_constructor_msgs::Property>& props,
                                           const planning_scene::PlanningSceneConstPtr& scene_,
                                           rviz::DisplayContext* display_context_) {
+	// most properties are never inspected: avoid creating (and parsing) them until the tree is requested
+	if (!property_tree_)
+		pending_properties_ = props;
+	else
+		updateProperties(props, scene_, display_context_);
+}
+
+rviz::PropertyTreeModel* RemoteTaskModel::Node::propertyTree(const planning_scene::PlanningSceneConstPtr& scene_,
+                                                             rviz::DisplayContext* display_context_) {
+	if (!property_tree_) {
+		property_tree_.reset(new rviz::PropertyTreeModel(new rviz::Property()));
+		updateProperties(pending_properties_, scene_, display_context_);
+		pending_properties_.clear();
+	}
+	return property_tree_.get();
+}
+
+void RemoteTaskModel::Node::updateProperties(const std::vector<moveit_task_constructor_msgs::Property>& props,
+                                             const planning_scene::PlanningSceneConstPtr& scene_,
+                                             rviz::DisplayContext* display_context_) {
 	// insert properties in same order as reported in description
 	rviz::Property* root = property_tree_->getRoot();
 	int index = 0;  // current child index in root
@@ -183,7 +212,7 @@ QModelIndex RemoteTaskModel::index(const Node* n) const {
 RemoteTaskModel::RemoteTaskModel(ros::NodeHandle& nh, const std::string& service_name,
                                  const planning_scene::PlanningSceneConstPtr& scene,
                                  rviz::DisplayContext* display_context, QObject* parent)
-  : BaseTaskModel(scene, display_context, parent), root_(new Node(nullptr)) {
+  : BaseTaskModel(scene, display_context, parent), root_(new Node(nullptr)), scene_cache_(new SceneCache) {
 	id_to_stage_[0] = root_;  // root node has ID 0
 	// service to request solutions
 	get_solution_client_ = nh.serviceClient<moveit_task_constructor_msgs::GetSolution>(service_name);
@@ -336,7 +365,22 @@ void RemoteTaskModel::processStageDescriptions(const moveit_task_constructor_msg
 	}
 }
 
-void RemoteTaskModel::processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg) {
+void RemoteTaskModel::processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg,
+                                             bool incremental) {
+	std::set<const Node*> changed;
+	updateStageStatistics(msg, incremental, changed);
+	notifyStageStatistics(changed);
+}
+
+void RemoteTaskModel::processStageStatistics(const std::vector<moveit_task_constructor_msgs::TaskStatistics>& msgs) {
+	std::set<const Node*> changed;
+	for (const auto& msg : msgs)
+		updateStageStatistics(msg.stages, msg.incremental, changed);
+	notifyStageStatistics(changed);
+}
+
+void RemoteTaskModel::updateStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg,
+                                            bool incremental, std::set<const Node*>& changed) {
 	// iterate over statistics and update node's solutions where needed
 	for (const auto& s : msg) {
 		// find node for stage s, this should always exist
@@ -346,14 +390,32 @@ void RemoteTaskModel::processStageStatistics(const moveit_task_constructor_msgs:
 			continue;
 		}
 		Node* n = it->second;
-		n->solutions_->processSolutionIDs(s.solved, s.failed, s.num_failed, s.total_compute_time);
+		if (incremental)
+			n->solutions_->processIncrementalSolutionIDs(s.solved, s.solved_indices, s.failed, s.num_failed,
+			                                             s.total_compute_time);
+		else
+			n->solutions_->processSolutionIDs(s.solved, s.failed, s.num_failed, s.total_compute_time);
+
+		// notify about model changes when node was already visited
+		if (n->node_flags_ & WAS_VISITED)
+			changed.insert(n);
+	}
+}
 
-		// emit notify about model changes when node was already visited
-		if (n->node_flags_ & WAS_VISITED) {
-			QModelIndex idx = index(n);
-			dataChanged(idx.sibling(idx.row(), 1), idx.sibling(idx.row(), 3));
-		}
+void RemoteTaskModel::notifyStageStatistics(const std::set<const Node*>& changed) {
+	// dataChanged() ranges need to share their parent: collect the range of rows per parent
+	std::map<Node*, std::pair<int, int>> ranges;
+	for (const Node* n : changed) {
+		QModelIndex idx = index(n);
+		if (!idx.isValid())
+			continue;
+		auto inserted = ranges.insert(std::make_pair(n->parent_, std::make_pair(idx.row(), idx.row())));
+		auto& range = inserted.first->second;
+		range.first = std::min(range.first, idx.row());
+		range.second = std::max(range.second, idx.row());
 	}
+	for (const auto& pair : ranges)
+		dataChanged(createIndex(pair.second.first, 1, pair.first), createIndex(pair.second.second, 3, pair.first));
 }
 
 void RemoteTaskModel::setSolutionData(const moveit_task_constructor_msgs::SolutionInfo& info) {
@@ -363,37 +425,72 @@ void RemoteTaskModel::setSolutionData(const moveit_task_constructor_msgs::Soluti
 		m->setSolutionData(info.id, info.cost, QString::fromStdString(info.comment));
 }
 
-DisplaySolutionPtr RemoteTaskModel::processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg) {
-	DisplaySolutionPtr s(new DisplaySolution);
-	s->setFromMessage(scene_->diff(), msg);
+DisplaySolutionPtr RemoteTaskModel::cachedSolution(uint32_t id) {
+	auto it = id_to_solution_.find(id);
+	if (it == id_to_solution_.end())
+		return DisplaySolutionPtr();
+	solution_lru_.splice(solution_lru_.begin(), solution_lru_, it->second.second);
+	return it->second.first;
+}
+
+void RemoteTaskModel::cacheSolution(uint32_t id, const DisplaySolutionPtr& s) {
+	auto it_inserted = id_to_solution_.insert(std::make_pair(id, std::make_pair(s, solution_lru_.end())));
+	if (!it_inserted.second)
+		return;  // already known
+	it_inserted.first->second.second = solution_lru_.insert(solution_lru_.begin(), id);
+	evictSolutions();
+}
+
+void RemoteTaskModel::evictSolutions() {
+	if (solution_cache_size_ == 0)
+		return;
+	while (id_to_solution_.size() > solution_cache_size_) {
+		id_to_solution_.erase(solution_lru_.back());
+		solution_lru_.pop_back();
+	}
+}
+
+void RemoteTaskModel::setSolutionCacheSize(size_t size) {
+	solution_cache_size_ = size;
+	evictSolutions();
+}
 
+void RemoteTaskModel::processSolutionInfo(const moveit_task_constructor_msgs::Solution& msg) {
 	// store sub solution data in model
 	for (const auto& sub : msg.sub_solution)
 		setSolutionData(sub.info);
 	for (const auto& sub : msg.sub_trajectory)
 		setSolutionData(sub.info);
+}
+
+DisplaySolutionPtr RemoteTaskModel::processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg) {
+	DisplaySolutionPtr s(new DisplaySolution);
+	s->setFromMessage(solutionStartScene(), msg, scene_cache_.get());
+	processSolutionMessage(msg, s);
+	return s;
+}
+
+void RemoteTaskModel::processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg,
+                                             const DisplaySolutionPtr& s) {
+	processSolutionInfo(msg);
 
 	// caching is only enabled for top-level solutions (stage_id == 1)
 	// otherwise we would store PlanningScenes over and over
 	if (!msg.sub_solution.empty() && msg.sub_solution.front().info.stage_id == 1 &&
 	    msg.sub_solution.front().info.id != 0) {
 		// cache solution for future use
-		id_to_solution_[msg.sub_solution.front().info.id] = s;
+		cacheSolution(msg.sub_solution.front().info.id, s);
 
 		// cache DisplaySolutions for all individual sub trajectories
 		uint i = 0;
 		for (const auto& t : msg.sub_trajectory) {
 			if (t.info.id == 0)
 				continue;  // invalid id
-			DisplaySolutionPtr& sub =
-			    id_to_solution_.insert(std::make_pair(t.info.id, DisplaySolutionPtr())).first->second;
-			if (!sub)
-				sub.reset(new DisplaySolution(*s, i));
+			if (!cachedSolution(t.info.id))
+				cacheSolution(t.info.id, DisplaySolutionPtr(new DisplaySolution(*s, i)));
 			i++;
 		}
 	}
-
-	return s;
 }
 
 RemoteSolutionModel* RemoteTaskModel::getSolutionModel(uint32_t stage_id) const {
@@ -412,8 +509,8 @@ DisplaySolutionPtr RemoteTaskModel::getSolution(const QModelIndex& index) {
 	Q_ASSERT(index.isValid());
 
 	uint32_t id = index.sibling(index.row(), 0).data(Qt::UserRole).toUInt();
-	auto it = id_to_solution_.find(id);
-	if (it == id_to_solution_.cend()) {
+	DisplaySolutionPtr cached = cachedSolution(id);
+	if (!cached) {
 		// TODO: try to assemble (and cache) the solution from known leaves
 		// to avoid some communication overhead
 
@@ -423,7 +520,8 @@ DisplaySolutionPtr RemoteTaskModel::getSolution(const QModelIndex& index) {
 			moveit_task_constructor_msgs::GetSolution srv;
 			srv.request.solution_id = id;
 			if (get_solution_client_.call(srv)) {
-				id_to_solution_[id] = result = processSolutionMessage(srv.response.solution);
+				result = processSolutionMessage(srv.response.solution);
+				cacheSolution(id, result);
 				return result;
 			}
 			// on failure mark remote task as destroyed: don't retrieve more solutions
@@ -432,14 +530,14 @@ DisplaySolutionPtr RemoteTaskModel::getSolution(const QModelIndex& index) {
 		}
 		return result;
 	}
-	return it->second;
+	return cached;
 }
 
 rviz::PropertyTreeModel* RemoteTaskModel::getPropertyModel(const QModelIndex& index) {
 	Node* n = node(index);
 	if (!n)
 		return nullptr;
-	return n->property_tree_.get();
+	return n->propertyTree(scene_, display_context_);
 }
 
 namespace detail {
@@ -557,7 +655,7 @@ void RemoteSolutionModel::setSolutionData(uint32_t id, float cost, const QString
 		Q_EMIT dataChanged(tl, br);
 
 	if (row < 0 && isVisible(*it))  // item was newly created: inform views
-		sortInternal();
+		updateInternal();
 }
 
 void RemoteSolutionModel::sort(int column, Qt::SortOrder order) {
@@ -570,6 +668,55 @@ void RemoteSolutionModel::sort(int column, Qt::SortOrder order) {
 	sortInternal();
 }
 
+bool RemoteSolutionModel::lessThan(const Data& left, const Data& right) const {
+	if (sort_column_ < 0)  // unsorted: order of creation
+		return left.id < right.id;
+
+	int comp = 0;
+	switch (sort_column_) {
+		case 1:  // cost order
+			if (left.cost_rank < right.cost_rank)
+				comp = -1;
+			else if (left.cost_rank > right.cost_rank)
+				comp = 1;
+			break;
+		case 2:  // comment
+			comp = left.comment.compare(right.comment);
+			break;
+	}
+	if (comp == 0)  // if still undecided, id decides
+		comp = (left.id < right.id ? -1 : (left.id > right.id ? 1 : 0));
+	return (sort_order_ == Qt::AscendingOrder) ? (comp < 0) : (comp > 0);
+}
+
+void RemoteSolutionModel::updateInternal() {
+	auto less = [this](const DataList::iterator& left, const DataList::iterator& right) {
+		return lessThan(*left, *right);
+	};
+	// New solutions usually don't change the relative order of existing rows (only their ranks shift).
+	// Otherwise, or if rows became invisible, fall back to a full resort.
+	if (std::any_of(sorted_.begin(), sorted_.end(), [this](const DataList::iterator& it) { return !isVisible(*it); }) ||
+	    !std::is_sorted(sorted_.begin(), sorted_.end(), less)) {
+		sortInternal();
+		return;
+	}
+
+	if (!sorted_.empty())  // creation ranks of existing rows might have shifted
+		Q_EMIT dataChanged(index(0, 0), index(sorted_.size() - 1, 0));
+
+	// insert new rows at binary-searched positions
+	for (auto it = data_.begin(), end = data_.end(); it != end; ++it) {
+		if (it->listed || !isVisible(*it))
+			continue;
+		auto pos = std::upper_bound(sorted_.begin(), sorted_.end(), it, less);
+		int row = pos - sorted_.begin();
+		beginInsertRows(QModelIndex(), row, row);
+		sorted_.insert(pos, it);
+		it->listed = true;
+		endInsertRows();
+	}
+}
+
 void RemoteSolutionModel::sortInternal() {
 	Q_EMIT layoutAboutToBeChanged();
 	QModelIndexList old_indexes = persistentIndexList();
@@ -577,28 +724,16 @@ void RemoteSolutionModel::sortInternal() {
 	std::swap(sorted_, old_sorted);
 
 	// create new order in sorted_
-	for (auto it = data_.begin(), end = data_.end(); it != end; ++it)
-		if (isVisible(*it))
+	for (auto it = data_.begin(), end = data_.end(); it != end; ++it) {
+		it->listed = isVisible(*it);
+		if (it->listed)
 			sorted_.push_back(it);
+	}
 
 	if (sort_column_ >= 0) {
 		std::sort(sorted_.begin(), sorted_.end(),
 		          [this](const DataList::iterator& left, const DataList::iterator& right) {
-			          int comp = 0;
-			          switch (sort_column_) {
-				          case 1:  // cost order
-					          if (left->cost_rank < right->cost_rank)
-						          comp = -1;
-					          else if (left->cost_rank > right->cost_rank)
-						          comp = 1;
-					          break;
-				          case 2:  // comment
-					          comp = left->comment.compare(right->comment);
-					          break;
-			          }
-			          if (comp == 0)  // if still undecided, id decides
-				          comp = (left->id < right->id ? -1 : 1);
-			          return (sort_order_ == Qt::AscendingOrder) ? (comp < 0) : (comp >= 0);
+			          return lessThan(*left, *right);
 		          });
 	}
 
@@ -627,7 +762,43 @@ void RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& succes
 	// append new items to the end of data_
 	processSolutionIDs(successful, true);
 	processSolutionIDs(failed, false);
+	cost_order_ = successful;
+
+	num_failed_data_ = failed.size();  // needed to compute number of successes
+	updateRanks(num_failed, total_compute_time);
+}
+
+// process solution ids received in incremental stage statistics
+void RemoteSolutionModel::processIncrementalSolutionIDs(const std::vector<uint32_t>& successful,
+                                                        const std::vector<uint32_t>& successful_indices,
+                                                        const std::vector<uint32_t>& failed, size_t num_failed,
+                                                        double total_compute_time) {
+	// Interface axiom: indices are increasing, such that inserting in order yields the final cost order
+	for (size_t i = 0; i < successful.size(); ++i) {
+		size_t size = data_.size();
+		detail::insert(data_, Data(successful[i], std::numeric_limits<double>::quiet_NaN(), 0));
+		if (data_.size() == size)
+			continue;  // already known
+		size_t index = i < successful_indices.size() ? successful_indices[i] : cost_order_.size();
+		cost_order_.insert(cost_order_.begin() + std::min(index, cost_order_.size()), successful[i]);
+	}
+	// all cost ranks behind inserted items have changed
+	std::unordered_map<uint32_t, uint32_t> cost_ranks;
+	for (size_t i = 0; i < cost_order_.size(); ++i)
+		cost_ranks[cost_order_[i]] = i + 1;
+	for (auto& item : data_) {
+		auto it = cost_ranks.find(item.id);
+		if (it != cost_ranks.end())
+			item.cost_rank = it->second;
+	}
+
+	size_t size = data_.size();
+	processSolutionIDs(failed, false);
+	num_failed_data_ += data_.size() - size;
+	updateRanks(num_failed, total_compute_time);
+}
 
+void RemoteSolutionModel::updateRanks(size_t num_failed, double total_compute_time) {
 	// assign consecutive creation ranks
 	uint32_t rank = 0;
 	for (auto& item : data_)
@@ -635,11 +806,10 @@ void RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& succes
 
 	// the task may not report failure ids (in failed),
 	// but it may report the overall number of failures
-	num_failed_data_ = failed.size();  // needed to compute number of successes
 	num_failed_ = std::max(num_failed, num_failed_data_);
 	total_compute_time_ = total_compute_time;
 
-	sortInternal();
+	updateInternal();
 }
 
 void RemoteSolutionModel::processSolutionIDs(const std::vector<uint32_t>& ids, bool successful) {
@@ -41,6 +41,8 @@
 #include <ros/service_client.h>
 #include <memory>
 #include <limits>
+#include <list>
+#include <set>
 
 namespace moveit_rviz_plugin {
 
@@ -57,7 +59,13 @@ class RemoteTaskModel : public BaseTaskModel
 	ros::ServiceClient get_solution_client_;
 
 	std::map<uint32_t, Node*> id_to_stage_;
-	std::map<uint32_t, DisplaySolutionPtr> id_to_solution_;
+
+	// LRU cache of converted solutions: ids ordered by recent use, front is most recent
+	std::list<uint32_t> solution_lru_;
+	std::map<uint32_t, std::pair<DisplaySolutionPtr, std::list<uint32_t>::iterator>> id_to_solution_;
+	size_t solution_cache_size_ = 0;  // 0: unlimited
+	// decoded scenes shared by the solutions of this task
+	SceneCachePtr scene_cache_;
 
 	inline Node* node(const QModelIndex& index) const;
 	QModelIndex index(const Node* n) const;
@@ -65,6 +73,16 @@ class RemoteTaskModel : public BaseTaskModel
 	Node* node(uint32_t stage_id) const;
 	inline RemoteSolutionModel* getSolutionModel(uint32_t stage_id) const;
 	void setSolutionData(const moveit_task_constructor_msgs::SolutionInfo& info);
+	/// update solutions of stages from statistics, collecting the updated nodes
+	void updateStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg, bool incremental,
+	                           std::set<const Node*>& changed);
+	/// emit dataChanged() for the statistics columns of the given nodes
+	void notifyStageStatistics(const std::set<const Node*>& changed);
+	/// lookup solution in cache, marking it as recently used
+	DisplaySolutionPtr cachedSolution(uint32_t id);
+	/// insert solution into cache (if not yet known), evicting least recently used ones
+	void cacheSolution(uint32_t id, const DisplaySolutionPtr& s);
+	void evictSolutions();
 
 public:
 	RemoteTaskModel(ros::NodeHandle& nh, const std::string& service_name,
@@ -82,8 +100,22 @@ public:
 
 	QModelIndex indexFromStageId(size_t id) const override;
 	void processStageDescriptions(const moveit_task_constructor_msgs::TaskDescription::_stages_type& msg);
-	void processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg);
+	void processStageStatistics(const moveit_task_constructor_msgs::TaskStatistics::_stages_type& msg,
+	                            bool incremental = false);
+	/// process a sequence of statistics messages, notifying views only once per range of sibling stages
+	void processStageStatistics(const std::vector<moveit_task_constructor_msgs::TaskStatistics>& msgs);
 	DisplaySolutionPtr processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg);
+	/// process a solution message, which was already decoded into s, e.g. in a background thread
+	void processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg, const DisplaySolutionPtr& s);
+	/// new start scene to decode a solution message into (the shared scene itself is never modified)
+	planning_scene::PlanningScenePtr solutionStartScene() const { return scene_->diff(); }
+	/// cache to decode solution messages with
+	const SceneCachePtr& sceneCache() const { return scene_cache_; }
+	/// only store costs and comments of the solution, trajectories are fetched on demand by getSolution()
+	void processSolutionInfo(const moveit_task_constructor_msgs::Solution& msg);
+
+	/// limit number of cached DisplaySolutions (0: unlimited)
+	void setSolutionCacheSize(size_t size);
 
 	QAbstractItemModel* getSolutionModel(const QModelIndex& index) override;
 	DisplaySolutionPtr getSolution(const QModelIndex& index) override;
@@ -102,15 +134,17 @@ class RemoteSolutionModel : public QAbstractTableModel
 		QString comment;
 		uint32_t creation_rank;  // rank, ordered by creation
 		uint32_t cost_rank;  // rank, ordering by cost
+		bool listed;  // contained in sorted_
 
 		Data(uint32_t id, float cost, uint32_t cost_rank, const QString& name = QString())
-		  : id(id), cost(cost), comment(name), creation_rank(0), cost_rank(cost_rank) {}
+		  : id(id), cost(cost), comment(name), creation_rank(0), cost_rank(cost_rank), listed(false) {}
 
 		inline bool operator<(const Data& other) const { return this->id < other.id; }
 	};
 	// successful and failed solutions ordered by id / creation
 	using DataList = std::list<Data>;
 	DataList data_;
+	std::vector<uint32_t> cost_order_;  // ids of successful solutions ordered by cost
 	size_t num_failed_data_ = 0;  // number of failed solutions in data_
 	size_t num_failed_ = 0;  // number of reported failures
 	double total_compute_time_ = 0.0;
@@ -122,7 +156,12 @@ class RemoteSolutionModel : public QAbstractTableModel
 	std::vector<DataList::iterator> sorted_;
 
 	inline bool isVisible(const Data& item) const;
+	/// order of rows according to sort_column_ and sort_order_
+	bool lessThan(const Data& left, const Data& right) const;
 	void processSolutionIDs(const std::vector<uint32_t>& ids, bool successful);
+	void updateRanks(size_t num_failed, double total_compute_time);
+	/// insert new visible items at their sorted positions, resorting only if the order of existing rows changed
+	void updateInternal();
 	void sortInternal();
 
 public:
@@ -141,5 +180,10 @@ public:
 	void setSolutionData(uint32_t id, float cost, const QString& comment);
 	void processSolutionIDs(const std::vector<uint32_t>& successful, const std::vector<uint32_t>& failed,
 	                        size_t num_failed, double total_compute_time);
+	/// process solution ids added since the last update, successful ones inserted at the given cost positions
+	void processIncrementalSolutionIDs(const std::vector<uint32_t>& successful,
+	                                   const std::vector<uint32_t>& successful_indices,
+	                                   const std::vector<uint32_t>& failed, size_t num_failed,
+	                                   double total_compute_time);
 };
 }  // namespace moveit_rviz_plugin
@@ -41,6 +41,7 @@
 #include "task_list_model.h"
 #include "meta_task_list_model.h"
 #include <moveit/task_constructor/introspection.h>
+#include <moveit/task_constructor/solution_store.h>
 #include <moveit/visualization_tools/task_solution_visualization.h>
 #include <moveit/visualization_tools/marker_visualization.h>
 #include <moveit/visualization_tools/display_solution.h>
@@ -50,6 +51,8 @@
 #include <moveit/robot_model/robot_model.h>
 
 #include <rviz/display_context.h>
+#include <rviz/properties/bool_property.h>
+#include <rviz/properties/int_property.h>
 #include <rviz/properties/string_property.h>
 #include <rviz/properties/ros_topic_property.h>
 #include <rviz/properties/status_property.h>
@@ -80,14 +83,41 @@ TaskDisplay::TaskDisplay() : Display(), panel_requested_(false), received_task_d
 	    "The topic on which task solutions (moveit_msgs::Solution messages) are received", this,
 	    SLOT(changedTaskSolutionTopic()), this);
 
+	lazy_solutions_property_ =
+	    new rviz::BoolProperty("Lazy Solution Fetching", false,
+	                           "Only store costs and comments of published solutions. "
+	                           "Trajectories are requested from the task when a solution is selected.",
+	                           this);
+	solution_cache_size_property_ =
+	    new rviz::IntProperty("Solution Cache Size", 1000,
+	                          "Max number of (sub) solutions kept in memory per task, "
+	                          "least recently used ones are requested again if needed (0: unlimited)",
+	                          this, SLOT(changedSolutionCacheSize()), this);
+	solution_cache_size_property_->setMin(0);
+
+	solution_store_property_ =
+	    new rviz::StringProperty("Solution Store", "",
+	                             "File of solutions archived by Task::saveSolutions() to browse offline", this,
+	                             SLOT(changedSolutionStore()), this);
+	stored_solution_property_ =
+	    new rviz::IntProperty("Solution", 0, "Index of the displayed stored solution, sorted by cost",
+	                          solution_store_property_, SLOT(changedStoredSolution()), this);
+	stored_solution_property_->setMin(0);
+
 	trajectory_visual_.reset(new TaskSolutionVisualization(this, this));
 	connect(trajectory_visual_.get(), SIGNAL(activeStageChanged(size_t)), task_list_model_.get(),
 	        SLOT(highlightStage(size_t)));
 
 	tasks_property_ = new rviz::Property("Tasks", QVariant(), "Tasks received on monitored topic", this);
+	changedSolutionCacheSize();
+
+	decode_jobs_.startWorker();
 }
 
 TaskDisplay::~TaskDisplay() {
+	// running decode jobs access main_loop_jobs_, which isn't consumed anymore
+	main_loop_jobs_.close();
+	decode_jobs_.stopWorker();
 	if (panel_requested_)
 		TaskPanel::release();  // Indicate that we don't need a TaskPanel anymore
 }
@@ -131,9 +161,18 @@ void TaskDisplay::loadRobotModel() {
 
 	// perform any postponed subscription to topics (after scene is well-defined)
 	changedTaskSolutionTopic();
+	changedStoredSolution();
+}
+
+void TaskDisplay::dropPendingSolutions() {
+	++decode_generation_;  // a running decode job drops its result
+	decode_jobs_.clear();
+	main_loop_jobs_.clear();
 }
 
 void TaskDisplay::reset() {
+	// drop solutions decoded w.r.t. the previous robot model
+	dropPendingSolutions();
 	Display::reset();
 	loadRobotModel();
 	trajectory_visual_->reset();
@@ -181,6 +220,8 @@ void TaskDisplay::update(float wall_dt, float ros_dt) {
 	Display::update(wall_dt, ros_dt);
 	calculateOffsetPosition();
 	trajectory_visual_->update(wall_dt, ros_dt);
+	task_list_model_->flushStatistics();  // at most once per frame
+	main_loop_jobs_.executeJobs();
 }
 
 void TaskDisplay::setName(const QString& name) {
@@ -207,6 +248,8 @@ void TaskDisplay::taskDescriptionCB(const moveit_task_constructor_msgs::TaskDesc
 		received_task_description_ = true;
 		task_statistics_sub = update_nh_.subscribe(base_ns_ + STATISTICS_TOPIC, 2, &TaskDisplay::taskStatisticsCB, this);
 		task_solution_sub = update_nh_.subscribe(base_ns_ + SOLUTION_TOPIC, 2, &TaskDisplay::taskSolutionCB, this);
+		task_compressed_solution_sub = update_nh_.subscribe(base_ns_ + COMPRESSED_SOLUTION_TOPIC, 2,
+		                                                    &TaskDisplay::taskCompressedSolutionCB, this);
 	}
 }
 
@@ -217,16 +260,122 @@ void TaskDisplay::taskStatisticsCB(const moveit_task_constructor_msgs::TaskStati
 
 void TaskDisplay::taskSolutionCB(const moveit_task_constructor_msgs::SolutionConstPtr& msg) {
 	setStatus(rviz::StatusProperty::Ok, "Task Monitor", "OK");
-	try {
-		const DisplaySolutionPtr& s = task_list_model_->processSolutionMessage(*msg);
+	if (lazy_solutions_property_->getBool()) {
+		task_list_model_->processSolutionInfo(*msg);
+		return;
+	}
+	planning_scene::PlanningScenePtr start_scene = task_list_model_->solutionStartScene(*msg);
+	if (!start_scene) {
+		setSolutionStatus(false);
+		return;
+	}
+	SceneCachePtr scene_cache = task_list_model_->solutionSceneCache(*msg);
+
+	// decode the message in the background, keeping the GUI responsive for large solutions
+	const unsigned int generation = decode_generation_;
+	decode_jobs_.addJob([this, msg, start_scene, scene_cache, generation]() {
+		if (generation != decode_generation_)
+			return;  // expired
+		DisplaySolutionPtr s(new DisplaySolution);
+		std::string error;
+		try {
+			s->setFromMessage(start_scene, *msg, scene_cache.get());
+		} catch (const std::invalid_argument& e) {
+			error = e.what();
+			s.reset();
+		}
+
+		// models and visualization are only accessed from Qt's main loop
+		main_loop_jobs_.addJob([this, msg, s, error, generation]() {
+			if (generation != decode_generation_)
+				return;  // expired while decoding
+			if (!s) {
+				ROS_ERROR_STREAM(error);
+				setSolutionStatus(false, error.c_str());
+			} else if (!task_list_model_->processSolutionMessage(*msg, s))
+				setSolutionStatus(false);
+		});
+		// of a burst of solutions, only show the latest one
 		if (s)
-			trajectory_visual_->showTrajectory(s, false);
-		else
-			setSolutionStatus(false);
-	} catch (const std::invalid_argument& e) {
-		ROS_ERROR_STREAM(e.what());
-		setSolutionStatus(false, e.what());
+			main_loop_jobs_.addJob(trajectory_visual_.get(), [this, s, generation]() {
+				if (generation == decode_generation_)
+					trajectory_visual_->showTrajectory(s, false);
+			});
+	});
+}
+
+void TaskDisplay::taskCompressedSolutionCB(const moveit_task_constructor_msgs::CompressedSolutionConstPtr& msg) {
+	// decompress in the background, then proceed as with uncompressed solutions
+	const unsigned int generation = decode_generation_;
+	decode_jobs_.addJob([this, msg, generation]() {
+		if (generation != decode_generation_)
+			return;  // expired
+		boost::shared_ptr<moveit_task_constructor_msgs::Solution> solution(new moveit_task_constructor_msgs::Solution);
+		std::string error;
+		try {
+			moveit::task_constructor::utils::decompress(*msg, *solution);
+		} catch (const std::runtime_error& e) {
+			error = e.what();
+			solution.reset();
+		}
+
+		main_loop_jobs_.addJob([this, solution, error, generation]() {
+			if (generation != decode_generation_)
+				return;  // expired while decompressing
+			if (solution)
+				taskSolutionCB(solution);
+			else {
+				ROS_ERROR_STREAM(error);
+				setSolutionStatus(false, error.c_str());
+			}
+		});
+	});
+}
+
+void TaskDisplay::changedSolutionCacheSize() {
+	task_list_model_->setSolutionCacheSize(solution_cache_size_property_->getInt());
+}
+
+void TaskDisplay::changedSolutionStore() {
+	solution_store_.reset();
+	deleteStatus("Solution Store");
+
+	const std::string& path = solution_store_property_->getStdString();
+	if (path.empty())
+		return;
+	try {
+		solution_store_.reset(new moveit::task_constructor::utils::SolutionStore(path));
+	} catch (const std::runtime_error& e) {
+		setStatus(rviz::StatusProperty::Error, "Solution Store", e.what());
+		return;
+	}
+	stored_solution_property_->setMax(std::max<int>(0, static_cast<int>(solution_store_->size()) - 1));
+	changedStoredSolution();
+}
+
+void TaskDisplay::changedStoredSolution() {
+	// postpone display until scene is well-defined
+	if (!solution_store_ || !trajectory_visual_->getScene())
+		return;
+
+	size_t index = stored_solution_property_->getInt();
+	if (index >= solution_store_->size()) {
+		setStatus(rviz::StatusProperty::Warn, "Solution Store", "No solutions stored");
+		return;
+	}
+	try {
+		moveit_task_constructor_msgs::Solution msg;
+		solution_store_->load(index, msg);
+		trajectory_visual_->showTrajectory(msg);
+	} catch (const std::exception& e) {  // corrupt record or mismatching robot model
+		setStatus(rviz::StatusProperty::Error, "Solution Store", e.what());
+		return;
 	}
+	setStatus(rviz::StatusProperty::Ok, "Solution Store",
+	          QString("Solution %1 of %2, cost %3")
+	              .arg(index + 1)
+	              .arg(solution_store_->size())
+	              .arg(solution_store_->cost(index)));
 }
 
 void TaskDisplay::changedTaskSolutionTopic() {
@@ -237,6 +386,8 @@ void TaskDisplay::changedTaskSolutionTopic() {
 	task_description_sub.shutdown();
 	task_statistics_sub.shutdown();
 	task_solution_sub.shutdown();
+	task_compressed_solution_sub.shutdown();
+	dropPendingSolutions();  // of the previous topic
 
 	received_task_description_ = false;
 
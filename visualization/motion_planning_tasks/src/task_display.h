@@ -48,9 +48,14 @@
 #include <moveit_task_constructor_msgs/TaskDescription.h>
 #include <moveit_task_constructor_msgs/TaskStatistics.h>
 #include <moveit_task_constructor_msgs/Solution.h>
+#include <moveit_task_constructor_msgs/CompressedSolution.h>
 #endif
 
+#include <atomic>
+
 namespace rviz {
+class BoolProperty;
+class IntProperty;
 class StringProperty;
 class RosTopicProperty;
 }  // namespace rviz
@@ -59,6 +64,11 @@ namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotModel);
 }
+namespace task_constructor {
+namespace utils {
+class SolutionStore;
+}
+}  // namespace task_constructor
 }  // namespace moveit
 namespace rdf_loader {
 MOVEIT_CLASS_FORWARD(RDFLoader);
@@ -102,6 +112,8 @@ protected:
 
 private:
 	inline void requestPanel();
+	/// drop solutions still being decoded, e.g. w.r.t. a previous robot model or topic
+	void dropPendingSolutions();
 
 private Q_SLOTS:
 	/**
@@ -109,6 +121,9 @@ private Q_SLOTS:
 	 */
 	void changedRobotDescription();
 	void changedTaskSolutionTopic();
+	void changedSolutionCacheSize();
+	void changedSolutionStore();
+	void changedStoredSolution();
 	void onTasksInserted(const QModelIndex& parent, int first, int last);
 	void onTasksRemoved(const QModelIndex& parent, int first, int last);
 	void onTaskDataChanged(const QModelIndex& topLeft, const QModelIndex& bottomRight);
@@ -116,9 +131,11 @@ private Q_SLOTS:
 	void taskDescriptionCB(const moveit_task_constructor_msgs::TaskDescriptionConstPtr& msg);
 	void taskStatisticsCB(const moveit_task_constructor_msgs::TaskStatisticsConstPtr& msg);
 	void taskSolutionCB(const moveit_task_constructor_msgs::SolutionConstPtr& msg);
+	void taskCompressedSolutionCB(const moveit_task_constructor_msgs::CompressedSolutionConstPtr& msg);
 
 protected:
 	ros::Subscriber task_solution_sub;
+	ros::Subscriber task_compressed_solution_sub;
 	ros::Subscriber task_description_sub;
 	ros::Subscriber task_statistics_sub;
 
@@ -132,6 +149,16 @@ protected:
 	rdf_loader::RDFLoaderPtr rdf_loader_;
 	moveit::core::RobotModelConstPtr robot_model_;
 
+	// decoding of solution messages in a background thread
+	moveit::tools::JobQueue decode_jobs_;
+	// handing decoded solutions from the decoding thread to Qt's main loop, processed in update()
+	moveit::tools::SpscJobQueue main_loop_jobs_;
+	// incremented to expire all decode jobs added before, including a running one
+	std::atomic<unsigned int> decode_generation_{ 0 };
+
+	// archived solutions browsed offline
+	std::unique_ptr<moveit::task_constructor::utils::SolutionStore> solution_store_;
+
 	// topic namespace for ROS interfaces of task
 	std::string base_ns_;
 	// Indicates whether description was received for current task
@@ -140,6 +167,10 @@ protected:
 	// Properties
 	rviz::StringProperty* robot_description_property_;
 	rviz::RosTopicProperty* task_solution_topic_property_;
+	rviz::BoolProperty* lazy_solutions_property_;
+	rviz::IntProperty* solution_cache_size_property_;
+	rviz::StringProperty* solution_store_property_;
+	rviz::IntProperty* stored_solution_property_;
 	rviz::Property* tasks_property_;
 };
 
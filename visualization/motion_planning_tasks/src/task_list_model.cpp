@@ -243,6 +243,9 @@ QVariant TaskListModel::data(const QModelIndex& index, int role) const {
 // update existing RemoteTask, create a new one, or (if msg.stages is empty) delete an existing one
 void TaskListModel::processTaskDescriptionMessage(const moveit_task_constructor_msgs::TaskDescription& msg,
                                                   ros::NodeHandle& nh, const std::string& service_name) {
+	// apply statistics received before this description
+	flushStatistics();
+
 	// retrieve existing or insert new remote task for given task id
 	auto it_inserted = remote_tasks_.insert(std::make_pair(msg.task_id, nullptr));
 	const auto& task_it = it_inserted.first;
@@ -268,6 +271,7 @@ void TaskListModel::processTaskDescriptionMessage(const moveit_task_constructor_
 	} else if (!remote_task) {  // create new task model, if ID was not known before
 		// the model is managed by this instance via Qt's parent-child mechanism
 		remote_task = new RemoteTaskModel(nh, service_name, scene_, display_context_, this);
+		remote_task->setSolutionCacheSize(solution_cache_size_);
 		remote_task->processStageDescriptions(msg.stages);
 		ROS_DEBUG_NAMED(LOGNAME, "received new task: %s (%s)", msg.stages[0].name.c_str(), msg.task_id.c_str());
 		// insert newly created model into this' model instance
@@ -291,7 +295,24 @@ void TaskListModel::processTaskStatisticsMessage(const moveit_task_constructor_m
 	if (!remote_task || (remote_task->taskFlags() & RemoteTaskModel::IS_DESTROYED))
 		return;  // task is not in use anymore
 
-	remote_task->processStageStatistics(msg.stages);
+	auto& pending = pending_statistics_[msg.task_id];
+	if (!msg.incremental)
+		pending.clear();  // full statistics supersede everything received before
+	pending.push_back(msg);
+}
+
+void TaskListModel::flushStatistics() {
+	for (const auto& pair : pending_statistics_) {
+		auto it = remote_tasks_.find(pair.first);
+		if (it == remote_tasks_.cend())
+			continue;  // task removed in the meantime
+		RemoteTaskModel* remote_task = it->second;
+		if (!remote_task || (remote_task->taskFlags() & RemoteTaskModel::IS_DESTROYED))
+			continue;  // task is not in use anymore
+
+		remote_task->processStageStatistics(pair.second);
+	}
+	pending_statistics_.clear();
 }
 
 DisplaySolutionPtr TaskListModel::processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg) {
@@ -306,6 +327,48 @@ DisplaySolutionPtr TaskListModel::processSolutionMessage(const moveit_task_const
 	return remote_task->processSolutionMessage(msg);
 }
 
+planning_scene::PlanningScenePtr
+TaskListModel::solutionStartScene(const moveit_task_constructor_msgs::Solution& msg) const {
+	auto it = remote_tasks_.find(msg.task_id);
+	if (it == remote_tasks_.cend() || !it->second)
+		return planning_scene::PlanningScenePtr();  // unknown task or task not in use anymore
+
+	return it->second->solutionStartScene();
+}
+
+SceneCachePtr TaskListModel::solutionSceneCache(const moveit_task_constructor_msgs::Solution& msg) const {
+	auto it = remote_tasks_.find(msg.task_id);
+	if (it == remote_tasks_.cend() || !it->second)
+		return SceneCachePtr();  // unknown task or task not in use anymore
+
+	return it->second->sceneCache();
+}
+
+bool TaskListModel::processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg,
+                                           const DisplaySolutionPtr& s) {
+	auto it = remote_tasks_.find(msg.task_id);
+	if (it == remote_tasks_.cend() || !it->second)
+		return false;  // unknown task or task not in use anymore
+
+	it->second->processSolutionMessage(msg, s);
+	return true;
+}
+
+void TaskListModel::processSolutionInfo(const moveit_task_constructor_msgs::Solution& msg) {
+	auto it = remote_tasks_.find(msg.task_id);
+	if (it == remote_tasks_.cend() || !it->second)
+		return;  // unknown task or task not in use anymore
+
+	it->second->processSolutionInfo(msg);
+}
+
+void TaskListModel::setSolutionCacheSize(size_t size) {
+	solution_cache_size_ = size;
+	for (const auto& pair : remote_tasks_)
+		if (pair.second)
+			pair.second->setSolutionCacheSize(size);
+}
+
 bool TaskListModel::insertModel(BaseTaskModel* model, int pos) {
 	Q_ASSERT(model && model->columnCount() == columnCount());
 	// pass on stage factory
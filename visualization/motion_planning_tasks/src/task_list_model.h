@@ -61,6 +61,7 @@ class DisplayContext;
 namespace moveit_rviz_plugin {
 
 MOVEIT_CLASS_FORWARD(DisplaySolution);
+MOVEIT_CLASS_FORWARD(SceneCache);
 MOVEIT_CLASS_FORWARD(RemoteTaskModel);
 using StageFactory = PluginlibFactory<moveit::task_constructor::Stage>;
 using StageFactoryPtr = std::shared_ptr<StageFactory>;
@@ -132,6 +133,10 @@ class TaskListModel : public utils::FlatMergeProxyModel
 	std::map<std::string, RemoteTaskModel*> remote_tasks_;
 	// mode reflecting the "Old task handling" setting
 	int old_task_handling_;
+	// max number of DisplaySolutions cached per remote task (0: unlimited)
+	size_t solution_cache_size_ = 0;
+	// statistics messages received since the last flushStatistics(), per task ID
+	std::map<std::string, std::vector<moveit_task_constructor_msgs::TaskStatistics>> pending_statistics_;
 
 	// factory used to create stages
 	StageFactoryPtr stage_factory_;
@@ -157,10 +162,30 @@ public:
 	/// process an incoming task description message - only call in Qt's main loop
 	void processTaskDescriptionMessage(const moveit_task_constructor_msgs::TaskDescription& msg, ros::NodeHandle& nh,
 	                                   const std::string& service_name);
-	/// process an incoming task description message - only call in Qt's main loop
+	/** process an incoming task statistics message - only call in Qt's main loop
+	 *
+	 * The message is only applied by the next flushStatistics(). Until then, a full statistics message
+	 * supersedes all previously received messages of its task, incremental ones are accumulated.
+	 */
 	void processTaskStatisticsMessage(const moveit_task_constructor_msgs::TaskStatistics& msg);
+	/// apply pending statistics messages, notifying views once per task - only call in Qt's main loop
+	void flushStatistics();
 	/// process an incoming solution message - only call in Qt's main loop
 	DisplaySolutionPtr processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg);
+	/** start scene to decode an incoming solution message into, nullptr for unknown tasks - only call in Qt's main loop
+	 *
+	 * Decoding via DisplaySolution::setFromMessage() w.r.t. this scene is thread-safe.
+	 */
+	planning_scene::PlanningScenePtr solutionStartScene(const moveit_task_constructor_msgs::Solution& msg) const;
+	/// scene cache of the task to use for decoding, nullptr for unknown tasks - only call in Qt's main loop
+	SceneCachePtr solutionSceneCache(const moveit_task_constructor_msgs::Solution& msg) const;
+	/// process an incoming solution message, which was already decoded into s - only call in Qt's main loop
+	bool processSolutionMessage(const moveit_task_constructor_msgs::Solution& msg, const DisplaySolutionPtr& s);
+	/// only store the solution's cost and comment infos, fetching trajectories on demand - only call in Qt's main loop
+	void processSolutionInfo(const moveit_task_constructor_msgs::Solution& msg);
+
+	/// limit number of DisplaySolutions cached per remote task (0: unlimited)
+	void setSolutionCacheSize(size_t size);
 
 	/// insert a TaskModel, pos is relative to modelCount()
 	bool insertModel(BaseTaskModel* model, int pos = -1);
@@ -0,0 +1,369 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Throughput of the task models fed with synthetic description, statistics, and solution streams
+ *
+ * All messages are processed on the calling thread, which takes the role of rviz' GUI thread.
+ * Thus, the measured time is the time the GUI thread spends on the messages. A DummyView attached to the
+ * models reads back all changed data, as a QTreeView would do for visible items.
+ */
+
+#include <src/task_list_model.h>
+#include <src/remote_task_model.h>
+#include <utils/tree_merge_proxy_model.h>
+
+#include <benchmark/benchmark.h>
+#include <ros/init.h>
+#include <ros/node_handle.h>
+#include <QCoreApplication>
+
+#include <algorithm>
+#include <memory>
+#include <random>
+
+using namespace moveit_rviz_plugin;
+namespace mtc_msgs = moveit_task_constructor_msgs;
+
+namespace {
+constexpr size_t BRANCHING = 10;  // children per container of the synthetic task
+constexpr size_t ID_BATCH = 10;  // solution IDs per stage in an incremental statistics message
+constexpr size_t FLUSH_INTERVAL = 16;  // statistics messages received between two flushes (the display's timer)
+constexpr size_t SUB_TRAJECTORIES = 10;  // sub trajectories per solution message
+
+ros::NodeHandle& nodeHandle() {
+	static ros::NodeHandle nh;
+	return nh;
+}
+
+// tree of stages with IDs 1..stages: the parent of stage i > 1 is stage (i - 2) / BRANCHING + 1
+mtc_msgs::TaskDescription description(const std::string& task_id, size_t stages, unsigned int revision = 0) {
+	mtc_msgs::TaskDescription msg;
+	msg.task_id = task_id;
+	for (size_t id = 1; id <= stages; ++id) {
+		mtc_msgs::StageDescription desc;
+		desc.id = id;
+		desc.parent_id = id == 1 ? 0 : (id - 2) / BRANCHING + 1;
+		desc.name = "stage " + std::to_string(id) + "." + std::to_string(revision);
+		msg.stages.push_back(std::move(desc));
+	}
+	return msg;
+}
+
+/// reads back the data of all changed or inserted items, like a view showing all of them
+class DummyView
+{
+	QAbstractItemModel* model_;
+	std::vector<QMetaObject::Connection> connections_;
+
+	void read(const QModelIndex& parent, int first_row, int last_row, int first_column, int last_column) {
+		for (int row = first_row; row <= last_row; ++row)
+			for (int column = first_column; column <= last_column; ++column)
+				benchmark::DoNotOptimize(model_->data(model_->index(row, column, parent)));
+		++notifications;
+	}
+
+public:
+	size_t notifications = 0;
+
+	DummyView(QAbstractItemModel* model) : model_(model) {
+		auto on_changed = [this](const QModelIndex& top_left, const QModelIndex& bottom_right) {
+			read(top_left.parent(), top_left.row(), bottom_right.row(), top_left.column(), bottom_right.column());
+		};
+		auto on_inserted = [this](const QModelIndex& parent, int first, int last) {
+			read(parent, first, last, 0, model_->columnCount(parent) - 1);
+		};
+		connections_.push_back(QObject::connect(model, &QAbstractItemModel::dataChanged, on_changed));
+		connections_.push_back(QObject::connect(model, &QAbstractItemModel::rowsInserted, on_inserted));
+		visit(QModelIndex());
+	}
+	~DummyView() {
+		for (const auto& c : connections_)
+			QObject::disconnect(c);
+	}
+
+	/// visit all items, such that the models notify about their changes
+	void visit(const QModelIndex& parent) {
+		for (int row = 0, rows = model_->rowCount(parent); row < rows; ++row)
+			visit(model_->index(row, 0, parent));
+	}
+};
+
+/// stream of incremental statistics messages, reporting ID_BATCH new solutions per stage and message
+class StatisticsStream
+{
+	std::string task_id_;
+	size_t stages_;
+	uint32_t next_id_;
+	std::vector<size_t> solved_;  // number of solutions reported per stage so far
+	std::mt19937 rng_{ 42 };
+
+public:
+	StatisticsStream(std::string task_id, size_t stages, uint32_t first_id = 1)
+	  : task_id_(std::move(task_id)), stages_(stages), next_id_(first_id), solved_(stages, 0) {}
+
+	mtc_msgs::TaskStatistics next() {
+		mtc_msgs::TaskStatistics msg;
+		msg.task_id = task_id_;
+		msg.incremental = true;
+		for (size_t i = 0; i < stages_; ++i) {
+			mtc_msgs::StageStatistics s;
+			s.id = i + 1;
+			// new solutions are inserted at random (increasing) positions of the cost-sorted list
+			std::uniform_int_distribution<uint32_t> position(0, solved_[i]);
+			for (size_t k = 0; k < ID_BATCH; ++k) {
+				s.solved.push_back(next_id_++);
+				s.solved_indices.push_back(position(rng_));
+			}
+			std::sort(s.solved_indices.begin(), s.solved_indices.end());
+			for (size_t k = 0; k < ID_BATCH; ++k)
+				s.solved_indices[k] += k;
+			solved_[i] += ID_BATCH;
+			s.num_failed = solved_[i] / 2;
+			s.total_compute_time = 0.001 * solved_[i];
+			msg.stages.push_back(std::move(s));
+		}
+		return msg;
+	}
+};
+
+// solution message of the root stage, providing infos for its sub trajectories as well
+mtc_msgs::Solution solutionInfo(const std::string& task_id, uint32_t id, size_t stages) {
+	mtc_msgs::Solution msg;
+	msg.task_id = task_id;
+	mtc_msgs::SubSolution sub;
+	sub.info.id = id;
+	sub.info.stage_id = 1;
+	sub.info.cost = 1.0 / id;
+	msg.sub_solution.push_back(sub);
+	for (size_t i = 0; i < SUB_TRAJECTORIES; ++i) {
+		mtc_msgs::SubTrajectory t;
+		t.info.id = id * SUB_TRAJECTORIES + i;
+		t.info.stage_id = 2 + (id + i) % (stages - 1);
+		t.info.cost = 0.1 * i;
+		t.info.comment = "sub trajectory";
+		msg.sub_trajectory.push_back(std::move(t));
+	}
+	return msg;
+}
+
+void reportMessages(benchmark::State& state, size_t messages, size_t notifications) {
+	state.counters["messages"] = benchmark::Counter(messages, benchmark::Counter::kIsRate);
+	state.counters["notifications"] = benchmark::Counter(notifications, benchmark::Counter::kIsRate);
+}
+
+void disposeModels() {
+	QCoreApplication::sendPostedEvents(nullptr, QEvent::DeferredDelete);
+}
+}  // namespace
+
+// repeated descriptions of a known task, renaming all stages
+static void descriptionUpdates(benchmark::State& state) {
+	const size_t stages = state.range(0);
+	TaskListModel model;
+	model.processTaskDescriptionMessage(description("task", stages), nodeHandle(), "get_solution");
+	DummyView view(&model);
+
+	std::vector<mtc_msgs::TaskDescription> msgs{ description("task", stages, 1), description("task", stages, 2) };
+	size_t messages = 0;
+	for (auto _ : state)
+		model.processTaskDescriptionMessage(msgs[messages++ % msgs.size()], nodeHandle(), "get_solution");
+	reportMessages(state, messages, view.notifications);
+}
+BENCHMARK(descriptionUpdates)->ArgName("stages")->Arg(10)->Arg(100)->Arg(500);
+
+// descriptions of new tasks, creating a RemoteTaskModel each
+static void newTasks(benchmark::State& state) {
+	const size_t stages = state.range(0);
+	const mtc_msgs::TaskDescription msg = description("task", stages);
+	size_t messages = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto model = std::make_unique<TaskListModel>();
+		auto view = std::make_unique<DummyView>(model.get());
+		state.ResumeTiming();
+
+		model->processTaskDescriptionMessage(msg, nodeHandle(), "get_solution");
+		++messages;
+
+		state.PauseTiming();
+		view.reset();
+		model.reset();
+		disposeModels();
+		state.ResumeTiming();
+	}
+	state.counters["messages"] = benchmark::Counter(messages, benchmark::Counter::kIsRate);
+}
+BENCHMARK(newTasks)->ArgName("stages")->Arg(10)->Arg(100)->Arg(500);
+
+// incremental statistics streams, reporting the given number of solutions per stage in total
+static void statistics(benchmark::State& state) {
+	const size_t stages = state.range(0);
+	const size_t solutions = state.range(1);
+	size_t messages = 0, notifications = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto model = std::make_unique<TaskListModel>();
+		model->processTaskDescriptionMessage(description("task", stages), nodeHandle(), "get_solution");
+		auto view = std::make_unique<DummyView>(model.get());
+		StatisticsStream stream("task", stages);
+		std::vector<mtc_msgs::TaskStatistics> msgs;
+		for (size_t i = 0; i < solutions / ID_BATCH; ++i)
+			msgs.push_back(stream.next());
+		state.ResumeTiming();
+
+		for (size_t i = 0; i < msgs.size(); ++i) {
+			model->processTaskStatisticsMessage(msgs[i]);
+			if ((i + 1) % FLUSH_INTERVAL == 0)
+				model->flushStatistics();
+		}
+		model->flushStatistics();
+		messages += msgs.size();
+
+		state.PauseTiming();
+		notifications += view->notifications;
+		view.reset();
+		model.reset();
+		disposeModels();
+		state.ResumeTiming();
+	}
+	reportMessages(state, messages, notifications);
+	state.counters["solutions"] = benchmark::Counter(messages * ID_BATCH * stages, benchmark::Counter::kIsRate);
+}
+BENCHMARK(statistics)
+    ->ArgNames({ "stages", "solutions" })
+    ->ArgsProduct({ { 10, 100, 500 }, { 100, 1000 } })
+    ->Unit(benchmark::kMillisecond);
+
+// solution infos of the root stage, with a view showing the root's solution list
+static void solutionInfos(benchmark::State& state) {
+	const size_t stages = state.range(0);
+	const size_t solutions = state.range(1);
+	size_t messages = 0, notifications = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto model = std::make_unique<TaskListModel>();
+		model->processTaskDescriptionMessage(description("task", stages), nodeHandle(), "get_solution");
+		auto* task = dynamic_cast<RemoteTaskModel*>(model->getModel(model->index(0, 0)).first);
+		auto view = std::make_unique<DummyView>(task->getSolutionModel(task->indexFromStageId(1)));
+		// announce the solutions first, such that infos update existing items
+		StatisticsStream stream("task", 1);
+		std::vector<mtc_msgs::TaskStatistics> stats;
+		for (size_t i = 0; i < solutions / ID_BATCH; ++i)
+			stats.push_back(stream.next());
+		for (const auto& msg : stats)
+			model->processTaskStatisticsMessage(msg);
+		model->flushStatistics();
+		std::vector<mtc_msgs::Solution> msgs;
+		for (uint32_t id = 1; id <= solutions; ++id)
+			msgs.push_back(solutionInfo("task", id, stages));
+		view->notifications = 0;
+		state.ResumeTiming();
+
+		for (const auto& msg : msgs)
+			model->processSolutionInfo(msg);
+		messages += msgs.size();
+
+		state.PauseTiming();
+		notifications += view->notifications;
+		view.reset();
+		model.reset();
+		disposeModels();
+		state.ResumeTiming();
+	}
+	reportMessages(state, messages, notifications);
+}
+BENCHMARK(solutionInfos)
+    ->ArgNames({ "stages", "solutions" })
+    ->ArgsProduct({ { 10, 500 }, { 1000, 10000, 50000 } })
+    ->Unit(benchmark::kMillisecond);
+
+// statistics of several tasks, observed through the merge proxies used by the panel (MetaTaskListModel)
+static void mergedStatistics(benchmark::State& state) {
+	const size_t stages = state.range(0);
+	const size_t tasks = state.range(1);
+	const size_t messages_per_task = 20;
+	size_t messages = 0, notifications = 0;
+	for (auto _ : state) {
+		state.PauseTiming();
+		auto meta = std::make_unique<utils::TreeMergeProxyModel>();
+		auto* model = new TaskListModel(meta.get());  // owned by meta
+		meta->insertModel("display", model);
+		std::vector<mtc_msgs::TaskStatistics> msgs;
+		for (size_t t = 0; t < tasks; ++t) {
+			const std::string task_id = "task " + std::to_string(t);
+			model->processTaskDescriptionMessage(description(task_id, stages), nodeHandle(), "get_solution");
+			StatisticsStream stream(task_id, stages, 1 + t * messages_per_task * ID_BATCH * stages);
+			for (size_t i = 0; i < messages_per_task; ++i)
+				msgs.push_back(stream.next());
+		}
+		// interleave the streams of all tasks
+		std::vector<mtc_msgs::TaskStatistics> interleaved;
+		for (size_t i = 0; i < messages_per_task; ++i)
+			for (size_t t = 0; t < tasks; ++t)
+				interleaved.push_back(msgs[t * messages_per_task + i]);
+		auto view = std::make_unique<DummyView>(meta.get());
+		state.ResumeTiming();
+
+		for (size_t i = 0; i < interleaved.size(); ++i) {
+			model->processTaskStatisticsMessage(interleaved[i]);
+			if ((i + 1) % FLUSH_INTERVAL == 0)
+				model->flushStatistics();
+		}
+		model->flushStatistics();
+		messages += interleaved.size();
+
+		state.PauseTiming();
+		notifications += view->notifications;
+		view.reset();
+		meta.reset();
+		disposeModels();
+		state.ResumeTiming();
+	}
+	reportMessages(state, messages, notifications);
+}
+BENCHMARK(mergedStatistics)
+    ->ArgNames({ "stages", "tasks" })
+    ->ArgsProduct({ { 10, 100 }, { 1, 10, 50 } })
+    ->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+	ros::init(argc, argv, "benchmark_task_model", ros::init_options::AnonymousName | ros::init_options::NoRosout);
+	QCoreApplication app(argc, argv);
+	benchmark::Initialize(&argc, argv);
+	if (benchmark::ReportUnrecognizedArguments(argc, argv))
+		return 1;
+	benchmark::RunSpecifiedBenchmarks();
+	return 0;
+}
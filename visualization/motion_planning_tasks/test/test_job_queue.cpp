@@ -0,0 +1,103 @@
+#include <src/job_queue.h>
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace moveit::tools;
+
+TEST(SpscJobQueue, order) {
+	SpscJobQueue queue(4);
+	std::vector<int> executed;
+	for (int i = 0; i < 3; ++i)
+		queue.addJob([&executed, i]() { executed.push_back(i); });
+	EXPECT_EQ(queue.numPending(), 3u);
+
+	queue.executeJobs();
+	EXPECT_EQ(executed, std::vector<int>({ 0, 1, 2 }));
+	EXPECT_EQ(queue.numPending(), 0u);
+}
+
+TEST(SpscJobQueue, full) {
+	SpscJobQueue queue(2);
+	EXPECT_TRUE(queue.tryAddJob([]() {}));
+	EXPECT_TRUE(queue.tryAddJob([]() {}));
+	EXPECT_FALSE(queue.tryAddJob([]() {}));
+	queue.clear();
+	EXPECT_TRUE(queue.tryAddJob([]() {}));
+}
+
+TEST(SpscJobQueue, waitForSpace) {
+	SpscJobQueue queue(1);
+	int executed = 0;
+	EXPECT_TRUE(queue.addJob([&executed]() { ++executed; }));
+	std::atomic<bool> added{ false };
+	std::thread producer([&]() { added = queue.addJob([&executed]() { ++executed; }); });
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	EXPECT_FALSE(added);  // still waiting
+
+	while (!added)
+		queue.executeJobs();
+	producer.join();
+	queue.executeJobs();
+	EXPECT_EQ(executed, 2);
+}
+
+TEST(SpscJobQueue, close) {
+	SpscJobQueue queue(1);
+	int key;
+	EXPECT_TRUE(queue.addJob([]() {}));
+	std::thread producer([&]() {
+		EXPECT_FALSE(queue.addJob([]() {}));
+		EXPECT_FALSE(queue.addJob(&key, []() {}));
+	});
+	std::this_thread::sleep_for(std::chrono::milliseconds(10));
+	queue.close();  // releases the waiting producer
+	producer.join();
+	EXPECT_EQ(queue.numPending(), 1u);
+
+	queue.open();
+	queue.clear();
+	EXPECT_TRUE(queue.addJob(&key, []() {}));
+}
+
+TEST(SpscJobQueue, coalesce) {
+	SpscJobQueue queue;
+	std::vector<int> executed;
+	int key_a, key_b;
+	queue.addJob(&key_a, [&executed]() { executed.push_back(1); });
+	queue.addJob(&key_b, [&executed]() { executed.push_back(2); });
+	queue.addJob(&key_a, [&executed]() { executed.push_back(3); });  // replaces 1
+	queue.addJob([&executed]() { executed.push_back(4); });
+	EXPECT_EQ(queue.numPending(), 3u);
+
+	queue.executeJobs();
+	EXPECT_EQ(executed, std::vector<int>({ 3, 2, 4 }));
+
+	// once executed, keyed jobs are queued again
+	queue.addJob(&key_a, [&executed]() { executed.push_back(5); });
+	queue.executeJobs();
+	EXPECT_EQ(executed.back(), 5);
+}
+
+TEST(SpscJobQueue, concurrent) {
+	SpscJobQueue queue(16);
+	const int n = 10000;
+	int key;
+	int count = 0, latest = -1;
+	std::thread producer([&]() {
+		for (int i = 0; i < n; ++i) {
+			queue.addJob([&count]() { ++count; });
+			queue.addJob(&key, [&latest, i]() { latest = i; });
+		}
+	});
+	while (count < n)
+		queue.executeJobs();
+	producer.join();
+	queue.executeJobs();
+
+	EXPECT_EQ(count, n);
+	EXPECT_EQ(latest, n - 1);
+}
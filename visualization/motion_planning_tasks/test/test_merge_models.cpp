@@ -222,3 +222,38 @@ TEST_F(FlatMergeModelRemove, remove4) {
 	EXPECT_TRUE(flat.removeRows(2, 2));
 	EXPECT_EQ(flat.rowCount(), 1 + 1 + 2);
 }
+
+TEST(FlatMergeModel, rowOffsets) {
+	FlatMergeProxyModel flat;
+	std::vector<QStandardItemModel*> models;
+	for (int i = 1; i <= 10; ++i) {
+		models.push_back(createStandardModel(&flat, i, 3, 1));
+		ASSERT_TRUE(flat.insertModel(models.back()));
+	}
+	ASSERT_EQ(flat.rowCount(), 55);
+
+	auto expect_source = [&flat](int row, int column, QStandardItemModel* model, int src_row) {
+		auto src = flat.getModel(flat.index(row, column));
+		EXPECT_EQ(src.first, model);
+		EXPECT_EQ(src.second, model->index(src_row, column));
+	};
+
+	// grow and shrink a model in the middle: offsets of subsequent models need to follow
+	models[4]->appendRow(new QStandardItem("new"));
+	EXPECT_EQ(flat.rowCount(), 56);
+	expect_source(15, 0, models[4], 5);
+	expect_source(16, 0, models[5], 0);
+
+	models[2]->removeRow(0);
+	EXPECT_EQ(flat.rowCount(), 55);
+	expect_source(3, 0, models[2], 0);
+	expect_source(4, 0, models[2], 1);
+	expect_source(5, 1, models[3], 0);
+
+	// removing a model shifts all later ones
+	EXPECT_TRUE(flat.removeModel(models[0]));
+	EXPECT_EQ(flat.rowCount(), 54);
+	expect_source(0, 0, models[1], 0);
+	expect_source(53, 2, models[9], 9);
+	EXPECT_FALSE(flat.index(54, 0).isValid());
+}
@@ -55,3 +55,41 @@ TEST_F(SolutionModelTest, sorting) {
 	processAndValidate({ 1, 3 }, { 2 });
 	processAndValidate({ 4, 1, 6, 3 }, { 5, 2 });
 }
+
+TEST_F(SolutionModelTest, incremental) {
+	RemoteSolutionModel model;
+	processAndValidate({ 1, 3 }, { 2 });
+	// new ids 4 and 6 are inserted at cost positions 0 and 2: { 4, 1, 6, 3 }
+	model.processIncrementalSolutionIDs({ 4, 6 }, { 0, 2 }, { 5 }, 2, 0.0);
+	EXPECT_EQ(model.numSuccessful(), 4u);
+	EXPECT_EQ(model.numFailed(), 2u);
+	validateSorting(model, 0, Qt::AscendingOrder, { 1, 2, 3, 4, 5, 6 });
+	validateSorting(model, 1, Qt::AscendingOrder, { 4, 1, 6, 3, 2, 5 });
+
+	// a keyframe yields the same result
+	processAndValidate({ 4, 1, 6, 3 }, { 5, 2 });
+}
+
+TEST_F(SolutionModelTest, insertion) {
+	RemoteSolutionModel model;
+	model.sort(1, Qt::AscendingOrder);
+	model.processSolutionIDs({ 1, 3 }, { 2 }, 1, 0.0);
+
+	int inserted = 0;
+	int layouts = 0;
+	QObject::connect(&model, &QAbstractItemModel::rowsInserted,
+	                 [&inserted](const QModelIndex& /*parent*/, int first, int last) { inserted += last - first + 1; });
+	QObject::connect(&model, &QAbstractItemModel::layoutChanged, [&layouts]() { ++layouts; });
+
+	// new solutions don't change the relative order of existing ones: rows are inserted without a relayout
+	model.processIncrementalSolutionIDs({ 4, 6 }, { 0, 2 }, { 5 }, 2, 0.0);
+	EXPECT_EQ(inserted, 3);
+	EXPECT_EQ(layouts, 0);
+	validateSorting(model, 1, Qt::AscendingOrder, { 4, 1, 6, 3, 2, 5 });
+
+	// reordering existing solutions requires a full resort
+	model.processSolutionIDs({ 3, 1, 4, 6 }, { 5, 2 }, 2, 0.0);
+	EXPECT_EQ(inserted, 3);
+	EXPECT_EQ(layouts, 1);
+	validateSorting(model, 1, Qt::AscendingOrder, { 3, 1, 4, 6, 2, 5 });
+}
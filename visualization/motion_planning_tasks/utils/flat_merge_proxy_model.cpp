@@ -36,7 +36,8 @@
 
 #include "flat_merge_proxy_model.h"
 #include <vector>
-#include <numeric>
+#include <algorithm>
+#include <unordered_map>
 
 namespace moveit_rviz_plugin {
 namespace utils {
@@ -105,28 +106,52 @@ public:
 
 	// top-level items
 	std::vector<ModelData> data_;
+	// index of each model in data_
+	std::unordered_map<const QObject*, size_t> positions_;
+	// prefix sums of top-level rows: offsets_[i] = number of rows of all models before data_[i]
+	std::vector<int> offsets_;
+	// model owning the mapping of an internal pointer, nullptr if several models share the pointer
+	mutable std::unordered_map<void*, const QAbstractItemModel*> owners_;
 
 public:
-	FlatMergeProxyModelPrivate(FlatMergeProxyModel* model) : q_ptr(model) {}
+	FlatMergeProxyModelPrivate(FlatMergeProxyModel* model) : q_ptr(model), offsets_(1, 0) {}
 
 	std::vector<ModelData>::iterator find(const QObject* model) {
 		Q_ASSERT(model);
-		return std::find_if(data_.begin(), data_.end(), [model](const auto& data) { return data.model_ == model; });
+		auto it = positions_.find(model);
+		return it == positions_.end() ? data_.end() : data_.begin() + it->second;
+	}
+	const ModelData* find(const QObject* model) const {
+		auto it = positions_.find(model);
+		return it == positions_.end() ? nullptr : &data_[it->second];
 	}
 
-	int accumulatedRowCount(std::vector<ModelData>::const_iterator start,
-	                        std::vector<ModelData>::const_iterator end) const {
-		return std::accumulate(start, end, 0, [](int acc, const auto& d) { return acc + d.model_->rowCount(); });
+	// update positions_ and offsets_ for all models starting at position from
+	void updateIndex(size_t from = 0) {
+		offsets_.resize(data_.size() + 1);
+		for (size_t i = from; i < data_.size(); ++i) {
+			positions_[data_[i].model_] = i;
+			offsets_[i + 1] = offsets_[i] + data_[i].model_->rowCount();
+		}
 	}
 	int rowOffset(QObject* model) {
-		int result = 0;
-		for (const ModelData& d : data_) {
-			if (d.model_ == model)
-				return result;
-			result += d.model_->rowCount();
-		}
-		Q_ASSERT(false);
-		return 0;
+		auto it = positions_.find(model);
+		Q_ASSERT(it != positions_.end());
+		return offsets_[it->second];
+	}
+	int rowCount() const { return offsets_.back(); }
+
+	inline void storeMapping(ModelData& data, void* src_internal_pointer, const QModelIndex& src_parent) const {
+		data.storeMapping(src_internal_pointer, src_parent);
+		auto it = owners_.emplace(src_internal_pointer, data.model_).first;
+		if (it->second != data.model_)
+			it->second = nullptr;  // ambiguous: fall back to searching all models
+	}
+	// forget about ownership of src_internal_pointer by model
+	void releaseMapping(const QAbstractItemModel* model, void* src_internal_pointer) {
+		auto it = owners_.find(src_internal_pointer);
+		if (it != owners_.end() && it->second == model)
+			owners_.erase(it);
 	}
 
 	// retrieve the source_index corresponding to proxy_index
@@ -134,21 +159,27 @@ public:
 		Q_ASSERT(proxy_index.isValid());
 		Q_ASSERT(proxy_index.model() == q_ptr);
 
-		int prev_rows = 0;  // accumulated rows from previous models
+		auto map = [&](const ModelData& d, const QModelIndex& src_index) {
+			data = const_cast<ModelData*>(&d);
+			int row = proxy_index.row();
+			if (!src_index.isValid())  // top-level item of embedded model
+				row -= offsets_[&d - data_.data()];  // need to reduce row by number of previous' models rows
+			return d.model_->index(row, proxy_index.column(), src_index);
+		};
+
+		// internal_pointer points to source parent
+		auto owner = owners_.find(proxy_index.internalPointer());
+		if (owner != owners_.end() && owner->second) {
+			const ModelData* d = find(owner->second);
+			Q_ASSERT(d);
+			auto it = d->proxy_to_source_mapping_.find(proxy_index.internalPointer());
+			Q_ASSERT(it != d->proxy_to_source_mapping_.end());
+			return map(*d, it->second);
+		}
 		for (const ModelData& d : data_) {
-			// internal_pointer points to source parent
 			auto it = d.proxy_to_source_mapping_.find(proxy_index.internalPointer());
-			if (it != d.proxy_to_source_mapping_.end()) {
-				data = const_cast<ModelData*>(&d);
-				const QModelIndex& src_index = it->second;
-				int row = proxy_index.row();
-
-				if (!src_index.isValid())  // top-level item of embedded model
-					row -= prev_rows;  // need to reduce row by number of previous' models rows
-
-				return d.model_->index(row, proxy_index.column(), src_index);
-			}
-			prev_rows += d.model_->rowCount();
+			if (it != d.proxy_to_source_mapping_.end())
+				return map(d, it->second);
 		}
 		Q_ASSERT(false);
 		return QModelIndex();
@@ -161,20 +192,14 @@ public:
 		QModelIndex src_parent = src.parent();
 		int prev_rows = 0;
 		if (!src_parent.isValid()) {  // src is top-level item
-			auto it = data_.begin(), end = data_.end();
-			for (; it != end; ++it) {
-				if (it->model_ == src.model()) {
-					data = &const_cast<ModelData&>(*it);
-					break;
-				}
-				prev_rows += it->model_->rowCount();
-			}
-			Q_ASSERT(it != end);
+			data = const_cast<ModelData*>(find(src.model()));
+			Q_ASSERT(data);
+			prev_rows = offsets_[data - data_.data()];
 		}
 
 		// store source index in mapping: easy, if we already know the correspondig model (coming top-down)
 		if (data)
-			data->storeMapping(src.internalPointer(), src_parent);
+			storeMapping(*data, src.internalPointer(), src_parent);
 		// coming bottom-up, we need to climb the tree until we reach root and can lookup the model
 		else
 			mapSourceIndexes(src, data);
@@ -189,20 +214,16 @@ public:
 		const QModelIndex& src_parent = src.parent();
 		if (!src_parent.isValid()) {  // reached root
 			// figure out corresponding ModelData from src.model()
-			for (const ModelData& d : data_) {
-				if (d.model_ == src.model()) {
-					data = const_cast<ModelData*>(&d);
-					data->storeMapping(src.internalPointer(), src_parent);
-					return;
-				}
-			}
-			Q_ASSERT(false);  // src should be part of our model!
+			data = const_cast<ModelData*>(find(src.model()));
+			Q_ASSERT(data);  // src should be part of our model!
+			storeMapping(*data, src.internalPointer(), src_parent);
+			return;
 		}
 
 		// recursively climb the tree
 		mapSourceIndexes(src_parent, data);
 		// now data should be well-defined
-		data->storeMapping(src.internalPointer(), src_parent);
+		storeMapping(*data, src.internalPointer(), src_parent);
 	}
 
 	// remove model referenced by it, call indicates that onRemoveModel() should be called
@@ -251,7 +272,7 @@ int FlatMergeProxyModel::rowCount(const QModelIndex& parent) const {
 		return 0;
 
 	if (!parent.isValid())  // root
-		return d_ptr->accumulatedRowCount(d_ptr->data_.begin(), d_ptr->data_.end());
+		return d_ptr->rowCount();
 
 	FlatMergeProxyModelPrivate::ModelData* data = nullptr;
 	QModelIndex src_parent = d_ptr->mapToSource(parent, data);
@@ -275,18 +296,17 @@ QModelIndex FlatMergeProxyModel::index(int row, int column, const QModelIndex& p
 		return QModelIndex();
 
 	if (!parent.isValid()) {  // top-level items
-		int prev_rows = 0;
-		for (FlatMergeProxyModelPrivate::ModelData& d : const_cast<FlatMergeProxyModelPrivate*>(d_ptr)->data_) {
-			int rows = d.model_->rowCount();
-			if (row - prev_rows < rows) {
-				const QModelIndex& src_index = d.model_->index(row - prev_rows, column, QModelIndex());
-				// for top-level item, internal pointer refers to model
-				d.storeMapping(src_index.internalPointer(), QModelIndex());
-				return createIndex(row, column, src_index.internalPointer());
-			}
-			prev_rows += rows;
-		}
-		return QModelIndex();  // row is too large
+		if (row >= d_ptr->rowCount())
+			return QModelIndex();  // row is too large
+
+		// find last model starting at or before row
+		const auto& offsets = d_ptr->offsets_;
+		size_t pos = std::upper_bound(offsets.begin(), offsets.end(), row) - offsets.begin() - 1;
+		FlatMergeProxyModelPrivate::ModelData& d = const_cast<FlatMergeProxyModelPrivate*>(d_ptr)->data_[pos];
+		const QModelIndex& src_index = d.model_->index(row - offsets[pos], column, QModelIndex());
+		// for top-level item, internal pointer refers to model
+		d_ptr->storeMapping(d, src_index.internalPointer(), QModelIndex());
+		return createIndex(row, column, src_index.internalPointer());
 	}
 
 	// other items need to refer to operation on source model
@@ -415,20 +435,13 @@ bool FlatMergeProxyModel::insertModel(QAbstractItemModel* model, int pos) {
 	if (pos < 0)
 		pos = modelCount() + std::max<int>(pos + 1, -modelCount());
 	Q_ASSERT(pos >= 0 && pos <= static_cast<int>(modelCount()));
-	auto it = d_ptr->data_.begin();
-	std::advance(it, pos);
-
-	int row = 0;
-	for (const auto& d : d_ptr->data_) {
-		if (d.model_ == model)
-			return false;  // model can only inserted once
-		// accumulate rowCount() of models before pos
-		if (--pos >= 0)
-			row += d.model_->rowCount();
-	}
+	if (d_ptr->positions_.count(model))
+		return false;  // model can only inserted once
 
+	int row = d_ptr->offsets_[pos];  // accumulated rowCount() of models before pos
 	beginInsertRows(QModelIndex(), row, row + model->rowCount() - 1);
-	d_ptr->data_.insert(it, FlatMergeProxyModelPrivate::ModelData(model));
+	d_ptr->data_.insert(d_ptr->data_.begin() + pos, FlatMergeProxyModelPrivate::ModelData(model));
+	d_ptr->updateIndex(pos);
 	endInsertRows();
 
 	connect(model, SIGNAL(destroyed(QObject*)), this, SLOT(_q_sourceDestroyed(QObject*)));
@@ -502,11 +515,16 @@ bool FlatMergeProxyModelPrivate::removeModel(std::vector<ModelData>::iterator it
 	if (it == data_.end())
 		return false;
 
-	int row = accumulatedRowCount(data_.begin(), it);
+	size_t pos = it - data_.begin();
+	int row = offsets_[pos];
 	q_ptr->beginRemoveRows(QModelIndex(), row, row + it->model_->rowCount() - 1);
 	if (call)
 		q_ptr->onRemoveModel(it->model_);
-	it = data_.erase(it);
+	for (const auto& mapping : it->proxy_to_source_mapping_)
+		releaseMapping(it->model_, mapping.first);
+	positions_.erase(it->model_);
+	data_.erase(it);
+	updateIndex(pos);
 	q_ptr->endRemoveRows();
 	return true;
 }
@@ -543,31 +561,35 @@ void FlatMergeProxyModelPrivate::_q_sourceRowsAboutToBeRemoved(const QModelIndex
 
 // NOLINTNEXTLINE(readability-identifier-naming)
 void FlatMergeProxyModelPrivate::_q_sourceRowsInserted(const QModelIndex& parent, int start, int end) {
-	Q_UNUSED(parent)
 	Q_UNUSED(start)
 	Q_UNUSED(end)
+	if (!parent.isValid())
+		updateIndex(find(q_ptr->sender()) - data_.begin());
 	q_ptr->endInsertRows();
 }
 
 // NOLINTNEXTLINE(readability-identifier-naming)
 void FlatMergeProxyModelPrivate::_q_sourceRowsMoved(const QModelIndex& sourceParent, int sourceStart, int sourceEnd,
                                                     const QModelIndex& destParent, int dest) {
-	Q_UNUSED(sourceParent)
 	Q_UNUSED(sourceStart)
 	Q_UNUSED(sourceEnd)
-	Q_UNUSED(destParent)
 	Q_UNUSED(dest)
+	if (!sourceParent.isValid() || !destParent.isValid())
+		updateIndex(find(q_ptr->sender()) - data_.begin());
 	q_ptr->endMoveRows();
 }
 
 // NOLINTNEXTLINE(readability-identifier-naming)
 void FlatMergeProxyModelPrivate::_q_sourceRowsRemoved(const QModelIndex& parent, int start, int end) {
-	Q_UNUSED(parent)
 	Q_UNUSED(start)
 	Q_UNUSED(end)
 
 	auto it = find(q_ptr->sender());
 	Q_ASSERT(it != data_.end());
+	for (const auto& mapping : it->invalidated_mappings_)
+		releaseMapping(it->model_, mapping->first);
+	if (!parent.isValid())
+		updateIndex(it - data_.begin());
 	if (it->rowsRemoved())
 		q_ptr->endRemoveRows();
 }
@@ -36,6 +36,7 @@
 
 #include "tree_merge_proxy_model.h"
 #include <vector>
+#include <unordered_map>
 
 namespace moveit_rviz_plugin {
 namespace utils {
@@ -106,13 +107,47 @@ public:
 
 	// top-level items
 	std::vector<ModelData> data_;
+	// index of each model in data_
+	std::unordered_map<const QObject*, size_t> positions_;
+	// model owning the mapping of an internal pointer, nullptr if several models share the pointer
+	mutable std::unordered_map<void*, const QAbstractItemModel*> owners_;
 
 public:
 	TreeMergeProxyModelPrivate(TreeMergeProxyModel* model) : q_ptr(model) {}
 
 	std::vector<ModelData>::iterator find(const QObject* model) {
 		Q_ASSERT(model);
-		return std::find_if(data_.begin(), data_.end(), [model](const auto& data) { return data.model_ == model; });
+		auto it = positions_.find(model);
+		return it == positions_.end() ? data_.end() : data_.begin() + it->second;
+	}
+	const ModelData* find(const QObject* model) const {
+		auto it = positions_.find(model);
+		return it == positions_.end() ? nullptr : &data_[it->second];
+	}
+
+	// update positions_ for all models starting at position from
+	void updateIndex(size_t from = 0) {
+		for (size_t i = from; i < data_.size(); ++i)
+			positions_[data_[i].model_] = i;
+	}
+
+	inline void storeMapping(ModelData& data, void* src_internal_pointer, const QModelIndex& src_parent) const {
+		data.storeMapping(src_internal_pointer, src_parent);
+		auto it = owners_.emplace(src_internal_pointer, data.model_).first;
+		if (it->second != data.model_)
+			it->second = nullptr;  // ambiguous: fall back to searching all models
+	}
+	// forget about ownership of src_internal_pointer by model
+	void releaseMapping(const QAbstractItemModel* model, void* src_internal_pointer) {
+		auto it = owners_.find(src_internal_pointer);
+		if (it != owners_.end() && it->second == model)
+			owners_.erase(it);
+	}
+	// forget about model, before erasing it from data_
+	void releaseModel(const ModelData& data) {
+		for (const auto& mapping : data.proxy_to_source_mapping_)
+			releaseMapping(data.model_, mapping.first);
+		positions_.erase(data.model_);
 	}
 
 	// retrieve the source_index corresponding to proxy_index
@@ -125,8 +160,17 @@ public:
 			return QModelIndex();
 		}
 
+		// internal_pointer points to source parent
+		auto owner = owners_.find(proxy_index.internalPointer());
+		if (owner != owners_.end() && owner->second) {
+			const ModelData* d = find(owner->second);
+			Q_ASSERT(d);
+			auto it = d->proxy_to_source_mapping_.find(proxy_index.internalPointer());
+			Q_ASSERT(it != d->proxy_to_source_mapping_.end());
+			data = const_cast<ModelData*>(d);
+			return d->model_->index(proxy_index.row(), proxy_index.column(), it->second);
+		}
 		for (const ModelData& d : data_) {
-			// internal_pointer points to source parent
 			auto it = d.proxy_to_source_mapping_.find(proxy_index.internalPointer());
 			if (it != d.proxy_to_source_mapping_.end()) {
 				data = const_cast<ModelData*>(&d);
@@ -141,11 +185,10 @@ public:
 		if (!src.isValid()) {  // root src index: map to group item
 			QObject* model = data ? data->model_ : q_ptr->sender();
 			Q_ASSERT(model);
-			for (int row = 0, end = data_.size(); row != end; ++row) {
-				if (data_.at(row).model_ == model)
-					// for top-level items, internal pointer refers to this model
-					return q_ptr->createIndex(row, 0, q_ptr);
-			}
+			auto it = positions_.find(model);
+			if (it != positions_.end())
+				// for top-level items, internal pointer refers to this model
+				return q_ptr->createIndex(it->second, 0, q_ptr);
 			Q_ASSERT(false);
 		}
 
@@ -153,7 +196,7 @@ public:
 
 		// store source index in mapping: easy, if we already know the correspondig model (coming top-down)
 		if (data)
-			data->storeMapping(src.internalPointer(), src_parent);
+			storeMapping(*data, src.internalPointer(), src_parent);
 		// coming bottom-up, we need to climb the tree until we reach root and can lookup the model
 		else
 			mapSourceIndexes(src, data);
@@ -168,27 +211,21 @@ public:
 		const QModelIndex& src_parent = src.parent();
 		if (!src_parent.isValid()) {  // reached root
 			// figure out corresponding ModelData from src.model()
-			for (const ModelData& d : data_) {
-				if (d.model_ == src.model()) {
-					data = const_cast<ModelData*>(&d);
-					data->storeMapping(src.internalPointer(), src_parent);
-					return;
-				}
-			}
-			Q_ASSERT(false);  // src should be part of our model!
+			data = const_cast<ModelData*>(find(src.model()));
+			Q_ASSERT(data);  // src should be part of our model!
+			storeMapping(*data, src.internalPointer(), src_parent);
+			return;
 		}
 
 		// recursively climb the tree
 		mapSourceIndexes(src_parent, data);
 		// now data should be well-defined
-		data->storeMapping(src.internalPointer(), src_parent);
+		storeMapping(*data, src.internalPointer(), src_parent);
 	}
 
 	std::vector<ModelData>::iterator getModelIterator(const QAbstractItemModel* model) {
-		for (auto it = data_.begin(), end = data_.end(); it != end; ++it)
-			if (it->model_ == model)
-				return it;
-		return data_.end();
+		auto it = positions_.find(model);
+		return it == positions_.end() ? data_.end() : data_.begin() + it->second;
 	}
 
 	bool removeModel(std::vector<ModelData>::iterator it, bool call);
@@ -371,8 +408,12 @@ bool TreeMergeProxyModel::removeRows(int row, int count, const QModelIndex& pare
 		std::advance(last, count);
 
 		beginRemoveRows(QModelIndex(), row, row + count - 1);
-		std::for_each(first, last, [this](const auto& data) { this->onRemoveModel(data.model_); });
+		std::for_each(first, last, [this](const auto& data) {
+			this->onRemoveModel(data.model_);
+			d_ptr->releaseModel(data);
+		});
 		d_ptr->data_.erase(first, last);
+		d_ptr->updateIndex(row);
 		endRemoveRows();
 		return true;
 	} else {
@@ -387,9 +428,8 @@ bool TreeMergeProxyModel::insertModel(const QString& name, QAbstractItemModel* m
 		return false;  // invalid model
 	if (!d_ptr->data_.empty() && model->columnCount() != columnCount())
 		return false;  // all models must have same column count
-	for (const auto& d : d_ptr->data_)
-		if (d.model_ == model)
-			return false;  // model can only inserted once
+	if (d_ptr->positions_.count(model))
+		return false;  // model can only inserted once
 
 	// limit pos to range [0, modelCount()]
 	if (pos > 0 && pos > static_cast<int>(modelCount()))
@@ -402,6 +442,7 @@ bool TreeMergeProxyModel::insertModel(const QString& name, QAbstractItemModel* m
 
 	beginInsertRows(QModelIndex(), pos, pos);
 	d_ptr->data_.insert(it, TreeMergeProxyModelPrivate::ModelData(name, model));
+	d_ptr->updateIndex(pos);
 	endInsertRows();
 
 	connect(model, SIGNAL(destroyed(QObject*)), this, SLOT(_q_sourceDestroyed(QObject*)));
@@ -484,7 +525,9 @@ bool TreeMergeProxyModelPrivate::removeModel(std::vector<ModelData>::iterator it
 	q_ptr->beginRemoveRows(QModelIndex(), row, row);
 	if (call)
 		q_ptr->onRemoveModel(it->model_);
+	releaseModel(*it);
 	data_.erase(it);
+	updateIndex(row);
 	q_ptr->endRemoveRows();
 	return true;
 }
@@ -540,6 +583,8 @@ void TreeMergeProxyModelPrivate::_q_sourceRowsRemoved(const QModelIndex& parent,
 
 	auto it = find(q_ptr->sender());
 	Q_ASSERT(it != data_.end());
+	for (const auto& mapping : it->invalidated_mappings_)
+		releaseMapping(it->model_, mapping->first);
 	if (it->rowsRemoved())
 		q_ptr->endRemoveRows();
 }
@@ -39,6 +39,9 @@
 #include <moveit_task_constructor_msgs/Solution.h>
 #include <moveit/macros/class_forward.h>
 
+#include <mutex>
+#include <unordered_map>
+
 namespace moveit {
 namespace core {
 MOVEIT_CLASS_FORWARD(RobotState);
@@ -61,6 +64,42 @@ namespace moveit_rviz_plugin {
 
 MOVEIT_CLASS_FORWARD(DisplaySolution);
 MOVEIT_CLASS_FORWARD(MarkerVisualization);
+MOVEIT_CLASS_FORWARD(SceneCache);
+
+/** Cache of decoded planning scenes, shared by the solutions of a task
+ *
+ * Scenes are identified by the content of their message and, for diffs, by their parent scene.
+ * Thus, solutions sharing a start scene or a common prefix share their decoded scenes.
+ * Scenes are only cached as long as some solution uses them. Thread-safe.
+ */
+class SceneCache
+{
+public:
+	/// the scene described by the full scene msg, decoded into start_scene if not yet known
+	planning_scene::PlanningSceneConstPtr startScene(const planning_scene::PlanningScenePtr& start_scene,
+	                                                 const moveit_msgs::PlanningScene& msg);
+	/// (a diff of) parent with the scene diff msg applied
+	planning_scene::PlanningSceneConstPtr diffScene(const planning_scene::PlanningSceneConstPtr& parent,
+	                                                const moveit_msgs::PlanningScene& msg);
+	/// number of cached scenes, including expired ones not yet swept
+	size_t size();
+
+private:
+	struct Entry
+	{
+		const planning_scene::PlanningScene* parent;  // nullptr for start scenes
+		std::string msg;  // serialized scene message
+		std::weak_ptr<const planning_scene::PlanningScene> scene;
+	};
+	std::mutex mutex_;
+	std::unordered_multimap<size_t, Entry> scenes_;
+	size_t sweep_size_ = 64;
+
+	planning_scene::PlanningSceneConstPtr lookup(size_t key, const planning_scene::PlanningScene* parent,
+	                                             const std::string& msg);
+	void insert(size_t key, const planning_scene::PlanningScene* parent, std::string&& msg,
+	            const planning_scene::PlanningSceneConstPtr& scene);
+};
 
 /** Class representing a task solution for display */
 class DisplaySolution
@@ -120,12 +159,19 @@ public:
 	const std::string& comment(size_t index) const { return comment(indexPair(index)); }
 	uint32_t creatorId(const IndexPair& idx_pair) const;
 
+	/** indices of way points moving at least min_distance in joint space since the previously selected one
+	 *
+	 * The first and last way point of each sub trajectory are always selected. min_distance <= 0 selects all.
+	 */
+	std::vector<size_t> decimatedWayPoints(double min_distance) const;
+
 	const MarkerVisualizationPtr markers(const IndexPair& idx_pair) const;
 	const MarkerVisualizationPtr markers(size_t index) const { return markers(indexPair(index)); }
 	const MarkerVisualizationPtr markersOfSubTrajectory(size_t index) const { return data_.at(index).markers_; }
 
+	/// decode msg w.r.t. start_scene, sharing scenes with other solutions via cache (if provided)
 	void setFromMessage(const planning_scene::PlanningScenePtr& start_scene,
-	                    const moveit_task_constructor_msgs::Solution& msg);
+	                    const moveit_task_constructor_msgs::Solution& msg, SceneCache* cache = nullptr);
 	void fillMessage(moveit_task_constructor_msgs::Solution& msg) const;
 };
 }  // namespace moveit_rviz_plugin
@@ -0,0 +1,104 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Render the world of planning scenes, updating geometry of changed objects only */
+
+#pragma once
+
+#include <moveit/macros/class_forward.h>
+#include <moveit/collision_detection/world.h>
+#include <moveit/rviz_plugin_render_tools/octomap_render.h>
+#include <rviz/helpers/color.h>
+
+#include <map>
+#include <memory>
+#include <string>
+
+namespace Ogre {
+class SceneNode;
+}
+namespace rviz {
+class DisplayContext;
+}
+namespace planning_scene {
+MOVEIT_CLASS_FORWARD(PlanningScene);
+}
+
+namespace moveit_rviz_plugin {
+
+MOVEIT_CLASS_FORWARD(IncrementalSceneRender);
+class RenderShapes;
+
+/** Render the world objects of planning scenes, like PlanningSceneRender without a robot
+ *
+ * Switching to another scene only updates the geometry of the objects that differ from the previously rendered
+ * scene. Scenes derived via diff() share their unchanged objects, such that changes are detected by identity.
+ * Consecutive scenes of a solution usually differ in a single (attached or detached) object, while rendering
+ * meshes and octomaps from scratch is expensive.
+ */
+class IncrementalSceneRender
+{
+public:
+	IncrementalSceneRender(Ogre::SceneNode* root_node, rviz::DisplayContext* context);
+	~IncrementalSceneRender();
+
+	Ogre::SceneNode* getGeometryNode() { return geometry_node_; }
+
+	void renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene, const rviz::Color& default_env_color,
+	                         OctreeVoxelRenderMode octree_voxel_rendering, OctreeVoxelColorMode octree_color_mode,
+	                         float default_scene_alpha);
+	/// remove all geometry, such that the next scene is rendered from scratch
+	void clear();
+
+private:
+	struct Object
+	{
+		collision_detection::World::ObjectConstPtr object;  // rendered version of the object
+		rviz::Color color;
+		float alpha;
+		Ogre::SceneNode* node = nullptr;
+		std::unique_ptr<RenderShapes> shapes;
+	};
+
+	void destroy(Object& object);
+
+	Ogre::SceneNode* geometry_node_;
+	rviz::DisplayContext* context_;
+	std::map<std::string, Object> objects_;
+	// render modes of all rendered objects
+	OctreeVoxelRenderMode octree_voxel_rendering_ = OCTOMAP_OCCUPIED_VOXELS;
+	OctreeVoxelColorMode octree_color_mode_ = OCTOMAP_Z_AXIS_COLOR;
+};
+}  // namespace moveit_rviz_plugin
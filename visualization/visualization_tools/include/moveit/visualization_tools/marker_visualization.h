@@ -35,6 +35,8 @@ MOVEIT_CLASS_FORWARD(MarkerVisualization);
  *  corresponding scene node, which allows for fast toggling of visibility.
  *  Placement of markers always refers to the frames of a (fixed) planning scene
  *  and is transformed once w.r.t. its planning frame during construction.
+ *  Marker messages are deduplicated by content: identical markers are shared between
+ *  all instances and only created once per instance.
  */
 class MarkerVisualization
 {
@@ -44,7 +46,7 @@ class MarkerVisualization
 		visualization_msgs::MarkerPtr msg_;
 		std::shared_ptr<rviz::MarkerBase> marker_;
 
-		MarkerData(const visualization_msgs::Marker& marker);
+		MarkerData(visualization_msgs::MarkerPtr msg) : msg_(std::move(msg)) {}
 	};
 	struct NamespaceData
 	{
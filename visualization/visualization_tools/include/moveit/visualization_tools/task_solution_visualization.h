@@ -79,7 +79,7 @@ namespace moveit_rviz_plugin {
 
 MOVEIT_CLASS_FORWARD(RobotStateVisualization);
 MOVEIT_CLASS_FORWARD(TaskSolutionVisualization);
-MOVEIT_CLASS_FORWARD(PlanningSceneRender);
+MOVEIT_CLASS_FORWARD(IncrementalSceneRender);
 MOVEIT_CLASS_FORWARD(DisplaySolution);
 
 class TaskSolutionPanel;
@@ -127,6 +127,7 @@ private Q_SLOTS:
 	void changedRobotAlpha();
 	void changedLoopDisplay();
 	void changedTrail();
+	void changedDecimation();
 	void changedRobotColor();
 	void enabledRobotColor();
 	void changedAttachedBodyColor();
@@ -144,12 +145,14 @@ protected:
 	void setVisibility(Ogre::SceneNode* node, Ogre::SceneNode* parent, bool visible);
 	float getStateDisplayTime();
 	void clearTrail();
+	/// next way point to display after index, skipping decimated ones
+	int nextWayPoint(int index) const;
 	void renderCurrentWayPoint();
 	void renderWayPoint(size_t index, int previous_index);
 	void renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene);
 
 	// render the planning scene
-	PlanningSceneRenderPtr scene_render_;
+	IncrementalSceneRenderPtr scene_render_;
 	// render the robot
 	RobotStateVisualizationPtr robot_render_;
 	// render markers
@@ -162,6 +165,8 @@ protected:
 	DisplaySolutionPtr displaying_solution_;
 	DisplaySolutionPtr next_solution_to_display_;
 	std::vector<rviz::Robot*> trail_;
+	std::vector<size_t> trail_waypoints_;  // way point index of each trail robot
+	std::vector<size_t> waypoints_;  // way points of displaying_solution_ remaining after decimation
 	bool animating_ = false;  // auto-progressing the current waypoint?
 	bool drop_displaying_solution_ = false;
 	bool locked_ = false;
@@ -194,6 +199,7 @@ protected:
 	rviz::BoolProperty* trail_display_property_;
 	rviz::BoolProperty* interrupt_display_property_;
 	rviz::IntProperty* trail_step_size_property_;
+	rviz::FloatProperty* decimation_property_;
 
 	// PlanningScene Properties
 	rviz::BoolProperty* scene_enabled_property_;
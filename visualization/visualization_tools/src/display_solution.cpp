@@ -39,10 +39,77 @@
 #include <moveit/planning_scene/planning_scene.h>
 #include <moveit/robot_trajectory/robot_trajectory.h>
 #include <ros/console.h>
+#include <ros/serialization.h>
 #include <fmt/core.h>
 
+#include <algorithm>
+
 namespace moveit_rviz_plugin {
 
+namespace {
+std::string serialize(const moveit_msgs::PlanningScene& msg) {
+	std::string buffer(ros::serialization::serializationLength(msg), '\0');
+	ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&buffer[0]), buffer.size());
+	ros::serialization::serialize(stream, msg);
+	return buffer;
+}
+}  // namespace
+
+planning_scene::PlanningSceneConstPtr SceneCache::lookup(size_t key, const planning_scene::PlanningScene* parent,
+                                                         const std::string& msg) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	auto range = scenes_.equal_range(key);
+	for (auto it = range.first; it != range.second; ++it) {
+		// a living diff scene keeps its parent alive, thus parent pointers are unique
+		if (it->second.parent != parent || it->second.msg != msg)
+			continue;
+		if (auto scene = it->second.scene.lock())
+			return scene;
+	}
+	return planning_scene::PlanningSceneConstPtr();
+}
+
+void SceneCache::insert(size_t key, const planning_scene::PlanningScene* parent, std::string&& msg,
+                        const planning_scene::PlanningSceneConstPtr& scene) {
+	std::lock_guard<std::mutex> lock(mutex_);
+	if (scenes_.size() >= sweep_size_) {  // drop expired entries
+		for (auto it = scenes_.begin(); it != scenes_.end();)
+			it = it->second.scene.expired() ? scenes_.erase(it) : std::next(it);
+		sweep_size_ = std::max<size_t>(64, 2 * scenes_.size());
+	}
+	scenes_.emplace(key, Entry{ parent, std::move(msg), scene });
+}
+
+planning_scene::PlanningSceneConstPtr SceneCache::startScene(const planning_scene::PlanningScenePtr& start_scene,
+                                                             const moveit_msgs::PlanningScene& msg) {
+	std::string buffer = serialize(msg);
+	const size_t key = std::hash<std::string>()(buffer);
+	if (auto cached = lookup(key, nullptr, buffer))
+		return cached;
+
+	start_scene->setPlanningSceneMsg(msg);
+	insert(key, nullptr, std::move(buffer), start_scene);
+	return start_scene;
+}
+
+planning_scene::PlanningSceneConstPtr SceneCache::diffScene(const planning_scene::PlanningSceneConstPtr& parent,
+                                                            const moveit_msgs::PlanningScene& msg) {
+	std::string buffer = serialize(msg);
+	const size_t key = std::hash<std::string>()(buffer) ^ std::hash<const void*>()(parent.get());
+	if (auto cached = lookup(key, parent.get(), buffer))
+		return cached;
+
+	planning_scene::PlanningScenePtr scene = parent->diff();
+	scene->setPlanningSceneDiffMsg(msg);
+	insert(key, parent.get(), std::move(buffer), scene);
+	return scene;
+}
+
+size_t SceneCache::size() {
+	std::lock_guard<std::mutex> lock(mutex_);
+	return scenes_.size();
+}
+
 std::pair<size_t, size_t> DisplaySolution::indexPair(size_t index) const {
 	size_t part = 0;
 	for (const auto& d : data_) {
@@ -56,6 +123,24 @@ std::pair<size_t, size_t> DisplaySolution::indexPair(size_t index) const {
 	return std::make_pair(part, index);
 }
 
+std::vector<size_t> DisplaySolution::decimatedWayPoints(double min_distance) const {
+	std::vector<size_t> result;
+	size_t offset = 0;
+	for (const auto& d : data_) {
+		const size_t count = d.trajectory_->getWayPointCount();
+		const moveit::core::RobotState* last = nullptr;
+		for (size_t i = 0; i < count; ++i) {
+			const moveit::core::RobotState& state = d.trajectory_->getWayPoint(i);
+			if (!last || i + 1 == count || min_distance <= 0.0 || state.distance(*last) >= min_distance) {
+				result.push_back(offset + i);
+				last = &state;
+			}
+		}
+		offset += count;
+	}
+	return result;
+}
+
 DisplaySolution::DisplaySolution(const DisplaySolution& master, uint32_t sub)
   : start_scene_(sub == 0 ? master.start_scene_ : master.data_[sub - 1].scene_), data_({ master.data_[sub] }) {
 	steps_ = data_.front().trajectory_->getWayPointCount();
@@ -87,16 +172,20 @@ const MarkerVisualizationPtr DisplaySolution::markers(const DisplaySolution::Ind
 }
 
 void DisplaySolution::setFromMessage(const planning_scene::PlanningScenePtr& start_scene,
-                                     const moveit_task_constructor_msgs::Solution& msg) {
+                                     const moveit_task_constructor_msgs::Solution& msg, SceneCache* cache) {
 	if (msg.start_scene.robot_model_name != start_scene->getRobotModel()->getName())
 		throw std::invalid_argument(fmt::format("Solution for model '{}' but model '{}' was expected",
 		                                        msg.start_scene.robot_model_name,
 		                                        start_scene->getRobotModel()->getName()));
 
 	// initialize parent scene from solution's start scene
-	start_scene->setPlanningSceneMsg(msg.start_scene);
-	start_scene_ = start_scene;
-	planning_scene::PlanningScenePtr ref_scene = start_scene_->diff();
+	if (cache)
+		start_scene_ = cache->startScene(start_scene, msg.start_scene);
+	else {
+		start_scene->setPlanningSceneMsg(msg.start_scene);
+		start_scene_ = start_scene;
+	}
+	planning_scene::PlanningSceneConstPtr ref_scene = start_scene_;
 
 	data_.resize(msg.sub_trajectory.size());
 
@@ -112,12 +201,16 @@ void DisplaySolution::setFromMessage(const planning_scene::PlanningScenePtr& sta
 		data_[i].creator_id_ = sub.info.stage_id;
 		steps_ += data_[i].trajectory_->getWayPointCount();
 
-		ref_scene->setPlanningSceneDiffMsg(sub.scene_diff);
+		// end scene, which is the reference scene for the next iteration
+		if (cache)
+			ref_scene = cache->diffScene(ref_scene, sub.scene_diff);
+		else {
+			planning_scene::PlanningScenePtr diff = ref_scene->diff();
+			diff->setPlanningSceneDiffMsg(sub.scene_diff);
+			ref_scene = diff;
+		}
 		data_[i].scene_ = ref_scene;
 
-		// create new reference scene for next iteration
-		ref_scene = ref_scene->diff();
-
 		if (!sub.info.markers.empty())
 			data_[i].markers_.reset(new MarkerVisualization(sub.info.markers, *ref_scene));
 		else
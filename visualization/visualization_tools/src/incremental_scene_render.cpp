@@ -0,0 +1,127 @@
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2023, Bielefeld University
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Bielefeld University nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+
+/* Desc: Render the world of planning scenes, updating geometry of changed objects only */
+
+#include <moveit/visualization_tools/incremental_scene_render.h>
+
+#include <moveit/planning_scene/planning_scene.h>
+#include <moveit/rviz_plugin_render_tools/render_shapes.h>
+#include <rviz/display_context.h>
+
+#include <OgreSceneManager.h>
+#include <OgreSceneNode.h>
+
+namespace moveit_rviz_plugin {
+
+namespace {
+bool equal(const rviz::Color& a, const rviz::Color& b) {
+	return a.r_ == b.r_ && a.g_ == b.g_ && a.b_ == b.b_;
+}
+}  // namespace
+
+IncrementalSceneRender::IncrementalSceneRender(Ogre::SceneNode* root_node, rviz::DisplayContext* context)
+  : geometry_node_(root_node->createChildSceneNode()), context_(context) {}
+
+IncrementalSceneRender::~IncrementalSceneRender() {
+	clear();
+	context_->getSceneManager()->destroySceneNode(geometry_node_);
+}
+
+void IncrementalSceneRender::destroy(Object& object) {
+	object.shapes.reset();  // destroys the shapes, which are attached to the node
+	if (object.node)
+		context_->getSceneManager()->destroySceneNode(object.node);
+	object.node = nullptr;
+}
+
+void IncrementalSceneRender::clear() {
+	for (auto& pair : objects_)
+		destroy(pair.second);
+	objects_.clear();
+}
+
+void IncrementalSceneRender::renderPlanningScene(const planning_scene::PlanningSceneConstPtr& scene,
+                                                 const rviz::Color& default_env_color,
+                                                 OctreeVoxelRenderMode octree_voxel_rendering,
+                                                 OctreeVoxelColorMode octree_color_mode, float default_scene_alpha) {
+	if (!scene)
+		return;
+
+	if (octree_voxel_rendering != octree_voxel_rendering_ || octree_color_mode != octree_color_mode_) {
+		clear();
+		octree_voxel_rendering_ = octree_voxel_rendering;
+		octree_color_mode_ = octree_color_mode;
+	}
+
+	const collision_detection::WorldConstPtr& world = scene->getWorld();
+	// remove objects that are gone, e.g. attached to the robot
+	for (auto it = objects_.begin(); it != objects_.end();) {
+		if (world->hasObject(it->first))
+			++it;
+		else {
+			destroy(it->second);
+			it = objects_.erase(it);
+		}
+	}
+
+	for (const std::string& id : world->getObjectIds()) {
+		collision_detection::World::ObjectConstPtr object = world->getObject(id);
+		rviz::Color color = default_env_color;
+		float alpha = default_scene_alpha;
+		if (scene->hasObjectColor(id)) {
+			const std_msgs::ColorRGBA& c = scene->getObjectColor(id);
+			color = rviz::Color(c.r, c.g, c.b);
+			alpha = c.a;
+		}
+
+		Object& rendered = objects_[id];
+		if (rendered.object == object && equal(rendered.color, color) && rendered.alpha == alpha)
+			continue;  // unchanged
+
+		if (!rendered.node) {
+			rendered.node = geometry_node_->createChildSceneNode();
+			rendered.shapes = std::make_unique<RenderShapes>(context_);
+		}
+		rendered.shapes->clear();
+		for (std::size_t i = 0; i < object->shapes_.size(); ++i)
+			rendered.shapes->renderShape(rendered.node, object->shapes_[i].get(), object->global_shape_poses_[i],
+			                             octree_voxel_rendering, octree_color_mode, color, alpha);
+		rendered.object = object;
+		rendered.color = color;
+		rendered.alpha = alpha;
+	}
+}
+}  // namespace moveit_rviz_plugin
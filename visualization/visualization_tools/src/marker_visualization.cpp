@@ -9,19 +9,69 @@
 #include <OgreSceneNode.h>
 #include <tf2_msgs/TF2Error.h>
 #include <ros/console.h>
+#include <ros/serialization.h>
+
+#include <algorithm>
+#include <mutex>
+#include <set>
+#include <unordered_map>
 
 namespace moveit_rviz_plugin {
 
-// create MarkerData with nil marker_ pointer, just with a copy of message
-MarkerVisualization::MarkerData::MarkerData(const visualization_msgs::Marker& marker) {
-	msg_.reset(new visualization_msgs::Marker(marker));
-	msg_->header.stamp = ros::Time();
-	msg_->frame_locked = false;
-}
+namespace {
+/* Process-wide pool of marker messages, indexed by a hash of their serialization.
+ * Solutions of a task often carry identical markers, e.g. the target frame or end-effector meshes of all
+ * IK solutions of the same pose. Sharing them avoids keeping thousands of copies in memory. */
+class MarkerPool
+{
+	std::mutex mutex_;
+	std::unordered_multimap<size_t, std::weak_ptr<visualization_msgs::Marker>> markers_;
+	size_t sweep_size_ = 1024;
+
+	static size_t hash(const visualization_msgs::Marker& marker) {
+		std::string buffer(ros::serialization::serializationLength(marker), '\0');
+		ros::serialization::OStream stream(reinterpret_cast<uint8_t*>(&buffer[0]), buffer.size());
+		ros::serialization::serialize(stream, marker);
+		return std::hash<std::string>()(buffer);
+	}
+
+	// drop entries of markers not used anymore
+	void sweep() {
+		for (auto it = markers_.begin(); it != markers_.end();)
+			it = it->second.expired() ? markers_.erase(it) : std::next(it);
+		sweep_size_ = std::max<size_t>(1024, 2 * markers_.size());
+	}
+
+public:
+	static MarkerPool& instance() {
+		static MarkerPool pool;
+		return pool;
+	}
+
+	// return shared message with the same content as marker
+	visualization_msgs::MarkerPtr get(const visualization_msgs::Marker& marker) {
+		const size_t key = hash(marker);
+		std::lock_guard<std::mutex> lock(mutex_);
+		auto range = markers_.equal_range(key);
+		for (auto it = range.first; it != range.second; ++it) {
+			visualization_msgs::MarkerPtr shared = it->second.lock();
+			if (shared && *shared == marker)
+				return shared;
+		}
+		if (markers_.size() >= sweep_size_)
+			sweep();
+		visualization_msgs::MarkerPtr result(new visualization_msgs::Marker(marker));
+		markers_.emplace(key, result);
+		return result;
+	}
+};
+}  // namespace
 
 MarkerVisualization::MarkerVisualization(const std::vector<visualization_msgs::Marker>& markers,
                                          const planning_scene::PlanningScene& end_scene) {
 	planning_frame_ = end_scene.getPlanningFrame();
+	std::set<const visualization_msgs::Marker*> known;
+	visualization_msgs::Marker normalized;
 	// remember marker message, postpone rviz::MarkerBase creation until later
 	for (const auto& marker : markers) {
 		if (!end_scene.knowsFrameTransform(marker.header.frame_id)) {
@@ -30,8 +80,14 @@ MarkerVisualization::MarkerVisualization(const std::vector<visualization_msgs::M
 			continue;  // ignore markers with unknown frame
 		}
 
-		// remember marker message
-		markers_.emplace_back(marker);
+		// remember (shared) marker message, skipping duplicates
+		normalized = marker;
+		normalized.header.stamp = ros::Time();
+		normalized.frame_locked = false;
+		visualization_msgs::MarkerPtr msg = MarkerPool::instance().get(normalized);
+		if (!known.insert(msg.get()).second)
+			continue;
+		markers_.emplace_back(std::move(msg));
 		// remember namespace name
 		namespaces_.insert(std::make_pair(marker.ns, NamespaceData()));
 	}
@@ -104,11 +160,10 @@ bool MarkerVisualization::createMarkers(rviz::DisplayContext* context, Ogre::Sce
 		// w.r.t. rviz' current fixed frame. However, we want to place the marker w.r.t.
 		// the planning frame of the planning scene!
 
-		// Hence, temporarily modify the message-specified frame to planning_frame_
-		const std::string msg_frame = data.msg_->header.frame_id;
-		data.msg_->header.frame_id = planning_frame_;
-		data.marker_->setMessage(data.msg_);
-		data.msg_->header.frame_id = msg_frame;
+		// Hence, pass a copy placed at planning_frame_: the original message is shared with other displays
+		auto msg = boost::make_shared<visualization_msgs::Marker>(*data.msg_);
+		msg->header.frame_id = planning_frame_;
+		data.marker_->setMessage(msg);
 
 		// ... and subsequently revert any transform between rviz' fixed frame and planning_frame_
 		data.marker_->setOrientation(quat * data.marker_->getOrientation());
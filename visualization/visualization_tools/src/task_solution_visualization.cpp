@@ -35,11 +35,11 @@
 /* Author: Robert Haschke */
 
 #include <moveit/visualization_tools/display_solution.h>
+#include <moveit/visualization_tools/incremental_scene_render.h>
 #include <moveit/visualization_tools/task_solution_visualization.h>
 #include <moveit/visualization_tools/marker_visualization.h>
 #include <moveit/visualization_tools/task_solution_panel.h>
 
-#include <moveit/rviz_plugin_render_tools/planning_scene_render.h>
 #include <moveit/rviz_plugin_render_tools/robot_state_visualization.h>
 #include <moveit/rviz_plugin_render_tools/planning_link_updater.h>
 
@@ -68,6 +68,8 @@
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/trim.hpp>
 
+#include <algorithm>
+
 namespace moveit_rviz_plugin {
 TaskSolutionVisualization::TaskSolutionVisualization(rviz::Property* parent, rviz::Display* display)
   : display_(display) {
@@ -99,6 +101,13 @@ TaskSolutionVisualization::TaskSolutionVisualization(rviz::Property* parent, rvi
 	    SLOT(changedTrail()), this);
 	trail_step_size_property_->setMin(1);
 
+	decimation_property_ =
+	    new rviz::FloatProperty("Decimation Distance", 0.0,
+	                            "Skip way points moving less than this joint-space distance since the previously shown "
+	                            "one, both in animation and trail. Speeds up inspection of dense trajectories (0: off).",
+	                            parent, SLOT(changedDecimation()), this);
+	decimation_property_->setMin(0.0);
+
 	// robot properties
 	robot_property_ = new rviz::Property("Robot", QString(), QString(), parent);
 	robot_visual_enabled_property_ = new rviz::BoolProperty("Show Robot Visual", true,
@@ -189,7 +198,7 @@ void TaskSolutionVisualization::onInitialize(Ogre::SceneNode* scene_node, rviz::
 	enabledRobotColor();
 	robot_render_->setVisible(true);
 
-	scene_render_.reset(new PlanningSceneRender(main_scene_node_, context_, RobotStateVisualizationPtr()));
+	scene_render_.reset(new IncrementalSceneRender(main_scene_node_, context_));
 	scene_render_->getGeometryNode()->setVisible(scene_enabled_property_->getBool());
 
 	marker_visual_->onInitialize(main_scene_node_, context_);
@@ -241,6 +250,20 @@ void TaskSolutionVisualization::reset() {
 void TaskSolutionVisualization::clearTrail() {
 	qDeleteAll(trail_);
 	trail_.clear();
+	trail_waypoints_.clear();
+}
+
+int TaskSolutionVisualization::nextWayPoint(int index) const {
+	auto it = std::upper_bound(waypoints_.begin(), waypoints_.end(), static_cast<size_t>(std::max(index, 0)));
+	return it == waypoints_.end() ? index + 1 : static_cast<int>(*it);
+}
+
+void TaskSolutionVisualization::changedDecimation() {
+	if (displaying_solution_)
+		waypoints_ = displaying_solution_->decimatedWayPoints(decimation_property_->getFloat());
+	else
+		waypoints_.clear();
+	changedTrail();
 }
 
 void TaskSolutionVisualization::changedLoopDisplay() {
@@ -264,10 +287,13 @@ void TaskSolutionVisualization::changedTrail() {
 	setVisibility(main_scene_node_, parent_scene_node_, true);
 	setVisibility(trail_scene_node_, main_scene_node_, true);
 
-	int stepsize = trail_step_size_property_->getInt();
-	trail_.resize(t->getWayPointCount() / stepsize);
+	// trail robots are shown for every stepsize-th (non-decimated) way point
+	size_t stepsize = trail_step_size_property_->getInt();
+	for (size_t i = 0; i < waypoints_.size(); i += stepsize)
+		trail_waypoints_.push_back(waypoints_[i]);
+	trail_.resize(trail_waypoints_.size());
 	for (std::size_t i = 0; i < trail_.size(); i++) {
-		int waypoint_i = std::min(i * stepsize, t->getWayPointCount() - 1);  // limit to last trajectory point
+		int waypoint_i = trail_waypoints_[i];
 		rviz::Robot* r =
 		    new rviz::Robot(trail_scene_node_, context_, "Trail Robot " + boost::lexical_cast<std::string>(i), nullptr);
 		r->load(*scene_->getRobotModel()->getURDF());
@@ -371,7 +397,7 @@ void TaskSolutionVisualization::update(float wall_dt, float /*ros_dt*/) {
 			current_state_ = -1;
 			animating_ = true;
 			displaying_solution_ = next_solution_to_display_;
-			changedTrail();
+			changedDecimation();
 			if (slider_panel_)
 				slider_panel_->update(next_solution_to_display_->getWayPointCount());
 		}
@@ -411,8 +437,8 @@ void TaskSolutionVisualization::update(float wall_dt, float /*ros_dt*/) {
 				++current_state_;
 				current_state_time_ -= tm;
 			}
-		} else if (current_state_time_ > tm) {  // fixed display time per state
-			++current_state_;
+		} else if (current_state_time_ > tm) {  // fixed display time per (non-decimated) state
+			current_state_ = nextWayPoint(current_state_);
 			current_state_time_ = 0.0;
 		}
 	} else if (current_state_ != previous_state) {  // current_state_ changed from slider
@@ -436,16 +462,14 @@ void TaskSolutionVisualization::update(float wall_dt, float /*ros_dt*/) {
 
 	renderWayPoint(current_state_, previous_state);
 
-	// show / hide trail between start .. end
-	int stepsize = trail_step_size_property_->getInt();
-	int start = std::max(0, previous_state / stepsize);
-	int end = current_state_ / stepsize;
-	bool show = start <= end;
-	if (!show)
-		std::swap(start, end);
-	end = std::min<int>(end, trail_.size());
-	for (; start < end; ++start)
-		trail_[start]->setVisible(show);
+	// show / hide trail robots of way points between previous and current state
+	const bool show = current_state_ > previous_state;
+	const size_t lower = std::max(0, std::min(previous_state, current_state_));
+	const size_t upper = std::max(0, std::max(previous_state, current_state_));
+	auto first = std::upper_bound(trail_waypoints_.begin(), trail_waypoints_.end(), lower);
+	auto last = std::upper_bound(trail_waypoints_.begin(), trail_waypoints_.end(), upper);
+	for (auto it = first; it != last; ++it)
+		trail_[it - trail_waypoints_.begin()]->setVisible(show);
 
 	setVisibility();
 }
@@ -507,12 +531,12 @@ void TaskSolutionVisualization::renderPlanningScene(const planning_scene::Planni
 
 	QColor color = scene_color_property_->getColor();
 	rviz::Color env_color(color.redF(), color.greenF(), color.blueF());
-	color = attached_body_color_property_->getColor();
-	rviz::Color attached_color(color.redF(), color.greenF(), color.blueF());
 
-	scene_render_->renderPlanningScene(
-	    scene, env_color, attached_color, static_cast<OctreeVoxelRenderMode>(octree_render_property_->getOptionInt()),
-	    static_cast<OctreeVoxelColorMode>(octree_coloring_property_->getOptionInt()), scene_alpha_property_->getFloat());
+	// attached bodies are rendered by robot_render_
+	scene_render_->renderPlanningScene(scene, env_color,
+	                                   static_cast<OctreeVoxelRenderMode>(octree_render_property_->getOptionInt()),
+	                                   static_cast<OctreeVoxelColorMode>(octree_coloring_property_->getOptionInt()),
+	                                   scene_alpha_property_->getFloat());
 }
 
 void TaskSolutionVisualization::showTrajectory(const moveit_task_constructor_msgs::Solution& msg) {